@@ -46,48 +46,36 @@ unsigned char* GetMemBuffer(imImage* image, int *size, const char* format)
 {
   int error = IM_ERR_NONE;
   imFile* pMemoryFile = NULL;
-  int oldMode = imBinFileSetCurrentModule(IM_MEMFILE); 
 
-  /// This structure must exist for the lifetime of the memory file
-  imBinMemoryFileName MemFileName;
+  /// This structure must exist for the lifetime of the memory file.
+  /// The buffer is NULL so it will be dynamically allocated, 
+  /// with an initial size of 1000 bytes and a growth rate of 2.
+  imBinFileIO MemIO;
+  imBinFileIOInitMemory(&MemIO, NULL, 1000, 2.0f);
 
-  /// Setting this to null indicates that the buffer will be dynamically allocated
-  MemFileName.buffer = NULL;
-
-  /// The initial buffer size
-  MemFileName.size = 1000;
-
-  /// This constant sets the growth rate of the buffer
-  MemFileName.reallocate = 2.0f;
-
-  /// Allocate the memory file using the given format
-  pMemoryFile = imFileNew((const char*)&MemFileName, format, &error); 
-
-  /// The mode needs to be active only for the imFileOpen/imFileNew call
-  imBinFileSetCurrentModule(oldMode); 
+  /// Allocate the memory file using the given format.
+  /// The I/O is used only by this file, other threads can still use files in disk.
+  pMemoryFile = imFileNewIO(&MemIO, format, &error); 
 
   if (!pMemoryFile)
   {
-    if (MemFileName.buffer) free(MemFileName.buffer);
-    PrintError(error);
-    return NULL;
+    if (MemIO.memory.buffer) free(MemIO.memory.buffer);
+    PrintError(error);
+    return NULL;
   }
 
   /// Save the imImage to the memory file
   error = imFileSaveImage(pMemoryFile, image);
-
-  if (error == IM_ERR_NONE)
-  {
-    /// Obtain the number of bytes actually used
-    *size = imBinFileSize((imBinFile*)imFileHandle(pMemoryFile, 0));
-  }
-  else
-    PrintError(error);
+  if (error != IM_ERR_NONE)
+    PrintError(error);
 
   /// Close the memory file now
   imFileClose(pMemoryFile);
 
-  return MemFileName.buffer;
+  /// Obtain the number of bytes actually used
+  *size = (int)MemIO.file_size;
+
+  return MemIO.memory.buffer;
 }
 
 int main(int argc, char* argv[])
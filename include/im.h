@@ -99,6 +99,22 @@ imFile* imFileOpenAs(const char* file_name, const char* format, int *error);
  * \ingroup file */
 imFile* imFileNew(const char* file_name, const char* format, int *error);
 
+struct _imBinFileIO;  /* see im_binfile.h */
+
+/** Opens the file for reading from the given I/O, for instance a memory buffer or user callbacks, see \ref imBinFileIO. \n
+ * The I/O is used only by this file, so other threads can read and write files in memory or in disk at the same time.
+ * If format is NULL, it will try to identify the file format. 
+ * Formats that do not use the \ref binfile (like AVI and WMV) are not supported.
+ * See also \ref imErrorCodes.
+ * \ingroup file */
+imFile* imFileOpenIO(struct _imBinFileIO* io, const char* format, int *error);
+
+/** Creates a new file for writing to the given I/O using a specific format, see \ref imBinFileIO. \n
+ * The I/O is used only by this file, like in \ref imFileOpenIO.
+ * See also \ref imErrorCodes and \ref format.
+ * \ingroup file */
+imFile* imFileNewIO(struct _imBinFileIO* io, const char* format, int *error);
+
 /** Closes the file. \n
  * In Lua if this function is not called, the file is closed by the garbage collector.
  *
@@ -218,6 +234,22 @@ int imFileWriteImageInfo(imFile* ifile, int width, int height, int user_color_mo
  * \verbatim ifile:ReadImageData(data: userdata, convert2bitmap: boolean, color_mode_flags: number) -> error: number [in Lua 5] \endverbatim
  * \ingroup file */
 int imFileReadImageData(imFile* ifile, void* data, int convert2bitmap, int color_mode_flags);
+
+/** Reads a block of lines of the image data, so the image can be processed while it is decoded
+ * without holding the whole image in memory. Use it instead of \ref imFileReadImageData, after \ref imFileReadImageInfo. \n
+ * data receives count lines starting at first_line, with the same conversions of \ref imFileReadImageData.
+ * convert2bitmap and color_mode_flags are used only in the first call. If not packed, each plane has count lines. \n
+ * The blocks must be read in the order the lines are stored in the file, without gaps:
+ * from the first line to the last when the user color mode has the same orientation of the file color mode, 
+ * or from the last line to the first otherwise. \n
+ * Supported only by the RAW, BMP, PNM, TIFF, PNG and JPEG formats, 
+ * and only when the file stores the color components of each line together.
+ * Not supported for interlaced PNG. \n
+ * Returns an error code.
+ *
+ * \verbatim ifile:ReadImageLines(data: userdata, first_line: number, count: number, convert2bitmap: boolean, color_mode_flags: number) -> error: number [in Lua 5] \endverbatim
+ * \ingroup file */
+int imFileReadImageLines(imFile* ifile, void* data, int first_line, int count, int convert2bitmap, int color_mode_flags);
                            
 /** Writes the image data. \n
  * Returns an error code.
@@ -226,6 +258,58 @@ int imFileReadImageData(imFile* ifile, void* data, int convert2bitmap, int color
  * \ingroup file */
 int imFileWriteImageData(imFile* ifile, void* data);
 
+/** Writes a block of lines of the image data, so the image can be produced incrementally 
+ * without holding the whole image in memory. Use it instead of \ref imFileWriteImageData. \n
+ * data contains count lines starting at first_line, in the color mode and data type given to \ref imFileWriteImageInfo.
+ * If not packed, each plane has count lines. \n
+ * The blocks must be written in the order the lines are stored in the file, without gaps:
+ * from the first line to the last when the user color mode has the same orientation of the file, 
+ * or from the last line to the first otherwise. 
+ * JPEG, PNG, PNM and TIFF files are top down (use IM_TOPDOWN), BMP files are bottom up, 
+ * RAW files use the user orientation. \n
+ * The image is complete when all its lines are written. \n
+ * Supported only by the RAW, BMP, PNM, TIFF, PNG and JPEG formats, 
+ * and only when the file stores the color components of each line together.
+ * Not supported for interlaced PNG and for TIFF with overviews. \n
+ * The file stores the same image written by \ref imFileWriteImageData, but it is not always byte-identical:
+ * when OpenMP is enabled \ref imFileWriteImageData compresses large JPEG and PNG images in parallel,
+ * using restart markers and separate deflate blocks, and that is not done here. \n
+ * Returns an error code.
+ *
+ * \verbatim ifile:WriteImageLines(data: userdata, first_line: number, count: number) -> error: number [in Lua 5] \endverbatim
+ * \ingroup file */
+int imFileWriteImageLines(imFile* ifile, void* data, int first_line, int count);
+
+/** \brief File Probe Information
+ *
+ * \par
+ * Returned by \ref imFileProbe. Same values returned by \ref imFileGetInfo and \ref imFileReadImageInfo for the first image.
+ * \ingroup file */
+typedef struct _imFileProbeInfo
+{
+  char format[10];     /**< file format name */
+  int image_count;     /**< number of images */
+  int width, height;   /**< first image size */
+  int color_mode;      /**< first image file color mode, see \ref imColorSpace and \ref imColorModeConfig */
+  int data_type;       /**< first image file data type, see \ref imDataType */
+} imFileProbeInfo;
+
+/** Returns the file format and the first image information without opening the file with \ref imFileOpen. \n
+ * For JPEG and PNG files only the markers and chunks before the image data are read, 
+ * no decoder is initialized and no attributes are read. The image data is not validated. For the other formats it is the same as \ref imFileOpen, 
+ * \ref imFileReadImageInfo and \ref imFileClose, but without the \ref counter. \n
+ * Returns an error code. See also \ref imErrorCodes.
+ *
+ * \verbatim im.FileProbe(file_name: string) -> error: number, format: string, width: number, height: number, color_mode: number, data_type: number, image_count: number [in Lua 5] \endverbatim
+ * \ingroup file */
+int imFileProbe(const char* file_name, imFileProbeInfo* info);
+
+/** Probes a list of files using \ref imFileProbe. \n
+ * When compiled with OpenMP the files are probed in parallel. 
+ * errors can be NULL, the info of a file that failed is zeroed.
+ * \ingroup file */
+void imFileProbeList(const char** file_names, int count, imFileProbeInfo* infos, int* errors);
+
 
 
 
@@ -239,7 +323,8 @@ int imFileWriteImageData(imFile* ifile, void* data);
  * \ingroup format */
 void imFormatRegisterInternal(void);
 
-/** Remove all registered formats. Call this if you are checking memory leaks.
+/** Remove all registered formats. Call this if you are checking memory leaks. \n
+ * Must not be called while other threads are using files.
  * \ingroup format */
 void imFormatRemoveAll(void);
 
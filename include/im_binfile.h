@@ -24,6 +24,7 @@ extern "C" {
  * It will process the data only if the file format is diferent from the current CPU.
  * \par
  * Can read from disk or memory. In case of a memory buffer, the file name must be the \ref imBinMemoryFileName structure.
+ * Or the I/O can be selected for each file using \ref imBinFileIO.
  * \par
  * See \ref im_binfile.h
  * \ingroup util */
@@ -146,6 +147,70 @@ typedef struct _imBinMemoryFileName
  * \ingroup binfile */
 void imBinMemoryRelease(unsigned char *buffer);
 
+/** Per File I/O Types.
+ * \ingroup binfile */
+enum imBinFileIOType
+{
+  IM_IO_MEMORY,    /**< Memory buffer that can be read or written (see \ref imBinMemoryFileName). */
+  IM_IO_MEMREAD,   /**< Read only memory buffer, the data is never copied or changed. */
+  IM_IO_CALLBACK   /**< User callbacks (see \ref imBinFileCallbacks). */
+};
+
+/** \brief User I/O Callbacks
+ *
+ * \par
+ *  Used by the \ref IM_IO_CALLBACK I/O. The file starts at offset 0 and it is positioned there when opened. \n
+ *  Callbacks can be called from any thread, but never at the same time for the same file.
+ * \ingroup binfile */
+typedef struct _imBinFileCallbacks
+{
+  void* user_data;   /**< Passed to all the callbacks. */
+  unsigned long (*read)(void* user_data, void* buffer, unsigned long size);         /**< Returns the number of bytes read. NULL if the file can not be read. */
+  unsigned long (*write)(void* user_data, const void* buffer, unsigned long size);  /**< Returns the number of bytes written. NULL if the file can not be written. */
+  int (*seek)(void* user_data, long offset, int origin);  /**< origin is SEEK_SET, SEEK_CUR or SEEK_END. Returns 0 if successful. */
+  unsigned long (*tell)(void* user_data);                 /**< Returns the current position from the begining of the file. */
+} imBinFileCallbacks;
+
+/** \brief Per File I/O
+ *
+ * \par
+ *  Describes where a single file is read or written, 
+ *  so files in memory and files in disk can be used at the same time by different threads,
+ *  without changing the current module (see \ref imBinFileSetCurrentModule). \n
+ *  Initialize it with \ref imBinFileIOInitMemory, \ref imBinFileIOInitMemRead or \ref imBinFileIOInitCallback,
+ *  then use it with \ref imBinFileOpenIO, \ref imBinFileNewIO, \ref imFileOpenIO or \ref imFileNewIO.
+ *  The structure must exist while the file is open.
+ * \ingroup binfile */
+typedef struct _imBinFileIO
+{
+  int type;                     /**< See \ref imBinFileIOType. */
+  imBinMemoryFileName memory;   /**< Used by \ref IM_IO_MEMORY and \ref IM_IO_MEMREAD. When writing, buffer and size are updated if the buffer is reallocated. */
+  imBinFileCallbacks callbacks; /**< Used by \ref IM_IO_CALLBACK. */
+  unsigned long file_size;      /**< Number of bytes in the file, updated when the file is closed. */
+} imBinFileIO;
+
+/** Initializes a memory buffer I/O. Same parameters of \ref imBinMemoryFileName.
+ * \ingroup binfile */
+void imBinFileIOInitMemory(imBinFileIO* io, unsigned char* buffer, int size, float reallocate);
+
+/** Initializes a read only memory buffer I/O. The data is used directly from the buffer, it is not copied.
+ * \ingroup binfile */
+void imBinFileIOInitMemRead(imBinFileIO* io, const unsigned char* buffer, int size);
+
+/** Initializes a user callbacks I/O. The callbacks structure is copied.
+ * \ingroup binfile */
+void imBinFileIOInitCallback(imBinFileIO* io, const imBinFileCallbacks* callbacks);
+
+/** Opens a binary file for reading using the given I/O, independent of the current module.
+ * Returns NULL if failed.
+ * \ingroup binfile */
+imBinFile* imBinFileOpenIO(imBinFileIO* io);
+
+/** Creates a new binary file for writing using the given I/O, independent of the current module.
+ * Returns NULL if failed.
+ * \ingroup binfile */
+imBinFile* imBinFileNewIO(imBinFileIO* io);
+
 
 #if	defined(__cplusplus)
 }
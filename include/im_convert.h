@@ -101,7 +101,8 @@ int imConvertToBitmap(const imImage* src_image, imImage* dst_image, int cpx2real
  * It can be cleared by setting the attribute to NULL. \n
  * MAP images are converted to RGB, and BINARY images are converted to GRAY.
  * Alpha channel is considered and Transparency* attributes are converted to alpha channel.
- * So calculate depth from glformat, not from image depth.
+ * So calculate depth from glformat, not from image depth. \n
+ * RGB and GRAY images with \ref IM_IMAGE_PACKED and no line padding are returned directly, when there is no Transparency* attribute to convert.
  *
  * \verbatim image:GetOpenGLData() -> gldata: userdata, glformat: number [in Lua 5] \endverbatim
  * \ingroup convert */
@@ -26,7 +26,8 @@ extern "C" {
  * Progress in a count reports a value from 0 to 1000. 
  * If -1 indicates the start of a sequence of operations, 1001 ends the sequence. \n
  * If returns 0 the client should abort the operation. \n
- * If the counter is aborted, the callback will be called one last time at 1001.
+ * If the counter is aborted, the callback will be called one last time at 1001. \n
+ * The counter functions can be called from several threads, but then the callback can also be called from those threads.
  * \ingroup counter */
 typedef int (*imCounterCallback)(int counter, void* user_data, const char* text, int progress);
 
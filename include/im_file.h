@@ -61,6 +61,11 @@ struct _imFile
       image_index,
       width,           
       height;
+
+  /* line blocks, after the original members so they keep their offsets */
+  int data_first_line;   /**< first line of the user data, when reading or writing lines */
+  int data_line_count;   /**< number of lines of the user data when reading or writing lines, 0 if the user data has all the lines */
+  int next_line;         /**< next line to be read or written by imFileReadImageLines and imFileWriteImageLines, in the file order */
 };
 
 
@@ -97,6 +102,23 @@ void imFileLineBufferRead(imFile* ifile, void* data, int line, int plane);
  * \ingroup filesdk */
 void imFileLineBufferWrite(imFile* ifile, const void* data, int line, int plane);
 
+/** Same as \ref imFileLineBufferRead but using an external line buffer. \n
+ * Allows several lines to be converted at the same time by different threads.
+ * \ingroup filesdk */
+void imFileLineBufferReadBuffer(imFile* ifile, void* line_buffer, void* data, int line, int plane);
+
+/** Same as \ref imFileLineBufferWrite but using an external line buffer. \n
+ * Allows several lines to be converted at the same time by different threads.
+ * \ingroup filesdk */
+void imFileLineBufferWriteBuffer(imFile* ifile, const void* data, void* line_buffer, int line, int plane);
+
+/** Returns the line address inside the application buffer when no conversion is necessary, 
+ * or NULL if the line must be read into the line buffer and converted by \ref imFileLineBufferRead. \n
+ * Used to decode directly into the application buffer, skipping the line buffer copy. 
+ * The format must not write more than line_buffer_size bytes.
+ * \ingroup filesdk */
+void* imFileLineBufferDirect(imFile* ifile, void* data, int line, int plane);
+
 /** Utility to calculate the line size in byte with a specified alignment. \n
  * "align" can be 1, 2 or 4.
  * \ingroup filesdk */
@@ -38,6 +38,15 @@ public:
   virtual int ReadImageData(void* data) = 0;
   virtual int WriteImageInfo() = 0;            // Should update compression
   virtual int WriteImageData(void* data) = 0;  // Must update image_count
+
+  /* Optional Virtual Methods. */
+
+  virtual void LoadAttributes() {}  // Called before the attribute table is accessed by the application, 
+                                    // can add attributes read in ReadImageInfo but not parsed yet
+  virtual int ReadImageLines(void* data, int first_line, int count)   // first_line is in the file order
+  { (void)data; (void)first_line; (void)count; return IM_ERR_DATA; }
+  virtual int WriteImageLines(void* data, int first_line, int count)  // first_line is in the file order, 
+  { (void)data; (void)first_line; (void)count; return IM_ERR_DATA; }  // must finish the image and update image_count after the last line
 };
 
 /** \brief Image File Format Descriptor Class (SDK Use Only) 
@@ -85,10 +94,20 @@ imFileFormatBase* imFileFormatBaseOpenAs(const char* file_name, const char* form
  * Used by "im_file.cpp" only. */
 imFileFormatBase* imFileFormatBaseNew(const char* file_name, const char* format, int *error);
 
+/* Returns the format driver that imFileFormatBaseOpen will try first for the file.
+ * Used by "im_fileprobe.cpp" only. */
+const imFormat* imFormatFindFirst(const char* file_name);
+
+/* Returns the color mode of a IM_MAP image changed to IM_GRAY or IM_BINARY when the palette allows,
+ * like imFileReadImageInfo does. palette must have 256 colors.
+ * Used by "im_fileprobe.cpp" only. */
+int imFilePaletteColorMode(int file_color_mode, const long* palette, int palette_count);
+
 
 /* File Format SDK */
 
-/** Register a format driver.
+/** Register a format driver. Can be called from any thread. \n
+ * The format is owned by the library, it is destroyed if the list is full (maximum of 50 formats).
  * \ingroup filesdk */
 void imFormatRegister(imFormat* iformat);
 
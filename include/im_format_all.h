@@ -61,6 +61,9 @@ extern "C" {
       ExtraSampleInfo IM_USHORT (1) (description of alpha channel: 0- uknown, 1- pre-multiplied, 2-normal)
       JPEGQuality IM_INT (1) [0-100, default 75] (write only)
       ZIPQuality IM_INT (1) [1-9, default 6] (write only)
+      TileWidth, TileLength IM_INT (1) [multiple of 16] (write only) (when defined the image is written in tiles instead of strips)
+      OverviewCount IM_INT (1) [default 0] (write only) (number of reduced resolution images, each one half the size of the previous)
+      OverviewType (string) ["SUBIFD", "PAGES"] (write only) (overviews are written as SubIFDs of the image [default], or as the next images in the file)
       ResolutionUnit (string) ["DPC", "DPI"]
       XResolution, YResolution IM_FLOAT (1)
       Description, Author, Copyright, DateTime, DocumentName,
@@ -99,9 +102,12 @@ extern "C" {
 
     Comments:
       LogLuv is in fact Y'+CIE(u,v), so we choose to always convert it to XYZ.
-      SubIFD is handled only for DNG.
+      SubIFD is handled for DNG. For other files a SubIFD is loaded only when SubIFDSelect is defined.
       Since LZW patent expired, LZW compression is enabled. LZW Copyright Unisys.
       libGeoTIFF can be used without XTIFF initialization. Use Handle(1) to obtain a TIFF*.
+      When compiled with OpenMP, large compressed images are decoded in parallel,
+        one strip or one row of tiles at a time, each thread with its own libTIFF handle.
+        Also the tiles of large images are compressed in parallel when using LZW, RLE, DEFLATE or ADOBEDEFLATE.
 
     Changes:
       "tiff_jpeg.c" - commented "downsampled_output = TRUE" and downsampled_input = TRUE.
@@ -145,6 +151,7 @@ void imFormatRegisterTIFF(void);
 
     Attributes:
       AutoYCbCr IM_INT (1) (controls YCbCr auto conversion) default 1
+      SkipMetadata IM_INT (1) (when 1 the Description and the Exif tags are not read) default 0, set before ReadImageInfo
       JPEGQuality IM_INT (1) [0-100, default 75] (write only)
       ResolutionUnit (string) ["DPC", "DPI"]
       XResolution, YResolution IM_FLOAT (1)
@@ -156,6 +163,8 @@ void imFormatRegisterTIFF(void);
       jdatadst.c - fflush and ferror replaced by macros JFFLUSH and JFERROR.
       jinclude.h - standard JFFLUSH and JFERROR definitions, and new macro HAVE_JFIO.
       new file created: jconfig.h from jconfig.txt
+      new files jsimd.h and jdsimd.c - SSE2 versions of the IDCT, upsampling and YCbCr to RGB conversion,
+        selected at run time in jddctmgr.c, jdsample.c and jdcolor.c (JSIMD_FORCENONE=1 disables them).
 
     Changes to libEXIF:
       new files config.h and _stdint.h
@@ -166,6 +175,14 @@ void imFormatRegisterTIFF(void);
       No thumbnail support.
       RGB images are automatically converted to YCbCr when saved.
       Also YcbCr are automatically converted to RGB when loaded. Use AutoYCbCr=0 to disable this behavior.
+      When compiled with OpenMP, files with restart markers aligned to the MCU rows are decoded in parallel,
+        and large non progressive images are encoded in parallel using one MCU row as the restart interval.
+      The Exif tags are parsed only when the attributes are first accessed,
+        by imFileGetAttribute, imFileGetAttributeList, imFileSetAttribute or imFileLoadImage.
+        The image loading functions always parse them, because the image keeps its own copy of the attributes
+        after the file is closed. Use SkipMetadata=1 to load images without the Exif tags.
+      Lossless rotations, flips and crop of the DCT coefficients are available in im_jpeg.h,
+        see imFileTransformJPEG and imFileCropJPEG.
 \endverbatim
  * \ingroup format */
 void imFormatRegisterJPEG(void);
@@ -194,6 +211,10 @@ void imFormatRegisterJPEG(void);
 
     Attributes:
       ZIPQuality IM_INT (1) [1-9, default 6] (write only)
+      ZIPStrategy (string) ["DEFAULT", "FILTERED", "HUFFMAN", "RLE", "FIXED"] (write only)
+        [default FILTERED, or DEFAULT when PNGFilter is NONE] (other values return IM_ERR_DATA)
+      PNGFilter (string) ["NONE", "SUB", "UP", "AVERAGE", "PAETH", "ADAPTIVE"] (write only)
+        [default ADAPTIVE, or NONE for MAP and Binary images] (other values return IM_ERR_DATA)
       ResolutionUnit (string) ["DPC", "DPI"]
       XResolution, YResolution IM_FLOAT (1)
       Interlaced (same as Progressive) IM_INT (1 | 0) default 0
@@ -220,6 +241,8 @@ void imFormatRegisterJPEG(void);
       When saving PNG image with TransparencyIndex or TransparencyMap, TransparencyMap has precedence, 
         so set it to NULL if you changed TransparencyIndex.
       Attributes set after the image are ignored.
+      When compiled with OpenMP, large non interlaced images are compressed in parallel 
+        using independent blocks of rows joined in a single zlib stream.
 \endverbatim
  * \ingroup format */
 void imFormatRegisterPNG(void);
@@ -259,10 +282,15 @@ void imFormatRegisterPNG(void);
       Disposal (string) [UNDEF, LEAVE, RBACK, RPREV]
       Delay IM_USHORT (1) [time to wait betweed frames in 1/100 of a second]
       Iterations IM_USHORT (1) (NETSCAPE2.0 Application Extension) [The number of times to repeat the animation. 0 means to repeat forever. ]
+      FrameDifference IM_INT (1 | 0) default 0 (write only) [When 1, an image that has the same size, position and palette of the previous one
+                                  is written as the rectangle of the changed pixels, with the unchanged pixels as transparent.]
 
     Comments:
       Attributes after the last image are ignored.
       Reads GIF87 and GIF89, but writes GIF89 always.
+      The complete image data is decoded at once, each LZW code is expanded directly into the image buffer.
+      Difference frames are used only when the previous image has no TransparencyIndex and 
+        its Disposal is not RBACK or RPREV. They are read as images with XScreen and YScreen.
       Ignored attributes: Background Color Index, Pixel Aspect Ratio,
                           Plain Text Extensions, Application Extensions...
 \endverbatim
@@ -50,6 +50,7 @@ extern "C" {
  
     Attributes:
       CompressionRatio IM_FLOAT (1) [write only, example: Ratio=7 just like 7:1]
+      DecodeThreads IM_INT (1) [read only, number of threads used to decode, default is all available. Set it before ReadImageInfo]
       GeoTIFFBox IM_BYTE (n)
       XMLPacket IM_BYTE (n)
 
@@ -63,6 +64,10 @@ extern "C" {
       Changed base/jas_stream.c to export jas_stream_create and jas_stream_initbuf.
       Changed jp2/jp2_dec.c and jpc/jpc_cs.c to remove "uint" and "ulong" usage.
       The counter is restarted many times, because it has many phases.
+      When OpenMP is available the code-blocks, the tiles, the inverse wavelet transform 
+        and the inverse color transform are decoded in parallel. 
+        Changed jpc/jpc_dec.c, jpc/jpc_dec.h, jpc/jpc_t1dec.c, jpc/jpc_mct.c and base/jas_image.c.
+      Changed jpc/jpc_qmfb.c to use SSE2 in the inverse wavelet lifting, the result is the same.
 \endverbatim
  * \ingroup format */
  
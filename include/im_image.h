@@ -47,15 +47,21 @@ typedef struct _imImage
 
   /* secondary parameters */
   int depth;          /**< Number of planes                      (ColorSpaceDepth)   image:Depth() -> depth: number [in Lua 5].       */
-  int line_size;      /**< Number of bytes per line in one plane (width * DataTypeSize)    */
-  int plane_size;     /**< Number of bytes per plane.            (line_size * height)      */
-  int size;           /**< Number of bytes occupied by the image (plane_size * depth)      */
+  int line_size;      /**< Number of bytes per line in one plane (width * DataTypeSize)    \n
+                           When packed all the components are in the line (width * (depth+has_alpha) * DataTypeSize). */
+  int plane_size;     /**< Number of bytes per plane.            (line_stride * height)    \n
+                           When packed is the offset from one component to the next (DataTypeSize). */
+  int size;           /**< Number of bytes occupied by the image (plane_size * depth)      \n
+                           When packed includes the alpha component (line_stride * height). */
   int count;          /**< Number of pixels per plane            (width * height)          */
 
   /* image data */
   void** data;        /**< Image data organized as a 2D matrix with several planes.   \n
                            But plane 0 is also a pointer to the full data.            \n
                            The remaining planes are: data[i] = data[0] + i*plane_size \n
+                           Line y of plane i starts at data[i] + y*line_stride.        \n
+                           When packed, the components of a pixel are consecutive and data[i] points to the first pixel of component i, \n
+                           so pixel x of component i is at position x*(depth+has_alpha) of the line. \n
                            In Lua, data indexing is possible using: image[plane][row][column] */
 
   /* image attributes */
@@ -64,6 +70,14 @@ typedef struct _imImage
   int palette_count;  /**< The palette is always 256 colors allocated, but can have less colors used. */
 
   void* attrib_table; /**< in fact is an imAttribTable, but we hide this here */
+
+  /* data layout, after the original members so they keep their offsets */
+  int line_stride;    /**< Number of bytes from one line to the next in one plane. \n
+                           Equal to line_size, unless lines are padded (see \ref IM_IMAGE_ALIGNED and \ref imImageInitStride). */
+  int flags;          /**< Layout flags given at creation (see \ref imImageCreateFlags). IM_IMAGE_NOCLEAR is not stored. */
+
+  void* shared;       /**< reference counted data and attributes, shared with views and copy-on-write duplicates. NULL if not shared. \n
+                           See \ref imImageCreateView and \ref IM_IMAGE_COPYONWRITE. */
 } imImage;
 
 
@@ -78,17 +92,109 @@ typedef struct _imImage
  * \ingroup imgclass */
 imImage* imImageCreate(int width, int height, int color_space, int data_type);
 
+/** Image creation flags. See \ref imImageCreateEx.
+ * \ingroup imgclass */
+enum imImageCreateFlags
+{
+  IM_IMAGE_NOCLEAR = 0x01,  /**< image data is not cleared, use it when all the pixels will be written after creation. */
+  IM_IMAGE_ALIGNED = 0x02,  /**< planes start at 64 bytes boundaries and lines are padded to a multiple of 64 bytes.
+                                 Rows can be processed with aligned vector loads, and rows processed by different threads do not share cache lines.
+                                 The padding is not part of the image, see \ref imImageIsContiguous. */
+  IM_IMAGE_COPYONWRITE = 0x04, /**< \ref imImageDuplicate shares the data buffer and the attributes instead of copying them.
+                                 The image receives a private copy only when one of them is changed.
+                                 The imImage functions, image loading, the conversion functions and the processing functions
+                                 do that for the images they write, but when writing directly to the data buffer
+                                 call \ref imImageMakeWritable first. Duplicates also have this flag.
+                                 It can also be set or reset in image->flags after creation. */
+  IM_IMAGE_PACKED = 0x08    /**< the components of each pixel are interleaved (rgbrgbrgb...), like \ref IM_PACKED in file data.
+                                 Image loading and saving, \ref imImageGetOpenGLData and the imImage functions use the layout directly.
+                                 \ref imConvertColorSpace (except for complex data), the tone and threshold functions that accept padded images,
+                                 \ref imProcessUnaryPointOp, \ref imProcessMultiPointOp and their color versions,
+                                 \ref imProcessResize, \ref imProcessReduce, \ref imProcessReduceBy4,
+                                 \ref imProcessRotate90, \ref imProcessRotate180 and \ref imProcessMirror use the layout directly,
+                                 also when mixed with planar images. Those point operations do not change alpha.
+                                 The arithmetic and logic point operations, \ref imProcessCrop, \ref imProcessInsert, \ref imProcessAddMargins,
+                                 \ref imProcessFlip and \ref imProcessInterlaceSplit use the layout directly when all their images
+                                 are packed with the same number of components, and then alpha is also processed.
+                                 \ref imConvertDataType, the convolution and rank filters and the other processing functions
+                                 process planar copies of packed images and copy the results back, so there is the cost of an extra copy.
+                                 The flag can NOT be changed after creation. */
+};
+
+/** Same as \ref imImageCreate but with creation flags. See \ref imImageCreateFlags.
+ *
+ * \verbatim im.ImageCreate(width: number, height: number, color_space: number, data_type: number, flags: number) -> image: imImage [in Lua 5] \endverbatim
+ * \ingroup imgclass */
+imImage* imImageCreateEx(int width, int height, int color_space, int data_type, int flags);
+
+/** Configures the pool of image buffers. \n
+ * Buffers released by \ref imImageDestroy are kept for reuse by the next images of similar size,
+ * avoiding new allocations when images are created and destroyed in a loop.
+ * Small buffers are not pooled. \n
+ * max_size is the maximum size in Mbytes of the free buffers kept in the pool (default 128),
+ * and max_count is the maximum number of free buffers of each size (default 8).
+ * Use 0 to disable the pool. Free buffers above the new limits are released.
+ * \ingroup imgclass */
+void imImageSetBufferPool(int max_size, int max_count);
+
+/** Releases all the free buffers kept in the pool. The pool configuration is not changed.
+ * \ingroup imgclass */
+void imImageReleaseBufferPool(void);
+
 /** Initializes the image structure but does not allocates image data.
  * See also \ref imDataType and \ref imColorSpace. 
- * The only addtional flag thar color_mode can has here is IM_ALPHA.
+ * The only addtional flags thar color_mode can has here are IM_ALPHA and IM_PACKED (see \ref IM_IMAGE_PACKED).
  * To release the image structure without releasing the buffer, 
  * set "data[0]" to NULL before calling imImageDestroy.
  * \ingroup imgclass */
 imImage* imImageInit(int width, int height, int color_mode, int data_type, void* data_buffer, long* palette, int palette_count);
 
+/** Same as \ref imImageInit but for a buffer with padded lines or planes. \n
+ * line_stride is the number of bytes from one line to the next,
+ * and plane_size is the number of bytes from one plane to the next. \n
+ * Use 0 for the default values, i.e. line_stride=width*DataTypeSize and plane_size=line_stride*height. \n * For IM_PACKED plane_size must be 0. \n
+ * The padding is never written by the imImage functions.
+ * \ingroup imgclass */
+imImage* imImageInitStride(int width, int height, int color_mode, int data_type, void* data_buffer, int line_stride, int plane_size, long* palette, int palette_count);
+
+/** Returns 1 if lines and planes have no padding, so all the planes can be accessed as a single array of depth*count pixels.
+ * Returns 0 otherwise, and always for packed images (see \ref IM_IMAGE_PACKED). \n
+ * Images with padding (including views) are accessed directly by the imImage functions, image storage,
+ * \ref imConvertDataType, \ref imConvertColorSpace (except RGB to MAP), the arithmetic and logic operations,
+ * \ref imProcessUnaryPointOp, \ref imProcessMultiPointOp and their color versions, \ref imProcessToneGamut and the other tone functions
+ * (except histogram based), the threshold functions (except error diffusion, hysteresis and local max), the convolution and rank filters,
+ * \ref imProcessResize, \ref imProcessReduce, \ref imProcessReduceBy4, \ref imProcessRotate90, \ref imProcessRotate180,
+ * \ref imProcessMirror, \ref imProcessFlip, \ref imProcessCrop, \ref imProcessInsert and \ref imProcessAddMargins.
+ * The other processing functions, like morphology, rendering, quantization, \ref imProcessRotate and the analysis functions,
+ * process contiguous copies of those images, and copy the results back.
+ * \ingroup imgclass */
+int imImageIsContiguous(const imImage* image);
+
+/** Creates a view of a rectangular region of the image without copying pixels. \n
+ * The view data points inside the image data, with the same line_stride and plane_size,
+ * so changes in one are visible in the other. Attributes and palette are also shared. \n
+ * The view has the flags of the image, except \ref IM_IMAGE_ALIGNED because its data is not aligned.
+ * All the processing functions accept views, but only some of them avoid a copy, see \ref imImageIsContiguous. \n
+ * The data buffer, the attributes and the palette are reference counted,
+ * they are released only when the image and all its views were destroyed, in any order.
+ * A view can also be created from another view. \n
+ * \ref imImageAddAlpha, \ref imImageRemoveAlpha and \ref imImageReshape detach the image, i.e. it receives a private copy of its data. \n
+ * Returns NULL if the region is not inside the image.
+ * \ingroup imgclass */
+imImage* imImageCreateView(imImage* image, int xmin, int ymin, int width, int height);
+
+/** Makes sure the image does not share its data buffer and its attributes with copy-on-write duplicates,
+ * copying them if necessary. Must be called before writing directly to the data buffer of an image
+ * created with \ref IM_IMAGE_COPYONWRITE. Does nothing for other images, and views remain shared. \n
+ * Returns 0 if failed to allocate the copy.
+ *
+ * \verbatim image:MakeWritable() -> ok: boolean [in Lua 5] \endverbatim
+ * \ingroup imgclass */
+int imImageMakeWritable(imImage* image);
+
 /** Creates a new image based on an existing one. \n
  * If the addicional parameters are -1, the given image parameters are used. \n
- * The image atributes always are copied. HasAlpha is copied.
+ * The image atributes always are copied. HasAlpha is copied. IM_IMAGE_ALIGNED is also copied.
  * See also \ref imDataType and \ref imColorSpace.
  *
  * \verbatim im.ImageCreateBased(image: imImage, [width: number], [height: number], [color_space: number], [data_type: number]) -> image: imImage [in Lua 5] \endverbatim
@@ -166,13 +272,14 @@ void imImageMergeAttributes(const imImage* src_image, imImage* dst_image);
  * \ingroup imgclass */
 void imImageCopyPlane(const imImage* src_image, int src_plane, imImage* dst_image, int dst_plane);
 
-/** Creates a copy of the image.
+/** Creates a copy of the image. IM_IMAGE_ALIGNED is preserved.
+ * If the image has IM_IMAGE_COPYONWRITE, the pixels and the attributes are shared until one of the images change them.
  *
  * \verbatim image:Duplicate() -> new_image: imImage [in Lua 5] \endverbatim
  * \ingroup imgclass */
 imImage* imImageDuplicate(const imImage* image);
 
-/** Creates a clone of the image. i.e. same attributes but ignore contents.
+/** Creates a clone of the image. i.e. same attributes but ignore contents. IM_IMAGE_ALIGNED is preserved.
  *
  * \verbatim image:Clone() -> new_image: imImage [in Lua 5] \endverbatim
  * \ingroup imgclass */
@@ -381,6 +488,74 @@ void imFileLoadBitmapFrame(imFile* ifile, int index, imImage* image, int *error)
  * \ingroup imgfile */
 int imFileSaveImage(imFile* ifile, const imImage* image);
 
+/** Read-ahead state of an already open file. See \ref imFileReadAheadStart.
+ * \ingroup imgfile */
+typedef struct _imFileReadAhead imFileReadAhead;
+
+/** Starts a background thread that loads the images of an already open file
+ * while the application processes the previous ones. \n
+ * index_list contains the index of the images to be loaded, in order.
+ * If NULL all the images from 0 to image_count-1 are loaded, and index_count is ignored. \n
+ * queue_size is the maximum number of loaded images waiting to be retrieved,
+ * when the queue is full the thread waits. \n
+ * If bitmap is non zero the images are loaded as in \ref imFileLoadBitmap. \n
+ * While the read-ahead is active the file must not be used by the application,
+ * and the counter callback will be called from the background thread. \n
+ * Returns NULL if failed.
+ * \ingroup imgfile */
+imFileReadAhead* imFileReadAheadStart(imFile* ifile, const int* index_list, int index_count, int queue_size, int bitmap);
+
+/** Returns the next loaded image, waits if it is not loaded yet.
+ * If index is not NULL returns the image index in the file. \n
+ * Returns NULL when all the images were returned or if failed, in this case check the error. \n
+ * The image belongs to the application. Use \ref imFileReadAheadRelease when done,
+ * so its buffer can be reused for the next images, or destroy it with \ref imImageDestroy.
+ * See also \ref imErrorCodes.
+ * \ingroup imgfile */
+imImage* imFileReadAheadNext(imFileReadAhead* read_ahead, int *index, int *error);
+
+/** Returns an image to the read-ahead pool, it will be reused by the next images with the same parameters.
+ * \ingroup imgfile */
+void imFileReadAheadRelease(imFileReadAhead* read_ahead, imImage* image);
+
+/** Cancels the loading of the remaining images and waits for the thread to finish.
+ * The image being loaded is completed first. \n
+ * Destroys the images in the queue and in the pool, images not released by the application are not destroyed.
+ * After this the file can be used again.
+ * \ingroup imgfile */
+void imFileReadAheadStop(imFileReadAhead* read_ahead);
+
+/** Batch loader state. See \ref imFileImageLoadBatchStart.
+ * \ingroup imgfile */
+typedef struct _imFileImageBatch imFileImageBatch;
+
+/** Starts a pool of threads that load a list of files using \ref imFileImageLoad, 
+ * always the first image of each file. The images are returned in the same order of the list. \n
+ * thread_count is the number of threads, if 0 or less uses the number of processors. \n
+ * max_memory is the maximum size in megabytes of the loaded images waiting to be retrieved, 
+ * when reached the threads wait. 0 means no limit. 
+ * Notice that the next image in order is always loaded, and the images being loaded are not included. \n
+ * If bitmap is non zero the images are loaded as in \ref imFileImageLoadBitmap. \n
+ * The file_names array is copied, but not the strings, they must exist until \ref imFileImageLoadBatchStop. \n
+ * The counter callback will be called from the threads, so it must be thread safe. \n
+ * Returns NULL if failed.
+ * \ingroup imgfile */
+imFileImageBatch* imFileImageLoadBatchStart(const char** file_names, int count, int thread_count, int max_memory, int bitmap);
+
+/** Returns the image of the next file in the list, waits if it is not loaded yet.
+ * If index is not NULL returns the position of the file in the list. \n
+ * If the file failed to load returns NULL and the error, the next call will return the next file. 
+ * Returns NULL and IM_ERR_NONE when all the files were returned. \n
+ * The image belongs to the application. See also \ref imErrorCodes.
+ * \ingroup imgfile */
+imImage* imFileImageLoadBatchNext(imFileImageBatch* batch, int *index, int *error);
+
+/** Cancels the loading of the remaining files and waits for the threads to finish.
+ * The files being loaded are completed first. \n
+ * Destroys the loaded images not yet returned.
+ * \ingroup imgfile */
+void imFileImageLoadBatchStop(imFileImageBatch* batch);
+
 /** Loads an image from file. Open, loads and closes the file. \n
  * index specifies the image number between 0 and image_count-1. \n
  * Returns NULL if failed.
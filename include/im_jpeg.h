@@ -0,0 +1,59 @@
+/** \file
+ * \brief JPEG Lossless Transformations
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_JPEG_H
+#define __IM_JPEG_H
+
+#if	defined(__cplusplus)
+extern "C" {
+#endif
+
+
+/** Lossless transformations of a JPEG file.
+ * \ingroup jpeg */
+enum imJPEGTransform
+{
+  IM_JPEG_NONE,        /**< copy without changes */
+  IM_JPEG_FLIP_H,      /**< horizontal mirror, left-right */
+  IM_JPEG_FLIP_V,      /**< vertical flip, top-bottom */
+  IM_JPEG_TRANSPOSE,   /**< transpose across the top-left to bottom-right diagonal */
+  IM_JPEG_TRANSVERSE,  /**< transpose across the top-right to bottom-left diagonal */
+  IM_JPEG_ROT90,       /**< rotate 90 degrees clockwise */
+  IM_JPEG_ROT180,      /**< rotate 180 degrees */
+  IM_JPEG_ROT270,      /**< rotate 270 degrees clockwise (90 counter clockwise) */
+  IM_JPEG_AUTOORIENT   /**< applies the transformation given by the Exif Orientation tag, that is then set to 1 */
+};
+
+/** Transforms a JPEG file without decompressing it, see \ref imJPEGTransform. \n
+ * The DCT coefficients are only rearranged, so there is no quality loss and it is much faster than
+ * loading, processing and saving the image. \n
+ * Partial iMCU blocks (8 or 16 pixels) at the right or bottom edges that would move to the interior of the image are dropped,
+ * like "jpegtran -trim". So the result size can be smaller than the original size. \n
+ * The markers (Exif, comments, ICC profile, ...) are copied. \n
+ * The source and destination files can be the same.
+ * See also \ref imErrorCodes.
+ *
+ * \verbatim im.FileTransformJPEG(src_file_name: string, dst_file_name: string, transform: number) -> error: number [in Lua 5] \endverbatim
+ * \ingroup jpeg */
+int imFileTransformJPEG(const char* src_file_name, const char* dst_file_name, int transform);
+
+/** Crops a JPEG file without decompressing it. \n
+ * The origin is at the top-left corner of the image.
+ * The top-left corner of the region is moved up and left to the nearest iMCU boundary (8 or 16 pixels),
+ * and the size is increased by the same amount. \n
+ * Returns IM_ERR_DATA if the region is not inside the image.
+ * See also \ref imFileTransformJPEG and \ref imErrorCodes.
+ *
+ * \verbatim im.FileCropJPEG(src_file_name: string, dst_file_name: string, x, y, width, height: number) -> error: number [in Lua 5] \endverbatim
+ * \ingroup jpeg */
+int imFileCropJPEG(const char* src_file_name, const char* dst_file_name, int x, int y, int width, int height);
+
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -78,9 +78,10 @@ inline int imResampleInt(int x, float factor)
 }
 
 /** Does Zero Order Decimation (Mean).
+ * Lines of the map are stride samples apart, and pixels are step samples apart (1 for planar data).
  * \ingroup math */
 template <class T, class TU>
-inline T imZeroOrderDecimation(int width, int height, T *map, float xl, float yl, float box_width, float box_height, TU Dummy)
+inline T imZeroOrderDecimation(int width, int height, T *map, int stride, int step, float xl, float yl, float box_width, float box_height, TU Dummy)
 {
   int x0,x1,y0,y1;
   (void)Dummy;
@@ -107,7 +108,7 @@ inline T imZeroOrderDecimation(int width, int height, T *map, float xl, float yl
   {
     for (int x = x0; x <= x1; x++)
     {
-      Value += map[y*width+x];
+      Value += map[y*stride + x*step];
       Count++;
     }
   }
@@ -121,10 +122,19 @@ inline T imZeroOrderDecimation(int width, int height, T *map, float xl, float yl
   return (T)(Value/(float)Count);
 }
 
+/** Does Zero Order Decimation (Mean) in a contiguous map.
+ * \ingroup math */
+template <class T, class TU>
+inline T imZeroOrderDecimation(int width, int height, T *map, float xl, float yl, float box_width, float box_height, TU Dummy)
+{
+  return imZeroOrderDecimation(width, height, map, width, 1, xl, yl, box_width, box_height, Dummy);
+}
+
 /** Does Bilinear Decimation.
+ * Lines of the map are stride samples apart, and pixels are step samples apart (1 for planar data).
  * \ingroup math */
 template <class T, class TU>
-inline T imBilinearDecimation(int width, int height, T *map, float xl, float yl, float box_width, float box_height, TU Dummy)
+inline T imBilinearDecimation(int width, int height, T *map, int stride, int step, float xl, float yl, float box_width, float box_height, TU Dummy)
 {
   int x0,x1,y0,y1;
   (void)Dummy;
@@ -161,7 +171,7 @@ inline T imBilinearDecimation(int width, int height, T *map, float xl, float yl,
       dxr = xl - (x+0.5f);
       if (dxr < 0) dxr *= -1;
 
-      LineValue += map[y*width+x] * dxr;
+      LineValue += map[y*stride + x*step] * dxr;
       LineNorm += dxr;
     }
 
@@ -178,22 +188,40 @@ inline T imBilinearDecimation(int width, int height, T *map, float xl, float yl,
   return (T)(Value/Norm);
 }
 
+/** Does Bilinear Decimation in a contiguous map.
+ * \ingroup math */
+template <class T, class TU>
+inline T imBilinearDecimation(int width, int height, T *map, float xl, float yl, float box_width, float box_height, TU Dummy)
+{
+  return imBilinearDecimation(width, height, map, width, 1, xl, yl, box_width, box_height, Dummy);
+}
+
 /** Does Zero Order Interpolation (Nearest Neighborhood).
+ * Lines of the map are stride samples apart, and pixels are step samples apart (1 for planar data).
  * \ingroup math */
 template <class T>
-inline T imZeroOrderInterpolation(int width, int height, T *map, float xl, float yl)
+inline T imZeroOrderInterpolation(int width, int height, T *map, int stride, int step, float xl, float yl)
 {
   int x0 = imRound(xl-0.5f);
   int y0 = imRound(yl-0.5f);
   x0 = x0<0? 0: x0>width-1? width-1: x0;
   y0 = y0<0? 0: y0>height-1? height-1: y0;
-  return map[y0*width + x0];
+  return map[y0*stride + x0*step];
+}
+
+/** Does Zero Order Interpolation (Nearest Neighborhood) in a contiguous map.
+ * \ingroup math */
+template <class T>
+inline T imZeroOrderInterpolation(int width, int height, T *map, float xl, float yl)
+{
+  return imZeroOrderInterpolation(width, height, map, width, 1, xl, yl);
 }
 
 /** Does Bilinear Interpolation.
+ * Lines of the map are stride samples apart, and pixels are step samples apart (1 for planar data).
  * \ingroup math */
 template <class T>
-inline T imBilinearInterpolation(int width, int height, T *map, float xl, float yl)
+inline T imBilinearInterpolation(int width, int height, T *map, int stride, int step, float xl, float yl)
 {
   int x0, y0, x1, y1;
   float t, u;
@@ -232,10 +260,10 @@ inline T imBilinearInterpolation(int width, int height, T *map, float xl, float
     u = yl - (y0+0.5f);
   }
 
-  T fll = map[y0*width + x0];
-  T fhl = map[y0*width + x1];
-  T flh = map[y1*width + x0];
-  T fhh = map[y1*width + x1];
+  T fll = map[y0*stride + x0*step];
+  T fhl = map[y0*stride + x1*step];
+  T flh = map[y1*stride + x0*step];
+  T fhh = map[y1*stride + x1*step];
 
   return (T)((fhh - flh - fhl + fll) * u * t +
                          (fhl - fll) * t +
@@ -243,10 +271,19 @@ inline T imBilinearInterpolation(int width, int height, T *map, float xl, float
                                 fll);
 }
 
+/** Does Bilinear Interpolation in a contiguous map.
+ * \ingroup math */
+template <class T>
+inline T imBilinearInterpolation(int width, int height, T *map, float xl, float yl)
+{
+  return imBilinearInterpolation(width, height, map, width, 1, xl, yl);
+}
+
 /** Does Bicubic Interpolation.
+ * Lines of the map are stride samples apart, and pixels are step samples apart (1 for planar data).
  * \ingroup math */
 template <class T, class TU>
-inline T imBicubicInterpolation(int width, int height, T *map, float xl, float yl, TU Dummy)
+inline T imBicubicInterpolation(int width, int height, T *map, int stride, int step, float xl, float yl, TU Dummy)
 {
   int X[4], Y[4];
   float t, u;
@@ -332,7 +369,7 @@ inline T imBicubicInterpolation(int width, int height, T *map, float xl, float y
 
     for (int x = 0; x < 4; x++)
     {
-      LineValue += map[Y[y]*width+X[x]] * CX[x];
+      LineValue += map[Y[y]*stride + X[x]*step] * CX[x];
       LineNorm += CX[x];
     }
 
@@ -355,6 +392,14 @@ inline T imBicubicInterpolation(int width, int height, T *map, float xl, float y
     return (T)(Value);
 }
 
+/** Does Bicubic Interpolation in a contiguous map.
+ * \ingroup math */
+template <class T, class TU>
+inline T imBicubicInterpolation(int width, int height, T *map, float xl, float yl, TU Dummy)
+{
+  return imBicubicInterpolation(width, height, map, width, 1, xl, yl, Dummy);
+}
+
 /** Calculates minimum and maximum values.
  * \ingroup math */
 template <class T> 
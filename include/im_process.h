@@ -26,6 +26,10 @@ extern "C" {
  * Some complex operations use the \ref counter.\n
  * There is no check on the input/output image properties, 
  * check each function documentation before using it.
+ * Images that are not contiguous (see \ref imImageIsContiguous) are accepted by all the functions.
+ * Some functions process padded images directly, the others process contiguous copies of those images,
+ * see \ref imImageIsContiguous for the list.
+ * See \ref IM_IMAGE_PACKED for the functions that process packed images directly.
  * \par
  * To enable OpenMP support use the "im_process_omp.lib/.a/.so" libraries.
  * In Lua call require"imlua_process_omp". \n
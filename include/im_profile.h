@@ -0,0 +1,105 @@
+/** \file
+ * \brief Operation Profiling
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_PROFILE_H
+#define __IM_PROFILE_H
+
+#if	defined(__cplusplus)
+extern "C" {
+#endif
+
+
+/** \defgroup profile Profiling
+ * \par
+ * Measures the operations performed by the library, without an external profiler. \n
+ * When enabled, each operation is timed and aggregated by name:
+ * file open, read, write and close (named "File Open", "File Read TIFF", "File Write TIFF" and "File Close"),
+ * image conversions and the processing functions that use the \ref counter (named by the counter title). \n
+ * Times include the nested operations, for instance a conversion called inside a processing function.
+ * \par
+ * Profiling is disabled by default, and then it has no cost.
+ * \par
+ * See \ref im_profile.h
+ * \ingroup util */
+
+/** Profiling modes. Can be combined.
+ * \ingroup profile */
+enum imProfileMode
+{
+  IM_PROFILE_OFF   = 0x00,  /**< disabled */
+  IM_PROFILE_STATS = 0x01,  /**< aggregate statistics per operation name, see \ref imProfileGetStats */
+  IM_PROFILE_TRACE = 0x02   /**< records a timeline of the operations, see \ref imProfileWriteTrace */
+};
+
+/** Statistics of an operation.
+ * \ingroup profile */
+typedef struct _imProfileStats
+{
+  char name[64];      /**< operation name */
+  int call_count;     /**< number of calls */
+  double wall_time;   /**< elapsed time in seconds */
+  double cpu_time;    /**< CPU time of the process during the calls in seconds, includes the other threads */
+  double pixels;      /**< pixels processed, when reported by the operation */
+  double bytes;       /**< bytes read and written, when reported by the operation */
+  int threads;        /**< maximum number of threads used by a call */
+} imProfileStats;
+
+/** Sets the profiling mode. See \ref imProfileMode. Returns the previous mode. \n
+ * Data already collected is kept, use \ref imProfileReset to clear it.
+ * Change the mode when no operation is running.
+ *
+ * \verbatim im.ProfileSetMode(mode: number) -> old_mode: number [in Lua 5] \endverbatim
+ * \ingroup profile */
+int imProfileSetMode(int mode);
+
+/** Returns the profiling mode.
+ *
+ * \verbatim im.ProfileGetMode() -> mode: number [in Lua 5] \endverbatim
+ * \ingroup profile */
+int imProfileGetMode(void);
+
+/** Clears the statistics and the timeline.
+ *
+ * \verbatim im.ProfileReset() [in Lua 5] \endverbatim
+ * \ingroup profile */
+void imProfileReset(void);
+
+/** Copies a snapshot of the statistics, at most max_count operations in order of their first call. \n
+ * Returns the number of operations, stats can be NULL to return only the number.
+ *
+ * \verbatim im.ProfileGet() -> stats: table of tables [in Lua 5] \endverbatim
+ * Each table has the fields name, call_count, wall_time, cpu_time, pixels, bytes and threads.
+ * \ingroup profile */
+int imProfileGetStats(imProfileStats* stats, int max_count);
+
+/** Writes the recorded timeline in the Chrome Trace Event format (JSON),
+ * that can be viewed in "chrome://tracing" or in Perfetto. \n
+ * The timeline keeps the last 1000000 operations. \n
+ * Returns an error code.
+ *
+ * \verbatim im.ProfileWriteTrace(file_name: string) -> error: number [in Lua 5] \endverbatim
+ * \ingroup profile */
+int imProfileWriteTrace(const char* file_name);
+
+/** Begins an operation in the current thread. Operations can be nested, but must end in the same thread. \n
+ * Does nothing if the profiling is disabled. This is to be used by the operations.
+ * \ingroup profile */
+void imProfileBegin(const char* name, int threads);
+
+/** Adds pixels and bytes to the current operation of the current thread.
+ * \ingroup profile */
+void imProfileAddData(double pixels, double bytes);
+
+/** Ends the current operation of the current thread.
+ * \ingroup profile */
+void imProfileEnd(void);
+
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,957 @@
+/** \file
+ * \brief IM Benchmark
+ *
+ * Times image storage for every registered format and compression,
+ * and the image processing functions, using synthetic images.
+ * Results are written in JSON and can be compared with a previous run.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include <im.h>
+#include <im_lib.h>
+#include <im_util.h>
+#include <im_image.h>
+#include <im_convert.h>
+#include <im_process.h>
+#include <im_kernel.h>
+#include <im_color.h>
+#include <im_format_jp2.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/******************************************************************
+                            Timer
+******************************************************************/
+
+static double iBenchTime(void)  /* in miliseconds */
+{
+#if defined(WIN32) || defined(_WIN32)
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static int iBenchCompareDouble(const void* a, const void* b)
+{
+  double da = *(const double*)a, db = *(const double*)b;
+  return (da > db) - (da < db);
+}
+
+#define IB_MAX_REPEAT 100
+
+struct iBenchTimes
+{
+  double t[IB_MAX_REPEAT];
+  int count;
+};
+
+static void iBenchTimesMinMedian(iBenchTimes* times, double *min, double *median)
+{
+  qsort(times->t, times->count, sizeof(double), iBenchCompareDouble);
+  *min = times->t[0];
+  *median = times->t[times->count/2];
+}
+
+
+/******************************************************************
+                            Options
+******************************************************************/
+
+#define IB_MAX_LIST 16
+
+struct iBenchOptions
+{
+  int width[IB_MAX_LIST], height[IB_MAX_LIST], size_count;
+  int data_type[IB_MAX_LIST], data_type_count;
+  int color_space[IB_MAX_LIST], color_space_count;
+  int threads[IB_MAX_LIST], threads_count;
+  int repeat;
+  int do_formats, do_process;
+  const char* filter;     /* substring of the names to run */
+  const char* dir;        /* for temporary files */
+  const char* output;
+  const char* baseline;
+  const char* input;      /* compare this file instead of running */
+  double tolerance;       /* in percent */
+};
+
+static void iBenchUsage(void)
+{
+  printf("Usage: im_bench [options]\n"
+         "  -size WxH[,WxH...]     image sizes (default 512x512,2048x2048)\n"
+         "  -type t[,t...]         data types: byte, short, ushort, int, float, cfloat (default byte)\n"
+         "  -color c[,c...]        color spaces: rgb, gray (default rgb,gray)\n"
+         "  -threads n[,n...]      OpenMP thread counts for processing (default 1,2,4... up to the processors)\n"
+         "  -repeat n              number of runs of each test, the minimum is reported (default 5)\n"
+         "  -formats | -process    run only the storage or only the processing tests\n"
+         "  -filter text           run only the tests with the text in the name\n"
+         "  -dir path              folder for the temporary files (default current folder)\n"
+         "  -out file              JSON results (default im_bench.json)\n"
+         "  -baseline file         compare with the results of a previous run\n"
+         "  -input file            compare this results file with the baseline instead of running\n"
+         "  -tolerance pct         slowdown above this percentage is a regression (default 10)\n"
+         "Exit code is 2 when regressions are found.\n");
+}
+
+static int iBenchParseList(const char* str, int* list, int max, int (*parse)(const char* item, int* value))
+{
+  char item[64];
+  int count = 0;
+  while (*str && count < max)
+  {
+    int len = (int)strcspn(str, ",");
+    if (len >= (int)sizeof(item))
+      return 0;
+    memcpy(item, str, len);
+    item[len] = 0;
+
+    if (!parse(item, list + count))
+      return 0;
+    count++;
+
+    str += len;
+    if (*str == ',') str++;
+  }
+  return count;
+}
+
+static int iBenchParseInt(const char* item, int* value)
+{
+  *value = atoi(item);
+  return *value > 0;
+}
+
+static int iBenchParseDataType(const char* item, int* value)
+{
+  for (int data_type = IM_BYTE; data_type <= IM_CFLOAT; data_type++)
+  {
+    if (imStrEqual(item, imDataTypeName(data_type)))
+    {
+      *value = data_type;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int iBenchParseColorSpace(const char* item, int* value)
+{
+  if (imStrEqual(item, "rgb"))
+    *value = IM_RGB;
+  else if (imStrEqual(item, "gray"))
+    *value = IM_GRAY;
+  else
+    return 0;
+  return 1;
+}
+
+static int iBenchParseOptions(int argc, char* argv[], iBenchOptions* opt)
+{
+  memset(opt, 0, sizeof(iBenchOptions));
+
+  opt->width[0] = 512;  opt->height[0] = 512;
+  opt->width[1] = 2048; opt->height[1] = 2048;
+  opt->size_count = 2;
+  opt->data_type[0] = IM_BYTE;
+  opt->data_type_count = 1;
+  opt->color_space[0] = IM_RGB;
+  opt->color_space[1] = IM_GRAY;
+  opt->color_space_count = 2;
+  opt->repeat = 5;
+  opt->do_formats = 1;
+  opt->do_process = 1;
+  opt->dir = ".";
+  opt->output = "im_bench.json";
+  opt->tolerance = 10;
+
+#ifdef _OPENMP
+  int max_threads = omp_get_num_procs();
+  for (int n = 1; n < max_threads && opt->threads_count < IB_MAX_LIST-1; n *= 2)
+    opt->threads[opt->threads_count++] = n;
+  opt->threads[opt->threads_count++] = max_threads;
+#else
+  opt->threads[0] = 1;
+  opt->threads_count = 1;
+#endif
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    const char* value = (i+1 < argc)? argv[i+1]: NULL;
+
+    if (imStrEqual(arg, "-formats"))
+      opt->do_process = 0;
+    else if (imStrEqual(arg, "-process"))
+      opt->do_formats = 0;
+    else if (!value)
+      return 0;
+    else
+    {
+      i++;
+
+      if (imStrEqual(arg, "-size"))
+      {
+        opt->size_count = 0;
+        const char* str = value;
+        while (*str && opt->size_count < IB_MAX_LIST)
+        {
+          int w, h;
+          if (sscanf(str, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+            return 0;
+          opt->width[opt->size_count] = w;
+          opt->height[opt->size_count] = h;
+          opt->size_count++;
+
+          str += strcspn(str, ",");
+          if (*str == ',') str++;
+        }
+        if (!opt->size_count)
+          return 0;
+      }
+      else if (imStrEqual(arg, "-type"))
+      {
+        opt->data_type_count = iBenchParseList(value, opt->data_type, IB_MAX_LIST, iBenchParseDataType);
+        if (!opt->data_type_count) return 0;
+      }
+      else if (imStrEqual(arg, "-color"))
+      {
+        opt->color_space_count = iBenchParseList(value, opt->color_space, IB_MAX_LIST, iBenchParseColorSpace);
+        if (!opt->color_space_count) return 0;
+      }
+      else if (imStrEqual(arg, "-threads"))
+      {
+        opt->threads_count = iBenchParseList(value, opt->threads, IB_MAX_LIST, iBenchParseInt);
+        if (!opt->threads_count) return 0;
+      }
+      else if (imStrEqual(arg, "-repeat"))
+      {
+        opt->repeat = atoi(value);
+        if (opt->repeat < 1) opt->repeat = 1;
+        if (opt->repeat > IB_MAX_REPEAT) opt->repeat = IB_MAX_REPEAT;
+      }
+      else if (imStrEqual(arg, "-filter"))
+        opt->filter = value;
+      else if (imStrEqual(arg, "-dir"))
+        opt->dir = value;
+      else if (imStrEqual(arg, "-out"))
+        opt->output = value;
+      else if (imStrEqual(arg, "-baseline"))
+        opt->baseline = value;
+      else if (imStrEqual(arg, "-input"))
+        opt->input = value;
+      else if (imStrEqual(arg, "-tolerance"))
+        opt->tolerance = atof(value);
+      else
+        return 0;
+    }
+  }
+
+  if (opt->input && !opt->baseline)
+    return 0;
+
+  return 1;
+}
+
+
+/******************************************************************
+                            Results
+******************************************************************/
+
+struct iBenchResult
+{
+  char key[200];
+  double min, median;
+  int bytes;
+};
+
+struct iBenchResults
+{
+  iBenchResult* list;
+  int count, size;
+};
+
+static void iBenchResultsAdd(iBenchResults* results, const char* key, double min, double median, int bytes)
+{
+  if (results->count == results->size)
+  {
+    results->size = results->size? 2*results->size: 256;
+    results->list = (iBenchResult*)realloc(results->list, results->size*sizeof(iBenchResult));
+  }
+
+  iBenchResult* result = results->list + results->count;
+  strncpy(result->key, key, sizeof(result->key)-1);
+  result->key[sizeof(result->key)-1] = 0;
+  result->min = min;
+  result->median = median;
+  result->bytes = bytes;
+  results->count++;
+}
+
+static iBenchResult* iBenchResultsFind(iBenchResults* results, const char* key)
+{
+  for (int i = 0; i < results->count; i++)
+  {
+    if (imStrEqual(results->list[i].key, key))
+      return results->list + i;
+  }
+  return NULL;
+}
+
+/* One result per line, so the file can be read back without a JSON parser:
+   {"key": "...", "min_ms": 1.234, "median_ms": 1.345, "bytes": 0}, */
+
+static int iBenchResultsWrite(iBenchResults* results, const char* file_name)
+{
+  FILE* file = fopen(file_name, "w");
+  if (!file)
+    return 0;
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"im_version\": \"%s\",\n", imVersion());
+#ifdef _OPENMP
+  fprintf(file, "  \"openmp\": true,\n");
+#else
+  fprintf(file, "  \"openmp\": false,\n");
+#endif
+  fprintf(file, "  \"results\": [\n");
+  for (int i = 0; i < results->count; i++)
+  {
+    iBenchResult* result = results->list + i;
+    fprintf(file, "    {\"key\": \"%s\", \"min_ms\": %.4f, \"median_ms\": %.4f, \"bytes\": %d}%s\n",
+            result->key, result->min, result->median, result->bytes, (i < results->count-1)? ",": "");
+  }
+  fprintf(file, "  ]\n");
+  fprintf(file, "}\n");
+
+  fclose(file);
+  return 1;
+}
+
+static int iBenchResultsRead(iBenchResults* results, const char* file_name)
+{
+  FILE* file = fopen(file_name, "r");
+  if (!file)
+    return 0;
+
+  char line[1024];
+  while (fgets(line, sizeof(line), file))
+  {
+    const char* key = strstr(line, "\"key\": \"");
+    const char* min = strstr(line, "\"min_ms\": ");
+    const char* median = strstr(line, "\"median_ms\": ");
+    const char* bytes = strstr(line, "\"bytes\": ");
+    if (!key || !min || !median || !bytes)
+      continue;
+
+    key += 8;
+    const char* key_end = strchr(key, '"');
+    if (!key_end)
+      continue;
+
+    char key_str[200];
+    int len = (int)(key_end - key);
+    if (len >= (int)sizeof(key_str))
+      continue;
+    memcpy(key_str, key, len);
+    key_str[len] = 0;
+
+    iBenchResultsAdd(results, key_str, atof(min + 10), atof(median + 13), atoi(bytes + 9));
+  }
+
+  fclose(file);
+  return 1;
+}
+
+static int iBenchCompare(iBenchResults* results, iBenchResults* baseline, double tolerance)
+{
+  int regressions = 0, improvements = 0, compared = 0;
+
+  for (int i = 0; i < results->count; i++)
+  {
+    iBenchResult* result = results->list + i;
+    iBenchResult* base = iBenchResultsFind(baseline, result->key);
+    if (!base || base->min <= 0)
+      continue;
+
+    compared++;
+    double change = 100.0 * (result->min - base->min) / base->min;
+    if (change > tolerance)
+    {
+      printf("REGRESSION  %-60s %10.3f -> %10.3f ms (%+.1f%%)\n", result->key, base->min, result->min, change);
+      regressions++;
+    }
+    else if (change < -tolerance)
+    {
+      printf("improvement %-60s %10.3f -> %10.3f ms (%+.1f%%)\n", result->key, base->min, result->min, change);
+      improvements++;
+    }
+  }
+
+  for (int i = 0; i < baseline->count; i++)
+  {
+    if (!iBenchResultsFind(results, baseline->list[i].key))
+      printf("missing     %s\n", baseline->list[i].key);
+  }
+
+  printf("Compared %d results: %d regressions, %d improvements (tolerance %.1f%%).\n", compared, regressions, improvements, tolerance);
+  return regressions;
+}
+
+
+/******************************************************************
+                        Synthetic Images
+******************************************************************/
+
+/* smooth gradients with some noise, so compression has something to do,
+   the same image for the same parameters in every run */
+static imImage* iBenchCreateImage(int width, int height, int color_space, int data_type)
+{
+  imImage* image = imImageCreate(width, height, color_space, data_type);
+  if (!image)
+    return NULL;
+
+  unsigned int seed = 12345;
+  double type_max = (data_type == IM_FLOAT || data_type == IM_CFLOAT)? 1.0: (double)imColorMax(data_type);
+  if (data_type == IM_INT || data_type == IM_SHORT)
+    type_max = 4095;
+
+  for (int d = 0; d < image->depth; d++)
+  {
+    for (int y = 0; y < height; y++)
+    {
+      for (int x = 0; x < width; x++)
+      {
+        seed = seed * 1103515245 + 12345;
+        double noise = ((seed >> 16) & 0xFF) / 255.0 - 0.5;
+        double v = 0.5 + 0.25*sin(x*(d+1)*0.013) + 0.2*cos(y*0.021 + d) + 0.05*noise;
+        if (v < 0) v = 0;
+        if (v > 1) v = 1;
+        v *= type_max;
+
+        int offset = y*width + x;
+        switch(data_type)
+        {
+        case IM_BYTE:
+          ((imbyte*)image->data[d])[offset] = (imbyte)v;
+          break;
+        case IM_SHORT:
+          ((short*)image->data[d])[offset] = (short)v;
+          break;
+        case IM_USHORT:
+          ((imushort*)image->data[d])[offset] = (imushort)v;
+          break;
+        case IM_INT:
+          ((int*)image->data[d])[offset] = (int)v;
+          break;
+        case IM_FLOAT:
+          ((float*)image->data[d])[offset] = (float)v;
+          break;
+        case IM_CFLOAT:
+          ((float*)image->data[d])[2*offset] = (float)v;
+          ((float*)image->data[d])[2*offset+1] = 0;
+          break;
+        }
+      }
+    }
+  }
+
+  return image;
+}
+
+static void iBenchImageKey(char* key, const imImage* image)
+{
+  sprintf(key, "%dx%d/%s/%s", image->width, image->height,
+          imColorModeSpaceName(image->color_space), imDataTypeName(image->data_type));
+}
+
+
+/******************************************************************
+                            Formats
+******************************************************************/
+
+static int iBenchFileSize(const char* file_name)
+{
+  FILE* file = fopen(file_name, "rb");
+  if (!file)
+    return 0;
+  fseek(file, 0, SEEK_END);
+  int size = (int)ftell(file);
+  fclose(file);
+  return size;
+}
+
+static int iBenchSave(const char* file_name, const char* format, const char* compression, const imImage* image)
+{
+  int error;
+  imFile* ifile = imFileNew(file_name, format, &error);
+  if (!ifile)
+    return error;
+
+  imFileSetInfo(ifile, compression);
+  error = imFileSaveImage(ifile, image);
+  imFileClose(ifile);
+  return error;
+}
+
+static int iBenchLoad(const char* file_name, const imImage* image)
+{
+  int error;
+  imFile* ifile = imFileOpen(file_name, &error);
+  if (!ifile)
+    return error;
+
+  imImage* loaded = imFileLoadImage(ifile, 0, &error);
+  imFileClose(ifile);
+
+  if (loaded)
+  {
+    if (loaded->width != image->width || loaded->height != image->height)
+      error = IM_ERR_DATA;
+    imImageDestroy(loaded);
+  }
+  return error;
+}
+
+static void iBenchFormats(iBenchOptions* opt, const imImage* image, iBenchResults* results)
+{
+  char* format_list[50];
+  int format_count;
+  imFormatList(format_list, &format_count);
+
+  char file_name[1024];
+  sprintf(file_name, "%s/im_bench.tmp", opt->dir);
+
+  char image_key[100];
+  iBenchImageKey(image_key, image);
+
+  int color_mode = image->color_space;
+  if (image->has_alpha)
+    color_mode |= IM_ALPHA;
+
+  for (int f = 0; f < format_count; f++)
+  {
+    char* comp[50];
+    int comp_count = 0;
+    if (imFormatCompressions(format_list[f], comp, &comp_count, color_mode, image->data_type) != IM_ERR_NONE)
+      continue;
+
+    for (int c = 0; c < comp_count; c++)
+    {
+      char name[200];
+      sprintf(name, "%s/%s", format_list[f], comp[c]);
+      if (opt->filter && !strstr(name, opt->filter))
+        continue;
+
+      iBenchTimes save_times, load_times;
+      save_times.count = load_times.count = 0;
+      int error = IM_ERR_NONE, bytes = 0;
+
+      for (int r = 0; r < opt->repeat && !error; r++)
+      {
+        double t0 = iBenchTime();
+        error = iBenchSave(file_name, format_list[f], comp[c], image);
+        double t1 = iBenchTime();
+        if (error)
+          break;
+        save_times.t[save_times.count++] = t1 - t0;
+        bytes = iBenchFileSize(file_name);
+
+        t0 = iBenchTime();
+        error = iBenchLoad(file_name, image);
+        t1 = iBenchTime();
+        if (error)
+          break;
+        load_times.t[load_times.count++] = t1 - t0;
+      }
+
+      remove(file_name);
+
+      if (error)
+      {
+        printf("  %-30s %-24s failed (error %d)\n", name, image_key, error);
+        continue;
+      }
+
+      char key[512];
+      double min, median;
+
+      iBenchTimesMinMedian(&save_times, &min, &median);
+      snprintf(key, sizeof(key), "format/%s/save/%s", name, image_key);
+      iBenchResultsAdd(results, key, min, median, bytes);
+      printf("  %-30s %-24s save %10.3f ms", name, image_key, min);
+
+      iBenchTimesMinMedian(&load_times, &min, &median);
+      snprintf(key, sizeof(key), "format/%s/load/%s", name, image_key);
+      iBenchResultsAdd(results, key, min, median, bytes);
+      printf("  load %10.3f ms  %10d bytes\n", min, bytes);
+    }
+  }
+}
+
+
+/******************************************************************
+                            Processing
+******************************************************************/
+
+struct iBenchData
+{
+  const imImage* src;
+  const imImage* src2;
+  imImage* dst;         /* same as src */
+  imImage* dst_float;   /* same as src, but float */
+  imImage* dst_gray;    /* same as src, but gray */
+  imImage* dst_map;     /* same size, map */
+  imImage* dst_bin;     /* same size, binary */
+  imImage* dst_big;     /* twice the size */
+  imImage* dst_small;   /* half the size */
+  imImage* dst_rotate;  /* size of the 30 degrees rotation */
+  imImage* dst_margins; /* 32 pixels larger in each direction */
+  imImage* bin;         /* binary version of src */
+  imImage* kernel;      /* 3x3 sobel */
+};
+
+#define IB_INTEGER  0x01   /* integer data types only */
+#define IB_BYTE     0x02   /* IM_BYTE only */
+#define IB_GRAY     0x04   /* gray images only */
+#define IB_RGB      0x08   /* RGB images only */
+#define IB_REAL     0x10   /* no complex */
+#define IB_USHORT   0x20   /* IM_BYTE and IM_USHORT only */
+
+typedef void (*iBenchProcessFunc)(iBenchData* d);
+
+struct iBenchProcess
+{
+  const char* name;
+  int flags;
+  iBenchProcessFunc func;
+};
+
+static const double iBenchCos30 = 0.86602540378443864676;
+static const double iBenchSin30 = 0.5;
+
+static void iBenchArithmeticAdd(iBenchData* d) { imProcessArithmeticOp(d->src, d->src2, d->dst, IM_BIN_ADD); }
+static void iBenchArithmeticMul(iBenchData* d) { imProcessArithmeticOp(d->src, d->src2, d->dst_float, IM_BIN_MUL); }
+static void iBenchArithmeticConstMul(iBenchData* d) { imProcessArithmeticConstOp(d->src, 1.5f, d->dst, IM_BIN_MUL); }
+static void iBenchUnArithmeticAbs(iBenchData* d) { imProcessUnArithmeticOp(d->src, d->dst, IM_UN_ABS); }
+static void iBenchUnArithmeticSqrt(iBenchData* d) { imProcessUnArithmeticOp(d->src, d->dst_float, IM_UN_SQRT); }
+static void iBenchBlendConst(iBenchData* d) { imProcessBlendConst(d->src, d->src2, d->dst, 0.3f); }
+static void iBenchBitwiseAnd(iBenchData* d) { imProcessBitwiseOp(d->src, d->src2, d->dst, IM_BIT_AND); }
+static void iBenchBitwiseNot(iBenchData* d) { imProcessBitwiseNot(d->src, d->dst); }
+static void iBenchNegative(iBenchData* d) { imProcessNegative(d->src, d->dst); }
+static void iBenchToneGamutPow(iBenchData* d) { float params[1] = {2.2f}; imProcessToneGamut(d->src, d->dst, IM_GAMUT_POW, params); }
+static void iBenchThreshold(iBenchData* d) { imProcessThreshold(d->src, d->dst_bin, 100, 1); }
+static void iBenchOtsuThreshold(iBenchData* d) { imProcessOtsuThreshold(d->src, d->dst_bin); }
+static void iBenchExpandHistogram(iBenchData* d) { imProcessExpandHistogram(d->src, d->dst, 1); }
+static void iBenchEqualizeHistogram(iBenchData* d) { imProcessEqualizeHistogram(d->src, d->dst); }
+static void iBenchQuantizeRGBUniform(iBenchData* d) { imProcessQuantizeRGBUniform(d->src, d->dst_map, 1); }
+static void iBenchPixelate(iBenchData* d) { imProcessPixelate(d->src, d->dst, 8); }
+static void iBenchPosterize(iBenchData* d) { imProcessPosterize(d->src, d->dst, 4); }
+static void iBenchConvertToFloat(iBenchData* d) { imProcessConvertDataType(d->src, d->dst_float, 0, 0, 0, IM_CAST_MINMAX); }
+static void iBenchConvertToGray(iBenchData* d) { imProcessConvertColorSpace(d->src, d->dst_gray); }
+static void iBenchResizeLinear(iBenchData* d) { imProcessResize(d->src, d->dst_big, 1); }
+static void iBenchResizeBicubic(iBenchData* d) { imProcessResize(d->src, d->dst_big, 3); }
+static void iBenchReduce(iBenchData* d) { imProcessReduce(d->src, d->dst_small, 1); }
+static void iBenchRotate(iBenchData* d) { imProcessRotate(d->src, d->dst_rotate, iBenchCos30, iBenchSin30, 1); }
+static void iBenchMirror(iBenchData* d) { imProcessMirror(d->src, d->dst); }
+static void iBenchFlip(iBenchData* d) { imProcessFlip(d->src, d->dst); }
+static void iBenchCrop(iBenchData* d) { imProcessCrop(d->src, d->dst_small, d->src->width/4, d->src->height/4); }
+static void iBenchAddMargins(iBenchData* d) { imProcessAddMargins(d->src, d->dst_margins, 32, 32); }
+static void iBenchConvolve(iBenchData* d) { imProcessConvolve(d->src, d->dst, d->kernel); }
+static void iBenchMeanConvolve(iBenchData* d) { imProcessMeanConvolve(d->src, d->dst, 5); }
+static void iBenchGaussianConvolve(iBenchData* d) { imProcessGaussianConvolve(d->src, d->dst, 2.0f); }
+static void iBenchMedianConvolve(iBenchData* d) { imProcessMedianConvolve(d->src, d->dst, 3); }
+static void iBenchRankMaxConvolve(iBenchData* d) { imProcessRankMaxConvolve(d->src, d->dst, 3); }
+static void iBenchSobelConvolve(iBenchData* d) { imProcessSobelConvolve(d->src, d->dst); }
+static void iBenchUnsharp(iBenchData* d) { imProcessUnsharp(d->src, d->dst, 2.0f, 0.5f, 0.1f); }
+static void iBenchGrayMorphDilate(iBenchData* d) { imProcessGrayMorphDilate(d->src, d->dst, 3); }
+static void iBenchGrayMorphOpen(iBenchData* d) { imProcessGrayMorphOpen(d->src, d->dst, 5); }
+static void iBenchBinMorphErode(iBenchData* d) { imProcessBinMorphErode(d->bin, d->dst_bin, 3, 1); }
+static void iBenchBinMorphThin(iBenchData* d) { imProcessBinMorphThin(d->bin, d->dst_bin); }
+static void iBenchDistanceTransform(iBenchData* d) { imProcessDistanceTransform(d->bin, d->dst_float); }
+static void iBenchFillHoles(iBenchData* d) { imProcessFillHoles(d->bin, d->dst_bin, 4); }
+static void iBenchCanny(iBenchData* d) { imProcessCanny(d->src, d->dst, 1.5f); }
+static void iBenchSplitHSI(iBenchData* d)
+{
+  imImage* h = imImageCreateBased(d->dst_float, -1, -1, IM_GRAY, IM_FLOAT);
+  imImage* s = imImageClone(h);
+  imImage* i = imImageClone(h);
+  imProcessSplitHSI(d->src, h, s, i);
+  imImageDestroy(h); imImageDestroy(s); imImageDestroy(i);
+}
+static void iBenchRenderGaussianNoise(iBenchData* d) { imProcessRenderAddGaussianNoise(d->src, d->dst, 0, 10); }
+static void iBenchHistogram(iBenchData* d)
+{
+  int hcount;
+  unsigned long* histo = imHistogramNew(d->src->data_type, &hcount);
+  imCalcHistogram(d->src, histo, 0, 0);
+  imHistogramRelease(histo);
+}
+static void iBenchImageStatistics(iBenchData* d) { imStats stats[4]; imCalcImageStatistics(d->src, stats); }
+static void iBenchCountColors(iBenchData* d) { imCalcCountColors(d->src); }
+
+/* To add a function to the benchmark add a line here. */
+static iBenchProcess iBenchProcessList[] = {
+  {"ArithmeticOp/Add",          IB_REAL,                 iBenchArithmeticAdd},
+  {"ArithmeticOp/Mul",          IB_REAL,                 iBenchArithmeticMul},
+  {"ArithmeticConstOp/Mul",     IB_REAL,                 iBenchArithmeticConstMul},
+  {"UnArithmeticOp/Abs",        IB_REAL,                 iBenchUnArithmeticAbs},
+  {"UnArithmeticOp/Sqrt",       IB_REAL,                 iBenchUnArithmeticSqrt},
+  {"BlendConst",                IB_REAL,                 iBenchBlendConst},
+  {"BitwiseOp/And",             IB_INTEGER,              iBenchBitwiseAnd},
+  {"BitwiseNot",                IB_INTEGER,              iBenchBitwiseNot},
+  {"Negative",                  IB_REAL,                 iBenchNegative},
+  {"ToneGamut/Pow",             IB_REAL,                 iBenchToneGamutPow},
+  {"Threshold",                 IB_INTEGER|IB_GRAY,      iBenchThreshold},
+  {"OtsuThreshold",             IB_BYTE|IB_GRAY,         iBenchOtsuThreshold},
+  {"ExpandHistogram",           IB_USHORT,               iBenchExpandHistogram},
+  {"EqualizeHistogram",         IB_USHORT,               iBenchEqualizeHistogram},
+  {"QuantizeRGBUniform",        IB_BYTE|IB_RGB,          iBenchQuantizeRGBUniform},
+  {"Pixelate",                  IB_REAL,                 iBenchPixelate},
+  {"Posterize",                 IB_BYTE,                 iBenchPosterize},
+  {"ConvertDataType/Float",     IB_REAL,                 iBenchConvertToFloat},
+  {"ConvertColorSpace/Gray",    IB_RGB,                  iBenchConvertToGray},
+  {"Resize/Linear",             0,                       iBenchResizeLinear},
+  {"Resize/Bicubic",            0,                       iBenchResizeBicubic},
+  {"Reduce/Linear",             0,                       iBenchReduce},
+  {"Rotate/Linear",             0,                       iBenchRotate},
+  {"Mirror",                    0,                       iBenchMirror},
+  {"Flip",                      0,                       iBenchFlip},
+  {"Crop",                      0,                       iBenchCrop},
+  {"AddMargins",                0,                       iBenchAddMargins},
+  {"Convolve/3x3",              0,                       iBenchConvolve},
+  {"MeanConvolve/5x5",          0,                       iBenchMeanConvolve},
+  {"GaussianConvolve/2",        0,                       iBenchGaussianConvolve},
+  {"MedianConvolve/3x3",        IB_REAL,                 iBenchMedianConvolve},
+  {"RankMaxConvolve/3x3",       IB_REAL,                 iBenchRankMaxConvolve},
+  {"SobelConvolve",             IB_REAL,                 iBenchSobelConvolve},
+  {"Unsharp",                   IB_REAL,                 iBenchUnsharp},
+  {"GrayMorphDilate/3x3",       IB_REAL,                 iBenchGrayMorphDilate},
+  {"GrayMorphOpen/5x5",         IB_REAL,                 iBenchGrayMorphOpen},
+  {"BinMorphErode/3x3",         IB_BYTE|IB_GRAY,         iBenchBinMorphErode},
+  {"BinMorphThin",              IB_BYTE|IB_GRAY,         iBenchBinMorphThin},
+  {"DistanceTransform",         IB_BYTE|IB_GRAY,         iBenchDistanceTransform},
+  {"FillHoles",                 IB_BYTE|IB_GRAY,         iBenchFillHoles},
+  {"Canny",                     IB_BYTE|IB_GRAY,         iBenchCanny},
+  {"SplitHSI",                  IB_BYTE|IB_RGB,          iBenchSplitHSI},
+  {"RenderAddGaussianNoise",    IB_REAL,                 iBenchRenderGaussianNoise},
+  {"CalcHistogram",             IB_USHORT,               iBenchHistogram},
+  {"CalcImageStatistics",       IB_REAL,                 iBenchImageStatistics},
+  {"CalcCountColors",           IB_BYTE,                 iBenchCountColors},
+};
+
+static int iBenchProcessSupported(int flags, const imImage* image)
+{
+  int data_type = image->data_type;
+  if ((flags & IB_BYTE) && data_type != IM_BYTE)
+    return 0;
+  if ((flags & IB_USHORT) && data_type != IM_BYTE && data_type != IM_USHORT)
+    return 0;
+  if ((flags & IB_INTEGER) && data_type >= IM_FLOAT)
+    return 0;
+  if ((flags & IB_REAL) && data_type == IM_CFLOAT)
+    return 0;
+  if ((flags & IB_GRAY) && image->color_space != IM_GRAY)
+    return 0;
+  if ((flags & IB_RGB) && image->color_space != IM_RGB)
+    return 0;
+  return 1;
+}
+
+static void iBenchDataInit(iBenchData* d, const imImage* src)
+{
+  int width = src->width, height = src->height;
+  int rotate_width, rotate_height;
+  imProcessCalcRotateSize(width, height, &rotate_width, &rotate_height, iBenchCos30, iBenchSin30);
+
+  d->src = src;
+  d->src2 = imImageClone(src);
+  imImageCopyData(src, (imImage*)d->src2);
+  imProcessMirror(src, (imImage*)d->src2);
+
+  d->dst = imImageClone(src);
+  d->dst_float = imImageCreateBased(src, -1, -1, -1, (src->data_type == IM_CFLOAT)? IM_CFLOAT: IM_FLOAT);
+  d->dst_gray = imImageCreateBased(src, -1, -1, IM_GRAY, -1);
+  d->dst_map = imImageCreate(width, height, IM_MAP, IM_BYTE);
+  d->dst_bin = imImageCreate(width, height, IM_BINARY, IM_BYTE);
+  d->dst_big = imImageCreateBased(src, 2*width, 2*height, -1, -1);
+  d->dst_small = imImageCreateBased(src, width/2, height/2, -1, -1);
+  d->dst_rotate = imImageCreateBased(src, rotate_width, rotate_height, -1, -1);
+  d->dst_margins = imImageCreateBased(src, width+64, height+64, -1, -1);
+
+  d->bin = imImageCreate(width, height, IM_BINARY, IM_BYTE);
+  if (src->color_space == IM_GRAY && src->data_type == IM_BYTE)
+    imProcessThreshold(src, d->bin, 128, 1);
+
+  d->kernel = imKernelSobel();
+}
+
+static void iBenchDataFinish(iBenchData* d)
+{
+  imImageDestroy((imImage*)d->src2);
+  imImageDestroy(d->dst);
+  imImageDestroy(d->dst_float);
+  imImageDestroy(d->dst_gray);
+  imImageDestroy(d->dst_map);
+  imImageDestroy(d->dst_bin);
+  imImageDestroy(d->dst_big);
+  imImageDestroy(d->dst_small);
+  imImageDestroy(d->dst_rotate);
+  imImageDestroy(d->dst_margins);
+  imImageDestroy(d->bin);
+  imImageDestroy(d->kernel);
+}
+
+static void iBenchProcessAll(iBenchOptions* opt, const imImage* image, iBenchResults* results)
+{
+  char image_key[100];
+  iBenchImageKey(image_key, image);
+
+  iBenchData data;
+  iBenchDataInit(&data, image);
+
+  int process_count = sizeof(iBenchProcessList)/sizeof(iBenchProcess);
+  for (int p = 0; p < process_count; p++)
+  {
+    iBenchProcess* process = iBenchProcessList + p;
+    if (!iBenchProcessSupported(process->flags, image))
+      continue;
+    if (opt->filter && !strstr(process->name, opt->filter))
+      continue;
+
+    printf("  %-30s %-24s", process->name, image_key);
+
+    double single_min = 0;
+    for (int t = 0; t < opt->threads_count; t++)
+    {
+      int threads = opt->threads[t];
+      imProcessOpenMPSetNumThreads(threads);
+
+      iBenchTimes times;
+      times.count = 0;
+      for (int r = 0; r < opt->repeat; r++)
+      {
+        double t0 = iBenchTime();
+        process->func(&data);
+        double t1 = iBenchTime();
+        times.t[times.count++] = t1 - t0;
+      }
+
+      double min, median;
+      iBenchTimesMinMedian(&times, &min, &median);
+      if (t == 0)
+        single_min = min;
+
+      char key[200];
+      snprintf(key, sizeof(key), "process/%s/%s/t%d", process->name, image_key, threads);
+      iBenchResultsAdd(results, key, min, median, 0);
+
+      if (opt->threads_count > 1)
+        printf(" %dt %9.3f ms (x%.2f)", threads, min, (min > 0)? single_min/min: 0);
+      else
+        printf(" %10.3f ms", min);
+    }
+    printf("\n");
+  }
+
+  iBenchDataFinish(&data);
+}
+
+
+/******************************************************************
+                            Main
+******************************************************************/
+
+int main(int argc, char* argv[])
+{
+  iBenchOptions opt;
+  if (!iBenchParseOptions(argc, argv, &opt))
+  {
+    iBenchUsage();
+    return 1;
+  }
+
+  iBenchResults results, baseline;
+  memset(&results, 0, sizeof(iBenchResults));
+  memset(&baseline, 0, sizeof(iBenchResults));
+
+  if (opt.baseline && !iBenchResultsRead(&baseline, opt.baseline))
+  {
+    printf("Error reading baseline \"%s\".\n", opt.baseline);
+    return 1;
+  }
+
+  if (opt.input)
+  {
+    if (!iBenchResultsRead(&results, opt.input))
+    {
+      printf("Error reading results \"%s\".\n", opt.input);
+      return 1;
+    }
+  }
+  else
+  {
+    imFormatRegisterJP2();
+
+    printf("IM %s\n", imVersion());
+
+    for (int s = 0; s < opt.size_count; s++)
+    {
+      for (int c = 0; c < opt.color_space_count; c++)
+      {
+        for (int t = 0; t < opt.data_type_count; t++)
+        {
+          imImage* image = iBenchCreateImage(opt.width[s], opt.height[s], opt.color_space[c], opt.data_type[t]);
+          if (!image)
+          {
+            printf("Insuficient memory for %dx%d images.\n", opt.width[s], opt.height[s]);
+            continue;
+          }
+
+          if (opt.do_formats)
+            iBenchFormats(&opt, image, &results);
+
+          if (opt.do_process)
+            iBenchProcessAll(&opt, image, &results);
+
+          imImageDestroy(image);
+        }
+      }
+    }
+
+    if (!iBenchResultsWrite(&results, opt.output))
+    {
+      printf("Error writing results \"%s\".\n", opt.output);
+      return 1;
+    }
+    printf("Results written to \"%s\".\n", opt.output);
+  }
+
+  int ret = 0;
+  if (opt.baseline && iBenchCompare(&results, &baseline, opt.tolerance))
+    ret = 2;
+
+  free(results.list);
+  free(baseline.list);
+  return ret;
+}
@@ -10,6 +10,7 @@
 #include <im_convert.h>
 
 #include "im_process.h"
+#include "process/im_process_layout.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -131,18 +132,33 @@ static void iDoFFT(void *map, int width, int height, int inverse, int center, in
 
 void imProcessSwapQuadrants(imImage* image, int inverse)
 {
+  imImageMakeWritable(image);
+
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessSwapQuadrants, image, inverse);
+
   for (int i = 0; i < image->depth; i++)
     iCenterFFT((imcfloat*)image->data[i], image->width, image->height, inverse);
 }
 
 void imProcessFFTraw(imImage* image, int inverse, int center, int normalize)
 {
+  imImageMakeWritable(image);
+
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessFFTraw, image, inverse, center, normalize);
+
   for (int i = 0; i < image->depth; i++)
     iDoFFT(image->data[i], image->width, image->height, inverse, center, normalize);
 }
 
 void imProcessFFT(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessFFT, src_image, dst_image);
+
   if (src_image->data_type != IM_CFLOAT)
     imConvertDataType(src_image, dst_image, 0, 0, 0, 0);
   else
@@ -153,6 +169,11 @@ void imProcessFFT(const imImage* src_image, imImage* dst_image)
 
 void imProcessIFFT(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessIFFT, src_image, dst_image);
+
   imImageCopy(src_image, dst_image);
 
   imProcessFFTraw(dst_image, 1, 1, 2); // inverse, uncentered, double normalized
@@ -160,6 +181,11 @@ void imProcessIFFT(const imImage* src_image, imImage* dst_image)
 
 void imProcessCrossCorrelation(const imImage* src_image1, const imImage* src_image2, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  if (!imProcessIsContiguous(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessCrossCorrelation, src_image1, src_image2, dst_image);
+
   imImage *tmp_image = imImageCreate(src_image2->width, src_image2->height, src_image2->color_space, IM_CFLOAT);
   if (!tmp_image) 
     return;
@@ -187,6 +213,11 @@ void imProcessCrossCorrelation(const imImage* src_image1, const imImage* src_ima
 
 void imProcessAutoCorrelation(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessAutoCorrelation, src_image, dst_image);
+
   if (src_image->data_type != IM_CFLOAT)
     imConvertDataType(src_image, dst_image, 0, 0, 0, 0);
   else
@@ -11,16 +11,10 @@
 
 int imBinCPUByteOrder(void)
 {
-  static int CPUByteOrder = -1;
-
-  if (CPUByteOrder == -1)
-  {
-	  unsigned short w = 0x0001;
-	  unsigned char* b = (unsigned char*)&w;
-	  CPUByteOrder = (b[0] == 0x01)? IM_LITTLEENDIAN: IM_BIGENDIAN;
-  }
-
-  return CPUByteOrder;
+  /* not cached, so it can be called from several threads */
+  unsigned short w = 0x0001;
+  unsigned char* b = (unsigned char*)&w;
+  return (b[0] == 0x01)? IM_LITTLEENDIAN: IM_BIGENDIAN;
 }
 
 void imBinSwapBytes(void *data, int count, int size)
@@ -0,0 +1,296 @@
+/** \file
+ * \brief Block Buffered Binary File Access (internal use only)
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_BINBUFFER_H
+#define __IM_BINBUFFER_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "im_binfile.h"
+#include "im_util.h"
+
+
+/* Reads the file in large blocks, so decoders can consume it one byte at a time without a file access per byte.
+ * The file position is ahead of the consumed data until iBinBufferSync is called. 
+ * Can also be used to write, see iBinBufferInitWrite. */
+struct iBinBuffer
+{
+  imBinFile* handle;
+  imbyte* data;
+  int size,      /* allocated size */
+      count,     /* valid bytes in data */
+      pos;       /* next byte to be consumed */
+  unsigned long remain;  /* bytes in the file after the last block, when reading */
+};
+
+#define IM_BINBUFFER_SIZE 65536
+
+/* The block size is limited to the remaining size of the file. Returns 0 if failed. */
+static inline int iBinBufferInit(iBinBuffer* buffer, imBinFile* handle, int size)
+{
+  unsigned long file_size = imBinFileSize(handle);
+  unsigned long offset = imBinFileTell(handle);
+
+  buffer->handle = handle;
+  buffer->count = 0;
+  buffer->pos = 0;
+  buffer->remain = file_size > offset? file_size - offset: 0;
+
+  if ((unsigned long)size > buffer->remain)
+    size = (int)buffer->remain;
+  if (size < 1)
+    size = 1;
+
+  buffer->size = size;
+  buffer->data = (imbyte*)malloc(size);
+  return buffer->data != NULL;
+}
+
+static inline void iBinBufferRelease(iBinBuffer* buffer)
+{
+  free(buffer->data);
+  buffer->data = NULL;
+}
+
+/* Returns the file position to just after the consumed data. */
+static inline void iBinBufferSync(iBinBuffer* buffer)
+{
+  if (buffer->pos < buffer->count)
+    imBinFileSeekOffset(buffer->handle, -(long)(buffer->count - buffer->pos));
+  buffer->count = 0;
+  buffer->pos = 0;
+}
+
+static inline int iBinBufferFill(iBinBuffer* buffer)
+{
+  if (buffer->remain == 0)
+    return 0;
+
+  int size = buffer->size;
+  if ((unsigned long)size > buffer->remain)
+    size = (int)buffer->remain;
+
+  imBinFileRead(buffer->handle, buffer->data, size, 1);
+  if (imBinFileError(buffer->handle))
+    return 0;
+
+  buffer->remain -= size;
+  buffer->count = size;
+  buffer->pos = 0;
+  return 1;
+}
+
+/* Returns 0 at the end of the file or if failed. */
+static inline int iBinBufferGetByte(iBinBuffer* buffer, int *value)
+{
+  if (buffer->pos == buffer->count && !iBinBufferFill(buffer))
+    return 0;
+
+  *value = buffer->data[buffer->pos];
+  buffer->pos++;
+  return 1;
+}
+
+static inline int iBinBufferRead(iBinBuffer* buffer, void* values, int size)
+{
+  imbyte* byte_values = (imbyte*)values;
+  while (size > 0)
+  {
+    if (buffer->pos == buffer->count && !iBinBufferFill(buffer))
+      return 0;
+
+    int n = buffer->count - buffer->pos;
+    if (n > size) n = size;
+
+    memcpy(byte_values, buffer->data + buffer->pos, n);
+    buffer->pos += n;
+    byte_values += n;
+    size -= n;
+  }
+  return 1;
+}
+
+static inline int iBinBufferSkip(iBinBuffer* buffer, int size)
+{
+  while (size > 0)
+  {
+    if (buffer->pos == buffer->count && !iBinBufferFill(buffer))
+      return 0;
+
+    int n = buffer->count - buffer->pos;
+    if (n > size) n = size;
+
+    buffer->pos += n;
+    size -= n;
+  }
+  return 1;
+}
+
+static inline int iBinBufferIsNumber(int c)
+{
+  return (c >= '0' && c <= '9') || c == '-';
+}
+
+static inline int iBinBufferIsFloat(int c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/* Reads the characters of a number, skipping any other characters before it. 
+ * The character after the number is also consumed. */
+static inline int iBinBufferReadToken(iBinBuffer* buffer, char* token, int max_size, int (*is_number)(int))
+{
+  int c, i = 0;
+
+  do
+  {
+    if (!iBinBufferGetByte(buffer, &c))
+      return 0;
+  } while (!is_number(c));
+
+  do
+  {
+    if (i == max_size)
+      return 0;
+
+    token[i] = (char)c;
+    i++;
+  } while (iBinBufferGetByte(buffer, &c) && is_number(c));  /* the end of the file also ends the number */
+
+  token[i] = 0;
+  return 1;
+}
+
+/* Same as imBinFileReadInteger, but accepts all the 11 characters of a negative integer. */
+static inline int iBinBufferReadInteger(iBinBuffer* buffer, int *value)
+{
+  char token[12];
+  if (!iBinBufferReadToken(buffer, token, 11, iBinBufferIsNumber))
+    return 0;
+
+  const char* t = token;
+  int negative = 0;
+  if (*t == '-')
+  {
+    negative = 1;
+    t++;
+  }
+
+  /* same as atoi, stops at the first invalid character */
+  unsigned int number = 0;
+  while (*t >= '0' && *t <= '9')
+  {
+    number = number*10 + (*t - '0');
+    t++;
+  }
+
+  *value = (int)(negative? 0u - number: number);
+  return 1;
+}
+
+/* Same as imBinFileReadFloat */
+static inline int iBinBufferReadFloat(iBinBuffer* buffer, float *value)
+{
+  char token[17];
+  if (!iBinBufferReadToken(buffer, token, 16, iBinBufferIsFloat))
+    return 0;
+
+  *value = (float)atof(token);
+  return 1;
+}
+
+/* Initializes the buffer to write, the data is written to the file when the buffer is full
+ * or when iBinBufferFlush is called. Returns 0 if failed. */
+static inline int iBinBufferInitWrite(iBinBuffer* buffer, imBinFile* handle, int size)
+{
+  buffer->handle = handle;
+  buffer->count = 0;
+  buffer->pos = 0;
+  buffer->remain = 0;
+  buffer->size = size;
+  buffer->data = (imbyte*)malloc(size);
+  return buffer->data != NULL;
+}
+
+static inline int iBinBufferFlush(iBinBuffer* buffer)
+{
+  if (buffer->count)
+  {
+    imBinFileWrite(buffer->handle, buffer->data, buffer->count, 1);
+    buffer->count = 0;
+  }
+  return !imBinFileError(buffer->handle);
+}
+
+static inline int iBinBufferWrite(iBinBuffer* buffer, const void* values, int size)
+{
+  if (buffer->count + size > buffer->size)
+  {
+    if (!iBinBufferFlush(buffer))
+      return 0;
+
+    if (size > buffer->size)
+    {
+      imBinFileWrite(buffer->handle, (void*)values, size, 1);
+      return !imBinFileError(buffer->handle);
+    }
+  }
+
+  memcpy(buffer->data + buffer->count, values, size);
+  buffer->count += size;
+  return 1;
+}
+
+/* Writes the integer followed by the separator, if not 0. Same as printf "%d". 
+ * Returns the number of characters written, or 0 if failed. */
+static inline int iBinBufferPrintInteger(iBinBuffer* buffer, int value, char separator)
+{
+  char digits[16];
+  int i = sizeof(digits);
+  unsigned int number = value < 0? 0u - (unsigned int)value: (unsigned int)value;
+
+  if (separator)
+    digits[--i] = separator;
+
+  do
+  {
+    digits[--i] = (char)('0' + number % 10);
+    number /= 10;
+  } while (number);
+
+  if (value < 0)
+    digits[--i] = '-';
+
+  int size = sizeof(digits) - i;
+  if (!iBinBufferWrite(buffer, digits + i, size))
+    return 0;
+  return size;
+}
+
+/* Same as imBinFilePrintf. 
+ * Returns the number of characters written, or 0 if failed. */
+static inline int iBinBufferPrintf(iBinBuffer* buffer, const char *format, ...)
+{
+  char text[4096];
+  va_list arglist;
+  va_start(arglist, format);
+  int size = vsnprintf(text, sizeof(text), format, arglist);
+  va_end(arglist);
+
+  if (size < 0)
+    return 0;
+  if (size >= (int)sizeof(text))
+    size = sizeof(text)-1;
+
+  if (!iBinBufferWrite(buffer, text, size))
+    return 0;
+  return size;
+}
+
+#endif
@@ -13,6 +13,7 @@
 
 #include "im_util.h"
 #include "im_binfile.h"
+#include "im_thread.h"
 
 
 /**************************************************
@@ -30,6 +31,7 @@ protected:
 
   unsigned long ReadBuf(void* pValues, unsigned long pSize);
   unsigned long WriteBuf(void* pValues, unsigned long pSize);
+  int Reserve(unsigned long pSize);
 
 public:
   void Open(const char* pFileName);
@@ -118,6 +120,37 @@ unsigned long imBinMemoryFile::ReadBuf(void* pValues, unsigned long pSize)
   return pSize;
 }
                              
+/* Reallocates the buffer to hold at least pSize bytes, if writing and reallocation is enabled. 
+   Returns 0 if failed. */
+int imBinMemoryFile::Reserve(unsigned long pSize)
+{
+  if (pSize <= this->BufferSize)
+    return 1;
+
+  if (this->Reallocate == 0.0 || !this->IsNew)
+    return 0;
+
+  unsigned long lOffset = this->CurPos - this->Buffer;
+
+  unsigned long nSize = this->BufferSize;
+  while (pSize > nSize)
+    nSize += (unsigned long)(this->Reallocate*(float)this->BufferSize);
+
+  unsigned char* nBuffer = (unsigned char*)realloc(this->Buffer, nSize);
+  if (!nBuffer)
+    return 0;
+
+  /* seeking after the end of the file leaves a gap filled with zeros */
+  memset(nBuffer + this->BufferSize, 0, nSize - this->BufferSize);
+
+  this->Buffer = nBuffer;
+  this->BufferSize = nSize;
+  this->file_name->buffer = this->Buffer;
+  this->file_name->size = this->BufferSize;
+  this->CurPos = this->Buffer + lOffset;
+  return 1;
+}
+
 unsigned long imBinMemoryFile::WriteBuf(void* pValues, unsigned long pSize)
 {
   assert(this->Buffer);
@@ -125,36 +158,10 @@ unsigned long imBinMemoryFile::WriteBuf(void* pValues, unsigned long pSize)
   unsigned long lOffset = this->CurPos - this->Buffer;
 
   this->Error = 0;
-  if (lOffset + pSize > this->BufferSize)
+  if (!Reserve(lOffset + pSize))
   {
-    if (this->Reallocate != 0.0)
-    {
-      unsigned long nSize = this->BufferSize;
-      while (lOffset + pSize > nSize)
-        nSize += (unsigned long)(this->Reallocate*(float)this->BufferSize);
-
-      this->Buffer = (unsigned char*)realloc(this->Buffer, nSize);
-
-      if (this->Buffer)
-      {
-        this->BufferSize = nSize;
-        this->file_name->buffer = this->Buffer;
-        this->file_name->size = this->BufferSize;
-      }
-      else
-      {
-        this->Buffer = this->file_name->buffer;
-        this->Error = 1;
-        pSize = this->BufferSize - lOffset;
-      }
-      
-      this->CurPos = this->Buffer + lOffset;
-    }
-    else
-    {
-      this->Error = 1;
-      pSize = this->BufferSize - lOffset;
-    }
+    this->Error = 1;
+    pSize = this->BufferSize - lOffset;
   }
 
   memcpy(this->CurPos, pValues, pSize);
@@ -184,7 +191,7 @@ void imBinMemoryFile::SeekTo(unsigned long pOffset)
   assert(this->Buffer);
 
   this->Error = 0;
-  if (pOffset > this->BufferSize)
+  if (!Reserve(pOffset))
   {
     this->Error = 1;
     return;
@@ -204,8 +211,8 @@ void imBinMemoryFile::SeekFrom(long pOffset)
   /* remember that offset is usually a negative value in this case */
 
   this->Error = 0;
-  if (this->CurrentSize + pOffset > this->BufferSize || 
-      (long)this->CurrentSize + pOffset < 0)
+  if ((long)this->CurrentSize + pOffset < 0 || 
+      !Reserve(this->CurrentSize + pOffset))
   {
     this->Error = 1;
     return;
@@ -224,7 +231,7 @@ void imBinMemoryFile::SeekOffset(long pOffset)
   long lOffset = this->CurPos - this->Buffer;
 
   this->Error = 0;
-  if (lOffset + pOffset < 0 || lOffset + pOffset > (long)this->BufferSize)
+  if (lOffset + pOffset < 0 || !Reserve(lOffset + pOffset))
   {
     this->Error = 1;
     return;
@@ -397,7 +404,7 @@ void imBinStreamFile::Open(const char* pFileName)
 
 void imBinStreamFile::New(const char* pFileName)
 {
-  this->FileHandle = fopen(pFileName, "wb");
+  this->FileHandle = fopen(pFileName, "w+b");
   SetByteOrder(imBinCPUByteOrder());
   this->IsNew = 1;
 }
@@ -465,6 +472,143 @@ int imBinStreamFile::EndOfFile() const
   return feof(this->FileHandle) == 0? 0: 1;
 }
 
+/**************************************************
+                imBinIOMemoryFile
+**************************************************/
+
+class imBinIOMemoryFile: public imBinMemoryFile
+{
+protected:
+  imBinFileIO* IO;
+
+public:
+  imBinIOMemoryFile(imBinFileIO* pIO): IO(pIO) {}
+
+  void Close() { this->IO->file_size = this->CurrentSize; } // the memory belongs to the user
+};
+
+/**************************************************
+                imBinCallbackFile
+**************************************************/
+
+class imBinCallbackFile: public imBinFileBase
+{
+protected:
+  imBinFileIO* IO;
+  imBinFileCallbacks* Callbacks;
+  int Error;
+
+  unsigned long ReadBuf(void* pValues, unsigned long pSize);
+  unsigned long WriteBuf(void* pValues, unsigned long pSize);
+
+public:
+  imBinCallbackFile(imBinFileIO* pIO): IO(pIO), Callbacks(&pIO->callbacks), Error(0) {}
+
+  void Open(const char* pFileName);
+  void New(const char* pFileName);
+  void Close();
+
+  unsigned long FileSize();
+  int HasError() const;
+  void SeekTo(unsigned long pOffset);
+  void SeekOffset(long pOffset);
+  void SeekFrom(long pOffset);
+  unsigned long Tell() const;
+  int EndOfFile() const;
+};
+
+void imBinCallbackFile::Open(const char*)
+{
+  SetByteOrder(imBinCPUByteOrder());
+  this->IsNew = 0;
+  this->Error = !this->Callbacks->read || !this->Callbacks->seek || !this->Callbacks->tell;
+
+  /* the file can be opened several times while searching for its format */
+  if (!this->Error)
+    SeekTo(0);
+}
+
+void imBinCallbackFile::New(const char*)
+{
+  SetByteOrder(imBinCPUByteOrder());
+  this->IsNew = 1;
+  this->Error = !this->Callbacks->write || !this->Callbacks->seek || !this->Callbacks->tell;
+
+  if (!this->Error)
+    SeekTo(0);
+}
+
+void imBinCallbackFile::Close()
+{
+  this->IO->file_size = FileSize();
+}
+
+unsigned long imBinCallbackFile::ReadBuf(void* pValues, unsigned long pSize)
+{
+  if (!this->Callbacks->read)
+  {
+    this->Error = 1;
+    return 0;
+  }
+
+  /* a short read is the end of the file, not an error */
+  this->Error = 0;
+  return this->Callbacks->read(this->Callbacks->user_data, pValues, pSize);
+}
+                             
+unsigned long imBinCallbackFile::WriteBuf(void* pValues, unsigned long pSize)
+{
+  if (!this->Callbacks->write)
+  {
+    this->Error = 1;
+    return 0;
+  }
+
+  unsigned long ret = this->Callbacks->write(this->Callbacks->user_data, pValues, pSize);
+  this->Error = ret != pSize;
+  return ret;
+}
+
+int imBinCallbackFile::HasError() const
+{
+  return this->Error;
+}
+
+void imBinCallbackFile::SeekTo(unsigned long pOffset)
+{
+  this->Error = this->Callbacks->seek(this->Callbacks->user_data, (long)pOffset, SEEK_SET) != 0;
+}
+
+void imBinCallbackFile::SeekOffset(long pOffset)
+{
+  this->Error = this->Callbacks->seek(this->Callbacks->user_data, pOffset, SEEK_CUR) != 0;
+}
+
+void imBinCallbackFile::SeekFrom(long pOffset)
+{
+  this->Error = this->Callbacks->seek(this->Callbacks->user_data, pOffset, SEEK_END) != 0;
+}
+
+unsigned long imBinCallbackFile::Tell() const
+{
+  return this->Callbacks->tell(this->Callbacks->user_data);
+}
+
+unsigned long imBinCallbackFile::FileSize()
+{
+  void* user_data = this->Callbacks->user_data;
+  unsigned long lCurrentPosition = this->Callbacks->tell(user_data);
+  this->Callbacks->seek(user_data, 0L, SEEK_END);
+  unsigned long lSize = this->Callbacks->tell(user_data);
+  this->Callbacks->seek(user_data, (long)lCurrentPosition, SEEK_SET);
+  return lSize;
+}
+
+int imBinCallbackFile::EndOfFile() const
+{
+  return Tell() == ((imBinCallbackFile*)this)->FileSize()? 1: 0;
+}
+
 /**************************************************
                  NewFuncModules
 **************************************************/
@@ -507,6 +651,55 @@ extern "C" int imBinFileRegisterModule(imBinFileNewFunc pNewFunc)
   return id;
 }
 
+/**************************************************
+                 imBinFileIO
+**************************************************/
+
+/* I/O used by all the files opened by the current thread, see imBinFileSetThreadIO */
+static IM_THREAD_LOCAL imBinFileIO* iBinFileThreadIO = NULL;
+
+/* Used by "im_format.cpp" only, to open the format drivers with an explicit I/O. 
+   Returns the previous I/O. */
+imBinFileIO* imBinFileSetThreadIO(imBinFileIO* io)
+{
+  imBinFileIO* old_io = iBinFileThreadIO;
+  iBinFileThreadIO = io;
+  return old_io;
+}
+
+void imBinFileIOInitMemory(imBinFileIO* io, unsigned char* buffer, int size, float reallocate)
+{
+  memset(io, 0, sizeof(imBinFileIO));
+  io->type = IM_IO_MEMORY;
+  io->memory.buffer = buffer;
+  io->memory.size = size;
+  io->memory.reallocate = reallocate;
+}
+
+void imBinFileIOInitMemRead(imBinFileIO* io, const unsigned char* buffer, int size)
+{
+  memset(io, 0, sizeof(imBinFileIO));
+  io->type = IM_IO_MEMREAD;
+  io->memory.buffer = (unsigned char*)buffer;  /* only read */
+  io->memory.size = size;
+  io->file_size = size;
+}
+
+void imBinFileIOInitCallback(imBinFileIO* io, const imBinFileCallbacks* callbacks)
+{
+  memset(io, 0, sizeof(imBinFileIO));
+  io->type = IM_IO_CALLBACK;
+  io->callbacks = *callbacks;
+}
+
+static imBinFileBase* iBinFileIONew(imBinFileIO* io)
+{
+  if (io->type == IM_IO_CALLBACK)
+    return new imBinCallbackFile(io);
+  else
+    return new imBinIOMemoryFile(io);
+}
+
 /**************************************************
                  imBinFile
 **************************************************/
@@ -516,16 +709,8 @@ struct _imBinFile
   imBinFileBase* binfile;
 };
 
-imBinFile* imBinFileOpen(const char* pFileName)
+static imBinFile* iBinFileOpen(imBinFileBase* binfile, const char* pFileName)
 {
-  assert(pFileName);
-
-  assert(iBinFileModuleCurrent < iBinFileModuleCount);
-  assert(iBinFileModuleCurrent < MAX_MODULES);
-
-  imBinFileNewFunc NewFunc = iBinFileModule[iBinFileModuleCurrent];
-  imBinFileBase* binfile = NewFunc();
-
   binfile->Open(pFileName);
   if (binfile->HasError())
   {
@@ -539,13 +724,8 @@ imBinFile* imBinFileOpen(const char* pFileName)
   return bfile;
 }
 
-imBinFile* imBinFileNew(const char* pFileName)
+static imBinFile* iBinFileNew(imBinFileBase* binfile, const char* pFileName)
 {
-  assert(pFileName);
-
-  imBinFileNewFunc NewFunc = iBinFileModule[iBinFileModuleCurrent];
-  imBinFileBase* binfile = NewFunc();
-
   binfile->New(pFileName);
   if (binfile->HasError())
   {
@@ -559,6 +739,52 @@ imBinFile* imBinFileNew(const char* pFileName)
   return bfile;
 }
 
+imBinFile* imBinFileOpenIO(imBinFileIO* io)
+{
+  assert(io);
+
+  if (io->type != IM_IO_CALLBACK && (!io->memory.buffer || !io->memory.size))
+    return NULL;
+
+  return iBinFileOpen(iBinFileIONew(io), (const char*)&io->memory);
+}
+
+imBinFile* imBinFileNewIO(imBinFileIO* io)
+{
+  assert(io);
+
+  if (io->type == IM_IO_MEMREAD || 
+      (io->type == IM_IO_MEMORY && !io->memory.size))
+    return NULL;
+
+  return iBinFileNew(iBinFileIONew(io), (const char*)&io->memory);
+}
+
+imBinFile* imBinFileOpen(const char* pFileName)
+{
+  if (iBinFileThreadIO)
+    return imBinFileOpenIO(iBinFileThreadIO);
+
+  assert(pFileName);
+
+  assert(iBinFileModuleCurrent < iBinFileModuleCount);
+  assert(iBinFileModuleCurrent < MAX_MODULES);
+
+  imBinFileNewFunc NewFunc = iBinFileModule[iBinFileModuleCurrent];
+  return iBinFileOpen(NewFunc(), pFileName);
+}
+
+imBinFile* imBinFileNew(const char* pFileName)
+{
+  if (iBinFileThreadIO)
+    return imBinFileNewIO(iBinFileThreadIO);
+
+  assert(pFileName);
+
+  imBinFileNewFunc NewFunc = iBinFileModule[iBinFileModuleCurrent];
+  return iBinFileNew(NewFunc(), pFileName);
+}
+
 void imBinFileClose(imBinFile* bfile)
 {
   assert(bfile);
@@ -633,6 +859,7 @@ unsigned long imBinFilePrintf(imBinFile* bfile, char *format, ...)
   va_start(arglist, format);
   char buffer[4096];
   int size = vsprintf(buffer, format, arglist);
+  va_end(arglist);
   return imBinFileWrite(bfile, buffer, size, 1);
 }
 
@@ -643,7 +870,9 @@ int imBinFileReadInteger(imBinFile* handle, int *value)
 
   while (!found)
   {
-    imBinFileRead(handle, &c, 1, 1);
+    int end = !imBinFileRead(handle, &c, 1, 1);
+    if (end)
+      c = 0;  /* the end of the file also ends the number */
 
     /* if it's an integer, increments the number of characters read */
     if ((c >= '0' && c <= '9') || (c == '-'))
@@ -662,7 +891,7 @@ int imBinFileReadInteger(imBinFile* handle, int *value)
       }
     }
 
-    if (imBinFileError(handle) || i > 10)
+    if (((imBinFileError(handle) || end) && !found) || i > 10)
       return 0;
   } 
 
@@ -676,7 +905,9 @@ int imBinFileReadFloat(imBinFile* handle, float *value)
 
   while (!found)
   {
-    imBinFileRead(handle, &c, 1, 1);
+    int end = !imBinFileRead(handle, &c, 1, 1);
+    if (end)
+      c = 0;  /* the end of the file also ends the number */
 
     /* if it's a floating point number, increments the number of characters read */
     if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
@@ -695,7 +926,7 @@ int imBinFileReadFloat(imBinFile* handle, float *value)
       }
     }
 
-    if (imBinFileError(handle) || i > 16)
+    if (((imBinFileError(handle) || end) && !found) || i > 16)
       return 0;
   } 
 
@@ -282,14 +282,43 @@ void* imImageGetOpenGLData(const imImage* image, int *format)
     break;
   }
 
-  int size = image->count*gldepth;
-  imImageSetAttribute(image, "GLDATA", IM_BYTE, size, NULL);
-  imbyte* gldata = (imbyte*)imImageGetAttribute(image, "GLDATA", NULL, NULL);
-
   int depth = image->depth;
   if (image->has_alpha)
     depth++;
 
+  /* packed data without padding is already in the OpenGL format */
+  if ((image->flags & IM_IMAGE_PACKED) && image->line_stride == image->line_size &&
+      (image->color_space == IM_RGB || image->color_space == IM_GRAY) && depth == gldepth)
+  {
+    if (format) *format = glformat;
+    return image->data[0];
+  }
+
+  if (!imImageIsContiguous(image))
+  {
+    /* padded or packed lines, build from a contiguous copy */
+    imImage* contiguous = imImageCreateEx(image->width, image->height, image->color_space, image->data_type, IM_IMAGE_NOCLEAR);
+    if (!contiguous)
+      return NULL;
+
+    if (image->has_alpha)
+      imImageAddAlpha(contiguous);
+
+    imImageCopy(image, contiguous);
+
+    int size;
+    void* gldata = imImageGetOpenGLData(contiguous, format);
+    imImageGetAttribute(contiguous, "GLDATA", NULL, &size);
+    imImageSetAttribute(image, "GLDATA", IM_BYTE, size, gldata);
+    imImageDestroy(contiguous);
+
+    return (void*)imImageGetAttribute(image, "GLDATA", NULL, NULL);
+  }
+
+  int size = image->count*gldepth;
+  imImageSetAttribute(image, "GLDATA", IM_BYTE, size, NULL);
+  imbyte* gldata = (imbyte*)imImageGetAttribute(image, "GLDATA", NULL, NULL);
+
   /* copy data, including alpha */
   if (image->color_space != IM_MAP)
   {
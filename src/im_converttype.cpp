@@ -17,6 +17,9 @@
 #else
 #include "im_counter.h"
 #endif
+#include "im_profile.h"
+#include "process/im_process_layout.h"
+#include "process/im_process_run.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -28,6 +31,9 @@
 #define IM_BEGIN_PROCESSING   
 #define IM_COUNT_PROCESSING   if (!imCounterInc(counter)) { processing = IM_ERR_COUNTER; break; }
 #define IM_END_PROCESSING
+#define IM_STOP_PROCESSING    (processing != IM_ERR_NONE)
+#else
+#define IM_STOP_PROCESSING    (!processing)
 #endif
 
 
@@ -142,54 +148,109 @@ inline void iDataTypeRealMinMax(float& min, float& max, int abssolute, T tmp)
 /**********************************************************************/
 
 
+/* The conversions access the image data as runs of contiguous pixels (see im_process_run.h),
+   so the images can have padded lines. */
+
+template <class T> 
+IM_STATIC void iMinMaxType(const imImage* image, int single, T& min, T& max, int abssolute)
+{
+  // same as imMinMaxType, but for all the runs
+  int run_count = imProcessRunCount(image, single);
+  int count = imProcessRunSize(image, single);
+
+  if (run_count == 1 || sizeof(T) == sizeof(imbyte))
+  {
+    imMinMaxType((const T*)imProcessRunData(image, 0, single), count, min, max, abssolute);
+    return;
+  }
+
+  for (int run = 0; run < run_count; run++)
+  {
+    T run_min, run_max;
+    imMinMax((const T*)imProcessRunData(image, run, single), count, run_min, run_max, abssolute);
+
+    if (run == 0 || run_min < min)
+      min = run_min;
+    if (run == 0 || run_max > max)
+      max = run_max;
+  }
+
+  // if equal define a minimum interval
+  if (min == max)
+  {
+    max = min + 1;
+
+    if (min != 0)
+      min = min - 1;
+  }
+}
+
 template <class SRCT, class DSTT> 
-IM_STATIC int iPromoteIntDirect(int count, const SRCT *src_map, DSTT *dst_map)
+IM_STATIC int iPromoteIntDirect(const imImage* src_image, imImage* dst_image, int single)
 {
   // small integer to big integer, no need for scale
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    DSTT *dst_map = (DSTT*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    dst_map[i] = (DSTT)(src_map[i]);
+    for (int i = 0; i < count; i++)
+    {
+      dst_map[i] = (DSTT)(src_map[i]);
+    }
   }
 
   return IM_ERR_NONE;
 }
   
 template <class SRCT, class DSTT> 
-IM_STATIC int iDemoteIntDirect(int count, const SRCT *src_map, DSTT *dst_map, int abssolute)
+IM_STATIC int iDemoteIntDirect(const imImage* src_image, imImage* dst_image, int single, int abssolute)
 {
   // big integer to small integer, need to crop
   DSTT dst_type_min, dst_type_max;
   iDataTypeIntMinMax(dst_type_min, dst_type_max, abssolute);
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    DSTT *dst_map = (DSTT*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    SRCT value;
+    for (int i = 0; i < count; i++)
+    {
+      SRCT value;
 
-    if (abssolute)
-      value = imAbs(src_map[i]);
-    else
-      value = src_map[i];
+      if (abssolute)
+        value = imAbs(src_map[i]);
+      else
+        value = src_map[i];
 
-    if (value > dst_type_max)
-      value = (SRCT)dst_type_max;
+      if (value > dst_type_max)
+        value = (SRCT)dst_type_max;
 
-    if (value < dst_type_min)
-      value = (SRCT)dst_type_min;
+      if (value < dst_type_min)
+        value = (SRCT)dst_type_min;
 
-    dst_map[i] = (DSTT)(value);
+      dst_map[i] = (DSTT)(value);
+    }
   }
 
   return IM_ERR_NONE;
 }
 
 template <class SRCT, class DSTT> 
-IM_STATIC int iPromoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abssolute)
+IM_STATIC int iPromoteInt(const imImage* src_image, imImage* dst_image, int single, int abssolute)
 {
   // small integer to big integer, need to shift if necessary
   // also includes ushort <-> short conversion
@@ -198,7 +259,7 @@ IM_STATIC int iPromoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abs
   SRCT shift = 0;
   if (!abssolute)
   {
-    if (iIsNegativeType(*src_map) && !iIsNegativeType(*dst_map))
+    if (iIsNegativeType(SRCT()) && !iIsNegativeType(DSTT()))
     {
       SRCT type_min, type_max;
       iDataTypeIntMinMax(type_min, type_max, abssolute);
@@ -206,33 +267,42 @@ IM_STATIC int iPromoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abs
     }
   }
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    DSTT *dst_map = (DSTT*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    SRCT value;
+    for (int i = 0; i < count; i++)
+    {
+      SRCT value;
 
-    if (abssolute)
-      value = imAbs(src_map[i]);
-    else
-      value = src_map[i] - shift;
+      if (abssolute)
+        value = imAbs(src_map[i]);
+      else
+        value = src_map[i] - shift;
 
-    dst_map[i] = (DSTT)(value);
+      dst_map[i] = (DSTT)(value);
+    }
   }
 
   return IM_ERR_NONE;
 }
 
 template <class SRCT, class DSTT> 
-IM_STATIC int iDemoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
+IM_STATIC int iDemoteInt(const imImage* src_image, imImage* dst_image, int single, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
 {
   // big integer to small integer, need to scale down
   SRCT min, max;
   DSTT dst_type_min, dst_type_max;
 
   if (cast_mode == IM_CAST_MINMAX)  // search for min-max
-    imMinMaxType(src_map, count, min, max, abssolute);
+    iMinMaxType(src_image, single, min, max, abssolute);
   else  
   {
     // IM_CAST_FIXED - use data type limits for min-max
@@ -255,41 +325,53 @@ IM_STATIC int iDemoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abss
 
   float factor = ((float)dst_type_max - (float)dst_type_min + 1.0f) / ((float)max - (float)min + 1.0f);
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
   IM_INT_PROCESSING;
 
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    DSTT *dst_map = (DSTT*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
+    for (int i = 0; i < count; i++)
+    {
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_BEGIN_PROCESSING;
-
-    SRCT value;
-    if (abssolute)
-      value = imAbs(src_map[i]);
-    else
-      value = src_map[i];
+      IM_BEGIN_PROCESSING;
 
-    if (value >= max)
-      dst_map[i] = dst_type_max;
-    else if (value <= min)
-      dst_map[i] = dst_type_min;
-    else
-    {
-      if (direct)
-        dst_map[i] = (DSTT)value;
+      SRCT value;
+      if (abssolute)
+        value = imAbs(src_map[i]);
       else
-        dst_map[i] = (DSTT)imResampleInt(value - min, factor) + dst_type_min;
-    }
+        value = src_map[i];
 
-    IM_COUNT_PROCESSING;
+      if (value >= max)
+        dst_map[i] = dst_type_max;
+      else if (value <= min)
+        dst_map[i] = dst_type_min;
+      else
+      {
+        if (direct)
+          dst_map[i] = (DSTT)value;
+        else
+          dst_map[i] = (DSTT)imResampleInt(value - min, factor) + dst_type_min;
+      }
+
+      IM_COUNT_PROCESSING;
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_END_PROCESSING;
+      IM_END_PROCESSING;
+    }
+
+    if (IM_STOP_PROCESSING)
+      break;
   }
 
   return processing;
@@ -300,14 +382,14 @@ IM_STATIC int iDemoteInt(int count, const SRCT *src_map, DSTT *dst_map, int abss
 
 
 template <class SRCT> 
-IM_STATIC int iPromoteReal(int count, const SRCT *src_map, float *dst_map, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
+IM_STATIC int iPromoteReal(const imImage* src_image, imImage* dst_image, int single, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
 {
   // integer to real, always have to scale to 0:1 or -0.5:+0.5
   SRCT min, max;
   float dst_type_min, dst_type_max;
 
   if (cast_mode == IM_CAST_MINMAX)   // search for min-max
-    imMinMaxType(src_map, count, min, max, abssolute);
+    iMinMaxType(src_image, single, min, max, abssolute);
   else  
   {
     // IM_CAST_FIXED - use data type limits for min-max
@@ -322,7 +404,7 @@ IM_STATIC int iPromoteReal(int count, const SRCT *src_map, float *dst_map, float
     }
   }
 
-  iDataTypeRealMinMax(dst_type_min, dst_type_max, abssolute, *src_map);
+  iDataTypeRealMinMax(dst_type_min, dst_type_max, abssolute, SRCT());
 
   float dst_type_range = 1.0f;
   float range = float(max - min + 1);
@@ -330,56 +412,68 @@ IM_STATIC int iPromoteReal(int count, const SRCT *src_map, float *dst_map, float
   gamma = -gamma; // gamma is inverted here, because we are promoting int2real
   float factor = iGammaFactor(dst_type_range, gamma);
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
   IM_INT_PROCESSING;
 
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    float *dst_map = (float*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
+    for (int i = 0; i < count; i++)
+    {
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_BEGIN_PROCESSING;
+      IM_BEGIN_PROCESSING;
 
-    float fvalue;
-    if (abssolute)
-      fvalue = (imAbs(src_map[i]) - min + 0.5f)/range; 
-    else
-      fvalue = (src_map[i] - min + 0.5f)/range; 
+      float fvalue;
+      if (abssolute)
+        fvalue = (imAbs(src_map[i]) - min + 0.5f)/range; 
+      else
+        fvalue = (src_map[i] - min + 0.5f)/range; 
 
-    // Now 0 <= fvalue <= 1 (if min-max are correct)
+      // Now 0 <= fvalue <= 1 (if min-max are correct)
 
-    if (fvalue >= 1)
-      dst_map[i] = dst_type_max;
-    else if (fvalue <= 0)
-      dst_map[i] = dst_type_min;
-    else
-      dst_map[i] = iGammaFunc(factor, dst_type_min, gamma, fvalue);
+      if (fvalue >= 1)
+        dst_map[i] = dst_type_max;
+      else if (fvalue <= 0)
+        dst_map[i] = dst_type_min;
+      else
+        dst_map[i] = iGammaFunc(factor, dst_type_min, gamma, fvalue);
 
-    IM_COUNT_PROCESSING;
+      IM_COUNT_PROCESSING;
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_END_PROCESSING;
+      IM_END_PROCESSING;
+    }
+
+    if (IM_STOP_PROCESSING)
+      break;
   }
 
   return processing;
 }
 
 template <class DSTT> 
-IM_STATIC int iDemoteReal(int count, const float *src_map, DSTT *dst_map, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
+IM_STATIC int iDemoteReal(const imImage* src_image, imImage* dst_image, int single, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
 {
   // real to integer, always have to scale from 0:1 or -0.5:+0.5
   float min, max;
   DSTT dst_type_min, dst_type_max;
 
   if (cast_mode == IM_CAST_MINMAX)  // search for min-max
-    imMinMaxType(src_map, count, min, max, abssolute);
+    iMinMaxType(src_image, single, min, max, abssolute);
   else  
   {
     // IM_CAST_FIXED - use data type limits for min-max
-    iDataTypeRealMinMax(min, max, abssolute, *dst_map);
+    iDataTypeRealMinMax(min, max, abssolute, DSTT());
 
     if (cast_mode == IM_CAST_USER)  // get min,max from atributes
     {
@@ -397,47 +491,59 @@ IM_STATIC int iDemoteReal(int count, const float *src_map, DSTT *dst_map, float
 
   float factor = iGammaFactor((float)dst_type_range, gamma);
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
   IM_INT_PROCESSING;
 
+  for (int run = 0; run < run_count; run++)
+  {
+    const float *src_map = (const float*)imProcessRunData(src_image, run, single);
+    DSTT *dst_map = (DSTT*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
+    for (int i = 0; i < count; i++)
+    {
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_BEGIN_PROCESSING;
+      IM_BEGIN_PROCESSING;
 
-    float value;
-    if (abssolute)
-      value = ((float)imAbs(src_map[i]) - min)/range; 
-    else
-      value = (src_map[i] - min)/range; 
+      float value;
+      if (abssolute)
+        value = ((float)imAbs(src_map[i]) - min)/range; 
+      else
+        value = (src_map[i] - min)/range; 
 
-    // Now 0 <= value <= 1 (if min-max are correct)
+      // Now 0 <= value <= 1 (if min-max are correct)
 
-    if (value >= 1)
-      dst_map[i] = dst_type_max;
-    else if (value <= 0)
-      dst_map[i] = dst_type_min;
-    else
-    {
-      value = iGammaFunc(factor, (float)dst_type_min, gamma, value);
-      int ivalue = imRound(value);
-      if (ivalue >= dst_type_max)
+      if (value >= 1)
         dst_map[i] = dst_type_max;
-      else if (ivalue <= dst_type_min)
+      else if (value <= 0)
         dst_map[i] = dst_type_min;
       else
-        dst_map[i] = (DSTT)imRound(value - 0.5f);
-    }
-
-    IM_COUNT_PROCESSING;
+      {
+        value = iGammaFunc(factor, (float)dst_type_min, gamma, value);
+        int ivalue = imRound(value);
+        if (ivalue >= dst_type_max)
+          dst_map[i] = dst_type_max;
+        else if (ivalue <= dst_type_min)
+          dst_map[i] = dst_type_min;
+        else
+          dst_map[i] = (DSTT)imRound(value - 0.5f);
+      }
+
+      IM_COUNT_PROCESSING;
 #ifdef _OPENMP
-    #pragma omp flush (processing)
+      #pragma omp flush (processing)
 #endif
-    IM_END_PROCESSING;
+      IM_END_PROCESSING;
+    }
+
+    if (IM_STOP_PROCESSING)
+      break;
   }
 
   return processing;
@@ -447,7 +553,7 @@ IM_STATIC int iDemoteReal(int count, const float *src_map, DSTT *dst_map, float
 /**********************************************************************/
 
 
-static int iDemoteCpxReal(int count, const imcfloat* src_map, float *dst_map, int cpx2real)
+static int iDemoteCpxReal(const imImage* src_image, imImage* dst_image, int single, int cpx2real)
 {
   float (*CpxCnv)(const imcfloat& cpx) = NULL;
 
@@ -459,68 +565,86 @@ static int iDemoteCpxReal(int count, const imcfloat* src_map, float *dst_map, in
   case IM_CPX_PHASE: CpxCnv = cpxphase; break;
   }
 
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const imcfloat *src_map = (const imcfloat*)imProcessRunData(src_image, run, single);
+    float *dst_map = (float*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    dst_map[i] = CpxCnv(src_map[i]);
+    for (int i = 0; i < count; i++)
+    {
+      dst_map[i] = CpxCnv(src_map[i]);
+    }
   }
 
   return IM_ERR_NONE;
 }
                                                                      
 template <class DSTT> 
-IM_STATIC int iDemoteCpxInt(int count, const imcfloat* src_map, DSTT *dst_map, int cpx2real, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
+IM_STATIC int iDemoteCpxInt(const imImage* src_image, imImage* dst_image, int single, int cpx2real, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
 {
-  float* real_map = (float*)malloc(count*sizeof(float));
-  if (!real_map) return IM_ERR_MEM;
+  imImage* real_image = imImageCreate(src_image->width, src_image->height, src_image->color_space, IM_FLOAT);
+  if (!real_image) return IM_ERR_MEM;
 
   // complex to real
-  iDemoteCpxReal(count, src_map, real_map, cpx2real);
+  iDemoteCpxReal(src_image, real_image, single, cpx2real);
 
   // real to integer
-  if (iDemoteReal(count, real_map, dst_map, gamma, abssolute, cast_mode, counter, attrib_table) != IM_ERR_NONE)
+  if (iDemoteReal<DSTT>(real_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table) != IM_ERR_NONE)
   {
-    free(real_map);
+    imImageDestroy(real_image);
     return IM_ERR_COUNTER;
   }
 
-  free(real_map);
+  imImageDestroy(real_image);
   return IM_ERR_NONE;
 }
 
 template <class SRCT> 
-IM_STATIC int iPromoteCpxDirect(int count, const SRCT *src_map, imcfloat *dst_map)
+IM_STATIC int iPromoteCpxDirect(const imImage* src_image, imImage* dst_image, int single)
 {
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const SRCT *src_map = (const SRCT*)imProcessRunData(src_image, run, single);
+    imcfloat *dst_map = (imcfloat*)imProcessRunData(dst_image, run, single);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    dst_map[i].real = (float)(src_map[i]);
+    for (int i = 0; i < count; i++)
+    {
+      dst_map[i].real = (float)(src_map[i]);
+    }
   }
 
   return IM_ERR_NONE;
 }
 
 template <class SRCT> 
-IM_STATIC int iPromoteCpx(int count, const SRCT* src_map, imcfloat *dst_map, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
+IM_STATIC int iPromoteCpx(const imImage* src_image, imImage* dst_image, int single, float gamma, int abssolute, int cast_mode, int counter, imAttribTable* attrib_table)
 {
-  float* real_map = (float*)malloc(count*sizeof(float));
-  if (!real_map) return IM_ERR_MEM;
+  imImage* real_image = imImageCreate(src_image->width, src_image->height, src_image->color_space, IM_FLOAT);
+  if (!real_image) return IM_ERR_MEM;
 
   // integer to real
-  if (iPromoteReal(count, src_map, real_map, gamma, abssolute, cast_mode, counter, attrib_table) != IM_ERR_NONE)
+  if (iPromoteReal<SRCT>(src_image, real_image, single, gamma, abssolute, cast_mode, counter, attrib_table) != IM_ERR_NONE)
   {
-    free(real_map);
+    imImageDestroy(real_image);
     return IM_ERR_COUNTER;
   }
 
   // real to complex
-  iPromoteCpxDirect(count, real_map, dst_map);
+  iPromoteCpxDirect<float>(real_image, dst_image, single);
 
-  free(real_map);
+  imImageDestroy(real_image);
   return IM_ERR_NONE;
 }
 
@@ -528,28 +652,18 @@ IM_STATIC int iPromoteCpx(int count, const SRCT* src_map, imcfloat *dst_map, flo
 /**********************************************************************/
 
 
-#ifdef IM_PROCESS
-int imProcessConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real, float gamma, int abssolute, int cast_mode)
-#else
-int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real, float gamma, int abssolute, int cast_mode)
-#endif
+static int iConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real, float gamma, int abssolute, int cast_mode)
 {
-  assert(src_image);
-  assert(dst_image);
-
-  if (!imImageMatchColorSpace(src_image, dst_image))
-    return IM_ERR_DATA;
-
-  if (src_image->data_type == dst_image->data_type)
-    return IM_ERR_DATA;
-
+  int single = imImageIsContiguous(src_image) && imImageIsContiguous(dst_image);
   int total_count = src_image->depth * src_image->count;
   int ret = IM_ERR_DATA;
 #ifdef IM_PROCESS
   int counter = imProcessCounterBegin("Convert Data Type");
 #else
+  imProfileBegin("Convert Data Type", 1);
   int counter = imCounterBegin("Convert Data Type");
 #endif
+  imProfileAddData(src_image->count, (double)total_count*(imDataTypeSize(src_image->data_type) + imDataTypeSize(dst_image->data_type)));
   char msg[50];
   sprintf(msg, "Converting to %s...", imDataTypeName(dst_image->data_type));
   imCounterTotal(counter, total_count, msg);
@@ -563,33 +677,33 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     {
     case IM_SHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imbyte*)src_image->data[0], (short*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imbyte, short>(src_image, dst_image, single);
       else
-        ret = iPromoteInt(total_count, (const imbyte*)src_image->data[0], (short*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<imbyte, short>(src_image, dst_image, single, abssolute);
       break;
     case IM_USHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imbyte*)src_image->data[0], (imushort*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imbyte, imushort>(src_image, dst_image, single);
       else
-        ret = iPromoteInt(total_count, (const imbyte*)src_image->data[0], (imushort*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<imbyte, imushort>(src_image, dst_image, single, abssolute);
       break;
     case IM_INT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imbyte*)src_image->data[0], (int*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imbyte, int>(src_image, dst_image, single);
       else
-        ret = iPromoteInt(total_count, (const imbyte*)src_image->data[0], (int*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<imbyte, int>(src_image, dst_image, single, abssolute);
       break;
     case IM_FLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imbyte*)src_image->data[0], (float*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imbyte, float>(src_image, dst_image, single);
       else
-        ret = iPromoteReal(total_count, (const imbyte*)src_image->data[0], (float*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteReal<imbyte>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_CFLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteCpxDirect(total_count, (const imbyte*)src_image->data[0], (imcfloat*)dst_image->data[0]);
+        ret = iPromoteCpxDirect<imbyte>(src_image, dst_image, single);
       else
-        ret = iPromoteCpx(total_count, (const imbyte*)src_image->data[0], (imcfloat*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteCpx<imbyte>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     }
     break;
@@ -598,33 +712,33 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     {
     case IM_BYTE:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const short*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<short, imbyte>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteInt(total_count, (const short*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteInt<short, imbyte>(src_image, dst_image, single, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_USHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const short*)src_image->data[0], (imushort*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<short, imushort>(src_image, dst_image, single, abssolute);
       else
-        ret = iPromoteInt(total_count, (const short*)src_image->data[0], (imushort*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<short, imushort>(src_image, dst_image, single, abssolute);
       break;
     case IM_INT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const short*)src_image->data[0], (int*)dst_image->data[0]);
+        ret = iPromoteIntDirect<short, int>(src_image, dst_image, single);
       else
-        ret = iPromoteInt(total_count, (const short*)src_image->data[0], (int*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<short, int>(src_image, dst_image, single, abssolute);
       break;
     case IM_FLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const short*)src_image->data[0], (float*)dst_image->data[0]);
+        ret = iPromoteIntDirect<short, float>(src_image, dst_image, single);
       else
-        ret = iPromoteReal(total_count, (const short*)src_image->data[0], (float*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteReal<short>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_CFLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteCpxDirect(total_count, (const short*)src_image->data[0], (imcfloat*)dst_image->data[0]);
+        ret = iPromoteCpxDirect<short>(src_image, dst_image, single);
       else
-        ret = iPromoteCpx(total_count, (const short*)src_image->data[0], (imcfloat*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteCpx<short>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     }
     break;
@@ -633,33 +747,33 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     {
     case IM_BYTE:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const imushort*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<imushort, imbyte>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteInt(total_count, (const imushort*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteInt<imushort, imbyte>(src_image, dst_image, single, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_SHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const imushort*)src_image->data[0], (short*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<imushort, short>(src_image, dst_image, single, abssolute);
       else
-        ret = iPromoteInt(total_count, (const imushort*)src_image->data[0], (short*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<imushort, short>(src_image, dst_image, single, abssolute);
       break;
     case IM_INT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imushort*)src_image->data[0], (int*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imushort, int>(src_image, dst_image, single);
       else
-        ret = iPromoteInt(total_count, (const imushort*)src_image->data[0], (int*)dst_image->data[0], abssolute);
+        ret = iPromoteInt<imushort, int>(src_image, dst_image, single, abssolute);
       break;
     case IM_FLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const imushort*)src_image->data[0], (float*)dst_image->data[0]);
+        ret = iPromoteIntDirect<imushort, float>(src_image, dst_image, single);
       else
-        ret = iPromoteReal(total_count, (const imushort*)src_image->data[0], (float*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteReal<imushort>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_CFLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteCpxDirect(total_count, (const imushort*)src_image->data[0], (imcfloat*)dst_image->data[0]);
+        ret = iPromoteCpxDirect<imushort>(src_image, dst_image, single);
       else
-        ret = iPromoteCpx(total_count, (const imushort*)src_image->data[0], (imcfloat*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteCpx<imushort>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     }
     break;
@@ -668,33 +782,33 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     {
     case IM_BYTE:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const int*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<int, imbyte>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteInt(total_count, (const int*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteInt<int, imbyte>(src_image, dst_image, single, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_SHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const int*)src_image->data[0], (short*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<int, short>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteInt(total_count, (const int*)src_image->data[0], (short*)dst_image->data[0], abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteInt<int, short>(src_image, dst_image, single, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_USHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const int*)src_image->data[0], (imushort*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<int, imushort>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteInt(total_count, (const int*)src_image->data[0], (imushort*)dst_image->data[0], abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteInt<int, imushort>(src_image, dst_image, single, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_FLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteIntDirect(total_count, (const int*)src_image->data[0], (float*)dst_image->data[0]);
+        ret = iPromoteIntDirect<int, float>(src_image, dst_image, single);
       else
-        ret = iPromoteReal(total_count, (const int*)src_image->data[0], (float*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteReal<int>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_CFLOAT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iPromoteCpxDirect(total_count, (const int*)src_image->data[0], (imcfloat*)dst_image->data[0]);
+        ret = iPromoteCpxDirect<int>(src_image, dst_image, single);
       else
-        ret = iPromoteCpx(total_count, (const int*)src_image->data[0], (imcfloat*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iPromoteCpx<int>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     }
     break;
@@ -703,30 +817,30 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     {
     case IM_BYTE:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const float*)src_image->data[0], (imbyte*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<float, imbyte>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteReal(total_count, (const float*)src_image->data[0], (imbyte*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteReal<imbyte>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_SHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const float*)src_image->data[0], (short*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<float, short>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteReal(total_count, (const float*)src_image->data[0], (short*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteReal<short>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_USHORT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const float*)src_image->data[0], (imushort*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<float, imushort>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteReal(total_count, (const float*)src_image->data[0], (imushort*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteReal<imushort>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_INT:
       if (cast_mode == IM_CAST_DIRECT)
-        ret = iDemoteIntDirect(total_count, (const float*)src_image->data[0], (int*)dst_image->data[0], abssolute);
+        ret = iDemoteIntDirect<float, int>(src_image, dst_image, single, abssolute);
       else
-        ret = iDemoteReal(total_count, (const float*)src_image->data[0], (int*)dst_image->data[0], gamma, abssolute, cast_mode, counter, attrib_table);
+        ret = iDemoteReal<int>(src_image, dst_image, single, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_CFLOAT:
-      ret = iPromoteCpxDirect(total_count, (const float*)src_image->data[0], (imcfloat*)dst_image->data[0]);
+      ret = iPromoteCpxDirect<float>(src_image, dst_image, single);
       break;
     }
     break;
@@ -734,19 +848,19 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
     switch(dst_image->data_type)                                                                       
     {
     case IM_BYTE:
-      ret = iDemoteCpxInt(total_count, (const imcfloat*)src_image->data[0], (imbyte*)dst_image->data[0], cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
+      ret = iDemoteCpxInt<imbyte>(src_image, dst_image, single, cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_SHORT:
-      ret = iDemoteCpxInt(total_count, (const imcfloat*)src_image->data[0], (short*)dst_image->data[0], cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
+      ret = iDemoteCpxInt<short>(src_image, dst_image, single, cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_USHORT:
-      ret = iDemoteCpxInt(total_count, (const imcfloat*)src_image->data[0], (imushort*)dst_image->data[0], cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
+      ret = iDemoteCpxInt<imushort>(src_image, dst_image, single, cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_INT:
-      ret = iDemoteCpxInt(total_count, (const imcfloat*)src_image->data[0], (int*)dst_image->data[0], cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
+      ret = iDemoteCpxInt<int>(src_image, dst_image, single, cpx2real, gamma, abssolute, cast_mode, counter, attrib_table);
       break;
     case IM_FLOAT:
-      ret = iDemoteCpxReal(total_count, (const imcfloat*)src_image->data[0], (float*)dst_image->data[0], cpx2real);
+      ret = iDemoteCpxReal(src_image, dst_image, single, cpx2real);
       break;
     }
     break;
@@ -756,6 +870,37 @@ int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real
   imProcessCounterEnd(counter);
 #else
   imCounterEnd(counter);
+  imProfileEnd();
 #endif
   return ret;
 }
+
+#ifdef IM_PROCESS
+int imProcessConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real, float gamma, int abssolute, int cast_mode)
+#else
+int imConvertDataType(const imImage* src_image, imImage* dst_image, int cpx2real, float gamma, int abssolute, int cast_mode)
+#endif
+{
+  assert(src_image);
+  assert(dst_image);
+
+  if (!imImageMatchColorSpace(src_image, dst_image))
+    return IM_ERR_DATA;
+
+  if (src_image->data_type == dst_image->data_type)
+    return IM_ERR_DATA;
+
+  if (!imImageMakeWritable(dst_image))
+    return IM_ERR_MEM;
+
+  if (!imProcessIsPlanar(src_image, dst_image))
+  {
+    // packed images are converted using planar copies
+    imProcessContiguous contiguous_src(src_image), contiguous_dst(dst_image, 1);
+    if (contiguous_src.Failed() || contiguous_dst.Failed())
+      return IM_ERR_MEM;
+    return iConvertDataType(contiguous_src, contiguous_dst, cpx2real, gamma, abssolute, cast_mode);
+  }
+
+  return iConvertDataType(src_image, dst_image, cpx2real, gamma, abssolute, cast_mode);
+}
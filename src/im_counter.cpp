@@ -5,6 +5,7 @@
  */
 
 #include "im_counter.h"
+#include "im_thread.h"
 
 #include <stdlib.h>
 #include <memory.h>
@@ -39,18 +40,18 @@ struct iCounter
 #define MAX_COUNTERS 10
 static iCounter iCounterList[MAX_COUNTERS];
 
+/* Counters can be used from several threads (see imFileImageLoadBatchStart).
+   The table is changed only inside the lock, the callback is called outside it. */
+static iMutex iCounterMutex = IM_MUTEX_INITIALIZER;
+
 int imCounterBegin(const char* title)
 {
-  static int first = 1;
-  if (first)
-  {
-    memset(iCounterList, 0, MAX_COUNTERS*sizeof(iCounter));
-    first = 0;
-  }
-
-  if (!iCounterFunc) 
+  imCounterCallback counter_func = iCounterFunc;
+  if (!counter_func) 
     return -1;             // counter management is useless
 
+  iMutexLock(&iCounterMutex);
+
   int counter = -1;
   for (int i = 0; i < MAX_COUNTERS; i++)
   {
@@ -63,35 +64,50 @@ int imCounterBegin(const char* title)
   }
 
   if (counter == -1) 
+  {
+    iMutexUnlock(&iCounterMutex);
     return -1;             // too many counters
+  }
 
   iCounter *ct = &iCounterList[counter];
 
   ct->sequence++;
+  int top_level = ct->sequence == 1;
+
+  iMutexUnlock(&iCounterMutex);
 
-  if (ct->sequence == 1)   // top level counter
-    iCounterFunc(counter, iCounterUserData, title, -1);
+  if (top_level)           // top level counter
+    counter_func(counter, iCounterUserData, title, -1);
 
   return counter;
 }
 
 void imCounterEnd(int counter)
 {
-  if (counter == -1 || !iCounterFunc) 
+  imCounterCallback counter_func = iCounterFunc;
+  if (counter == -1 || !counter_func) 
     return;                // invalid counter
 
+  iMutexLock(&iCounterMutex);
+
   iCounter *ct = &iCounterList[counter];
   if (ct->sequence == 0 || // counter with no begin or no total
       ct->total == 0)
+  {
+    iMutexUnlock(&iCounterMutex);
     return;
+  }
 
-  if (ct->sequence == 1)   // top level counter
-  {
-    iCounterFunc(counter, iCounterUserData, NULL, 1001);
+  int top_level = ct->sequence == 1;
+  if (top_level)           // top level counter
     memset(ct, 0, sizeof(iCounter));
-  }
   else
     ct->sequence--;
+
+  iMutexUnlock(&iCounterMutex);
+
+  if (top_level)
+    counter_func(counter, iCounterUserData, NULL, 1001);
 }
 
 void* imCounterGetUserData(int counter)
@@ -99,8 +115,10 @@ void* imCounterGetUserData(int counter)
   if (counter == -1 || !iCounterFunc) 
     return NULL;            // invalid counter
 
-  iCounter *ct = &iCounterList[counter];
-  return ct->userdata;
+  iMutexLock(&iCounterMutex);
+  void* userdata = iCounterList[counter].userdata;
+  iMutexUnlock(&iCounterMutex);
+  return userdata;
 }
 
 void imCounterSetUserData(int counter, void* userdata)
@@ -108,19 +126,26 @@ void imCounterSetUserData(int counter, void* userdata)
   if (counter == -1 || !iCounterFunc) 
     return;                // invalid counter
 
-  iCounter *ct = &iCounterList[counter];
-  ct->userdata = userdata;
+  iMutexLock(&iCounterMutex);
+  iCounterList[counter].userdata = userdata;
+  iMutexUnlock(&iCounterMutex);
 }
 
 int imCounterInc(int counter)
 {
-  if (counter == -1 || !iCounterFunc)                       
+  imCounterCallback counter_func = iCounterFunc;
+  if (counter == -1 || !counter_func)                       
     return 1;              // invalid counter
 
+  iMutexLock(&iCounterMutex);
+
   iCounter *ct = &iCounterList[counter];
   if (ct->sequence == 0 || // counter with no begin or no total
       ct->total == 0)
+  {
+    iMutexUnlock(&iCounterMutex);
     return 1;
+  }
 
   const char* msg = NULL;
   if (ct->current == 0)
@@ -133,18 +158,26 @@ int imCounterInc(int counter)
   if (ct->current == ct->total)
     ct->current = 0;
 
-  return iCounterFunc(counter, iCounterUserData, msg, progress);
+  iMutexUnlock(&iCounterMutex);
+
+  return counter_func(counter, iCounterUserData, msg, progress);
 }
 
 int imCounterIncTo(int counter, int count)
 {
-  if (counter == -1 || !iCounterFunc)        
+  imCounterCallback counter_func = iCounterFunc;
+  if (counter == -1 || !counter_func)        
     return 1;              // invalid counter
 
+  iMutexLock(&iCounterMutex);
+
   iCounter *ct = &iCounterList[counter];
   if (ct->sequence == 0 || // counter with no begin or no total
       ct->total == 0)
+  {
+    iMutexUnlock(&iCounterMutex);
     return 1;
+  }
 
   if (count <= 0) count = 0;
   if (count >= ct->total) count = ct->total;
@@ -160,7 +193,9 @@ int imCounterIncTo(int counter, int count)
   if (ct->current == ct->total)
     ct->current = 0;
 
-  return iCounterFunc(counter, iCounterUserData, msg, progress);
+  iMutexUnlock(&iCounterMutex);
+
+  return counter_func(counter, iCounterUserData, msg, progress);
 }
 
 void imCounterTotal(int counter, int total, const char* message)
@@ -168,11 +203,15 @@ void imCounterTotal(int counter, int total, const char* message)
   if (counter == -1 || !iCounterFunc) 
     return;                // invalid counter
 
+  iMutexLock(&iCounterMutex);
+
   iCounter *ct = &iCounterList[counter];
-  if (ct->sequence == 0) 
-    return;                // counter with no begin
+  if (ct->sequence != 0)   // ignore counter with no begin
+  {
+    ct->message = message;
+    ct->total = total;
+    ct->current = 0;
+  }
 
-  ct->message = message;
-  ct->total = total;
-  ct->current = 0;
+  iMutexUnlock(&iCounterMutex);
 }
@@ -13,8 +13,13 @@
 #include "im_util.h"
 #include "im_attrib.h"
 #include "im_counter.h"
+#include "im_profile.h"
+#include "im_binfile.h"
 #include "im_plus.h"  // make shure that this file is compiled
 
+/* implemented in "im_binfile.cpp" */
+imBinFileIO* imBinFileSetThreadIO(imBinFileIO* io);
+
 
 void imFileClear(imFile* ifile)
 {
@@ -27,6 +32,9 @@ void imFileClear(imFile* ifile)
   ifile->line_buffer_size = 0;
   ifile->line_buffer_extra = 0;
   ifile->line_buffer_alloc = 0;
+  ifile->data_first_line = 0;
+  ifile->data_line_count = 0;
+  ifile->next_line = 0;
 
   ifile->convert_bpp = 0;
   ifile->switch_type = 0;
@@ -58,9 +66,14 @@ imFile* imFileOpen(const char* file_name, int *error)
 {
   assert(file_name);
 
+  imProfileBegin("File Open", 1);
+
   imFileFormatBase* ifileformat = imFileFormatBaseOpen(file_name, error);
   if (!ifileformat) 
+  {
+    imProfileEnd();
     return NULL;
+  }
 
   imFileClear(ifileformat);
 
@@ -69,6 +82,8 @@ imFile* imFileOpen(const char* file_name, int *error)
 
   ifileformat->counter = imCounterBegin(file_name);
 
+  imProfileEnd();
+
   return ifileformat;
 }
 
@@ -76,9 +91,14 @@ imFile* imFileOpenAs(const char* file_name, const char* format, int *error)
 {
   assert(file_name);
 
+  imProfileBegin("File Open", 1);
+
   imFileFormatBase* ifileformat = imFileFormatBaseOpenAs(file_name, format, error);
   if (!ifileformat) 
+  {
+    imProfileEnd();
     return NULL;
+  }
 
   imFileClear(ifileformat);
 
@@ -87,6 +107,8 @@ imFile* imFileOpenAs(const char* file_name, const char* format, int *error)
 
   ifileformat->counter = imCounterBegin(file_name);
 
+  imProfileEnd();
+
   return ifileformat;
 }
 
@@ -94,9 +116,14 @@ imFile* imFileNew(const char* file_name, const char* format, int *error)
 {
   assert(file_name);
 
+  imProfileBegin("File Open", 1);
+
   imFileFormatBase* ifileformat = imFileFormatBaseNew(file_name, format, error);
   if (!ifileformat) 
+  {
+    imProfileEnd();
     return NULL;
+  }
 
   imFileClear(ifileformat);
 
@@ -108,15 +135,44 @@ imFile* imFileNew(const char* file_name, const char* format, int *error)
 
   ifileformat->counter = imCounterBegin(file_name);
 
+  imProfileEnd();
+
   return ifileformat;
 }
 
+/* The format drivers open the file with imBinFileOpen or imBinFileNew, 
+   that will use the given I/O while the driver is opened in this thread. */
+
+imFile* imFileOpenIO(imBinFileIO* io, const char* format, int *error)
+{
+  assert(io);
+
+  imBinFileIO* old_io = imBinFileSetThreadIO(io);
+  imFile* ifile = format? imFileOpenAs("", format, error): imFileOpen("", error);
+  imBinFileSetThreadIO(old_io);
+
+  return ifile;
+}
+
+imFile* imFileNewIO(imBinFileIO* io, const char* format, int *error)
+{
+  assert(io);
+
+  imBinFileIO* old_io = imBinFileSetThreadIO(io);
+  imFile* ifile = imFileNew("", format, error);
+  imBinFileSetThreadIO(old_io);
+
+  return ifile;
+}
+
 void imFileClose(imFile* ifile)
 {
   assert(ifile);
   imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
   imAttribTable* attrib_table = (imAttribTable*)ifile->attrib_table;
 
+  imProfileBegin("File Close", 1);
+
   imCounterEnd(ifile->counter);
 
   ifileformat->Close();
@@ -125,6 +181,8 @@ void imFileClose(imFile* ifile)
   
   delete attrib_table;
   delete ifileformat;
+
+  imProfileEnd();
 }
 
 void* imFileHandle(imFile* ifile, int index)
@@ -141,6 +199,7 @@ void imFileSetAttribute(imFile* ifile, const char* attrib, int data_type, int co
   assert(ifile);
   assert(attrib);
   imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+  ifileformat->LoadAttributes();
   imAttribTable* atable = (imAttribTable*)ifileformat->attrib_table;
   if (data)
     atable->Set(attrib, data_type, count, data);
@@ -153,6 +212,7 @@ const void* imFileGetAttribute(imFile* ifile, const char* attrib, int *data_type
   assert(ifile);
   assert(attrib);
   imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+  ifileformat->LoadAttributes();
   imAttribTable* attrib_table = (imAttribTable*)ifileformat->attrib_table;
   return attrib_table->Get(attrib, data_type, count);
 }
@@ -172,6 +232,8 @@ void imFileGetAttributeList(imFile* ifile, char** attrib, int *attrib_count)
   assert(ifile);
   assert(attrib_count);
 
+  imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+  ifileformat->LoadAttributes();
   imAttribTable* attrib_table = (imAttribTable*)ifile->attrib_table;
   *attrib_count = attrib_table->Count();
 
@@ -188,16 +250,16 @@ void imFileGetInfo(imFile* ifile, char* format, char* compression, int *image_co
   if (image_count) *image_count = ifile->image_count;
 }
 
-static int iFileCheckPaletteGray(imFile* ifile)
+static int iFileCheckPaletteGray(const long* palette, int palette_count)
 {
   int i;
   imbyte r, g, b;
   imbyte remaped[256];
   memset(remaped, 0, 256);
 
-  for (i = 0; i < ifile->palette_count; i++)
+  for (i = 0; i < palette_count; i++)
   {
-    imColorDecode(&r, &g, &b, ifile->palette[i]);
+    imColorDecode(&r, &g, &b, palette[i]);
 
     /* if there are colors abort */
     if (r != g || g != b)
@@ -217,20 +279,20 @@ static int iFileCheckPaletteGray(imFile* ifile)
   return 1;
 }
 
-static int iFileCheckPaletteBinary(imFile* ifile)
+static int iFileCheckPaletteBinary(const long* palette, int palette_count)
 {
-  if (ifile->palette_count > 2)
+  if (palette_count > 2)
     return 0;
 
   imbyte r, g, b;
 
-  imColorDecode(&r, &g, &b, ifile->palette[0]);
+  imColorDecode(&r, &g, &b, palette[0]);
   if ((r != 0 || g != 0 || b != 0) &&
       (r != 1 || g != 1 || b != 1) &&
       (r != 255 || g != 255 || b != 255))
     return 0;
 
-  imColorDecode(&r, &g, &b, ifile->palette[1]);
+  imColorDecode(&r, &g, &b, palette[1]);
   if ((r != 0 || g != 0 || b != 0) &&
       (r != 1 || g != 1 || b != 1) &&
       (r != 255 || g != 255 || b != 255))
@@ -239,6 +301,20 @@ static int iFileCheckPaletteBinary(imFile* ifile)
   return 1;
 }
 
+int imFilePaletteColorMode(int file_color_mode, const long* palette, int palette_count)
+{
+  if (imColorModeSpace(file_color_mode) == IM_MAP)
+  {    
+    if (iFileCheckPaletteGray(palette, palette_count))
+      file_color_mode = (file_color_mode & 0xFF00) | IM_GRAY;
+
+    if (iFileCheckPaletteBinary(palette, palette_count))
+      file_color_mode = (file_color_mode & 0xFF00) | IM_BINARY;
+  }
+
+  return file_color_mode;
+}
+
 int imFileReadImageInfo(imFile* ifile, int index, int *width, int *height, int *file_color_mode, int *file_data_type)
 {
   assert(ifile);
@@ -261,6 +337,7 @@ int imFileReadImageInfo(imFile* ifile, int index, int *width, int *height, int *
 
   ifile->convert_bpp = 0;
   ifile->switch_type = 0;
+  ifile->next_line = 0;
 
   int error = ifileformat->ReadImageInfo(index);
   if (error) return error;
@@ -275,14 +352,7 @@ int imFileReadImageInfo(imFile* ifile, int index, int *width, int *height, int *
     ifile->palette[1] = imColorEncode(255, 255, 255);
   }
 
-  if (imColorModeSpace(ifile->file_color_mode) == IM_MAP)
-  {    
-    if (iFileCheckPaletteGray(ifile))
-      ifile->file_color_mode = (ifile->file_color_mode & 0xFF00) | IM_GRAY;
-
-    if (iFileCheckPaletteBinary(ifile))
-      ifile->file_color_mode = (ifile->file_color_mode & 0xFF00) | IM_BINARY;
-  }
+  ifile->file_color_mode = imFilePaletteColorMode(ifile->file_color_mode, ifile->palette, ifile->palette_count);
 
   if(width) *width = ifile->width;
   if(height) *height = ifile->height;
@@ -305,22 +375,20 @@ void imFileGetPalette(imFile* ifile, long* palette, int *palette_count)
  if (palette_count) *palette_count = ifile->palette_count;
 }
 
-static void iFileCheckConvertGray(imFile* ifile, imbyte* data)
+static void iFileCheckConvertGray(imFile* ifile, imbyte* data, int line_count, int update_palette)
 {
   int i, do_remap = 0;
   imbyte remap[256], r, g, b;
 
   // enforce the palette to only have grays in the correct order.
+  // when reading lines the palette is updated only after the last line.
 
   for (i = 0; i < ifile->palette_count; i++)
   {
     imColorDecode(&r, &g, &b, ifile->palette[i]);
 
     if (r != i)
-    {
-      ifile->palette[i] = imColorEncode((imbyte)i, (imbyte)i, (imbyte)i);
       do_remap = 1;
-    }
 
     remap[i] = r;
   }
@@ -328,13 +396,23 @@ static void iFileCheckConvertGray(imFile* ifile, imbyte* data)
   if (!do_remap)
     return;
 
-  int count = ifile->width*ifile->height;
+  int count = ifile->width*line_count;
   for(i = 0; i < count; i++)
   {
     *data = remap[*data];
     data++;
   }
 
+  if (!update_palette)
+    return;
+
+  for (i = 0; i < ifile->palette_count; i++)
+  {
+    imColorDecode(&r, &g, &b, ifile->palette[i]);
+    if (r != i)
+      ifile->palette[i] = imColorEncode((imbyte)i, (imbyte)i, (imbyte)i);
+  }
+
   int transp_count;
   imbyte* transp_map = (imbyte*)imFileGetAttribute(ifile, "TransparencyMap", NULL, &transp_count);
   if (transp_map)
@@ -346,9 +424,9 @@ static void iFileCheckConvertGray(imFile* ifile, imbyte* data)
   }
 }
 
-static void iFileCheckConvertBinary(imFile* ifile, imbyte* data)
+static void iFileCheckConvertBinary(imFile* ifile, imbyte* data, int line_count)
 {
-  int count = ifile->width*ifile->height;
+  int count = ifile->width*line_count;
   for(int i = 0; i < count; i++)
   {
     if (*data)
@@ -357,15 +435,23 @@ static void iFileCheckConvertBinary(imFile* ifile, imbyte* data)
   }
 }
 
-int imFileReadImageData(imFile* ifile, void* data, int convert2bitmap, int color_mode_flags)
+static void iFileProfileBegin(imFile* ifile, const char* op, int line_count)
 {
-  assert(ifile);
-  assert(!ifile->is_new);
+  if (!imProfileGetMode())
+    return;
+
+  /* operation name includes the format, for instance "File Read TIFF" */
   imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+  char name[64];
+  sprintf(name, "%s %s", op, ifileformat->iformat->format);
 
-  if (ifile->image_index == -1)
-    return IM_ERR_DATA;
+  imProfileBegin(name, 1);
+  imProfileAddData((double)ifile->width*line_count, 
+                   imImageDataSize(ifile->width, line_count, ifile->user_color_mode, ifile->user_data_type));
+}
 
+static int iFileSetUserMode(imFile* ifile, int convert2bitmap, int color_mode_flags)
+{
   ifile->user_color_mode = ifile->file_color_mode;
   ifile->user_data_type = ifile->file_data_type;
 
@@ -389,16 +475,94 @@ int imFileReadImageData(imFile* ifile, void* data, int convert2bitmap, int color
 
   imFileLineBufferInit(ifile);
 
+  return IM_ERR_NONE;
+}
+
+int imFileReadImageData(imFile* ifile, void* data, int convert2bitmap, int color_mode_flags)
+{
+  assert(ifile);
+  assert(!ifile->is_new);
+  imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+
+  if (ifile->image_index == -1)
+    return IM_ERR_DATA;
+
+  int error = iFileSetUserMode(ifile, convert2bitmap, color_mode_flags);
+  if (error)
+    return error;
+
+  iFileProfileBegin(ifile, "File Read", ifile->height);
+
   int ret = ifileformat->ReadImageData(data);
 
   // here we can NOT change the file_color_mode we already returned to the user
   // so just check for gray and binary consistency
 
   if (imColorModeSpace(ifile->file_color_mode) == IM_GRAY && ifile->file_data_type == IM_BYTE)
-    iFileCheckConvertGray(ifile, (imbyte*)data);
+    iFileCheckConvertGray(ifile, (imbyte*)data, ifile->height, 1);
 
   if (imColorModeSpace(ifile->file_color_mode) == IM_BINARY)
-    iFileCheckConvertBinary(ifile, (imbyte*)data);
+    iFileCheckConvertBinary(ifile, (imbyte*)data, ifile->height);
+
+  imProfileEnd();
+
+  return ret;
+}
+
+int imFileReadImageLines(imFile* ifile, void* data, int first_line, int count, int convert2bitmap, int color_mode_flags)
+{
+  assert(ifile);
+  assert(!ifile->is_new);
+  assert(data);
+  imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+
+  if (ifile->image_index == -1)
+    return IM_ERR_DATA;
+
+  if (ifile->next_line == 0)
+  {
+    int error = iFileSetUserMode(ifile, convert2bitmap, color_mode_flags);
+    if (error)
+      return error;
+  }
+
+  if (first_line < 0 || count <= 0 || first_line + count > ifile->height)
+    return IM_ERR_DATA;
+
+  // lines are read in the file order
+  int file_first_line = first_line;
+  if (imColorModeIsTopDown(ifile->file_color_mode) != imColorModeIsTopDown(ifile->user_color_mode))
+    file_first_line = ifile->height - (first_line + count);
+
+  if (file_first_line != ifile->next_line)
+    return IM_ERR_DATA;
+
+  // the planes are stored one after the other, the whole image is necessary
+  if (imFileLineBufferCount(ifile) != ifile->height)
+    return IM_ERR_DATA;
+
+  iFileProfileBegin(ifile, "File Read", count);
+
+  ifile->data_first_line = first_line;
+  ifile->data_line_count = count;
+
+  int ret = ifileformat->ReadImageLines(data, file_first_line, count);
+
+  ifile->data_first_line = 0;
+  ifile->data_line_count = 0;
+
+  int last = (ifile->next_line + count == ifile->height);
+
+  if (imColorModeSpace(ifile->file_color_mode) == IM_GRAY && ifile->file_data_type == IM_BYTE)
+    iFileCheckConvertGray(ifile, (imbyte*)data, count, last);
+
+  if (imColorModeSpace(ifile->file_color_mode) == IM_BINARY)
+    iFileCheckConvertBinary(ifile, (imbyte*)data, count);
+
+  imProfileEnd();
+
+  if (ret == IM_ERR_NONE)
+    ifile->next_line += count;
 
   return ret;
 }
@@ -440,6 +604,7 @@ int imFileWriteImageInfo(imFile* ifile, int width, int height, int user_color_mo
   ifile->height = height;
   ifile->user_color_mode = user_color_mode;
   ifile->user_data_type = user_data_type;
+  ifile->next_line = 0;
 
   if (imColorModeSpace(user_color_mode) == IM_BINARY)
   {
@@ -463,5 +628,59 @@ int imFileWriteImageData(imFile* ifile, void* data)
 
   imFileLineBufferInit(ifile);
 
-  return ifileformat->WriteImageData(data);
+  iFileProfileBegin(ifile, "File Write", ifile->height);
+
+  int ret = ifileformat->WriteImageData(data);
+
+  imProfileEnd();
+
+  return ret;
+}
+
+int imFileWriteImageLines(imFile* ifile, void* data, int first_line, int count)
+{
+  assert(ifile);
+  assert(ifile->is_new);
+  assert(data);
+  imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+
+  if (first_line < 0 || count <= 0 || first_line + count > ifile->height)
+    return IM_ERR_DATA;
+
+  // lines are written in the file order
+  int file_first_line = first_line;
+  if (imColorModeIsTopDown(ifile->file_color_mode) != imColorModeIsTopDown(ifile->user_color_mode))
+    file_first_line = ifile->height - (first_line + count);
+
+  if (file_first_line != ifile->next_line)
+    return IM_ERR_DATA;
+
+  if (ifile->next_line == 0)
+  {
+    if (!imFileCheckConversion(ifile))
+      return IM_ERR_DATA;
+
+    imFileLineBufferInit(ifile);
+  }
+
+  // the planes are stored one after the other, the whole image is necessary
+  if (imFileLineBufferCount(ifile) != ifile->height)
+    return IM_ERR_DATA;
+
+  iFileProfileBegin(ifile, "File Write", count);
+
+  ifile->data_first_line = first_line;
+  ifile->data_line_count = count;
+
+  int ret = ifileformat->WriteImageLines(data, file_first_line, count);
+
+  ifile->data_first_line = 0;
+  ifile->data_line_count = 0;
+
+  imProfileEnd();
+
+  if (ret == IM_ERR_NONE)
+    ifile->next_line += count;
+
+  return ret;
 }
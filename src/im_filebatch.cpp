@@ -0,0 +1,215 @@
+/** \file
+ * \brief Parallel Image Batch Loader
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "im.h"
+#include "im_image.h"
+#include "im_util.h"
+
+#include "im_thread.h"
+
+
+struct iBatchSlot
+{
+  imImage* image;
+  int error,
+      done;
+};
+
+struct _imFileImageBatch
+{
+  const char** file_names;
+  int count;
+  int bitmap;
+
+  iBatchSlot* slots;
+  int next_load,     /* next file to be loaded by a worker */
+      next_return;   /* next file to be returned to the application */
+
+  double memory,       /* size of the loaded images waiting for the application */
+         max_memory;
+
+  int cancel;
+
+  iMutex mutex;
+  iCondition loaded,    /* signaled when a file is loaded */
+             removed;   /* signaled when an image is returned or when canceled */
+
+  iThread* threads;
+  int thread_count;
+};
+
+static double iBatchImageMemory(const imImage* image)
+{
+  return (double)image->size + (image->has_alpha? image->plane_size: 0);
+}
+
+static void iBatchRun(imFileImageBatch* batch)
+{
+  for (;;)
+  {
+    iMutexLock(&batch->mutex);
+    /* the next file to be returned is always loaded, so the memory limit never blocks the application */
+    while (!batch->cancel && batch->next_load < batch->count &&
+           batch->max_memory > 0 && batch->memory >= batch->max_memory &&
+           batch->next_load != batch->next_return)
+      iConditionWait(&batch->removed, &batch->mutex);
+
+    if (batch->cancel || batch->next_load == batch->count)
+    {
+      iMutexUnlock(&batch->mutex);
+      break;
+    }
+
+    int i = batch->next_load;
+    batch->next_load++;
+    iMutexUnlock(&batch->mutex);
+
+    int error;
+    imImage* image;
+    if (batch->bitmap)
+      image = imFileImageLoadBitmap(batch->file_names[i], 0, &error);
+    else
+      image = imFileImageLoad(batch->file_names[i], 0, &error);
+
+    iMutexLock(&batch->mutex);
+    batch->slots[i].image = image;
+    batch->slots[i].error = image? IM_ERR_NONE: (error? error: IM_ERR_MEM);
+    batch->slots[i].done = 1;
+    if (image)
+      batch->memory += iBatchImageMemory(image);
+    iConditionSignal(&batch->loaded);
+    iMutexUnlock(&batch->mutex);
+  }
+}
+
+IM_THREAD_PROC(iBatchThread, param)
+{
+  iBatchRun((imFileImageBatch*)param);
+  return IM_THREAD_RETURN;
+}
+
+static void iBatchDestroy(imFileImageBatch* batch)
+{
+  for (int i = batch->next_return; i < batch->count; i++)
+  {
+    if (batch->slots[i].image)
+      imImageDestroy(batch->slots[i].image);
+  }
+
+  iConditionDestroy(&batch->removed);
+  iConditionDestroy(&batch->loaded);
+  iMutexDestroy(&batch->mutex);
+
+  free(batch->file_names);
+  free(batch->slots);
+  free(batch->threads);
+  free(batch);
+}
+
+imFileImageBatch* imFileImageLoadBatchStart(const char** file_names, int count, int thread_count, int max_memory, int bitmap)
+{
+  assert(file_names);
+
+  if (count <= 0)
+    return NULL;
+
+  if (thread_count <= 0)
+    thread_count = iThreadProcessorCount();
+  if (thread_count > count)
+    thread_count = count;
+
+  imFileImageBatch* batch = (imFileImageBatch*)malloc(sizeof(imFileImageBatch));
+  if (!batch)
+    return NULL;
+  memset(batch, 0, sizeof(imFileImageBatch));
+
+  batch->count = count;
+  batch->bitmap = bitmap;
+  batch->max_memory = (double)max_memory*1024*1024;
+
+  batch->file_names = (const char**)malloc(count*sizeof(const char*));
+  batch->slots = (iBatchSlot*)calloc(count, sizeof(iBatchSlot));
+  batch->threads = (iThread*)malloc(thread_count*sizeof(iThread));
+  if (!batch->file_names || !batch->slots || !batch->threads)
+  {
+    free(batch->file_names);
+    free(batch->slots);
+    free(batch->threads);
+    free(batch);
+    return NULL;
+  }
+
+  memcpy(batch->file_names, file_names, count*sizeof(const char*));
+
+  iMutexInit(&batch->mutex);
+  iConditionInit(&batch->loaded);
+  iConditionInit(&batch->removed);
+
+  for (int t = 0; t < thread_count; t++)
+  {
+    if (!iThreadCreate(batch->threads + t, iBatchThread, batch))
+      break;
+    batch->thread_count++;
+  }
+
+  if (batch->thread_count == 0)
+  {
+    iBatchDestroy(batch);
+    return NULL;
+  }
+
+  return batch;
+}
+
+imImage* imFileImageLoadBatchNext(imFileImageBatch* batch, int *index, int *error)
+{
+  assert(batch);
+  assert(error);
+
+  imImage* image = NULL;
+
+  iMutexLock(&batch->mutex);
+  if (batch->next_return < batch->count)
+  {
+    iBatchSlot* slot = batch->slots + batch->next_return;
+    while (!slot->done)
+      iConditionWait(&batch->loaded, &batch->mutex);
+
+    image = slot->image;
+    *error = slot->error;
+    if (index) *index = batch->next_return;
+
+    if (image)
+      batch->memory -= iBatchImageMemory(image);
+    slot->image = NULL;
+    batch->next_return++;
+    iConditionSignal(&batch->removed);
+  }
+  else
+    *error = IM_ERR_NONE;  /* at the end */
+  iMutexUnlock(&batch->mutex);
+
+  return image;
+}
+
+void imFileImageLoadBatchStop(imFileImageBatch* batch)
+{
+  assert(batch);
+
+  iMutexLock(&batch->mutex);
+  batch->cancel = 1;
+  iConditionSignal(&batch->removed);
+  iMutexUnlock(&batch->mutex);
+
+  for (int t = 0; t < batch->thread_count; t++)
+    iThreadJoin(batch->threads + t);
+
+  iBatchDestroy(batch);
+}
@@ -25,6 +25,479 @@ int imFileLineSizeAligned(int width, int bpp, int align)
     return (width * bpp + 7) / 8;
 }
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IM_FILEBUFFER_SSE2
+#endif
+
+#ifdef IM_FILEBUFFER_SSE2
+
+/* SSE2 kernels for the most common line conversions (8 and 16 bits).
+ * They only move, mask or convert values, so the result is identical to the generic code.
+ * Each kernel returns the number of elements it processed, the remaining are processed 
+ * by the generic code. */
+
+#include <emmintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/* 32-bit x86 compilers may not enable SSE2 code generation by default */
+#if defined(__GNUC__) && !defined(__SSE2__)
+#define IM_SSE2_TARGET  __attribute__((target("sse2")))
+#else
+#define IM_SSE2_TARGET
+#endif
+
+static int iFileCanSSE2(void)
+{
+  static int simd_support = -1;
+
+  if (simd_support < 0)
+  {
+    int support;
+#if defined(__x86_64__) || defined(_M_X64)
+    support = 1;   /* SSE2 is part of the x86-64 baseline */
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    support = (info[3] >> 26) & 1;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    support = __get_cpuid(1, &eax, &ebx, &ecx, &edx)? (int)((edx >> 26) & 1): 0;
+#endif
+    simd_support = support;
+  }
+
+  return simd_support;
+}
+
+IM_SSE2_TARGET static int iSplit2Byte(int count, const imbyte* src, imbyte* p0, imbyte* p1)
+{
+  const __m128i mask = _mm_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 16 <= count; x += 16, src += 32)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    _mm_storeu_si128((__m128i*)(p0 + x), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+    _mm_storeu_si128((__m128i*)(p1 + x), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iSplit3Byte(int count, const imbyte* src, imbyte* p0, imbyte* p1, imbyte* p2)
+{
+  int x = 0;
+  for (; x + 16 <= count; x += 16, src += 48)
+  {
+    __m128i t00 = _mm_loadu_si128((const __m128i*)src);
+    __m128i t01 = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i t02 = _mm_loadu_si128((const __m128i*)(src + 32));
+
+    /* each step interleaves the three 8 byte halves, after 4 steps the components are separated */
+    __m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+    __m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+    __m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+    __m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+    _mm_storeu_si128((__m128i*)(p0 + x), _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31)));
+    _mm_storeu_si128((__m128i*)(p1 + x), _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32));
+    _mm_storeu_si128((__m128i*)(p2 + x), _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32)));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iSplit4Byte(int count, const imbyte* src, imbyte* p0, imbyte* p1, imbyte* p2, imbyte* p3)
+{
+  /* p3 can be NULL to ignore the 4th component */
+  int x = 0;
+  for (; x + 16 <= count; x += 16, src += 64)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+    __m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+
+    __m128i t0 = _mm_unpacklo_epi8(a, b);
+    __m128i t1 = _mm_unpackhi_epi8(a, b);
+    __m128i t2 = _mm_unpacklo_epi8(c, d);
+    __m128i t3 = _mm_unpackhi_epi8(c, d);
+
+    __m128i u0 = _mm_unpacklo_epi8(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi8(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi8(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi8(t2, t3);
+
+    __m128i v0 = _mm_unpacklo_epi8(u0, u1);   /* 8 x c0, 8 x c1 */
+    __m128i v1 = _mm_unpackhi_epi8(u0, u1);   /* 8 x c2, 8 x c3 */
+    __m128i v2 = _mm_unpacklo_epi8(u2, u3);
+    __m128i v3 = _mm_unpackhi_epi8(u2, u3);
+
+    _mm_storeu_si128((__m128i*)(p0 + x), _mm_unpacklo_epi64(v0, v2));
+    _mm_storeu_si128((__m128i*)(p1 + x), _mm_unpackhi_epi64(v0, v2));
+    _mm_storeu_si128((__m128i*)(p2 + x), _mm_unpacklo_epi64(v1, v3));
+    if (p3)
+      _mm_storeu_si128((__m128i*)(p3 + x), _mm_unpackhi_epi64(v1, v3));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iSplit4Short(int count, const imushort* src, imushort* p0, imushort* p1, imushort* p2, imushort* p3)
+{
+  /* p3 can be NULL to ignore the 4th component */
+  int x = 0;
+  for (; x + 8 <= count; x += 8, src += 32)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 8));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i d = _mm_loadu_si128((const __m128i*)(src + 24));
+
+    __m128i t0 = _mm_unpacklo_epi16(a, b);
+    __m128i t1 = _mm_unpackhi_epi16(a, b);
+    __m128i t2 = _mm_unpacklo_epi16(c, d);
+    __m128i t3 = _mm_unpackhi_epi16(c, d);
+
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);  /* 4 x c0, 4 x c1 */
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);  /* 4 x c2, 4 x c3 */
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+
+    _mm_storeu_si128((__m128i*)(p0 + x), _mm_unpacklo_epi64(u0, u2));
+    _mm_storeu_si128((__m128i*)(p1 + x), _mm_unpackhi_epi64(u0, u2));
+    _mm_storeu_si128((__m128i*)(p2 + x), _mm_unpacklo_epi64(u1, u3));
+    if (p3)
+      _mm_storeu_si128((__m128i*)(p3 + x), _mm_unpackhi_epi64(u1, u3));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iMerge2Byte(int count, const imbyte* p0, const imbyte* p1, imbyte* dst)
+{
+  int x = 0;
+  for (; x + 16 <= count; x += 16, dst += 32)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)(p0 + x));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p1 + x));
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(a, b));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static inline void iMerge4Byte16(const imbyte* p0, const imbyte* p1, const imbyte* p2, __m128i d, __m128i out[4])
+{
+  __m128i a = _mm_loadu_si128((const __m128i*)p0);
+  __m128i b = _mm_loadu_si128((const __m128i*)p1);
+  __m128i c = _mm_loadu_si128((const __m128i*)p2);
+
+  __m128i ab0 = _mm_unpacklo_epi8(a, b);
+  __m128i ab1 = _mm_unpackhi_epi8(a, b);
+  __m128i cd0 = _mm_unpacklo_epi8(c, d);
+  __m128i cd1 = _mm_unpackhi_epi8(c, d);
+
+  out[0] = _mm_unpacklo_epi16(ab0, cd0);
+  out[1] = _mm_unpackhi_epi16(ab0, cd0);
+  out[2] = _mm_unpacklo_epi16(ab1, cd1);
+  out[3] = _mm_unpackhi_epi16(ab1, cd1);
+}
+
+IM_SSE2_TARGET static int iMerge3Byte(int count, const imbyte* p0, const imbyte* p1, const imbyte* p2, imbyte* dst)
+{
+  /* merge as 4 components, then store each pixel with a 4 bytes write 
+     that is overwritten by the next pixel, so the last pixel of the line is never done here. */
+  int x = 0;
+  for (; x + 16 < count; x += 16)
+  {
+    __m128i out[4];
+    iMerge4Byte16(p0 + x, p1 + x, p2 + x, _mm_setzero_si128(), out);
+
+    for (int i = 0; i < 4; i++)
+    {
+      __m128i v = out[i];
+      for (int j = 0; j < 4; j++)
+      {
+        int pixel = _mm_cvtsi128_si32(v);
+        memcpy(dst, &pixel, 4);
+        dst += 3;
+        v = _mm_srli_si128(v, 4);
+      }
+    }
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iMerge4Byte(int count, const imbyte* p0, const imbyte* p1, const imbyte* p2, const imbyte* p3, imbyte* dst)
+{
+  int x = 0;
+  for (; x + 16 <= count; x += 16, dst += 64)
+  {
+    __m128i out[4];
+    iMerge4Byte16(p0 + x, p1 + x, p2 + x, _mm_loadu_si128((const __m128i*)(p3 + x)), out);
+
+    _mm_storeu_si128((__m128i*)dst, out[0]);
+    _mm_storeu_si128((__m128i*)(dst + 16), out[1]);
+    _mm_storeu_si128((__m128i*)(dst + 32), out[2]);
+    _mm_storeu_si128((__m128i*)(dst + 48), out[3]);
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iMerge4Short(int count, const imushort* p0, const imushort* p1, const imushort* p2, const imushort* p3, imushort* dst)
+{
+  int x = 0;
+  for (; x + 8 <= count; x += 8, dst += 32)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)(p0 + x));
+    __m128i b = _mm_loadu_si128((const __m128i*)(p1 + x));
+    __m128i c = _mm_loadu_si128((const __m128i*)(p2 + x));
+    __m128i d = _mm_loadu_si128((const __m128i*)(p3 + x));
+
+    __m128i ab0 = _mm_unpacklo_epi16(a, b);
+    __m128i ab1 = _mm_unpackhi_epi16(a, b);
+    __m128i cd0 = _mm_unpacklo_epi16(c, d);
+    __m128i cd1 = _mm_unpackhi_epi16(c, d);
+
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi32(ab0, cd0));
+    _mm_storeu_si128((__m128i*)(dst + 8), _mm_unpackhi_epi32(ab0, cd0));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpacklo_epi32(ab1, cd1));
+    _mm_storeu_si128((__m128i*)(dst + 24), _mm_unpackhi_epi32(ab1, cd1));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iExpand1Bit(int count, const imbyte* bit_buffer, imbyte* byte_buffer)
+{
+  /* in-place, done backwards in blocks of 16 pixels (2 bytes) */
+  const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 
+                                    1, 2, 4, 8, 16, 32, 64, (char)128);
+  const __m128i one = _mm_set1_epi8(1);
+  int blocks = count / 16;
+  for (int b = blocks-1; b >= 0; b--)
+  {
+    __m128i v = _mm_cvtsi32_si128(bit_buffer[2*b] | (bit_buffer[2*b+1] << 8));
+    v = _mm_unpacklo_epi8(v, v);     /* b0 b0 b1 b1 */
+    v = _mm_unpacklo_epi16(v, v);    /* b0 x4, b1 x4 */
+    v = _mm_unpacklo_epi32(v, v);    /* b0 x8, b1 x8 */
+    v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+    _mm_storeu_si128((__m128i*)(byte_buffer + 16*b), _mm_and_si128(v, one));
+  }
+  return blocks*16;
+}
+
+IM_SSE2_TARGET static int iExpand4Bit(int count, const imbyte* bit_buffer, imbyte* byte_buffer, int expand_range)
+{
+  /* in-place, done backwards in blocks of 16 pixels (8 bytes) */
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  int blocks = count / 16;
+  for (int b = blocks-1; b >= 0; b--)
+  {
+    __m128i v = _mm_loadl_epi64((const __m128i*)(bit_buffer + 8*b));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i lo = _mm_and_si128(v, mask);
+    v = _mm_unpacklo_epi8(hi, lo);
+    if (expand_range)   /* x*17 */
+      v = _mm_or_si128(v, _mm_slli_epi16(v, 4));
+    _mm_storeu_si128((__m128i*)(byte_buffer + 16*b), v);
+  }
+  return blocks*16;
+}
+
+IM_SSE2_TARGET static int iCompact1Bit(int count, imbyte* buffer)
+{
+  /* in-place, 16 pixels into 2 bytes */
+  const __m128i zero = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buffer + x));
+    int m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));   /* bit i is pixel i */
+
+    /* the first pixel goes to the most significant bit */
+    m = ((m & 0xF0F0) >> 4) | ((m & 0x0F0F) << 4);
+    m = ((m & 0xCCCC) >> 2) | ((m & 0x3333) << 2);
+    m = ((m & 0xAAAA) >> 1) | ((m & 0x5555) << 1);
+
+    buffer[x/8] = (imbyte)m;
+    buffer[x/8 + 1] = (imbyte)(m >> 8);
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iExpandNonZero(int count, imbyte* buffer)
+{
+  const __m128i zero = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 16 <= count; x += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buffer + x));
+    _mm_storeu_si128((__m128i*)(buffer + x), _mm_andnot_si128(_mm_cmpeq_epi8(v, zero), _mm_set1_epi8((char)0xFF)));
+  }
+  return x;
+}
+
+IM_SSE2_TARGET static int iSwitchSignBit(int size, imbyte* buffer, int type_size)
+{
+  /* in-place, size in bytes */
+  __m128i mask;
+  if (type_size == 1)
+    mask = _mm_set1_epi8((char)0x80);
+  else if (type_size == 2)
+    mask = _mm_set1_epi16((short)0x8000);
+  else
+    mask = _mm_set1_epi32((int)0x80000000);
+
+  int i = 0;
+  for (; i + 16 <= size; i += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buffer + i));
+    _mm_storeu_si128((__m128i*)(buffer + i), _mm_xor_si128(v, mask));
+  }
+  return i;
+}
+
+IM_SSE2_TARGET static int iDouble2Float(int count, const double* src, float* dst)
+{
+  /* in-place, forward */
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+    __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+    _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+  }
+  return i;
+}
+
+IM_SSE2_TARGET static int iFloat2Double(int count, const float* src, double* dst)
+{
+  /* in-place, backwards, returns the number of elements left for the generic code at the start */
+  int i = count;
+  for (; i - 4 >= 0; i -= 4)
+  {
+    __m128 v = _mm_loadu_ps(src + i - 4);
+    __m128d lo = _mm_cvtps_pd(v);
+    __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+    _mm_storeu_pd(dst + i - 4, lo);
+    _mm_storeu_pd(dst + i - 2, hi);
+  }
+  return i;
+}
+
+#endif
+
+/* Packing conversions with SIMD support.
+ * The generic templates do nothing, the overloads for 8 and 16 bits use the SSE2 kernels. */
+
+template <class T> 
+static int iDoSplitPacked(int, const T*, int, int, T*, int)
+{
+  return 0;
+}
+
+template <class T> 
+static int iDoMergePlanar(int, const T*, int, int, T*, int)
+{
+  return 0;
+}
+
+static int iDoSplitPacked(int count, const imbyte* src, int file_depth, int depth, imbyte* data, int plane_size)
+{
+  // from packed line to planes, depth<=file_depth
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2())
+  {
+    if (file_depth == 2 && depth == 2)
+      return iSplit2Byte(count, src, data, data + plane_size);
+    if (file_depth == 3 && depth == 3)
+      return iSplit3Byte(count, src, data, data + plane_size, data + 2*plane_size);
+    if (file_depth == 4 && depth >= 3)
+      return iSplit4Byte(count, src, data, data + plane_size, data + 2*plane_size, depth == 4? data + 3*plane_size: NULL);
+  }
+#else
+  (void)count; (void)src; (void)file_depth; (void)depth; (void)data; (void)plane_size;
+#endif
+  return 0;
+}
+
+static int iDoSplitPacked(int count, const imushort* src, int file_depth, int depth, imushort* data, int plane_size)
+{
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2() && file_depth == 4 && depth >= 3)
+    return iSplit4Short(count, src, data, data + plane_size, data + 2*plane_size, depth == 4? data + 3*plane_size: NULL);
+#else
+  (void)count; (void)src; (void)file_depth; (void)depth; (void)data; (void)plane_size;
+#endif
+  return 0;
+}
+
+static int iDoSplitPacked(int count, const short* src, int file_depth, int depth, short* data, int plane_size)
+{
+  return iDoSplitPacked(count, (const imushort*)src, file_depth, depth, (imushort*)data, plane_size);
+}
+
+static int iDoMergePlanar(int count, const imbyte* data, int plane_size, int depth, imbyte* dst, int file_depth)
+{
+  // from planes to packed line, all file components must be filled
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2() && depth == file_depth)
+  {
+    if (depth == 2)
+      return iMerge2Byte(count, data, data + plane_size, dst);
+    if (depth == 3)
+      return iMerge3Byte(count, data, data + plane_size, data + 2*plane_size, dst);
+    if (depth == 4)
+      return iMerge4Byte(count, data, data + plane_size, data + 2*plane_size, data + 3*plane_size, dst);
+  }
+#else
+  (void)count; (void)data; (void)plane_size; (void)depth; (void)dst; (void)file_depth;
+#endif
+  return 0;
+}
+
+static int iDoMergePlanar(int count, const imushort* data, int plane_size, int depth, imushort* dst, int file_depth)
+{
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2() && depth == 4 && file_depth == 4)
+    return iMerge4Short(count, data, data + plane_size, data + 2*plane_size, data + 3*plane_size, dst);
+#else
+  (void)count; (void)data; (void)plane_size; (void)depth; (void)dst; (void)file_depth;
+#endif
+  return 0;
+}
+
+static int iDoMergePlanar(int count, const short* data, int plane_size, int depth, short* dst, int file_depth)
+{
+  return iDoMergePlanar(count, (const imushort*)data, plane_size, depth, (imushort*)dst, file_depth);
+}
+
+template <class T> 
+static void iDoCopyComponent(int count, const T* src, int src_step, T* dst, int dst_step)
+{
+  if (src_step == 1 && dst_step == 1)
+  {
+    memcpy(dst, src, count*sizeof(T));
+    return;
+  }
+
+  for (int x = 0; x < count; x++)
+  {
+    *dst = *src;
+    src += src_step;
+    dst += dst_step;
+  }
+}
+
 template <class T> 
 static void iDoFillLineBuffer(int width, int height, int line, int plane,  
                               int file_color_mode, T* line_buffer, 
@@ -36,45 +509,41 @@ static void iDoFillLineBuffer(int width, int height, int line, int plane,
   int file_depth = imColorModeDepth(file_color_mode);  
   int data_depth = imColorModeDepth(user_color_mode);
   int data_plane_size = width*height;  // This will be used in UNpacked data
+  int data_packed = imColorModeIsPacked(user_color_mode);
 
-  if (imColorModeIsPacked(user_color_mode))
+  if (data_packed)
     data += line*width*data_depth;
   else
     data += line*width;
 
-  for (int x = 0; x < width; x++)
-  {
-    int x_data_offset = x*data_depth;    // This will be used in packed data
-
-    if (imColorModeIsPacked(file_color_mode))
-    {
-      int x_file_offset = x*file_depth;  // This will be used in packed data
+  // offset between components and between pixels in data
+  int data_comp_step = data_packed? 1: data_plane_size;
+  int data_step = data_packed? data_depth: 1;
 
-      // file is packed
-      // NO color space conversion, color_space must match
-      // Ignore alpha if necessary.
-      int depth = IM_MIN(file_depth, data_depth);      
-      for (int d = 0; d < depth; d++)
-      {
-        if (imColorModeIsPacked(user_color_mode))
-          line_buffer[x_file_offset + d] = data[x_data_offset + d];
-        else
-          line_buffer[x_file_offset + d] = data[d*data_plane_size + x];
-      }
-    }
-    else
-    {
-      // file NOT packed, copy just one plane
-      // NO color space conversion, color_space must match
+  if (imColorModeIsPacked(file_color_mode))
+  {
+    // file is packed
+    // NO color space conversion, color_space must match
+    // Ignore alpha if necessary.
+    int depth = IM_MIN(file_depth, data_depth);      
+
+    int x = 0;
+    if (!data_packed)
+      x = iDoMergePlanar(width, data, data_plane_size, depth, line_buffer, file_depth);
+
+    for (int d = 0; d < depth; d++)
+      iDoCopyComponent(width - x, data + d*data_comp_step + x*data_step, data_step, 
+                       line_buffer + x*file_depth + d, file_depth);
+  }
+  else
+  {
+    // file NOT packed, copy just one plane
+    // NO color space conversion, color_space must match
 
-      if (plane >= imColorModeDepth(user_color_mode))
-        return;
+    if (plane >= data_depth)
+      return;
 
-      if (imColorModeIsPacked(user_color_mode))
-        line_buffer[x] = data[x_data_offset + plane];
-      else
-        line_buffer[x] = data[plane*data_plane_size + x];
-    }
+    iDoCopyComponent(width, data + plane*data_comp_step, data_step, line_buffer, 1);
   }
 }
 
@@ -89,45 +558,41 @@ static void iDoFillData(int width, int height, int line, int plane,
   int file_depth = imColorModeDepth(file_color_mode);
   int data_depth = imColorModeDepth(user_color_mode);
   int data_plane_size = width*height;  // This will be used in UNpacked data
+  int data_packed = imColorModeIsPacked(user_color_mode);
 
-  if (imColorModeIsPacked(user_color_mode))
+  if (data_packed)
     data += line*width*data_depth;
   else
     data += line*width;
 
-  for (int x = 0; x < width; x++)
-  {
-    int x_data_offset = x*data_depth;    // This will be used in packed data
+  // offset between components and between pixels in data
+  int data_comp_step = data_packed? 1: data_plane_size;
+  int data_step = data_packed? data_depth: 1;
 
-    if (imColorModeIsPacked(file_color_mode))
-    {
-      int x_file_offset = x*file_depth;  // This will be used in packed data
-
-      // file is packed
-      // NO color space conversion, color_space must match
-      // ignore alpha if necessary.
-      int depth = IM_MIN(file_depth, data_depth);      
-      for (int d = 0; d < depth; d++)
-      {
-        if (imColorModeIsPacked(user_color_mode))
-          data[x_data_offset + d] = line_buffer[x_file_offset + d];
-        else
-          data[d*data_plane_size + x] = line_buffer[x_file_offset + d];
-      }
-    }
-    else
-    {
-      // file NOT packed, copy just one plane
-      // NO color space conversion, color_space must match
+  if (imColorModeIsPacked(file_color_mode))
+  {
+    // file is packed
+    // NO color space conversion, color_space must match
+    // ignore alpha if necessary.
+    int depth = IM_MIN(file_depth, data_depth);      
+
+    int x = 0;
+    if (!data_packed)
+      x = iDoSplitPacked(width, line_buffer, file_depth, depth, data, data_plane_size);
+
+    for (int d = 0; d < depth; d++)
+      iDoCopyComponent(width - x, line_buffer + x*file_depth + d, file_depth, 
+                       data + d*data_comp_step + x*data_step, data_step);
+  }
+  else
+  {
+    // file NOT packed, copy just one plane
+    // NO color space conversion, color_space must match
 
-      if (plane >= imColorModeDepth(user_color_mode))
-        return;
+    if (plane >= data_depth)
+      return;
 
-      if (imColorModeIsPacked(user_color_mode))
-        data[x_data_offset + plane] = line_buffer[x];
-      else
-        data[plane*data_plane_size + x] = line_buffer[x];
-    }
+    iDoCopyComponent(width, line_buffer, 1, data + plane*data_comp_step, data_step);
   }
 }
 
@@ -220,139 +685,152 @@ static void iDoFillDataBitmap(int width, int height, int line, int plane, int da
   int data_depth = imColorModeDepth(user_color_mode);
   int copy_alpha = imColorModeHasAlpha(file_color_mode) && imColorModeHasAlpha(user_color_mode);
   int data_plane_size = width*height;  // This will be used in UNpacked data
+  int data_packed = imColorModeIsPacked(user_color_mode);
 
   T type_max = (T)imColorMax(data_type);
   T type_min = (T)imColorMin(data_type);
 
-  if (imColorModeIsPacked(user_color_mode))
+  if (data_packed)
     data += line*width*data_depth;
   else
     data += line*width;
 
-  for (int x = 0; x < width; x++)
-  {
-    int x_data_offset = x*data_depth;    // This will be used in packed data
+  // offset between components and between pixels in data
+  int data_comp_step = data_packed? 1: data_plane_size;
+  int data_step = data_packed? data_depth: 1;
 
-    if (imColorModeIsPacked(file_color_mode))
+  if (imColorModeIsPacked(file_color_mode))
+  {
+    if (imColorModeMatch(file_color_mode, user_color_mode))
     {
-      int x_file_offset = x*file_depth;  // This will be used in packed data
-
-      if (imColorModeMatch(file_color_mode, user_color_mode))
+      // file is packed
+      // same color space components   (in this case means RGB)
+      // ignore alpha if necessary.
+      int depth = IM_MIN(file_depth, data_depth);      
+      for (int d = 0; d < depth; d++)
       {
-        // file is packed
-        // same color space components   (in this case means RGB)
-        // ignore alpha if necessary.
-        int depth = IM_MIN(file_depth, data_depth);      
-        for (int d = 0; d < depth; d++)
+        const T* src = line_buffer + d;
+        imbyte* dst = data + d*data_comp_step;
+        for (int x = 0; x < width; x++)
         {
-          if (imColorModeIsPacked(user_color_mode))
-            data[x_data_offset + d] = iConvertType2Byte(line_buffer[x_file_offset + d], type_min, type_max);
-          else
-            data[d*data_plane_size + x] = iConvertType2Byte(line_buffer[x_file_offset + d], type_min, type_max);
+          *dst = iConvertType2Byte(*src, type_min, type_max);
+          src += file_depth;
+          dst += data_step;
         }
       }
-      else
-      {
-        // file is packed
-        // but different color space components
-        // only to RGB conversions are accepted
+    }
+    else
+    {
+      // file is packed
+      // but different color space components
+      // only to RGB conversions are accepted
+
+      if (imColorModeSpace(user_color_mode) != IM_RGB)
+        return;
 
-        if (imColorModeSpace(user_color_mode) != IM_RGB)
-          return;
+      int file_space = imColorModeSpace(file_color_mode);
+      int alpha_offset = (file_space == IM_CMYK)? 4: 3;
+
+      for (int x = 0; x < width; x++)
+      {
+        const T* src = line_buffer + x*file_depth;
+        imbyte* dst = data + x*data_step;
 
         T src_data[4];
-        src_data[0] = line_buffer[x_file_offset];
-        src_data[1] = line_buffer[x_file_offset + 1];
-        src_data[2] = line_buffer[x_file_offset + 2];
-        if (imColorModeSpace(file_color_mode) == IM_CMYK)
-          src_data[3] = line_buffer[x_file_offset + 3];
+        src_data[0] = src[0];
+        src_data[1] = src[1];
+        src_data[2] = src[2];
+        if (file_space == IM_CMYK)
+          src_data[3] = src[3];
 
         // Do conversion in-place
-        iConvertColor2RGB(src_data, imColorModeSpace(file_color_mode), data_type);
+        iConvertColor2RGB(src_data, file_space, data_type);
 
-        if (imColorModeIsPacked(user_color_mode))
-        {
-          data[x_data_offset] = iConvertType2Byte(src_data[0], type_min, type_max);
-          data[x_data_offset + 1] = iConvertType2Byte(src_data[1], type_min, type_max);
-          data[x_data_offset + 2] = iConvertType2Byte(src_data[2], type_min, type_max);
-
-          if (copy_alpha)
-          {
-            if (imColorModeSpace(file_color_mode) == IM_CMYK)
-              data[x_data_offset + 3] = iConvertType2Byte(line_buffer[x_file_offset + 4], type_min, type_max);
-            else
-              data[x_data_offset + 3] = iConvertType2Byte(line_buffer[x_file_offset + 3], type_min, type_max);
-          }
-        }
-        else
-        {
-          data[x] = iConvertType2Byte(src_data[0], type_min, type_max);
-          data[data_plane_size + x] = iConvertType2Byte(src_data[1], type_min, type_max);
-          data[2*data_plane_size + x] = iConvertType2Byte(src_data[2], type_min, type_max);
-
-          if (copy_alpha)
-          {
-            if (imColorModeSpace(file_color_mode) == IM_CMYK)
-              data[3*data_plane_size + x] = iConvertType2Byte(line_buffer[x_file_offset + 4], type_min, type_max);
-            else
-              data[3*data_plane_size + x] = iConvertType2Byte(line_buffer[x_file_offset + 3], type_min, type_max);
-          }
-        }
+        dst[0] = iConvertType2Byte(src_data[0], type_min, type_max);
+        dst[data_comp_step] = iConvertType2Byte(src_data[1], type_min, type_max);
+        dst[2*data_comp_step] = iConvertType2Byte(src_data[2], type_min, type_max);
+
+        if (copy_alpha)
+          dst[3*data_comp_step] = iConvertType2Byte(src[alpha_offset], type_min, type_max);
       }
     }
-    else
-    {
-      // file NOT packed, copy just one plane
-      // NO color space conversion possible now
+  }
+  else
+  {
+    // file NOT packed, copy just one plane
+    // NO color space conversion possible now
 
-      if (plane >= imColorModeDepth(user_color_mode))
-        return;
+    if (plane >= data_depth)
+      return;
 
-      if (imColorModeIsPacked(user_color_mode))
-        data[x_data_offset + plane] = iConvertType2Byte(line_buffer[x], type_min, type_max);
-      else
-        data[plane*data_plane_size + x] = iConvertType2Byte(line_buffer[x], type_min, type_max);
+    imbyte* dst = data + plane*data_comp_step;
+    for (int x = 0; x < width; x++)
+    {
+      *dst = iConvertType2Byte(line_buffer[x], type_min, type_max);
+      dst += data_step;
     }
   }
 }
 
-static void iFileExpandBits(imFile* ifile)
+static void iFileExpandBits(imFile* ifile, void* line_buffer)
 {
   // conversion will be done in-place in backward order (from end to start)
 
   if (abs(ifile->convert_bpp) < 8)
   {
-    imbyte* byte_buffer = (imbyte*)ifile->line_buffer;
-    imbyte* bit_buffer = (imbyte*)ifile->line_buffer;
-
-    byte_buffer += ifile->width-1; 
+    imbyte* byte_buffer = (imbyte*)line_buffer;
+    imbyte* bit_buffer = (imbyte*)line_buffer;
     int bpp = ifile->convert_bpp;
     int expand_range = imColorModeSpace(ifile->file_color_mode) == IM_GRAY? 1: 0;
+    int width = ifile->width;
 
-    for (int i=ifile->width-1; i >= 0; i--)
+    if (bpp < 0)  /* if convert_bpp<0 then only expand its range */
+    {
+      if (!expand_range || bpp == -1)
+        return;
+
+      imbyte factor = (bpp == -4)? 17: 85;
+      for (int i = 0; i < width; i++)
+        byte_buffer[i] *= factor;
+      return;
+    }
+
+    // the SIMD kernels do complete blocks at the start of the line, 
+    // so first do the remaining pixels at the end of the line.
+    int start = 0;
+#ifdef IM_FILEBUFFER_SSE2
+    if (iFileCanSSE2() && (bpp == 1 || bpp == 4))
+      start = width - width % 16;
+#endif
+
+    imbyte factor = 1;
+    if (expand_range)
+      factor = (bpp == 4)? 17: (bpp == 2)? 85: 1;
+
+    for (int i = width-1; i >= start; i--)
     {
       if (bpp == 1)
-        *byte_buffer = (imbyte)((bit_buffer[i / 8] >> (7 - i % 8)) & 0x01);
+        byte_buffer[i] = (imbyte)((bit_buffer[i / 8] >> (7 - i % 8)) & 0x01);
       else if (bpp == 4)
-        *byte_buffer = (imbyte)((bit_buffer[i / 2] >> ((1 - i % 2) * 4)) & 0x0F);
+        byte_buffer[i] = (imbyte)(((bit_buffer[i / 2] >> ((1 - i % 2) * 4)) & 0x0F) * factor);
       else if (bpp == 2)
-        *byte_buffer = (imbyte)((bit_buffer[i / 4] >> ((3 - i % 4) * 2)) & 0x03);
-
-      if (expand_range)   /* if convert_bpp<0 then only expand its range */
-      {
-        if (bpp == 4 || bpp == -4)
-          *byte_buffer *= 17;
-        else if (bpp == 2 || bpp == -2)
-          *byte_buffer *= 85;
-      }
+        byte_buffer[i] = (imbyte)(((bit_buffer[i / 4] >> ((3 - i % 4) * 2)) & 0x03) * factor);
+    }
 
-      byte_buffer--;
+#ifdef IM_FILEBUFFER_SSE2
+    if (start)
+    {
+      if (bpp == 1)
+        iExpand1Bit(start, bit_buffer, byte_buffer);
+      else
+        iExpand4Bit(start, bit_buffer, byte_buffer, expand_range);
     }
+#endif
   }
   else if (ifile->convert_bpp == 12)
   {
-    imushort* ushort_buffer = (imushort*)ifile->line_buffer;
-    imbyte* bit_buffer = (imbyte*)ifile->line_buffer;
+    imushort* ushort_buffer = (imushort*)line_buffer;
+    imbyte* bit_buffer = (imbyte*)line_buffer;
 
     for (int i=ifile->width-1; i >= 0; i--)
     {
@@ -365,178 +843,220 @@ static void iFileExpandBits(imFile* ifile)
   }
 }
 
-static void iFileCompactBits(imFile* ifile)
+static void iFileCompactBits(imFile* ifile, void* line_buffer)
 {
   // conversion will be done in-place
-  imbyte* byte_buffer = (imbyte*)ifile->line_buffer;
-  imbyte* bit_buffer = (imbyte*)ifile->line_buffer;
+  imbyte* byte_buffer = (imbyte*)line_buffer;
+  imbyte* bit_buffer = (imbyte*)line_buffer;
+  int i = 0;
 
   if (ifile->convert_bpp == 1)
   {
-    for (int i = 0; i < ifile->width; i++)
+#ifdef IM_FILEBUFFER_SSE2
+    if (iFileCanSSE2())
+      i = iCompact1Bit(ifile->width, byte_buffer);
+#endif
+
+    for (; i < ifile->width; i++)
     {
-      if (*byte_buffer)
+      if (byte_buffer[i])
         bit_buffer[i / 8] |=  (0x01 << (7 - (i % 8)));
       else
         bit_buffer[i / 8] &= ~(0x01 << (7 - (i % 8)));
-
-      byte_buffer++;
     }
   }
   else  // -1 == expand 1 to 255
   {
-    for (int i = 0; i < ifile->width; i++)
-    {
-      if (*byte_buffer)
-        *byte_buffer = 255;
+#ifdef IM_FILEBUFFER_SSE2
+    if (iFileCanSSE2())
+      i = iExpandNonZero(ifile->width, byte_buffer);
+#endif
 
-      byte_buffer++;
+    for (; i < ifile->width; i++)
+    {
+      if (byte_buffer[i])
+        byte_buffer[i] = 255;
     }
   }
 }
 
-template <class SRC, class DST> 
-static void iDoSwitchInt(int count, const SRC* src_data, DST* dst_data, int offset)
+template <class T> 
+static void iDoSwitchSign(int count, T* data, T sign_bit)
 {
-  for (int i = 0; i < count; i++)
-  {
-    *dst_data++ = (DST)((int)(*src_data++) + offset);
-  }
+  // signed <-> unsigned is the same as adding or subtracting the zero shift, 
+  // which is the same as inverting the most significant bit.
+  int i = 0;
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2())
+    i = iSwitchSignBit(count*sizeof(T), (imbyte*)data, sizeof(T)) / sizeof(T);
+#endif
+
+  for (; i < count; i++)
+    data[i] ^= sign_bit;
 }
 
-template <class SRC, class DST> 
-static void iDoSwitchReal(int count, const SRC* src_data, DST* dst_data)
+static void iDoSwitchDouble2Float(int count, const double* src_data, float* dst_data)
 {
-  for (int i = 0; i < count; i++)
-  {
-    *dst_data++ = (DST)(*src_data++);
-  }
+  // in-place, from start to end, destiny is smaller
+  int i = 0;
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2())
+    i = iDouble2Float(count, src_data, dst_data);
+#endif
+
+  for (; i < count; i++)
+    dst_data[i] = (float)src_data[i];
 }
 
-static void iFileSwitchFromType(imFile* ifile)
+static void iDoSwitchFloat2Double(int count, const float* src_data, double* dst_data)
+{
+  // in-place, from end to start, destiny is larger
+  int i = count;
+#ifdef IM_FILEBUFFER_SSE2
+  if (iFileCanSSE2())
+    i = iFloat2Double(count, src_data, dst_data);
+#endif
+
+  for (i = i-1; i >= 0; i--)
+    dst_data[i] = (double)src_data[i];
+}
+
+static void iFileSwitchFromType(imFile* ifile, void* line_buffer)
 {
   int line_count = imImageLineCount(ifile->width, ifile->file_color_mode);
   switch(ifile->file_data_type)
   {
   case IM_BYTE:    // Source is char
-    iDoSwitchInt(line_count, (const char*)ifile->line_buffer, (imbyte*)ifile->line_buffer, 128);
+    iDoSwitchSign(line_count, (imbyte*)line_buffer, (imbyte)0x80);
     break;
   case IM_SHORT:  // Source is ushort
-    iDoSwitchInt(line_count, (const imushort*)ifile->line_buffer, (short*)ifile->line_buffer, -32768);
-    break;
   case IM_USHORT:  // Source is short
-    iDoSwitchInt(line_count, (const short*)ifile->line_buffer, (imushort*)ifile->line_buffer, 32768);
+    iDoSwitchSign(line_count, (imushort*)line_buffer, (imushort)0x8000);
     break;
   case IM_INT:     // Source is uint                                                             
-    iDoSwitchInt(line_count, (const unsigned int*)ifile->line_buffer, (int*)ifile->line_buffer, -2147483647-1);
+    iDoSwitchSign(line_count, (unsigned int*)line_buffer, 0x80000000U);
     break;
   case IM_FLOAT:   // Source is double
-    iDoSwitchReal(line_count, (const double*)ifile->line_buffer, (float*)ifile->line_buffer);
+    iDoSwitchDouble2Float(line_count, (const double*)line_buffer, (float*)line_buffer);
     break;
   case IM_CFLOAT:  // Source is complex double
-    iDoSwitchReal(2*line_count, (const double*)ifile->line_buffer, (float*)ifile->line_buffer);
+    iDoSwitchDouble2Float(2*line_count, (const double*)line_buffer, (float*)line_buffer);
     break;
   }
 }
 
-static void iFileSwitchToType(imFile* ifile)
+static void iFileSwitchToType(imFile* ifile, void* line_buffer)
 {
   int line_count = imImageLineCount(ifile->width, ifile->file_color_mode);
   switch(ifile->file_data_type)
   {
   case IM_BYTE:    // Destiny is char
-    iDoSwitchInt(line_count, (const imbyte*)ifile->line_buffer, (char*)ifile->line_buffer, -128);
+    iDoSwitchSign(line_count, (imbyte*)line_buffer, (imbyte)0x80);
     break;
   case IM_SHORT:  // Destiny is ushort
-    iDoSwitchInt(line_count, (const short*)ifile->line_buffer, (imushort*)ifile->line_buffer, 32768);
-    break;
   case IM_USHORT:  // Destiny is short
-    iDoSwitchInt(line_count, (const imushort*)ifile->line_buffer, (short*)ifile->line_buffer, -32768);
+    iDoSwitchSign(line_count, (imushort*)line_buffer, (imushort)0x8000);
     break;
   case IM_INT:     // Destiny is uint
-    iDoSwitchInt(line_count, (const int*)ifile->line_buffer, (unsigned int*)ifile->line_buffer, 2147483648);
+    iDoSwitchSign(line_count, (unsigned int*)line_buffer, 0x80000000U);
     break;
   case IM_FLOAT:   // Destiny is double
-    iDoSwitchReal(line_count, (const float*)ifile->line_buffer, (double*)ifile->line_buffer);
+    iDoSwitchFloat2Double(line_count, (const float*)line_buffer, (double*)line_buffer);
     break;
   case IM_CFLOAT:  // Destiny is complex double
-    iDoSwitchReal(2*line_count, (const float*)ifile->line_buffer, (double*)ifile->line_buffer);
+    iDoSwitchFloat2Double(2*line_count, (const float*)line_buffer, (double*)line_buffer);
     break;
   }
 }
 
-void imFileLineBufferWrite(imFile* ifile, const void* data, int line, int plane)
+void imFileLineBufferWriteBuffer(imFile* ifile, const void* data, void* line_buffer, int line, int plane)
 {
   // (writing) from data to file
 
   if (imColorModeIsTopDown(ifile->file_color_mode) != imColorModeIsTopDown(ifile->user_color_mode))
     line = ifile->height-1 - line;
 
+  // when writing lines the data contains only some lines of the image
+  int height = ifile->height;
+  if (ifile->data_line_count)
+  {
+    line -= ifile->data_first_line;
+    height = ifile->data_line_count;
+  }
+
   if ((ifile->file_color_mode & 0x3FF) == 
       (ifile->user_color_mode & 0x3FF)) // compare only packing, alpha and color space, ignore bottom up.
   {
     int data_offset = line*ifile->line_buffer_size;
     if (plane != 0)
-      data_offset += plane*ifile->height*ifile->line_buffer_size;
+      data_offset += plane*height*ifile->line_buffer_size;
 
-    memcpy(ifile->line_buffer, (unsigned char*)data + data_offset, ifile->line_buffer_size);
+    memcpy(line_buffer, (unsigned char*)data + data_offset, ifile->line_buffer_size);
   }
   else
   {
     switch(ifile->file_data_type)
     {
     case IM_BYTE:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane, 
-                        ifile->file_color_mode, (imbyte*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane, 
+                        ifile->file_color_mode, (imbyte*)line_buffer, 
                         ifile->user_color_mode, (const imbyte*)data);
       break;
     case IM_SHORT:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane,  
-                        ifile->file_color_mode, (short*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane,  
+                        ifile->file_color_mode, (short*)line_buffer, 
                         ifile->user_color_mode, (const short*)data);
       break;
     case IM_USHORT:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane,  
-                        ifile->file_color_mode, (imushort*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane,  
+                        ifile->file_color_mode, (imushort*)line_buffer, 
                         ifile->user_color_mode, (const imushort*)data);
       break;
     case IM_INT:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane,  
-                        ifile->file_color_mode, (int*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane,  
+                        ifile->file_color_mode, (int*)line_buffer, 
                         ifile->user_color_mode, (const int*)data);
       break;
     case IM_FLOAT:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane,  
-                        ifile->file_color_mode, (float*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane,  
+                        ifile->file_color_mode, (float*)line_buffer, 
                         ifile->user_color_mode, (const float*)data);
       break;
     case IM_CFLOAT:
-      iDoFillLineBuffer(ifile->width, ifile->height, line, plane,  
-                        ifile->file_color_mode, (imcfloat*)ifile->line_buffer, 
+      iDoFillLineBuffer(ifile->width, height, line, plane,  
+                        ifile->file_color_mode, (imcfloat*)line_buffer, 
                         ifile->user_color_mode, (const imcfloat*)data);
       break;
     }
   }
 
   if (ifile->convert_bpp)
-    iFileCompactBits(ifile);
+    iFileCompactBits(ifile, line_buffer);
 
   if (ifile->switch_type)
-    iFileSwitchToType(ifile);
+    iFileSwitchToType(ifile, line_buffer);
 }
 
-void imFileLineBufferRead(imFile* ifile, void* data, int line, int plane)
+void imFileLineBufferReadBuffer(imFile* ifile, void* line_buffer, void* data, int line, int plane)
 {
   // (reading) from file to data
 
   if (imColorModeIsTopDown(ifile->file_color_mode) != imColorModeIsTopDown(ifile->user_color_mode))
     line = ifile->height-1 - line;
 
+  // when reading lines the data contains only some lines of the image
+  int height = ifile->height;
+  if (ifile->data_line_count)
+  {
+    line -= ifile->data_first_line;
+    height = ifile->data_line_count;
+  }
+
   if (ifile->convert_bpp)
-    iFileExpandBits(ifile);
+    iFileExpandBits(ifile, line_buffer);
 
   if (ifile->switch_type)
-    iFileSwitchFromType(ifile);
+    iFileSwitchFromType(ifile, line_buffer);
 
   if (((ifile->file_color_mode & 0x3FF) == 
       (ifile->user_color_mode & 0x3FF)) && // compare only packing, alpha and color space, ignore bottom up.
@@ -544,9 +1064,9 @@ void imFileLineBufferRead(imFile* ifile, void* data, int line, int plane)
   {
     int data_offset = line*ifile->line_buffer_size;
     if (plane != 0)
-      data_offset += plane*ifile->height*ifile->line_buffer_size;
+      data_offset += plane*height*ifile->line_buffer_size;
 
-    memcpy((unsigned char*)data + data_offset, ifile->line_buffer, ifile->line_buffer_size);
+    memcpy((unsigned char*)data + data_offset, line_buffer, ifile->line_buffer_size);
   }
   else
   {
@@ -562,68 +1082,107 @@ void imFileLineBufferRead(imFile* ifile, void* data, int line, int plane)
     {
     case IM_BYTE:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const imbyte*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const imbyte*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane, 
-                    ifile->file_color_mode, (const imbyte*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane, 
+                    ifile->file_color_mode, (const imbyte*)line_buffer, 
                     ifile->user_color_mode, (imbyte*)data);
       break;
     case IM_SHORT:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const short*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const short*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane,  
-                    ifile->file_color_mode, (const short*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane,  
+                    ifile->file_color_mode, (const short*)line_buffer, 
                     ifile->user_color_mode, (short*)data);
       break;
     case IM_USHORT:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const imushort*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const imushort*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane,  
-                    ifile->file_color_mode, (const imushort*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane,  
+                    ifile->file_color_mode, (const imushort*)line_buffer, 
                     ifile->user_color_mode, (imushort*)data);
       break;
     case IM_INT:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const int*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const int*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane,  
-                    ifile->file_color_mode, (const int*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane,  
+                    ifile->file_color_mode, (const int*)line_buffer, 
                     ifile->user_color_mode, (int*)data);
       break;
     case IM_FLOAT:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const float*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const float*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane,  
-                    ifile->file_color_mode, (const float*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane,  
+                    ifile->file_color_mode, (const float*)line_buffer, 
                     ifile->user_color_mode, (float*)data);
       break;
     case IM_CFLOAT:
       if (convert2bitmap)
-        iDoFillDataBitmap(ifile->width, ifile->height, line, plane, ifile->file_data_type,
-                          ifile->file_color_mode, (const double*)ifile->line_buffer, 
+        iDoFillDataBitmap(ifile->width, height, line, plane, ifile->file_data_type,
+                          ifile->file_color_mode, (const double*)line_buffer, 
                           ifile->user_color_mode, (imbyte*)data);
       else
-        iDoFillData(ifile->width, ifile->height, line, plane,  
-                    ifile->file_color_mode, (const imcfloat*)ifile->line_buffer, 
+        iDoFillData(ifile->width, height, line, plane,  
+                    ifile->file_color_mode, (const imcfloat*)line_buffer, 
                     ifile->user_color_mode, (imcfloat*)data);
       break;
     }
   }
 }
            
+void imFileLineBufferWrite(imFile* ifile, const void* data, int line, int plane)
+{
+  imFileLineBufferWriteBuffer(ifile, data, ifile->line_buffer, line, plane);
+}
+
+void imFileLineBufferRead(imFile* ifile, void* data, int line, int plane)
+{
+  imFileLineBufferReadBuffer(ifile, ifile->line_buffer, data, line, plane);
+}
+
+void* imFileLineBufferDirect(imFile* ifile, void* data, int line, int plane)
+{
+  // (reading) when there is nothing to convert the format can decode directly in the application buffer
+
+  if (ifile->convert_bpp || ifile->switch_type || ifile->line_buffer_extra)
+    return NULL;
+
+  if (((ifile->file_color_mode & 0x3FF) != 
+      (ifile->user_color_mode & 0x3FF)) || // compare only packing, alpha and color space, ignore bottom up.
+      ifile->file_data_type != ifile->user_data_type)
+    return NULL;
+
+  if (imColorModeIsTopDown(ifile->file_color_mode) != imColorModeIsTopDown(ifile->user_color_mode))
+    line = ifile->height-1 - line;
+
+  int height = ifile->height;
+  if (ifile->data_line_count)
+  {
+    line -= ifile->data_first_line;
+    height = ifile->data_line_count;
+  }
+
+  int data_offset = line*ifile->line_buffer_size;
+  if (plane != 0)
+    data_offset += plane*height*ifile->line_buffer_size;
+
+  return (unsigned char*)data + data_offset;
+}
+
 void imFileLineBufferInit(imFile* ifile)
 {
   ifile->line_buffer_size = imImageLineSize(ifile->width, ifile->file_color_mode, ifile->file_data_type);
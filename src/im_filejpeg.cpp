@@ -0,0 +1,420 @@
+/** \file
+ * \brief JPEG Lossless Transformations
+ *
+ * See Copyright Notice in im_lib.h
+ * See libJPEG Copyright Notice in jpeglib.h
+ */
+
+#include "im.h"
+#include "im_jpeg.h"
+#include "im_util.h"
+#include "im_binfile.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <assert.h>
+
+extern "C" {
+#include "jpeglib.h"
+#include "jerror.h"
+}
+
+
+struct iJPEGError
+{
+  jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+};
+
+static void iJPEGErrorExit(j_common_ptr cinfo)
+{
+  iJPEGError* err_mgr = (iJPEGError*)cinfo->err;
+  longjmp(err_mgr->setjmp_buffer, 1);
+}
+
+static void iJPEGOutputMessage(j_common_ptr cinfo)
+{
+  (void)cinfo;
+}
+
+static void iJPEGEmitMessage(j_common_ptr cinfo, int msg_level)
+{
+  (void)cinfo; (void)msg_level;
+}
+
+/* How each transformation maps the destination to the source.
+ * When transposed the destination columns come from the source lines.
+ * reverse_x and reverse_y are relative to the source. */
+static const struct
+{
+  int transpose, reverse_x, reverse_y;
+} iJPEGTransformTable[IM_JPEG_AUTOORIENT] =
+{
+  /* IM_JPEG_NONE */       {0, 0, 0},
+  /* IM_JPEG_FLIP_H */     {0, 1, 0},
+  /* IM_JPEG_FLIP_V */     {0, 0, 1},
+  /* IM_JPEG_TRANSPOSE */  {1, 0, 0},
+  /* IM_JPEG_TRANSVERSE */ {1, 1, 1},
+  /* IM_JPEG_ROT90 */      {1, 0, 1},
+  /* IM_JPEG_ROT180 */     {0, 1, 1},
+  /* IM_JPEG_ROT270 */     {1, 1, 0}
+};
+
+/* Exif Orientation values 1 to 8 */
+static const int iJPEGOrientationTable[9] =
+{
+  IM_JPEG_NONE, IM_JPEG_NONE, IM_JPEG_FLIP_H, IM_JPEG_ROT180, IM_JPEG_FLIP_V,
+  IM_JPEG_TRANSPOSE, IM_JPEG_ROT90, IM_JPEG_TRANSVERSE, IM_JPEG_ROT270
+};
+
+static unsigned int iJPEGGetExif16(const JOCTET* data, int big_endian)
+{
+  if (big_endian)
+    return ((unsigned int)data[0] << 8) | data[1];
+  else
+    return ((unsigned int)data[1] << 8) | data[0];
+}
+
+static unsigned int iJPEGGetExif32(const JOCTET* data, int big_endian)
+{
+  if (big_endian)
+    return (iJPEGGetExif16(data, 1) << 16) | iJPEGGetExif16(data + 2, 1);
+  else
+    return (iJPEGGetExif16(data + 2, 0) << 16) | iJPEGGetExif16(data, 0);
+}
+
+/* Returns the value of the Orientation tag in the first IFD of the Exif marker, or NULL. */
+static JOCTET* iJPEGFindOrientation(jpeg_saved_marker_ptr marker, int *big_endian)
+{
+  for (; marker; marker = marker->next)
+  {
+    if (marker->marker != JPEG_APP0+1 || marker->data_length < 6+8 ||
+        memcmp(marker->data, "Exif\0\0", 6) != 0)
+      continue;
+
+    JOCTET* tiff = marker->data + 6;
+    unsigned int size = marker->data_length - 6;
+
+    if (tiff[0] == 'M' && tiff[1] == 'M')
+      *big_endian = 1;
+    else if (tiff[0] == 'I' && tiff[1] == 'I')
+      *big_endian = 0;
+    else
+      continue;
+
+    unsigned int offset = iJPEGGetExif32(tiff + 4, *big_endian);
+    if (offset > size - 2)
+      continue;
+
+    unsigned int count = iJPEGGetExif16(tiff + offset, *big_endian);
+    offset += 2;
+
+    for (unsigned int i = 0; i < count && offset + 12 <= size; i++, offset += 12)
+    {
+      /* tag 0x0112, type SHORT */
+      if (iJPEGGetExif16(tiff + offset, *big_endian) == 0x0112 &&
+          iJPEGGetExif16(tiff + offset + 2, *big_endian) == 3)
+        return tiff + offset + 8;
+    }
+  }
+
+  return NULL;
+}
+
+static void iJPEGTransposeQuantTables(j_compress_ptr dstinfo)
+{
+  for (int t = 0; t < NUM_QUANT_TBLS; t++)
+  {
+    JQUANT_TBL* qtbl = dstinfo->quant_tbl_ptrs[t];
+    if (!qtbl)
+      continue;
+
+    for (int i = 0; i < DCTSIZE; i++)
+    {
+      for (int j = i+1; j < DCTSIZE; j++)
+      {
+        UINT16 value = qtbl->quantval[i*DCTSIZE + j];
+        qtbl->quantval[i*DCTSIZE + j] = qtbl->quantval[j*DCTSIZE + i];
+        qtbl->quantval[j*DCTSIZE + i] = value;
+      }
+    }
+  }
+}
+
+/* Mirroring the pixels of a block changes the sign of the odd frequencies in that direction. */
+static void iJPEGTransformBlock(JCOEFPTR src, JCOEFPTR dst, int transpose, int negate_col, int negate_row)
+{
+  for (int r = 0; r < DCTSIZE; r++)
+  {
+    for (int c = 0; c < DCTSIZE; c++)
+    {
+      JCOEF value = transpose? src[c*DCTSIZE + r]: src[r*DCTSIZE + c];
+      if (((c & 1) && negate_col) ^ ((r & 1) && negate_row))
+        value = -value;
+      dst[r*DCTSIZE + c] = value;
+    }
+  }
+}
+
+static void iJPEGCopyMarkers(j_decompress_ptr srcinfo, j_compress_ptr dstinfo)
+{
+  for (jpeg_saved_marker_ptr marker = srcinfo->marker_list; marker; marker = marker->next)
+  {
+    /* these are already written by libJPEG */
+    if (dstinfo->write_JFIF_header && marker->marker == JPEG_APP0 &&
+        marker->data_length >= 5 && memcmp(marker->data, "JFIF\0", 5) == 0)
+      continue;
+    if (dstinfo->write_Adobe_marker && marker->marker == JPEG_APP0+14 &&
+        marker->data_length >= 5 && memcmp(marker->data, "Adobe", 5) == 0)
+      continue;
+
+    jpeg_write_marker(dstinfo, marker->marker, marker->data, marker->data_length);
+  }
+}
+
+static int iJPEGTransformFile(const char* src_file_name, const char* dst_file_name, int transform,
+                              int crop, int x, int y, int width, int height)
+{
+  jpeg_decompress_struct srcinfo;
+  jpeg_compress_struct dstinfo;
+  iJPEGError jerr;
+  jvirt_barray_ptr dst_coef[MAX_COMPONENTS];
+  int comp_width[MAX_COMPONENTS], comp_height[MAX_COMPONENTS],   /* size of the region in blocks */
+      comp_x[MAX_COMPONENTS], comp_y[MAX_COMPONENTS];             /* offset of the region in blocks */
+
+  imBinFile* src_handle = imBinFileOpen(src_file_name);
+  if (!src_handle)
+    return IM_ERR_OPEN;
+
+  memset(&srcinfo, 0, sizeof(jpeg_decompress_struct));
+  memset(&dstinfo, 0, sizeof(jpeg_compress_struct));
+
+  srcinfo.err = jpeg_std_error(&jerr.pub);
+  dstinfo.err = &jerr.pub;
+  jerr.pub.error_exit = iJPEGErrorExit;
+  jerr.pub.output_message = iJPEGOutputMessage;
+  jerr.pub.emit_message = iJPEGEmitMessage;
+
+  imBinFile* volatile dst_handle = NULL;
+  volatile int error = IM_ERR_FORMAT;
+
+  if (setjmp(jerr.setjmp_buffer))
+  {
+    jpeg_destroy_compress(&dstinfo);
+    jpeg_destroy_decompress(&srcinfo);
+    if (dst_handle) imBinFileClose(dst_handle);
+    imBinFileClose(src_handle);
+    return error;
+  }
+
+  jpeg_create_decompress(&srcinfo);
+  jpeg_stdio_src(&srcinfo, (FILE*)src_handle);
+
+  jpeg_save_markers(&srcinfo, JPEG_COM, 0xFFFF);
+  for (int m = 0; m < 16; m++)
+    jpeg_save_markers(&srcinfo, JPEG_APP0+m, 0xFFFF);
+
+  jpeg_read_header(&srcinfo, TRUE);
+
+  if (transform == IM_JPEG_AUTOORIENT)
+  {
+    int big_endian;
+    JOCTET* orientation = iJPEGFindOrientation(srcinfo.marker_list, &big_endian);
+    transform = IM_JPEG_NONE;
+    if (orientation)
+    {
+      unsigned int value = iJPEGGetExif16(orientation, big_endian);
+      if (value >= 1 && value <= 8)
+        transform = iJPEGOrientationTable[value];
+
+      /* the saved marker is copied to the new file */
+      orientation[0] = (JOCTET)(big_endian? 0: 1);
+      orientation[1] = (JOCTET)(big_endian? 1: 0);
+    }
+  }
+
+  int transpose = iJPEGTransformTable[transform].transpose;
+  int reverse_x = iJPEGTransformTable[transform].reverse_x;
+  int reverse_y = iJPEGTransformTable[transform].reverse_y;
+
+  /* iMCU size in pixels, a single component is not interleaved */
+  int num_components = srcinfo.num_components;
+  int mcu_width = num_components == 1? DCTSIZE: srcinfo.max_h_samp_factor*DCTSIZE;
+  int mcu_height = num_components == 1? DCTSIZE: srcinfo.max_v_samp_factor*DCTSIZE;
+
+  int image_width = (int)srcinfo.image_width;
+  int image_height = (int)srcinfo.image_height;
+
+  int x0 = 0, y0 = 0, region_width = image_width, region_height = image_height;
+  if (crop)
+  {
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        width > image_width - x || height > image_height - y)
+      error = IM_ERR_DATA;
+
+    x0 = x - x % mcu_width;
+    y0 = y - y % mcu_height;
+    region_width = width + (x - x0);
+    region_height = height + (y - y0);
+  }
+
+  /* partial iMCUs can not be moved, they must stay at the right and bottom edges */
+  if (reverse_x)
+    region_width -= region_width % mcu_width;
+  if (reverse_y)
+    region_height -= region_height % mcu_height;
+
+  if (region_width == 0 || region_height == 0 || srcinfo.block_size != DCTSIZE)
+    error = IM_ERR_DATA;
+
+  if (error == IM_ERR_DATA)
+  {
+    jpeg_destroy_decompress(&srcinfo);
+    imBinFileClose(src_handle);
+    return IM_ERR_DATA;
+  }
+
+  /* the destination arrays must be requested before the source is read, to be realized together */
+  for (int ci = 0; ci < num_components; ci++)
+  {
+    jpeg_component_info* compptr = srcinfo.comp_info + ci;
+    int mcu_blocks_x = num_components == 1? 1: compptr->h_samp_factor;
+    int mcu_blocks_y = num_components == 1? 1: compptr->v_samp_factor;
+
+    comp_width[ci] = (region_width*mcu_blocks_x + mcu_width-1) / mcu_width;
+    comp_height[ci] = (region_height*mcu_blocks_y + mcu_height-1) / mcu_height;
+    comp_x[ci] = (x0 / mcu_width) * mcu_blocks_x;
+    comp_y[ci] = (y0 / mcu_height) * mcu_blocks_y;
+
+    int dst_blocks_x = transpose? mcu_blocks_y: mcu_blocks_x;
+    int dst_blocks_y = transpose? mcu_blocks_x: mcu_blocks_y;
+    int dst_width = transpose? comp_height[ci]: comp_width[ci];
+    int dst_height = transpose? comp_width[ci]: comp_height[ci];
+
+    /* rounded up to complete iMCUs, the padding blocks stay zero */
+    dst_coef[ci] = (*srcinfo.mem->request_virt_barray)((j_common_ptr)&srcinfo, JPOOL_IMAGE, TRUE,
+                                                         (JDIMENSION)(((dst_width + dst_blocks_x-1) / dst_blocks_x) * dst_blocks_x),
+                                                         (JDIMENSION)(((dst_height + dst_blocks_y-1) / dst_blocks_y) * dst_blocks_y),
+                                                         (JDIMENSION)dst_blocks_y);
+  }
+
+  jvirt_barray_ptr* src_coef = jpeg_read_coefficients(&srcinfo);
+
+  /* the source is already in memory, so it can be the same file */
+  dst_handle = imBinFileNew(dst_file_name);
+  if (!dst_handle)
+  {
+    jpeg_destroy_decompress(&srcinfo);
+    imBinFileClose(src_handle);
+    return IM_ERR_OPEN;
+  }
+
+  error = IM_ERR_ACCESS;
+
+  jpeg_create_compress(&dstinfo);
+  jpeg_stdio_dest(&dstinfo, (FILE*)dst_handle);
+
+  jpeg_copy_critical_parameters(&srcinfo, &dstinfo);
+
+  dstinfo.image_width = dstinfo.jpeg_width = (JDIMENSION)(transpose? region_height: region_width);
+  dstinfo.image_height = dstinfo.jpeg_height = (JDIMENSION)(transpose? region_width: region_height);
+
+  for (int ci = 0; ci < num_components; ci++)
+  {
+    jpeg_component_info* compptr = dstinfo.comp_info + ci;
+    if (num_components == 1)
+    {
+      compptr->h_samp_factor = 1;
+      compptr->v_samp_factor = 1;
+    }
+    else if (transpose)
+    {
+      int h_samp_factor = compptr->h_samp_factor;
+      compptr->h_samp_factor = compptr->v_samp_factor;
+      compptr->v_samp_factor = h_samp_factor;
+    }
+  }
+
+  if (transpose)
+    iJPEGTransposeQuantTables(&dstinfo);
+
+  /* parameters that do not affect the coefficients */
+  if (srcinfo.progressive_mode)
+    jpeg_simple_progression(&dstinfo);
+  dstinfo.arith_code = srcinfo.arith_code;
+  dstinfo.optimize_coding = srcinfo.arith_code? FALSE: TRUE;
+
+  jpeg_write_coefficients(&dstinfo, dst_coef);
+
+  iJPEGCopyMarkers(&srcinfo, &dstinfo);
+
+  int negate_col = transpose? reverse_y: reverse_x;
+  int negate_row = transpose? reverse_x: reverse_y;
+
+  for (int ci = 0; ci < num_components; ci++)
+  {
+    int dst_width = transpose? comp_height[ci]: comp_width[ci];
+    int dst_height = transpose? comp_width[ci]: comp_height[ci];
+    JBLOCKARRAY src_row = NULL;
+
+    for (int dst_y = 0; dst_y < dst_height; dst_y++)
+    {
+      JBLOCKARRAY dst_row = (*srcinfo.mem->access_virt_barray)((j_common_ptr)&srcinfo, dst_coef[ci], (JDIMENSION)dst_y, 1, TRUE);
+
+      if (!transpose)
+      {
+        int src_y = comp_y[ci] + (reverse_y? comp_height[ci]-1 - dst_y: dst_y);
+        src_row = (*srcinfo.mem->access_virt_barray)((j_common_ptr)&srcinfo, src_coef[ci], (JDIMENSION)src_y, 1, FALSE);
+      }
+
+      for (int dst_x = 0; dst_x < dst_width; dst_x++)
+      {
+        int src_x;
+        if (transpose)
+        {
+          int src_y = comp_y[ci] + (reverse_y? comp_height[ci]-1 - dst_x: dst_x);
+          src_row = (*srcinfo.mem->access_virt_barray)((j_common_ptr)&srcinfo, src_coef[ci], (JDIMENSION)src_y, 1, FALSE);
+          src_x = comp_x[ci] + (reverse_x? comp_width[ci]-1 - dst_y: dst_y);
+        }
+        else
+          src_x = comp_x[ci] + (reverse_x? comp_width[ci]-1 - dst_x: dst_x);
+
+        iJPEGTransformBlock(src_row[0][src_x], dst_row[0][dst_x], transpose, negate_col, negate_row);
+      }
+    }
+  }
+
+  jpeg_finish_compress(&dstinfo);
+  jpeg_destroy_compress(&dstinfo);
+  imBinFileClose(dst_handle);
+  dst_handle = NULL;
+
+  error = IM_ERR_NONE;
+
+  jpeg_finish_decompress(&srcinfo);
+  jpeg_destroy_decompress(&srcinfo);
+  imBinFileClose(src_handle);
+
+  return IM_ERR_NONE;
+}
+
+int imFileTransformJPEG(const char* src_file_name, const char* dst_file_name, int transform)
+{
+  assert(src_file_name);
+  assert(dst_file_name);
+
+  if (transform < IM_JPEG_NONE || transform > IM_JPEG_AUTOORIENT)
+    return IM_ERR_DATA;
+
+  return iJPEGTransformFile(src_file_name, dst_file_name, transform, 0, 0, 0, 0, 0);
+}
+
+int imFileCropJPEG(const char* src_file_name, const char* dst_file_name, int x, int y, int width, int height)
+{
+  assert(src_file_name);
+  assert(dst_file_name);
+
+  return iJPEGTransformFile(src_file_name, dst_file_name, IM_JPEG_NONE, 1, x, y, width, height);
+}
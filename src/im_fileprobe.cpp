@@ -0,0 +1,422 @@
+/** \file
+ * \brief File Probe
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "im.h"
+#include "im_format.h"
+#include "im_util.h"
+#include "im_attrib.h"
+#include "im_binfile.h"
+#include "im_binbuffer.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/* The header parsers return -1 when the header is not the one expected by the format driver,
+   or when it uses a feature that is only checked by the decoder.
+   Then the file is probed using the format driver. */
+
+/* The header is read in a single block, large segments are skipped with a seek. */
+#define IM_PROBE_BUFFER_SIZE 4096
+
+static int iProbeReadByte(iBinBuffer* buffer)
+{
+  int value;
+  if (!iBinBufferGetByte(buffer, &value))
+    return -1;
+  return value;
+}
+
+/* big endian */
+static int iProbeReadWord(iBinBuffer* buffer, unsigned int* value)
+{
+  imbyte b[2];
+  if (!iBinBufferRead(buffer, b, 2))
+    return 0;
+  *value = (b[0] << 8) | b[1];
+  return 1;
+}
+
+static int iProbeReadDWord(iBinBuffer* buffer, unsigned int* value)
+{
+  imbyte b[4];
+  if (!iBinBufferRead(buffer, b, 4))
+    return 0;
+  *value = ((unsigned int)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+  return 1;
+}
+
+/* Returns 0 if the end of the file is reached. */
+static int iProbeSkip(iBinBuffer* buffer, unsigned long size)
+{
+  unsigned long available = buffer->count - buffer->pos;
+  if (size <= available)
+  {
+    buffer->pos += (int)size;
+    return 1;
+  }
+
+  size -= available;
+  if (size > buffer->remain)
+    return 0;
+
+  imBinFileSeekOffset(buffer->handle, (long)size);
+  buffer->remain -= size;
+  buffer->count = 0;
+  buffer->pos = 0;
+  return 1;
+}
+
+static int iProbeJPEG(iBinBuffer* buffer, imFileProbeInfo* info)
+{
+  imbyte sig[2];
+  if (!iBinBufferRead(buffer, sig, 2) || sig[0] != 0xFF || sig[1] != 0xD8)
+    return -1;
+
+  /* the markers are read up to the start of scan, like jpeg_read_header,
+     the scan data and the markers after it are not checked */
+  int found_sof = 0;
+  for (;;)
+  {
+    /* same as next_marker in libjpeg, skips garbage and fill bytes */
+    int marker;
+    do
+    {
+      do
+      {
+        marker = iProbeReadByte(buffer);
+        if (marker == -1)
+          return -1;
+      } while (marker != 0xFF);
+
+      do
+      {
+        marker = iProbeReadByte(buffer);
+        if (marker == -1)
+          return -1;
+      } while (marker == 0xFF);
+    } while (marker == 0);
+
+    if (marker == 0xDA)   /* SOS */
+      return found_sof? IM_ERR_NONE: -1;
+
+    if (marker == 0xD9)   /* EOI before SOS */
+      return -1;
+
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))  /* markers without parameters */
+      continue;
+
+    unsigned int length;
+    if (!iProbeReadWord(buffer, &length) || length < 2)
+      return -1;
+
+    /* baseline, extended sequential and progressive, Huffman or arithmetic,
+       the others are not supported by libjpeg */
+    if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2 || marker == 0xC9 || marker == 0xCA)
+    {
+      if (found_sof)
+        return -1;
+
+      int precision, num_components;
+      unsigned int height, width;
+      if ((precision = iProbeReadByte(buffer)) == -1 ||
+          !iProbeReadWord(buffer, &height) ||
+          !iProbeReadWord(buffer, &width) ||
+          (num_components = iProbeReadByte(buffer)) == -1 ||
+          length != (unsigned int)(8 + num_components * 3))
+        return -1;
+
+      /* same limits of libjpeg, a zero height is defined later by a DNL marker */
+      if (precision != 8 || width == 0 || height == 0 || width > 65500 || height > 65500)
+        return -1;
+
+      for (int c = 0; c < num_components; c++)
+      {
+        imbyte component[3];  /* id, sampling factors and quantization table */
+        if (!iBinBufferRead(buffer, component, 3))
+          return -1;
+
+        int h_samp = component[1] >> 4, v_samp = component[1] & 15;
+        if (h_samp < 1 || h_samp > 4 || v_samp < 1 || v_samp > 4)
+          return -1;
+      }
+
+      /* the color space used by the JPEG driver does not depend on the markers */
+      if (num_components == 1)
+        info->color_mode = IM_GRAY;
+      else if (num_components == 3)
+        info->color_mode = IM_RGB;
+      else if (num_components == 4)
+        info->color_mode = IM_CMYK;
+      else
+        return -1;
+
+      info->color_mode |= IM_TOPDOWN;
+      if (imColorModeDepth(info->color_mode) > 1)
+        info->color_mode |= IM_PACKED;
+
+      info->width = width;
+      info->height = height;
+      info->data_type = IM_BYTE;
+      info->image_count = 1;
+      found_sof = 1;
+      continue;
+    }
+
+    if ((marker >= 0xC3 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+      return -1;
+
+    if (!iProbeSkip(buffer, length - 2))
+      return -1;
+  }
+}
+
+static int iProbePNG(iBinBuffer* buffer, imFileProbeInfo* info)
+{
+  static const imbyte png_sig[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+  imbyte sig[8];
+  if (!iBinBufferRead(buffer, sig, 8) || memcmp(sig, png_sig, 8) != 0)
+    return -1;
+
+  unsigned int length;
+  char type[4];
+  if (!iProbeReadDWord(buffer, &length) || !iBinBufferRead(buffer, type, 4) || length != 13 || memcmp(type, "IHDR", 4) != 0)
+    return -1;
+
+  unsigned int width, height;
+  imbyte ihdr[5];  /* bit depth, color type, compression, filter and interlace */
+  if (!iProbeReadDWord(buffer, &width) || !iProbeReadDWord(buffer, &height) || !iBinBufferRead(buffer, ihdr, 5))
+    return -1;
+
+  /* same checks of png_check_IHDR */
+  if (width == 0 || height == 0 || width > 1000000 || height > 1000000 ||
+      ihdr[2] != 0 || ihdr[3] != 0 || ihdr[4] > 1)
+    return -1;
+
+  int bit_depth = ihdr[0], color_type = ihdr[1];
+  switch(color_type)
+  {
+  case 0:  /* PNG_COLOR_TYPE_GRAY */
+    if (bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8 && bit_depth != 16)
+      return -1;
+    info->color_mode = IM_GRAY;
+    break;
+  case 3:  /* PNG_COLOR_TYPE_PALETTE */
+    if (bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8)
+      return -1;
+    info->color_mode = IM_MAP;
+    break;
+  case 2:  /* PNG_COLOR_TYPE_RGB */
+  case 4:  /* PNG_COLOR_TYPE_GRAY_ALPHA */
+  case 6:  /* PNG_COLOR_TYPE_RGB_ALPHA */
+    if (bit_depth != 8 && bit_depth != 16)
+      return -1;
+    if (color_type == 2)
+      info->color_mode = IM_RGB;
+    else if (color_type == 4)
+      info->color_mode = IM_GRAY | IM_ALPHA;
+    else
+      info->color_mode = IM_RGB | IM_ALPHA;
+    break;
+  default:
+    return -1;
+  }
+
+  /* same as the PNG driver */
+  if (bit_depth == 16)
+    info->data_type = IM_USHORT;
+  else
+  {
+    if (bit_depth == 1)
+      info->color_mode = IM_BINARY;
+    info->data_type = IM_BYTE;
+  }
+
+  /* the chunks are read up to the image data, like png_read_info,
+     the CRCs, the image data and the chunks after it are not checked */
+  if (!iProbeSkip(buffer, 4))  /* CRC of IHDR */
+    return -1;
+
+  int found_plte = 0;
+  for (;;)
+  {
+    if (!iProbeReadDWord(buffer, &length) || !iBinBufferRead(buffer, type, 4) || length > 0x7FFFFFFF)
+      return -1;
+
+    if (memcmp(type, "IDAT", 4) == 0)
+      break;
+
+    if (memcmp(type, "IEND", 4) == 0 || memcmp(type, "IHDR", 4) == 0)
+      return -1;
+
+    if (memcmp(type, "PLTE", 4) == 0)
+    {
+      /* a palette in the other color types is only a suggestion, leave it to libpng */
+      if (color_type != 3 || found_plte)
+        return -1;
+
+      int palette_count = length / 3;
+      if (length % 3 != 0 || palette_count == 0 || palette_count > (1 << bit_depth))
+        return -1;
+
+      if (info->color_mode == IM_MAP)  /* 1 bit palettes are always binary */
+      {
+        imbyte colors[256 * 3];
+        if (!iBinBufferRead(buffer, colors, length))
+          return -1;
+
+        long palette[256];
+        for (int c = 0; c < 256; c++)
+        {
+          if (c < palette_count)
+            palette[c] = imColorEncode(colors[c*3], colors[c*3+1], colors[c*3+2]);
+          else
+            palette[c] = imColorEncode((imbyte)c, (imbyte)c, (imbyte)c);
+        }
+
+        info->color_mode = imFilePaletteColorMode(info->color_mode, palette, palette_count);
+        length = 0;
+      }
+
+      found_plte = 1;
+    }
+
+    if (!iProbeSkip(buffer, (unsigned long)length + 4))
+      return -1;
+  }
+
+  if (color_type == 3 && !found_plte)
+    return -1;
+
+  info->color_mode |= IM_TOPDOWN;
+  if (imColorModeDepth(info->color_mode) > 1)
+    info->color_mode |= IM_PACKED;
+
+  info->width = width;
+  info->height = height;
+  info->image_count = 1;
+  return IM_ERR_NONE;
+}
+
+static int iProbeHeader(const char* file_name, const char* format, imFileProbeInfo* info)
+{
+  int (*probe)(iBinBuffer* buffer, imFileProbeInfo* info);
+  if (imStrEqual(format, "JPEG"))
+    probe = iProbeJPEG;
+  else if (imStrEqual(format, "PNG"))
+    probe = iProbePNG;
+  else
+    return -1;
+
+  imBinFile* handle = imBinFileOpen(file_name);
+  if (!handle)
+    return IM_ERR_OPEN;
+
+  iBinBuffer buffer;
+  if (!iBinBufferInit(&buffer, handle, IM_PROBE_BUFFER_SIZE))
+  {
+    imBinFileClose(handle);
+    return IM_ERR_MEM;
+  }
+
+  int error = probe(&buffer, info);
+
+  iBinBufferRelease(&buffer);
+  imBinFileClose(handle);
+
+  if (error == IM_ERR_NONE)
+    strcpy(info->format, format);
+
+  return error;
+}
+
+/* Same as imFileOpen, imFileReadImageInfo and imFileClose, without the counter */
+static int iProbeFile(const char* file_name, imFileProbeInfo* info)
+{
+  int error;
+  imFileFormatBase* ifileformat = imFileFormatBaseOpen(file_name, &error);
+  if (!ifileformat)
+    return error;
+
+  imFileClear(ifileformat);
+  ifileformat->attrib_table = new imAttribTable(599);
+  imFileSetBaseAttributes(ifileformat);
+  ifileformat->counter = -1;
+
+  /* some drivers change image_count when reading the image information,
+     so return the value imFileGetInfo returns after imFileOpen */
+  int image_count = ifileformat->image_count;
+
+  if (image_count > 0)
+    error = imFileReadImageInfo(ifileformat, 0, &info->width, &info->height, &info->color_mode, &info->data_type);
+  else
+    error = IM_ERR_DATA;
+
+  if (error == IM_ERR_NONE)
+  {
+    strcpy(info->format, ifileformat->iformat->format);
+    info->image_count = image_count;
+  }
+
+  ifileformat->Close();
+  if (ifileformat->line_buffer) free(ifileformat->line_buffer);
+  delete (imAttribTable*)ifileformat->attrib_table;
+  delete ifileformat;
+
+  return error;
+}
+
+int imFileProbe(const char* file_name, imFileProbeInfo* info)
+{
+  assert(file_name);
+  assert(info);
+
+  memset(info, 0, sizeof(imFileProbeInfo));
+
+  /* the header is parsed only when the format driver that will open the file is known */
+  const imFormat* iformat = imFormatFindFirst(file_name);
+  if (iformat)
+  {
+    int error = iProbeHeader(file_name, iformat->format, info);
+    if (error != -1)
+      return error;
+  }
+
+  memset(info, 0, sizeof(imFileProbeInfo));
+  int error = iProbeFile(file_name, info);
+  if (error != IM_ERR_NONE)
+    memset(info, 0, sizeof(imFileProbeInfo));
+  return error;
+}
+
+void imFileProbeList(const char** file_names, int count, imFileProbeInfo* infos, int* errors)
+{
+  assert(file_names);
+  assert(infos);
+
+  if (count <= 0)
+    return;
+
+  /* also registers the internal formats before the threads start */
+  imFormatFindFirst(file_names[0]);
+
+  int i;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (count > 1)
+#endif
+  for (i = 0; i < count; i++)
+  {
+    int error = imFileProbe(file_names[i], infos + i);
+    if (errors)
+      errors[i] = error;
+  }
+}
@@ -0,0 +1,289 @@
+/** \file
+ * \brief Image File Read-Ahead
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "im.h"
+#include "im_image.h"
+#include "im_util.h"
+
+#include "im_thread.h"
+
+
+struct _imFileReadAhead
+{
+  imFile* ifile;
+  int bitmap;
+
+  int* index_list;
+  int index_count;
+
+  /* loaded images waiting for the application, circular queue */
+  imImage** queue;
+  int* queue_index;
+  int queue_size, queue_start, queue_count;
+
+  /* released images that can be reused */
+  imImage** pool;
+  int pool_size, pool_count;
+
+  int done,      /* thread finished loading, or failed */
+      cancel,    /* application requested to stop */
+      error;
+
+  iMutex mutex;
+  iCondition loaded,    /* signaled when an image is added to the queue or when done */
+             removed;   /* signaled when an image is removed from the queue or when canceled */
+  iThread thread;
+};
+
+static int iReadAheadMatch(imImage* image, int width, int height, int color_space, int has_alpha, int data_type)
+{
+  /* same test of imFileLoadImageFrame */
+  return image->width == width &&
+         image->height == height &&
+         image->depth == imColorModeDepth(color_space) &&
+         image->has_alpha == has_alpha &&
+         image->data_type == data_type;
+}
+
+static imImage* iReadAheadLoad(imFileReadAhead* read_ahead, int index, int *error)
+{
+  imFile* ifile = read_ahead->ifile;
+
+  int width, height, color_mode, data_type;
+  *error = imFileReadImageInfo(ifile, index, &width, &height, &color_mode, &data_type);
+  if (*error)
+    return NULL;
+
+  int color_space = imColorModeSpace(color_mode);
+  if (read_ahead->bitmap)
+  {
+    color_space = imColorModeToBitmap(color_mode);
+    data_type = IM_BYTE;
+  }
+
+  /* look for an image in the pool with the same parameters */
+  imImage* image = NULL;
+  iMutexLock(&read_ahead->mutex);
+  for (int i = 0; i < read_ahead->pool_count; i++)
+  {
+    if (iReadAheadMatch(read_ahead->pool[i], width, height, color_space, imColorModeHasAlpha(color_mode), data_type))
+    {
+      image = read_ahead->pool[i];
+      read_ahead->pool[i] = read_ahead->pool[read_ahead->pool_count-1];
+      read_ahead->pool_count--;
+      break;
+    }
+  }
+  iMutexUnlock(&read_ahead->mutex);
+
+  if (!image)
+  {
+    if (read_ahead->bitmap)
+      return imFileLoadBitmap(ifile, index, error);
+    else
+      return imFileLoadImage(ifile, index, error);
+  }
+
+  if (read_ahead->bitmap)
+    imFileLoadBitmapFrame(ifile, index, image, error);
+  else
+    imFileLoadImageFrame(ifile, index, image, error);
+
+  if (*error)
+  {
+    imImageDestroy(image);
+    return NULL;
+  }
+
+  return image;
+}
+
+static void iReadAheadRun(imFileReadAhead* read_ahead)
+{
+  for (int i = 0; i < read_ahead->index_count; i++)
+  {
+    iMutexLock(&read_ahead->mutex);
+    while (read_ahead->queue_count == read_ahead->queue_size && !read_ahead->cancel)
+      iConditionWait(&read_ahead->removed, &read_ahead->mutex);
+    int cancel = read_ahead->cancel;
+    iMutexUnlock(&read_ahead->mutex);
+
+    if (cancel)
+      break;
+
+    int error;
+    int index = read_ahead->index_list[i];
+    imImage* image = iReadAheadLoad(read_ahead, index, &error);
+
+    iMutexLock(&read_ahead->mutex);
+    if (image)
+    {
+      int pos = (read_ahead->queue_start + read_ahead->queue_count) % read_ahead->queue_size;
+      read_ahead->queue[pos] = image;
+      read_ahead->queue_index[pos] = index;
+      read_ahead->queue_count++;
+    }
+    else
+      read_ahead->error = error? error: IM_ERR_MEM;
+    iConditionSignal(&read_ahead->loaded);
+    iMutexUnlock(&read_ahead->mutex);
+
+    if (!image)
+      break;
+  }
+
+  iMutexLock(&read_ahead->mutex);
+  read_ahead->done = 1;
+  iConditionSignal(&read_ahead->loaded);
+  iMutexUnlock(&read_ahead->mutex);
+}
+
+IM_THREAD_PROC(iReadAheadThread, param)
+{
+  iReadAheadRun((imFileReadAhead*)param);
+  return IM_THREAD_RETURN;
+}
+
+static void iReadAheadDestroy(imFileReadAhead* read_ahead)
+{
+  int i;
+  for (i = 0; i < read_ahead->queue_count; i++)
+    imImageDestroy(read_ahead->queue[(read_ahead->queue_start + i) % read_ahead->queue_size]);
+  for (i = 0; i < read_ahead->pool_count; i++)
+    imImageDestroy(read_ahead->pool[i]);
+
+  iConditionDestroy(&read_ahead->removed);
+  iConditionDestroy(&read_ahead->loaded);
+  iMutexDestroy(&read_ahead->mutex);
+
+  free(read_ahead->index_list);
+  free(read_ahead->queue);
+  free(read_ahead->queue_index);
+  free(read_ahead->pool);
+  free(read_ahead);
+}
+
+imFileReadAhead* imFileReadAheadStart(imFile* ifile, const int* index_list, int index_count, int queue_size, int bitmap)
+{
+  assert(ifile);
+
+  int image_count;
+  imFileGetInfo(ifile, NULL, NULL, &image_count);
+
+  if (!index_list)
+    index_count = image_count;
+
+  if (index_count <= 0)
+    return NULL;
+
+  if (queue_size < 1)
+    queue_size = 1;
+
+  imFileReadAhead* read_ahead = (imFileReadAhead*)malloc(sizeof(imFileReadAhead));
+  if (!read_ahead)
+    return NULL;
+  memset(read_ahead, 0, sizeof(imFileReadAhead));
+
+  read_ahead->ifile = ifile;
+  read_ahead->bitmap = bitmap;
+  read_ahead->index_count = index_count;
+  read_ahead->queue_size = queue_size;
+  /* the application may hold one image while the queue is full */
+  read_ahead->pool_size = queue_size + 1;
+
+  read_ahead->index_list = (int*)malloc(index_count*sizeof(int));
+  read_ahead->queue = (imImage**)malloc(queue_size*sizeof(imImage*));
+  read_ahead->queue_index = (int*)malloc(queue_size*sizeof(int));
+  read_ahead->pool = (imImage**)malloc(read_ahead->pool_size*sizeof(imImage*));
+  if (!read_ahead->index_list || !read_ahead->queue || !read_ahead->queue_index || !read_ahead->pool)
+  {
+    free(read_ahead->index_list);
+    free(read_ahead->queue);
+    free(read_ahead->queue_index);
+    free(read_ahead->pool);
+    free(read_ahead);
+    return NULL;
+  }
+
+  for (int i = 0; i < index_count; i++)
+    read_ahead->index_list[i] = index_list? index_list[i]: i;
+
+  iMutexInit(&read_ahead->mutex);
+  iConditionInit(&read_ahead->loaded);
+  iConditionInit(&read_ahead->removed);
+
+  if (!iThreadCreate(&read_ahead->thread, iReadAheadThread, read_ahead))
+  {
+    iReadAheadDestroy(read_ahead);
+    return NULL;
+  }
+
+  return read_ahead;
+}
+
+imImage* imFileReadAheadNext(imFileReadAhead* read_ahead, int *index, int *error)
+{
+  assert(read_ahead);
+
+  imImage* image = NULL;
+
+  iMutexLock(&read_ahead->mutex);
+  while (read_ahead->queue_count == 0 && !read_ahead->done)
+    iConditionWait(&read_ahead->loaded, &read_ahead->mutex);
+
+  if (read_ahead->queue_count)
+  {
+    image = read_ahead->queue[read_ahead->queue_start];
+    if (index) *index = read_ahead->queue_index[read_ahead->queue_start];
+    read_ahead->queue_start = (read_ahead->queue_start + 1) % read_ahead->queue_size;
+    read_ahead->queue_count--;
+    iConditionSignal(&read_ahead->removed);
+    *error = IM_ERR_NONE;
+  }
+  else
+    *error = read_ahead->error;  /* IM_ERR_NONE at the end */
+  iMutexUnlock(&read_ahead->mutex);
+
+  return image;
+}
+
+void imFileReadAheadRelease(imFileReadAhead* read_ahead, imImage* image)
+{
+  assert(read_ahead);
+
+  if (!image)
+    return;
+
+  iMutexLock(&read_ahead->mutex);
+  if (read_ahead->pool_count < read_ahead->pool_size)
+  {
+    read_ahead->pool[read_ahead->pool_count] = image;
+    read_ahead->pool_count++;
+    image = NULL;
+  }
+  iMutexUnlock(&read_ahead->mutex);
+
+  if (image)
+    imImageDestroy(image);
+}
+
+void imFileReadAheadStop(imFileReadAhead* read_ahead)
+{
+  assert(read_ahead);
+
+  iMutexLock(&read_ahead->mutex);
+  read_ahead->cancel = 1;
+  iConditionSignal(&read_ahead->removed);
+  iMutexUnlock(&read_ahead->mutex);
+
+  iThreadJoin(&read_ahead->thread);
+
+  iReadAheadDestroy(read_ahead);
+}
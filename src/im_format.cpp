@@ -15,40 +15,76 @@
 #include "im_format.h"
 #include "im_util.h"
 
+#include "im_thread.h"
 
-static imFormat* iFormatList[50];
+
+#define IM_MAX_FORMATS 50
+
+/* The list only grows while the formats are in use. 
+   A new entry is stored before the count is updated, so the list can be read without a lock. */
+static imFormat* iFormatList[IM_MAX_FORMATS];
 static int iFormatCount = 0;
 static int iFormatRegistredAll = 0;
+static iMutex iFormatMutex = IM_MUTEX_INITIALIZER;      /* serializes imFormatRegister */
+static iMutex iFormatInitMutex = IM_MUTEX_INITIALIZER;  /* registers the internal formats only once */
 
 void imFormatRemoveAll(void)
 {
-  for (int i = 0; i < iFormatCount; i++)
+  iMutexLock(&iFormatInitMutex);
+  iMutexLock(&iFormatMutex);
+  int count = iFormatCount;
+  iAtomicStore(&iFormatCount, 0);
+  iAtomicStore(&iFormatRegistredAll, 0);
+  for (int i = 0; i < count; i++)
   {
     imFormat* iformat = iFormatList[i];
     delete iformat;
     iFormatList[i] = NULL;
   }
-  iFormatCount = 0;
-  iFormatRegistredAll = 0;
+  iMutexUnlock(&iFormatMutex);
+  iMutexUnlock(&iFormatInitMutex);
 }
 
 void imFormatRegister(imFormat* iformat)
 {
-  iFormatList[iFormatCount] = iformat;
-  iFormatCount++;
+  iMutexLock(&iFormatMutex);
+  int count = iFormatCount;
+  if (count < IM_MAX_FORMATS)
+  {
+    iFormatList[count] = iformat;
+    iAtomicStore(&iFormatCount, count+1);
+    iformat = NULL;
+  }
+  iMutexUnlock(&iFormatMutex);
+
+  if (iformat)  /* list is full */
+    delete iformat;
+}
+
+/* Registers the internal formats in the first call. Returns the number of registered formats. */
+static int iFormatRegisterAll(void)
+{
+  if (!iAtomicLoad(&iFormatRegistredAll))
+  {
+    iMutexLock(&iFormatInitMutex);
+    if (!iFormatRegistredAll)
+    {
+      imFormatRegisterInternal();
+      iAtomicStore(&iFormatRegistredAll, 1);
+    }
+    iMutexUnlock(&iFormatInitMutex);
+  }
+
+  return iAtomicLoad(&iFormatCount);
 }
 
 static imFormat* iFormatFind(const char* format)
 {
   assert(format);
 
-  if (!iFormatRegistredAll) 
-  {
-    imFormatRegisterInternal();
-    iFormatRegistredAll = 1;
-  }
+  int format_count = iFormatRegisterAll();
 
-  for (int i = 0; i < iFormatCount; i++)
+  for (int i = 0; i < format_count; i++)
   {
     imFormat* iformat = iFormatList[i];
     if (imStrEqual(format, iformat->format))
@@ -62,20 +98,12 @@ void imFormatList(char** format_list, int *format_count)
   assert(format_list);
   assert(format_count);
 
-  if (!iFormatRegistredAll) 
-  {
-    imFormatRegisterInternal();
-    iFormatRegistredAll = 1;
-  }
-
-  static char format_list_buffer[50][50];
-
-  *format_count = iFormatCount;
-  for (int i = 0; i < iFormatCount; i++)
+  /* the identifiers are owned by the formats, so there is no shared buffer */
+  *format_count = iFormatRegisterAll();
+  for (int i = 0; i < *format_count; i++)
   {
     imFormat* iformat = iFormatList[i];
-    strcpy(format_list_buffer[i], iformat->format);
-    format_list[i] = format_list_buffer[i];
+    format_list[i] = (char*)iformat->format;
   }
 }
 
@@ -108,15 +136,12 @@ int imFormatCompressions(const char* format, char** comp, int *comp_count, int c
 
   int count = 0;
 
-  static char comp_buffer[50][50];
-
   for (int i = 0; i < iformat->comp_count; i++)
   {
     if (color_mode == -1 || data_type == -1 || 
         iformat->CanWrite(iformat->comp[i], color_mode, data_type) == IM_ERR_NONE)
     {
-      strcpy(comp_buffer[count], iformat->comp[i]);
-      comp[count] = comp_buffer[count];
+      comp[count] = (char*)iformat->comp[i];
       count++;
     }
   }
@@ -143,7 +168,7 @@ static char* utlFileGetExt(const char *file_name)
 
   // Starts at the last character
   int offset = len - 1;
-  while (offset != 0)
+  while (offset > 0)
   {
     // if found a path separator, no extension found
     if (file_name[offset] == '\\' || file_name[offset] == '/')
@@ -158,8 +183,8 @@ static char* utlFileGetExt(const char *file_name)
     offset--;
   }
 
-  // if at the first character, no extension found
-  if (offset == 0) 
+  // if at the first character or empty, no extension found
+  if (offset <= 0) 
     return NULL;
 
   int ext_size = len - offset + 1;
@@ -179,20 +204,16 @@ imFileFormatBase* imFileFormatBaseOpen(const char* file_name, int *error)
   assert(file_name);
   assert(error);
 
-  if (!iFormatRegistredAll) 
-  {
-    imFormatRegisterInternal();
-    iFormatRegistredAll = 1;
-  }
+  int format_count = iFormatRegisterAll();
 
-  int* ext_mark = new int [iFormatCount];
-  memset(ext_mark, 0, sizeof(int)*iFormatCount);
+  int* ext_mark = new int [format_count];
+  memset(ext_mark, 0, sizeof(int)*format_count);
 
   // Search for the extension first, this usually is going to speed the search
   char* extension = utlFileGetExt(file_name);
   if (extension)
   {
-    for(i = 0; i < iFormatCount; i++)
+    for(i = 0; i < format_count; i++)
     {
       imFormat* iformat = iFormatList[i];
 
@@ -229,7 +250,7 @@ imFileFormatBase* imFileFormatBaseOpen(const char* file_name, int *error)
   // If the search did not work, try all the formats
   // except those already tested.
 
-  for(i = 0; i < iFormatCount; i++)
+  for(i = 0; i < format_count; i++)
   {
     if (!ext_mark[i])
     {
@@ -260,20 +281,42 @@ imFileFormatBase* imFileFormatBaseOpen(const char* file_name, int *error)
   return NULL;
 }
 
-imFileFormatBase* imFileFormatBaseOpenAs(const char* file_name, const char* format, int *error)
+const imFormat* imFormatFindFirst(const char* file_name)
 {
   assert(file_name);
-  assert(format);
-  assert(error);
 
-  if (!iFormatRegistredAll) 
+  int format_count = iFormatRegisterAll();
+  if (format_count == 0)
+    return NULL;
+
+  // Same order used by imFileFormatBaseOpen
+  char* extension = utlFileGetExt(file_name);
+  if (extension)
   {
-    imFormatRegisterInternal();
-    iFormatRegistredAll = 1;
+    for(int i = 0; i < format_count; i++)
+    {
+      imFormat* iformat = iFormatList[i];
+      if (strstr(iformat->ext, extension) != NULL)
+      {
+        free(extension);
+        return iformat;
+      }
+    }
+
+    free(extension);
   }
 
+  return iFormatList[0];
+}
+
+imFileFormatBase* imFileFormatBaseOpenAs(const char* file_name, const char* format, int *error)
+{
+  assert(file_name);
+  assert(format);
+  assert(error);
+
   imFormat* iformat = iFormatFind(format);
-  if (!format)
+  if (!iformat)
   {
     *error = IM_ERR_FORMAT;
     return NULL;
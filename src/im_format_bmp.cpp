@@ -10,6 +10,8 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
+#include "im_rle.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -81,53 +83,56 @@
 /*  1   rgbReserved;  Reserved (should be 0) */
 /*  4  */
 
-static int iBMPDecodeScanLine(imBinFile* handle, unsigned char* DecodedBuffer, int Width)
+static int iBMPDecodeScanLine(iBinBuffer* buffer, unsigned char* DecodedBuffer, int Width, int *EndOfBitmap)
 {
-  unsigned char runCount;   /* Number of pixels in the run  */
-  unsigned char runValue;   /* Value of pixels in the run   */
-  int Index = 0;            /* The index of DecodedBuffer   */
-  int cont = 1, remain;
+  int runCount;   /* Number of pixels in the run  */
+  int runValue;   /* Value of pixels in the run   */
+  int Index = 0;  /* The index of DecodedBuffer   */
+  int size;
 
-  while (cont)
+  if (*EndOfBitmap)
   {
-    imBinFileRead(handle, &runCount, 1, 1);  /* Number of pixels in the run */
-    imBinFileRead(handle, &runValue, 1, 1);  /* Value of pixels in the run  */
+    memset(DecodedBuffer, 0, Width);
+    return IM_ERR_NONE;
+  }
 
-    if (imBinFileError(handle))
+  for (;;)
+  {
+    if (!iBinBufferGetByte(buffer, &runCount) ||  /* Number of pixels in the run */
+        !iBinBufferGetByte(buffer, &runValue))    /* Value of pixels in the run  */
       return IM_ERR_ACCESS;
 
     if (runCount)
     {
-      while (runCount-- && Index < Width)
-        DecodedBuffer[Index++] = runValue;
+      if (runCount > Width - Index)
+        runCount = Width - Index;
+      memset(DecodedBuffer + Index, runValue, runCount);
+      Index += runCount;
     }
     else  /* Abssolute Mode or Escape Code */
     {
       switch(runValue)
       {
-      case 0:             /* End of Scan Line Escape Code */
       case 1:             /* End of Bitmap Escape Code */
-        cont = 0;
-        break;
+        *EndOfBitmap = 1;
+        /* fall through */
+      case 0:             /* End of Scan Line Escape Code */
+        return IM_ERR_NONE;
       case 2:             /* Delta Escape Code (ignored) */
-        imBinFileRead(handle, &runCount, 1, 1);
-        imBinFileRead(handle, &runCount, 1, 1);  
+        if (!iBinBufferSkip(buffer, 2))
+          return IM_ERR_ACCESS;
         break;
-      default:            /* Abssolute Mode */
-        remain = runValue % 2;
-        runValue = (unsigned char)(Index + runValue < (Width + 1)? runValue: (Width - 1) - Index);
-        imBinFileRead(handle, DecodedBuffer + Index, runValue, 1);
-        if (remain) 
-          imBinFileSeekOffset(handle, 1);
-        Index += runValue;
+      default:            /* Abssolute Mode, padded to 2 bytes */
+        size = runValue;
+        if (size > Width - Index)
+          size = Width - Index;
+        if (!iBinBufferRead(buffer, DecodedBuffer + Index, size) ||
+            !iBinBufferSkip(buffer, runValue - size + runValue % 2))
+          return IM_ERR_ACCESS;
+        Index += size;
       }
     }
-
-    if (imBinFileError(handle) || Index > Width)
-      return IM_ERR_ACCESS;
   }
-
-  return IM_ERR_NONE;
 }
 
 static int iBMPEncodeScanLine(unsigned char* EncodedBuffer, unsigned char* sl, int np)
@@ -169,15 +174,11 @@ static int iBMPEncodeScanLine(unsigned char* EncodedBuffer, unsigned char* sl, i
       /* sl[slx] == first pixel of run */
       /* sl[slx] == sl[slx + 1] */
 
-      count = 2;
       pixel = sl[slx];
-      slx += 2;
-
-      while ((slx < np) && (pixel == sl[slx]) && (count < 255)) 
-      {
-        count++;
-        slx++;
-      }
+      count = np - slx - 2;
+      if (count > 253) count = 253;
+      count = 2 + iRLERepeatCount(sl + slx + 1, 1, count);
+      slx += count;
 
       *EncodedBuffer++ = (unsigned char)count; 
       BufSize++;
@@ -289,7 +290,8 @@ class imFileFormatBMP: public imFileFormatBase
   unsigned int offset,        /* image data offset, used only when reading */
                comp_type;     /* bmp compression information */
   int is_os2,                 /* indicates an os2 1.x BMP */
-      line_raw_size;              // raw line size
+      line_raw_size,              // raw line size
+      end_of_bitmap;              /* RLE end of bitmap found, used only when reading */
   unsigned int rmask, gmask, bmask, 
                 roff, goff, boff; /* pixel bit mask control when reading 16 and 32 bpp images */
 
@@ -307,8 +309,10 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
 };
 
 class imFormatBMP: public imFormat
@@ -855,12 +859,27 @@ void imFileFormatBMP::FixRGBOrder()
 
 int imFileFormatBMP::ReadImageData(void* data)
 {
-  imCounterTotal(this->counter, this->height, "Reading BMP...");
+  return ReadImageLines(data, 0, this->height);
+}
 
-  /* jump to the begin of image data */
-  imBinFileSeekTo(handle, this->offset);
+int imFileFormatBMP::ReadImageLines(void* data, int first_line, int count)
+{
+  if (first_line == 0)
+  {
+    imCounterTotal(this->counter, this->height, "Reading BMP...");
 
-  for (int row = 0; row < this->height; row++)
+    /* jump to the begin of image data */
+    imBinFileSeekTo(handle, this->offset);
+    this->end_of_bitmap = 0;
+  }
+
+  /* an encoded line is usually smaller than twice the raw line */
+  iBinBuffer buffer = {0};
+  int buffer_size = IM_MIN(IM_BINBUFFER_SIZE, count * (2*this->line_raw_size + 4));
+  if (this->comp_type != BMP_COMPRESS_RGB && !iBinBufferInit(&buffer, handle, buffer_size))
+    return IM_ERR_MEM;
+
+  for (int row = first_line; row < first_line + count; row++)
   {
     /* read and decompress the data */
     if (this->comp_type == BMP_COMPRESS_RGB)
@@ -872,8 +891,11 @@ int imFileFormatBMP::ReadImageData(void* data)
     }
     else
     {
-      if (iBMPDecodeScanLine(handle, (imbyte*)this->line_buffer, this->width) == IM_ERR_ACCESS)
+      if (iBMPDecodeScanLine(&buffer, (imbyte*)this->line_buffer, this->width, &this->end_of_bitmap) == IM_ERR_ACCESS)
+      {
+        iBinBufferRelease(&buffer);
         return IM_ERR_ACCESS;     
+      }
     }
 
     if (this->bpp > 8)
@@ -882,7 +904,18 @@ int imFileFormatBMP::ReadImageData(void* data)
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
+    {
+      if (this->comp_type != BMP_COMPRESS_RGB)
+        iBinBufferRelease(&buffer);
       return IM_ERR_COUNTER;
+    }
+  }
+
+  if (this->comp_type != BMP_COMPRESS_RGB)
+  {
+    /* the next lines start after the consumed data */
+    iBinBufferSync(&buffer);
+    iBinBufferRelease(&buffer);
   }
 
   return IM_ERR_NONE;
@@ -890,13 +923,19 @@ int imFileFormatBMP::ReadImageData(void* data)
 
 int imFileFormatBMP::WriteImageData(void* data)
 {
-  imCounterTotal(this->counter, this->height, "Writing BMP...");
+  return WriteImageLines(data, 0, this->height);
+}
+
+int imFileFormatBMP::WriteImageLines(void* data, int first_line, int count)
+{
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->height, "Writing BMP...");
 
   imbyte* compressed_buffer = NULL;
   if (this->comp_type == BMP_COMPRESS_RLE8) // point to the extra buffer
     compressed_buffer = (imbyte*)this->line_buffer + this->line_buffer_size+4;
 
-  for (int row = 0; row < this->height; row++)
+  for (int row = first_line; row < first_line + count; row++)
   {
     imFileLineBufferWrite(this, data, row, 0);
 
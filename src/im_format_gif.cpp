@@ -24,7 +24,6 @@ static const int InterlacedOffset[4] = { 0, 4, 2, 1 },  /* The way Interlaced im
 #define GIF_LZ_BITS		12
 
 #define GIF_LZ_MAX_CODE	    4095		/* Biggest code possible in 12 bits. */
-#define GIF_FLUSH_OUTPUT		4096    /* Impossible code, to signal flush. */
 #define GIF_FIRST_CODE		  4097    /* Impossible code, to signal first. */
 #define GIF_NO_SUCH_CODE		4098    /* Impossible code, to signal empty. */
 
@@ -33,6 +32,8 @@ static const int InterlacedOffset[4] = { 0, 4, 2, 1 },  /* The way Interlaced im
 #define GIF_HT_MAX_KEY		  8191	  /* 13bits - 1, maximal code possible */
 #define GIF_HT_SIZE			    8192	  /* 12bits = 4096 or twice as big! */
 
+#define GIF_OUT_SIZE        (64*256)  /* 64 sub-blocks of 255 bytes plus its size byte */
+
 /*  GIF89 extension function codes                                             */
 #define COMMENT_EXT_FUNC_CODE	    0xFE	/* comment */
 #define GRAPHICS_EXT_FUNC_CODE    0xF9	/* graphics control */
@@ -63,94 +64,76 @@ struct iGIFData
 	    RunningCode,		   /* The next code algorithm can generate. */
 	    RunningBits,       /* The number of bits required to represent RunningCode. */
 	    MaxCode1,          /* 1 bigger than max. possible code, in RunningBits bits. */
-	    LastCode,		       /* The code before the current code. */
 	    CrntCode,				   /* Current algorithm code. */
-	    StackPtr,		       /* For character stack (see below). */
-	    CrntShiftState;		 /* Number of bits in CrntShiftDWord. */
-  unsigned char Buf[256];	                  /* Compressed input is buffered here. */
+	    CrntShiftState,		 /* Number of bits in CrntShiftDWord. */
+      OutPos,            /* Next byte in OutBuf. */
+      OutBlock;          /* Size byte of the current sub-block in OutBuf. */
   unsigned int CrntShiftDWord;             /* For bytes decomposition into codes. */
-  unsigned char Stack[GIF_LZ_MAX_CODE];	    /* Decoded pixels are stacked here. */
-  unsigned char Suffix[GIF_LZ_MAX_CODE+1];	/* So we can trace the codes. */
-  unsigned int Prefix[GIF_LZ_MAX_CODE+1];
-  unsigned int HTable[GIF_HT_SIZE];            /* hash table for the compression only, when using LZW */
-};
 
-/******************************************************************************
-* Routine to generate an HKey for the hashtable out of the given unique key.  *
-* The given Key is assumed to be 20 bits as follows: lower 8 bits are the     *
-* new postfix character, while the upper 12 bits are the prefix code.	      *
-* Because the average hit ratio is only 2 (2 hash references per entry),      *
-* evaluating more complex keys (such as twin prime keys) does not worth it!   *
-******************************************************************************/
-static int iGIFHashKeyItem(unsigned int Item)
-{
-  return ((Item >> 12) ^ Item) & GIF_HT_KEY_MASK;
-}
+  /* Decoding tables. Each code is a string of Length pixels, 
+     the string of its Prefix code followed by its Suffix pixel. */
+  unsigned short Prefix[GIF_LZ_MAX_CODE+1];
+  unsigned short Length[GIF_LZ_MAX_CODE+1];
+  unsigned char Suffix[GIF_LZ_MAX_CODE+1];
+  unsigned char First[GIF_LZ_MAX_CODE+1];     /* First pixel of the string */
+
+  unsigned int HTable[GIF_HT_SIZE];          /* hash table for the compression only, when using LZW */
+  unsigned char OutBuf[GIF_OUT_SIZE];        /* Compressed output is buffered here already split in sub-blocks. */
+
+  unsigned char* data_buf;  /* all the compressed data of the image when reading */
+  int data_alloc;
+
+  unsigned char *frame,     /* all the image pixels */
+                *prev_frame;/* pixels of the previous image when writing difference frames */
+  int frame_alloc,
+      prev_valid,
+      prev_x, prev_y,
+      prev_width, prev_height,
+      prev_palette_count;
+  long prev_palette[256];
+};
 
 /******************************************************************************
-* Routine to insert a new Item into the HashTable. The data is assumed to be  *
-* new one.								      *
+*   This routines buffers the given characters in sub-blocks of 255 bytes,    *
+* with the first byte as its size, as GIF format requires. Several            *
+* sub-blocks are dumped at once.                                              *
 ******************************************************************************/
-static void iGIFInsertHashTable(unsigned int *HTable, unsigned int Key, int Code)
+static inline void iGIFBufferedOutput(iGIFData* igif, imBinFile* handle, unsigned char c)
 {
-  int HKey = iGIFHashKeyItem(Key);
+  igif->OutBuf[igif->OutPos++] = c;
 
-  while (GIF_HT_GET_KEY(HTable[HKey]) != 0xFFFFFL) 
+  if (igif->OutPos - igif->OutBlock == 256) 
   {
-    HKey = (HKey + 1) & GIF_HT_KEY_MASK;
-  }
-
-  HTable[HKey] = GIF_HT_PUT_KEY(Key) | GIF_HT_PUT_CODE(Code);
-}
+    /* This sub-block is full */
+    igif->OutBuf[igif->OutBlock] = 255;
+    igif->OutBlock = igif->OutPos;
 
-/******************************************************************************
-* Routine to test if given Key exists in HashTable and if so returns its code *
-* Returns the Code if key was found, -1 if not.				      *
-******************************************************************************/
-static int iGIFExistsHashTable(unsigned int *HTable, unsigned int Key)
-{
-  int HKey = iGIFHashKeyItem(Key);
-  unsigned int HTKey;
-
-  while ((HTKey = GIF_HT_GET_KEY(HTable[HKey])) != 0xFFFFFL) 
-  {
-    if (Key == HTKey) 
-      return GIF_HT_GET_CODE(HTable[HKey]);
+    if (igif->OutBlock == GIF_OUT_SIZE)
+    {
+      imBinFileWrite(handle, igif->OutBuf, GIF_OUT_SIZE, 1);
+      igif->OutBlock = 0;
+    }
 
-    HKey = (HKey + 1) & GIF_HT_KEY_MASK;
+    igif->OutPos = igif->OutBlock + 1;
   }
-
-  return -1;
 }
 
-/******************************************************************************
-*   This routines buffers the given characters until 255 characters are ready *
-* to be output. If Code is equal to -1 the buffer is flushed (EOF).	      *
-*   The buffer is Dumped with first byte as its size, as GIF format requires. *
-******************************************************************************/
-static int iGIFBufferedOutput(imBinFile* handle, unsigned char *Buf, int c)
+static int iGIFBufferedOutputFlush(iGIFData* igif, imBinFile* handle)
 {
-  if (c == GIF_FLUSH_OUTPUT) 
+  int size = igif->OutPos - igif->OutBlock - 1;
+  if (size)
   {
-    /* Flush everything out. */
-    if (Buf[0] != 0)
-      imBinFileWrite(handle, Buf, Buf[0] + 1, 1);
-
-    /* Mark end of compressed data, by an empty block (see GIF doc): */
-    Buf[0] = 0;
-    imBinFileWrite(handle, Buf, 1, 1);
+    igif->OutBuf[igif->OutBlock] = (unsigned char)size;
+    igif->OutBlock = igif->OutPos;
   }
-  else 
-  {
-    if (Buf[0] == 255) 
-    {
-      /* Dump out this buffer - it is full: */
-      imBinFileWrite(handle, Buf, Buf[0] + 1, 1);
-      Buf[0] = 0;
-    }
 
-    Buf[++Buf[0]] = (unsigned char)c;
-  }
+  /* Mark end of compressed data, by an empty block (see GIF doc): */
+  igif->OutBuf[igif->OutBlock++] = 0;
+
+  imBinFileWrite(handle, igif->OutBuf, igif->OutBlock, 1);
+
+  igif->OutBlock = 0;
+  igif->OutPos = 1;
 
   if (imBinFileError(handle))
     return IM_ERR_ACCESS;
@@ -195,43 +178,38 @@ static int iGIFWriteNetscapeApplication(imBinFile* handle, short iterations)
 *   This routine is responsable for the compression of the bit stream into    *
 * 8 bits (bytes) packets.						      *
 ******************************************************************************/
-static int iGIFCompressOutput(iGIFData* igif, imBinFile* handle, int Code)
+static inline void iGIFCompressOutput(iGIFData* igif, imBinFile* handle, int Code)
 {
-  int error = IM_ERR_NONE;
-
-  if (Code == GIF_FLUSH_OUTPUT) 
+  igif->CrntShiftDWord |= ((unsigned int) Code) << igif->CrntShiftState;
+  igif->CrntShiftState += igif->RunningBits;
+  while (igif->CrntShiftState >= 8) 
   {
-    while (igif->CrntShiftState > 0) 
-    {
-      /* Get Rid of what is left in DWord, and flush it. */
-      error = iGIFBufferedOutput(handle, igif->Buf, igif->CrntShiftDWord & 0xff);
-      igif->CrntShiftDWord >>= 8;
-      igif->CrntShiftState -= 8;
-    }
-    igif->CrntShiftState = 0;			   /* For next time. */
-    error = iGIFBufferedOutput(handle, igif->Buf, GIF_FLUSH_OUTPUT);
+    /* Dump out full bytes: */
+    iGIFBufferedOutput(igif, handle, (unsigned char)(igif->CrntShiftDWord & 0xff));
+    igif->CrntShiftDWord >>= 8;
+    igif->CrntShiftState -= 8;
   }
-  else 
+
+  /* If code cannt fit into RunningBits bits, must raise its size. */
+  if (igif->RunningCode >= igif->MaxCode1) 
   {
-    igif->CrntShiftDWord |= ((int) Code) << igif->CrntShiftState;
-    igif->CrntShiftState += igif->RunningBits;
-    while (igif->CrntShiftState >= 8) 
-    {
-      /* Dump out full bytes: */
-      error = iGIFBufferedOutput(handle, igif->Buf, igif->CrntShiftDWord & 0xff);
-      igif->CrntShiftDWord >>= 8;
-      igif->CrntShiftState -= 8;
-    }
+    igif->MaxCode1 = 1 << ++igif->RunningBits;
   }
+}
 
-  /* If code cannt fit into RunningBits bits, must raise its size. Note */
-  /* however that codes above 4095 are used for special signaling.      */
-  if (igif->RunningCode >= igif->MaxCode1 && Code <= GIF_LZ_MAX_CODE) 
+static int iGIFCompressFlush(iGIFData* igif, imBinFile* handle)
+{
+  while (igif->CrntShiftState > 0) 
   {
-    igif->MaxCode1 = 1 << ++igif->RunningBits;
+    /* Get Rid of what is left in DWord, and flush it. */
+    iGIFBufferedOutput(igif, handle, (unsigned char)(igif->CrntShiftDWord & 0xff));
+    igif->CrntShiftDWord >>= 8;
+    igif->CrntShiftState -= 8;
   }
+  igif->CrntShiftState = 0;			   /* For next time. */
+  igif->CrntShiftDWord = 0;
 
-  return error;
+  return iGIFBufferedOutputFlush(igif, handle);
 }
 
 /******************************************************************************
@@ -239,11 +217,13 @@ static int iGIFCompressOutput(iGIFData* igif, imBinFile* handle, int Code)
 *   This version compress the given buffer Line of length LineLen.	      *
 *   This routine can be called few times (one per scan line, for example), in *
 * order the complete the whole image.					      *
+*   The hash table uses open addressing. The key is 12 bits Prefix code plus  *
+* 8 bits new char, stored with the code. Empty entries have all bits set.     *
 ******************************************************************************/
-static int iGIFCompressLine(iGIFData* igif, imBinFile* handle, unsigned char *Line, int LineLen)
+static void iGIFCompressLine(iGIFData* igif, imBinFile* handle, const unsigned char *Line, int LineLen)
 {
-  int i = 0, CrntCode, NewCode;
-  unsigned int NewKey;
+  int i = 0, CrntCode, HKey;
+  unsigned int NewKey, HTKey, *HTable = igif->HTable;
   unsigned char Pixel;
 
   if (igif->CrntCode == GIF_FIRST_CODE)		  /* Its first time! */
@@ -258,18 +238,21 @@ static int iGIFCompressLine(iGIFData* igif, imBinFile* handle, unsigned char *Li
     /* CrntCode as Prefix string with Pixel as postfix char.	     */
     NewKey = (((unsigned int) CrntCode) << 8) + Pixel;
 
-    if ((NewCode = iGIFExistsHashTable(igif->HTable, NewKey)) >= 0) 
+    HKey = ((NewKey >> 12) ^ NewKey) & GIF_HT_KEY_MASK;
+    while ((HTKey = GIF_HT_GET_KEY(HTable[HKey])) != 0xFFFFFL && HTKey != NewKey) 
+      HKey = (HKey + 1) & GIF_HT_KEY_MASK;
+
+    if (HTKey == NewKey) 
     {
       /* This Key is already there, or the string is old one, so	     */
       /* simple take new code as our CrntCode:			     */
-      CrntCode = NewCode;
+      CrntCode = GIF_HT_GET_CODE(HTable[HKey]);
     }
     else 
     {
       /* Put it in hash table, output the prefix code, and make our    */
       /* CrntCode equal to Pixel.					     */
-      if (iGIFCompressOutput(igif, handle, CrntCode) != IM_ERR_NONE) 
-        return IM_ERR_ACCESS;
+      iGIFCompressOutput(igif, handle, CrntCode);
 
       CrntCode = Pixel;
 
@@ -278,245 +261,179 @@ static int iGIFCompressLine(iGIFData* igif, imBinFile* handle, unsigned char *Li
       if (igif->RunningCode >= GIF_LZ_MAX_CODE) 
       {
         /* Time to do some clearance: */
-        if (iGIFCompressOutput(igif, handle, igif->ClearCode) != IM_ERR_NONE) 
-          return IM_ERR_ACCESS;
+        iGIFCompressOutput(igif, handle, igif->ClearCode);
 
         igif->RunningCode = igif->EOFCode + 1;
         igif->RunningBits = igif->BitsPerPixel + 1;
         igif->MaxCode1 = 1 << igif->RunningBits;
-        memset(igif->HTable, 0xFF, GIF_HT_SIZE * sizeof(int));
+        memset(HTable, 0xFF, GIF_HT_SIZE * sizeof(int));
       }
       else 
       {
-        /* Put this unique key with its relative Code in hash table: */
-        iGIFInsertHashTable(igif->HTable, NewKey, igif->RunningCode++);
+        /* Put this unique key with its relative Code in the empty entry found: */
+        HTable[HKey] = GIF_HT_PUT_KEY(NewKey) | GIF_HT_PUT_CODE(igif->RunningCode++);
       }
     }
   }
 
   /* Preserve the current state of the compression algorithm: */
   igif->CrntCode = CrntCode;
-
-  return IM_ERR_NONE;
 }
 
 /******************************************************************************
-*   This routines read one gif data block at a time and buffers it internally *
-* so that the decompression routine could access it.			      *
-*   The routine returns the next byte from its internal buffer (or read next  *
-* block in if buffer empty).		      *
+*   This routines read all the gif data blocks of the image at once,          *
+* so that the decompression routine could access them as a single buffer.     *
 ******************************************************************************/
-static int iGIFBufferedInput(imBinFile* handle, unsigned char *Buf, unsigned char *NextByte)
+static int iGIFReadDataBlocks(iGIFData* igif, imBinFile* handle, int *size)
 {
-  if (Buf[0] == 0) 
+  unsigned char byte_value;
+  *size = 0;
+
+  do
   {
-    /* Needs to read the next buffer - this one is empty: */
-    imBinFileRead(handle, Buf, 1, 1);
-    imBinFileRead(handle, &Buf[1], Buf[0], 1);
+    /* reads the number of bytes of the block or the terminator */
+    byte_value = 0;
+    imBinFileRead(handle, &byte_value, 1, 1);
 
     if (imBinFileError(handle))
       return IM_ERR_ACCESS;
 
-    *NextByte = Buf[1];
-    Buf[1] = 2;	   /* We use now the second place as last char read! */
-    Buf[0]--;
-  }
-  else 
-  {
-    *NextByte = Buf[Buf[1]++];
-    Buf[0]--;
-  }
+    if (byte_value)
+    {
+      if (*size + 255 > igif->data_alloc)
+      {
+        int new_alloc = igif->data_alloc? 2*igif->data_alloc: 64*1024;
+        unsigned char* new_buf = (unsigned char*)realloc(igif->data_buf, new_alloc);
+        if (!new_buf)
+          return IM_ERR_MEM;
+
+        igif->data_buf = new_buf;
+        igif->data_alloc = new_alloc;
+      }
+
+      imBinFileRead(handle, igif->data_buf + *size, byte_value, 1);
+      *size += byte_value;
+    }
+  } while (byte_value != 0);
+
+  if (imBinFileError(handle))
+    return IM_ERR_ACCESS;
 
   return IM_ERR_NONE;
 }
 
 /******************************************************************************
-*   The LZ decompression input routine:					      *
-*   This routine is responsable for the decompression of the bit stream from  *
-* 8 bits (bytes) packets, into the real codes.				      *
+*   The LZ decompression routine:					      *
+*   Decodes the whole image into Frame. Each code is expanded at once,        *
+* writing its string from the last pixel to the first following the Prefix    *
+* chain, so no stack is necessary.                                            *
 ******************************************************************************/
-static int iGIFDecompressInput(iGIFData* igif, imBinFile* handle, int *Code)
+static int iGIFDecompressFrame(iGIFData* igif, const unsigned char* Data, int DataSize, unsigned char *Frame, int FrameSize)
 {
-  unsigned char NextByte;
-  static unsigned int CodeMasks[] = 
+  int Code, Len, Pos = 0, DataPos = 0, 
+      ClearCode = igif->ClearCode, 
+      EOFCode = igif->EOFCode,
+      RunningCode = EOFCode + 1, 
+      RunningBits = igif->BitsPerPixel + 1, 
+      MaxCode1 = 1 << RunningBits,
+      LastCode = GIF_NO_SUCH_CODE,
+      CrntShiftState = 0;
+  unsigned int CrntShiftDWord = 0;
+  unsigned short *Prefix = igif->Prefix, *Length = igif->Length;
+  unsigned char *Suffix = igif->Suffix, *First = igif->First;
+
+  for (Code = 0; Code < ClearCode; Code++)
   {
-    0x0000, 0x0001, 0x0003, 0x0007,
-    0x000f, 0x001f, 0x003f, 0x007f,
-    0x00ff, 0x01ff, 0x03ff, 0x07ff,
-    0x0fff
-  };
-
-  while (igif->CrntShiftState < igif->RunningBits) 
-  {
-    /* Needs to get more bytes from input stream for next code: */
-    if (iGIFBufferedInput(handle, igif->Buf, &NextByte) != IM_ERR_NONE) 
-      return IM_ERR_ACCESS;
-
-    igif->CrntShiftDWord |= ((unsigned int) NextByte) << igif->CrntShiftState;
-    igif->CrntShiftState += 8;
+    Prefix[Code] = 0;
+    Length[Code] = 1;
+    Suffix[Code] = (unsigned char)Code;
+    First[Code] = (unsigned char)Code;
   }
 
-  *Code = igif->CrntShiftDWord & CodeMasks[igif->RunningBits];
-
-  igif->CrntShiftDWord >>= igif->RunningBits;
-  igif->CrntShiftState -= igif->RunningBits;
-
-  /* If code cannt fit into RunningBits bits, must raise its size. Note */
-  /* however that codes above 4095 are used for special signaling.      */
-  if (++(igif->RunningCode) > igif->MaxCode1 && igif->RunningBits < GIF_LZ_BITS) 
+  while (Pos < FrameSize)
   {
-    igif->MaxCode1 <<= 1;
-    igif->RunningBits++;
-  }
-
-  return IM_ERR_NONE;
-}
-
-/******************************************************************************
-* Routine to trace the Prefixes linked list until we get a prefix which is    *
-* not code, but a pixel value (less than ClearCode). Returns that pixel value.*
-* If image is defective, we might loop here forever, so we limit the loops to *
-* the maximum possible if image O.k. - LZ_MAX_CODE times.		      *
-******************************************************************************/
-static int iGIFGetPrefixChar(unsigned int *Prefix, int Code, int ClearCode)
-{
-  int i = 0;
+    while (CrntShiftState < RunningBits) 
+    {
+      /* Data ended before all the pixels were decoded */
+      if (DataPos == DataSize)
+        return IM_ERR_ACCESS;
 
-  while (Code > ClearCode && i++ <= GIF_LZ_MAX_CODE) 
-    Code = Prefix[Code];
+      CrntShiftDWord |= ((unsigned int) Data[DataPos++]) << CrntShiftState;
+      CrntShiftState += 8;
+    }
 
-  return Code;
-}
+    Code = CrntShiftDWord & (MaxCode1 - 1);
+    CrntShiftDWord >>= RunningBits;
+    CrntShiftState -= RunningBits;
 
-static int iGIFDecompressLine(iGIFData* igif, imBinFile* handle, unsigned char *Line,	int LineLen)
-{
-  int i = 0, j, CrntCode, EOFCode, ClearCode, CrntPrefix, LastCode, StackPtr;
-  unsigned char *Stack, *Suffix;
-  unsigned int *Prefix;
-
-  StackPtr = igif->StackPtr;
-  Prefix = igif->Prefix;
-  Suffix = igif->Suffix;
-  Stack = igif->Stack;
-  EOFCode = igif->EOFCode;
-  ClearCode = igif->ClearCode;
-  LastCode = igif->LastCode;
-
-  if (StackPtr != 0) 
-  {
-    /* Let pop the stack off before continueing to read the gif file: */
-    while (StackPtr != 0 && i < LineLen) 
-      Line[i++] = Stack[--StackPtr];
-  }
+    if (Code == ClearCode) 
+    {
+      /* We need to start over again: */
+      RunningCode = EOFCode + 1;
+      RunningBits = igif->BitsPerPixel + 1;
+      MaxCode1 = 1 << RunningBits;
+      LastCode = GIF_NO_SUCH_CODE;
+      continue;
+    }
 
-  while (i < LineLen) 
-  {			    
-    /* Decode LineLen items. */
-    if (iGIFDecompressInput(igif, handle, &CrntCode))
+    if (Code == EOFCode) 
       return IM_ERR_ACCESS;
 
-    if (CrntCode == EOFCode) 
+    if (LastCode == GIF_NO_SUCH_CODE)
     {
-      /* Note however that usually we will not be here as we will stop */
-      /* decoding as soon as we got all the pixel, or EOF code will    */
-      /* not be read at all, and DGifGetLine/Pixel clean everything.   */
-      if (i != LineLen - 1) 
+      /* First code after a clear must be a pixel */
+      if (Code > ClearCode)
         return IM_ERR_ACCESS;
-  
-    i++;
-    }
-    else if (CrntCode == ClearCode) 
-    {
-      /* We need to start over again: */
-      for (j = 0; j <= GIF_LZ_MAX_CODE; j++) 
-        Prefix[j] = GIF_NO_SUCH_CODE;
 
-      igif->RunningCode = igif->EOFCode + 1;
-      igif->RunningBits = igif->BitsPerPixel + 1;
-      igif->MaxCode1 = 1 << igif->RunningBits;
-      LastCode = igif->LastCode = GIF_NO_SUCH_CODE;
+      Frame[Pos++] = (unsigned char)Code;
+      LastCode = Code;
+      continue;
     }
-    else 
+
+    if (Code > RunningCode)
+      return IM_ERR_ACCESS;
+
+    if (RunningCode <= GIF_LZ_MAX_CODE)
     {
-      /* Its regular code - if in pixel range simply add it to output  */
-      /* stream, otherwise trace to codes linked list until the prefix */
-      /* is in pixel range:					     */
-      if (CrntCode < ClearCode) 
+      /* New string is the last string plus the first pixel of the current string, */
+      /* if CrntCode is exactly the running code the current string is this new one. */
+      Prefix[RunningCode] = (unsigned short)LastCode;
+      Length[RunningCode] = Length[LastCode] + 1;
+      First[RunningCode] = First[LastCode];
+      Suffix[RunningCode] = (Code == RunningCode)? First[LastCode]: First[Code];
+      RunningCode++;
+
+      /* If code cannt fit into RunningBits bits, must raise its size. */
+      if (RunningCode == MaxCode1 && RunningBits < GIF_LZ_BITS) 
       {
-        /* This is simple - its pixel scalar, so add it to output:   */
-        Line[i++] = (unsigned char)CrntCode;
-      }
-      else 
-      {
-        /* Its a code to needed to be traced: trace the linked list  */
-        /* until the prefix is a pixel, while pushing the suffix     */
-        /* pixels on our stack. If we done, pop the stack in reverse */
-        /* (thats what stack is good for!) order to output.	     */
-        if (Prefix[CrntCode] == GIF_NO_SUCH_CODE) 
-        {
-          /* Only allowed if CrntCode is exactly the running code: */
-          /* In that case CrntCode = XXXCode, CrntCode or the	     */
-          /* prefix code is last code and the suffix char is	     */
-          /* exactly the prefix of last code!			     */
-          if (CrntCode == igif->RunningCode - 2) 
-          {
-            CrntPrefix = LastCode;
-            Suffix[igif->RunningCode - 2] =
-            Stack[StackPtr++] = (unsigned char)iGIFGetPrefixChar(Prefix, LastCode, ClearCode);
-          }
-          else 
-            return IM_ERR_ACCESS;
-        }
-        else
-          CrntPrefix = CrntCode;
-
-        /* Now (if image is O.K.) we should not get an NO_SUCH_CODE  */
-        /* During the trace. As we might loop forever, in case of    */
-        /* defective image, we count the number of loops we trace    */
-        /* and stop if we got LZ_MAX_CODE. obviously we can not      */
-        /* loop more than that.					     */
-        j = 0;
-        while (j++ <= GIF_LZ_MAX_CODE && CrntPrefix > ClearCode && CrntPrefix <= GIF_LZ_MAX_CODE) 
-        {
-          Stack[StackPtr++] = Suffix[CrntPrefix];
-          CrntPrefix = Prefix[CrntPrefix];
-        }
-
-        if (j >= GIF_LZ_MAX_CODE || CrntPrefix > GIF_LZ_MAX_CODE) 
-            return IM_ERR_ACCESS;
-
-        /* Push the last character on stack: */
-        Stack[StackPtr++] = (unsigned char)CrntPrefix;
-
-        /* Now lets pop all the stack into output: */
-        while (StackPtr != 0 && i < LineLen)
-          Line[i++] = Stack[--StackPtr];
+        MaxCode1 <<= 1;
+        RunningBits++;
       }
+    }
+    else if (Code == RunningCode)
+      return IM_ERR_ACCESS;
 
-      if (LastCode != GIF_NO_SUCH_CODE) 
-      {
-        Prefix[igif->RunningCode - 2] = LastCode;
-
-        if (CrntCode == igif->RunningCode - 2) 
-        {
-          /* Only allowed if CrntCode is exactly the running code: */
-          /* In that case CrntCode = XXXCode, CrntCode or the	     */
-          /* prefix code is last code and the suffix char is	     */
-          /* exactly the prefix of last code!			     */
-          Suffix[igif->RunningCode - 2] = (unsigned char)iGIFGetPrefixChar(Prefix, LastCode, ClearCode);
-        }
-        else 
-        {
-          Suffix[igif->RunningCode - 2] = (unsigned char)iGIFGetPrefixChar(Prefix, CrntCode, ClearCode);
-        }
-      }
-    
-      LastCode = CrntCode;
+    LastCode = Code;
+
+    Len = Length[Code];
+    if (Len > FrameSize - Pos)
+    {
+      /* ignore the pixels after the end of the image */
+      int skip = Len - (FrameSize - Pos);
+      while (skip--) Code = Prefix[Code];
+      Len = FrameSize - Pos;
     }
-  }
 
-  igif->LastCode = LastCode;
-  igif->StackPtr = StackPtr;
+    unsigned char* Pixel = Frame + Pos + Len - 1;
+    Pos += Len;
+
+    while (Len-- > 1)
+    {
+      *Pixel-- = Suffix[Code];
+      Code = Prefix[Code];
+    }
+    *Pixel = (unsigned char)Code;
+  }
 
   return IM_ERR_NONE;
 }
@@ -847,7 +764,7 @@ static int iGIFWriteComment(imBinFile* handle, unsigned char *buffer, int size)
   return IM_ERR_NONE;
 }
 
-static int iGIFWriteGraphicsControl(imBinFile* handle, imAttribTable* attrib_table)
+static int iGIFWriteGraphicsControl(imBinFile* handle, imAttribTable* attrib_table, const unsigned char* frame_transparency)
 {
   const void *attrib_user_input, *attrib_disposal, *attrib_delay, *attrib_transparency;
   unsigned char byte_value;
@@ -857,6 +774,10 @@ static int iGIFWriteGraphicsControl(imBinFile* handle, imAttribTable* attrib_tab
   attrib_delay = attrib_table->Get("Delay");
   attrib_transparency = attrib_table->Get("TransparencyIndex");
 
+  /* difference frames use their own transparency index */
+  if (frame_transparency)
+    attrib_transparency = frame_transparency;
+
   /* Writes the Graphics Control Extension */
   if (attrib_user_input || attrib_disposal || attrib_delay || attrib_transparency)
   {
@@ -926,6 +847,152 @@ static int iGIFWriteGraphicsControl(imBinFile* handle, imAttribTable* attrib_tab
   return IM_ERR_NONE;
 }
 
+static void iGIFInitBuffers(iGIFData* igif)
+{
+  igif->data_buf = NULL;
+  igif->data_alloc = 0;
+  igif->frame = NULL;
+  igif->prev_frame = NULL;
+  igif->frame_alloc = 0;
+  igif->prev_valid = 0;
+}
+
+static void iGIFFreeBuffers(iGIFData* igif)
+{
+  if (igif->data_buf) free(igif->data_buf);
+  if (igif->frame) free(igif->frame);
+  if (igif->prev_frame) free(igif->prev_frame);
+  iGIFInitBuffers(igif);
+}
+
+static int iGIFAllocFrame(iGIFData* igif, int frame_size, int difference)
+{
+  if (frame_size > igif->frame_alloc)
+  {
+    /* a bigger image can not be compared with the previous one */
+    iGIFFreeBuffers(igif);
+
+    igif->frame = (unsigned char*)malloc(frame_size);
+    if (!igif->frame)
+      return 0;
+
+    igif->frame_alloc = frame_size;
+  }
+
+  if (difference && !igif->prev_frame)
+  {
+    igif->prev_frame = (unsigned char*)malloc(igif->frame_alloc);
+    igif->prev_valid = 0;
+    if (!igif->prev_frame)
+      return 0;
+  }
+
+  return 1;
+}
+
+static int iGIFNextRow(iGIFData* igif, int row, int height)
+{
+  if (!igif->interlaced)
+    return row + 1;
+
+  row += InterlacedJumps[igif->step];
+
+  /* a pass can be empty for small images */
+  while (row > height-1 && igif->step < 3)
+  {
+    igif->step++;
+    row = InterlacedOffset[igif->step];
+  }
+
+  return row;
+}
+
+static void iGIFDifferenceRect(const unsigned char* frame, const unsigned char* prev_frame, int width, int height, int *x, int *y, int *w, int *h)
+{
+  int y0 = 0, y1 = height-1, x0 = width, x1 = -1;
+
+  while (y0 < height && memcmp(frame + y0*width, prev_frame + y0*width, width) == 0)
+    y0++;
+
+  if (y0 == height)
+  {
+    /* nothing changed, but at least one pixel must be written */
+    *x = 0; *y = 0; *w = 1; *h = 1;
+    return;
+  }
+
+  while (memcmp(frame + y1*width, prev_frame + y1*width, width) == 0)
+    y1--;
+
+  for (int j = y0; j <= y1; j++)
+  {
+    const unsigned char* line = frame + j*width;
+    const unsigned char* prev_line = prev_frame + j*width;
+
+    int i = 0;
+    while (i < x0 && line[i] == prev_line[i]) i++;
+    if (i < x0) x0 = i;
+
+    i = width-1;
+    while (i > x1 && line[i] == prev_line[i]) i--;
+    if (i > x1) x1 = i;
+  }
+
+  *x = x0; *y = y0; *w = x1-x0+1; *h = y1-y0+1;
+}
+
+static int iGIFDifferenceTransparency(const unsigned char* frame, const unsigned char* prev_frame, int width, int x, int y, int w, int h, int num_colors)
+{
+  /* finds an index that is not used by the changed pixels */
+  unsigned char used[256];
+  memset(used, 0, 256);
+
+  for (int j = 0; j < h; j++)
+  {
+    int offset = (y+j)*width + x;
+    const unsigned char* line = frame + offset;
+    const unsigned char* prev_line = prev_frame + offset;
+
+    for (int i = 0; i < w; i++)
+    {
+      if (line[i] != prev_line[i])
+        used[line[i]] = 1;
+    }
+  }
+
+  for (int c = 0; c < num_colors; c++)
+  {
+    if (!used[c])
+      return c;
+  }
+
+  return -1;
+}
+
+static void iGIFDifferenceFrame(const unsigned char* frame, unsigned char* prev_frame, int width, int x, int y, int w, int h, int transparency)
+{
+  /* The rectangle is packed at the start of prev_frame. 
+     Each pixel is written before or at the position it was read from, 
+     so the pixels not yet compared are never overwritten. */
+  unsigned char* rect = prev_frame;
+
+  for (int j = 0; j < h; j++)
+  {
+    int offset = (y+j)*width + x;
+    const unsigned char* line = frame + offset;
+    const unsigned char* prev_line = prev_frame + offset;
+
+    for (int i = 0; i < w; i++)
+    {
+      unsigned char pixel = line[i];
+      if (transparency >= 0 && pixel == prev_line[i])
+        pixel = (unsigned char)transparency;
+
+      *rect++ = pixel;
+    }
+  }
+}
+
 static const char* iGIFCompTable[1] = 
 {
   "LZW"
@@ -937,7 +1004,8 @@ class imFileFormatGIF: public imFileFormatBase
   iGIFData gif_data;
 
   int GIFReadImageInfo();
-  int GIFWriteImageInfo();
+  int GIFWriteImageInfo(int left, int top, int width, int height);
+  int GIFColorCount();
 
 public:
   imFileFormatGIF(const imFormat* _iformat): imFileFormatBase(_iformat) {}
@@ -981,6 +1049,8 @@ int imFileFormatGIF::Open(const char* file_name)
   if (this->handle == NULL)
     return IM_ERR_OPEN;
 
+  iGIFInitBuffers(&gif_data);
+
   imBinFileByteOrder(handle, IM_LITTLEENDIAN); 
 
   unsigned char sig[4];
@@ -1058,6 +1128,8 @@ int imFileFormatGIF::New(const char* file_name)
   if (this->handle == NULL)
     return IM_ERR_OPEN;
 
+  iGIFInitBuffers(&gif_data);
+
   imBinFileByteOrder(handle, IM_LITTLEENDIAN); 
 
   /* writes the GIF STAMP and version - header */
@@ -1084,6 +1156,8 @@ void imFileFormatGIF::Close()
     imBinFileWrite(this->handle, (void*)";", 1, 1);
 
   imBinFileClose(this->handle);
+
+  iGIFFreeBuffers(&gif_data);
 }
 
 void* imFileFormatGIF::Handle(int index)
@@ -1173,55 +1247,43 @@ int imFileFormatGIF::GIFReadImageInfo()
   return IM_ERR_NONE;
 }
 
-int imFileFormatGIF::GIFWriteImageInfo()
+int imFileFormatGIF::GIFColorCount()
 {
-  this->file_data_type = IM_BYTE;
-  this->file_color_mode = imColorModeSpace(this->user_color_mode);
-  this->file_color_mode |= IM_TOPDOWN;
-
-  imAttribTable* attrib_table = AttribTable();
-  const void* attrib = attrib_table->Get("Interlaced");
-  if (attrib)
-    gif_data.interlaced = *(int*)attrib;
+  if (imColorModeSpace(this->user_color_mode) == IM_MAP)
+  {
+    int bpp = 0, c = this->palette_count-1;
+    while (c) {c = c >> 1;bpp++;} 
+    if (bpp == 0) bpp = 1;
+    return 1 << bpp;
+  }
+  else
+    return 256; /* 8 bits = 256 grays */
+}
 
+int imFileFormatGIF::GIFWriteImageInfo(int left, int top, int width, int height)
+{
   imBinFileWrite(handle, (void*)",", 1, 1);  /* Image separator character. */
 
   imushort word_value;
 
-  attrib = attrib_table->Get("XScreen");
-  if (attrib)
-    word_value = *(unsigned short*)attrib;
-  else
-    word_value = 0;
+  word_value = (imushort)left;
   imBinFileWrite(handle, &word_value, 1, 2); /* image left */
-
-  attrib = attrib_table->Get("YScreen");
-  if (attrib)
-    word_value = *(unsigned short*)attrib;
-  else
-    word_value = 0;
+  word_value = (imushort)top;
   imBinFileWrite(handle, &word_value, 1, 2); /* image top */
 
-  word_value = (unsigned short)this->width;
+  word_value = (imushort)width;
   imBinFileWrite(handle, &word_value, 1, 2); /* image width */
-  word_value = (unsigned short)this->height;
+  word_value = (imushort)height;
   imBinFileWrite(handle, &word_value, 1, 2); /* image height */
 
   /* local color table */
+  int num_colors = GIFColorCount(), bpp = 0;
+  while ((1 << bpp) < num_colors) bpp++;
+
   imbyte byte_value = 0x80;
   if (gif_data.interlaced)
     byte_value |= 0x40;
-
-  int num_colors = 256;
-  if (imColorModeSpace(this->user_color_mode) == IM_MAP)
-  {
-    int bpp = 0, c = this->palette_count-1;
-    while (c) {c = c >> 1;bpp++;} 
-    byte_value |= (bpp-1); 
-    num_colors = 1 << bpp;
-  }
-  else
-    byte_value |= 0x07; /* 8 bits = 256 grays */
+  byte_value |= (imbyte)(bpp-1); 
 
   imBinFileWrite(handle, &byte_value, 1, 1); /* image information */
 
@@ -1306,22 +1368,15 @@ int imFileFormatGIF::ReadImageInfo(int index)
   /* reads the LZW Min code byte */
   imBinFileRead(handle, &byte_value, 1, 1);
 
-  /* now initialize the compression control data */
+  if (byte_value >= GIF_LZ_BITS)
+    return IM_ERR_FORMAT;
+
+  /* now initialize the decompression control data, 
+     the rest is initialized in iGIFDecompressFrame */
 
   gif_data.BitsPerPixel = byte_value;
   gif_data.ClearCode = (1 << byte_value);
   gif_data.EOFCode = gif_data.ClearCode + 1;
-  gif_data.RunningCode = gif_data.EOFCode + 1;
-  gif_data.RunningBits = byte_value + 1;	 /* Number of bits per code. */
-  gif_data.MaxCode1 = 1 << gif_data.RunningBits;     /* Max. code + 1. */
-  gif_data.StackPtr = 0;		    /* No pixels on the pixel stack. */
-  gif_data.LastCode = GIF_NO_SUCH_CODE;
-  gif_data.CrntShiftState = 0;	/* No information in CrntShiftDWord. */
-  gif_data.CrntShiftDWord = 0;
-  gif_data.Buf[0] = 0;			      /* Input Buffer empty. */
-
-  for (int i = 0; i <= GIF_LZ_MAX_CODE; i++) 
-    gif_data.Prefix[i] = GIF_NO_SUCH_CODE;
 
   gif_data.step = 0;
 
@@ -1332,7 +1387,7 @@ int imFileFormatGIF::WriteImageInfo()
 {
   this->file_color_mode = imColorModeSpace(this->user_color_mode);
   this->file_color_mode |= IM_TOPDOWN;
-  this->file_data_type = this->user_data_type;
+  this->file_data_type = IM_BYTE;
 
   imAttribTable* attrib_table = AttribTable();
   const void* attrib_data;
@@ -1374,116 +1429,174 @@ int imFileFormatGIF::WriteImageInfo()
       return IM_ERR_ACCESS;
   }
 
-  if (iGIFWriteGraphicsControl(handle, attrib_table) != IM_ERR_NONE)
-    return IM_ERR_ACCESS;
-
-  if (GIFWriteImageInfo() != IM_ERR_NONE)
-    return IM_ERR_ACCESS;
-
-  /* initializes the hash table */
-  memset(gif_data.HTable, 0xFF, GIF_HT_SIZE * sizeof(int));
-
-  /* initializes compression data */
-
-  imbyte byte_value = 8;
-  imBinFileWrite(handle, &byte_value, 1, 1); /* Write the Code size to file. */
-
-  gif_data.Buf[0] = 0;			  /* Nothing was output yet. */
-  gif_data.BitsPerPixel = 8;
-  gif_data.ClearCode = (1 << 8);
-  gif_data.EOFCode = gif_data.ClearCode + 1;
-  gif_data.RunningBits = 8 + 1;	 /* Number of bits per code. */
-  gif_data.MaxCode1 = 1 << gif_data.RunningBits;	   /* Max. code + 1. */
-  gif_data.CrntCode = GIF_FIRST_CODE;	   /* Signal that this is first one! */
-  gif_data.CrntShiftState = 0;      /* No information in CrntShiftDWord. */
-  gif_data.CrntShiftDWord = 0;
+  gif_data.interlaced = 0;
+  attrib_data = attrib_table->Get("Interlaced");
+  if (attrib_data)
+    gif_data.interlaced = *(int*)attrib_data;
 
-  gif_data.RunningCode = gif_data.EOFCode + 1;
+  /* The graphics control extension and the image descriptor are written 
+     in WriteImageData, because a difference frame can change them. */
 
   if (imBinFileError(handle))
     return IM_ERR_ACCESS;
 
-  gif_data.step = 0;          /* interlaced step */
-
-  return iGIFCompressOutput(&gif_data, handle, gif_data.ClearCode);
+  return IM_ERR_NONE;
 }
 
 int imFileFormatGIF::ReadImageData(void* data)
 {
   imCounterTotal(this->counter, this->height, "Reading GIF...");
 
-  int row = 0, error;
+  int frame_size = this->width * this->height;
+  if (!iGIFAllocFrame(&gif_data, frame_size, 0))
+    return IM_ERR_MEM;
+
+  int data_size;
+  int error = iGIFReadDataBlocks(&gif_data, handle, &data_size);
+  if (error != IM_ERR_NONE)
+    return error;
+
+  error = iGIFDecompressFrame(&gif_data, gif_data.data_buf, data_size, gif_data.frame, frame_size);
+  if (error != IM_ERR_NONE)
+    return IM_ERR_ACCESS;
+
+  int row = 0;
   for (int i = 0; i < this->height; i++)
   {
-    error = iGIFDecompressLine(&gif_data, handle, (imbyte*)this->line_buffer, this->width);
-    if (error != IM_ERR_NONE)
-      return IM_ERR_ACCESS;
+    memcpy(this->line_buffer, gif_data.frame + i*this->width, this->width);
 
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
       return IM_ERR_COUNTER;
 
-	  if (gif_data.interlaced)
-	  {
-      row += InterlacedJumps[gif_data.step];
-
-      if (row > this->height-1)
-      {
-        gif_data.step++;
-        row = InterlacedOffset[gif_data.step];
-      }
-	  }
-	  else
-      row++;
+    row = iGIFNextRow(&gif_data, row, this->height);
   }
 
-  /* Skip remaining empty blocks of the image data */
-  if (iGIFSkipSubBlocks(handle) != IM_ERR_NONE)
-    return IM_ERR_ACCESS;
-
   return IM_ERR_NONE;
 }
 
 int imFileFormatGIF::WriteImageData(void* data)
 {
-  imCounterTotal(this->counter, this->height, "Writing GIF...");
+  imAttribTable* attrib_table = AttribTable();
+  const void* attrib_data;
 
-  int row = 0, error;
-  for (int i = 0; i < this->height; i++)
+  attrib_data = attrib_table->Get("FrameDifference");
+  int difference = attrib_data? *(int*)attrib_data: 0;
+
+  int frame_size = this->width * this->height;
+  if (!iGIFAllocFrame(&gif_data, frame_size, difference))
+    return IM_ERR_MEM;
+
+  imbyte* frame = gif_data.frame;
+  for (int row = 0; row < this->height; row++)
+    imFileLineBufferWriteBuffer(this, data, frame + row*this->width, row, 0);
+
+  int left = 0, top = 0;
+  attrib_data = attrib_table->Get("XScreen");
+  if (attrib_data) left = *(imushort*)attrib_data;
+  attrib_data = attrib_table->Get("YScreen");
+  if (attrib_data) top = *(imushort*)attrib_data;
+
+  int has_transparency = attrib_table->Get("TransparencyIndex")? 1: 0;
+
+  /* the region and the pixels that will be actually compressed */
+  int x = 0, y = 0, w = this->width, h = this->height;
+  const imbyte* pixels = frame;
+  unsigned char frame_transparency;
+  int use_frame_transparency = 0;
+
+  if (difference && !has_transparency && gif_data.prev_valid &&
+      gif_data.prev_width == this->width && gif_data.prev_height == this->height &&
+      gif_data.prev_x == left && gif_data.prev_y == top &&
+      gif_data.prev_palette_count == this->palette_count &&
+      memcmp(gif_data.prev_palette, this->palette, this->palette_count*sizeof(long)) == 0)
   {
-    imFileLineBufferWrite(this, data, row, 0);
+    /* The previous image is still on screen, so only the changed rectangle is written,
+       and inside it the unchanged pixels are marked as transparent. */
+    iGIFDifferenceRect(frame, gif_data.prev_frame, this->width, this->height, &x, &y, &w, &h);
 
-    error = iGIFCompressLine(&gif_data, handle, (imbyte*)this->line_buffer, this->width);
+    int transparency = iGIFDifferenceTransparency(frame, gif_data.prev_frame, this->width, x, y, w, h, GIFColorCount());
+    if (transparency >= 0)
+    {
+      frame_transparency = (unsigned char)transparency;
+      use_frame_transparency = 1;
+    }
 
-    if (error != IM_ERR_NONE)
-      return IM_ERR_ACCESS;
+    /* the rectangle is stored in the previous image buffer, it will not be used anymore */
+    iGIFDifferenceFrame(frame, gif_data.prev_frame, this->width, x, y, w, h, transparency);
+    pixels = gif_data.prev_frame;
+  }
+
+  if (iGIFWriteGraphicsControl(handle, attrib_table, use_frame_transparency? &frame_transparency: NULL) != IM_ERR_NONE)
+    return IM_ERR_ACCESS;
+
+  if (GIFWriteImageInfo(left + x, top + y, w, h) != IM_ERR_NONE)
+    return IM_ERR_ACCESS;
+
+  /* initializes the hash table */
+  memset(gif_data.HTable, 0xFF, GIF_HT_SIZE * sizeof(int));
+
+  /* initializes compression data */
+
+  imbyte byte_value = 8;
+  imBinFileWrite(handle, &byte_value, 1, 1); /* Write the Code size to file. */
+
+  gif_data.OutBlock = 0;			  /* Nothing was output yet. */
+  gif_data.OutPos = 1;
+  gif_data.BitsPerPixel = 8;
+  gif_data.ClearCode = (1 << 8);
+  gif_data.EOFCode = gif_data.ClearCode + 1;
+  gif_data.RunningBits = 8 + 1;	 /* Number of bits per code. */
+  gif_data.MaxCode1 = 1 << gif_data.RunningBits;	   /* Max. code + 1. */
+  gif_data.CrntCode = GIF_FIRST_CODE;	   /* Signal that this is first one! */
+  gif_data.CrntShiftState = 0;      /* No information in CrntShiftDWord. */
+  gif_data.CrntShiftDWord = 0;
+
+  gif_data.RunningCode = gif_data.EOFCode + 1;
+
+  gif_data.step = 0;          /* interlaced step */
+
+  iGIFCompressOutput(&gif_data, handle, gif_data.ClearCode);
+
+  imCounterTotal(this->counter, h, "Writing GIF...");
+
+  int row = 0;
+  for (int i = 0; i < h; i++)
+  {
+    iGIFCompressLine(&gif_data, handle, pixels + row*w, w);
 
     if (!imCounterInc(this->counter))
       return IM_ERR_COUNTER;
 
-	  if (gif_data.interlaced)
-	  {
-      row += InterlacedJumps[gif_data.step];
-
-      if (row > this->height-1)
-      {
-        gif_data.step++;
-        row = InterlacedOffset[gif_data.step];
-      }
-	  }
-	  else
-      row++;
+    row = iGIFNextRow(&gif_data, row, h);
   }
 
   /* writes the end picture code */
   iGIFCompressOutput(&gif_data, handle, gif_data.CrntCode);
   iGIFCompressOutput(&gif_data, handle, gif_data.EOFCode);
-  iGIFCompressOutput(&gif_data, handle, GIF_FLUSH_OUTPUT);
-
-  if (imBinFileError(handle))
+  if (iGIFCompressFlush(&gif_data, handle) != IM_ERR_NONE)
     return IM_ERR_ACCESS;
 
+  if (difference)
+  {
+    /* the screen now shows this image, unless it will be disposed or has transparent pixels */
+    attrib_data = attrib_table->Get("Disposal");
+    gif_data.prev_valid = !has_transparency && 
+                          (!attrib_data || imStrEqual((char*)attrib_data, "LEAVE") || imStrEqual((char*)attrib_data, "UNDEF"));
+    gif_data.prev_x = left;
+    gif_data.prev_y = top;
+    gif_data.prev_width = this->width;
+    gif_data.prev_height = this->height;
+    gif_data.prev_palette_count = this->palette_count;
+    memcpy(gif_data.prev_palette, this->palette, this->palette_count*sizeof(long));
+
+    gif_data.frame = gif_data.prev_frame;
+    gif_data.prev_frame = frame;
+  }
+  else
+    gif_data.prev_valid = 0;
+
   this->image_count++;
   return IM_ERR_NONE;
 }
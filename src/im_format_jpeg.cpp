@@ -19,6 +19,10 @@
 #include <setjmp.h>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 extern "C" {
 #include "jpeglib.h"
 #include "jinclude.h"
@@ -296,9 +300,22 @@ class imFileFormatJPEG: public imFileFormatBase
   imBinFile* handle;
   int fix_adobe;
 
+#ifdef _OPENMP
+  int ReadImageDataParallel(void* data);
+  int WriteImageDataParallel(void* data);
+#endif
+
 #ifdef USE_EXIF
+  /* EXIF marker not parsed yet. Points to the marker saved by libjpeg, 
+     or to exif_copy after the markers are released when the data is read. */
+  const unsigned char* exif_data;
+  int exif_data_length;
+  unsigned char* exif_copy;
+
   void iReadExifAttrib(unsigned char* data, int data_length, imAttribTable* attrib_table);
   void iWriteExifAttrib(imAttribTable* attrib_table);
+  void iKeepExifData();
+  void iReleaseExifData();
 #endif
 
 public:
@@ -311,8 +328,11 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
+  void LoadAttributes();
 };
 
 class imFormatJPEG: public imFormat
@@ -361,6 +381,11 @@ int imFileFormatJPEG::Open(const char* file_name)
   strcpy(this->compression, "JPEG");
   this->image_count = 1;
 
+#ifdef USE_EXIF
+  this->exif_data = NULL;
+  this->exif_copy = NULL;
+#endif
+
   this->dinfo.err = jpeg_std_error(&this->jerr.pub);
   this->jerr.pub.error_exit = JPEGerror_exit;
   this->jerr.pub.output_message = JPEGoutput_message;
@@ -414,6 +439,11 @@ int imFileFormatJPEG::New(const char* file_name)
   strcpy(this->compression, "JPEG");
   this->image_count = 1;
 
+#ifdef USE_EXIF
+  this->exif_data = NULL;
+  this->exif_copy = NULL;
+#endif
+
   return IM_ERR_NONE;
 }
 
@@ -422,7 +452,12 @@ void imFileFormatJPEG::Close()
   if (this->is_new)
     jpeg_destroy_compress(&this->cinfo);
   else
+  {
+#ifdef USE_EXIF
+    iReleaseExifData();
+#endif
     jpeg_destroy_decompress(&this->dinfo);
+  }
 
   imBinFileClose(this->handle);
 }
@@ -443,6 +478,31 @@ void* imFileFormatJPEG::Handle(int index)
 }
 
 #ifdef USE_EXIF
+void imFileFormatJPEG::iKeepExifData()
+{
+  /* the saved markers are released by libjpeg when the decompression ends */
+  if (this->exif_data && !this->exif_copy)
+  {
+    this->exif_copy = (unsigned char*)malloc(this->exif_data_length);
+    if (this->exif_copy)
+    {
+      memcpy(this->exif_copy, this->exif_data, this->exif_data_length);
+      this->exif_data = this->exif_copy;
+    }
+    else
+      this->exif_data = NULL;
+  }
+}
+
+void imFileFormatJPEG::iReleaseExifData()
+{
+  if (this->exif_copy) 
+    free(this->exif_copy);
+
+  this->exif_data = NULL;
+  this->exif_copy = NULL;
+}
+
 void imFileFormatJPEG::iReadExifAttrib(unsigned char* data, int data_length, imAttribTable* attrib_table)
 {
   ExifData* exif = exif_data_new_from_data(data, data_length);
@@ -828,9 +888,19 @@ int imFileFormatJPEG::ReadImageInfo(int index)
   if (setjmp(this->jerr.setjmp_buffer)) 
     return IM_ERR_ACCESS;
 
-  // notify libjpeg to save the COM marker
-  jpeg_save_markers(&this->dinfo, JPEG_COM, 0xFFFF);
-  jpeg_save_markers(&this->dinfo, JPEG_APP0+1, 0xFFFF);
+  imAttribTable* attrib_table = AttribTable();
+
+#ifdef USE_EXIF
+  iReleaseExifData();
+#endif
+
+  int* skip_metadata = (int*)attrib_table->Get("SkipMetadata");
+  if (!skip_metadata || *skip_metadata == 0)
+  {
+    // notify libjpeg to save the COM marker
+    jpeg_save_markers(&this->dinfo, JPEG_COM, 0xFFFF);
+    jpeg_save_markers(&this->dinfo, JPEG_APP0+1, 0xFFFF);
+  }
 
   /* Step 3: read file parameters with jpeg_read_header() */
   if (jpeg_read_header(&this->dinfo, TRUE) != JPEG_HEADER_OK)
@@ -863,8 +933,6 @@ int imFileFormatJPEG::ReadImageInfo(int index)
     return IM_ERR_DATA;
   }
 
-  imAttribTable* attrib_table = AttribTable();
-
   int* auto_ycbcr = (int*)attrib_table->Get("AutoYCbCr");
   if (auto_ycbcr && *auto_ycbcr == 0 &&
       this->dinfo.jpeg_color_space == JCS_YCbCr)
@@ -915,8 +983,13 @@ int imFileFormatJPEG::ReadImageInfo(int index)
       }
       
 #ifdef USE_EXIF
-      if (cur_marker->marker == JPEG_APP0+1)
-        iReadExifAttrib(cur_marker->data, cur_marker->data_length, attrib_table);
+      // the EXIF attributes are parsed only when requested, see LoadAttributes
+      if (cur_marker->marker == JPEG_APP0+1 && !this->exif_data && 
+          cur_marker->data_length > 6 && memcmp(cur_marker->data, "Exif\0\0", 6) == 0)
+      {
+        this->exif_data = cur_marker->data;
+        this->exif_data_length = cur_marker->data_length;
+      }
 #endif
 
       cur_marker = cur_marker->next;
@@ -1032,34 +1105,785 @@ static void iFixAdobe(unsigned char* line_buffer, int width)
   }
 }
 
+#ifdef _OPENMP
+
+/* Parallel decoding and encoding.
+ * The entropy coded data of a sequential JPEG can only be decoded from its start 
+ * or from a restart marker. When the restart interval is aligned with the MCU rows 
+ * the image can be split in horizontal segments that are decoded as independent 
+ * JPEG streams, each one by its own libjpeg decompressor. 
+ * When writing, horizontal bands are compressed separately and 
+ * then joined in a single stream using restart markers. */
+
+static const int iJPEGParallelMinCount = 250000;   /* 500*500 image size, same as im_process */
+
+/* libjpeg source manager that reads a sequence of memory chunks */
+
+struct iJPEGChunkSource
+{
+  jpeg_source_mgr pub;
+  const JOCTET* chunk[5];
+  size_t chunk_size[5];
+  int chunk_count, chunk_index;
+};
+
+static void iJPEGInitSource(j_decompress_ptr dinfo)
+{
+  (void)dinfo;
+}
+
+static boolean iJPEGFillInputBuffer(j_decompress_ptr dinfo)
+{
+  static const JOCTET eoi_buffer[2] = {0xFF, JPEG_EOI};
+  iJPEGChunkSource* src = (iJPEGChunkSource*)dinfo->src;
+
+  while (src->chunk_index < src->chunk_count && src->chunk_size[src->chunk_index] == 0)
+    src->chunk_index++;
+
+  if (src->chunk_index < src->chunk_count)
+  {
+    src->pub.next_input_byte = src->chunk[src->chunk_index];
+    src->pub.bytes_in_buffer = src->chunk_size[src->chunk_index];
+    src->chunk_index++;
+  }
+  else
+  {
+    /* Insert a fake EOI marker, same as jdatasrc.c */
+    WARNMS(dinfo, JWRN_JPEG_EOF);
+    src->pub.next_input_byte = eoi_buffer;
+    src->pub.bytes_in_buffer = 2;
+  }
+
+  return TRUE;
+}
+
+static void iJPEGSkipInputData(j_decompress_ptr dinfo, long num_bytes)
+{
+  jpeg_source_mgr* src = dinfo->src;
+
+  if (num_bytes > 0)
+  {
+    while (num_bytes > (long)src->bytes_in_buffer) 
+    {
+      num_bytes -= (long)src->bytes_in_buffer;
+      (*src->fill_input_buffer)(dinfo);
+    }
+
+    src->next_input_byte += (size_t)num_bytes;
+    src->bytes_in_buffer -= (size_t)num_bytes;
+  }
+}
+
+static void iJPEGTermSource(j_decompress_ptr dinfo)
+{
+  (void)dinfo;
+}
+
+/* libjpeg destination manager that writes to a growing memory buffer */
+
+struct iJPEGBand
+{
+  int first_row, row_count;     /* in pixels */
+  int first_mcu_row;
+  JOCTET* buffer;
+  size_t size;
+};
+
+struct iJPEGMemDestination
+{
+  jpeg_destination_mgr pub;
+  iJPEGBand* band;
+  size_t alloc;
+};
+
+static void iJPEGInitDestination(j_compress_ptr cinfo)
+{
+  iJPEGMemDestination* dest = (iJPEGMemDestination*)cinfo->dest;
+
+  dest->alloc = 65536;
+  dest->band->buffer = (JOCTET*)malloc(dest->alloc);
+  if (!dest->band->buffer)
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+
+  dest->pub.next_output_byte = dest->band->buffer;
+  dest->pub.free_in_buffer = dest->alloc;
+}
+
+static boolean iJPEGEmptyOutputBuffer(j_compress_ptr cinfo)
+{
+  iJPEGMemDestination* dest = (iJPEGMemDestination*)cinfo->dest;
+
+  JOCTET* new_buffer = (JOCTET*)realloc(dest->band->buffer, 2*dest->alloc);
+  if (!new_buffer)
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 1);
+
+  dest->band->buffer = new_buffer;
+  dest->pub.next_output_byte = new_buffer + dest->alloc;
+  dest->pub.free_in_buffer = dest->alloc;
+  dest->alloc *= 2;
+
+  return TRUE;
+}
+
+static void iJPEGTermDestination(j_compress_ptr cinfo)
+{
+  iJPEGMemDestination* dest = (iJPEGMemDestination*)cinfo->dest;
+  dest->band->size = dest->alloc - dest->pub.free_in_buffer;
+}
+
+static void iJPEGInitError(JPEGerror_mgr* jerr)
+{
+  jpeg_std_error(&jerr->pub);
+  jerr->pub.error_exit = JPEGerror_exit;
+  jerr->pub.output_message = JPEGoutput_message;
+  jerr->pub.emit_message = JPEGemit_message;
+}
+
+/* Walks the markers of a JPEG header. 
+ * Returns the offset of the entropy coded data after the first SOS, or 0 if invalid.
+ * Also returns the offset of the SOF parameters (the sample precision byte). */
+static size_t iJPEGParseHeader(const JOCTET* buffer, size_t size, size_t *sof_offset)
+{
+  *sof_offset = 0;
+
+  if (size < 4 || buffer[0] != 0xFF || buffer[1] != 0xD8)  /* SOI */
+    return 0;
+
+  size_t pos = 2;
+  while (pos + 4 <= size)
+  {
+    if (buffer[pos] != 0xFF)
+      return 0;
+
+    while (pos < size && buffer[pos] == 0xFF)  /* skip fill bytes */
+      pos++;
+
+    if (pos + 3 > size)
+      return 0;
+
+    int marker = buffer[pos];
+    size_t length = (buffer[pos+1] << 8) | buffer[pos+2];
+    pos++;
+
+    if (length < 2 || pos + length > size)
+      return 0;
+
+    /* SOF0 to SOF15, except DHT, JPG and DAC */
+    if (marker >= 0xC0 && marker <= 0xCF && 
+        marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+    {
+      if (length < 8)
+        return 0;
+      *sof_offset = pos + 2;
+    }
+
+    pos += length;
+
+    if (marker == 0xDA)  /* SOS */
+      return *sof_offset? pos: 0;
+  }
+
+  return 0;
+}
+
+/* Finds the restart markers in the entropy coded data, they must be in sequence.
+ * Returns the offset of the marker that ends the scan, or 0 if invalid. */
+static size_t iJPEGFindRestarts(const JOCTET* buffer, size_t start, size_t size, size_t* rst_offset, int rst_count)
+{
+  int count = 0;
+  size_t pos = start;
+
+  while (pos + 1 < size)
+  {
+    const JOCTET* ff = (const JOCTET*)memchr(buffer + pos, 0xFF, size - pos);
+    if (!ff)
+      return 0;
+
+    pos = ff - buffer;
+    if (pos + 1 >= size)
+      return 0;
+
+    int marker = buffer[pos+1];
+    if (marker == 0x00)       /* stuffed zero */
+      pos += 2;
+    else if (marker == 0xFF)  /* fill byte */
+      pos++;
+    else if (marker >= JPEG_RST0 && marker <= JPEG_RST0+7)
+    {
+      if (count == rst_count || marker != JPEG_RST0 + (count & 7))
+        return 0;
+
+      rst_offset[count] = pos;
+      count++;
+      pos += 2;
+    }
+    else  /* end of scan */
+      return (count == rst_count)? pos: 0;
+  }
+
+  return 0;
+}
+
+/* Adds "shift" to the number of the restart markers found in the entropy coded data */
+static void iJPEGShiftRestarts(JOCTET* buffer, size_t size, int shift)
+{
+  size_t pos = 0;
+  while (pos + 1 < size)
+  {
+    JOCTET* ff = (JOCTET*)memchr(buffer + pos, 0xFF, size - pos);
+    if (!ff)
+      return;
+
+    pos = ff - buffer;
+    if (pos + 1 >= size)
+      return;
+
+    if (ff[1] == 0xFF)  /* fill byte */
+    {
+      pos++;
+      continue;
+    }
+
+    if (ff[1] >= JPEG_RST0 && ff[1] <= JPEG_RST0+7)
+      ff[1] = (JOCTET)(JPEG_RST0 + ((ff[1] - JPEG_RST0 + shift) & 7));
+
+    pos += 2;
+  }
+}
+
+static int iJPEGCounterInc(int counter, volatile int* processing)
+{
+  int ret;
+
+#pragma omp critical (imJPEGCounter)
+  {
+    ret = *processing;
+    if (ret && !imCounterInc(counter))
+    {
+      *processing = 0;
+      ret = 0;
+    }
+  }
+
+  return ret;
+}
+
+static int iJPEGDecodeSegment(imFile* ifile, j_decompress_ptr main_dinfo, int fix_adobe, 
+                              iJPEGChunkSource* src, int first_row, void* data, volatile int* processing)
+{
+  jpeg_decompress_struct dinfo;
+  JPEGerror_mgr jerr;
+  JSAMPROW line_buffer = (JSAMPROW)malloc(ifile->line_buffer_alloc);
+  if (!line_buffer)
+    return IM_ERR_MEM;
+
+  dinfo.err = &jerr.pub;
+  iJPEGInitError(&jerr);
+
+  if (setjmp(jerr.setjmp_buffer)) 
+  {
+    jpeg_destroy_decompress(&dinfo);
+    free(line_buffer);
+    return IM_ERR_ACCESS;
+  }
+
+  jpeg_create_decompress(&dinfo);
+
+  src->pub.init_source = iJPEGInitSource;
+  src->pub.fill_input_buffer = iJPEGFillInputBuffer;
+  src->pub.skip_input_data = iJPEGSkipInputData;
+  src->pub.resync_to_restart = jpeg_resync_to_restart;
+  src->pub.term_source = iJPEGTermSource;
+  src->pub.bytes_in_buffer = 0;
+  src->pub.next_input_byte = NULL;
+  dinfo.src = &src->pub;
+
+  jpeg_read_header(&dinfo, TRUE);
+
+  /* same output options of the main decompressor */
+  dinfo.out_color_space = main_dinfo->out_color_space;
+  dinfo.dct_method = main_dinfo->dct_method;
+  dinfo.do_fancy_upsampling = main_dinfo->do_fancy_upsampling;
+
+  jpeg_start_decompress(&dinfo);
+
+  if (dinfo.output_width != main_dinfo->output_width || 
+      dinfo.output_components != main_dinfo->output_components)
+    ERREXIT(&dinfo, JERR_BAD_LENGTH);
+
+  int direct = (int)(dinfo.output_width * dinfo.output_components) <= ifile->line_buffer_size;
+
+  int row = first_row;
+  while (dinfo.output_scanline < dinfo.output_height) 
+  {
+    JSAMPROW dst_buffer = direct? (JSAMPROW)imFileLineBufferDirect(ifile, data, row, 0): NULL;
+    if (!dst_buffer)
+      dst_buffer = line_buffer;
+
+    if (jpeg_read_scanlines(&dinfo, &dst_buffer, 1) == 0)
+      ERREXIT(&dinfo, JERR_BAD_LENGTH);
+
+    if (fix_adobe)
+      iFixAdobe((unsigned char*)dst_buffer, ifile->width);
+
+    if (dst_buffer == line_buffer)
+      imFileLineBufferReadBuffer(ifile, line_buffer, data, row, 0);
+
+    if (!iJPEGCounterInc(ifile->counter, processing))
+    {
+      jpeg_destroy_decompress(&dinfo);
+      free(line_buffer);
+      return IM_ERR_COUNTER;
+    }
+
+    row++;
+  }
+
+  jpeg_destroy_decompress(&dinfo);
+  free(line_buffer);
+  return IM_ERR_NONE;
+}
+
+static int iJPEGEncodeBand(imFile* ifile, j_compress_ptr main_cinfo, iJPEGBand* band, 
+                           const void* data, volatile int* processing)
+{
+  jpeg_compress_struct cinfo;
+  JPEGerror_mgr jerr;
+  iJPEGMemDestination dest;
+  JSAMPROW line_buffer = (JSAMPROW)malloc(ifile->line_buffer_alloc);
+  if (!line_buffer)
+    return IM_ERR_MEM;
+
+  cinfo.err = &jerr.pub;
+  iJPEGInitError(&jerr);
+
+  if (setjmp(jerr.setjmp_buffer)) 
+  {
+    jpeg_destroy_compress(&cinfo);
+    free(line_buffer);
+    return IM_ERR_ACCESS;
+  }
+
+  jpeg_create_compress(&cinfo);
+
+  dest.pub.init_destination = iJPEGInitDestination;
+  dest.pub.empty_output_buffer = iJPEGEmptyOutputBuffer;
+  dest.pub.term_destination = iJPEGTermDestination;
+  dest.band = band;
+  cinfo.dest = &dest.pub;
+
+  cinfo.image_width = main_cinfo->image_width;
+  cinfo.image_height = band->row_count;
+  cinfo.input_components = main_cinfo->input_components;
+  cinfo.in_color_space = main_cinfo->in_color_space;
+
+  /* same compression parameters of the main compressor */
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_colorspace(&cinfo, main_cinfo->jpeg_color_space);
+
+  for (int c = 0; c < cinfo.num_components; c++)
+  {
+    jpeg_component_info* compptr = cinfo.comp_info + c;
+    jpeg_component_info* main_compptr = main_cinfo->comp_info + c;
+    compptr->h_samp_factor = main_compptr->h_samp_factor;
+    compptr->v_samp_factor = main_compptr->v_samp_factor;
+    compptr->quant_tbl_no = main_compptr->quant_tbl_no;
+    compptr->dc_tbl_no = main_compptr->dc_tbl_no;
+    compptr->ac_tbl_no = main_compptr->ac_tbl_no;
+  }
+
+  for (int q = 0; q < NUM_QUANT_TBLS; q++)
+  {
+    if (main_cinfo->quant_tbl_ptrs[q])
+    {
+      if (!cinfo.quant_tbl_ptrs[q])
+        cinfo.quant_tbl_ptrs[q] = jpeg_alloc_quant_table((j_common_ptr)&cinfo);
+      memcpy(cinfo.quant_tbl_ptrs[q]->quantval, main_cinfo->quant_tbl_ptrs[q]->quantval, sizeof(cinfo.quant_tbl_ptrs[q]->quantval));
+    }
+  }
+
+  cinfo.dct_method = main_cinfo->dct_method;
+  cinfo.do_fancy_downsampling = main_cinfo->do_fancy_downsampling;
+  cinfo.smoothing_factor = main_cinfo->smoothing_factor;
+  cinfo.restart_interval = main_cinfo->MCUs_per_row;  /* one MCU row */
+
+  /* the file header is written by the main compressor */
+  cinfo.write_JFIF_header = FALSE;
+  cinfo.write_Adobe_marker = FALSE;
+
+  jpeg_start_compress(&cinfo, TRUE);
+
+  int row = band->first_row;
+  while (cinfo.next_scanline < cinfo.image_height) 
+  {
+    imFileLineBufferWriteBuffer(ifile, data, line_buffer, row, 0);
+
+    if (jpeg_write_scanlines(&cinfo, &line_buffer, 1) == 0)
+      ERREXIT(&cinfo, JERR_BAD_LENGTH);
+
+    if (!iJPEGCounterInc(ifile->counter, processing))
+    {
+      jpeg_destroy_compress(&cinfo);
+      free(line_buffer);
+      return IM_ERR_COUNTER;
+    }
+
+    row++;
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  free(line_buffer);
+  return IM_ERR_NONE;
+}
+
+/* Writes a buffer using the main compressor destination manager */
+static void iJPEGWriteBytes(j_compress_ptr cinfo, const JOCTET* buffer, size_t size)
+{
+  jpeg_destination_mgr* dest = cinfo->dest;
+
+  while (size)
+  {
+    if (dest->free_in_buffer == 0 && !(*dest->empty_output_buffer)(cinfo))
+      ERREXIT(cinfo, JERR_CANT_SUSPEND);
+
+    size_t count = IM_MIN(size, dest->free_in_buffer);
+    memcpy(dest->next_output_byte, buffer, count);
+    dest->next_output_byte += count;
+    dest->free_in_buffer -= count;
+    buffer += count;
+    size -= count;
+  }
+}
+
+int imFileFormatJPEG::ReadImageDataParallel(void* data)
+{
+  /* Returns -1 when the file can not be decoded in parallel, 
+     in this case the file position is restored. */
+
+  int thread_count = omp_get_max_threads();
+  if (thread_count < 2 || 
+      this->width * this->height < iJPEGParallelMinCount ||
+      this->dinfo.restart_interval == 0 ||
+      this->dinfo.progressive_mode || 
+      this->dinfo.arith_code || 
+      this->dinfo.data_precision != 8 ||
+      this->dinfo.output_scanline != 0 ||
+      jpeg_has_multiple_scans(&this->dinfo))
+    return -1;
+
+  /* a non interleaved scan is only aligned with the image rows when not subsampled */
+  if (this->dinfo.comps_in_scan == 1 && 
+      (this->dinfo.max_v_samp_factor != 1 || this->dinfo.max_h_samp_factor != 1))
+    return -1;
+
+  int mcu_height = this->dinfo.max_v_samp_factor * this->dinfo.min_DCT_v_scaled_size;
+  if (this->dinfo.comps_in_scan == 1)
+    mcu_height = this->dinfo.min_DCT_v_scaled_size;
+
+  int mcu_row_count = this->dinfo.MCU_rows_in_scan;
+  int mcus_per_row = this->dinfo.MCUs_per_row;
+  int restart_interval = this->dinfo.restart_interval;
+
+  /* the segments must start at a MCU row that also starts a restart interval */
+  int row_step = 1;
+  while ((row_step * mcus_per_row) % restart_interval != 0)
+    row_step++;
+
+  int segment_count = IM_MIN(2*thread_count, mcu_row_count / row_step);
+  if (segment_count < 2)
+    return -1;
+
+  int segment_step = ((mcu_row_count / row_step + segment_count-1) / segment_count) * row_step;
+  segment_count = (mcu_row_count + segment_step-1) / segment_step;
+  if (segment_count < 2)
+    return -1;
+
+  unsigned long file_pos = imBinFileTell(this->handle);
+  size_t entropy_start = file_pos - this->dinfo.src->bytes_in_buffer;
+  size_t file_size = imBinFileSize(this->handle);
+
+  JOCTET* file_buffer = (JOCTET*)malloc(file_size);
+  if (!file_buffer)
+    return -1;
+
+  imBinFileSeekTo(this->handle, 0);
+  if (imBinFileRead(this->handle, file_buffer, file_size, 1) != file_size || 
+      imBinFileError(this->handle))
+  {
+    free(file_buffer);
+    imBinFileSeekTo(this->handle, file_pos);
+    return -1;
+  }
+
+  int total_mcus = mcu_row_count * mcus_per_row;
+  int rst_count = (total_mcus + restart_interval-1) / restart_interval - 1;
+  size_t* rst_offset = new size_t [rst_count + 1];
+
+  size_t sof_offset, entropy_end = 0;
+  if (iJPEGParseHeader(file_buffer, file_size, &sof_offset) == entropy_start)
+    entropy_end = iJPEGFindRestarts(file_buffer, entropy_start, file_size, rst_offset, rst_count);
+
+  if (entropy_end == 0)
+  {
+    delete [] rst_offset;
+    free(file_buffer);
+    imBinFileSeekTo(this->handle, file_pos);
+    return -1;
+  }
+
+  /* Each segment is a JPEG stream made of the original header, 
+     with a new image height, its entropy coded data and an EOI marker. */
+  JOCTET* segment_height = new JOCTET [2*segment_count];
+  iJPEGChunkSource* segment_src = new iJPEGChunkSource [segment_count];
+  static const JOCTET eoi_buffer[2] = {0xFF, JPEG_EOI};
+
+  for (int s = 0; s < segment_count; s++)
+  {
+    int first_mcu_row = s * segment_step;
+    int last_mcu_row = IM_MIN(first_mcu_row + segment_step, mcu_row_count);
+    int first_interval = (first_mcu_row * mcus_per_row) / restart_interval;
+    int last_interval = (last_mcu_row * mcus_per_row) / restart_interval;   /* next segment first interval */
+
+    size_t start = first_interval? rst_offset[first_interval-1] + 2: entropy_start;
+    size_t end = (last_mcu_row < mcu_row_count)? rst_offset[last_interval-1]: entropy_end;
+
+    /* restart markers must be numbered from the segment start */
+    if (first_interval & 7)
+      iJPEGShiftRestarts(file_buffer + start, end - start, -first_interval);
+
+    int rows = IM_MIN(last_mcu_row * mcu_height, this->height) - first_mcu_row * mcu_height;
+    segment_height[2*s] = (JOCTET)(rows >> 8);
+    segment_height[2*s+1] = (JOCTET)(rows & 0xFF);
+
+    iJPEGChunkSource* src = segment_src + s;
+    src->chunk[0] = file_buffer;
+    src->chunk_size[0] = sof_offset + 1;
+    src->chunk[1] = segment_height + 2*s;
+    src->chunk_size[1] = 2;
+    src->chunk[2] = file_buffer + sof_offset + 3;
+    src->chunk_size[2] = entropy_start - (sof_offset + 3);
+    src->chunk[3] = file_buffer + start;
+    src->chunk_size[3] = end - start;
+    src->chunk[4] = eoi_buffer;
+    src->chunk_size[4] = 2;
+    src->chunk_count = 5;
+    src->chunk_index = 0;
+  }
+
+  imCounterTotal(this->counter, this->dinfo.output_height, "Reading JPEG...");
+
+  volatile int processing = 1;
+  int error = IM_ERR_NONE;
+
+#pragma omp parallel for schedule(dynamic)
+  for (int s = 0; s < segment_count; s++)
+  {
+    if (!processing)
+      continue;
+
+    int ret = iJPEGDecodeSegment(this, &this->dinfo, this->fix_adobe, segment_src + s, 
+                                 s * segment_step * mcu_height, data, &processing);
+    if (ret != IM_ERR_NONE)
+    {
+#pragma omp critical (imJPEGCounter)
+      {
+        if (error == IM_ERR_NONE)
+          error = ret;
+        processing = 0;
+      }
+    }
+  }
+
+  delete [] segment_src;
+  delete [] segment_height;
+  delete [] rst_offset;
+  free(file_buffer);
+
+  jpeg_abort_decompress(&this->dinfo);
+
+  return error;
+}
+
+int imFileFormatJPEG::WriteImageDataParallel(void* data)
+{
+  /* Returns -1 when the image can not be encoded in parallel. */
+
+  int thread_count = omp_get_max_threads();
+  if (thread_count < 2 || 
+      this->width * this->height < iJPEGParallelMinCount ||
+      this->cinfo.progressive_mode || 
+      this->cinfo.arith_code || 
+      this->cinfo.optimize_coding ||
+      this->cinfo.restart_interval != 0 ||
+      this->cinfo.next_scanline != 0)
+    return -1;
+
+  if (this->cinfo.comps_in_scan == 1 && 
+      (this->cinfo.max_v_samp_factor != 1 || this->cinfo.max_h_samp_factor != 1))
+    return -1;
+
+  int mcu_height = this->cinfo.max_v_samp_factor * this->cinfo.min_DCT_v_scaled_size;
+  if (this->cinfo.comps_in_scan == 1)
+    mcu_height = this->cinfo.min_DCT_v_scaled_size;
+
+  int mcu_row_count = (this->height + mcu_height-1) / mcu_height;
+  int band_count = IM_MIN(2*thread_count, mcu_row_count);
+  int band_step = (mcu_row_count + band_count-1) / band_count;
+  band_count = (mcu_row_count + band_step-1) / band_step;
+  if (band_count < 2)
+    return -1;
+
+  iJPEGBand* band = new iJPEGBand [band_count];
+  for (int b = 0; b < band_count; b++)
+  {
+    band[b].first_mcu_row = b * band_step;
+    band[b].first_row = band[b].first_mcu_row * mcu_height;
+    band[b].row_count = IM_MIN(band[b].first_row + band_step * mcu_height, this->height) - band[b].first_row;
+    band[b].buffer = NULL;
+    band[b].size = 0;
+  }
+
+  imCounterTotal(this->counter, this->cinfo.image_height, "Writing JPEG...");
+
+  volatile int processing = 1;
+  int error = IM_ERR_NONE;
+
+#pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < band_count; b++)
+  {
+    if (!processing)
+      continue;
+
+    int ret = iJPEGEncodeBand(this, &this->cinfo, band + b, data, &processing);
+    if (ret != IM_ERR_NONE)
+    {
+#pragma omp critical (imJPEGCounter)
+      {
+        if (error == IM_ERR_NONE)
+          error = ret;
+        processing = 0;
+      }
+    }
+  }
+
+  /* The first band provides the frame header, with the full image height.
+     The other bands are appended after a restart marker. 
+     All the bands use one MCU row as the restart interval. */
+  for (int b = 0; b < band_count && error == IM_ERR_NONE; b++)
+  {
+    size_t sof_offset, entropy_start = iJPEGParseHeader(band[b].buffer, band[b].size, &sof_offset);
+    if (entropy_start == 0 || band[b].size < entropy_start + 2)
+    {
+      error = IM_ERR_ACCESS;
+      break;
+    }
+
+    size_t end = band[b].size - 2;  /* remove EOI */
+
+    if (b == 0)
+    {
+      band[b].buffer[sof_offset + 1] = (JOCTET)(this->height >> 8);
+      band[b].buffer[sof_offset + 2] = (JOCTET)(this->height & 0xFF);
+      iJPEGWriteBytes(&this->cinfo, band[b].buffer + 2, end - 2);  /* remove SOI, already written */
+    }
+    else
+    {
+      JOCTET rst_marker[2] = {0xFF, (JOCTET)(JPEG_RST0 + ((band[b].first_mcu_row - 1) & 7))};
+      iJPEGShiftRestarts(band[b].buffer + entropy_start, end - entropy_start, band[b].first_mcu_row);
+      iJPEGWriteBytes(&this->cinfo, rst_marker, 2);
+      iJPEGWriteBytes(&this->cinfo, band[b].buffer + entropy_start, end - entropy_start);
+    }
+  }
+
+  for (int b = 0; b < band_count; b++)
+    free(band[b].buffer);
+  delete [] band;
+
+  if (error == IM_ERR_NONE)
+  {
+    static const JOCTET eoi_buffer[2] = {0xFF, JPEG_EOI};
+    iJPEGWriteBytes(&this->cinfo, eoi_buffer, 2);
+    (*this->cinfo.dest->term_destination)(&this->cinfo);
+  }
+
+  jpeg_abort_compress(&this->cinfo);
+
+  return error;
+}
+
+#endif
+
+void imFileFormatJPEG::LoadAttributes()
+{
+#ifdef USE_EXIF
+  if (this->exif_data)
+  {
+    iReadExifAttrib((unsigned char*)this->exif_data, this->exif_data_length, AttribTable());
+    iReleaseExifData();
+  }
+#endif
+}
+
 int imFileFormatJPEG::ReadImageData(void* data)
 {
   if (setjmp(this->jerr.setjmp_buffer)) 
     return IM_ERR_ACCESS;
 
-  imCounterTotal(this->counter, this->dinfo.output_height, "Reading JPEG...");
+#ifdef USE_EXIF
+  iKeepExifData();
+#endif
+
+#ifdef _OPENMP
+  int error = ReadImageDataParallel(data);
+  if (error != -1)
+    return error;
+#endif
+
+  return ReadImageLines(data, 0, this->height);
+}
 
-  int row = 0, plane = 0;
-  while (this->dinfo.output_scanline < this->dinfo.output_height) 
+int imFileFormatJPEG::ReadImageLines(void* data, int first_line, int count)
+{
+  if (setjmp(this->jerr.setjmp_buffer)) 
+    return IM_ERR_ACCESS;
+
+  if (first_line == 0)
+  {
+#ifdef USE_EXIF
+    iKeepExifData();
+#endif
+    imCounterTotal(this->counter, this->dinfo.output_height, "Reading JPEG...");
+  }
+
+  /* decode directly in the application buffer when possible */
+  int direct = (int)(this->dinfo.output_width * this->dinfo.output_components) <= this->line_buffer_size;
+
+  /* the file is always packed, there is only one plane */
+  for (int row = first_line; row < first_line + count; row++)
   {
-    if (jpeg_read_scanlines(&this->dinfo, (JSAMPARRAY)&this->line_buffer, 1) == 0)
+    JSAMPROW line_buffer = direct? (JSAMPROW)imFileLineBufferDirect(this, data, row, 0): NULL;
+    if (!line_buffer)
+      line_buffer = (JSAMPROW)this->line_buffer;
+
+    if (jpeg_read_scanlines(&this->dinfo, &line_buffer, 1) == 0)
       return IM_ERR_ACCESS;
 
     if (this->fix_adobe)
-      iFixAdobe((unsigned char*)this->line_buffer, this->width);
+      iFixAdobe((unsigned char*)line_buffer, this->width);
 
-    imFileLineBufferRead(this, data, row, plane);
+    if (line_buffer == this->line_buffer)
+      imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
     {
       jpeg_finish_decompress(&this->dinfo);
       return IM_ERR_COUNTER;
     }
-
-    imFileLineBufferInc(this, &row, &plane);
   }
 
-  jpeg_finish_decompress(&this->dinfo);
+  if (this->dinfo.output_scanline == this->dinfo.output_height)
+    jpeg_finish_decompress(&this->dinfo);
 
   return IM_ERR_NONE;
 }
@@ -1069,12 +1893,27 @@ int imFileFormatJPEG::WriteImageData(void* data)
   if (setjmp(this->jerr.setjmp_buffer)) 
     return IM_ERR_ACCESS;
 
-  imCounterTotal(this->counter, this->dinfo.output_height, "Writing JPEG...");
+#ifdef _OPENMP
+  int error = WriteImageDataParallel(data);
+  if (error != -1)
+    return error;
+#endif
+
+  return WriteImageLines(data, 0, this->height);
+}
 
-  int row = 0, plane = 0;
-  while (this->cinfo.next_scanline < this->cinfo.image_height) 
+int imFileFormatJPEG::WriteImageLines(void* data, int first_line, int count)
+{
+  if (setjmp(this->jerr.setjmp_buffer)) 
+    return IM_ERR_ACCESS;
+
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->cinfo.image_height, "Writing JPEG...");
+
+  /* the file is always packed, there is only one plane */
+  for (int row = first_line; row < first_line + count; row++)
   {
-    imFileLineBufferWrite(this, data, row, plane);
+    imFileLineBufferWrite(this, data, row, 0);
 
     if (jpeg_write_scanlines(&this->cinfo, (JSAMPARRAY)&this->line_buffer, 1) == 0)
       return IM_ERR_ACCESS;
@@ -1084,11 +1923,10 @@ int imFileFormatJPEG::WriteImageData(void* data)
       jpeg_finish_compress(&this->cinfo);
       return IM_ERR_COUNTER;
     }
-
-    imFileLineBufferInc(this, &row, &plane);
   }
 
-  jpeg_finish_compress(&this->cinfo);
+  if (this->cinfo.next_scanline == this->cinfo.image_height)
+    jpeg_finish_compress(&this->cinfo);
 
   return IM_ERR_NONE;
 }
@@ -10,6 +10,7 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -220,9 +221,9 @@ int imFileFormatKRN::WriteImageInfo()
   imBinFilePrintf(handle, "%d\n", this->height);
 
   if (this->file_data_type == IM_INT)
-    imBinFileWrite(handle, (void*)"0\n", 1, 1);
+    imBinFileWrite(handle, (void*)"0\n", 2, 1);
   else
-    imBinFileWrite(handle, (void*)"1\n", 1, 1);
+    imBinFileWrite(handle, (void*)"1\n", 2, 1);
   
   /* tests if everything was ok */
   if (imBinFileError(handle))
@@ -233,75 +234,96 @@ int imFileFormatKRN::WriteImageInfo()
 
 int imFileFormatKRN::ReadImageData(void* data)
 {
+  iBinBuffer buffer;
+  if (!iBinBufferInit(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
   imCounterTotal(this->counter, this->height, "Reading KRN...");
 
-  for (int row = 0; row < this->height; row++)
+  int error = IM_ERR_NONE;
+  for (int row = 0; row < this->height && !error; row++)
   {
     for (int col = 0; col < this->width; col++)
     {
       if (this->file_data_type == IM_INT)
       {
         int value;
-        if (!imBinFileReadInteger(handle, &value))
-          return IM_ERR_ACCESS;
+        if (!iBinBufferReadInteger(&buffer, &value))
+        {
+          error = IM_ERR_ACCESS;
+          break;
+        }
 
         ((int*)this->line_buffer)[col] = value;
       }
       else
       {
         float value;
-        if (!imBinFileReadFloat(handle, &value))
-          return IM_ERR_ACCESS;
+        if (!iBinBufferReadFloat(&buffer, &value))
+        {
+          error = IM_ERR_ACCESS;
+          break;
+        }
 
         ((float*)this->line_buffer)[col] = value;
       }
     }
 
+    if (error)
+      break;
+
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+      error = IM_ERR_COUNTER;
   }
 
-  return IM_ERR_NONE;
+  iBinBufferSync(&buffer);
+  iBinBufferRelease(&buffer);
+  return error;
 }
 
 int imFileFormatKRN::WriteImageData(void* data)
 {
+  iBinBuffer buffer;
+  if (!iBinBufferInitWrite(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
   imCounterTotal(this->counter, this->height, "Writing KRN...");
 
-  for (int row = 0; row < this->height; row++)
+  int error = IM_ERR_NONE;
+  for (int row = 0; row < this->height && !error; row++)
   {
     imFileLineBufferWrite(this, data, row, 0);
 
     for (int col = 0; col < this->width; col++)
     {
+      int write_size;
       if (this->file_data_type == IM_INT)
-      {
-        int value = ((int*)this->line_buffer)[col];
-
-        if (!imBinFilePrintf(handle, "%d ", value))
-          return IM_ERR_ACCESS;
-      }
+        write_size = iBinBufferPrintInteger(&buffer, ((int*)this->line_buffer)[col], ' ');
       else
-      {
-        float value = ((float*)this->line_buffer)[col];
+        write_size = iBinBufferPrintf(&buffer, "%f ", (double)((float*)this->line_buffer)[col]);
 
-        if (!imBinFilePrintf(handle, "%f ", (double)value))
-          return IM_ERR_ACCESS;
+      if (!write_size)
+      {
+        error = IM_ERR_ACCESS;
+        break;
       }
     }
 
-    imBinFileWrite(handle, (void*)"\n", 1, 1);
-
-    if (imBinFileError(handle))
-      return IM_ERR_ACCESS;     
+    if (error)
+      break;
 
-    if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    if (!iBinBufferWrite(&buffer, "\n", 1))
+      error = IM_ERR_ACCESS;
+    else if (!imCounterInc(this->counter))
+      error = IM_ERR_COUNTER;
   }
 
-  return IM_ERR_NONE;
+  if (!iBinBufferFlush(&buffer) && !error)
+    error = IM_ERR_ACCESS;
+  iBinBufferRelease(&buffer);
+  return error;
 }
 
 int imFormatKRN::CanWrite(const char* compression, int color_mode, int data_type) const
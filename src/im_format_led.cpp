@@ -10,6 +10,7 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -268,54 +269,79 @@ int imFileFormatLED::ReadImageData(void* data)
 {
   int value;
 
+  iBinBuffer buffer;
+  if (!iBinBufferInit(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
   imCounterTotal(this->counter, this->height, "Reading LED...");
 
-  for (int row = 0; row < this->height; row++)
+  int error = IM_ERR_NONE;
+  for (int row = 0; row < this->height && !error; row++)
   {
     for (int col = 0; col < this->width; col++)
     {
-      if (!imBinFileReadInteger(handle, &value))
-        return IM_ERR_ACCESS;
+      if (!iBinBufferReadInteger(&buffer, &value))
+      {
+        error = IM_ERR_ACCESS;
+        break;
+      }
 
       ((imbyte*)this->line_buffer)[col] = (unsigned char)value;
     }
 
+    if (error)
+      break;
+
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+      error = IM_ERR_COUNTER;
   } 
 
-  return IM_ERR_NONE;
+  iBinBufferSync(&buffer);
+  iBinBufferRelease(&buffer);
+  return error;
 }
 
 int imFileFormatLED::WriteImageData(void* data)
 {
+  iBinBuffer buffer;
+  if (!iBinBufferInitWrite(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
   imCounterTotal(this->counter, this->height, "Writing LED...");
 
-  for (int row = 0; row < this->height; row++)
+  int error = IM_ERR_NONE;
+  for (int row = 0; row < this->height && !error; row++)
   {
     imFileLineBufferWrite(this, data, row, 0);
 
     for (int col = 0; col < this->width; col++)
     {
-      if (!imBinFilePrintf(handle, ",%d", (int)((imbyte*)this->line_buffer)[col]))
-        return IM_ERR_ACCESS;
+      if (!iBinBufferWrite(&buffer, ",", 1) ||
+          !iBinBufferPrintInteger(&buffer, (int)((imbyte*)this->line_buffer)[col], 0))
+      {
+        error = IM_ERR_ACCESS;
+        break;
+      }
     }
-  
-    imBinFileWrite(handle, (void*)"\n", 1, 1);
-    if (imBinFileError(handle))
-      return IM_ERR_ACCESS;     
 
-    if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    if (error)
+      break;
+  
+    if (!iBinBufferWrite(&buffer, "\n", 1))
+      error = IM_ERR_ACCESS;
+    else if (!imCounterInc(this->counter))
+      error = IM_ERR_COUNTER;
   }
 
-  imBinFileWrite(handle, (void*)")", 1, 1);
-  if (imBinFileError(handle))
-    return IM_ERR_ACCESS;     
+  if (!error && !iBinBufferWrite(&buffer, ")", 1))
+    error = IM_ERR_ACCESS;
 
-  return IM_ERR_NONE;
+  if (!iBinBufferFlush(&buffer) && !error)
+    error = IM_ERR_ACCESS;
+  iBinBufferRelease(&buffer);
+  return error;
 }
 
 int imFormatLED::CanWrite(const char* compression, int color_mode, int data_type) const
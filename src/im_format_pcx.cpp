@@ -10,6 +10,8 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
+#include "im_rle.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -73,9 +75,10 @@ static int iPCXEncodeScanLine(unsigned char* EncodedBuffer, const unsigned char*
     ** Pixel value runs are encoded until a different pixel value
     ** is encountered, the end of the scan line is reached, or 63
     ** pixel values have been counted. */
-    for (runcount = 1, runvalue = DecodedBuffer[index]; 
-         index + runcount < BufferSize && runvalue == DecodedBuffer[index + runcount] && runcount < 63; 
-         runcount++);
+    int max_count = BufferSize - index - 1;
+    if (max_count > 62) max_count = 62;
+    runvalue = DecodedBuffer[index];
+    runcount = (unsigned char)(1 + iRLERepeatCount(DecodedBuffer + index, 1, max_count));
 
     /** Encode the run into a one or two-unsigned char code.
     ** Multiple pixel runs are stored in two-unsigned char codes.  If a single
@@ -105,34 +108,32 @@ static int iPCXEncodeScanLine(unsigned char* EncodedBuffer, const unsigned char*
   return scanindex;      /* Return the number of unsigned chars written to buffer */
 }
 
-static int iPCXDecodeScanLine(imBinFile* handle, unsigned char* DecodedBuffer, int BufferSize)
+static int iPCXDecodeScanLine(iBinBuffer* buffer, unsigned char* DecodedBuffer, int BufferSize)
 {
-  int  index = 0;    /* Index into compressed scan line buffer */
-  unsigned char data;          /* Data byte read from PCX file           */
-  unsigned char runcount = 0;   /* Length of decoded pixel run            */
-  unsigned char runvalue = 0;   /* Value of decoded pixel run             */
+  int index = 0;     /* Index into decoded scan line buffer */
+  int data;          /* Data byte read from PCX file        */
+  int runcount;      /* Length of decoded pixel run         */
+  int runvalue;      /* Value of decoded pixel run          */
 
   while (index < BufferSize)    /* Read until the end of the buffer     */
   {
-    imBinFileRead(handle, &data, 1, 1);
+    if (!iBinBufferGetByte(buffer, &data))
+      return IM_ERR_ACCESS;
 
     if ((data & 0xC0) == 0xC0)              /* Two-unsigned char code    */
     {
-      runcount = (unsigned char)(data & 0x3F);             /* Get run count    */
-      imBinFileRead(handle, &runvalue, 1, 1);
+      runcount = data & 0x3F;             /* Get run count    */
+      if (!iBinBufferGetByte(buffer, &runvalue))
+        return IM_ERR_ACCESS;
+
+      /* Write the pixel run to the buffer */
+      if (runcount > BufferSize - index)
+        runcount = BufferSize - index;
+      memset(DecodedBuffer + index, runvalue, runcount);
+      index += runcount;
     }
     else                                    /* One unsigned char code    */
-    {
-      runcount = 1;                       /* Run count is one */
-      runvalue = data;                    /* Pixel value      */
-    }
-
-    if (imBinFileError(handle))
-      return IM_ERR_ACCESS;
-
-    /* Write the pixel run to the buffer */
-    for (;runcount && (index < BufferSize); runcount--, index++)
-      DecodedBuffer[index] = runvalue;    /* Assign value to buffer   */
+      DecodedBuffer[index++] = (unsigned char)data;
   }
 
   return IM_ERR_NONE;      
@@ -326,7 +327,7 @@ int imFileFormatPCX::ReadImageInfo(int index)
   {
     this->file_color_mode = IM_RGB;
     this->file_color_mode |= IM_PACKED;
-    this->line_buffer_extra += 3*this->width; // room for 24 bpp packing
+    this->line_buffer_extra += this->line_raw_size; // room for 24 bpp packing, including the line padding
   }
   else
   {
@@ -565,7 +566,7 @@ void imFileFormatPCX::Expand4bpp()
     }
   }
 
-  memcpy(this->line_buffer, in_data + this->line_buffer_size+2, this->width);
+  memmove(this->line_buffer, in_data + this->line_buffer_size+2, this->width);
 }
 
 void imFileFormatPCX::Pack24bpp()
@@ -586,7 +587,7 @@ void imFileFormatPCX::Pack24bpp()
     *out_data++ = *blue++;
   }
 
-  memcpy(in_data, in_data + this->line_buffer_size+2, this->line_raw_size);
+  memmove(in_data, in_data + this->line_buffer_size+2, this->line_raw_size);
 }
 
 void imFileFormatPCX::Unpack24bpp()
@@ -607,7 +608,7 @@ void imFileFormatPCX::Unpack24bpp()
     *blue++ = *in_data++;
   }
 
-  memcpy(out_data - (this->line_buffer_size+2), out_data, this->line_raw_size);
+  memmove(out_data - (this->line_buffer_size+2), out_data, this->line_raw_size);
 }
 
 int imFileFormatPCX::ReadImageData(void* data)
@@ -616,13 +617,20 @@ int imFileFormatPCX::ReadImageData(void* data)
 
   imBinFileSeekTo(handle, 128);
 
+  iBinBuffer buffer = {0};
+  if (this->comp_type && !iBinBufferInit(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
   for (int row = 0; row < this->height; row++)
   {
     /* read and decompress the data */
     if (this->comp_type)
     {
-      if (iPCXDecodeScanLine(handle, (imbyte*)this->line_buffer, this->line_raw_size) == IM_ERR_ACCESS)
+      if (iPCXDecodeScanLine(&buffer, (imbyte*)this->line_buffer, this->line_raw_size) == IM_ERR_ACCESS)
+      {
+        iBinBufferRelease(&buffer);
         return IM_ERR_ACCESS;     
+      }
     }
     else
     {
@@ -640,9 +648,16 @@ int imFileFormatPCX::ReadImageData(void* data)
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
+    {
+      if (this->comp_type)
+        iBinBufferRelease(&buffer);
       return IM_ERR_COUNTER;
+    }
   }
 
+  if (this->comp_type)
+    iBinBufferRelease(&buffer);
+
   return IM_ERR_NONE;
 }
 
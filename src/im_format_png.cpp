@@ -15,7 +15,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "png.h"
+#include "zlib.h"
 
 
 static void png_user_read_fn(png_structp png_ptr, png_bytep buffer, png_size_t size)
@@ -51,10 +56,15 @@ class imFileFormatPNG: public imFileFormatBase
 
   imBinFile* handle;
   int interlace_steps, fixbits;
+  int zip_level, zip_strategy, filters;
 
   void iReadAttrib(imAttribTable* attrib_table);
   void iWriteAttrib(imAttribTable* attrib_table);
 
+#ifdef _OPENMP
+  int WriteImageDataParallel(void* data);
+#endif
+
 public:
   imFileFormatPNG(const imFormat* _iformat): imFileFormatBase(_iformat) {}
   ~imFileFormatPNG() {}
@@ -65,8 +75,10 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
 };
 
 class imFormatPNG: public imFormat
@@ -123,6 +135,9 @@ int imFileFormatPNG::Open(const char* file_name)
     return IM_ERR_FORMAT;
   }
 
+  /* created in ReadImageInfo, the file can be closed before */
+  this->info_ptr = NULL;
+
   return IM_ERR_NONE;
 }
 
@@ -139,6 +154,8 @@ int imFileFormatPNG::New(const char* file_name)
     return IM_ERR_ACCESS;
   }
 
+  this->info_ptr = NULL;
+
   strcpy(this->compression, "DEFLATE");
   this->image_count = 1;
   
@@ -365,11 +382,16 @@ void imFileFormatPNG::iReadAttrib(imAttribTable* attrib_table)
   }
 }
 
-static int iAttribStringCount = 0;
+/* kept per call, files can be written by several threads */
+struct iPNGTextList
+{
+  png_text text[512];
+  int count;
+};
 
 static int iFindAttribString(void* user_data, int index, const char* name, int data_type, int count, const void* data)
 {
-  png_textp text_ptr = (png_textp)user_data;
+  iPNGTextList* text_list = (iPNGTextList*)user_data;
   (void)index;
 
   if (data_type == IM_BYTE && count > 3 && ((imbyte*)data)[count-1] == 0)
@@ -380,10 +402,15 @@ static int iFindAttribString(void* user_data, int index, const char* name, int d
         imStrEqual(name, "CalibrationName") ||
         imStrEqual(name, "CalibrationParam") ||
         imStrEqual(name, "ICCProfile") ||
-        imStrEqual(name, "ScaleUnit"))
+        imStrEqual(name, "ScaleUnit") ||
+        imStrEqual(name, "ZIPStrategy") ||
+        imStrEqual(name, "PNGFilter"))
       return 1;
     
-    png_textp png_text = &text_ptr[iAttribStringCount];
+    if (text_list->count == 512)
+      return 0;
+
+    png_textp png_text = &text_list->text[text_list->count];
 
     png_text->key = (char*)name;
     png_text->text = (char*)data;
@@ -394,7 +421,7 @@ static int iFindAttribString(void* user_data, int index, const char* name, int d
     else
       png_text->compression = PNG_TEXT_COMPRESSION_zTXt;
 
-    iAttribStringCount++;
+    text_list->count++;
   }
 
   return 1;
@@ -559,11 +586,11 @@ void imFileFormatPNG::iWriteAttrib(imAttribTable* attrib_table)
     }
   }
   
-  iAttribStringCount = 0;
-  png_text text_ptr[512];
-  attrib_table->ForEach(text_ptr, iFindAttribString);
-  if (iAttribStringCount)
-    png_set_text(png_ptr, info_ptr, text_ptr, iAttribStringCount);
+  iPNGTextList text_list;
+  text_list.count = 0;
+  attrib_table->ForEach(&text_list, iFindAttribString);
+  if (text_list.count)
+    png_set_text(png_ptr, info_ptr, text_list.text, text_list.count);
 
   attrib_data = attrib_table->Get("DateTimeModified");
   if (attrib_data)
@@ -792,9 +819,65 @@ int imFileFormatPNG::WriteImageInfo()
     png_set_PLTE(png_ptr, info_ptr, pal, this->palette_count);
   }
 
+  this->zip_level = Z_DEFAULT_COMPRESSION;
   int* quality = (int*)attrib_table->Get("ZIPQuality");
   if (quality)
+  {
+    this->zip_level = *quality;
     png_set_compression_level(png_ptr, *quality);
+  }
+
+  /* same default as libpng */
+  if (color_type == PNG_COLOR_TYPE_PALETTE || bit_depth < 8)
+    this->filters = PNG_FILTER_NONE;
+  else
+    this->filters = PNG_ALL_FILTERS;
+
+  char* filter = (char*)attrib_table->Get("PNGFilter");
+  if (filter)
+  {
+    if (imStrEqual(filter, "NONE"))
+      this->filters = PNG_FILTER_NONE;
+    else if (imStrEqual(filter, "SUB"))
+      this->filters = PNG_FILTER_SUB;
+    else if (imStrEqual(filter, "UP"))
+      this->filters = PNG_FILTER_UP;
+    else if (imStrEqual(filter, "AVERAGE"))
+      this->filters = PNG_FILTER_AVG;
+    else if (imStrEqual(filter, "PAETH"))
+      this->filters = PNG_FILTER_PAETH;
+    else if (imStrEqual(filter, "ADAPTIVE"))
+      this->filters = PNG_ALL_FILTERS;
+    else
+      return IM_ERR_DATA;
+
+    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, this->filters);
+  }
+
+  /* same default as libpng */
+  if (this->filters == PNG_FILTER_NONE)
+    this->zip_strategy = Z_DEFAULT_STRATEGY;
+  else
+    this->zip_strategy = Z_FILTERED;
+
+  char* strategy = (char*)attrib_table->Get("ZIPStrategy");
+  if (strategy)
+  {
+    if (imStrEqual(strategy, "DEFAULT"))
+      this->zip_strategy = Z_DEFAULT_STRATEGY;
+    else if (imStrEqual(strategy, "FILTERED"))
+      this->zip_strategy = Z_FILTERED;
+    else if (imStrEqual(strategy, "HUFFMAN"))
+      this->zip_strategy = Z_HUFFMAN_ONLY;
+    else if (imStrEqual(strategy, "RLE"))
+      this->zip_strategy = Z_RLE;
+    else if (imStrEqual(strategy, "FIXED"))
+      this->zip_strategy = Z_FIXED;
+    else
+      return IM_ERR_DATA;
+
+    png_set_compression_strategy(png_ptr, this->zip_strategy);
+  }
 
   iWriteAttrib(attrib_table);
 
@@ -843,6 +926,20 @@ static int iInterlaceRowCheck(int row_step, int pass)
   return 0;
 }
 
+static void iPNGFixBits(imbyte* buf, int size, int fixbits)
+{
+  /* expands 2 and 4 bits gray values to 0-255 */
+  for (int b = 0; b < size; b++)
+  {
+    if (fixbits == 4)
+      *buf *= 17;
+    else
+      *buf *= 85;
+
+    buf++;
+  }
+}
+
 int imFileFormatPNG::ReadImageData(void* data)
 {
   if (setjmp(png_jmpbuf(this->png_ptr)))
@@ -851,31 +948,34 @@ int imFileFormatPNG::ReadImageData(void* data)
   int count = this->height*this->interlace_steps;
   imCounterTotal(this->counter, count, "Reading PNG...");
 
+  /* decode directly in the application buffer when possible, 
+     when interlaced the previous passes are already there. */
+  int direct = png_get_rowbytes(this->png_ptr, this->info_ptr) <= (png_size_t)this->line_buffer_size;
+
   int row = 0;
   for (int i = 0; i < count; i++)
   {
-    if (this->interlace_steps > 1 && ((row % 8) % 2 == 0)) // only when interlaced and in the 2,4,6 row steps.
-      imFileLineBufferWrite(this, data, row, 0);
+    imbyte* line_buffer = direct? (imbyte*)imFileLineBufferDirect(this, data, row, 0): NULL;
+    if (!line_buffer)
+    {
+      line_buffer = (imbyte*)this->line_buffer;
+
+      if (this->interlace_steps > 1 && ((row % 8) % 2 == 0)) // only when interlaced and in the 2,4,6 row steps.
+        imFileLineBufferWrite(this, data, row, 0);
+    }
 
-    png_read_row(this->png_ptr, (imbyte*)this->line_buffer, NULL);
+    /* must be obtained before reading, at the last row the pass is incremented */
+    int pass = png_get_current_pass_number(this->png_ptr);
 
-    if (this->interlace_steps == 1 || iInterlaceRowCheck(row % 8, png_get_current_pass_number(png_ptr)+1))
+    png_read_row(this->png_ptr, line_buffer, NULL);
+
+    if (this->interlace_steps == 1 || iInterlaceRowCheck(row % 8, pass+1))
     {
       if (this->fixbits)
-      {
-        unsigned char* buf = (unsigned char*)this->line_buffer;
-        for (int b = 0; b < this->line_buffer_size; b++)
-        {
-          if (this->fixbits == 4)
-            *buf *= 17;
-          else
-            *buf *= 85;
+        iPNGFixBits(line_buffer, this->line_buffer_size, this->fixbits);
 
-          buf++;
-        }
-      }
-
-      imFileLineBufferRead(this, data, row, 0);
+      if (line_buffer == this->line_buffer)
+        imFileLineBufferRead(this, data, row, 0);
     }
 
     if (!imCounterInc(this->counter))
@@ -894,11 +994,396 @@ int imFileFormatPNG::ReadImageData(void* data)
   return IM_ERR_NONE;
 }
 
+int imFileFormatPNG::ReadImageLines(void* data, int first_line, int count)
+{
+  /* each interlace pass updates all the lines */
+  if (this->interlace_steps != 1)
+    return IM_ERR_DATA;
+
+  if (setjmp(png_jmpbuf(this->png_ptr)))
+    return IM_ERR_ACCESS;
+
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->height, "Reading PNG...");
+
+  /* decode directly in the application buffer when possible */
+  int direct = png_get_rowbytes(this->png_ptr, this->info_ptr) <= (png_size_t)this->line_buffer_size;
+
+  for (int row = first_line; row < first_line + count; row++)
+  {
+    imbyte* line_buffer = direct? (imbyte*)imFileLineBufferDirect(this, data, row, 0): NULL;
+    if (!line_buffer)
+      line_buffer = (imbyte*)this->line_buffer;
+
+    png_read_row(this->png_ptr, line_buffer, NULL);
+
+    if (this->fixbits)
+      iPNGFixBits(line_buffer, this->line_buffer_size, this->fixbits);
+
+    if (line_buffer == this->line_buffer)
+      imFileLineBufferRead(this, data, row, 0);
+
+    if (!imCounterInc(this->counter))
+    {
+      png_read_end(this->png_ptr, NULL);
+      return IM_ERR_COUNTER;
+    }
+  }
+
+  if (first_line + count == this->height)
+    png_read_end(this->png_ptr, NULL);
+
+  return IM_ERR_NONE;
+}
+
+#ifdef _OPENMP
+
+/* Parallel compression.
+ * The image is split in blocks of rows that are filtered and compressed 
+ * independently, each block ends at a byte boundary (Z_SYNC_FLUSH) 
+ * so the blocks can be concatenated in a single zlib stream (same as pigz -i). 
+ * The zlib header and the Adler-32 checksum are computed here, 
+ * and the stream is written in IDAT chunks. */
+
+static const int iPNGParallelMinCount = 250000;   /* 500*500 image size, same as im_process */
+static const int iPNGBlockMinSize = 262144;       /* uncompressed bytes per block */
+
+struct iPNGBlock
+{
+  int first_row, row_count;
+  unsigned char* buffer;    /* compressed data */
+  size_t size;
+  uLong adler, raw_size;
+};
+
+static inline int iPNGPaeth(int a, int b, int c)
+{
+  int p = b - c;
+  int pc = a - c;
+  int pa = p < 0? -p: p;
+  int pb = pc < 0? -pc: pc;
+  pc = (p + pc) < 0? -(p + pc): (p + pc);
+
+  if (pa <= pb && pa <= pc)
+    return a;
+  else if (pb <= pc)
+    return b;
+  else
+    return c;
+}
+
+/* Filters one row using one filter type, 
+   returns the sum of the absolute signed values (libpng heuristic) */
+static unsigned long iPNGFilterRow(int filter_type, const imbyte* row, const imbyte* prev_row, imbyte* out, int rowbytes, int bpp)
+{
+  unsigned long sum = 0;
+  *out = (imbyte)filter_type;
+  out++;
+
+  for (int i = 0; i < rowbytes; i++)
+  {
+    int a = i >= bpp? row[i - bpp]: 0;
+    int b = prev_row? prev_row[i]: 0;
+    int c = (prev_row && i >= bpp)? prev_row[i - bpp]: 0;
+    int v;
+
+    switch (filter_type)
+    {
+    case PNG_FILTER_VALUE_SUB:
+      v = row[i] - a;
+      break;
+    case PNG_FILTER_VALUE_UP:
+      v = row[i] - b;
+      break;
+    case PNG_FILTER_VALUE_AVG:
+      v = row[i] - ((a + b) >> 1);
+      break;
+    case PNG_FILTER_VALUE_PAETH:
+      v = row[i] - iPNGPaeth(a, b, c);
+      break;
+    default:
+      v = row[i];
+      break;
+    }
+
+    out[i] = (imbyte)v;
+    v = (signed char)out[i];
+    sum += v < 0? -v: v;
+  }
+
+  return sum;
+}
+
+/* Filters one row using the best of the selected filters */
+static void iPNGFilter(int filters, const imbyte* row, const imbyte* prev_row, imbyte* out, imbyte* try_buffer, int rowbytes, int bpp)
+{
+  static const int filter_flag[PNG_FILTER_VALUE_LAST] = {PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH};
+  unsigned long min_sum = 0;
+  int found = 0;
+
+  for (int f = 0; f < PNG_FILTER_VALUE_LAST; f++)
+  {
+    if (!(filters & filter_flag[f]))
+      continue;
+
+    unsigned long sum = iPNGFilterRow(f, row, prev_row, try_buffer, rowbytes, bpp);
+    if (!found || sum < min_sum)
+    {
+      memcpy(out, try_buffer, rowbytes + 1);
+      min_sum = sum;
+      found = 1;
+    }
+  }
+
+  if (!found)
+    iPNGFilterRow(PNG_FILTER_VALUE_NONE, row, prev_row, out, rowbytes, bpp);
+}
+
+static void iPNGSwapRow(imbyte* row, int rowbytes)
+{
+  for (int i = 0; i < rowbytes; i += 2)
+  {
+    imbyte t = row[i];
+    row[i] = row[i+1];
+    row[i+1] = t;
+  }
+}
+
+static int iPNGCounterInc(int counter, volatile int* processing)
+{
+  int ret;
+
+#pragma omp critical (imPNGCounter)
+  {
+    ret = *processing;
+    if (ret && !imCounterInc(counter))
+    {
+      *processing = 0;
+      ret = 0;
+    }
+  }
+
+  return ret;
+}
+
+static int iPNGCompressBlock(imFile* ifile, const void* data, iPNGBlock* block, int last_block,
+                             int rowbytes, int bpp, int swap16, int filters, int level, int strategy, 
+                             volatile int* processing)
+{
+  int line_alloc = IM_MAX(ifile->line_buffer_alloc, rowbytes);
+  uLong raw_size = (uLong)block->row_count * (rowbytes + 1);
+
+  imbyte* row = (imbyte*)malloc(line_alloc);
+  imbyte* prev_row = (imbyte*)malloc(line_alloc);
+  imbyte* try_buffer = (imbyte*)malloc(rowbytes + 1);
+  imbyte* raw_buffer = (imbyte*)malloc(raw_size);
+  if (!row || !prev_row || !try_buffer || !raw_buffer)
+  {
+    free(row); free(prev_row); free(try_buffer); free(raw_buffer);
+    return IM_ERR_MEM;
+  }
+
+  /* the previous row is used by the filters */
+  if (block->first_row > 0)
+  {
+    imFileLineBufferWriteBuffer(ifile, data, prev_row, block->first_row - 1, 0);
+    if (swap16)
+      iPNGSwapRow(prev_row, rowbytes);
+  }
+
+  int error = IM_ERR_NONE;
+  imbyte* raw = raw_buffer;
+  for (int r = 0; r < block->row_count; r++)
+  {
+    imFileLineBufferWriteBuffer(ifile, data, row, block->first_row + r, 0);
+    if (swap16)
+      iPNGSwapRow(row, rowbytes);
+
+    iPNGFilter(filters, row, (block->first_row + r > 0)? prev_row: NULL, raw, try_buffer, rowbytes, bpp);
+    raw += rowbytes + 1;
+
+    imbyte* t = row; row = prev_row; prev_row = t;
+
+    if (!iPNGCounterInc(ifile->counter, processing))
+    {
+      error = IM_ERR_COUNTER;
+      break;
+    }
+  }
+
+  free(row); free(prev_row); free(try_buffer);
+
+  if (error != IM_ERR_NONE)
+  {
+    free(raw_buffer);
+    return error;
+  }
+
+  block->raw_size = raw_size;
+  block->adler = adler32(adler32(0L, Z_NULL, 0), raw_buffer, (uInt)raw_size);
+
+  z_stream zstream;
+  memset(&zstream, 0, sizeof(z_stream));
+  if (deflateInit2(&zstream, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)  /* raw deflate, no header */
+  {
+    free(raw_buffer);
+    return IM_ERR_ACCESS;
+  }
+
+  size_t alloc = deflateBound(&zstream, raw_size) + 64;
+  block->buffer = (unsigned char*)malloc(alloc);
+  if (!block->buffer)
+  {
+    deflateEnd(&zstream);
+    free(raw_buffer);
+    return IM_ERR_MEM;
+  }
+
+  zstream.next_in = raw_buffer;
+  zstream.avail_in = (uInt)raw_size;
+  zstream.next_out = block->buffer;
+  zstream.avail_out = (uInt)alloc;
+
+  /* only the last block is final, the others are aligned to a byte boundary */
+  int flush = last_block? Z_FINISH: Z_SYNC_FLUSH;
+  int ret = deflate(&zstream, flush);
+  while (ret == Z_OK && zstream.avail_out == 0)
+  {
+    unsigned char* new_buffer = (unsigned char*)realloc(block->buffer, 2*alloc);
+    if (!new_buffer)
+      break;
+
+    block->buffer = new_buffer;
+    zstream.next_out = new_buffer + alloc;
+    zstream.avail_out = (uInt)alloc;
+    alloc *= 2;
+
+    ret = deflate(&zstream, flush);
+  }
+
+  block->size = alloc - zstream.avail_out;
+  deflateEnd(&zstream);
+  free(raw_buffer);
+
+  if (last_block)
+    return (ret == Z_STREAM_END)? IM_ERR_NONE: IM_ERR_ACCESS;
+  else
+    return (ret == Z_OK && zstream.avail_out != 0)? IM_ERR_NONE: IM_ERR_ACCESS;
+}
+
+int imFileFormatPNG::WriteImageDataParallel(void* data)
+{
+  /* Returns -1 when the image can not be compressed in parallel. */
+
+  int thread_count = omp_get_max_threads();
+  if (thread_count < 2 || 
+      this->interlace_steps != 1 ||
+      this->width * this->height < iPNGParallelMinCount)
+    return -1;
+
+  int rowbytes = (int)png_get_rowbytes(this->png_ptr, this->info_ptr);
+  int bpp = (png_get_channels(this->png_ptr, this->info_ptr) * png_get_bit_depth(this->png_ptr, this->info_ptr) + 7) / 8;
+  int swap16 = (this->file_data_type == IM_USHORT && imBinCPUByteOrder() == IM_LITTLEENDIAN);
+
+  int block_rows = (iPNGBlockMinSize + rowbytes) / (rowbytes + 1);
+  int block_count = (this->height + block_rows-1) / block_rows;
+  if (block_count < 2)
+    return -1;
+
+  imCounterTotal(this->counter, this->height, "Writing PNG...");
+
+  /* zlib header, same as deflateInit */
+  int level = (this->zip_level == Z_DEFAULT_COMPRESSION)? 6: this->zip_level;
+  unsigned char header[2];
+  header[0] = 0x78;  /* deflate, 32K window */
+  header[1] = (unsigned char)((level < 2? 0: level < 6? 1: level == 6? 2: 3) << 6);
+  header[1] += (unsigned char)(31 - (header[0]*256 + header[1]) % 31);
+  png_write_chunk(this->png_ptr, (png_const_bytep)"IDAT", header, 2);
+
+  /* blocks are compressed in groups to limit the memory in use */
+  int group_count = 2*thread_count;
+  iPNGBlock* block = new iPNGBlock [group_count];
+
+  uLong adler = adler32(0L, Z_NULL, 0);
+  volatile int processing = 1;
+  int error = IM_ERR_NONE;
+
+  for (int first_block = 0; first_block < block_count && error == IM_ERR_NONE; first_block += group_count)
+  {
+    int count = IM_MIN(group_count, block_count - first_block);
+
+    for (int b = 0; b < count; b++)
+    {
+      block[b].first_row = (first_block + b) * block_rows;
+      block[b].row_count = IM_MIN(block_rows, this->height - block[b].first_row);
+      block[b].buffer = NULL;
+      block[b].size = 0;
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < count; b++)
+    {
+      if (!processing)
+        continue;
+
+      int ret = iPNGCompressBlock(this, data, block + b, first_block + b == block_count-1, 
+                                  rowbytes, bpp, swap16, this->filters, this->zip_level, this->zip_strategy, 
+                                  &processing);
+      if (ret != IM_ERR_NONE)
+      {
+#pragma omp critical (imPNGCounter)
+        {
+          if (error == IM_ERR_NONE)
+            error = ret;
+          processing = 0;
+        }
+      }
+    }
+
+    for (int b = 0; b < count; b++)
+    {
+      if (error == IM_ERR_NONE)
+      {
+        png_write_chunk(this->png_ptr, (png_const_bytep)"IDAT", block[b].buffer, block[b].size);
+        adler = adler32_combine(adler, block[b].adler, (z_off_t)block[b].raw_size);
+      }
+
+      free(block[b].buffer);
+    }
+  }
+
+  delete [] block;
+
+  if (error != IM_ERR_NONE)
+    return error;
+
+  unsigned char adler_buffer[4];
+  adler_buffer[0] = (unsigned char)(adler >> 24);
+  adler_buffer[1] = (unsigned char)(adler >> 16);
+  adler_buffer[2] = (unsigned char)(adler >> 8);
+  adler_buffer[3] = (unsigned char)(adler);
+  png_write_chunk(this->png_ptr, (png_const_bytep)"IDAT", adler_buffer, 4);
+
+  /* png_write_end can not be used because the IDAT chunks were not written by libpng,
+     the other chunks were already written by png_write_info. */
+  png_write_chunk(this->png_ptr, (png_const_bytep)"IEND", NULL, 0);
+
+  return IM_ERR_NONE;
+}
+
+#endif
+
 int imFileFormatPNG::WriteImageData(void* data)
 {
   if (setjmp(png_jmpbuf(this->png_ptr)))
     return IM_ERR_ACCESS;
 
+#ifdef _OPENMP
+  int error = WriteImageDataParallel(data);
+  if (error != -1)
+    return error;
+#endif
+
   int count = this->height*this->interlace_steps;
   imCounterTotal(this->counter, count, "Writing PNG...");
 
@@ -925,6 +1410,37 @@ int imFileFormatPNG::WriteImageData(void* data)
   return IM_ERR_NONE;
 }
 
+int imFileFormatPNG::WriteImageLines(void* data, int first_line, int count)
+{
+  /* each interlace pass needs all the lines */
+  if (this->interlace_steps != 1)
+    return IM_ERR_DATA;
+
+  if (setjmp(png_jmpbuf(this->png_ptr)))
+    return IM_ERR_ACCESS;
+
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->height, "Writing PNG...");
+
+  for (int row = first_line; row < first_line + count; row++)
+  {
+    imFileLineBufferWrite(this, data, row, 0);
+
+    png_write_row(this->png_ptr, (imbyte*)this->line_buffer);
+
+    if (!imCounterInc(this->counter))
+    {
+      png_write_end(this->png_ptr, this->info_ptr);
+      return IM_ERR_COUNTER;
+    }
+  }
+
+  if (first_line + count == this->height)
+    png_write_end(this->png_ptr, this->info_ptr);
+
+  return IM_ERR_NONE;
+}
+
 int imFormatPNG::CanWrite(const char* compression, int color_mode, int data_type) const
 {
   int color_space = imColorModeSpace(color_mode);
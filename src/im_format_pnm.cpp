@@ -10,6 +10,7 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -85,8 +86,10 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
 };
 
 class imFormatPNM: public imFormat
@@ -318,9 +321,85 @@ void imFileFormatPNM::FixBinary()
   }
 }
 
+/* plain PBM values are single digits, that may not be separated by white space */
+static int iPNMReadBit(iBinBuffer* buffer, int *value)
+{
+  int c;
+  do
+  {
+    if (!iBinBufferGetByte(buffer, &c))
+      return 0;
+  } while (c != '0' && c != '1');
+
+  *value = c - '0';
+  return 1;
+}
+
+static int iPNMReadAsciiLine(iBinBuffer* buffer, void* line_buffer, int line_count, int image_type, int data_type)
+{
+  int value;
+  for (int col = 0; col < line_count; col++)
+  {
+    if (image_type == '1')
+    {
+      if (!iPNMReadBit(buffer, &value))
+        return 0;
+
+      value = 1 - value;
+    }
+    else if (!iBinBufferReadInteger(buffer, &value))
+      return 0;
+
+    if (data_type == IM_USHORT)
+      ((imushort*)line_buffer)[col] = (imushort)value;
+    else
+      ((imbyte*)line_buffer)[col] = (unsigned char)value;
+  }
+
+  return 1;
+}
+
+static int iPNMWriteAsciiLine(iBinBuffer* buffer, const void* line_buffer, int line_count, int image_type, int data_type)
+{
+  int line_size = 0;
+  for (int col = 0; col < line_count; col++)
+  {
+    int value;
+    if (data_type == IM_USHORT)
+      value = ((imushort*)line_buffer)[col];
+    else
+      value = ((imbyte*)line_buffer)[col];
+
+    if (image_type == '1' && value < 2)
+      value = 1 - value;
+
+    int write_size = iBinBufferPrintInteger(buffer, value, ' ');
+    if (!write_size)
+      return 0;
+
+    line_size += write_size;
+
+    // No line should be longer than 70 characters. 
+    if (line_size > 60 || col == line_count-1)
+    {
+      line_size = 0;
+      if (!iBinBufferWrite(buffer, "\n", 1))
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
 int imFileFormatPNM::ReadImageData(void* data)
 {
-  imCounterTotal(this->counter, this->height, "Reading PNM...");
+  return ReadImageLines(data, 0, this->height);
+}
+
+int imFileFormatPNM::ReadImageLines(void* data, int first_line, int count)
+{
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->height, "Reading PNM...");
 
   int line_count = imImageLineCount(this->width, this->file_color_mode);
 
@@ -334,23 +413,19 @@ int imFileFormatPNM::ReadImageData(void* data)
   if (this->image_type == '1' || this->image_type == '2' || this->image_type == '3')
     ascii = 1;
 
-  for (int row = 0; row < this->height; row++)
+  /* the ASCII values are read in blocks */
+  iBinBuffer buffer = {0};
+  if (ascii && !iBinBufferInit(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
+  for (int row = first_line; row < first_line + count; row++)
   {
     if (ascii)
     {
-      int value;
-      for (int col = 0; col < line_count; col++)
+      if (!iPNMReadAsciiLine(&buffer, this->line_buffer, line_count, this->image_type, this->file_data_type))
       {
-        if (!imBinFileReadInteger(handle, &value))
-          return IM_ERR_ACCESS;
-
-        if (this->image_type == '1' && value < 2)
-          value = 1 - value;
-
-        if (this->file_data_type == IM_USHORT)
-          ((imushort*)this->line_buffer)[col] = (imushort)value;
-        else
-          ((imbyte*)this->line_buffer)[col] = (unsigned char)value;
+        iBinBufferRelease(&buffer);
+        return IM_ERR_ACCESS;
       }
     }
     else
@@ -367,9 +442,22 @@ int imFileFormatPNM::ReadImageData(void* data)
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
+    {
+      if (ascii) iBinBufferRelease(&buffer);
       return IM_ERR_COUNTER;
+    }
+  }
+
+  if (ascii)
+  {
+    /* the next lines or the next image start after the consumed data */
+    iBinBufferSync(&buffer);
+    iBinBufferRelease(&buffer);
   }
 
+  if (first_line + count < this->height)
+    return IM_ERR_NONE;
+
   // try to find another image, ignore errors from here
 
   /* reads the PNM format identifier */
@@ -396,7 +484,13 @@ int imFileFormatPNM::ReadImageData(void* data)
 
 int imFileFormatPNM::WriteImageData(void* data)
 {
-  imCounterTotal(this->counter, this->height, "Writing PNM...");
+  return WriteImageLines(data, 0, this->height);
+}
+
+int imFileFormatPNM::WriteImageLines(void* data, int first_line, int count)
+{
+  if (first_line == 0)
+    imCounterTotal(this->counter, this->height, "Writing PNM...");
 
   int line_count = imImageLineCount(this->width, this->file_color_mode);
 
@@ -410,36 +504,22 @@ int imFileFormatPNM::WriteImageData(void* data)
   if (this->image_type == '1' || this->image_type == '2' || this->image_type == '3')
     ascii = 1;
 
-  for (int row = 0; row < this->height; row++)
+  /* the ASCII values are written in blocks */
+  iBinBuffer buffer = {0};
+  if (ascii && !iBinBufferInitWrite(&buffer, handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
+  int error = IM_ERR_NONE;
+  for (int row = first_line; row < first_line + count; row++)
   {
     imFileLineBufferWrite(this, data, row, 0);
 
     if (ascii)
     {
-      int line_size = 0;
-      for (int col = 0; col < line_count; col++)
+      if (!iPNMWriteAsciiLine(&buffer, this->line_buffer, line_count, this->image_type, this->file_data_type))
       {
-        int value;
-        if (this->file_data_type == IM_USHORT)
-          value = ((imushort*)this->line_buffer)[col];
-        else
-          value = ((imbyte*)this->line_buffer)[col];
-
-        if (this->image_type == '1' && value < 2)
-          value = 1 - value;
-
-        int write_size = imBinFilePrintf(handle, "%d ", value);
-        if (!write_size)
-          return IM_ERR_ACCESS;
-
-        line_size += write_size;
-
-        // No line should be longer than 70 characters. 
-        if (line_size > 60 || col == line_count-1)
-        {
-          line_size = 0;
-          imBinFileWrite(handle, (void*)"\n", 1, 1);
-        }
+        error = IM_ERR_ACCESS;
+        break;
       }
     }
     else
@@ -451,13 +531,26 @@ int imFileFormatPNM::WriteImageData(void* data)
     }
 
     if (imBinFileError(handle))
-      return IM_ERR_ACCESS;     
+    {
+      error = IM_ERR_ACCESS;
+      break;
+    }
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    {
+      error = IM_ERR_COUNTER;
+      break;
+    }
   }
 
-  return IM_ERR_NONE;
+  if (ascii)
+  {
+    if (!iBinBufferFlush(&buffer) && error == IM_ERR_NONE)
+      error = IM_ERR_ACCESS;
+    iBinBufferRelease(&buffer);
+  }
+
+  return error;
 }
 
 int imFormatPNM::CanWrite(const char* compression, int color_mode, int data_type) const
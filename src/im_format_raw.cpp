@@ -10,6 +10,7 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -37,8 +38,10 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
 };
 
 class imFormatRAW: public imFormat
@@ -200,9 +203,78 @@ static int iFileDataTypeSize(int file_data_type, int switch_type)
   return type_size;
 }
 
+/* complex values are read as 2 real values */
+static int iRAWReadAsciiLine(iBinBuffer* buffer, void* line_buffer, int line_count, int data_type)
+{
+  for (int col = 0; col < line_count; col++)
+  {
+    if (data_type == IM_FLOAT || data_type == IM_CFLOAT)
+    {
+      float value;
+      if (!iBinBufferReadFloat(buffer, &value))
+        return 0;
+
+      ((float*)line_buffer)[col] = value;
+    }
+    else
+    {
+      int value;
+      if (!iBinBufferReadInteger(buffer, &value))
+        return 0;
+
+      if (data_type == IM_INT)
+        ((int*)line_buffer)[col] = value;
+      else if (data_type == IM_SHORT)
+        ((short*)line_buffer)[col] = (short)value;
+      else if (data_type == IM_USHORT)
+        ((imushort*)line_buffer)[col] = (imushort)value;
+      else
+        ((imbyte*)line_buffer)[col] = (unsigned char)value;
+    }
+  }
+
+  return 1;
+}
+
+static int iRAWWriteAsciiLine(iBinBuffer* buffer, const void* line_buffer, int line_count, int data_type)
+{
+  for (int col = 0; col < line_count; col++)
+  {
+    if (data_type == IM_FLOAT || data_type == IM_CFLOAT)
+    {
+      float value = ((float*)line_buffer)[col];
+
+      if (!iBinBufferPrintf(buffer, "%f ", (double)value))
+        return 0;
+    }
+    else
+    {
+      int value;
+      if (data_type == IM_INT)
+        value = ((int*)line_buffer)[col];
+      else if (data_type == IM_SHORT)
+        value = ((short*)line_buffer)[col];
+      else if (data_type == IM_USHORT)
+        value = ((imushort*)line_buffer)[col];
+      else
+        value = ((imbyte*)line_buffer)[col];
+
+      if (!iBinBufferPrintInteger(buffer, value, ' '))
+        return 0;
+    }
+  }
+
+  return iBinBufferWrite(buffer, "\n", 1);
+}
+
 int imFileFormatRAW::ReadImageData(void* data)
 {
-  int count = imFileLineBufferCount(this);
+  /* includes the lines of all the planes */
+  return ReadImageLines(data, 0, imFileLineBufferCount(this));
+}
+
+int imFileFormatRAW::ReadImageLines(void* data, int first_line, int count)
+{
   int line_count = imImageLineCount(this->width, this->file_color_mode);
   int type_size = iFileDataTypeSize(this->file_data_type, this->switch_type);
 
@@ -219,65 +291,80 @@ int imFileFormatRAW::ReadImageData(void* data)
   else
     ascii = 0;
 
-  imCounterTotal(this->counter, count, "Reading RAW...");
+  /* the ASCII values are read in blocks */
+  iBinBuffer buffer = {0};
+  if (ascii && !iBinBufferInit(&buffer, this->handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
+  if (first_line == 0)
+    imCounterTotal(this->counter, imFileLineBufferCount(this), "Reading RAW...");
 
-  int row = 0, plane = 0;
+  int error = IM_ERR_NONE;
+  int row = first_line, plane = 0;
   for (int i = 0; i < count; i++)
   {
+    /* read directly in the application buffer when possible */
+    void* line_buffer = imFileLineBufferDirect(this, data, row, plane);
+    if (!line_buffer)
+      line_buffer = this->line_buffer;
+
     if (ascii)
     {
-      for (int col = 0; col < line_count; col++)
+      if (!iRAWReadAsciiLine(&buffer, line_buffer, line_count, this->file_data_type))
       {
-        if (this->file_data_type == IM_FLOAT)
-        {
-          float value;
-          if (!imBinFileReadFloat(handle, &value))
-            return IM_ERR_ACCESS;
-
-          ((float*)this->line_buffer)[col] = value;
-        }
-        else
-        {
-          int value;
-          if (!imBinFileReadInteger(handle, &value))
-            return IM_ERR_ACCESS;
-
-          if (this->file_data_type == IM_INT)
-            ((int*)this->line_buffer)[col] = value;
-          else if (this->file_data_type == IM_SHORT)
-            ((short*)this->line_buffer)[col] = (short)value;
-          else if (this->file_data_type == IM_USHORT)
-            ((imushort*)this->line_buffer)[col] = (imushort)value;
-          else
-            ((imbyte*)this->line_buffer)[col] = (unsigned char)value;
-        }
+        error = IM_ERR_ACCESS;
+        break;
       }
     }
     else
     {
-      imBinFileRead(this->handle, (imbyte*)this->line_buffer, line_count, type_size);
+      imBinFileRead(this->handle, (imbyte*)line_buffer, line_count, type_size);
 
       if (imBinFileError(this->handle))
-        return IM_ERR_ACCESS;
+      {
+        error = IM_ERR_ACCESS;
+        break;
+      }
     }
 
-    imFileLineBufferRead(this, data, row, plane);
+    if (line_buffer == this->line_buffer)
+      imFileLineBufferRead(this, data, row, plane);
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    {
+      error = IM_ERR_COUNTER;
+      break;
+    }
 
     imFileLineBufferInc(this, &row, &plane);
 
     if (this->padding)
-      imBinFileSeekOffset(this->handle, this->padding);
+    {
+      if (ascii)
+        iBinBufferSkip(&buffer, this->padding);
+      else
+        imBinFileSeekOffset(this->handle, this->padding);
+    }
   }
 
-  return IM_ERR_NONE;
+  if (ascii)
+  {
+    iBinBufferSync(&buffer);
+    iBinBufferRelease(&buffer);
+  }
+
+  return error;
 }
 
 int imFileFormatRAW::WriteImageData(void* data)
 {
-  int count = imFileLineBufferCount(this);
+  /* includes the lines of all the planes */
+  return WriteImageLines(data, 0, imFileLineBufferCount(this));
+}
+
+int imFileFormatRAW::WriteImageLines(void* data, int first_line, int count)
+{
+  int total_count = imFileLineBufferCount(this);
   int line_count = imImageLineCount(this->width, this->file_color_mode);
   int type_size = iFileDataTypeSize(this->file_data_type, this->switch_type);
 
@@ -294,42 +381,27 @@ int imFileFormatRAW::WriteImageData(void* data)
   else
     ascii = 0;
 
-  imCounterTotal(this->counter, count, "Writing RAW...");
+  /* the ASCII values are written in blocks */
+  iBinBuffer buffer = {0};
+  if (ascii && !iBinBufferInitWrite(&buffer, this->handle, IM_BINBUFFER_SIZE))
+    return IM_ERR_MEM;
+
+  if (first_line == 0)
+    imCounterTotal(this->counter, total_count, "Writing RAW...");
 
-  int row = 0, plane = 0;
+  int error = IM_ERR_NONE;
+  int row = first_line, plane = 0;
   for (int i = 0; i < count; i++)
   {
     imFileLineBufferWrite(this, data, row, plane);
 
     if (ascii)
     {
-      for (int col = 0; col < line_count; col++)
+      if (!iRAWWriteAsciiLine(&buffer, this->line_buffer, line_count, this->file_data_type))
       {
-        if (this->file_data_type == IM_FLOAT)
-        {
-          float value = ((float*)this->line_buffer)[col];
-
-          if (!imBinFilePrintf(handle, "%f ", (double)value))
-            return IM_ERR_ACCESS;
-        }
-        else
-        {
-          int value;
-          if (this->file_data_type == IM_INT)
-            value = ((int*)this->line_buffer)[col];
-          else if (this->file_data_type == IM_SHORT)
-            value = ((short*)this->line_buffer)[col];
-          else if (this->file_data_type == IM_USHORT)
-            value = ((imushort*)this->line_buffer)[col];
-          else
-            value = ((imbyte*)this->line_buffer)[col];
-
-          if (!imBinFilePrintf(handle, "%d ", value))
-            return IM_ERR_ACCESS;
-        }
+        error = IM_ERR_ACCESS;
+        break;
       }
-
-      imBinFileWrite(handle, (void*)"\n", 1, 1);
     }
     else
     {
@@ -337,18 +409,43 @@ int imFileFormatRAW::WriteImageData(void* data)
     }
 
     if (imBinFileError(this->handle))
-      return IM_ERR_ACCESS;
+    {
+      error = IM_ERR_ACCESS;
+      break;
+    }
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    {
+      error = IM_ERR_COUNTER;
+      break;
+    }
 
     imFileLineBufferInc(this, &row, &plane);
 
     if (this->padding)
+    {
+      if (ascii && !iBinBufferFlush(&buffer))
+      {
+        error = IM_ERR_ACCESS;
+        break;
+      }
+
       imBinFileSeekOffset(this->handle, this->padding);
+    }
   }
 
-  this->image_count++;
+  if (ascii)
+  {
+    if (!iBinBufferFlush(&buffer) && error == IM_ERR_NONE)
+      error = IM_ERR_ACCESS;
+    iBinBufferRelease(&buffer);
+  }
+
+  if (error)
+    return error;
+
+  if (first_line + count == total_count)
+    this->image_count++;
   return IM_ERR_NONE;
 }
 
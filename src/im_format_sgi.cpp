@@ -10,6 +10,7 @@
 #include "im_counter.h"
 
 #include "im_binfile.h"
+#include "im_rle.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -44,13 +45,16 @@
 #define SGI_COLORMAP  3
 
 template <class T> 
-static int iSGIDecodeScanLine(T *optr, const T *iptr, int width)
+static int iSGIDecodeScanLine(T *optr, const T *iptr, const T *iend, int width)
 {
   T pixel;
   int c = 0, count;
 
   while (c < width)
   {
+    if (iptr == iend)
+      return IM_ERR_ACCESS;
+
     pixel = *iptr++;
 
     count = pixel & 0x7f;
@@ -63,15 +67,22 @@ static int iSGIDecodeScanLine(T *optr, const T *iptr, int width)
 
     if (pixel & 0x80)
     {
-      while (count--)
-        *optr++ = *iptr++;
+      if (iend - iptr < count)
+        return IM_ERR_ACCESS;
+
+      memcpy(optr, iptr, count*sizeof(T));
+      iptr += count;
     }
     else
     {
+      if (iptr == iend)
+        return IM_ERR_ACCESS;
+
       pixel = *iptr++;
-      while (count--)
-        *optr++ = pixel;
+      iRLEFill((imbyte*)optr, (const imbyte*)&pixel, sizeof(T), count);
     }
+
+    optr += count;
   }
 
   if (c < width)
@@ -109,8 +120,7 @@ static int iSGIEncodeScanLine(T *optr, const T *iptr, int width)
     sptr = iptr;
     cc = *iptr++;
 
-    while((iptr < ibufend) && (*iptr == cc))
-      iptr++;
+    iptr += iRLERepeatCount((const imbyte*)sptr, sizeof(T), (int)(ibufend-iptr)*sizeof(T)) / sizeof(T);
     count = iptr-sptr;
 
     while(count) 
@@ -140,6 +150,8 @@ class imFileFormatSGI: public imFileFormatBase
   unsigned int *starttab,     /* compression control buffer */
                *lengthtab;    /* compression control buffer */
 
+  int ReadCompressedData(int count, imbyte** buffer, unsigned int *start);
+
 public:
   imFileFormatSGI(const imFormat* _iformat): imFileFormatBase(_iformat) {}
   ~imFileFormatSGI() {}
@@ -361,9 +373,6 @@ int imFileFormatSGI::ReadImageInfo(int index)
     /* reads the compression control information */
     imBinFileRead(handle, this->starttab, tablen, 4);
     imBinFileRead(handle, this->lengthtab, tablen, 4);
-
-    // allocates more than enough since compression algoritm can be ineficient
-    this->line_buffer_extra = 2*imImageLineSize(this->width, this->file_color_mode, this->file_data_type);
   }
 
   if (imBinFileError(handle))
@@ -500,7 +509,8 @@ int imFileFormatSGI::WriteImageInfo()
     imBinFileWrite(handle, this->lengthtab, tablen*4, 1);
 
     // allocates more than enough since compression algoritm can be ineficient
-    this->line_buffer_extra = 2*imImageLineSize(this->width, this->file_color_mode, this->file_data_type);
+    // (up to two values per pixel plus the end marker)
+    this->line_buffer_extra = 2*imImageLineSize(this->width, this->file_color_mode, this->file_data_type) + this->bpc;
   }
 
   /* tests if everything was ok */
@@ -510,15 +520,58 @@ int imFileFormatSGI::WriteImageInfo()
   return IM_ERR_NONE;
 }
 
+int imFileFormatSGI::ReadCompressedData(int count, imbyte** buffer, unsigned int *start)
+{
+  /* the scan lines are usually stored in sequence, 
+     but can be in any order, and even share data */
+  unsigned int min_start = 0xFFFFFFFF, max_end = 0;
+  for (int i = 0; i < count; i++)
+  {
+    unsigned int end = this->starttab[i] + this->lengthtab[i];
+    if (end < this->starttab[i] || (this->starttab[i] % this->bpc) != 0 || (this->lengthtab[i] % this->bpc) != 0)
+      return IM_ERR_ACCESS;
+
+    if (this->starttab[i] < min_start) min_start = this->starttab[i];
+    if (end > max_end) max_end = end;
+  }
+
+  if (max_end > imBinFileSize(handle))
+    return IM_ERR_ACCESS;
+
+  unsigned int size = max_end - min_start;
+  *buffer = (imbyte*)malloc(size? size: 1);
+  if (!*buffer)
+    return IM_ERR_MEM;
+
+  imBinFileSeekTo(handle, min_start);
+  imBinFileRead(handle, *buffer, size / this->bpc, this->bpc);
+
+  if (imBinFileError(handle))
+  {
+    free(*buffer);
+    *buffer = NULL;
+    return IM_ERR_ACCESS;
+  }
+
+  *start = min_start;
+  return IM_ERR_NONE;
+}
+
 int imFileFormatSGI::ReadImageData(void* data)
 {
   int count = imFileLineBufferCount(this);
 
   imCounterTotal(this->counter, count, "Reading SGI...");
 
+  /* the compressed scan lines are read in a single block */
   imbyte* compressed_buffer = NULL;
-  if (this->comp_type == SGI_RLE)  // point to the extra buffer
-    compressed_buffer = (imbyte*)this->line_buffer + this->line_buffer_size;
+  unsigned int compressed_start = 0;
+  if (this->comp_type == SGI_RLE)
+  {
+    int error = ReadCompressedData(count, &compressed_buffer, &compressed_start);
+    if (error)
+      return error;
+  }
 
   int row = 0, plane = 0;
   for (int i = 0; i < count; i++)
@@ -533,26 +586,34 @@ int imFileFormatSGI::ReadImageData(void* data)
     else
     {
       int row_index = row + plane*this->height;
-      imBinFileSeekTo(handle, this->starttab[row_index]);
-      imBinFileRead(handle, compressed_buffer, this->lengthtab[row_index] / this->bpc, this->bpc);
-
-      if (imBinFileError(handle))
-        return IM_ERR_ACCESS;     
+      imbyte* line_data = compressed_buffer + (this->starttab[row_index] - compressed_start);
+      imbyte* line_end = line_data + this->lengthtab[row_index];
 
+      int error;
       if (this->bpc == 1)
-        iSGIDecodeScanLine((imbyte*)this->line_buffer, compressed_buffer, this->width);
+        error = iSGIDecodeScanLine((imbyte*)this->line_buffer, line_data, line_end, this->width);
       else
-        iSGIDecodeScanLine((imushort*)this->line_buffer, (imushort*)compressed_buffer, this->width);
+        error = iSGIDecodeScanLine((imushort*)this->line_buffer, (imushort*)line_data, (imushort*)line_end, this->width);
+
+      if (error)
+      {
+        free(compressed_buffer);
+        return error;
+      }
     }
 
     imFileLineBufferRead(this, data, row, plane);
 
     if (!imCounterInc(this->counter))
+    {
+      free(compressed_buffer);
       return IM_ERR_COUNTER;
+    }
 
     imFileLineBufferInc(this, &row, &plane);
   }
 
+  free(compressed_buffer);
   return IM_ERR_NONE;
 }
 
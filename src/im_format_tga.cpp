@@ -11,6 +11,8 @@
 #include "im_math.h"
 
 #include "im_binfile.h"
+#include "im_binbuffer.h"
+#include "im_rle.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -96,94 +98,74 @@ Extension Area:
 * The ability for simple expansion
 */
 
-static int iTGADecodeScanLine(imBinFile* handle, imbyte *DecodedBuffer, int width, int pixel_size)
+/* a packet can continue in the next scan line */
+struct iTGAPacket
 {
-  int i=0;
-  unsigned char runcount; /* repetition count field */
-  imbyte pixel_buffer[4];
+  int count, repeat;
+  imbyte pixel[4];
+};
+
+static int iTGADecodeScanLine(iBinBuffer* buffer, iTGAPacket* packet, imbyte *DecodedBuffer, int width, int pixel_size)
+{
+  int i = 0;
   
   while (i < width) 
   { 
-    imBinFileRead(handle, &runcount, 1, 1);  
-
-    if (runcount & 0x80)
-    { 
-      imBinFileRead(handle, pixel_buffer, pixel_size, 1); 
-      runcount &= 0x7F;
-
-      if (imBinFileError(handle))
+    if (packet->count == 0)
+    {
+      int runcount; /* repetition count field */
+      if (!iBinBufferGetByte(buffer, &runcount))
         return IM_ERR_ACCESS;     
 
-      runcount++;      
-      while (runcount-- && i < width)
-      {
-        memcpy(DecodedBuffer, pixel_buffer, pixel_size);
-        i++;
-        DecodedBuffer += pixel_size;
-      }
-    } 
-    else
-    { 
-      runcount++;
-      while (runcount-- && i < width)
-      {
-        imBinFileRead(handle, pixel_buffer, pixel_size, 1);
-        memcpy(DecodedBuffer, pixel_buffer, pixel_size);
-        i++;
-        DecodedBuffer += pixel_size;
-      }
+      packet->count = (runcount & 0x7F) + 1;
+      packet->repeat = runcount & 0x80;
 
-      if (imBinFileError(handle))
+      if (packet->repeat && !iBinBufferRead(buffer, packet->pixel, pixel_size))
         return IM_ERR_ACCESS;     
     }
-  }
 
-  return IM_ERR_NONE;
-}
+    int count = packet->count;
+    if (count > width - i)
+      count = width - i;
 
-inline int iTGAEqualPixel(const imbyte* Buffer1, const imbyte* Buffer2, int pixel_size)
-{
-  while(pixel_size--)
-  {
-    if (*Buffer1++ != *Buffer2++)
-      return 0;
+    if (packet->repeat)
+      iRLEFill(DecodedBuffer, packet->pixel, pixel_size, count);
+    else if (!iBinBufferRead(buffer, DecodedBuffer, count*pixel_size))
+      return IM_ERR_ACCESS;     
+
+    packet->count -= count;
+    i += count;
+    DecodedBuffer += count*pixel_size;
   }
-  return 1;
+
+  return IM_ERR_NONE;
 }
 
 static int iTGAEncodeScanLine(imbyte* EncodedBuffer, const imbyte* DecodedBuffer, int width, int pixel_size)
 {
-  imbyte pixel_buffer[4];
-  unsigned char runcount; /* Length of encoded pixel run          */
+  int runcount;           /* Length of encoded pixel run          */
   int x = 0;              /* Index into uncompressed data buffer  */
   imbyte* StartBuffer = EncodedBuffer;
 
   while (x < width)
   {
-    runcount = 1;
-    memcpy(pixel_buffer, &DecodedBuffer[x*pixel_size], pixel_size);
+    const imbyte* pixel_buffer = DecodedBuffer + x*pixel_size;
+    int max_count = width - x;
+    if (max_count > 128) max_count = 128;
 
     // count equal pixels
-    while (x+runcount < width && runcount < 128 && 
-           iTGAEqualPixel(pixel_buffer, &DecodedBuffer[(x+runcount)*pixel_size], pixel_size))
-      runcount++; 
+    runcount = 1 + iRLERepeatCount(pixel_buffer, pixel_size, (max_count-1)*pixel_size) / pixel_size;
 
     if (runcount == 1)
     {
       // count different pixels
-      while (x+runcount+1 < width && runcount < 128)
-      {
-        memcpy(pixel_buffer, &DecodedBuffer[(x+runcount)*pixel_size], pixel_size);
-
-        if (!iTGAEqualPixel(pixel_buffer, &DecodedBuffer[(x+runcount+1)*pixel_size], pixel_size))
-          runcount++; 
-        else
-          break;
-      }
+      while (x+runcount+1 < width && runcount < 128 &&
+             memcmp(pixel_buffer + runcount*pixel_size, pixel_buffer + (runcount+1)*pixel_size, pixel_size) != 0)
+        runcount++; 
 
       *EncodedBuffer++ = (imbyte)(runcount-1);
 
-      memcpy(EncodedBuffer, &DecodedBuffer[x*pixel_size], runcount*pixel_size);
+      memcpy(EncodedBuffer, pixel_buffer, runcount*pixel_size);
       EncodedBuffer += runcount*pixel_size;
     }
     else
@@ -1033,12 +1015,24 @@ int imFileFormatTGA::ReadImageData(void* data)
   if (this->bpp == 16)
     line_size = this->width*2;
 
+  iBinBuffer buffer = {0};
+  iTGAPacket packet;
+  if (this->image_type > 3)
+  {
+    if (!iBinBufferInit(&buffer, handle, IM_BINBUFFER_SIZE))
+      return IM_ERR_MEM;
+    packet.count = 0;
+  }
+
   for (int row = 0; row < this->height; row++)
   {
     if (this->image_type > 3)
     {
-      if (iTGADecodeScanLine(handle, (imbyte*)this->line_buffer, this->width, this->bpp/8) == IM_ERR_ACCESS)
+      if (iTGADecodeScanLine(&buffer, &packet, (imbyte*)this->line_buffer, this->width, this->bpp/8) == IM_ERR_ACCESS)
+      {
+        iBinBufferRelease(&buffer);
         return IM_ERR_ACCESS;     
+      }
     }
     else
     {
@@ -1053,8 +1047,15 @@ int imFileFormatTGA::ReadImageData(void* data)
     imFileLineBufferRead(this, data, row, 0);
 
     if (!imCounterInc(this->counter))
+    {
+      if (this->image_type > 3)
+        iBinBufferRelease(&buffer);
       return IM_ERR_COUNTER;
+    }
   }
+
+  if (this->image_type > 3)
+    iBinBufferRelease(&buffer);
   
   return IM_ERR_NONE;
 }
@@ -9,6 +9,7 @@
 #include "im_util.h"
 #include "im_format_all.h"
 #include "im_counter.h"
+#include "im_binfile.h"
 
 #include "tiffiop.h"
 
@@ -17,6 +18,10 @@
 #include <string.h>
 #include <memory.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 //Used to debug TIFF loading and decoding
 //#define IM_TIFF_DEBUG_RGBA 1
 
@@ -201,6 +206,8 @@ static int iTIFFWriteTag(TIFF* tiff, int index, const char* name, int data_type,
         fld->field_tag == TIFFTAG_INTEROPERABILITYIFD ||   
 	      fld->field_tag == TIFFTAG_SUBIFD ||          
 	      fld->field_tag == TIFFTAG_COLORMAP ||        /* handled elsewhere */
+	      fld->field_tag == TIFFTAG_TILEWIDTH ||
+	      fld->field_tag == TIFFTAG_TILELENGTH ||
 	      fld->field_tag == TIFFTAG_EXTRASAMPLES ||
 	      fld->field_tag == TIFFTAG_TRANSFERFUNCTION ||
 	      fld->field_tag == TIFFTAG_RESOLUTIONUNIT ||
@@ -640,7 +647,26 @@ class imFileFormatTIFF: public imFileFormatBase
   void** tile_buf;
   int tile_buf_count, tile_width, tile_height, start_row, tile_line_size, tile_line_raw_size;
 
+  int overview_count, overview_subifd;
+
+  /* used while a resolution level is written */
+  imbyte* write_prev_line;
+  imbyte* write_band_buf;
+  int write_band_line_size;
+
   int ReadTileline(void* line_buffer, int row, int plane);
+  int ReadLines(void* data, int first_line, int count);
+  void FixLine(void* line_buffer, int plane);
+  void WriteImageFields(int width, int height, uint16 Compression);
+  int WriteImageLevel(void* data, const imbyte* level_buf, int width, int height, imbyte* reduce_buf);
+  int WriteLevelBegin(int width, int reduce);
+  int WriteLevelRows(void* data, const imbyte* level_buf, int first_row, int count, int width, int height, imbyte* reduce_buf);
+  void WriteLevelEnd();
+  int WriteTileRow(imbyte* band_buf, int band_line_size, int row, int width, int height);
+
+#ifdef _OPENMP
+  int ReadImageDataParallel(void* data);
+#endif
 
 public:
   imFileFormatTIFF(const imFormat* _iformat): imFileFormatBase(_iformat) {}
@@ -652,8 +678,10 @@ public:
   void* Handle(int index);
   int ReadImageInfo(int index);
   int ReadImageData(void* data);
+  int ReadImageLines(void* data, int first_line, int count);
   int WriteImageInfo();
   int WriteImageData(void* data);
+  int WriteImageLines(void* data, int first_line, int count);
 };
 
 class imFormatTIFF: public imFormat
@@ -712,6 +740,8 @@ int imFileFormatTIFF::New(const char* file_name)
     return IM_ERR_OPEN;
 
   this->tile_buf = 0;
+  this->write_prev_line = NULL;
+  this->write_band_buf = NULL;
 
   return IM_ERR_NONE;
 }
@@ -725,6 +755,9 @@ void imFileFormatTIFF::Close()
     free(this->tile_buf);
   }
 
+  if (this->is_new)
+    WriteLevelEnd();
+
   TIFFClose(this->tiff);
 }
 
@@ -769,15 +802,16 @@ int imFileFormatTIFF::ReadImageInfo(int index)
   attrib_table->RemoveAll();
   imFileSetBaseAttributes(this);
 
+  uint16 SubIFDsCount = 0;
+  uint64* SubIFDs = NULL;
+  TIFFGetField(this->tiff, TIFFTAG_SUBIFD, &SubIFDsCount, &SubIFDs);
+
   void* data = NULL;
   if (TIFFGetField(this->tiff, TIFFTAG_DNGVERSION, &data) == 1 && data)
   {
     uint32 SubFileType = 0;
     TIFFGetField(this->tiff, TIFFTAG_SUBFILETYPE, &SubFileType);
 
-    uint16 SubIFDsCount = 0;
-    uint64* SubIFDs = NULL;
-    TIFFGetField(this->tiff, TIFFTAG_SUBIFD, &SubIFDsCount, &SubIFDs);
     attrib_table->Set("SubIFDCount", IM_USHORT, 1, (void*)&SubIFDsCount);
 
     /* If it is a DNG file and has SubIFDs, 
@@ -793,6 +827,17 @@ int imFileFormatTIFF::ReadImageInfo(int index)
       TIFFSetSubDirectory(this->tiff, SubIFDOffset);
     }
   }
+  else if (SubIFDsCount != 0)
+  {
+    attrib_table->Set("SubIFDCount", IM_USHORT, 1, (void*)&SubIFDsCount);
+
+    /* Usually reduced resolution images, loaded only when selected. */
+    if (sub_ifd >= 0 && sub_ifd < SubIFDsCount)
+    {
+      uint64 SubIFDOffset = SubIFDs[sub_ifd];
+      TIFFSetSubDirectory(this->tiff, SubIFDOffset);
+    }
+  }
 
   uint16 Compression = COMPRESSION_NONE;
   TIFFGetField(this->tiff, TIFFTAG_COMPRESSION, &Compression);
@@ -1076,25 +1121,18 @@ int imFileFormatTIFF::ReadImageInfo(int index)
   return IM_ERR_NONE;
 }
 
-int imFileFormatTIFF::WriteImageInfo()
+void imFileFormatTIFF::WriteImageFields(int width, int height, uint16 Compression)
 {
   this->file_color_mode = this->user_color_mode;
   this->file_data_type = this->user_data_type;
   this->lab_fix = 0;
 
-  uint16 Compression = iTIFFCompCalc(this->compression, this->file_color_mode, this->file_data_type);
-  if (Compression == (uint16)-1)
-    return IM_ERR_COMPRESS;
-
-  int comp_index = iTIFFGetCompIndex(Compression);
-  strcpy(this->compression, iTIFFCompTable[comp_index]);
-
   TIFFSetField(this->tiff, TIFFTAG_COMPRESSION, Compression);
 
-  uint32 Width = this->width;
+  uint32 Width = width;
   TIFFSetField(this->tiff, TIFFTAG_IMAGEWIDTH, Width);
 
-  uint32 Height = this->height;
+  uint32 Height = height;
   TIFFSetField(this->tiff, TIFFTAG_IMAGELENGTH, Height);
 
   static uint16 colorspace2photometric [] =
@@ -1221,10 +1259,83 @@ int imFileFormatTIFF::WriteImageInfo()
     TIFFSetField(this->tiff, TIFFTAG_COLORMAP, rmap, gmap, bmap);
   }
 
-  // Force libTIFF to calculate best RowsPerStrip
-  uint32 RowsPerStrip = (uint32)-1; 
-  RowsPerStrip = TIFFDefaultStripSize(this->tiff, RowsPerStrip);
-  TIFFSetField(this->tiff, TIFFTAG_ROWSPERSTRIP, RowsPerStrip);
+  if (this->tile_width)
+  {
+    uint32 tileWidth = this->tile_width, tileLength = this->tile_height;
+    TIFFSetField(this->tiff, TIFFTAG_TILEWIDTH, tileWidth);
+    TIFFSetField(this->tiff, TIFFTAG_TILELENGTH, tileLength);
+  }
+  else
+  {
+    // Force libTIFF to calculate best RowsPerStrip
+    uint32 RowsPerStrip = (uint32)-1; 
+    RowsPerStrip = TIFFDefaultStripSize(this->tiff, RowsPerStrip);
+    TIFFSetField(this->tiff, TIFFTAG_ROWSPERSTRIP, RowsPerStrip);
+  }
+}
+
+static int iTIFFTileSize(int size)
+{
+  /* tile sizes must be a multiple of 16 */
+  if (size < 16)
+    return 16;
+  return ((size + 15) / 16) * 16;
+}
+
+int imFileFormatTIFF::WriteImageInfo()
+{
+  uint16 Compression = iTIFFCompCalc(this->compression, this->user_color_mode, this->user_data_type);
+  if (Compression == (uint16)-1)
+    return IM_ERR_COMPRESS;
+
+  int comp_index = iTIFFGetCompIndex(Compression);
+  strcpy(this->compression, iTIFFCompTable[comp_index]);
+
+  imAttribTable* attrib_table = AttribTable();
+
+  int* tile_width = (int*)attrib_table->Get("TileWidth");
+  int* tile_length = (int*)attrib_table->Get("TileLength");
+  if (tile_width || tile_length)
+  {
+    this->tile_width = iTIFFTileSize(tile_width? *tile_width: *tile_length);
+    this->tile_height = iTIFFTileSize(tile_length? *tile_length: *tile_width);
+  }
+  else
+  {
+    this->tile_width = 0;
+    this->tile_height = 0;
+  }
+
+  this->overview_count = 0;
+  this->overview_subifd = 1;
+
+  int* overview_count = (int*)attrib_table->Get("OverviewCount");
+  if (overview_count && *overview_count > 0)
+  {
+    /* stop at a 1x1 image */
+    int w = this->width, h = this->height;
+    while (this->overview_count < *overview_count && (w > 1 || h > 1))
+    {
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+      this->overview_count++;
+    }
+
+    char* overview_type = (char*)attrib_table->Get("OverviewType");
+    if (overview_type && imStrEqual(overview_type, "PAGES"))
+      this->overview_subifd = 0;
+  }
+
+  WriteImageFields(this->width, this->height, Compression);
+
+  if (this->overview_count && this->overview_subifd)
+  {
+    /* the next directories written will be the SubIFDs of this one */
+    uint16 SubIFDsCount = (uint16)this->overview_count;
+    uint64 SubIFDs[32];
+    memset(SubIFDs, 0, sizeof(SubIFDs));
+    TIFFSetField(this->tiff, TIFFTAG_SUBIFD, SubIFDsCount, SubIFDs);
+  }
 
   iTIFFWriteAttributes(this->tiff, attrib_table);
 
@@ -1395,6 +1506,325 @@ int imFileFormatTIFF::ReadTileline(void* line_buffer, int row, int plane)
   return 1;
 }
 
+void imFileFormatTIFF::FixLine(void* line_buffer, int plane)
+{
+  if (this->invert && this->file_data_type == IM_BYTE)
+  {
+    unsigned char* buf = (unsigned char*)line_buffer;
+    for (int b = 0; b < this->line_buffer_size; b++)
+    {
+      *buf = ~(*buf);
+      buf++;
+    }
+  }
+
+  if (this->cpx_int)
+  {
+    int line_count = imImageLineCount(this->width, this->user_color_mode);
+    iTIFFExpandComplexInt(line_buffer, line_count, this->cpx_int);
+  }
+
+  if (this->lab_fix)
+    iTIFFLabFix(line_buffer, this->width, this->file_data_type, 0);
+
+  if (this->extra_sample_size)
+    iTIFFExtraSamplesFix((imbyte*)line_buffer, this->width, this->sample_size, this->extra_sample_size, plane);
+}
+
+#ifdef _OPENMP
+
+/* Parallel decoding.
+ * Each strip or tile is compressed independently. So each thread opens its own
+ * libTIFF handle for the same directory, with its own codec state, and decodes
+ * whole strips (or rows of tiles) directly into the application buffer.
+ * All the handles share the same imBinFile, only the raw data reading is serialized. */
+
+static const int iTIFFParallelMinCount = 250000;   /* 500*500 image size, same as im_process */
+
+struct iTIFFSharedFile
+{
+  imBinFile* file_bin;
+  toff_t offset, size;
+};
+
+static tmsize_t iTIFFSharedReadProc(thandle_t fd, void* buf, tmsize_t size)
+{
+  iTIFFSharedFile* shared = (iTIFFSharedFile*)fd;
+  tmsize_t ret;
+
+#pragma omp critical (imTIFFFile)
+  {
+    imBinFileSeekTo(shared->file_bin, (unsigned long)shared->offset);
+    ret = (tmsize_t)imBinFileRead(shared->file_bin, buf, (unsigned long)size, 1);
+  }
+
+  shared->offset += ret;
+  return ret;
+}
+
+static tmsize_t iTIFFSharedWriteProc(thandle_t fd, void* buf, tmsize_t size)
+{
+  (void) fd; (void) buf; (void) size;
+  return 0;
+}
+
+static toff_t iTIFFSharedSeekProc(thandle_t fd, toff_t off, int whence)
+{
+  iTIFFSharedFile* shared = (iTIFFSharedFile*)fd;
+  switch (whence)
+  {
+  case SEEK_SET:
+    shared->offset = off;
+    break;
+  case SEEK_CUR:
+    shared->offset += off;
+    break;
+  case SEEK_END:
+    shared->offset = shared->size + off;
+    break;
+  }
+
+  return shared->offset;
+}
+
+static int iTIFFSharedCloseProc(thandle_t fd)
+{
+  (void) fd;
+  return 0;
+}
+
+static toff_t iTIFFSharedSizeProc(thandle_t fd)
+{
+  iTIFFSharedFile* shared = (iTIFFSharedFile*)fd;
+  return shared->size;
+}
+
+static int iTIFFSharedMapProc(thandle_t fd, void** pbase, toff_t* psize)
+{
+  (void) fd; (void) pbase; (void) psize;
+  return 0;
+}
+
+static void iTIFFSharedUnmapProc(thandle_t fd, void* base, toff_t size)
+{
+  (void) fd; (void) base; (void) size;
+}
+
+static TIFF* iTIFFSharedOpen(TIFF* tiff, iTIFFSharedFile* shared)
+{
+  /* only the header is read here, then position at the same directory of the main handle */
+  TIFF* shared_tiff = TIFFClientOpen(TIFFFileName(tiff), "rh", (thandle_t)shared,
+                                     iTIFFSharedReadProc, iTIFFSharedWriteProc,
+                                     iTIFFSharedSeekProc, iTIFFSharedCloseProc,
+                                     iTIFFSharedSizeProc, iTIFFSharedMapProc,
+                                     iTIFFSharedUnmapProc);
+  if (!shared_tiff)
+    return NULL;
+
+  if (!TIFFSetSubDirectory(shared_tiff, TIFFCurrentDirOffset(tiff)))
+  {
+    TIFFClose(shared_tiff);
+    return NULL;
+  }
+
+  /* same pseudo tags set in ReadImageInfo */
+  uint16 Compression = COMPRESSION_NONE, Photometric = PHOTOMETRIC_MINISBLACK;
+  TIFFGetField(shared_tiff, TIFFTAG_COMPRESSION, &Compression);
+  TIFFGetField(shared_tiff, TIFFTAG_PHOTOMETRIC, &Photometric);
+
+  if (Compression == COMPRESSION_JPEG)
+    TIFFSetField(shared_tiff, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+
+  if (Photometric == PHOTOMETRIC_LOGLUV || Photometric == PHOTOMETRIC_LOGL)
+    TIFFSetField(shared_tiff, TIFFTAG_SGILOGDATAFMT, SGILOGDATAFMT_FLOAT);
+
+  return shared_tiff;
+}
+
+static int iTIFFCounterInc(int counter, volatile int* processing)
+{
+  int ret;
+
+#pragma omp critical (imTIFFCounter)
+  {
+    ret = *processing;
+    if (ret && !imCounterInc(counter))
+    {
+      *processing = 0;
+      ret = 0;
+    }
+  }
+
+  return ret;
+}
+
+int imFileFormatTIFF::ReadImageDataParallel(void* data)
+{
+  /* Returns -1 when the image can not be decoded in parallel. */
+
+  uint16 Compression = COMPRESSION_NONE;
+  TIFFGetField(this->tiff, TIFFTAG_COMPRESSION, &Compression);
+
+  int thread_count = omp_get_max_threads();
+  if (thread_count < 2 ||
+      this->width * this->height < iTIFFParallelMinCount ||
+      Compression == COMPRESSION_NONE ||     /* nothing to decode, just I/O */
+      this->h_subsample != 1 || this->v_subsample != 1)
+    return -1;
+
+  int is_tiled = TIFFIsTiled(this->tiff);
+
+  /* each unit is a strip or a row of tiles */
+  int unit_rows;
+  if (is_tiled)
+    unit_rows = this->tile_height;
+  else
+  {
+    uint32 RowsPerStrip = (uint32)-1;
+    TIFFGetFieldDefaulted(this->tiff, TIFFTAG_ROWSPERSTRIP, &RowsPerStrip);
+    unit_rows = (int)IM_MIN(RowsPerStrip, (uint32)this->height);
+  }
+
+  if (unit_rows <= 0)
+    return -1;
+
+  int count = imFileLineBufferCount(this);
+  int plane_count = count / this->height;
+  int units_per_plane = (this->height + unit_rows-1) / unit_rows;
+  int unit_count = units_per_plane * plane_count;
+  if (unit_count < 2)
+    return -1;
+
+  /* decode directly in the application buffer when possible */
+  int direct = (int)TIFFScanlineSize(this->tiff) <= this->line_buffer_size;
+
+  iTIFFSharedFile shared_template;
+  shared_template.file_bin = (imBinFile*)TIFFClientdata(this->tiff);
+  shared_template.offset = 0;
+  shared_template.size = imBinFileSize(shared_template.file_bin);
+
+  volatile int processing = 1;
+  int error = IM_ERR_NONE;
+
+#pragma omp parallel
+  {
+    iTIFFSharedFile shared = shared_template;
+    TIFF* shared_tiff = iTIFFSharedOpen(this->tiff, &shared);
+    void* line_buffer = malloc(this->line_buffer_alloc);
+    imbyte* unit_buf = NULL;
+    int line_size = 0, tiles_across = 0, tile_size = 0;
+
+    if (shared_tiff)
+    {
+      if (is_tiled)
+      {
+        tiles_across = (this->width + this->tile_width-1) / this->tile_width;
+        tile_size = (int)TIFFTileSize(shared_tiff);
+        unit_buf = (imbyte*)malloc(tiles_across*tile_size);
+      }
+      else
+      {
+        line_size = (int)TIFFScanlineSize(shared_tiff);
+        unit_buf = (imbyte*)malloc(TIFFStripSize(shared_tiff));
+      }
+    }
+
+    if (!unit_buf || !line_buffer)
+    {
+#pragma omp critical (imTIFFCounter)
+      {
+        if (error == IM_ERR_NONE)
+          error = shared_tiff? IM_ERR_MEM: IM_ERR_ACCESS;
+        processing = 0;
+      }
+    }
+
+#pragma omp for schedule(dynamic)
+    for (int u = 0; u < unit_count; u++)
+    {
+      if (!processing)
+        continue;
+
+      int plane = this->start_plane + u / units_per_plane;
+      int first_row = (u % units_per_plane) * unit_rows;
+      int rows = IM_MIN(unit_rows, this->height - first_row);
+      int ret = IM_ERR_NONE;
+
+      if (is_tiled)
+      {
+        int x = 0;
+        for (int t = 0; t < tiles_across; t++)
+        {
+          uint32 tile = TIFFComputeTile(shared_tiff, x, first_row, 0, (tsample_t)plane);
+          if (TIFFReadEncodedTile(shared_tiff, tile, unit_buf + t*tile_size, tile_size) <= 0)
+          {
+            ret = IM_ERR_ACCESS;
+            break;
+          }
+
+          x += this->tile_width;
+        }
+      }
+      else
+      {
+        uint32 strip = TIFFComputeStrip(shared_tiff, first_row, (tsample_t)plane);
+        if (TIFFReadEncodedStrip(shared_tiff, strip, unit_buf, (tmsize_t)-1) <= 0)
+          ret = IM_ERR_ACCESS;
+      }
+
+      for (int r = 0; r < rows && ret == IM_ERR_NONE; r++)
+      {
+        void* dst_buffer = direct? imFileLineBufferDirect(this, data, first_row + r, plane): NULL;
+        if (!dst_buffer)
+          dst_buffer = line_buffer;
+
+        if (is_tiled)
+        {
+          /* same as ReadTileline */
+          imbyte* dst = (imbyte*)dst_buffer;
+          int tile_line_size = this->tile_line_size;
+          for (int t = 0; t < tiles_across; t++)
+          {
+            if (t == tiles_across-1)
+              tile_line_size -= this->tile_line_size*tiles_across - this->tile_line_raw_size;
+
+            memcpy(dst, unit_buf + t*tile_size + r*this->tile_line_size, tile_line_size);
+            dst += tile_line_size;
+          }
+        }
+        else
+          memcpy(dst_buffer, unit_buf + r*line_size, line_size);
+
+        FixLine(dst_buffer, plane);
+
+        if (dst_buffer == line_buffer)
+          imFileLineBufferReadBuffer(this, line_buffer, data, first_row + r, plane);
+
+        if (!iTIFFCounterInc(this->counter, &processing))
+          ret = IM_ERR_COUNTER;
+      }
+
+      if (ret != IM_ERR_NONE)
+      {
+#pragma omp critical (imTIFFCounter)
+        {
+          if (error == IM_ERR_NONE)
+            error = ret;
+          processing = 0;
+        }
+      }
+    }
+
+    if (unit_buf) free(unit_buf);
+    if (line_buffer) free(line_buffer);
+    if (shared_tiff) TIFFClose(shared_tiff);
+  }
+
+  return error;
+}
+
+#endif
+
 #ifdef IM_TIFF_DEBUG_RGBA
 static void iTIFFReadRGBA(TIFF* tif, int w, int h, imbyte* data)
 {
@@ -1427,9 +1857,40 @@ int imFileFormatTIFF::ReadImageData(void* data)
 #ifdef IM_TIFF_DEBUG_RGBA
   iTIFFReadRGBA(this->tiff, this->width, this->height, (imbyte*)data);
 #else
-  int row = 0, plane = this->start_plane;
-  for (int i = 0; i < count; i++)
+#ifdef _OPENMP
+  int error = ReadImageDataParallel(data);
+  if (error != -1)
+    return error;
+#endif
+
+  return ReadLines(data, 0, count);
+#endif
+
+  return IM_ERR_NONE;
+}
+
+int imFileFormatTIFF::ReadImageLines(void* data, int first_line, int count)
+{
+  if (first_line == 0)
+    imCounterTotal(this->counter, imFileLineBufferCount(this), "Reading TIFF...");
+
+  return ReadLines(data, first_line, count);
+}
+
+/* Reads the lines in file order, the subsampled line of the previous call is kept in the line buffer. */
+int imFileFormatTIFF::ReadLines(void* data, int first_line, int count)
+{
+  /* decode directly in the application buffer when possible */
+  int direct = this->h_subsample == 1 && this->v_subsample == 1 &&
+               (int)TIFFScanlineSize(this->tiff) <= this->line_buffer_size;
+
+  int row = first_line, plane = this->start_plane;
+  for (int i = first_line; i < first_line + count; i++)
   {
+    void* line_buffer = direct? imFileLineBufferDirect(this, data, row, plane): NULL;
+    if (!line_buffer)
+      line_buffer = this->line_buffer;
+
     if (TIFFIsTiled(this->tiff))
     {
       if (this->h_subsample != 1 || this->v_subsample != 1)
@@ -1447,7 +1908,7 @@ int imFileFormatTIFF::ReadImageData(void* data)
       }
       else
       {
-        if (ReadTileline(this->line_buffer, row, (tsample_t)plane) <= 0)
+        if (ReadTileline(line_buffer, row, (tsample_t)plane) <= 0)
           return IM_ERR_ACCESS;
       }
     }
@@ -1468,74 +1929,588 @@ int imFileFormatTIFF::ReadImageData(void* data)
       }
       else
       {
-        if (TIFFReadScanline(this->tiff, this->line_buffer, row, (tsample_t)plane) <= 0)
+        if (TIFFReadScanline(this->tiff, line_buffer, row, (tsample_t)plane) <= 0)
           return IM_ERR_ACCESS;
       }
     }
 
-    if (this->invert && this->file_data_type == IM_BYTE)
+    FixLine(line_buffer, plane);
+
+    if (line_buffer == this->line_buffer)
+      imFileLineBufferRead(this, data, row, plane);
+
+    if (!imCounterInc(this->counter))
+      return IM_ERR_COUNTER;
+
+    imFileLineBufferInc(this, &row, &plane);
+  }
+
+  return IM_ERR_NONE;
+}
+
+/* Reduced resolution images (overviews).
+ * Lines are in the file format before the Lab fix,
+ * each destination pixel is the average of a 2x2 block of pixels. */
+
+template <class T, class TA>
+static void iTIFFReduceLine(const T* line0, const T* line1, T* dst_line, int width, int depth, TA round)
+{
+  int dst_width = (width + 1) / 2;
+  for (int x = 0; x < dst_width; x++)
+  {
+    int x0 = (2*x)*depth,
+        x1 = IM_MIN(2*x+1, width-1)*depth;
+
+    for (int d = 0; d < depth; d++)
+    {
+      TA sum = (TA)line0[x0+d] + (TA)line0[x1+d] + (TA)line1[x0+d] + (TA)line1[x1+d];
+      dst_line[x*depth+d] = (T)((sum + round) / 4);
+    }
+  }
+}
+
+static void iTIFFReduceLineNearest(const imbyte* line0, imbyte* dst_line, int width, int color_space)
+{
+  int dst_width = (width + 1) / 2;
+
+  if (color_space == IM_BINARY)
+  {
+    /* 1 bit per pixel, most significant bit first */
+    memset(dst_line, 0, (dst_width + 7) / 8);
+    for (int x = 0; x < dst_width; x++)
+    {
+      if (line0[(2*x) / 8] & (0x01 << (7 - ((2*x) % 8))))
+        dst_line[x / 8] |= (imbyte)(0x01 << (7 - (x % 8)));
+    }
+  }
+  else
+  {
+    for (int x = 0; x < dst_width; x++)
+      dst_line[x] = line0[2*x];
+  }
+}
+
+static void iTIFFReduce(const void* line0, const void* line1, void* dst_line, int width, int color_mode, int data_type)
+{
+  int color_space = imColorModeSpace(color_mode);
+  int depth = imColorModeDepth(color_mode);
+
+  /* indices can not be averaged */
+  if (color_space == IM_BINARY || color_space == IM_MAP)
+  {
+    iTIFFReduceLineNearest((const imbyte*)line0, (imbyte*)dst_line, width, color_space);
+    return;
+  }
+
+  switch(data_type)
+  {
+  case IM_BYTE:
+    iTIFFReduceLine((const imbyte*)line0, (const imbyte*)line1, (imbyte*)dst_line, width, depth, (int)2);
+    break;
+  case IM_SHORT:
+    iTIFFReduceLine((const short*)line0, (const short*)line1, (short*)dst_line, width, depth, (int)2);
+    break;
+  case IM_USHORT:
+    iTIFFReduceLine((const imushort*)line0, (const imushort*)line1, (imushort*)dst_line, width, depth, (int)2);
+    break;
+  case IM_INT:
+    iTIFFReduceLine((const int*)line0, (const int*)line1, (int*)dst_line, width, depth, (double)0);
+    break;
+  case IM_FLOAT:
+    iTIFFReduceLine((const float*)line0, (const float*)line1, (float*)dst_line, width, depth, (float)0);
+    break;
+  case IM_CFLOAT:
+    iTIFFReduceLine((const float*)line0, (const float*)line1, (float*)dst_line, width, 2*depth, (float)0);
+    break;
+  }
+}
+
+static int iTIFFLineSize(int width, int color_mode, int data_type)
+{
+  if (imColorModeSpace(color_mode) == IM_BINARY)
+    return (width + 7) / 8;
+  else
+    return imImageLineSize(width, color_mode, data_type);
+}
+
+#ifdef _OPENMP
+
+/* Parallel tile compression.
+ * Each thread has its own libTIFF handle writing to memory, with the same layout and compression.
+ * A tile is encoded by that handle, then its compressed data is written to the file
+ * by the main handle as a raw tile. Only the compressions without tables shared
+ * in the directory are supported. */
+
+struct iTIFFMemFile
+{
+  imbyte* buffer;
+  toff_t offset, size, alloc;
+};
+
+static tmsize_t iTIFFMemReadProc(thandle_t fd, void* buf, tmsize_t size)
+{
+  (void) fd; (void) buf; (void) size;
+  return 0;
+}
+
+static tmsize_t iTIFFMemWriteProc(thandle_t fd, void* buf, tmsize_t size)
+{
+  iTIFFMemFile* mem = (iTIFFMemFile*)fd;
+
+  if (mem->offset + size > mem->alloc)
+  {
+    toff_t alloc = 2*(mem->offset + size);
+    imbyte* buffer = (imbyte*)realloc(mem->buffer, (size_t)alloc);
+    if (!buffer)
+      return 0;
+
+    mem->buffer = buffer;
+    mem->alloc = alloc;
+  }
+
+  memcpy(mem->buffer + mem->offset, buf, (size_t)size);
+  mem->offset += size;
+  if (mem->offset > mem->size)
+    mem->size = mem->offset;
+
+  return size;
+}
+
+static toff_t iTIFFMemSeekProc(thandle_t fd, toff_t off, int whence)
+{
+  iTIFFMemFile* mem = (iTIFFMemFile*)fd;
+  switch (whence)
+  {
+  case SEEK_SET:
+    mem->offset = off;
+    break;
+  case SEEK_CUR:
+    mem->offset += off;
+    break;
+  case SEEK_END:
+    mem->offset = mem->size + off;
+    break;
+  }
+
+  return mem->offset;
+}
+
+static int iTIFFMemCloseProc(thandle_t fd)
+{
+  (void) fd;
+  return 0;
+}
+
+static toff_t iTIFFMemSizeProc(thandle_t fd)
+{
+  iTIFFMemFile* mem = (iTIFFMemFile*)fd;
+  return mem->size;
+}
+
+static int iTIFFMemMapProc(thandle_t fd, void** pbase, toff_t* psize)
+{
+  (void) fd; (void) pbase; (void) psize;
+  return 0;
+}
+
+static void iTIFFMemUnmapProc(thandle_t fd, void* base, toff_t size)
+{
+  (void) fd; (void) base; (void) size;
+}
+
+static int iTIFFCanWriteParallel(TIFF* tiff)
+{
+  uint16 Compression = COMPRESSION_NONE;
+  TIFFGetField(tiff, TIFFTAG_COMPRESSION, &Compression);
+
+  return Compression == COMPRESSION_LZW ||
+         Compression == COMPRESSION_DEFLATE ||
+         Compression == COMPRESSION_ADOBE_DEFLATE ||
+         Compression == COMPRESSION_PACKBITS;
+}
+
+static TIFF* iTIFFMemOpen(TIFF* tiff, iTIFFMemFile* mem)
+{
+  memset(mem, 0, sizeof(iTIFFMemFile));
+
+  TIFF* mem_tiff = TIFFClientOpen(TIFFFileName(tiff), "w", (thandle_t)mem,
+                                  iTIFFMemReadProc, iTIFFMemWriteProc,
+                                  iTIFFMemSeekProc, iTIFFMemCloseProc,
+                                  iTIFFMemSizeProc, iTIFFMemMapProc,
+                                  iTIFFMemUnmapProc);
+  if (!mem_tiff)
+    return NULL;
+
+  /* only the fields used by the encoder */
+  uint32 Width, Height, tileWidth, tileLength;
+  uint16 Compression, BitsPerSample, SamplesPerPixel, SampleFormat;
+  TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &Width);
+  TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &Height);
+  TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &tileWidth);
+  TIFFGetField(tiff, TIFFTAG_TILELENGTH, &tileLength);
+  TIFFGetField(tiff, TIFFTAG_COMPRESSION, &Compression);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &BitsPerSample);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &SamplesPerPixel);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &SampleFormat);
+
+  TIFFSetField(mem_tiff, TIFFTAG_IMAGEWIDTH, Width);
+  TIFFSetField(mem_tiff, TIFFTAG_IMAGELENGTH, Height);
+  TIFFSetField(mem_tiff, TIFFTAG_TILEWIDTH, tileWidth);
+  TIFFSetField(mem_tiff, TIFFTAG_TILELENGTH, tileLength);
+  TIFFSetField(mem_tiff, TIFFTAG_BITSPERSAMPLE, BitsPerSample);
+  TIFFSetField(mem_tiff, TIFFTAG_SAMPLESPERPIXEL, SamplesPerPixel);
+  TIFFSetField(mem_tiff, TIFFTAG_SAMPLEFORMAT, SampleFormat);
+  TIFFSetField(mem_tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+  TIFFSetField(mem_tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  TIFFSetField(mem_tiff, TIFFTAG_COMPRESSION, Compression);
+
+  int zip_quality;
+  if ((Compression == COMPRESSION_DEFLATE || Compression == COMPRESSION_ADOBE_DEFLATE) &&
+      TIFFGetField(tiff, TIFFTAG_ZIPQUALITY, &zip_quality))
+    TIFFSetField(mem_tiff, TIFFTAG_ZIPQUALITY, zip_quality);
+
+  return mem_tiff;
+}
+
+static void iTIFFMemClose(TIFF* mem_tiff, iTIFFMemFile* mem)
+{
+  TIFFClose(mem_tiff);
+  free(mem->buffer);
+}
+
+#endif
+
+static void iTIFFCopyTile(const imbyte* band_buf, int band_line_size, imbyte* tile_buf, int tile_line_size, int tile_height, int t)
+{
+  for (int j = 0; j < tile_height; j++)
+    memcpy(tile_buf + j*tile_line_size, band_buf + j*band_line_size + t*tile_line_size, tile_line_size);
+}
+
+int imFileFormatTIFF::WriteTileRow(imbyte* band_buf, int band_line_size, int row, int width, int height)
+{
+  int tiles_across = (width + this->tile_width-1) / this->tile_width;
+  int tile_line_size = (int)TIFFTileRowSize(this->tiff);
+  int tile_size = (int)TIFFTileSize(this->tiff);
+
+#ifdef _OPENMP
+  int thread_count = omp_get_max_threads();
+  if (thread_count > 1 && tiles_across > 1 &&
+      width * height >= iTIFFParallelMinCount &&
+      iTIFFCanWriteParallel(this->tiff))
+  {
+    imbyte** tile_data = new imbyte* [tiles_across];
+    tmsize_t* tile_data_size = new tmsize_t [tiles_across];
+    int error = IM_ERR_NONE;
+
+#pragma omp parallel
     {
-      unsigned char* buf = (unsigned char*)this->line_buffer;
-      for (int b = 0; b < this->line_buffer_size; b++)
+      iTIFFMemFile mem;
+      TIFF* mem_tiff = iTIFFMemOpen(this->tiff, &mem);
+      imbyte* tile_buf = (imbyte*)malloc(tile_size);
+
+#pragma omp for schedule(dynamic)
+      for (int t = 0; t < tiles_across; t++)
       {
-        *buf = ~(*buf);
-        buf++;
+        tile_data[t] = NULL;
+        if (!mem_tiff || !tile_buf)
+          continue;
+
+        iTIFFCopyTile(band_buf, band_line_size, tile_buf, tile_line_size, this->tile_height, t);
+
+        uint32 tile = TIFFComputeTile(mem_tiff, t*this->tile_width, row, 0, 0);
+        toff_t size = mem.size;
+        if (TIFFWriteEncodedTile(mem_tiff, tile, tile_buf, tile_size) <= 0)
+          continue;
+
+        /* the tile was appended to the memory file */
+        tile_data_size[t] = (tmsize_t)mem_tiff->tif_dir.td_stripbytecount[tile];
+        tile_data[t] = (imbyte*)malloc(tile_data_size[t]);
+        if (tile_data[t])
+          memcpy(tile_data[t], mem.buffer + mem_tiff->tif_dir.td_stripoffset[tile], tile_data_size[t]);
+
+        /* discard it, so the memory file does not grow */
+        mem.size = size;
+        mem.offset = size;
       }
+
+      if (tile_buf) free(tile_buf);
+      if (mem_tiff) iTIFFMemClose(mem_tiff, &mem);
     }
 
-    if (this->cpx_int)
+    for (int t = 0; t < tiles_across; t++)
     {
-      int line_count = imImageLineCount(this->width, this->user_color_mode);
-      iTIFFExpandComplexInt(this->line_buffer, line_count, this->cpx_int);
+      if (!tile_data[t])
+        error = IM_ERR_ACCESS;
+      else
+      {
+        uint32 tile = TIFFComputeTile(this->tiff, t*this->tile_width, row, 0, 0);
+        if (error == IM_ERR_NONE && TIFFWriteRawTile(this->tiff, tile, tile_data[t], tile_data_size[t]) <= 0)
+          error = IM_ERR_ACCESS;
+
+        free(tile_data[t]);
+      }
     }
 
-    if (this->lab_fix)
-      iTIFFLabFix(this->line_buffer, this->width, this->file_data_type, 0);
+    delete [] tile_data_size;
+    delete [] tile_data;
+    return error;
+  }
+#endif
 
-    if (this->extra_sample_size)
-      iTIFFExtraSamplesFix((imbyte*)this->line_buffer, this->width, this->sample_size, this->extra_sample_size, plane);
+  imbyte* tile_buf = (imbyte*)malloc(tile_size);
+  if (!tile_buf)
+    return IM_ERR_MEM;
 
-    imFileLineBufferRead(this, data, row, plane);
+  for (int t = 0; t < tiles_across; t++)
+  {
+    iTIFFCopyTile(band_buf, band_line_size, tile_buf, tile_line_size, this->tile_height, t);
 
-    if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    uint32 tile = TIFFComputeTile(this->tiff, t*this->tile_width, row, 0, 0);
+    if (TIFFWriteEncodedTile(this->tiff, tile, tile_buf, tile_size) <= 0)
+    {
+      free(tile_buf);
+      return IM_ERR_ACCESS;
+    }
+  }
 
-    imFileLineBufferInc(this, &row, &plane);
+  free(tile_buf);
+  return IM_ERR_NONE;
+}
+
+int imFileFormatTIFF::WriteLevelBegin(int width, int reduce)
+{
+  /* Allocates the buffers kept between the rows of a resolution level. */
+
+  if (reduce)
+  {
+    this->write_prev_line = (imbyte*)malloc(iTIFFLineSize(width, this->file_color_mode, this->file_data_type));
+    if (!this->write_prev_line)
+      return IM_ERR_MEM;
+  }
+
+  if (this->tile_width)
+  {
+    int tiles_across = (width + this->tile_width-1) / this->tile_width;
+    this->write_band_line_size = tiles_across * (int)TIFFTileRowSize(this->tiff);
+    this->write_band_buf = (imbyte*)malloc(this->write_band_line_size * this->tile_height);
+    if (!this->write_band_buf)
+    {
+      WriteLevelEnd();
+      return IM_ERR_MEM;
+    }
   }
-#endif
 
   return IM_ERR_NONE;
 }
 
-int imFileFormatTIFF::WriteImageData(void* data)
+void imFileFormatTIFF::WriteLevelEnd()
 {
-  int count = imFileLineBufferCount(this);
+  if (this->write_prev_line) free(this->write_prev_line);
+  if (this->write_band_buf) free(this->write_band_buf);
+  this->write_prev_line = NULL;
+  this->write_band_buf = NULL;
+}
 
-  imCounterTotal(this->counter, count, "Writing TIFF...");
+int imFileFormatTIFF::WriteImageLevel(void* data, const imbyte* level_buf, int width, int height, imbyte* reduce_buf)
+{
+  /* Writes the image from the user data or from a reduced resolution buffer.
+     When reduce_buf is not NULL, also computes the next reduced resolution image. */
+
+  int error = WriteLevelBegin(width, reduce_buf != NULL);
+  if (error)
+    return error;
+
+  error = WriteLevelRows(data, level_buf, 0, height, width, height, reduce_buf);
 
-  int row = 0, plane = 0;
-  for (int i = 0; i < count; i++)
+  WriteLevelEnd();
+  return error;
+}
+
+int imFileFormatTIFF::WriteLevelRows(void* data, const imbyte* level_buf, int first_row, int count, int width, int height, imbyte* reduce_buf)
+{
+  /* level_buf has all the rows of the level, data has the rows given to imFileWriteImageLines */
+
+  int line_size = iTIFFLineSize(width, this->file_color_mode, this->file_data_type);
+  int reduce_line_size = iTIFFLineSize((width + 1) / 2, this->file_color_mode, this->file_data_type);
+  imbyte* prev_line = this->write_prev_line;
+  imbyte* band_buf = this->write_band_buf;
+  int band_line_size = this->write_band_line_size;
+
+  int error = IM_ERR_NONE;
+  for (int row = first_row; row < first_row + count; row++)
   {
-    imFileLineBufferWrite(this, data, row, plane);
+    const imbyte* line;
+    if (level_buf)
+      line = level_buf + row*line_size;
+    else
+    {
+      imFileLineBufferWrite(this, data, row, 0);
+      line = (imbyte*)this->line_buffer;
+    }
+
+    if (reduce_buf)
+    {
+      if (row % 2 == 0)
+        memcpy(prev_line, line, line_size);
+
+      if (row % 2 == 1 || row == height-1)
+        iTIFFReduce(prev_line, line, reduce_buf + (row/2)*reduce_line_size, width, this->file_color_mode, this->file_data_type);
+    }
+
+    imbyte* dst_line = (imbyte*)this->line_buffer;
+    if (band_buf)
+    {
+      int band_row = row % this->tile_height;
+      if (band_row == 0)
+        memset(band_buf, 0, band_line_size * this->tile_height);
+
+      dst_line = band_buf + band_row*band_line_size;
+    }
+
+    if (dst_line != line)
+      memcpy(dst_line, line, line_size);
 
     if (this->lab_fix)
-      iTIFFLabFix(this->line_buffer, this->width, this->file_data_type, 1);
+      iTIFFLabFix(dst_line, width, this->file_data_type, 1);
 
-    if (TIFFWriteScanline(this->tiff, this->line_buffer, row, (tsample_t)plane) <= 0)
-      return IM_ERR_ACCESS;
+    if (band_buf)
+    {
+      if (row % this->tile_height == this->tile_height-1 || row == height-1)
+      {
+        error = WriteTileRow(band_buf, band_line_size, row - row % this->tile_height, width, height);
+        if (error)
+          break;
+      }
+    }
+    else
+    {
+      if (TIFFWriteScanline(this->tiff, dst_line, row, 0) <= 0)
+      {
+        error = IM_ERR_ACCESS;
+        break;
+      }
+    }
 
     if (!imCounterInc(this->counter))
-      return IM_ERR_COUNTER;
+    {
+      error = IM_ERR_COUNTER;
+      break;
+    }
+  }
 
-    imFileLineBufferInc(this, &row, &plane);
+  return error;
+}
+
+int imFileFormatTIFF::WriteImageData(void* data)
+{
+  int count = imFileLineBufferCount(this);
+
+  /* file is always packed when writing, so count is the image height */
+  int h = this->height;
+  for (int o = 0; o < this->overview_count; o++)
+  {
+    h = (h + 1) / 2;
+    count += h;
+  }
+
+  imCounterTotal(this->counter, count, "Writing TIFF...");
+
+  int w = this->width;
+  h = this->height;
+  imbyte* level_buf = NULL;
+  imbyte* reduce_buf = NULL;
+  if (this->overview_count)
+  {
+    reduce_buf = (imbyte*)malloc(iTIFFLineSize((w + 1) / 2, this->file_color_mode, this->file_data_type) * ((h + 1) / 2));
+    if (!reduce_buf)
+      return IM_ERR_MEM;
+  }
+
+  /* used by the reduced resolution images */
+  uint16 Compression = COMPRESSION_NONE;
+  TIFFGetField(this->tiff, TIFFTAG_COMPRESSION, &Compression);
+
+  int error = WriteImageLevel(data, NULL, w, h, reduce_buf);
+  if (error)
+  {
+    if (reduce_buf) free(reduce_buf);
+    return error;
   }
 
   this->image_count++;
 
   if (!TIFFWriteDirectory(this->tiff))
-    return IM_ERR_ACCESS;
+    error = IM_ERR_ACCESS;
+
+  for (int o = 1; o <= this->overview_count && !error; o++)
+  {
+    if (level_buf) free(level_buf);
+    level_buf = reduce_buf;
+    reduce_buf = NULL;
 
-   return IM_ERR_NONE;
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+
+    if (o < this->overview_count)
+    {
+      reduce_buf = (imbyte*)malloc(iTIFFLineSize((w + 1) / 2, this->file_color_mode, this->file_data_type) * ((h + 1) / 2));
+      if (!reduce_buf)
+      {
+        error = IM_ERR_MEM;
+        break;
+      }
+    }
+
+    WriteImageFields(w, h, Compression);
+
+    uint32 SubFileType = FILETYPE_REDUCEDIMAGE;
+    TIFFSetField(this->tiff, TIFFTAG_SUBFILETYPE, SubFileType);
+
+    error = WriteImageLevel(NULL, level_buf, w, h, reduce_buf);
+
+    if (!error && !TIFFWriteDirectory(this->tiff))
+      error = IM_ERR_ACCESS;
+  }
+
+  if (level_buf) free(level_buf);
+  if (reduce_buf) free(reduce_buf);
+
+  return error;
+}
+
+int imFileFormatTIFF::WriteImageLines(void* data, int first_line, int count)
+{
+  /* the reduced resolution images need the whole image */
+  if (this->overview_count)
+    return IM_ERR_DATA;
+
+  if (first_line == 0)
+  {
+    imCounterTotal(this->counter, this->height, "Writing TIFF...");
+
+    int error = WriteLevelBegin(this->width, 0);
+    if (error)
+      return error;
+  }
+
+  int error = WriteLevelRows(data, NULL, first_line, count, this->width, this->height, NULL);
+  if (error)
+  {
+    WriteLevelEnd();
+    return error;
+  }
+
+  if (first_line + count == this->height)
+  {
+    WriteLevelEnd();
+
+    this->image_count++;
+
+    if (!TIFFWriteDirectory(this->tiff))
+      return IM_ERR_ACCESS;
+  }
+
+  return IM_ERR_NONE;
 }
 
 int imFormatTIFF::CanWrite(const char* compression, int color_mode, int data_type) const
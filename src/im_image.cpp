@@ -8,13 +8,20 @@
 #include <memory.h>
 #include <string.h>
 #include <assert.h>
+#if defined(WIN32) || defined(_WIN32)
+#include <malloc.h>
+#endif
 
 #include "im.h"
 #include "im_image.h"
 #include "im_util.h"
 #include "im_attrib.h"
 #include "im_file.h"
+#include "im_format.h"
 #include "im_color.h"
+#include "im_complex.h"
+
+#include "im_thread.h"
 
 
 int imImageCheckFormat(int color_mode, int data_type)
@@ -52,7 +59,422 @@ int imImageLineSize(int width, int color_mode, int data_type)
   return imImageLineCount(width, color_mode) * imDataTypeSize(data_type);
 }
 
-static void iImageInit(imImage* image, int width, int height, int color_space, int data_type, int has_alpha)
+/* Image buffer pool.
+ * Buffers released by imImageDestroy are kept in free lists by size class
+ * and reused by imImageCreate, avoiding new allocations and page faults in loops.
+ * Size classes have 4 steps per power of 2, so at most 25% is wasted.
+ * The pool buffers are aligned to IM_IMAGE_ALIGN bytes, 
+ * smaller buffers are allocated from the pool only when alignment is required.
+ * A table of the buffers allocated by the pool identifies them when released,
+ * other buffers (given to imImageInit for instance) are not pooled. */
+
+#define IM_POOL_MIN_SIZE   65536  /* smaller buffers are not pooled */
+#define IM_POOL_MIN_SHIFT  16
+#define IM_POOL_CLASSES    60     /* up to 2 Gb */
+
+#define IM_IMAGE_ALIGN     64     /* cache line size, also enough for any vector load */
+
+struct iPoolEntry
+{
+  void* buffer;
+  int size_class;
+};
+
+static iMutex iPoolMutex = IM_MUTEX_INITIALIZER;
+static void* iPoolFree[IM_POOL_CLASSES];       /* free lists, the next buffer is stored in the buffer */
+static int iPoolFreeCount[IM_POOL_CLASSES];
+static size_t iPoolFreeSize = 0;
+static size_t iPoolMaxSize = 128*1024*1024;    /* default 128 Mb of free buffers */
+static int iPoolMaxCount = 8;                   /* default 8 free buffers per size class */
+
+static iPoolEntry* iPoolTable = NULL;          /* open addressing hash table of the allocated buffers */
+static size_t iPoolTableSize = 0, iPoolTableCount = 0;
+
+static size_t iPoolClassSize(int size_class)
+{
+  int shift = size_class/4 + IM_POOL_MIN_SHIFT;
+  return (size_t)(4 + size_class%4) << (shift-2);
+}
+
+static int iPoolClass(size_t size)
+{
+  int shift = IM_POOL_MIN_SHIFT;
+  while (shift < IM_POOL_MIN_SHIFT + IM_POOL_CLASSES/4 && ((size_t)1 << (shift+1)) <= size)
+    shift++;
+
+  size_t base = (size_t)1 << shift;
+  size_t step = base / 4;
+  int size_class = (shift - IM_POOL_MIN_SHIFT)*4 + (int)((size - base + step-1) / step);
+  if (size_class >= IM_POOL_CLASSES)
+    return -1;
+  return size_class;
+}
+
+static void* iPoolBufferAlloc(size_t size)
+{
+#if defined(WIN32) || defined(_WIN32)
+  return _aligned_malloc(size, IM_IMAGE_ALIGN);
+#else
+  void* buffer;
+  if (posix_memalign(&buffer, IM_IMAGE_ALIGN, size) != 0)
+    return NULL;
+  return buffer;
+#endif
+}
+
+static void iPoolBufferFree(void* buffer)
+{
+#if defined(WIN32) || defined(_WIN32)
+  _aligned_free(buffer);
+#else
+  free(buffer);
+#endif
+}
+
+static size_t iPoolHash(void* buffer, size_t table_size)
+{
+  size_t h = (size_t)buffer >> 4;
+  h *= (size_t)2654435761U;
+  return h & (table_size-1);
+}
+
+static int iPoolTableInsert(void* buffer, int size_class)
+{
+  if (2*(iPoolTableCount+1) > iPoolTableSize)
+  {
+    size_t new_size = iPoolTableSize? 2*iPoolTableSize: 256;
+    iPoolEntry* new_table = (iPoolEntry*)calloc(new_size, sizeof(iPoolEntry));
+    if (!new_table)
+      return 0;
+
+    for (size_t i = 0; i < iPoolTableSize; i++)
+    {
+      if (iPoolTable[i].buffer)
+      {
+        size_t h = iPoolHash(iPoolTable[i].buffer, new_size);
+        while (new_table[h].buffer)
+          h = (h+1) & (new_size-1);
+        new_table[h] = iPoolTable[i];
+      }
+    }
+
+    free(iPoolTable);
+    iPoolTable = new_table;
+    iPoolTableSize = new_size;
+  }
+
+  size_t h = iPoolHash(buffer, iPoolTableSize);
+  while (iPoolTable[h].buffer)
+    h = (h+1) & (iPoolTableSize-1);
+  iPoolTable[h].buffer = buffer;
+  iPoolTable[h].size_class = size_class;
+  iPoolTableCount++;
+  return 1;
+}
+
+static long iPoolTableFind(void* buffer)
+{
+  /* returns the table position, or -1 if not a pool buffer */
+  if (!iPoolTableCount)
+    return -1;
+
+  size_t h = iPoolHash(buffer, iPoolTableSize);
+  while (iPoolTable[h].buffer != buffer)
+  {
+    if (!iPoolTable[h].buffer)
+      return -1;
+    h = (h+1) & (iPoolTableSize-1);
+  }
+
+  return (long)h;
+}
+
+static int iPoolTableRemove(void* buffer)
+{
+  /* returns the size class, or -1 if not a pool buffer */
+  long pos = iPoolTableFind(buffer);
+  if (pos < 0)
+    return -1;
+
+  size_t mask = iPoolTableSize-1;
+  size_t h = (size_t)pos;
+  int size_class = iPoolTable[h].size_class;
+
+  /* backward shift deletion, keeps the probe sequences valid */
+  size_t i = h, j = h;
+  for (;;)
+  {
+    j = (j+1) & mask;
+    if (!iPoolTable[j].buffer)
+      break;
+    size_t k = iPoolHash(iPoolTable[j].buffer, iPoolTableSize);
+    if ((i <= j)? (i < k && k <= j): (i < k || k <= j))
+      continue;
+    iPoolTable[i] = iPoolTable[j];
+    i = j;
+  }
+  iPoolTable[i].buffer = NULL;
+  iPoolTableCount--;
+
+  return size_class;
+}
+
+static void* iImageBufferAlloc(size_t size, int aligned)
+{
+  int size_class = -1;
+  if ((size >= IM_POOL_MIN_SIZE && iPoolMaxCount > 0) || aligned)
+    size_class = iPoolClass(size < IM_POOL_MIN_SIZE? IM_POOL_MIN_SIZE: size);
+  if (size_class < 0)
+    return aligned? NULL: malloc(size);
+
+  iMutexLock(&iPoolMutex);
+  void* buffer = iPoolFree[size_class];
+  if (buffer)
+  {
+    iPoolFree[size_class] = *(void**)buffer;
+    iPoolFreeCount[size_class]--;
+    iPoolFreeSize -= iPoolClassSize(size_class);
+  }
+  iMutexUnlock(&iPoolMutex);
+
+  if (!buffer)
+    buffer = iPoolBufferAlloc(iPoolClassSize(size_class));
+  if (!buffer)
+    return NULL;
+
+  iMutexLock(&iPoolMutex);
+  int registered = iPoolTableInsert(buffer, size_class);
+  iMutexUnlock(&iPoolMutex);
+
+  if (!registered)  /* it could not be identified when released */
+  {
+    iPoolBufferFree(buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+static void iImageBufferFree(void* buffer)
+{
+  iMutexLock(&iPoolMutex);
+  int size_class = iPoolTableRemove(buffer);
+  if (size_class >= 0)
+  {
+    size_t class_size = iPoolClassSize(size_class);
+    if (iPoolFreeCount[size_class] < iPoolMaxCount && iPoolFreeSize + class_size <= iPoolMaxSize)
+    {
+      *(void**)buffer = iPoolFree[size_class];
+      iPoolFree[size_class] = buffer;
+      iPoolFreeCount[size_class]++;
+      iPoolFreeSize += class_size;
+      buffer = NULL;
+    }
+  }
+  iMutexUnlock(&iPoolMutex);
+
+  if (buffer)
+  {
+    if (size_class >= 0)
+      iPoolBufferFree(buffer);
+    else
+      free(buffer);
+  }
+}
+
+static void* iImageBufferRealloc(void* buffer, size_t size, int aligned)
+{
+  if (!buffer)
+    return iImageBufferAlloc(size, aligned);
+
+  iMutexLock(&iPoolMutex);
+  long pos = iPoolTableFind(buffer);
+  int size_class = pos < 0? -1: iPoolTable[pos].size_class;
+  iMutexUnlock(&iPoolMutex);
+
+  if (size_class < 0)
+    return realloc(buffer, size);
+
+  size_t class_size = iPoolClassSize(size_class);
+  if (size <= class_size)
+    return buffer;  /* already large enough */
+
+  void* new_buffer = iImageBufferAlloc(size, aligned);
+  if (!new_buffer)
+    return NULL;
+
+  memcpy(new_buffer, buffer, class_size);
+  iImageBufferFree(buffer);
+  return new_buffer;
+}
+
+static void iImageBufferForget(void* buffer)
+{
+  /* the buffer now belongs to the application */
+  iMutexLock(&iPoolMutex);
+  iPoolTableRemove(buffer);
+  iMutexUnlock(&iPoolMutex);
+}
+
+static void iPoolTrim(void)
+{
+  /* called with the mutex locked, returns the free list to the heap until inside the limits */
+  for (int c = IM_POOL_CLASSES-1; c >= 0; c--)
+  {
+    while (iPoolFree[c] && (iPoolFreeCount[c] > iPoolMaxCount || iPoolFreeSize > iPoolMaxSize))
+    {
+      void* buffer = iPoolFree[c];
+      iPoolFree[c] = *(void**)buffer;
+      iPoolFreeCount[c]--;
+      iPoolFreeSize -= iPoolClassSize(c);
+      iPoolBufferFree(buffer);
+    }
+  }
+}
+
+void imImageSetBufferPool(int max_size, int max_count)
+{
+  iMutexLock(&iPoolMutex);
+  iPoolMaxSize = max_size > 0? (size_t)max_size*1024*1024: 0;
+  iPoolMaxCount = max_size > 0 && max_count > 0? max_count: 0;
+  iPoolTrim();
+  iMutexUnlock(&iPoolMutex);
+}
+
+void imImageReleaseBufferPool(void)
+{
+  iMutexLock(&iPoolMutex);
+  size_t max_size = iPoolMaxSize;
+  iPoolMaxSize = 0;
+  iPoolTrim();
+  iPoolMaxSize = max_size;
+  iMutexUnlock(&iPoolMutex);
+}
+
+/* Shared data.
+ * Views reference the data buffer of another image, 
+ * and copy-on-write duplicates reference the data buffer of the original image.
+ * When the first view or duplicate is created the buffer and the attribute table of the image
+ * are moved to a reference counted record, shared by all the images that use them.
+ * They are released only when the last image that uses them is destroyed. 
+ * Views write through the shared buffer, attribute table and palette.
+ * Copy-on-write images receive a private copy of the buffer in imImageMakeWritable,
+ * and a private copy of the attribute table before the first change. Their palettes are always private. */
+
+struct iImageShared
+{
+  int ref_count;          /* images that use the buffer */
+  int attrib_ref_count;   /* images that use the attribute table */
+  int copy_on_write;
+  void* buffer;
+  imAttribTable* attrib_table;
+  long* palette;          /* only for views */
+};
+
+static iMutex iSharedMutex = IM_MUTEX_INITIALIZER;
+
+static iImageShared* iImageSharedAddRef(imImage* image, int copy_on_write)
+{
+  iMutexLock(&iSharedMutex);
+  iImageShared* shared = (iImageShared*)image->shared;
+  if (!shared)
+  {
+    shared = (iImageShared*)malloc(sizeof(iImageShared));
+    if (shared)
+    {
+      shared->ref_count = 1;
+      shared->attrib_ref_count = 1;
+      shared->copy_on_write = copy_on_write;
+      shared->buffer = image->data[0];
+      shared->attrib_table = (imAttribTable*)image->attrib_table;
+      shared->palette = copy_on_write? NULL: image->palette;
+      image->shared = shared;
+    }
+  }
+  else if (shared->copy_on_write != copy_on_write)
+    shared = NULL;
+
+  if (shared)
+  {
+    shared->ref_count++;
+    if (image->attrib_table == shared->attrib_table)
+      shared->attrib_ref_count++;
+  }
+  iMutexUnlock(&iSharedMutex);
+  return shared;
+}
+
+/* releases the references of the image, but not its private palette and attribute table */
+static void iImageSharedRelease(imImage* image, int keep_buffer)
+{
+  iImageShared* shared = (iImageShared*)image->shared;
+  imAttribTable* attrib_table = NULL;
+
+  iMutexLock(&iSharedMutex);
+  if (keep_buffer)
+    shared->buffer = NULL;
+  if (image->attrib_table == shared->attrib_table)
+  {
+    shared->attrib_ref_count--;
+    if (shared->attrib_ref_count == 0)
+    {
+      attrib_table = shared->attrib_table;
+      shared->attrib_table = NULL;
+    }
+  }
+  int ref_count = --shared->ref_count;
+  iMutexUnlock(&iSharedMutex);
+
+  image->shared = NULL;
+
+  delete attrib_table;
+
+  if (ref_count)
+    return;
+
+  if (shared->buffer)
+    iImageBufferFree(shared->buffer);
+
+  if (shared->palette)
+    free(shared->palette);
+
+  free(shared);
+}
+
+/* copy-on-write images must have a private attribute table before changing it */
+static void iImageAttribWritable(const imImage* image)
+{
+  iImageShared* shared = (iImageShared*)image->shared;
+  if (!shared || !shared->copy_on_write || image->attrib_table != shared->attrib_table)
+    return;
+
+  iMutexLock(&iSharedMutex);
+  int attrib_ref_count = shared->attrib_ref_count;
+  iMutexUnlock(&iSharedMutex);
+
+  if (attrib_ref_count == 1)
+    return;
+
+  /* no one can change the table while we still reference it */
+  imAttribTable* attrib_table = new imAttribTable(599);
+  attrib_table->CopyFrom(*shared->attrib_table);
+
+  imAttribTable* old_attrib_table = NULL;
+  iMutexLock(&iSharedMutex);
+  shared->attrib_ref_count--;
+  if (shared->attrib_ref_count == 0)
+  {
+    old_attrib_table = shared->attrib_table;
+    shared->attrib_table = NULL;
+  }
+  iMutexUnlock(&iSharedMutex);
+
+  delete old_attrib_table;
+
+  ((imImage*)image)->attrib_table = attrib_table;
+}
+
+static void iImageInit(imImage* image, int width, int height, int color_space, int data_type, int has_alpha, int line_stride, int plane_size)
 {
   assert(width>0);
   assert(height>0);
@@ -67,8 +489,25 @@ static void iImageInit(imImage* image, int width, int height, int color_space, i
 
   image->depth = imColorModeDepth(color_space);
   image->line_size = image->width * imDataTypeSize(data_type); 
-  image->plane_size = image->line_size * image->height; 
-  image->size = image->plane_size * image->depth;
+
+  /* packed lines have all the components, including alpha */
+  int packed = image->flags & IM_IMAGE_PACKED;
+  if (packed)
+    image->line_size *= has_alpha? image->depth+1: image->depth;
+
+  /* line_stride and plane_size are given only for external buffers and views */
+  if (!line_stride)
+  {
+    line_stride = image->line_size;
+    if (image->flags & IM_IMAGE_ALIGNED)
+      line_stride = (line_stride + IM_IMAGE_ALIGN-1) & ~(IM_IMAGE_ALIGN-1);
+  }
+  if (!plane_size)
+    plane_size = packed? imDataTypeSize(data_type): line_stride * image->height;
+
+  image->line_stride = line_stride;
+  image->plane_size = plane_size; 
+  image->size = packed? line_stride * image->height: image->plane_size * image->depth;
   image->count = image->width * image->height; 
 
   int depth = image->depth+1;  // add room for an alpha plane pointer, even if does not have alpha now.
@@ -87,18 +526,42 @@ static void iImageInit(imImage* image, int width, int height, int color_space, i
     image->data = (void**)malloc(depth * sizeof(void*));
 }
 
-imImage* imImageInit(int width, int height, int color_mode, int data_type, void* data_buffer, long* palette, int palette_count)
+/* number of bytes allocated for the image data */
+static int iImageBufferSize(const imImage* image)
+{
+  if (image->has_alpha && !(image->flags & IM_IMAGE_PACKED))
+    return image->size + image->plane_size;
+  else
+    return image->size;
+}
+
+/* number of samples from one pixel to the next in the same plane */
+static int iImagePixelStep(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->has_alpha? image->depth+1: image->depth;
+  else
+    return 1;
+}
+
+static imImage* iImageCreateStruct(int width, int height, int color_mode, int data_type, int flags, int line_stride, int plane_size, void* data_buffer, long* palette, int palette_count)
 {
   if (!imImageCheckFormat(color_mode, data_type))
     return NULL;
                  
   imImage* image = (imImage*)malloc(sizeof(imImage));
   image->data = 0;
+  image->flags = flags & (IM_IMAGE_ALIGNED | IM_IMAGE_COPYONWRITE | IM_IMAGE_PACKED);
+  if (imColorModeIsPacked(color_mode))
+    image->flags |= IM_IMAGE_PACKED;
+  image->shared = NULL;
     
-  iImageInit(image, width, height, imColorModeSpace(color_mode), data_type, imColorModeHasAlpha(color_mode));
+  iImageInit(image, width, height, imColorModeSpace(color_mode), data_type, imColorModeHasAlpha(color_mode), line_stride, plane_size);
 
   if (data_buffer)
   {
+    iImageBufferForget(data_buffer);
+
     int depth = image->has_alpha? image->depth+1: image->depth;
     for (int d = 0; d < depth; d++)
       image->data[d] = (imbyte*)data_buffer + d*image->plane_size;
@@ -121,9 +584,155 @@ imImage* imImageInit(int width, int height, int color_mode, int data_type, void*
   return image;
 }
 
-imImage* imImageCreate(int width, int height, int color_space, int data_type)
+imImage* imImageInit(int width, int height, int color_mode, int data_type, void* data_buffer, long* palette, int palette_count)
+{
+  return iImageCreateStruct(width, height, color_mode, data_type, 0, 0, 0, data_buffer, palette, palette_count);
+}
+
+imImage* imImageInitStride(int width, int height, int color_mode, int data_type, void* data_buffer, int line_stride, int plane_size, long* palette, int palette_count)
+{
+  int type_size = imDataTypeSize(data_type);
+  int line_size = width * type_size;
+  if (imColorModeIsPacked(color_mode))
+  {
+    if (plane_size)
+      return NULL;
+    line_size *= imColorModeDepth(color_mode);  /* includes alpha */
+  }
+
+  if ((line_stride && (line_stride < line_size || line_stride % type_size)) ||
+      (plane_size && (plane_size < (line_stride? line_stride: line_size) * height || plane_size % type_size)))
+    return NULL;
+
+  return iImageCreateStruct(width, height, color_mode, data_type, 0, line_stride, plane_size, data_buffer, palette, palette_count);
+}
+
+int imImageIsContiguous(const imImage* image)
+{
+  assert(image);
+  return !(image->flags & IM_IMAGE_PACKED) &&
+         image->line_stride == image->line_size && 
+         image->plane_size == image->line_size * image->height;
+}
+
+imImage* imImageCreateView(imImage* image, int xmin, int ymin, int width, int height)
+{
+  assert(image);
+
+  if (xmin < 0 || ymin < 0 || width <= 0 || height <= 0 ||
+      xmin + width > image->width || ymin + height > image->height)
+    return NULL;
+
+  /* a copy-on-write image must own its buffer before it can be shared by views */
+  if (!imImageMakeWritable(image))
+    return NULL;
+
+  imImage* view = (imImage*)malloc(sizeof(imImage));
+  if (!view)
+    return NULL;
+
+  view->data = 0;
+  view->flags = image->flags & ~IM_IMAGE_ALIGNED;  /* the view data does not start at an aligned address */
+
+  /* same line_stride and plane_size of the image */
+  iImageInit(view, width, height, image->color_space, image->data_type, image->has_alpha, image->line_stride, image->plane_size);
+
+  iImageShared* shared = iImageSharedAddRef(image, 0);
+  if (!shared)
+  {
+    free(view->data);
+    free(view);
+    return NULL;
+  }
+
+  int offset = ymin*image->line_stride + xmin*(image->line_size / image->width);
+  int depth = image->has_alpha? image->depth+1: image->depth;
+  for (int d = 0; d < depth; d++)
+    view->data[d] = (imbyte*)image->data[d] + offset;
+
+  view->palette = image->palette;
+  view->palette_count = image->palette_count;
+  view->attrib_table = image->attrib_table;
+  view->shared = shared;
+
+  return view;
+}
+
+int imImageMakeWritable(imImage* image)
+{
+  assert(image);
+
+  iImageShared* shared = (iImageShared*)image->shared;
+  if (!shared || !shared->copy_on_write)
+    return 1;
+
+  iMutexLock(&iSharedMutex);
+  int ref_count = shared->ref_count;
+  iMutexUnlock(&iSharedMutex);
+
+  if (ref_count == 1)
+  {
+    /* the last image takes the buffer and the attribute table (if not already private) */
+    image->shared = NULL;
+    free(shared);
+    return 1;
+  }
+
+  int size = iImageBufferSize(image);
+  void* buffer = iImageBufferAlloc(size, image->flags & IM_IMAGE_ALIGNED);
+  if (!buffer)
+    return 0;
+
+  memcpy(buffer, image->data[0], size);
+
+  imAttribTable* attrib_table = (imAttribTable*)image->attrib_table;
+  if (attrib_table == shared->attrib_table)
+  {
+    attrib_table = new imAttribTable(599);
+    attrib_table->CopyFrom(*shared->attrib_table);
+  }
+
+  iImageSharedRelease(image, 0);
+
+  image->attrib_table = attrib_table;
+
+  int depth = image->has_alpha? image->depth+1: image->depth;
+  for (int d = 0; d < depth; d++)
+    image->data[d] = (imbyte*)buffer + d*image->plane_size;
+
+  return 1;
+}
+
+/* gives the image a private copy of the shared data, used before the data buffer is reallocated */
+static int iImageDetach(imImage* image)
+{
+  if (((iImageShared*)image->shared)->copy_on_write)
+    return imImageMakeWritable(image);
+
+  imImage* new_image = imImageDuplicate(image);
+  if (!new_image)
+    return 0;
+
+  /* views use the shared palette and attribute table */
+  iImageSharedRelease(image, 0);
+
+  free(image->data);
+
+  image->data = new_image->data;
+  image->line_stride = new_image->line_stride;
+  image->plane_size = new_image->plane_size;
+  image->size = new_image->size;
+  image->palette = new_image->palette;
+  image->palette_count = new_image->palette_count;
+  image->attrib_table = new_image->attrib_table;
+
+  free(new_image);
+  return 1;
+}
+
+imImage* imImageCreateEx(int width, int height, int color_space, int data_type, int flags)
 {
-  imImage* image = imImageInit(width, height, color_space, data_type, NULL, NULL, 0);
+  imImage* image = iImageCreateStruct(width, height, color_space, data_type, flags, 0, 0, NULL, NULL, 0);
   if (!image) 
     return NULL;
 
@@ -147,7 +756,7 @@ imImage* imImageCreate(int width, int height, int color_space, int data_type)
   }
   
   /* allocate data buffer */
-  image->data[0] = malloc(image->size);
+  image->data[0] = iImageBufferAlloc(image->size, image->flags & IM_IMAGE_ALIGNED);
   if (!image->data[0])
   {
     imImageDestroy(image);
@@ -158,11 +767,17 @@ imImage* imImageCreate(int width, int height, int color_space, int data_type)
   for (int d = 1; d < image->depth; d++)
     image->data[d] = (imbyte*)(image->data[0]) + d*image->plane_size;
 
-  imImageClear(image);
+  if (!(flags & IM_IMAGE_NOCLEAR))
+    imImageClear(image);
 
   return image;
 }
 
+imImage* imImageCreate(int width, int height, int color_space, int data_type)
+{
+  return imImageCreateEx(width, height, color_space, data_type, 0);
+}
+
 imImage* imImageCreateBased(const imImage* image, int width, int height, int color_space, int data_type)
 {
   assert(image);
@@ -172,7 +787,7 @@ imImage* imImageCreateBased(const imImage* image, int width, int height, int col
   if (color_space < 0) color_space = image->color_space;
   if (data_type < 0) data_type = image->data_type;
 
-  imImage* new_image = imImageCreate(width, height, color_space, data_type);
+  imImage* new_image = imImageCreateEx(width, height, color_space, data_type, image->flags);
   imImageCopyAttributes(image, new_image);
 
   if (image->has_alpha)
@@ -181,6 +796,42 @@ imImage* imImageCreateBased(const imImage* image, int width, int height, int col
   return new_image;
 }
 
+/* packed lines change size when alpha is added or removed */
+static int iImageRepack(imImage* image, int has_alpha)
+{
+  imbyte* old_data = (imbyte*)image->data[0];
+  int old_line_stride = image->line_stride,
+      old_pixel_size = image->line_size / image->width,
+      old_has_alpha = image->has_alpha;
+
+  iImageInit(image, image->width, image->height, image->color_space, image->data_type, has_alpha, 0, 0);
+
+  imbyte* new_data = (imbyte*)iImageBufferAlloc(image->size, image->flags & IM_IMAGE_ALIGNED);
+  if (new_data)
+  {
+    int new_pixel_size = image->line_size / image->width;
+    int copy_size = new_pixel_size < old_pixel_size? new_pixel_size: old_pixel_size;
+    for (int y = 0; y < image->height; y++)
+    {
+      imbyte* old_line = old_data + y*old_line_stride;
+      imbyte* new_line = new_data + y*image->line_stride;
+      for (int x = 0; x < image->width; x++)
+        memcpy(new_line + x*new_pixel_size, old_line + x*old_pixel_size, copy_size);
+    }
+
+    iImageBufferFree(old_data);
+    image->data[0] = new_data;
+  }
+  else /* if failed restore the previous layout */
+    iImageInit(image, image->width, image->height, image->color_space, image->data_type, old_has_alpha, old_line_stride, 0);
+
+  int depth = image->has_alpha? image->depth+1: image->depth;
+  for (int d = 1; d < depth; d++)
+    image->data[d] = (imbyte*)image->data[0] + d*image->plane_size;
+
+  return new_data != NULL;
+}
+
 void imImageAddAlpha(imImage* image)
 {
   assert(image);
@@ -188,7 +839,17 @@ void imImageAddAlpha(imImage* image)
   if (image->has_alpha)
     return;
 
-  unsigned char* new_data = (unsigned char*)realloc(image->data[0], image->size+image->plane_size);
+  if (image->shared && !iImageDetach(image))
+    return;
+
+  if (image->flags & IM_IMAGE_PACKED)
+  {
+    if (iImageRepack(image, IM_ALPHA))
+      imImageSetAlpha(image, 0);
+    return;
+  }
+
+  unsigned char* new_data = (unsigned char*)iImageBufferRealloc(image->data[0], image->size+image->plane_size, image->flags & IM_IMAGE_ALIGNED);
   if (!new_data)
     return;
 
@@ -196,9 +857,9 @@ void imImageAddAlpha(imImage* image)
   for (int d = 1; d < image->depth+1; d++)
     image->data[d] = (imbyte*)(image->data[0]) + d*image->plane_size;
 
-  memset(image->data[image->depth], 0, image->plane_size);
-
   image->has_alpha = IM_ALPHA;
+
+  imImageSetAlpha(image, 0);
 }
 
 void imImageRemoveAlpha(imImage* image)
@@ -208,7 +869,16 @@ void imImageRemoveAlpha(imImage* image)
   if (!image->has_alpha)
     return;
 
-  unsigned char* new_data = (unsigned char*)realloc(image->data[0], image->size-image->plane_size);
+  if (image->shared && !iImageDetach(image))
+    return;
+
+  if (image->flags & IM_IMAGE_PACKED)
+  {
+    iImageRepack(image, 0);
+    return;
+  }
+
+  unsigned char* new_data = (unsigned char*)iImageBufferRealloc(image->data[0], image->size, image->flags & IM_IMAGE_ALIGNED);
   if (!new_data)
     return;
 
@@ -223,17 +893,22 @@ void imImageReshape(imImage* image, int width, int height)
 {
   assert(image);
 
-  int old_size = image->size, 
-      old_width = width, 
-      old_height = height;
+  if (image->shared && !iImageDetach(image))
+    return;
+
+  int old_size = iImageBufferSize(image), 
+      old_width = image->width, 
+      old_height = image->height,
+      old_line_stride = image->line_stride,
+      old_plane_size = image->plane_size;
 
-  iImageInit(image, width, height, image->color_space, image->data_type, image->has_alpha);
+  iImageInit(image, width, height, image->color_space, image->data_type, image->has_alpha, 0, 0);
 
-  if (old_size < image->size)
+  if (old_size < iImageBufferSize(image))
   {
-    void* data0 = realloc(image->data[0], image->has_alpha? image->size+image->plane_size: image->size);
+    void* data0 = iImageBufferRealloc(image->data[0], iImageBufferSize(image), image->flags & IM_IMAGE_ALIGNED);
     if (!data0) // if failed restore the previous size
-      iImageInit(image, old_width, old_height, image->color_space, image->data_type, image->has_alpha);
+      iImageInit(image, old_width, old_height, image->color_space, image->data_type, image->has_alpha, old_line_stride, old_plane_size);
     else
       image->data[0] = data0;
   }
@@ -248,14 +923,33 @@ void imImageDestroy(imImage* image)
 {
   assert(image);
 
-  imAttribTable* attrib_table = (imAttribTable*)image->attrib_table;
-  delete attrib_table;
+  if (image->shared)
+  {
+    iImageShared* shared = (iImageShared*)image->shared;
 
-  if (image->data[0])
-    free(image->data[0]);
+    if (image->palette && image->palette != shared->palette)
+      free(image->palette);
 
-  if (image->palette)
-    free(image->palette);
+    if (image->attrib_table != shared->attrib_table)
+    {
+      imAttribTable* attrib_table = (imAttribTable*)image->attrib_table;
+      delete attrib_table;
+    }
+
+    /* data[0] of the original image can also be set to NULL to keep the buffer */
+    iImageSharedRelease(image, image->data[0] == NULL);
+  }
+  else
+  {
+    imAttribTable* attrib_table = (imAttribTable*)image->attrib_table;
+    delete attrib_table;
+
+    if (image->data[0])
+      iImageBufferFree(image->data[0]);
+
+    if (image->palette)
+      free(image->palette);
+  }
 
   free(image->data);
 
@@ -265,44 +959,98 @@ void imImageDestroy(imImage* image)
   free(image);
 }
 
+template <class T> 
+inline void iSet(T *map, T value, int count, int step)
+{
+  for (int i = 0; i < count; i++)
+  {
+    *map = value;
+    map += step;
+  }
+}
+
+template <class T> 
+static void iSetPlane(const imImage* image, int plane, T value)
+{
+  int step = iImagePixelStep(image);
+  if (step == 1 && image->line_stride == image->line_size)
+    iSet((T*)image->data[plane], value, image->count, 1);
+  else
+  {
+    /* padding and the other packed components are not written */
+    imbyte* line = (imbyte*)image->data[plane];
+    for (int y = 0; y < image->height; y++, line += image->line_stride)
+      iSet((T*)line, value, image->width, step);
+  }
+}
+
+static void iClearPlanes(const imImage* image, int plane, int plane_count)
+{
+  if (imImageIsContiguous(image))
+    memset(image->data[plane], 0, plane_count*image->plane_size);
+  else if ((image->flags & IM_IMAGE_PACKED) && plane_count < iImagePixelStep(image))
+  {
+    for (int d = plane; d < plane+plane_count; d++)
+    {
+      switch(image->plane_size)  /* the data type size */
+      {
+      case 1:
+        iSetPlane(image, d, (imbyte)0);
+        break;
+      case 2:
+        iSetPlane(image, d, (imushort)0);
+        break;
+      case 4:
+        iSetPlane(image, d, (int)0);
+        break;
+      default:
+        iSetPlane(image, d, imcfloat(0, 0));
+        break;
+      }
+    }
+  }
+  else
+  {
+    /* all the planes of a packed image are in the same line */
+    int last_plane = (image->flags & IM_IMAGE_PACKED)? 1: plane+plane_count;
+    for (int d = plane; d < last_plane; d++)
+    {
+      imbyte* line = (imbyte*)image->data[d];
+      for (int y = 0; y < image->height; y++, line += image->line_stride)
+        memset(line, 0, image->line_size);
+    }
+  }
+}
+
 void imImageClear(imImage* image)
 {
   assert(image);
 
+  imImageMakeWritable(image);
+
   if ((image->color_space == IM_YCBCR || image->color_space == IM_LAB || image->color_space == IM_LUV) && 
       (image->data_type == IM_BYTE || image->data_type == IM_USHORT))
   {
-    memset(image->data[0], 0, image->plane_size);
+    iClearPlanes(image, 0, 1);
 
     if (image->data_type == IM_BYTE)
     {
       imbyte zero = (imbyte)imColorZeroShift(image->data_type);
-      imbyte* usdata = (imbyte*)image->data[1];
-      for (int i = 0; i < 2*image->count; i++)
-        *usdata++ = zero;
+      iSetPlane(image, 1, zero);
+      iSetPlane(image, 2, zero);
     }
     else
     {
       imushort zero = (imushort)imColorZeroShift(image->data_type);
-      imushort* usdata = (imushort*)image->data[1];
-      for (int i = 0; i < 2*image->count; i++)
-        *usdata++ = zero;
+      iSetPlane(image, 1, zero);
+      iSetPlane(image, 2, zero);
     }
   }
   else
-    memset(image->data[0], 0, image->size);
+    iClearPlanes(image, 0, image->depth);
 
   if (image->has_alpha)
-    memset(image->data[image->depth], 0, image->plane_size);
-}
-
-template <class T> 
-inline void iSet(T *map, T value, int count)
-{
-  for (int i = 0; i < count; i++)
-  {
-    *map++ = value;
-  }
+    iClearPlanes(image, image->depth, 1);
 }
   
 void imImageSetAlpha(imImage* image, float alpha)
@@ -311,22 +1059,24 @@ void imImageSetAlpha(imImage* image, float alpha)
 
   if (image->has_alpha)
   {
+    imImageMakeWritable(image);
+
     switch(image->data_type)
     {
     case IM_BYTE:
-      memset(image->data[image->depth], (imbyte)alpha, image->plane_size);
+      iSetPlane(image, image->depth, (imbyte)alpha);
       break;                                                                                
     case IM_SHORT:                                                                           
-      iSet((short*)image->data[image->depth], (short)alpha, image->plane_size);
+      iSetPlane(image, image->depth, (short)alpha);
       break;                                                                                
     case IM_USHORT:                                                                           
-      iSet((imushort*)image->data[image->depth], (imushort)alpha, image->plane_size);
+      iSetPlane(image, image->depth, (imushort)alpha);
       break;                                                                                
     case IM_INT:                                                                           
-      iSet((int*)image->data[image->depth], (int)alpha, image->plane_size);
+      iSetPlane(image, image->depth, (int)alpha);
       break;                                                                                
     case IM_FLOAT:                                                                           
-      iSet((float*)image->data[image->depth], (float)alpha, image->plane_size);
+      iSetPlane(image, image->depth, (float)alpha);
       break;                                                                                
     }
   }
@@ -357,7 +1107,52 @@ void imImageCopyData(const imImage* src_image, imImage* dst_image)
 
   if (dst_image != src_image)
   {
-    memcpy(dst_image->data[0], src_image->data[0], (src_image->has_alpha && dst_image->has_alpha)? src_image->size+src_image->plane_size: src_image->size);
+    int depth = (src_image->has_alpha && dst_image->has_alpha)? src_image->depth+1: src_image->depth;
+
+    imImageMakeWritable(dst_image);
+
+    if (imImageIsContiguous(src_image) && imImageIsContiguous(dst_image))
+      memcpy(dst_image->data[0], src_image->data[0], depth*src_image->plane_size);
+    else if ((src_image->flags & IM_IMAGE_PACKED) && (dst_image->flags & IM_IMAGE_PACKED) && 
+             src_image->line_size == dst_image->line_size)
+    {
+      const imbyte* src_line = (const imbyte*)src_image->data[0];
+      imbyte* dst_line = (imbyte*)dst_image->data[0];
+      for (int y = 0; y < src_image->height; y++)
+      {
+        memcpy(dst_line, src_line, src_image->line_size);
+        src_line += src_image->line_stride;
+        dst_line += dst_image->line_stride;
+      }
+    }
+    else
+    {
+      for (int d = 0; d < depth; d++)
+        imImageCopyPlane(src_image, d, dst_image, d);
+    }
+  }
+}
+
+template <class T> 
+static void iCopyPlaneStep(const imImage* src_image, int src_plane, imImage* dst_image, int dst_plane, T)
+{
+  int src_step = iImagePixelStep(src_image);
+  int dst_step = iImagePixelStep(dst_image);
+  const imbyte* src_line = (const imbyte*)src_image->data[src_plane];
+  imbyte* dst_line = (imbyte*)dst_image->data[dst_plane];
+  for (int y = 0; y < src_image->height; y++)
+  {
+    const T* src_map = (const T*)src_line;
+    T* dst_map = (T*)dst_line;
+    for (int x = 0; x < src_image->width; x++)
+    {
+      *dst_map = *src_map;
+      src_map += src_step;
+      dst_map += dst_step;
+    }
+
+    src_line += src_image->line_stride;
+    dst_line += dst_image->line_stride;
   }
 }
 
@@ -367,14 +1162,112 @@ void imImageCopyPlane(const imImage* src_image, int src_plane, imImage* dst_imag
   assert(dst_image);
   assert(imImageMatchDataType(src_image, dst_image));
 
-  memcpy(dst_image->data[dst_plane], src_image->data[src_plane], src_image->plane_size);
+  imImageMakeWritable(dst_image);
+
+  if ((src_image->flags & IM_IMAGE_PACKED) || (dst_image->flags & IM_IMAGE_PACKED))
+  {
+    /* the components are interleaved in at least one of the images */
+    switch(imDataTypeSize(src_image->data_type))
+    {
+    case 1:
+      iCopyPlaneStep(src_image, src_plane, dst_image, dst_plane, (imbyte)0);
+      break;
+    case 2:
+      iCopyPlaneStep(src_image, src_plane, dst_image, dst_plane, (imushort)0);
+      break;
+    case 4:
+      iCopyPlaneStep(src_image, src_plane, dst_image, dst_plane, (int)0);
+      break;
+    default:
+      iCopyPlaneStep(src_image, src_plane, dst_image, dst_plane, imcfloat());
+      break;
+    }
+  }
+  else if (src_image->line_stride == src_image->line_size && dst_image->line_stride == dst_image->line_size)
+    memcpy(dst_image->data[dst_plane], src_image->data[src_plane], src_image->line_size*src_image->height);
+  else
+  {
+    const imbyte* src_line = (const imbyte*)src_image->data[src_plane];
+    imbyte* dst_line = (imbyte*)dst_image->data[dst_plane];
+    for (int y = 0; y < src_image->height; y++)
+    {
+      memcpy(dst_line, src_line, src_image->line_size);
+      src_line += src_image->line_stride;
+      dst_line += dst_image->line_stride;
+    }
+  }
+}
+
+/* the new image shares the buffer and the attribute table, the palette is copied */
+static imImage* iImageDuplicateShared(const imImage* image)
+{
+  /* views are always copied */
+  if (image->shared && !((iImageShared*)image->shared)->copy_on_write)
+    return NULL;
+
+  long* palette = NULL;
+  if (image->palette)
+  {
+    palette = (long*)malloc(256*sizeof(long));
+    if (!palette)
+      return NULL;
+    memcpy(palette, image->palette, 256*sizeof(long));
+  }
+
+  imImage* new_image = (imImage*)malloc(sizeof(imImage));
+  if (!new_image)
+  {
+    free(palette);
+    return NULL;
+  }
+
+  new_image->data = 0;
+  new_image->flags = image->flags;
+
+  iImageInit(new_image, image->width, image->height, image->color_space, image->data_type, image->has_alpha, image->line_stride, image->plane_size);
+
+  iImageShared* shared = iImageSharedAddRef((imImage*)image, 1);
+  if (!shared)
+  {
+    free(palette);
+    free(new_image->data);
+    free(new_image);
+    return NULL;
+  }
+
+  int depth = image->has_alpha? image->depth+1: image->depth;
+  for (int d = 0; d < depth; d++)
+    new_image->data[d] = image->data[d];
+
+  new_image->palette = palette;
+  new_image->palette_count = image->palette_count;
+  new_image->shared = shared;
+
+  if (image->attrib_table == shared->attrib_table)
+    new_image->attrib_table = image->attrib_table;
+  else
+  {
+    imAttribTable* attrib_table = new imAttribTable(599);
+    attrib_table->CopyFrom(*(const imAttribTable*)image->attrib_table);
+    new_image->attrib_table = attrib_table;
+  }
+
+  return new_image;
 }
 
 imImage* imImageDuplicate(const imImage* image)
 {
   assert(image);
 
-  imImage* new_image = imImageCreate(image->width, image->height, image->color_space, image->data_type);
+  if (image->flags & IM_IMAGE_COPYONWRITE)
+  {
+    imImage* new_image = iImageDuplicateShared(image);
+    if (new_image)
+      return new_image;
+  }
+
+  /* all the data will be copied */
+  imImage* new_image = imImageCreateEx(image->width, image->height, image->color_space, image->data_type, image->flags | IM_IMAGE_NOCLEAR);
   if (!new_image)
     return NULL;
 
@@ -390,7 +1283,7 @@ imImage* imImageClone(const imImage* image)
 {
   assert(image);
 
-  imImage* new_image = imImageCreate(image->width, image->height, image->color_space, image->data_type);
+  imImage* new_image = imImageCreateEx(image->width, image->height, image->color_space, image->data_type, image->flags);
   if (!new_image)
     return NULL;
 
@@ -406,6 +1299,7 @@ void imImageSetAttribute(const imImage* image, const char* attrib, int data_type
 {
   assert(image);
   assert(attrib);
+  iImageAttribWritable(image);
   imAttribTable* attrib_table = (imAttribTable*)image->attrib_table;
   if (data)
   {
@@ -432,7 +1326,8 @@ static void iAttributeTableCopy(const void* src_attrib_table, void* dst_attrib_t
 {
   const imAttribTable* src_table = (const imAttribTable*)src_attrib_table;
   imAttribTable* dst_table = (imAttribTable*)dst_attrib_table;
-  dst_table->CopyFrom(*src_table);
+  if (src_table != dst_table)  /* views share the table */
+    dst_table->CopyFrom(*src_table);
 }
 
 void imImageCopyAttributes(const imImage* src_image, imImage* dst_image)
@@ -447,6 +1342,9 @@ void imImageCopyAttributes(const imImage* src_image, imImage* dst_image)
     dst_image->palette_count = src_image->palette_count;
   }
 
+  if (src_image->attrib_table != dst_image->attrib_table)
+    iImageAttribWritable(dst_image);
+
   iAttributeTableCopy(src_image->attrib_table, dst_image->attrib_table);
 }
 
@@ -454,7 +1352,8 @@ static void iAttributeTableMerge(const void* src_attrib_table, void* dst_attrib_
 {
   const imAttribTable* src_table = (const imAttribTable*)src_attrib_table;
   imAttribTable* dst_table = (imAttribTable*)dst_attrib_table;
-  dst_table->MergeFrom(*src_table);
+  if (src_table != dst_table)
+    dst_table->MergeFrom(*src_table);
 }
 
 void imImageMergeAttributes(const imImage* src_image, imImage* dst_image)
@@ -469,6 +1368,9 @@ void imImageMergeAttributes(const imImage* src_image, imImage* dst_image)
     dst_image->palette_count = src_image->palette_count;
   }
 
+  if (src_image->attrib_table != dst_image->attrib_table)
+    iImageAttribWritable(dst_image);
+
   iAttributeTableMerge(src_image->attrib_table, dst_image->attrib_table);
 }
 
@@ -499,8 +1401,20 @@ void imImageSetPalette(imImage* image, long* palette, int palette_count)
 
   if (image->palette)
   {
-    free(image->palette);
-    image->palette = palette;
+    if (image->shared)
+    {
+      /* the palette is shared with views, update it in place */
+      if (palette != image->palette)
+      {
+        memcpy(image->palette, palette, (palette_count < 256? palette_count: 256)*sizeof(long));
+        free(palette);
+      }
+    }
+    else
+    {
+      free(image->palette);
+      image->palette = palette;
+    }
     image->palette_count = palette_count;
   }
 }
@@ -595,12 +1509,19 @@ void imImageMakeBinary(imImage *image)
 {
   assert(image);
 
-  imbyte *map = (imbyte*)image->data[0];
-  for(int i = 0; i < image->count; i++)
+  imImageMakeWritable(image);
+
+  int step = iImagePixelStep(image);
+  imbyte *line = (imbyte*)image->data[0];
+  for (int y = 0; y < image->height; y++, line += image->line_stride)
   {
-    if (*map)
-      *map = 1;
-    map++;
+    imbyte *map = line;
+    for(int x = 0; x < image->width; x++)
+    {
+      if (*map)
+        *map = 1;
+      map += step;
+    }
   }
 }
 
@@ -608,19 +1529,111 @@ void imImageMakeGray(imImage *image)
 {
   assert(image);
 
-  imbyte *map = (imbyte*)image->data[0];
-  for(int i = 0; i < image->count; i++)
+  imImageMakeWritable(image);
+
+  int step = iImagePixelStep(image);
+  imbyte *line = (imbyte*)image->data[0];
+  for (int y = 0; y < image->height; y++, line += image->line_stride)
   {
-    if (*map)
-      *map = 255;
-    map++;
+    imbyte *map = line;
+    for(int x = 0; x < image->width; x++)
+    {
+      if (*map)
+        *map = 255;
+      map += step;
+    }
   }
 }
 
+/* The file data is always contiguous, 
+   images with padding are transfered using an intermediate buffer. 
+   The lines of a packed image already contain all the components. */
+
+static int iImageContiguousPlanes(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return 1;
+  return image->has_alpha? image->depth+1: image->depth;
+}
+
+static int iImageIsTight(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->line_stride == image->line_size;
+  return imImageIsContiguous(image);
+}
+
+static int iImageColorMode(const imImage* image)
+{
+  int color_mode = image->color_space;
+  if (image->has_alpha)
+    color_mode |= IM_ALPHA;
+  if (image->flags & IM_IMAGE_PACKED)
+    color_mode |= IM_PACKED;
+  return color_mode;
+}
+
+static void iImageContiguousCopy(const imImage* image, void* buffer, int to_buffer)
+{
+  int depth = iImageContiguousPlanes(image);
+  imbyte* buffer_line = (imbyte*)buffer;
+
+  for (int d = 0; d < depth; d++)
+  {
+    imbyte* line = (imbyte*)image->data[d];
+    for (int y = 0; y < image->height; y++)
+    {
+      if (to_buffer)
+        memcpy(buffer_line, line, image->line_size);
+      else
+        memcpy(line, buffer_line, image->line_size);
+
+      line += image->line_stride;
+      buffer_line += image->line_size;
+    }
+  }
+}
+
+static void* iImageContiguousAlloc(const imImage* image)
+{
+  int depth = iImageContiguousPlanes(image);
+  return malloc(depth * image->line_size * image->height);
+}
+
 static void iLoadImageData(imFile* ifile, imImage* image, int *error, int bitmap)
 {
+  if (!imImageMakeWritable(image))
+  {
+    *error = IM_ERR_MEM;
+    return;
+  }
+
+  /* the image attributes must be complete when the file is closed, so the pending attributes are parsed here.
+     The parsing is small compared to the decoding of the image data. */
+  imFileFormatBase* ifileformat = (imFileFormatBase*)ifile;
+  ifileformat->LoadAttributes();
   iAttributeTableCopy(ifile->attrib_table, image->attrib_table);
-  *error = imFileReadImageData(ifile, image->data[0], bitmap, image->has_alpha);
+
+  int color_mode_flags = iImageColorMode(image) & ~0xFF;  /* only IM_ALPHA and IM_PACKED */
+
+  if (iImageIsTight(image))
+    *error = imFileReadImageData(ifile, image->data[0], bitmap, color_mode_flags);
+  else
+  {
+    void* buffer = iImageContiguousAlloc(image);
+    if (!buffer)
+    {
+      *error = IM_ERR_MEM;
+      return;
+    }
+
+    *error = imFileReadImageData(ifile, buffer, bitmap, color_mode_flags);
+    if (!(*error))
+      iImageContiguousCopy(image, buffer, 0);
+
+    free(buffer);
+  }
+
   if (image->color_space == IM_MAP)
     imFileGetPalette(ifile, image->palette, &image->palette_count);
 }
@@ -760,14 +1773,23 @@ int imFileSaveImage(imFile* ifile, const imImage* image)
 
   iAttributeTableCopy(image->attrib_table, ifile->attrib_table);
 
-  int color_mode = image->color_space;
-  if (image->has_alpha)
-    color_mode |= IM_ALPHA;
+  int color_mode = iImageColorMode(image);
 
   int error = imFileWriteImageInfo(ifile, image->width, image->height, color_mode, image->data_type);
   if (error) return error;
   
-  return imFileWriteImageData(ifile, image->data[0]);
+  if (iImageIsTight(image))
+    return imFileWriteImageData(ifile, image->data[0]);
+
+  void* buffer = iImageContiguousAlloc(image);
+  if (!buffer)
+    return IM_ERR_MEM;
+
+  iImageContiguousCopy(image, buffer, 1);
+  error = imFileWriteImageData(ifile, buffer);
+
+  free(buffer);
+  return error;
 }
 
 imImage* imFileImageLoad(const char* file_name, int index, int *error)
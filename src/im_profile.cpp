@@ -0,0 +1,324 @@
+/** \file
+ * \brief Operation Profiling
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_profile.h"
+#include "im.h"
+
+#include "im_thread.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(WIN32) && !defined(_WIN32)
+#include <time.h>
+#endif
+
+
+#define IM_PROFILE_MAXDEPTH  32
+#define IM_PROFILE_MAXEVENTS 1000000
+
+struct iProfileOp
+{
+  char name[64];
+  double wall_start, cpu_start;
+  double pixels, bytes;
+  int threads;
+};
+
+struct iProfileEvent
+{
+  int stats;        /* index in the statistics table */
+  int tid;
+  double start, duration;
+  double pixels, bytes;
+};
+
+static int iProfileMode = IM_PROFILE_OFF;
+static iMutex iProfileMutex = IM_MUTEX_INITIALIZER;
+
+/* protected by iProfileMutex */
+static imProfileStats* iProfileStats = NULL;
+static int iProfileStatsCount = 0, iProfileStatsSize = 0;
+static iProfileEvent* iProfileEvents = NULL;
+static int iProfileEventStart = 0, iProfileEventCount = 0, iProfileEventSize = 0;
+static double iProfileTimeBase = 0;
+static int iProfileThreadCount = 0;
+
+/* open operations of the current thread, depth can be larger than IM_PROFILE_MAXDEPTH */
+static IM_THREAD_LOCAL iProfileOp iProfileStack[IM_PROFILE_MAXDEPTH];
+static IM_THREAD_LOCAL int iProfileDepth = 0;
+static IM_THREAD_LOCAL int iProfileThreadId = 0;
+
+#if defined(WIN32) || defined(_WIN32)
+
+static double iProfileWallTime(void)
+{
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+}
+
+static double iProfileCpuTime(void)
+{
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    return 0;
+
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+  return (double)(k.QuadPart + u.QuadPart) * 1.0e-7;  /* 100 ns units */
+}
+
+#else
+
+static double iProfileWallTime(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+static double iProfileCpuTime(void)
+{
+  struct timespec ts;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+    return 0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+#endif
+
+int imProfileSetMode(int mode)
+{
+  iMutexLock(&iProfileMutex);
+  int old_mode = iProfileMode;
+  if (iProfileTimeBase == 0)
+    iProfileTimeBase = iProfileWallTime();
+  iProfileMode = mode;
+  iMutexUnlock(&iProfileMutex);
+  return old_mode;
+}
+
+int imProfileGetMode(void)
+{
+  return iProfileMode;
+}
+
+void imProfileReset(void)
+{
+  iMutexLock(&iProfileMutex);
+  free(iProfileStats);
+  iProfileStats = NULL;
+  iProfileStatsCount = 0;
+  iProfileStatsSize = 0;
+
+  free(iProfileEvents);
+  iProfileEvents = NULL;
+  iProfileEventStart = 0;
+  iProfileEventCount = 0;
+  iProfileEventSize = 0;
+
+  iProfileTimeBase = iProfileWallTime();
+  iMutexUnlock(&iProfileMutex);
+}
+
+int imProfileGetStats(imProfileStats* stats, int max_count)
+{
+  iMutexLock(&iProfileMutex);
+  int count = iProfileStatsCount;
+  if (stats)
+  {
+    if (max_count > count)
+      max_count = count;
+    if (max_count > 0)
+      memcpy(stats, iProfileStats, max_count*sizeof(imProfileStats));
+  }
+  iMutexUnlock(&iProfileMutex);
+  return count;
+}
+
+static void iProfileWriteString(FILE* file, const char* str)
+{
+  for (; *str; str++)
+  {
+    if (*str == '"' || *str == '\\')
+      fprintf(file, "\\%c", *str);
+    else if ((unsigned char)*str < 0x20)
+      fprintf(file, "\\u%04x", (unsigned char)*str);
+    else
+      fputc(*str, file);
+  }
+}
+
+int imProfileWriteTrace(const char* file_name)
+{
+  FILE* file = fopen(file_name, "w");
+  if (!file)
+    return IM_ERR_OPEN;
+
+  iMutexLock(&iProfileMutex);
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (int i = 0; i < iProfileEventCount; i++)
+  {
+    iProfileEvent* event = iProfileEvents + (iProfileEventStart + i) % iProfileEventSize;
+    fprintf(file, "{\"name\":\"");
+    iProfileWriteString(file, iProfileStats[event->stats].name);
+    fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"pixels\":%.0f,\"bytes\":%.0f}}%s\n",
+                  event->start*1.0e6, event->duration*1.0e6, event->tid,
+                  event->pixels, event->bytes, (i < iProfileEventCount-1)? ",": "");
+  }
+  fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+  iMutexUnlock(&iProfileMutex);
+
+  int error = ferror(file);
+  if (fclose(file) != 0 || error)
+    return IM_ERR_ACCESS;
+
+  return IM_ERR_NONE;
+}
+
+void imProfileBegin(const char* name, int threads)
+{
+  if (!iProfileMode)
+    return;
+
+  int depth = iProfileDepth;
+  iProfileDepth++;
+  if (depth >= IM_PROFILE_MAXDEPTH)
+    return;
+
+  iProfileOp* op = iProfileStack + depth;
+  strncpy(op->name, name? name: "", sizeof(op->name)-1);
+  op->name[sizeof(op->name)-1] = 0;
+  op->pixels = 0;
+  op->bytes = 0;
+  op->threads = threads < 1? 1: threads;
+  op->cpu_start = iProfileCpuTime();
+  op->wall_start = iProfileWallTime();
+}
+
+void imProfileAddData(double pixels, double bytes)
+{
+  int depth = iProfileDepth;
+  if (depth == 0 || depth > IM_PROFILE_MAXDEPTH)
+    return;
+
+  iProfileOp* op = iProfileStack + depth-1;
+  op->pixels += pixels;
+  op->bytes += bytes;
+}
+
+static int iProfileFindStats(const char* name)
+{
+  int i;
+  for (i = 0; i < iProfileStatsCount; i++)
+  {
+    if (strcmp(iProfileStats[i].name, name) == 0)
+      return i;
+  }
+
+  if (iProfileStatsCount == iProfileStatsSize)
+  {
+    int new_size = iProfileStatsSize? 2*iProfileStatsSize: 32;
+    imProfileStats* new_stats = (imProfileStats*)realloc(iProfileStats, new_size*sizeof(imProfileStats));
+    if (!new_stats)
+      return -1;
+    iProfileStats = new_stats;
+    iProfileStatsSize = new_size;
+  }
+
+  i = iProfileStatsCount;
+  memset(iProfileStats + i, 0, sizeof(imProfileStats));
+  strcpy(iProfileStats[i].name, name);
+  iProfileStatsCount++;
+  return i;
+}
+
+static void iProfileAddEvent(int stats, const iProfileOp* op, double duration)
+{
+  if (iProfileEventCount == iProfileEventSize && iProfileEventSize < IM_PROFILE_MAXEVENTS)
+  {
+    /* the buffer is not circular yet, so iProfileEventStart is 0 */
+    int new_size = iProfileEventSize? 2*iProfileEventSize: 1024;
+    if (new_size > IM_PROFILE_MAXEVENTS)
+      new_size = IM_PROFILE_MAXEVENTS;
+    iProfileEvent* new_events = (iProfileEvent*)realloc(iProfileEvents, new_size*sizeof(iProfileEvent));
+    if (new_events)
+    {
+      iProfileEvents = new_events;
+      iProfileEventSize = new_size;
+    }
+  }
+
+  if (iProfileEventSize == 0)
+    return;
+
+  iProfileEvent* event;
+  if (iProfileEventCount < iProfileEventSize)
+  {
+    event = iProfileEvents + (iProfileEventStart + iProfileEventCount) % iProfileEventSize;
+    iProfileEventCount++;
+  }
+  else
+  {
+    /* full, discard the oldest */
+    event = iProfileEvents + iProfileEventStart;
+    iProfileEventStart = (iProfileEventStart + 1) % iProfileEventSize;
+  }
+
+  if (!iProfileThreadId)
+    iProfileThreadId = ++iProfileThreadCount;
+
+  event->stats = stats;
+  event->tid = iProfileThreadId;
+  event->start = op->wall_start - iProfileTimeBase;
+  event->duration = duration;
+  event->pixels = op->pixels;
+  event->bytes = op->bytes;
+}
+
+void imProfileEnd(void)
+{
+  int depth = iProfileDepth;
+  if (depth == 0)
+    return;
+
+  iProfileDepth = --depth;
+  if (depth >= IM_PROFILE_MAXDEPTH)
+    return;
+
+  iProfileOp* op = iProfileStack + depth;
+  double wall_time = iProfileWallTime() - op->wall_start;
+  double cpu_time = iProfileCpuTime() - op->cpu_start;
+
+  iMutexLock(&iProfileMutex);
+  int mode = iProfileMode;
+  if (mode)
+  {
+    int stats = iProfileFindStats(op->name);
+    if (stats != -1)
+    {
+      if (mode & IM_PROFILE_STATS)
+      {
+        imProfileStats* s = iProfileStats + stats;
+        s->call_count++;
+        s->wall_time += wall_time;
+        s->cpu_time += cpu_time;
+        s->pixels += op->pixels;
+        s->bytes += op->bytes;
+        if (op->threads > s->threads)
+          s->threads = op->threads;
+      }
+
+      if (mode & IM_PROFILE_TRACE)
+        iProfileAddEvent(stats, op, wall_time);
+    }
+  }
+  iMutexUnlock(&iProfileMutex);
+}
@@ -0,0 +1,66 @@
+/** \file
+ * \brief Run Length Encoding Utilities (internal use only)
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_RLE_H
+#define __IM_RLE_H
+
+#include <string.h>
+
+#include "im_util.h"
+
+
+/* Returns how many bytes after the first pixel repeat the previous pixel,
+ * that is data[i] == data[i - pixel_size], up to max_count bytes.
+ * The number of equal pixels after the first is the result divided by pixel_size.
+ * Compares a word at a time. */
+static inline int iRLERepeatCount(const imbyte* data, int pixel_size, int max_count)
+{
+  const imbyte* start = data + pixel_size;
+  const imbyte* end = start + max_count;
+  const imbyte* ptr = start;
+
+  while (ptr + sizeof(size_t) <= end)
+  {
+    size_t w1, w2;
+    memcpy(&w1, ptr, sizeof(size_t));
+    memcpy(&w2, ptr - pixel_size, sizeof(size_t));
+    if (w1 != w2)
+      break;
+    ptr += sizeof(size_t);
+  }
+
+  while (ptr < end && *ptr == *(ptr - pixel_size))
+    ptr++;
+
+  return (int)(ptr - start);
+}
+
+/* Fills data with count copies of pixel. */
+static inline void iRLEFill(imbyte* data, const imbyte* pixel, int pixel_size, int count)
+{
+  if (pixel_size == 1)
+  {
+    memset(data, *pixel, count);
+    return;
+  }
+
+  int size = count*pixel_size;
+  if (size <= 0)
+    return;
+
+  memcpy(data, pixel, pixel_size);
+
+  /* doubles the filled area at each copy */
+  int done = pixel_size;
+  while (done < size)
+  {
+    int n = done < size - done? done: size - done;
+    memcpy(data + done, data, n);
+    done += n;
+  }
+}
+
+#endif
@@ -0,0 +1,106 @@
+/** \file
+ * \brief Minimal Thread Support (internal use only)
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_THREAD_H
+#define __IM_THREAD_H
+
+#if defined(WIN32) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(WIN32) || defined(_WIN32)
+
+typedef SRWLOCK iMutex;
+typedef CONDITION_VARIABLE iCondition;
+typedef HANDLE iThread;
+
+#define IM_MUTEX_INITIALIZER SRWLOCK_INIT
+#define IM_THREAD_LOCAL __declspec(thread)
+
+static inline void iMutexInit(iMutex* mutex) { InitializeSRWLock(mutex); }
+static inline void iMutexDestroy(iMutex* mutex) { (void)mutex; }
+static inline void iMutexLock(iMutex* mutex) { AcquireSRWLockExclusive(mutex); }
+static inline void iMutexUnlock(iMutex* mutex) { ReleaseSRWLockExclusive(mutex); }
+
+static inline void iConditionInit(iCondition* cond) { InitializeConditionVariable(cond); }
+static inline void iConditionDestroy(iCondition* cond) { (void)cond; }
+static inline void iConditionWait(iCondition* cond, iMutex* mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+static inline void iConditionSignal(iCondition* cond) { WakeAllConditionVariable(cond); }
+
+#define IM_THREAD_PROC(_name, _param) static DWORD WINAPI _name(LPVOID _param)
+#define IM_THREAD_RETURN 0
+
+static inline int iThreadCreate(iThread* thread, LPTHREAD_START_ROUTINE proc, void* param)
+{
+  *thread = CreateThread(NULL, 0, proc, param, 0, NULL);
+  return *thread != NULL;
+}
+
+static inline void iThreadJoin(iThread* thread)
+{
+  WaitForSingleObject(*thread, INFINITE);
+  CloseHandle(*thread);
+}
+
+static inline int iThreadProcessorCount(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+}
+
+/* full barriers, so also acquire and release */
+static inline int iAtomicLoad(volatile int* value) { return (int)InterlockedCompareExchange((volatile LONG*)value, 0, 0); }
+static inline void iAtomicStore(volatile int* value, int new_value) { InterlockedExchange((volatile LONG*)value, (LONG)new_value); }
+
+#else
+
+typedef pthread_mutex_t iMutex;
+typedef pthread_cond_t iCondition;
+typedef pthread_t iThread;
+
+#define IM_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define IM_THREAD_LOCAL __thread
+
+static inline void iMutexInit(iMutex* mutex) { pthread_mutex_init(mutex, NULL); }
+static inline void iMutexDestroy(iMutex* mutex) { pthread_mutex_destroy(mutex); }
+static inline void iMutexLock(iMutex* mutex) { pthread_mutex_lock(mutex); }
+static inline void iMutexUnlock(iMutex* mutex) { pthread_mutex_unlock(mutex); }
+
+static inline void iConditionInit(iCondition* cond) { pthread_cond_init(cond, NULL); }
+static inline void iConditionDestroy(iCondition* cond) { pthread_cond_destroy(cond); }
+static inline void iConditionWait(iCondition* cond, iMutex* mutex) { pthread_cond_wait(cond, mutex); }
+static inline void iConditionSignal(iCondition* cond) { pthread_cond_broadcast(cond); }
+
+#define IM_THREAD_PROC(_name, _param) static void* _name(void* _param)
+#define IM_THREAD_RETURN NULL
+
+static inline int iThreadCreate(iThread* thread, void* (*proc)(void*), void* param)
+{
+  return pthread_create(thread, NULL, proc, param) == 0;
+}
+
+static inline void iThreadJoin(iThread* thread)
+{
+  pthread_join(*thread, NULL);
+}
+
+static inline int iThreadProcessorCount(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0? (int)count: 1;
+}
+
+static inline int iAtomicLoad(volatile int* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+static inline void iAtomicStore(volatile int* value, int new_value) { __atomic_store_n(value, new_value, __ATOMIC_RELEASE); }
+
+#endif
+
+#endif
@@ -231,11 +231,16 @@ int imFileFormatJP2::ReadImageInfo(int index)
 {
   (void)index;
 
+  char inopts[512] = "";
+  int* threads = (int*)AttribTable()->Get("DecodeThreads");
+  if (threads)
+    sprintf(inopts, "numthreads=%d", *threads);
+
   // The counter is started because in Jasper all image reading is done here. BAD!
   ijp2_counter = this->counter;
   ijp2_abort = 0;
   ijp2_message = "Reading JP2...";
-  this->image = jas_image_decode(this->stream, this->fmtid, 0);
+  this->image = jas_image_decode(this->stream, this->fmtid, inopts);
   ijp2_counter = -1;
   if (!this->image)
     return IM_ERR_ACCESS;
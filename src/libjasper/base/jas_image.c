@@ -82,6 +82,10 @@
 #include <assert.h>
 #include <ctype.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "jasper/jas_math.h"
 #include "jasper/jas_image.h"
 #include "jasper/jas_malloc.h"
@@ -102,6 +106,12 @@ void jas_set_progress_proc( jas_progress_proc_t new_proc ) {
 }
 
 void jas_do_progress( int done, int total, char *descr ) {
+#ifdef _OPENMP
+  /* IM: inside parallel regions only the master thread reports */
+  int level;
+  for (level = omp_get_level(); level > 0; --level)
+    if (omp_get_ancestor_thread_num(level) != 0) return;
+#endif
   if (progress_proc != NULL) progress_proc( done, total, descr );
 }
 
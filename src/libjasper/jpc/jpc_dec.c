@@ -75,6 +75,10 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "jasper/jas_types.h"
 #include "jasper/jas_math.h"
 #include "jasper/jas_tvp.h"
@@ -240,6 +244,9 @@ jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
 	jpc_dec_t *dec;
 	jas_image_t *image;
   unsigned int i;
+#ifdef _OPENMP
+	int old_numthreads = omp_get_max_threads();
+#endif
 
 	dec = 0;
 
@@ -253,11 +260,22 @@ jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
 		goto error;
 	}
 
+#ifdef _OPENMP
+	/* IM: all the parallel regions of the decoder use this number of threads */
+	if (opts.numthreads > 0) {
+		omp_set_num_threads(opts.numthreads);
+	}
+#endif
+
 	/* Do most of the work. */
 	if (jpc_dec_decode(dec)) {
 		goto error;
 	}
 
+#ifdef _OPENMP
+	omp_set_num_threads(old_numthreads);
+#endif
+
   // GeoJasper: dima - begin - first declare all components as GRAY and if there are more than 3 set first 3 as RGB
   /*
   if (jas_image_numcmpts(dec->image) >= 3) {
@@ -297,6 +315,9 @@ jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
 	return image;
 
 error:
+#ifdef _OPENMP
+	omp_set_num_threads(old_numthreads);
+#endif
 	if (dec) {
 		jpc_dec_destroy(dec);
 	}
@@ -306,13 +327,15 @@ error:
 typedef enum {
 	OPT_MAXLYRS,
 	OPT_MAXPKTS,
-	OPT_DEBUG
+	OPT_DEBUG,
+	OPT_NUMTHREADS
 } optid_t;
 
 jas_taginfo_t decopts[] = {
 	{OPT_MAXLYRS, "maxlyrs"},
 	{OPT_MAXPKTS, "maxpkts"},
 	{OPT_DEBUG, "debug"},
+	{OPT_NUMTHREADS, "numthreads"},
 	{-1, 0}
 };
 
@@ -323,6 +346,7 @@ static int jpc_dec_parseopts(char *optstr, jpc_dec_importopts_t *opts)
 	opts->debug = 0;
 	opts->maxlyrs = JPC_MAXLYRS;
 	opts->maxpkts = -1;
+	opts->numthreads = 0;
 
 	if (!(tvp = jas_tvparser_create(optstr ? optstr : ""))) {
 		return -1;
@@ -340,6 +364,9 @@ static int jpc_dec_parseopts(char *optstr, jpc_dec_importopts_t *opts)
 		case OPT_MAXPKTS:
 			opts->maxpkts = atoi(jas_tvparser_getval(tvp));
 			break;
+		case OPT_NUMTHREADS:
+			opts->numthreads = atoi(jas_tvparser_getval(tvp));
+			break;
 		default:
 			jas_eprintf("warning: ignoring invalid option %s\n",
 			  jas_tvparser_gettag(tvp));
@@ -1068,6 +1095,7 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	int bandno;
 	int adjust;
 	int v;
+	int ret;
 	jpc_dec_ccp_t *ccp;
 	jpc_dec_cmpt_t *cmpt;
 
@@ -1127,6 +1155,9 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	if (tile->realmode) {
 		for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
 		  ++compno, ++tcomp) {
+#ifdef _OPENMP
+#pragma omp parallel for private(j, v)
+#endif
 			for (i = 0; i < jas_matrix_numrows(tcomp->data); ++i) {
 				for (j = 0; j < jas_matrix_numcols(tcomp->data); ++j) {
 					v = jas_matrix_get(tcomp->data, i, j);
@@ -1141,6 +1172,9 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
 	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
 		adjust = cmpt->sgnd ? 0 : (1 << (cmpt->prec - 1));
+#ifdef _OPENMP
+#pragma omp parallel for private(j)
+#endif
 		for (i = 0; i < jas_matrix_numrows(tcomp->data); ++i) {
 			for (j = 0; j < jas_matrix_numcols(tcomp->data); ++j) {
 				*jas_matrix_getref(tcomp->data, i, j) += adjust;
@@ -1162,6 +1196,11 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	/* XXX need to free tsfb struct */
 
 	/* Write the data for each component of the image. */
+	ret = 0;
+	/* IM: tiles can be decoded in parallel, but the image is shared */
+#ifdef _OPENMP
+#pragma omp critical (jpcImageWrite)
+#endif
 	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
 	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
 		if (jas_image_writecmpt(dec->image, compno, tcomp->xstart -
@@ -1169,31 +1208,47 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 		  JPC_CEILDIV(dec->ystart, cmpt->vstep), jas_matrix_numcols(
 		  tcomp->data), jas_matrix_numrows(tcomp->data), tcomp->data)) {
 			jas_eprintf("write component failed\n");
-			return -4;
+			ret = -4;
+			break;
 		}
 	}
 
-	return 0;
+	return ret;
 }
 
 static int jpc_dec_process_eoc(jpc_dec_t *dec, jpc_ms_t *ms)
 {
 	int tileno;
 	jpc_dec_tile_t *tile;
+	int ret;
 
 	/* Eliminate compiler warnings about unused variables. */
 	ms = 0;
 
-	for (tileno = 0, tile = dec->tiles; tileno < dec->numtiles; ++tileno,
-	  ++tile) {
-		if (tile->state == JPC_TILE_ACTIVE) {
+	/* IM: The tiles still active are independent, so they are decoded in parallel.
+	  Each thread has its own copy of ret, combined at the end of the loop. */
+	ret = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(tile) reduction(|:ret)
+#endif
+	for (tileno = 0; tileno < dec->numtiles; ++tileno) {
+		tile = &dec->tiles[tileno];
+		if (!ret && tile->state == JPC_TILE_ACTIVE) {
 			if (jpc_dec_tiledecode(dec, tile)) {
-				return -1;
+				ret = -1;
 			}
 		}
+	}
+
+	for (tileno = 0, tile = dec->tiles; tileno < dec->numtiles; ++tileno,
+	  ++tile) {
 		jpc_dec_tilefini(dec, tile);
 	}
 
+	if (ret) {
+		return -1;
+	}
+
 	/* We are done processing the code stream. */
 	dec->state = JPC_MT;
 
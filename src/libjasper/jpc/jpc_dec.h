@@ -674,6 +674,9 @@ typedef struct {
 	/* The maximum number of packets to decode. */
 	int maxpkts;
 
+	/* IM: The number of threads used to decode (0 = all available). */
+	int numthreads;
+
 } jpc_dec_importopts_t;
 
 /******************************************************************************\
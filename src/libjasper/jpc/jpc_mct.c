@@ -144,6 +144,10 @@ void jpc_irct(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2)
 	assert(jas_matrix_numrows(c1) == numrows && jas_matrix_numcols(c1) == numcols
 	  && jas_matrix_numrows(c2) == numrows && jas_matrix_numcols(c2) == numcols);
 
+	/* IM: rows are independent */
+#ifdef _OPENMP
+#pragma omp parallel for private(j, c0p, c1p, c2p)
+#endif
 	for (i = 0; i < numrows; i++) {
 		c0p = jas_matrix_getref(c0, i, 0);
 		c1p = jas_matrix_getref(c1, i, 0);
@@ -229,6 +233,10 @@ void jpc_iict(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2)
 	assert(jas_matrix_numrows(c1) == numrows && jas_matrix_numrows(c2) == numrows);
 	numcols = jas_matrix_numcols(c0);
 	assert(jas_matrix_numcols(c1) == numcols && jas_matrix_numcols(c2) == numcols);
+	/* IM: rows are independent */
+#ifdef _OPENMP
+#pragma omp parallel for private(j, r, g, b, y, u, v, c0p, c1p, c2p)
+#endif
 	for (i = 0; i < numrows; ++i) {
 		c0p = jas_matrix_getref(c0, i, 0);
 		c1p = jas_matrix_getref(c1, i, 0);
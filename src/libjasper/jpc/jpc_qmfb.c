@@ -79,6 +79,11 @@
 \******************************************************************************/
 
 #include <assert.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "jasper/jas_fix.h"
 #include "jasper/jas_malloc.h"
 #include "jasper/jas_math.h"
@@ -87,6 +92,15 @@
 #include "jpc_tsfb.h"
 #include "jpc_math.h"
 
+/* IM: SSE2 lifting of the column groups, SSE2 is part of the x86-64 baseline.
+  The SSE2 code handles 4 values of 32 bits, so it is used only when jpc_fix_t (int_fast32_t) has 32 bits,
+  it has 64 bits with the glibc stdint.h. */
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(JPC_QMFB_NOSIMD) && \
+    INT_FAST32_MAX == 0x7fffffff
+#define JPC_QMFB_SSE2
+#include <emmintrin.h>
+#endif
+
 /******************************************************************************\
 *
 \******************************************************************************/
@@ -94,6 +108,9 @@
 #define QMFB_SPLITBUFSIZE	4096
 #define	QMFB_JOINBUFSIZE	4096
 
+/* IM: minimum number of samples to synthesize in parallel */
+#define	QMFB_PARALLELSIZE	65536
+
 int jpc_ft_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
   int stride);
 int jpc_ft_synthesize(int *a, int xstart, int ystart, int width, int height,
@@ -1357,13 +1374,152 @@ void jpc_ft_invlift_col(jpc_fix_t *a, int numrows, int stride, int parity)
 
 }
 
+/******************************************************************************\
+* IM: lifting steps of a group of JPC_QMFB_COLGRPSIZE columns.
+* The SSE2 versions give the same results as the C code.
+\******************************************************************************/
+
+#if defined(JPC_QMFB_SSE2) && (JPC_QMFB_COLGRPSIZE % 4) == 0
+
+/* Same as jpc_fix_mul(c, x) for 4 values, where cv has c in all elements.
+  The 32x32 bit products are computed unsigned and corrected for the signs,
+  only the low 32 bits of the result are needed. */
+static __m128i jpc_fix_mul_sse2(__m128i x, __m128i cv, jpc_fix_t c)
+{
+	__m128i even;
+	__m128i odd;
+	__m128i r;
+	__m128i corr;
+
+	even = _mm_srli_epi64(_mm_mul_epu32(x, cv), JPC_FIX_FRACBITS);
+	odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), cv), JPC_FIX_FRACBITS);
+	r = _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)),
+	  _mm_slli_epi64(odd, 32));
+
+	corr = _mm_and_si128(_mm_srai_epi32(x, 31), cv);
+	if (c < 0) {
+		corr = _mm_add_epi32(corr, x);
+	}
+	return _mm_sub_epi32(r, _mm_slli_epi32(corr, 32 - JPC_FIX_FRACBITS));
+}
+
+/* x -= (y0 + 1) >> 1, or x -= (y0 + y1 + 2) >> 2 */
+static void jpc_ft_lift1_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1)
+{
+	int i;
+	__m128i v;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; i += 4) {
+		v = _mm_loadu_si128((__m128i *)&y0[i]);
+		if (y1) {
+			v = _mm_add_epi32(v, _mm_loadu_si128((__m128i *)&y1[i]));
+			v = _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(2)), 2);
+		} else {
+			v = _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(1)), 1);
+		}
+		_mm_storeu_si128((__m128i *)&x[i], _mm_sub_epi32(
+		  _mm_loadu_si128((__m128i *)&x[i]), v));
+	}
+}
+
+/* x += y0, or x += (y0 + y1) >> 1 */
+static void jpc_ft_lift2_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1)
+{
+	int i;
+	__m128i v;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; i += 4) {
+		v = _mm_loadu_si128((__m128i *)&y0[i]);
+		if (y1) {
+			v = _mm_srai_epi32(_mm_add_epi32(v,
+			  _mm_loadu_si128((__m128i *)&y1[i])), 1);
+		}
+		_mm_storeu_si128((__m128i *)&x[i], _mm_add_epi32(
+		  _mm_loadu_si128((__m128i *)&x[i]), v));
+	}
+}
+
+/* x -= c * y0, or x -= c * (y0 + y1) */
+static void jpc_ns_lift_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1,
+  jpc_fix_t c)
+{
+	int i;
+	__m128i v;
+	__m128i cv = _mm_set1_epi32(c);
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; i += 4) {
+		v = _mm_loadu_si128((__m128i *)&y0[i]);
+		if (y1) {
+			v = _mm_add_epi32(v, _mm_loadu_si128((__m128i *)&y1[i]));
+		}
+		_mm_storeu_si128((__m128i *)&x[i], _mm_sub_epi32(
+		  _mm_loadu_si128((__m128i *)&x[i]), jpc_fix_mul_sse2(v, cv, c)));
+	}
+}
+
+/* x = x * c */
+static void jpc_ns_scale_colgrp(jpc_fix_t *x, jpc_fix_t c)
+{
+	int i;
+	__m128i cv = _mm_set1_epi32(c);
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; i += 4) {
+		_mm_storeu_si128((__m128i *)&x[i], jpc_fix_mul_sse2(
+		  _mm_loadu_si128((__m128i *)&x[i]), cv, c));
+	}
+}
+
+#else
+
+static void jpc_ft_lift1_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1)
+{
+	int i;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+		if (y1) {
+			x[i] -= (y0[i] + y1[i] + 2) >> 2;
+		} else {
+			x[i] -= (y0[i] + 1) >> 1;
+		}
+	}
+}
+
+static void jpc_ft_lift2_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1)
+{
+	int i;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+		if (y1) {
+			x[i] += (y0[i] + y1[i]) >> 1;
+		} else {
+			x[i] += y0[i];
+		}
+	}
+}
+
+static void jpc_ns_lift_colgrp(jpc_fix_t *x, jpc_fix_t *y0, jpc_fix_t *y1,
+  jpc_fix_t c)
+{
+	int i;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+		if (y1) {
+			jpc_fix_minuseq(x[i], jpc_fix_mul(c, jpc_fix_add(y0[i], y1[i])));
+		} else {
+			jpc_fix_minuseq(x[i], jpc_fix_mul(c, y0[i]));
+		}
+	}
+}
+
+static void jpc_ns_scale_colgrp(jpc_fix_t *x, jpc_fix_t c)
+{
+	int i;
+	for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+		x[i] = jpc_fix_mul(x[i], c);
+	}
+}
+
+#endif
+
 void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
 {
 
 	jpc_fix_t *lptr;
 	jpc_fix_t *hptr;
 	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
 	register int n;
 	register int i;
 	int llen;
@@ -1376,70 +1532,34 @@ void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ft_lift1_colgrp(lptr, hptr, 0);
 			lptr += stride;
 		}
 		n = llen - (!parity) - (parity != (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + hptr2[stride] + 2) >> 2;
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ft_lift1_colgrp(lptr, hptr, hptr + stride);
 			lptr += stride;
 			hptr += stride;
 		}
 		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ft_lift1_colgrp(lptr, hptr, 0);
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += lptr2[0];
-				++hptr2;
-				++lptr2;
-			}
+			jpc_ft_lift2_colgrp(hptr, lptr, 0);
 			hptr += stride;
 		}
 		n = numrows - llen - parity - (parity == (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += (lptr2[0] + lptr2[stride]) >> 1;
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ft_lift2_colgrp(hptr, lptr, lptr + stride);
 			hptr += stride;
 			lptr += stride;
 		}
 		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += lptr2[0];
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ft_lift2_colgrp(hptr, lptr, 0);
 		}
 
 	} else {
@@ -1603,25 +1723,44 @@ int jpc_ft_synthesize(int *a, int xstart, int ystart, int width, int height,
 	int maxcols;
 	jpc_fix_t *startptr;
 	int i;
+	int aborted;
 
-	startptr = &a[0];
+	/* IM: the rows, and then the column groups, are independent,
+	  so they are processed in parallel */
+#ifdef _OPENMP
+#pragma omp parallel for private(startptr) if (numrows * numcols >= QMFB_PARALLELSIZE)
+#endif
 	for (i = 0; i < numrows; ++i) {
+		startptr = &a[i * stride];
 		jpc_ft_invlift_row(startptr, numcols, colparity);
 		jpc_qmfb_join_row(startptr, numcols, colparity);
-		startptr += stride;
 	}
 
 	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
+	aborted = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(startptr) if (numrows * numcols >= QMFB_PARALLELSIZE)
+#endif
 	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
+		if (aborted) {
+			continue;
+		}
+
     // GeoJasper: dima - progress
     jas_do_progress( i, maxcols, "jpc: synthesize" ); // dima
-    if (jas_test_abort() == 1) return 0;
+    if (jas_test_abort() == 1) {
+      aborted = 1;
+      continue;
+    }
 
+		startptr = &a[i];
 		jpc_ft_invlift_colgrp(startptr, numrows, stride, rowparity);
 		jpc_qmfb_join_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
 	}
+	if (aborted) {
+		return 0;
+	}
+	startptr = &a[maxcols];
 	if (maxcols < numcols) {
 		jpc_ft_invlift_colres(startptr, numrows, numcols - maxcols, stride,
 		  rowparity);
@@ -2485,10 +2624,11 @@ void jpc_ns_invlift_colgrp(jpc_fix_t *a, int numrows, int stride,
 
 	jpc_fix_t *lptr;
 	jpc_fix_t *hptr;
+#if defined(WT_LENONE)
 	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
 	register int i;
+#endif
+	register int n;
 	int llen;
 
 	llen = (numrows + 1 - parity) >> 1;
@@ -2500,21 +2640,13 @@ void jpc_ns_invlift_colgrp(jpc_fix_t *a, int numrows, int stride,
 		lptr = &a[0];
 		n = llen;
 		while (n-- > 0) {
-			lptr2 = lptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] = jpc_fix_mul(lptr2[0], jpc_dbltofix(1.0 / LGAIN));
-				++lptr2;
-			}
+			jpc_ns_scale_colgrp(lptr, jpc_dbltofix(1.0 / LGAIN));
 			lptr += stride;
 		}
 		hptr = &a[llen * stride];
 		n = numrows - llen;
 		while (n-- > 0) {
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] = jpc_fix_mul(hptr2[0], jpc_dbltofix(1.0 / HGAIN));
-				++hptr2;
-			}
+			jpc_ns_scale_colgrp(hptr, jpc_dbltofix(1.0 / HGAIN));
 			hptr += stride;
 		}
 #endif
@@ -2523,152 +2655,68 @@ void jpc_ns_invlift_colgrp(jpc_fix_t *a, int numrows, int stride,
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  DELTA), hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, 0, jpc_dbltofix(2.0 * DELTA));
 			lptr += stride;
 		}
 		n = llen - (!parity) - (parity != (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(DELTA),
-				  jpc_fix_add(hptr2[0], hptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, hptr + stride, jpc_dbltofix(DELTA));
 			lptr += stride;
 			hptr += stride;
 		}
 		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  DELTA), hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, 0, jpc_dbltofix(2.0 * DELTA));
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  GAMMA), lptr2[0]));
-				++hptr2;
-				++lptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, 0, jpc_dbltofix(2.0 * GAMMA));
 			hptr += stride;
 		}
 		n = numrows - llen - parity - (parity == (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(GAMMA),
-				  jpc_fix_add(lptr2[0], lptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, lptr + stride, jpc_dbltofix(GAMMA));
 			hptr += stride;
 			lptr += stride;
 		}
 		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  GAMMA), lptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, 0, jpc_dbltofix(2.0 * GAMMA));
 		}
 
 		/* Apply the third lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-				  hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, 0, jpc_dbltofix(2.0 * BETA));
 			lptr += stride;
 		}
 		n = llen - (!parity) - (parity != (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(BETA),
-				  jpc_fix_add(hptr2[0], hptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, hptr + stride, jpc_dbltofix(BETA));
 			lptr += stride;
 			hptr += stride;
 		}
 		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-				  hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(lptr, hptr, 0, jpc_dbltofix(2.0 * BETA));
 		}
 
 		/* Apply the fourth lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  ALPHA), lptr2[0]));
-				++hptr2;
-				++lptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, 0, jpc_dbltofix(2.0 * ALPHA));
 			hptr += stride;
 		}
 		n = numrows - llen - parity - (parity == (numrows & 1));
 		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(ALPHA),
-				  jpc_fix_add(lptr2[0], lptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, lptr + stride, jpc_dbltofix(ALPHA));
 			hptr += stride;
 			lptr += stride;
 		}
 		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  ALPHA), lptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_ns_lift_colgrp(hptr, lptr, 0, jpc_dbltofix(2.0 * ALPHA));
 		}
 
 	} else {
@@ -3120,25 +3168,44 @@ int jpc_ns_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
 	int maxcols;
 	jpc_fix_t *startptr;
 	int i;
+	int aborted;
 
-	startptr = &a[0];
+	/* IM: the rows, and then the column groups, are independent,
+	  so they are processed in parallel */
+#ifdef _OPENMP
+#pragma omp parallel for private(startptr) if (numrows * numcols >= QMFB_PARALLELSIZE)
+#endif
 	for (i = 0; i < numrows; ++i) {
+		startptr = &a[i * stride];
 		jpc_ns_invlift_row(startptr, numcols, colparity);
 		jpc_qmfb_join_row(startptr, numcols, colparity);
-		startptr += stride;
 	}
 
 	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
+	aborted = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(startptr) if (numrows * numcols >= QMFB_PARALLELSIZE)
+#endif
 	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
+		if (aborted) {
+			continue;
+		}
+
     // GeoJasper: dima - progress
     jas_do_progress( i, maxcols, "jpc: synthesize" ); // dima
-    if (jas_test_abort() == 1) return 0;
+    if (jas_test_abort() == 1) {
+      aborted = 1;
+      continue;
+    }
 
+		startptr = &a[i];
 		jpc_ns_invlift_colgrp(startptr, numrows, stride, rowparity);
 		jpc_qmfb_join_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
 	}
+	if (aborted) {
+		return 0;
+	}
+	startptr = &a[maxcols];
 	if (maxcols < numcols) {
 		jpc_ns_invlift_colres(startptr, numrows, numcols - maxcols, stride,
 		  rowparity);
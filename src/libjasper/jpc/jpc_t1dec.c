@@ -78,6 +78,7 @@
 #include "jasper/jas_fix.h"
 #include "jasper/jas_stream.h"
 #include "jasper/jas_math.h"
+#include "jasper/jas_malloc.h"
 
 #include "jpc_bs.h"
 #include "jpc_mqdec.h"
@@ -89,6 +90,13 @@
 *
 \******************************************************************************/
 
+/* IM: a code-block and where it is in the tile */
+typedef struct {
+	jpc_dec_tcomp_t *tcomp;
+	jpc_dec_band_t *band;
+	jpc_dec_cblk_t *cblk;
+} jpc_dec_cblkref_t;
+
 static int jpc_dec_decodecblk(jpc_dec_t *dec, jpc_dec_tile_t *tile, jpc_dec_tcomp_t *tcomp, jpc_dec_band_t *band,
   jpc_dec_cblk_t *cblk, int dopartial, int maxlyrs);
 static int dec_sigpass(jpc_dec_t *dec, jpc_mqdec_t *mqdec, int bitpos, int orient,
@@ -140,7 +148,10 @@ static long t1dec_cnt = 0;
 * Code.
 \******************************************************************************/
 
-int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+/* IM: Lists the code-blocks of the tile, returns the number of code-blocks.
+  When cblkrefs is null only counts them. */
+static int jpc_dec_listcblks(jpc_dec_t *dec, jpc_dec_tile_t *tile,
+  jpc_dec_cblkref_t *cblkrefs)
 {
 	jpc_dec_tcomp_t *tcomp;
 	int compcnt;
@@ -152,16 +163,13 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	int prccnt;
 	jpc_dec_cblk_t *cblk;
 	int cblkcnt;
+	int numcblks;
 
+	numcblks = 0;
 	for (compcnt = dec->numcomps, tcomp = tile->tcomps; compcnt > 0;
 	  --compcnt, ++tcomp) {
 		for (rlvlcnt = tcomp->numrlvls, rlvl = tcomp->rlvls;
 		  rlvlcnt > 0; --rlvlcnt, ++rlvl) {
-
-      // GeoJasper: dima - progress
-      jas_do_progress( (tcomp->numrlvls-rlvlcnt), (tcomp->numrlvls-1), "jpc: decode" );
-      if (jas_test_abort() == 1) return -1;
-
 			if (!rlvl->bands) {
 				continue;
 			}
@@ -178,10 +186,12 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 					for (cblkcnt = prc->numcblks,
 					  cblk = prc->cblks; cblkcnt > 0;
 					  --cblkcnt, ++cblk) {
-						if (jpc_dec_decodecblk(dec, tile, tcomp,
-						  band, cblk, 1, JPC_MAXLYRS)) {
-							return -1;
+						if (cblkrefs) {
+							cblkrefs[numcblks].tcomp = tcomp;
+							cblkrefs[numcblks].band = band;
+							cblkrefs[numcblks].cblk = cblk;
 						}
+						++numcblks;
 					}
 				}
 
@@ -189,7 +199,49 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 		}
 	}
 
-	return 0;
+	return numcblks;
+}
+
+int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jpc_dec_cblkref_t *cblkrefs;
+	int numcblks;
+	int cblkno;
+	int ret;
+
+	/* IM: Each code-block has its own decoder state and data,
+	  so they are decoded in parallel. */
+	numcblks = jpc_dec_listcblks(dec, tile, 0);
+	if (!numcblks) {
+		return 0;
+	}
+	if (!(cblkrefs = jas_malloc(numcblks * sizeof(jpc_dec_cblkref_t)))) {
+		return -1;
+	}
+	jpc_dec_listcblks(dec, tile, cblkrefs);
+
+	/* each thread has its own copy of ret, so after an error
+	  a thread skips its remaining code-blocks */
+	ret = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(|:ret)
+#endif
+	for (cblkno = 0; cblkno < numcblks; ++cblkno) {
+		jpc_dec_cblkref_t *ref = &cblkrefs[cblkno];
+		if (ret) {
+			continue;
+		}
+
+		// GeoJasper: dima - progress
+		jas_do_progress(cblkno, numcblks - 1, "jpc: decode");
+		if (jas_test_abort() == 1 || jpc_dec_decodecblk(dec, tile,
+		  ref->tcomp, ref->band, ref->cblk, 1, JPC_MAXLYRS)) {
+			ret = -1;
+		}
+	}
+
+	jas_free(cblkrefs);
+	return ret;
 }
 
 static int jpc_dec_decodecblk(jpc_dec_t *dec, jpc_dec_tile_t *tile, jpc_dec_tcomp_t *tcomp, jpc_dec_band_t *band,
@@ -181,3 +181,10 @@ typedef unsigned char boolean;
 
 #define JFERROR(file) \
   imBinFileError((imBinFile*)file)
+
+/* SSE2 decompression kernels (see jsimd.h), selected at run time */
+#ifdef JPEG_INTERNALS
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define JSIMD_SUPPORTED
+#endif
+#endif
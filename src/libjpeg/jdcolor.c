@@ -11,6 +11,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 
 /* Private subobject */
@@ -359,6 +360,11 @@ jinit_color_deconverter (j_decompress_ptr cinfo)
     cinfo->out_color_components = RGB_PIXELSIZE;
     if (cinfo->jpeg_color_space == JCS_YCbCr) {
       cconvert->pub.color_convert = ycc_rgb_convert;
+#ifdef JSIMD_SUPPORTED
+      if (RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 &&
+	  RGB_PIXELSIZE == 3 && jsimd_can_sse2())
+	cconvert->pub.color_convert = jsimd_ycc_rgb_convert;
+#endif
       build_ycc_rgb_table(cinfo);
     } else if (cinfo->jpeg_color_space == JCS_GRAYSCALE) {
       cconvert->pub.color_convert = gray_rgb_convert;
@@ -20,6 +20,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /*
@@ -256,6 +257,17 @@ start_pass (j_decompress_ptr cinfo)
 	       compptr->DCT_h_scaled_size, compptr->DCT_v_scaled_size);
       break;
     }
+#ifdef JSIMD_SUPPORTED
+    /* Replace the most used kernels with their SIMD versions */
+    if (jsimd_can_sse2()) {
+      if (method_ptr == jpeg_idct_islow)
+	method_ptr = jsimd_idct_islow;
+      else if (method_ptr == jpeg_idct_16x16)
+	method_ptr = jsimd_idct_16x16;
+      else if (method_ptr == jpeg_idct_16x8)
+	method_ptr = jsimd_idct_16x8;
+    }
+#endif
     idct->pub.inverse_DCT[ci] = method_ptr;
     /* Create multiplier table from quant table.
      * However, we can skip this if the component is uninteresting
@@ -22,6 +22,7 @@
 #define JPEG_INTERNALS
 #include "jinclude.h"
 #include "jpeglib.h"
+#include "jsimd.h"
 
 
 /* Pointer to routine to upsample a single component */
@@ -338,10 +339,18 @@ jinit_upsampler (j_decompress_ptr cinfo)
 	       v_in_group == v_out_group) {
       /* Special case for 2h1v upsampling */
       upsample->methods[ci] = h2v1_upsample;
+#ifdef JSIMD_SUPPORTED
+      if (jsimd_can_sse2())
+	upsample->methods[ci] = jsimd_h2v1_upsample;
+#endif
     } else if (h_in_group * 2 == h_out_group &&
 	       v_in_group * 2 == v_out_group) {
       /* Special case for 2h2v upsampling */
       upsample->methods[ci] = h2v2_upsample;
+#ifdef JSIMD_SUPPORTED
+      if (jsimd_can_sse2())
+	upsample->methods[ci] = jsimd_h2v2_upsample;
+#endif
     } else if ((h_out_group % h_in_group) == 0 &&
 	       (v_out_group % v_in_group) == 0) {
       /* Generic integral-factors upsampling method */
@@ -0,0 +1,581 @@
+/*
+ * jdsimd.c
+ *
+ * This file is an IM addition to the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains SSE2 versions of the decompression kernels declared
+ * in jsimd.h.  All of them are bit-exact with the C code they replace:
+ *
+ * IDCT: the LL&M kernels of jidctint.c are linear up to the two descaling
+ * shifts, so every output of a 1-D pass is (sum of integer multiplier *
+ * input + fudge) >> shift.  The multipliers below are the net FIX()
+ * constants the C code applies to each input along all of its data paths
+ * (CONST_BITS = 13).  As long as the 32-bit sums do not overflow the result
+ * is identical no matter how the products are grouped, so we evaluate them
+ * with pmaddwd.  The sums are safe when all inputs of a pass are within
+ * +-16384 (8 * 11529 * 16384 < 2^31).  This always holds for valid data;
+ * blocks that fail the check (corrupt data) are handed to the C routine.
+ * The final "& RANGE_MASK" table lookup is reproduced by wrapping the
+ * result to 10 bits and saturating.
+ *
+ * Color conversion: the table entries of jdcolor.c are rebuilt on the fly
+ * with the same FIX() constants, each split into a 16-bit part plus a
+ * multiple of 2^16 that is added after the descaling shift.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
+
+#ifdef JSIMD_SUPPORTED
+
+#include <stdlib.h>
+#include <emmintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/* 32-bit x86 compilers may not enable SSE2 code generation by default */
+#if defined(__GNUC__) && !defined(__SSE2__)
+#define JSIMD_TARGET  __attribute__((target("sse2")))
+#else
+#define JSIMD_TARGET
+#endif
+
+
+/*
+ * Run time detection.
+ */
+
+GLOBAL(boolean)
+jsimd_can_sse2 (void)
+{
+  static int simd_support = -1;
+
+  if (simd_support < 0) {
+    int support;
+    char * env;
+#if defined(__x86_64__) || defined(_M_X64)
+    support = 1;		/* SSE2 is part of the x86-64 baseline */
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    support = (info[3] >> 26) & 1;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    support = __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? (int) ((edx >> 26) & 1) : 0;
+#endif
+    env = getenv("JSIMD_FORCENONE");
+    if (env && env[0] == '1')
+      support = 0;
+    simd_support = support;
+  }
+
+  return simd_support ? TRUE : FALSE;
+}
+
+
+/* Two 16-bit multipliers packed for pmaddwd: a multiplies the even lane */
+#define PAIR(a,b)  ((int) (((unsigned int) (b) << 16) | ((unsigned int) (a) & 0xFFFF)))
+
+
+/**************** Inverse DCT **************/
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+/* Multipliers of one output pair (out[i], out[N-1-i]) of a 1-D kernel:
+ * {in0,in2}, {in4,in6} for the even part and {in1,in3}, {in5,in7}
+ * for the odd part, so that out = even + odd and out' = even - odd.
+ */
+
+/* 8-point kernel of jpeg_idct_islow (and pass 1 of jpeg_idct_16x8) */
+static const int idct8_coef[4][4] = {
+  { PAIR(8192,  10703), PAIR( 8192,   4433), PAIR(11363,   9633), PAIR( 6437,   2260) },
+  { PAIR(8192,   4433), PAIR(-8192, -10704), PAIR( 9633,  -2259), PAIR(-11362, -6436) },
+  { PAIR(8192,  -4433), PAIR(-8192,  10704), PAIR( 6437, -11362), PAIR( 2261,   9633) },
+  { PAIR(8192, -10703), PAIR( 8192,  -4433), PAIR( 2260,  -6436), PAIR( 9633, -11363) }
+};
+
+/* 16-point kernel of jpeg_idct_16x16 (and pass 2 of jpeg_idct_16x8) */
+static const int idct16_coef[8][4] = {
+  { PAIR(8192,  11363), PAIR( 10703,   9632), PAIR(11529,  11086), PAIR(10217,   8956) },
+  { PAIR(8192,   9633), PAIR(  4433,  -2260), PAIR(11086,   7350), PAIR( 1136,  -5461) },
+  { PAIR(8192,   6437), PAIR( -4433, -11363), PAIR(10217,   1136), PAIR(-8955, -11086) },
+  { PAIR(8192,   2260), PAIR(-10703,  -6436), PAIR( 8956,  -5461), PAIR(-11086,  1137) },
+  { PAIR(8192,  -2260), PAIR(-10703,   6436), PAIR( 7350, -10217), PAIR(-3363,  11529) },
+  { PAIR(8192,  -6437), PAIR( -4433,  11363), PAIR( 5461, -11529), PAIR( 7349,   3363) },
+  { PAIR(8192,  -9633), PAIR(  4433,   2260), PAIR( 3363,  -8955), PAIR(11529, -10217) },
+  { PAIR(8192, -11363), PAIR( 10703,  -9632), PAIR( 1136,  -3363), PAIR( 5461,  -7350) }
+};
+
+
+/*
+ * One 1-D pass over 8 columns at once.  in[] holds the 8 input rows,
+ * out[] receives 2*npairs output rows.
+ */
+
+JSIMD_TARGET LOCAL(void)
+idct_1d (const __m128i * in, __m128i * out, const int (*coef)[4], int npairs,
+	 int descale)
+{
+  __m128i p02l = _mm_unpacklo_epi16(in[0], in[2]);
+  __m128i p02h = _mm_unpackhi_epi16(in[0], in[2]);
+  __m128i p46l = _mm_unpacklo_epi16(in[4], in[6]);
+  __m128i p46h = _mm_unpackhi_epi16(in[4], in[6]);
+  __m128i p13l = _mm_unpacklo_epi16(in[1], in[3]);
+  __m128i p13h = _mm_unpackhi_epi16(in[1], in[3]);
+  __m128i p57l = _mm_unpacklo_epi16(in[5], in[7]);
+  __m128i p57h = _mm_unpackhi_epi16(in[5], in[7]);
+  __m128i fudge = _mm_set1_epi32(1 << (descale-1));
+  __m128i shift = _mm_cvtsi32_si128(descale);
+  int i;
+
+  for (i = 0; i < npairs; i++) {
+    __m128i c02 = _mm_set1_epi32(coef[i][0]);
+    __m128i c46 = _mm_set1_epi32(coef[i][1]);
+    __m128i c13 = _mm_set1_epi32(coef[i][2]);
+    __m128i c57 = _mm_set1_epi32(coef[i][3]);
+    __m128i evenl, evenh, oddl, oddh;
+
+    evenl = _mm_add_epi32(_mm_madd_epi16(p02l, c02), _mm_madd_epi16(p46l, c46));
+    evenh = _mm_add_epi32(_mm_madd_epi16(p02h, c02), _mm_madd_epi16(p46h, c46));
+    evenl = _mm_add_epi32(evenl, fudge);
+    evenh = _mm_add_epi32(evenh, fudge);
+    oddl = _mm_add_epi32(_mm_madd_epi16(p13l, c13), _mm_madd_epi16(p57l, c57));
+    oddh = _mm_add_epi32(_mm_madd_epi16(p13h, c13), _mm_madd_epi16(p57h, c57));
+
+    out[i] = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(evenl, oddl), shift),
+			     _mm_sra_epi32(_mm_add_epi32(evenh, oddh), shift));
+    out[2*npairs-1-i] = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(evenl, oddl), shift),
+					_mm_sra_epi32(_mm_sub_epi32(evenh, oddh), shift));
+  }
+}
+
+
+/* Transpose an 8x8 block of 16-bit values */
+
+JSIMD_TARGET LOCAL(void)
+transpose_8x8 (const __m128i * in, __m128i * out)
+{
+  __m128i a0 = _mm_unpacklo_epi16(in[0], in[1]);
+  __m128i a1 = _mm_unpackhi_epi16(in[0], in[1]);
+  __m128i a2 = _mm_unpacklo_epi16(in[2], in[3]);
+  __m128i a3 = _mm_unpackhi_epi16(in[2], in[3]);
+  __m128i a4 = _mm_unpacklo_epi16(in[4], in[5]);
+  __m128i a5 = _mm_unpackhi_epi16(in[4], in[5]);
+  __m128i a6 = _mm_unpacklo_epi16(in[6], in[7]);
+  __m128i a7 = _mm_unpackhi_epi16(in[6], in[7]);
+  __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+  out[0] = _mm_unpacklo_epi64(b0, b4);
+  out[1] = _mm_unpackhi_epi64(b0, b4);
+  out[2] = _mm_unpacklo_epi64(b1, b5);
+  out[3] = _mm_unpackhi_epi64(b1, b5);
+  out[4] = _mm_unpacklo_epi64(b2, b6);
+  out[5] = _mm_unpackhi_epi64(b2, b6);
+  out[6] = _mm_unpacklo_epi64(b3, b7);
+  out[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/* Dequantize the 8 coefficient rows.  Returns FALSE if any product falls
+ * outside +-16384, in which case the C routine must be used.
+ */
+
+JSIMD_TARGET LOCAL(boolean)
+dequantize (JCOEFPTR coef_block, ISLOW_MULT_TYPE * quantptr, __m128i * in)
+{
+  __m128i bad_hi = _mm_setzero_si128();
+  __m128i bad_lo = _mm_setzero_si128();
+  __m128i zero = _mm_setzero_si128();
+  int u;
+
+  for (u = 0; u < DCTSIZE; u++) {
+    __m128i coef = _mm_loadu_si128((const __m128i *) (coef_block + u*DCTSIZE));
+    __m128i quant, lo, hi, sign;
+
+    if (SIZEOF(ISLOW_MULT_TYPE) == 2)
+      quant = _mm_loadu_si128((const __m128i *) (quantptr + u*DCTSIZE));
+    else	/* quantization values above 32767 saturate, and fail below */
+      quant = _mm_packs_epi32(_mm_loadu_si128((const __m128i *) (quantptr + u*DCTSIZE)),
+			      _mm_loadu_si128((const __m128i *) (quantptr + u*DCTSIZE + 4)));
+
+    lo = _mm_mullo_epi16(coef, quant);
+    hi = _mm_mulhi_epi16(coef, quant);
+    sign = _mm_srai_epi16(lo, 15);
+    bad_hi = _mm_or_si128(bad_hi, _mm_xor_si128(hi, sign));
+    bad_lo = _mm_or_si128(bad_lo, _mm_xor_si128(lo, sign));
+    in[u] = lo;
+  }
+
+  bad_lo = _mm_and_si128(bad_lo, _mm_set1_epi16((short) 0xC000));
+  return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_or_si128(bad_lo, bad_hi), zero)) == 0xFFFF;
+}
+
+
+/* Check that the pass 1 outputs can be fed to pass 2 */
+
+JSIMD_TARGET LOCAL(boolean)
+in_range (const __m128i * ws, int count)
+{
+  __m128i acc = _mm_setzero_si128();
+  int i;
+
+  for (i = 0; i < count; i++)
+    acc = _mm_or_si128(acc, _mm_xor_si128(ws[i], _mm_srai_epi16(ws[i], 15)));
+
+  acc = _mm_and_si128(acc, _mm_set1_epi16((short) 0xC000));
+  return _mm_movemask_epi8(_mm_cmpeq_epi16(acc, _mm_setzero_si128())) == 0xFFFF;
+}
+
+
+/* Emulate range_limit[x & RANGE_MASK] and pack two rows to samples */
+
+JSIMD_TARGET LOCAL(__m128i)
+range_limit_pack (__m128i a, __m128i b)
+{
+  __m128i add = _mm_set1_epi16(2*(MAXJSAMPLE+1));
+  __m128i mask = _mm_set1_epi16(RANGE_MASK);
+  __m128i sub = _mm_set1_epi16(2*(MAXJSAMPLE+1) - CENTERJSAMPLE);
+
+  a = _mm_sub_epi16(_mm_and_si128(_mm_add_epi16(a, add), mask), sub);
+  b = _mm_sub_epi16(_mm_and_si128(_mm_add_epi16(b, add), mask), sub);
+  return _mm_packus_epi16(a, b);
+}
+
+
+/*
+ * Perform dequantization and inverse DCT on one block of coefficients.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  __m128i in[8], ws[8], out[8];
+  int ctr;
+
+  if (! dequantize(coef_block, (ISLOW_MULT_TYPE *) compptr->dct_table, in)) {
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  /* Pass 1: process columns, 8 at a time */
+  idct_1d(in, ws, idct8_coef, 4, CONST_BITS-PASS1_BITS);
+  if (! in_range(ws, 8)) {
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  /* Pass 2: process rows, 8 at a time */
+  transpose_8x8(ws, in);
+  idct_1d(in, out, idct8_coef, 4, CONST_BITS+PASS1_BITS+3);
+  transpose_8x8(out, ws);
+
+  for (ctr = 0; ctr < DCTSIZE; ctr += 2) {
+    __m128i rows = range_limit_pack(ws[ctr], ws[ctr+1]);
+    _mm_storel_epi64((__m128i *) (output_buf[ctr] + output_col), rows);
+    _mm_storel_epi64((__m128i *) (output_buf[ctr+1] + output_col),
+		     _mm_srli_si128(rows, 8));
+  }
+}
+
+
+/* Pass 2 of the 16-point kernels: 8 workspace rows to 8x16 samples */
+
+JSIMD_TARGET LOCAL(void)
+idct_16_rows (const __m128i * ws, JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  __m128i in[8], out[16], lo[8], hi[8];
+  int ctr;
+
+  transpose_8x8(ws, in);
+  idct_1d(in, out, idct16_coef, 8, CONST_BITS+PASS1_BITS+3);
+  transpose_8x8(out, lo);
+  transpose_8x8(out + 8, hi);
+
+  for (ctr = 0; ctr < 8; ctr++)
+    _mm_storeu_si128((__m128i *) (output_buf[ctr] + output_col),
+		     range_limit_pack(lo[ctr], hi[ctr]));
+}
+
+
+/*
+ * Perform dequantization and inverse DCT on one block of coefficients,
+ * producing a 16x16 output block.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_idct_16x16 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  __m128i in[8], ws[16];
+
+  if (! dequantize(coef_block, (ISLOW_MULT_TYPE *) compptr->dct_table, in)) {
+    jpeg_idct_16x16(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  idct_1d(in, ws, idct16_coef, 8, CONST_BITS-PASS1_BITS);
+  if (! in_range(ws, 16)) {
+    jpeg_idct_16x16(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  idct_16_rows(ws, output_buf, output_col);
+  idct_16_rows(ws + 8, output_buf + 8, output_col);
+}
+
+
+/*
+ * Perform dequantization and inverse DCT on one block of coefficients,
+ * producing a 16x8 output block.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_idct_16x8 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		 JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  __m128i in[8], ws[8];
+
+  if (! dequantize(coef_block, (ISLOW_MULT_TYPE *) compptr->dct_table, in)) {
+    jpeg_idct_16x8(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  idct_1d(in, ws, idct8_coef, 4, CONST_BITS-PASS1_BITS);
+  if (! in_range(ws, 8)) {
+    jpeg_idct_16x8(cinfo, compptr, coef_block, output_buf, output_col);
+    return;
+  }
+
+  idct_16_rows(ws, output_buf, output_col);
+}
+
+
+/**************** YCbCr -> RGB conversion **************/
+
+#undef FIX
+#define SCALEBITS	16	/* same as jdcolor.c */
+#define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
+#define FIX(x)		((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
+
+/* The jdcolor.c constants reduced to 16 bits */
+#define F_CR_R   (FIX(1.40200) - ((INT32) 1 << SCALEBITS))     /* + 1 * Cr */
+#define F_CB_B   (FIX(1.77200) - ((INT32) 2 << SCALEBITS))     /* + 2 * Cb */
+#define F_CB_G   (- FIX(0.34414))
+#define F_CR_G   (- FIX(0.71414) + ((INT32) 1 << SCALEBITS))   /* - 1 * Cr */
+
+
+/* Convert 16 pixels, writing 16*RGB_PIXELSIZE samples */
+
+JSIMD_TARGET LOCAL(void)
+ycc_rgb_16 (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2, JSAMPROW outptr)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  __m128i two = _mm_set1_epi16(2);
+  __m128i half = _mm_set1_epi32(ONE_HALF);
+  __m128i k_r = _mm_set1_epi32(PAIR(F_CR_R, ONE_HALF/2));	/* (Cr, 2) */
+  __m128i k_b = _mm_set1_epi32(PAIR(F_CB_B, ONE_HALF/2));	/* (Cb, 2) */
+  __m128i k_g = _mm_set1_epi32(PAIR(F_CB_G, F_CR_G));		/* (Cb, Cr) */
+  __m128i y = _mm_loadu_si128((const __m128i *) inptr0);
+  __m128i cb = _mm_loadu_si128((const __m128i *) inptr1);
+  __m128i cr = _mm_loadu_si128((const __m128i *) inptr2);
+  __m128i r[2], g[2], b[2];
+  __m128i red, green, blue, rg, bx, p[4], c[4];
+  __m128i m0, m1, m2, m3;
+  int h;
+
+  for (h = 0; h < 2; h++) {
+    __m128i y16 = h ? _mm_unpackhi_epi8(y, zero) : _mm_unpacklo_epi8(y, zero);
+    __m128i cb16 = _mm_sub_epi16(h ? _mm_unpackhi_epi8(cb, zero) : _mm_unpacklo_epi8(cb, zero), center);
+    __m128i cr16 = _mm_sub_epi16(h ? _mm_unpackhi_epi8(cr, zero) : _mm_unpacklo_epi8(cr, zero), center);
+    __m128i lo, hi, delta;
+
+    /* R = Y + ((F_CR_R * Cr + ONE_HALF) >> 16) + Cr */
+    lo = _mm_madd_epi16(_mm_unpacklo_epi16(cr16, two), k_r);
+    hi = _mm_madd_epi16(_mm_unpackhi_epi16(cr16, two), k_r);
+    delta = _mm_packs_epi32(_mm_srai_epi32(lo, SCALEBITS), _mm_srai_epi32(hi, SCALEBITS));
+    r[h] = _mm_add_epi16(y16, _mm_add_epi16(delta, cr16));
+
+    /* B = Y + ((F_CB_B * Cb + ONE_HALF) >> 16) + 2 * Cb */
+    lo = _mm_madd_epi16(_mm_unpacklo_epi16(cb16, two), k_b);
+    hi = _mm_madd_epi16(_mm_unpackhi_epi16(cb16, two), k_b);
+    delta = _mm_packs_epi32(_mm_srai_epi32(lo, SCALEBITS), _mm_srai_epi32(hi, SCALEBITS));
+    b[h] = _mm_add_epi16(y16, _mm_add_epi16(delta, _mm_add_epi16(cb16, cb16)));
+
+    /* G = Y + ((F_CB_G * Cb + F_CR_G * Cr + ONE_HALF) >> 16) - Cr */
+    lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cb16, cr16), k_g), half);
+    hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cb16, cr16), k_g), half);
+    delta = _mm_packs_epi32(_mm_srai_epi32(lo, SCALEBITS), _mm_srai_epi32(hi, SCALEBITS));
+    g[h] = _mm_add_epi16(y16, _mm_sub_epi16(delta, cr16));
+  }
+
+  /* Saturation is the same as the sample_range_limit lookup */
+  red = _mm_packus_epi16(r[0], r[1]);
+  green = _mm_packus_epi16(g[0], g[1]);
+  blue = _mm_packus_epi16(b[0], b[1]);
+
+  /* Interleave to RGB0 quads, then squeeze out the fourth byte */
+  rg = _mm_unpacklo_epi8(red, green);
+  bx = _mm_unpacklo_epi8(blue, zero);
+  p[0] = _mm_unpacklo_epi16(rg, bx);
+  p[1] = _mm_unpackhi_epi16(rg, bx);
+  rg = _mm_unpackhi_epi8(red, green);
+  bx = _mm_unpackhi_epi8(blue, zero);
+  p[2] = _mm_unpacklo_epi16(rg, bx);
+  p[3] = _mm_unpackhi_epi16(rg, bx);
+
+  m0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+  m1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+  m2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+  m3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+  for (h = 0; h < 4; h++)
+    c[h] = _mm_or_si128(_mm_or_si128(_mm_and_si128(p[h], m0),
+				     _mm_srli_si128(_mm_and_si128(p[h], m1), 1)),
+			_mm_or_si128(_mm_srli_si128(_mm_and_si128(p[h], m2), 2),
+				     _mm_srli_si128(_mm_and_si128(p[h], m3), 3)));
+
+  _mm_storeu_si128((__m128i *) outptr,
+		   _mm_or_si128(c[0], _mm_slli_si128(c[1], 12)));
+  _mm_storeu_si128((__m128i *) (outptr + 16),
+		   _mm_or_si128(_mm_srli_si128(c[1], 4), _mm_slli_si128(c[2], 8)));
+  _mm_storeu_si128((__m128i *) (outptr + 32),
+		   _mm_or_si128(_mm_srli_si128(c[2], 8), _mm_slli_si128(c[3], 4)));
+}
+
+
+/*
+ * Convert some rows of samples to the output colorspace.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+  JSAMPROW outptr;
+  JSAMPROW inptr0, inptr1, inptr2;
+  JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; col + 16 <= num_cols; col += 16)
+      ycc_rgb_16(inptr0 + col, inptr1 + col, inptr2 + col,
+		 outptr + col * RGB_PIXELSIZE);
+    if (col < num_cols) {
+      /* Last partial group goes through a padded copy */
+      JSAMPLE tmp0[16], tmp1[16], tmp2[16], tmpout[16*RGB_PIXELSIZE];
+      size_t count = (size_t) (num_cols - col);
+      MEMZERO(tmp0, SIZEOF(tmp0));
+      MEMZERO(tmp1, SIZEOF(tmp1));
+      MEMZERO(tmp2, SIZEOF(tmp2));
+      MEMCOPY(tmp0, inptr0 + col, count);
+      MEMCOPY(tmp1, inptr1 + col, count);
+      MEMCOPY(tmp2, inptr2 + col, count);
+      ycc_rgb_16(tmp0, tmp1, tmp2, tmpout);
+      MEMCOPY(outptr + col * RGB_PIXELSIZE, tmpout, count * RGB_PIXELSIZE);
+    }
+  }
+}
+
+
+/**************** Box upsampling **************/
+
+/* Duplicate the samples of one row, as h2v1_upsample in jdsample.c */
+
+JSIMD_TARGET LOCAL(void)
+h2_upsample_row (JSAMPROW inptr, JSAMPROW outptr, JSAMPROW outptr2,
+		 JDIMENSION output_width)
+{
+  JSAMPROW outend = outptr + output_width;
+  JSAMPLE invalue;
+
+  while (outptr + 32 <= outend) {
+    __m128i in = _mm_loadu_si128((const __m128i *) inptr);
+    __m128i lo = _mm_unpacklo_epi8(in, in);
+    __m128i hi = _mm_unpackhi_epi8(in, in);
+    _mm_storeu_si128((__m128i *) outptr, lo);
+    _mm_storeu_si128((__m128i *) (outptr + 16), hi);
+    if (outptr2) {
+      _mm_storeu_si128((__m128i *) outptr2, lo);
+      _mm_storeu_si128((__m128i *) (outptr2 + 16), hi);
+      outptr2 += 32;
+    }
+    inptr += 16;
+    outptr += 32;
+  }
+
+  while (outptr < outend) {
+    invalue = *inptr++;
+    *outptr++ = invalue;
+    *outptr++ = invalue;
+    if (outptr2) {
+      *outptr2++ = invalue;
+      *outptr2++ = invalue;
+    }
+  }
+}
+
+
+/*
+ * Fast processing for the common case of 2:1 horizontal and 1:1 vertical.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_h2v1_upsample (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		     JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  int outrow;
+
+  for (outrow = 0; outrow < cinfo->max_v_samp_factor; outrow++)
+    h2_upsample_row(input_data[outrow], output_data[outrow], NULL,
+		    cinfo->output_width);
+}
+
+
+/*
+ * Fast processing for the common case of 2:1 horizontal and 2:1 vertical.
+ */
+
+JSIMD_TARGET GLOBAL(void)
+jsimd_h2v2_upsample (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		     JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  int inrow, outrow;
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    h2_upsample_row(input_data[inrow], output_data[outrow],
+		    output_data[outrow+1], cinfo->output_width);
+    inrow++;
+    outrow += 2;
+  }
+}
+
+#endif /* JSIMD_SUPPORTED */
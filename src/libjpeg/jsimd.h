@@ -0,0 +1,64 @@
+/*
+ * jsimd.h
+ *
+ * This file is an IM addition to the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This include file declares the SIMD (SSE2) versions of the decoder
+ * kernels that dominate the decompression time: the 8x8 LL&M IDCT, the
+ * 16x16 and 16x8 scaled IDCTs (which perform the "fancy" 2:1 chroma
+ * upsampling in the DCT domain), the box upsamplers and the YCbCr->RGB
+ * color conversion.  The SIMD routines produce exactly the same samples
+ * as the C routines they replace; they are selected at run time by the
+ * module initialization code when jsimd_can_sse2() returns TRUE.
+ * These declarations are private to the JPEG library.
+ */
+
+#if BITS_IN_JSAMPLE != 8 || DCTSIZE != 8
+#undef JSIMD_SUPPORTED		/* the kernels handle 8-bit 8x8 data only */
+#endif
+
+#ifdef JSIMD_SUPPORTED
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define jsimd_can_sse2		jSCanSSE2
+#define jsimd_idct_islow	jSDislow
+#define jsimd_idct_16x16	jSD16x16
+#define jsimd_idct_16x8		jSD16x8
+#define jsimd_ycc_rgb_convert	jSYCCRGB
+#define jsimd_h2v1_upsample	jSH2V1Up
+#define jsimd_h2v2_upsample	jSH2V2Up
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+/* Run time detection.  Setting the environment variable JSIMD_FORCENONE=1
+ * disables the SIMD routines (useful to compare against the C code).
+ */
+EXTERN(boolean) jsimd_can_sse2 JPP((void));
+
+/* Inverse DCT, same interface as the routines in jidctint.c */
+EXTERN(void) jsimd_idct_islow
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+EXTERN(void) jsimd_idct_16x16
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+EXTERN(void) jsimd_idct_16x8
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+
+/* Color conversion, same interface as ycc_rgb_convert in jdcolor.c */
+EXTERN(void) jsimd_ycc_rgb_convert
+    JPP((j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row,
+	 JSAMPARRAY output_buf, int num_rows));
+
+/* Upsampling, same interface as h2v1_upsample/h2v2_upsample in jdsample.c */
+EXTERN(void) jsimd_h2v1_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) jsimd_h2v2_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+
+#endif /* JSIMD_SUPPORTED */
@@ -12,6 +12,8 @@
 #include "im_lib.h"
 #include "im_image.h"
 #include "im_convert.h"
+#include "im_profile.h"
+#include "im_jpeg.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -173,6 +175,25 @@ static const imlua_constant im_constants[] = {
   { "PACKED", IM_PACKED, NULL },
   { "TOPDOWN", IM_TOPDOWN, NULL },
 
+  { "IMAGE_NOCLEAR", IM_IMAGE_NOCLEAR, NULL },
+  { "IMAGE_ALIGNED", IM_IMAGE_ALIGNED, NULL },
+  { "IMAGE_COPYONWRITE", IM_IMAGE_COPYONWRITE, NULL },
+  { "IMAGE_PACKED", IM_IMAGE_PACKED, NULL },
+
+  { "PROFILE_OFF", IM_PROFILE_OFF, NULL },
+  { "PROFILE_STATS", IM_PROFILE_STATS, NULL },
+  { "PROFILE_TRACE", IM_PROFILE_TRACE, NULL },
+
+  { "JPEG_NONE", IM_JPEG_NONE, NULL },
+  { "JPEG_FLIP_H", IM_JPEG_FLIP_H, NULL },
+  { "JPEG_FLIP_V", IM_JPEG_FLIP_V, NULL },
+  { "JPEG_TRANSPOSE", IM_JPEG_TRANSPOSE, NULL },
+  { "JPEG_TRANSVERSE", IM_JPEG_TRANSVERSE, NULL },
+  { "JPEG_ROT90", IM_JPEG_ROT90, NULL },
+  { "JPEG_ROT180", IM_JPEG_ROT180, NULL },
+  { "JPEG_ROT270", IM_JPEG_ROT270, NULL },
+  { "JPEG_AUTOORIENT", IM_JPEG_AUTOORIENT, NULL },
+
   { "ERR_NONE", IM_ERR_NONE, NULL },
   { "ERR_OPEN", IM_ERR_OPEN, NULL },
   { "ERR_ACCESS", IM_ERR_ACCESS, NULL },
@@ -10,6 +10,7 @@
 
 #include "im.h"
 #include "im_raw.h"
+#include "im_jpeg.h"
 #include "im_image.h"
 #include "im_util.h"
 
@@ -115,6 +116,57 @@ static int imluaFileNewRaw (lua_State *L)
   return imlua_pushifileerror(L, ifile, error);
 }
 
+/*****************************************************************************\
+ im.FileProbe(filename)
+\*****************************************************************************/
+static int imluaFileProbe (lua_State *L)
+{
+  const char *filename = luaL_checkstring(L, 1);
+  imFileProbeInfo info;
+  int error = imFileProbe(filename, &info);
+
+  imlua_pusherror(L, error);
+  if (error)
+    return 1;
+
+  lua_pushstring(L, info.format);
+  lua_pushnumber(L, info.width);
+  lua_pushnumber(L, info.height);
+  lua_pushnumber(L, info.color_mode);
+  lua_pushnumber(L, info.data_type);
+  lua_pushnumber(L, info.image_count);
+  return 7;
+}
+
+/*****************************************************************************\
+ im.FileTransformJPEG(src_file_name, dst_file_name, transform)
+\*****************************************************************************/
+static int imluaFileTransformJPEG (lua_State *L)
+{
+  const char *src_file_name = luaL_checkstring(L, 1);
+  const char *dst_file_name = luaL_checkstring(L, 2);
+  int transform = luaL_checkint(L, 3);
+
+  imlua_pusherror(L, imFileTransformJPEG(src_file_name, dst_file_name, transform));
+  return 1;
+}
+
+/*****************************************************************************\
+ im.FileCropJPEG(src_file_name, dst_file_name, x, y, width, height)
+\*****************************************************************************/
+static int imluaFileCropJPEG (lua_State *L)
+{
+  const char *src_file_name = luaL_checkstring(L, 1);
+  const char *dst_file_name = luaL_checkstring(L, 2);
+  int x = luaL_checkint(L, 3);
+  int y = luaL_checkint(L, 4);
+  int width = luaL_checkint(L, 5);
+  int height = luaL_checkint(L, 6);
+
+  imlua_pusherror(L, imFileCropJPEG(src_file_name, dst_file_name, x, y, width, height));
+  return 1;
+}
+
 /*****************************************************************************\
  file:Handle()
 \*****************************************************************************/
@@ -576,6 +628,21 @@ static int imluaFileReadImageData (lua_State *L)
   return 1;
 }
 
+/*****************************************************************************\
+ file:ReadImageLines(data, first_line, count, convert2bitmap, color_mode_flags)
+\*****************************************************************************/
+static int imluaFileReadImageLines (lua_State *L)
+{
+  imFile *ifile = imlua_checkfile(L, 1);
+  void* data = lua_touserdata(L, 2);
+  int first_line = luaL_checkint(L, 3);
+  int count = luaL_checkint(L, 4);
+  int convert2bitmap = lua_toboolean(L, 5);
+  int color_mode_flags = luaL_checkint(L, 6);
+  imlua_pusherror(L, imFileReadImageLines(ifile, data, first_line, count, convert2bitmap, color_mode_flags));
+  return 1;
+}
+
 /*****************************************************************************\
  file:WriteImageData(data)
 \*****************************************************************************/
@@ -587,6 +654,19 @@ static int imluaFileWriteImageData (lua_State *L)
   return 1;
 }
 
+/*****************************************************************************\
+ file:WriteImageLines(data, first_line, count)
+\*****************************************************************************/
+static int imluaFileWriteImageLines (lua_State *L)
+{
+  imFile *ifile = imlua_checkfile(L, 1);
+  void* data = lua_touserdata(L, 2);
+  int first_line = luaL_checkint(L, 3);
+  int count = luaL_checkint(L, 4);
+  imlua_pusherror(L, imFileWriteImageLines(ifile, data, first_line, count));
+  return 1;
+}
+
 /*****************************************************************************\
  file:Close()
 \*****************************************************************************/
@@ -634,6 +714,9 @@ static const luaL_Reg imfile_lib[] = {
   {"FileNew", imluaFileNew},
   {"FileNewRaw", imluaFileNewRaw},
   {"FileClose", imluaFileClose},
+  {"FileProbe", imluaFileProbe},
+  {"FileTransformJPEG", imluaFileTransformJPEG},
+  {"FileCropJPEG", imluaFileCropJPEG},
   {NULL, NULL}
 };
 
@@ -656,7 +739,9 @@ static const luaL_Reg imfile_metalib[] = {
   {"ReadImageInfo", imluaFileReadImageInfo},
   {"WriteImageInfo", imluaFileWriteImageInfo},
   {"ReadImageData", imluaFileReadImageData},
+  {"ReadImageLines", imluaFileReadImageLines},
   {"WriteImageData", imluaFileWriteImageData},
+  {"WriteImageLines", imluaFileWriteImageLines},
 
   {"__gc", imluaFile_gc},
   {"__tostring", imluaFile_tostring},
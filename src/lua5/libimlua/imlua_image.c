@@ -105,7 +105,7 @@ static imluaImageRow* imlua_checkimagerow (lua_State *L, int param)
 }
 
 /*****************************************************************************\
- im.ImageCreate(width, height, color_space, data_type)
+ im.ImageCreate(width, height, color_space, data_type, [flags])
 \*****************************************************************************/
 static int imluaImageCreate (lua_State *L)
 {
@@ -113,12 +113,13 @@ static int imluaImageCreate (lua_State *L)
   int height = luaL_checkint(L, 2);
   int color_space = luaL_checkint(L, 3);
   int data_type = luaL_checkint(L, 4);
+  int flags = luaL_optint(L, 5, 0);
   imImage *image;
 
   if (!imImageCheckFormat(color_space, data_type))
     luaL_error(L, "invalid combination of color space and data type.");
 
-  image = imImageCreate(width, height, color_space, data_type);
+  image = imImageCreateEx(width, height, color_space, data_type, flags);
   imlua_pushimage(L, image);
   return 1;
 }
@@ -236,6 +237,15 @@ static int imluaImageDuplicate (lua_State *L)
   return 1;
 }
 
+/*****************************************************************************\
+ image:MakeWritable()
+\*****************************************************************************/
+static int imluaImageMakeWritable (lua_State *L)
+{
+  lua_pushboolean(L, imImageMakeWritable(imlua_checkimage(L, 1)));
+  return 1;
+}
+
 /*****************************************************************************\
  image:Clone()
 \*****************************************************************************/
@@ -923,7 +933,7 @@ static int imluaImageRow_tostring (lua_State *L)
 \*****************************************************************************/
 static int imluaImageRow_index (lua_State *L)
 {
-  int index;
+  int index, step;
   imluaImageRow *imagerow = imlua_checkimagerow(L, 1);
   imImage *image = imagerow->image;
   int channel = imagerow->channel;
@@ -934,7 +944,12 @@ static int imluaImageRow_index (lua_State *L)
   if (column < 0 || column >= imagerow->image->width)
     luaL_argerror(L, 2, "invalid column, out of bounds");
 
-  index = row * image->width + column;
+  /* lines can be padded, see imImageIsContiguous,
+     and when packed the components of a pixel are consecutive */
+  step = 1;
+  if (image->flags & IM_IMAGE_PACKED)
+    step = image->has_alpha? image->depth+1: image->depth;
+  index = row * (image->line_stride / imDataTypeSize(image->data_type)) + column * step;
 
   switch (image->data_type)
   {
@@ -989,18 +1004,27 @@ static int imluaImageRow_index (lua_State *L)
 \*****************************************************************************/
 static int imluaImageRow_newindex (lua_State *L)
 {
-  int index;
+  int index, step;
   imluaImageRow *imagerow = imlua_checkimagerow(L, 1);
   imImage *image = imagerow->image;
   int channel = imagerow->channel;
   int row = imagerow->row;
   int column = luaL_checkint(L, 2);
-  void* channel_buffer = image->data[channel];
+  void* channel_buffer;
 
   if (column < 0 || column >= imagerow->image->width)
     luaL_argerror(L, 2, "invalid column, out of bounds");
 
-  index = row * image->width + column;
+  /* duplicates may share the data buffer */
+  imImageMakeWritable(image);
+  channel_buffer = image->data[channel];
+
+  /* lines can be padded, see imImageIsContiguous,
+     and when packed the components of a pixel are consecutive */
+  step = 1;
+  if (image->flags & IM_IMAGE_PACKED)
+    step = image->has_alpha? image->depth+1: image->depth;
+  index = row * (image->line_stride / imDataTypeSize(image->data_type)) + column * step;
 
   switch (image->data_type)
   {
@@ -1135,6 +1159,7 @@ static const luaL_Reg imimage_metalib[] = {
   {"CopyData", imluaImageCopyData},
   {"CopyPlane", imluaImageCopyPlane},
   {"Duplicate", imluaImageDuplicate},
+  {"MakeWritable", imluaImageMakeWritable},
   {"Clone", imluaImageClone},
   {"SetAttribute", imluaImageSetAttribute},
   {"GetAttribute", imluaImageGetAttribute},
@@ -7,6 +7,9 @@
 #include "im.h"
 #include "im_util.h"
 #include "im_image.h"
+#include "im_profile.h"
+
+#include <stdlib.h>
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -244,6 +247,83 @@ static int imlua_colordecode(lua_State *L)
   return 3;
 }
 
+/*****************************************************************************\
+ im.ProfileSetMode(mode)
+\*****************************************************************************/
+static int imluaProfileSetMode (lua_State *L)
+{
+  lua_pushinteger(L, imProfileSetMode(luaL_checkint(L, 1)));
+  return 1;
+}
+
+/*****************************************************************************\
+ im.ProfileGetMode()
+\*****************************************************************************/
+static int imluaProfileGetMode (lua_State *L)
+{
+  lua_pushinteger(L, imProfileGetMode());
+  return 1;
+}
+
+/*****************************************************************************\
+ im.ProfileReset()
+\*****************************************************************************/
+static int imluaProfileReset (lua_State *L)
+{
+  (void)L;
+  imProfileReset();
+  return 0;
+}
+
+/*****************************************************************************\
+ im.ProfileGet()
+\*****************************************************************************/
+static int imluaProfileGet (lua_State *L)
+{
+  int i, count, stats_count = imProfileGetStats(NULL, 0);
+  imProfileStats* stats = (imProfileStats*)malloc((stats_count? stats_count: 1)*sizeof(imProfileStats));
+  if (!stats)
+    luaL_error(L, "insufficient memory");
+
+  /* new operations can be profiled between the calls, but only stats_count are copied */
+  count = imProfileGetStats(stats, stats_count);
+  if (count > stats_count)
+    count = stats_count;
+
+  lua_createtable(L, count, 0);
+  for (i = 0; i < count; i++)
+  {
+    lua_createtable(L, 0, 7);
+    lua_pushstring(L, stats[i].name);
+    lua_setfield(L, -2, "name");
+    lua_pushinteger(L, stats[i].call_count);
+    lua_setfield(L, -2, "call_count");
+    lua_pushnumber(L, stats[i].wall_time);
+    lua_setfield(L, -2, "wall_time");
+    lua_pushnumber(L, stats[i].cpu_time);
+    lua_setfield(L, -2, "cpu_time");
+    lua_pushnumber(L, stats[i].pixels);
+    lua_setfield(L, -2, "pixels");
+    lua_pushnumber(L, stats[i].bytes);
+    lua_setfield(L, -2, "bytes");
+    lua_pushinteger(L, stats[i].threads);
+    lua_setfield(L, -2, "threads");
+    lua_rawseti(L, -2, i+1);
+  }
+
+  free(stats);
+  return 1;
+}
+
+/*****************************************************************************\
+ im.ProfileWriteTrace(file_name)
+\*****************************************************************************/
+static int imluaProfileWriteTrace (lua_State *L)
+{
+  lua_pushinteger(L, imProfileWriteTrace(luaL_checkstring(L, 1)));
+  return 1;
+}
+
 
 static const luaL_Reg imutil_lib[] = {
   {"ImageDataSize", imluaImageDataSize},
@@ -270,6 +350,12 @@ static const luaL_Reg imutil_lib[] = {
   {"ColorEncode", imlua_colorencode},
   {"ColorDecode", imlua_colordecode},
 
+  {"ProfileSetMode", imluaProfileSetMode},
+  {"ProfileGetMode", imluaProfileGetMode},
+  {"ProfileReset", imluaProfileReset},
+  {"ProfileGet", imluaProfileGet},
+  {"ProfileWriteTrace", imluaProfileWriteTrace},
+
   {NULL, NULL}
 };
 
@@ -10,6 +10,7 @@
 #include <im_math.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_ana.h"
 #include "im_process_pnt.h"
 
@@ -393,6 +394,10 @@ static int DoAnalyzeFindRegionsBorder(int width, int height, imbyte* map, imusho
 
 int imAnalyzeFindRegions(const imImage* src_image, imImage* dst_image, int connect, int touch_border)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imAnalyzeFindRegions, src_image, dst_image, connect, touch_border);
+
   imImageSetAttribute(dst_image, "REGION_CONNECT", IM_BYTE, 1, connect==4?"4":"8");
   if (touch_border)
     return DoAnalyzeFindRegionsBorder(src_image->width, src_image->height, (imbyte*)src_image->data[0], (imushort*)dst_image->data[0], connect);
@@ -402,6 +407,9 @@ int imAnalyzeFindRegions(const imImage* src_image, imImage* dst_image, int conne
 
 void imAnalyzeMeasureArea(const imImage* image, int* data_area, int region_count)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imAnalyzeMeasureArea, image, data_area, region_count);
+
   imushort* img_data = (imushort*)image->data[0];
 
   memset(data_area, 0, region_count*sizeof(int));
@@ -424,6 +432,9 @@ void imAnalyzeMeasureArea(const imImage* image, int* data_area, int region_count
 
 void imAnalyzeMeasureCentroid(const imImage* image, const int* data_area, int region_count, float* data_cx, float* data_cy)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imAnalyzeMeasureCentroid, image, data_area, region_count, data_cx, data_cy);
+
   imushort* img_data = (imushort*)image->data[0];
   int* local_data_area = 0;
 
@@ -806,6 +817,9 @@ void imAnalyzeMeasurePrincipalAxis(const imImage* image, const int* data_area, c
 
 void imAnalyzeMeasureHoles(const imImage* image, int connect, int* count_data, int* area_data, float* perim_data)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imAnalyzeMeasureHoles, image, connect, count_data, area_data, perim_data);
+
   int i;
   imImage *inv_image = imImageCreate(image->width, image->height, IM_BINARY, IM_BYTE);
   imbyte* inv_data = (imbyte*)inv_image->data[0];
@@ -917,6 +931,10 @@ static void DoPerimeterLine(T* map, T* new_map, int width, int height)
 
 void imProcessPerimeterLine(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessPerimeterLine, src_image, dst_image);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
@@ -1030,6 +1048,9 @@ const float DT_SQRT2D2 = 0.707106781187f;
 
 void imAnalyzeMeasurePerimeter(const imImage* image, float* perim_data, int region_count)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imAnalyzeMeasurePerimeter, image, perim_data, region_count);
+
   static imbyte templ[256];
   static float vt[5];
   static int first = 1;
@@ -1216,6 +1237,9 @@ static void iInitPerimAreaTemplate(imbyte *templ, float *v)
 
 void imAnalyzeMeasurePerimArea(const imImage* image, float* area_data)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imAnalyzeMeasurePerimArea, image, area_data);
+
   static imbyte templ[256];
   static float vt[7];
   static int first = 1;
@@ -1270,6 +1294,10 @@ void imAnalyzeMeasurePerimArea(const imImage* image, float* area_data)
 
 void imProcessRemoveByArea(const imImage* src_image, imImage* dst_image, int connect, int start_size, int end_size, int inside)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRemoveByArea, src_image, dst_image, connect, start_size, end_size, inside);
+
   imImage *region_image = imImageCreate(src_image->width, src_image->height, IM_GRAY, IM_USHORT);
   if (!region_image)
     return;
@@ -1328,6 +1356,10 @@ void imProcessRemoveByArea(const imImage* src_image, imImage* dst_image, int con
 
 void imProcessFillHoles(const imImage* src_image, imImage* dst_image, int connect)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessFillHoles, src_image, dst_image, connect);
+
   // finding regions in the inverted src_image will isolate only the holes.
   imProcessNegative(src_image, dst_image);
 
@@ -9,8 +9,11 @@
 #include <im_util.h>
 #include <im_math.h>
 #include <im_complex.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 #include "im_math_op.h"
 #include "im_color.h"
@@ -217,57 +220,75 @@ static void DoBinaryOpCpxReal(imcfloat *map1, float *map2, imcfloat *map, int co
 
 void imProcessArithmeticOp(const imImage* src_image1, const imImage* src_image2, imImage* dst_image, int op)
 {
-  int count = src_image1->count*src_image1->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessArithmeticOp, src_image1, src_image2, dst_image, op);
 
-  switch(src_image1->data_type)
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(src_image2) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image1, single);
+  int count = imProcessRunSize(src_image1, single);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryOp((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoBinaryOp((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (short*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoBinaryOp((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imushort*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryOp((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (int*)dst_image->data[0], count, op);
-    else
-      DoBinaryOpByte((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imbyte*)dst_image->data[0], count, op);
-    break;
-  case IM_SHORT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryOp((short*)src_image1->data[0], (short*)src_image2->data[0], (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryOp((short*)src_image1->data[0], (short*)src_image2->data[0], (int*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoBinaryOp((short*)src_image1->data[0], (short*)src_image2->data[0], (imushort*)dst_image->data[0], count, op);
-    else
-      DoBinaryOp((short*)src_image1->data[0], (short*)src_image2->data[0], (short*)dst_image->data[0], count, op);
-    break;
-  case IM_USHORT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryOp((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryOp((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (int*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoBinaryOp((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (short*)dst_image->data[0], count, op);
-    else
-      DoBinaryOp((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (imushort*)dst_image->data[0], count, op);
-    break;
-  case IM_INT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryOp((int*)src_image1->data[0], (int*)src_image2->data[0], (float*)dst_image->data[0], count, op);
-    else
-      DoBinaryOp((int*)src_image1->data[0], (int*)src_image2->data[0], (int*)dst_image->data[0], count, op);
-    break;
-  case IM_FLOAT:
-    DoBinaryOp((float*)src_image1->data[0], (float*)src_image2->data[0], (float*)dst_image->data[0], count, op);
-    break;
-  case IM_CFLOAT:
-    if (src_image2->data_type == IM_FLOAT)
-      DoBinaryOpCpxReal((imcfloat*)src_image1->data[0], (float*)src_image2->data[0], (imcfloat*)dst_image->data[0], count, op);
-    else
-      DoBinaryOp((imcfloat*)src_image1->data[0], (imcfloat*)src_image2->data[0], (imcfloat*)dst_image->data[0], count, op);
-    break;
+    void* src_map1 = imProcessRunData(src_image1, run, single);
+    void* src_map2 = imProcessRunData(src_image2, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryOp((imbyte*)src_map1, (imbyte*)src_map2, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoBinaryOp((imbyte*)src_map1, (imbyte*)src_map2, (short*)dst_map, count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoBinaryOp((imbyte*)src_map1, (imbyte*)src_map2, (imushort*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryOp((imbyte*)src_map1, (imbyte*)src_map2, (int*)dst_map, count, op);
+      else
+        DoBinaryOpByte((imbyte*)src_map1, (imbyte*)src_map2, (imbyte*)dst_map, count, op);
+      break;
+    case IM_SHORT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryOp((short*)src_map1, (short*)src_map2, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryOp((short*)src_map1, (short*)src_map2, (int*)dst_map, count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoBinaryOp((short*)src_map1, (short*)src_map2, (imushort*)dst_map, count, op);
+      else
+        DoBinaryOp((short*)src_map1, (short*)src_map2, (short*)dst_map, count, op);
+      break;
+    case IM_USHORT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryOp((imushort*)src_map1, (imushort*)src_map2, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryOp((imushort*)src_map1, (imushort*)src_map2, (int*)dst_map, count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoBinaryOp((imushort*)src_map1, (imushort*)src_map2, (short*)dst_map, count, op);
+      else
+        DoBinaryOp((imushort*)src_map1, (imushort*)src_map2, (imushort*)dst_map, count, op);
+      break;
+    case IM_INT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryOp((int*)src_map1, (int*)src_map2, (float*)dst_map, count, op);
+      else
+        DoBinaryOp((int*)src_map1, (int*)src_map2, (int*)dst_map, count, op);
+      break;
+    case IM_FLOAT:
+      DoBinaryOp((float*)src_map1, (float*)src_map2, (float*)dst_map, count, op);
+      break;
+    case IM_CFLOAT:
+      if (src_image2->data_type == IM_FLOAT)
+        DoBinaryOpCpxReal((imcfloat*)src_map1, (float*)src_map2, (imcfloat*)dst_map, count, op);
+      else
+        DoBinaryOp((imcfloat*)src_map1, (imcfloat*)src_map2, (imcfloat*)dst_map, count, op);
+      break;
+    }
   }
 }
 
@@ -289,28 +310,46 @@ static void DoBlendConst(T *map1, T *map2, T *map, int count, float alpha)
 
 void imProcessBlendConst(const imImage* src_image1, const imImage* src_image2, imImage* dst_image, float alpha)
 {
-  int count = src_image1->count*src_image1->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessBlendConst, src_image1, src_image2, dst_image, alpha);
 
-  switch(src_image1->data_type)
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(src_image2) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image1, single);
+  int count = imProcessRunSize(src_image1, single);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    DoBlendConst((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imbyte*)dst_image->data[0], count, alpha);
-    break;
-  case IM_SHORT:
-    DoBlendConst((short*)src_image1->data[0], (short*)src_image2->data[0], (short*)dst_image->data[0], count, alpha);
-    break;
-  case IM_USHORT:
-    DoBlendConst((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (imushort*)dst_image->data[0], count, alpha);
-    break;
-  case IM_INT:
-    DoBlendConst((int*)src_image1->data[0], (int*)src_image2->data[0], (int*)dst_image->data[0], count, alpha);
-    break;
-  case IM_FLOAT:
-    DoBlendConst((float*)src_image1->data[0], (float*)src_image2->data[0], (float*)dst_image->data[0], count, alpha);
-    break;
-  case IM_CFLOAT:
-    DoBlendConst((imcfloat*)src_image1->data[0], (imcfloat*)src_image2->data[0], (imcfloat*)dst_image->data[0], count, alpha);
-    break;
+    void* src_map1 = imProcessRunData(src_image1, run, single);
+    void* src_map2 = imProcessRunData(src_image2, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      DoBlendConst((imbyte*)src_map1, (imbyte*)src_map2, (imbyte*)dst_map, count, alpha);
+      break;
+    case IM_SHORT:
+      DoBlendConst((short*)src_map1, (short*)src_map2, (short*)dst_map, count, alpha);
+      break;
+    case IM_USHORT:
+      DoBlendConst((imushort*)src_map1, (imushort*)src_map2, (imushort*)dst_map, count, alpha);
+      break;
+    case IM_INT:
+      DoBlendConst((int*)src_map1, (int*)src_map2, (int*)dst_map, count, alpha);
+      break;
+    case IM_FLOAT:
+      DoBlendConst((float*)src_map1, (float*)src_map2, (float*)dst_map, count, alpha);
+      break;
+    case IM_CFLOAT:
+      DoBlendConst((imcfloat*)src_map1, (imcfloat*)src_map2, (imcfloat*)dst_map, count, alpha);
+      break;
+    }
   }
 }
 
@@ -326,29 +365,49 @@ static void DoBlend(T *map1, T *map2, TA *alpha, T *map, int count, float type_m
 
 void imProcessBlend(const imImage* src_image1, const imImage* src_image2, const imImage* alpha, imImage* dst_image)
 {
-  int count = src_image1->count*src_image1->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image1, src_image2, alpha, dst_image))
+    return imProcessContiguousCall(imProcessBlend, src_image1, src_image2, alpha, dst_image);
+
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(src_image2) && 
+               imImageIsContiguous(alpha) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image1, single);
+  int count = imProcessRunSize(src_image1, single);
   float type_max = (float)imColorMax(src_image1->data_type);
 
-  switch(src_image1->data_type)
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    DoBlend((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imbyte*)alpha->data[0], (imbyte*)dst_image->data[0], count, type_max);
-    break;
-  case IM_SHORT:
-    DoBlend((short*)src_image1->data[0], (short*)src_image2->data[0], (short*)alpha->data[0], (short*)dst_image->data[0], count, type_max);
-    break;
-  case IM_USHORT:
-    DoBlend((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (imushort*)alpha->data[0], (imushort*)dst_image->data[0], count, type_max);
-    break;
-  case IM_INT:
-    DoBlend((int*)src_image1->data[0], (int*)src_image2->data[0], (int*)alpha->data[0], (int*)dst_image->data[0], count, type_max);
-    break;
-  case IM_FLOAT:
-    DoBlend((float*)src_image1->data[0], (float*)src_image2->data[0], (float*)alpha->data[0], (float*)dst_image->data[0], count, type_max);
-    break;
-  case IM_CFLOAT:
-    DoBlend((imcfloat*)src_image1->data[0], (imcfloat*)src_image2->data[0], (float*)alpha->data[0], (imcfloat*)dst_image->data[0], count, type_max);
-    break;
+    void* src_map1 = imProcessRunData(src_image1, run, single);
+    void* src_map2 = imProcessRunData(src_image2, run, single);
+    void* alpha_map = imProcessRunData(alpha, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      DoBlend((imbyte*)src_map1, (imbyte*)src_map2, (imbyte*)alpha_map, (imbyte*)dst_map, count, type_max);
+      break;
+    case IM_SHORT:
+      DoBlend((short*)src_map1, (short*)src_map2, (short*)alpha_map, (short*)dst_map, count, type_max);
+      break;
+    case IM_USHORT:
+      DoBlend((imushort*)src_map1, (imushort*)src_map2, (imushort*)alpha_map, (imushort*)dst_map, count, type_max);
+      break;
+    case IM_INT:
+      DoBlend((int*)src_map1, (int*)src_map2, (int*)alpha_map, (int*)dst_map, count, type_max);
+      break;
+    case IM_FLOAT:
+      DoBlend((float*)src_map1, (float*)src_map2, (float*)alpha_map, (float*)dst_map, count, type_max);
+      break;
+    case IM_CFLOAT:
+      DoBlend((imcfloat*)src_map1, (imcfloat*)src_map2, (float*)alpha_map, (imcfloat*)dst_map, count, type_max);
+      break;
+    }
   }
 }
 
@@ -457,6 +516,10 @@ static void DoComposeAlpha(T *alpha1, T *alpha2, T *dst_alpha, int count, TA max
 
 void imProcessCompose(const imImage* src_image1, const imImage* src_image2, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessCompose, src_image1, src_image2, dst_image);
+
   int count = src_image1->count, 
       src_alpha = src_image1->depth;
   int type_max = (int)imColorMax(src_image1->data_type);
@@ -706,69 +769,87 @@ static void DoBinaryConstOpByte(T1 *map1, int value, imbyte *map, int count, int
 
 void imProcessArithmeticConstOp(const imImage* src_image1, float value, imImage* dst_image, int op)
 {
-  int count = src_image1->count*src_image1->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image1, dst_image))
+    return imProcessContiguousCall(imProcessArithmeticConstOp, src_image1, value, dst_image, op);
 
-  switch(src_image1->data_type)
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image1, single);
+  int count = imProcessRunSize(src_image1, single);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryConstOp((imbyte*)src_image1->data[0], (float)value, (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoBinaryConstOp((imbyte*)src_image1->data[0], (short)value, (short*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoBinaryConstOp((imbyte*)src_image1->data[0], (imushort)value, (imushort*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryConstOp((imbyte*)src_image1->data[0], (int)value, (int*)dst_image->data[0], count, op);
-    else
-      DoBinaryConstOpByte((imbyte*)src_image1->data[0], (int)value, (imbyte*)dst_image->data[0], count, op);
-    break;
-  case IM_SHORT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryConstOp((short*)src_image1->data[0], (float)value, (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryConstOp((short*)src_image1->data[0], (int)value, (int*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoBinaryConstOp((short*)src_image1->data[0], (int)value, (imushort*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_BYTE)
-      DoBinaryConstOpByte((short*)src_image1->data[0], (int)value, (imbyte*)dst_image->data[0], count, op);
-    else
-      DoBinaryConstOp((short*)src_image1->data[0], (int)value, (short*)dst_image->data[0], count, op);
-    break;
-  case IM_USHORT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryConstOp((imushort*)src_image1->data[0], (float)value, (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoBinaryConstOp((imushort*)src_image1->data[0], (int)value, (int*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoBinaryConstOp((imushort*)src_image1->data[0], (int)value, (short*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_BYTE)
-      DoBinaryConstOpByte((imushort*)src_image1->data[0], (int)value, (imbyte*)dst_image->data[0], count, op);
-    else
-      DoBinaryConstOp((imushort*)src_image1->data[0], (int)value, (imushort*)dst_image->data[0], count, op);
-    break;
-  case IM_INT:
-    if (dst_image->data_type == IM_FLOAT)
-      DoBinaryConstOp((int*)src_image1->data[0], (float)value, (float*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoBinaryConstOp((int*)src_image1->data[0], (int)value, (short*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoBinaryConstOp((int*)src_image1->data[0], (int)value, (imushort*)dst_image->data[0], count, op);
-    else if (dst_image->data_type == IM_BYTE)
-      DoBinaryConstOpByte((int*)src_image1->data[0], (int)value, (imbyte*)dst_image->data[0], count, op);
-    else
-      DoBinaryConstOp((int*)src_image1->data[0], (int)value, (int*)dst_image->data[0], count, op);
-    break;
-  case IM_FLOAT:
-    DoBinaryConstOp((float*)src_image1->data[0], (float)value, (float*)dst_image->data[0], count, op);
-    break;
-  case IM_CFLOAT:
-    DoBinaryConstOpCpxReal((imcfloat*)src_image1->data[0], (float)value, (imcfloat*)dst_image->data[0], count, op);
-    break;
+    void* src_map1 = imProcessRunData(src_image1, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryConstOp((imbyte*)src_map1, (float)value, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoBinaryConstOp((imbyte*)src_map1, (short)value, (short*)dst_map, count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoBinaryConstOp((imbyte*)src_map1, (imushort)value, (imushort*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryConstOp((imbyte*)src_map1, (int)value, (int*)dst_map, count, op);
+      else
+        DoBinaryConstOpByte((imbyte*)src_map1, (int)value, (imbyte*)dst_map, count, op);
+      break;
+    case IM_SHORT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryConstOp((short*)src_map1, (float)value, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryConstOp((short*)src_map1, (int)value, (int*)dst_map, count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoBinaryConstOp((short*)src_map1, (int)value, (imushort*)dst_map, count, op);
+      else if (dst_image->data_type == IM_BYTE)
+        DoBinaryConstOpByte((short*)src_map1, (int)value, (imbyte*)dst_map, count, op);
+      else
+        DoBinaryConstOp((short*)src_map1, (int)value, (short*)dst_map, count, op);
+      break;
+    case IM_USHORT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryConstOp((imushort*)src_map1, (float)value, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoBinaryConstOp((imushort*)src_map1, (int)value, (int*)dst_map, count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoBinaryConstOp((imushort*)src_map1, (int)value, (short*)dst_map, count, op);
+      else if (dst_image->data_type == IM_BYTE)
+        DoBinaryConstOpByte((imushort*)src_map1, (int)value, (imbyte*)dst_map, count, op);
+      else
+        DoBinaryConstOp((imushort*)src_map1, (int)value, (imushort*)dst_map, count, op);
+      break;
+    case IM_INT:
+      if (dst_image->data_type == IM_FLOAT)
+        DoBinaryConstOp((int*)src_map1, (float)value, (float*)dst_map, count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoBinaryConstOp((int*)src_map1, (int)value, (short*)dst_map, count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoBinaryConstOp((int*)src_map1, (int)value, (imushort*)dst_map, count, op);
+      else if (dst_image->data_type == IM_BYTE)
+        DoBinaryConstOpByte((int*)src_map1, (int)value, (imbyte*)dst_map, count, op);
+      else
+        DoBinaryConstOp((int*)src_map1, (int)value, (int*)dst_map, count, op);
+      break;
+    case IM_FLOAT:
+      DoBinaryConstOp((float*)src_map1, (float)value, (float*)dst_map, count, op);
+      break;
+    case IM_CFLOAT:
+      DoBinaryConstOpCpxReal((imcfloat*)src_map1, (float)value, (imcfloat*)dst_map, count, op);
+      break;
+    }
   }
 }
 
 void imProcessMultipleMean(const imImage** src_image_list, int src_image_count, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   const imImage* image1 = src_image_list[0];
   imImage* aux_image = NULL;
 
@@ -804,6 +885,8 @@ void imProcessMultipleMean(const imImage** src_image_list, int src_image_count,
 
 void imProcessMultipleStdDev(const imImage** src_image_list, int src_image_count, const imImage *mean_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   imImage* aux_image = imImageClone(dst_image);
   if (!aux_image)
     return;
@@ -891,9 +974,14 @@ static int doAutoCov(int width, int height, DT *src_map, DT *mean_map, float *ds
 
 int imProcessAutoCovariance(const imImage* src_image, const imImage* mean_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, mean_image, dst_image))
+    return imProcessContiguousCall(imProcessAutoCovariance, src_image, mean_image, dst_image);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("Auto Convariance");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, src_image->depth*src_image->height, "Processing...");
 
   for (int i = 0; i < src_image->depth; i++)
@@ -928,6 +1016,10 @@ int imProcessAutoCovariance(const imImage* src_image, const imImage* mean_image,
 
 void imProcessMultiplyConj(const imImage* src_image1, const imImage* src_image2, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessMultiplyConj, src_image1, src_image2, dst_image);
+
   int total_count = src_image1->count*src_image1->depth;
 
   imcfloat* map = (imcfloat*)dst_image->data[0];
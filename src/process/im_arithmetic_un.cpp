@@ -11,6 +11,8 @@
 #include <im_complex.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 #include "im_math_op.h"
 
@@ -257,69 +259,90 @@ static void DoUnaryOpByte(T1 *map, imbyte *new_map, int count, int op)
 
 void imProcessUnArithmeticOp(const imImage* src_image, imImage* dst_image, int op)
 {
-  int total_count = src_image->count * src_image->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, dst_image))
+    return imProcessContiguousCall(imProcessUnArithmeticOp, src_image, dst_image, op);
 
-  switch(src_image->data_type)
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image, single);
+  int total_count = imProcessRunSize(src_image, single);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*total_count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    if (dst_image->data_type == IM_FLOAT)
-      DoUnaryOp((imbyte*)src_image->data[0], (float*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoUnaryOp((imbyte*)src_image->data[0], (int*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoUnaryOp((imbyte*)src_image->data[0], (imushort*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoUnaryOp((imbyte*)src_image->data[0], (short*)dst_image->data[0], total_count, op);
-    else
-      DoUnaryOpByte((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], total_count, op);
-    break;                                                                                
-  case IM_SHORT:
-    if (dst_image->data_type == IM_BYTE)
-      DoUnaryOpByte((short*)src_image->data[0], (imbyte*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoUnaryOp((short*)src_image->data[0], (imushort*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoUnaryOp((short*)src_image->data[0], (int*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_FLOAT)
-      DoUnaryOp((short*)src_image->data[0], (float*)dst_image->data[0], total_count, op);
-    else
-      DoUnaryOp((short*)src_image->data[0], (short*)dst_image->data[0], total_count, op);
-    break;                                                                                
-  case IM_USHORT:
-    if (dst_image->data_type == IM_BYTE)
-      DoUnaryOpByte((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoUnaryOp((imushort*)src_image->data[0], (short*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_INT)
-      DoUnaryOp((imushort*)src_image->data[0], (int*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_FLOAT)
-      DoUnaryOp((imushort*)src_image->data[0], (float*)dst_image->data[0], total_count, op);
-    else
-      DoUnaryOp((imushort*)src_image->data[0], (imushort*)dst_image->data[0], total_count, op);
-    break;                                                                                
-  case IM_INT:                                                                           
-    if (dst_image->data_type == IM_BYTE)
-      DoUnaryOpByte((int*)src_image->data[0], (imbyte*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_SHORT)
-      DoUnaryOp((int*)src_image->data[0], (short*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_USHORT)
-      DoUnaryOp((int*)src_image->data[0], (imushort*)dst_image->data[0], total_count, op);
-    else if (dst_image->data_type == IM_FLOAT)
-      DoUnaryOp((int*)src_image->data[0], (float*)dst_image->data[0], total_count, op);
-    else
-      DoUnaryOp((int*)src_image->data[0], (int*)dst_image->data[0], total_count, op);
-    break;                                                                                
-  case IM_FLOAT:                                                                           
-    DoUnaryOp((float*)src_image->data[0], (float*)dst_image->data[0], total_count, op);
-    break;                                                                                
-  case IM_CFLOAT:            
-    DoUnaryOp((imcfloat*)src_image->data[0], (imcfloat*)dst_image->data[0], total_count, op);
-    break;
+    void* src_map = imProcessRunData(src_image, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image->data_type)
+    {
+    case IM_BYTE:
+      if (dst_image->data_type == IM_FLOAT)
+        DoUnaryOp((imbyte*)src_map, (float*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoUnaryOp((imbyte*)src_map, (int*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoUnaryOp((imbyte*)src_map, (imushort*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoUnaryOp((imbyte*)src_map, (short*)dst_map, total_count, op);
+      else
+        DoUnaryOpByte((imbyte*)src_map, (imbyte*)dst_map, total_count, op);
+      break;                                                                                
+    case IM_SHORT:
+      if (dst_image->data_type == IM_BYTE)
+        DoUnaryOpByte((short*)src_map, (imbyte*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoUnaryOp((short*)src_map, (imushort*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoUnaryOp((short*)src_map, (int*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_FLOAT)
+        DoUnaryOp((short*)src_map, (float*)dst_map, total_count, op);
+      else
+        DoUnaryOp((short*)src_map, (short*)dst_map, total_count, op);
+      break;                                                                                
+    case IM_USHORT:
+      if (dst_image->data_type == IM_BYTE)
+        DoUnaryOpByte((imushort*)src_map, (imbyte*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoUnaryOp((imushort*)src_map, (short*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_INT)
+        DoUnaryOp((imushort*)src_map, (int*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_FLOAT)
+        DoUnaryOp((imushort*)src_map, (float*)dst_map, total_count, op);
+      else
+        DoUnaryOp((imushort*)src_map, (imushort*)dst_map, total_count, op);
+      break;                                                                                
+    case IM_INT:                                                                           
+      if (dst_image->data_type == IM_BYTE)
+        DoUnaryOpByte((int*)src_map, (imbyte*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_SHORT)
+        DoUnaryOp((int*)src_map, (short*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_USHORT)
+        DoUnaryOp((int*)src_map, (imushort*)dst_map, total_count, op);
+      else if (dst_image->data_type == IM_FLOAT)
+        DoUnaryOp((int*)src_map, (float*)dst_map, total_count, op);
+      else
+        DoUnaryOp((int*)src_map, (int*)dst_map, total_count, op);
+      break;                                                                                
+    case IM_FLOAT:                                                                           
+      DoUnaryOp((float*)src_map, (float*)dst_map, total_count, op);
+      break;                                                                                
+    case IM_CFLOAT:            
+      DoUnaryOp((imcfloat*)src_map, (imcfloat*)dst_map, total_count, op);
+      break;
+    }
   }
 }
 
 void imProcessSplitComplex(const imImage* src_image, imImage* dst_image1, imImage* dst_image2, int polar)
 {
+  imImageMakeWritable(dst_image1);
+  imImageMakeWritable(dst_image2);
+  if (!imProcessIsContiguous(src_image, dst_image1, dst_image2))
+    return imProcessContiguousCall(imProcessSplitComplex, src_image, dst_image1, dst_image2, polar);
+
   int total_count = src_image->count*src_image->depth;
 
   imcfloat* map = (imcfloat*)src_image->data[0];
@@ -346,6 +369,10 @@ void imProcessSplitComplex(const imImage* src_image, imImage* dst_image1, imImag
                   
 void imProcessMergeComplex(const imImage* src_image1, const imImage* src_image2, imImage* dst_image, int polar)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessMergeComplex, src_image1, src_image2, dst_image, polar);
+
   int total_count = src_image1->count*src_image1->depth;
 
   imcfloat* map = (imcfloat*)dst_image->data[0];
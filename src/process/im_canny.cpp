@@ -8,6 +8,7 @@
 #include <im_util.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
 
 #include <math.h>
@@ -30,6 +31,10 @@ static void nonmax_suppress (float **dx, float **dy, imImage* mag);
 
 void imProcessCanny(const imImage* src_image, imImage* dst_image, float stddev)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessCanny, src_image, dst_image, stddev);
+
   int width = 1;
   float **smx,**smy;
   float **dx,**dy;
@@ -11,6 +11,7 @@
 #include <im_palette.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 
 #include <stdlib.h>
@@ -37,6 +38,11 @@ static void rgb2yrgb(imbyte* r, imbyte* g, imbyte* b, imbyte* y)
 
 void imProcessSplitYChroma(const imImage* src_image, imImage* y_image, imImage* chroma_image)
 {
+  imImageMakeWritable(y_image);
+  imImageMakeWritable(chroma_image);
+  if (!imProcessIsContiguous(src_image, y_image, chroma_image))
+    return imProcessContiguousCall(imProcessSplitYChroma, src_image, y_image, chroma_image);
+
   imbyte 
     *red=(imbyte*)src_image->data[0],
     *green=(imbyte*)src_image->data[1],
@@ -98,6 +104,12 @@ static void DoSplitHSIByte(imbyte** data, float* hue, float* saturation, float*
 
 void imProcessSplitHSI(const imImage* src_image, imImage* dst_image1, imImage* dst_image2, imImage* dst_image3)
 {
+  imImageMakeWritable(dst_image1);
+  imImageMakeWritable(dst_image2);
+  imImageMakeWritable(dst_image3);
+  if (!imProcessIsContiguous(src_image, dst_image1, dst_image2, dst_image3))
+    return imProcessContiguousCall(imProcessSplitHSI, src_image, dst_image1, dst_image2, dst_image3);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
@@ -143,6 +155,10 @@ static void DoMergeHSIByte(imbyte** data, float* hue, float* saturation, float*
 
 void imProcessMergeHSI(const imImage* src_image1, const imImage* src_image2, const imImage* src_image3, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image1, src_image2, src_image3, dst_image))
+    return imProcessContiguousCall(imProcessMergeHSI, src_image1, src_image2, src_image3, dst_image);
+
   switch(dst_image->data_type)
   {
   case IM_BYTE:
@@ -156,6 +172,18 @@ void imProcessMergeHSI(const imImage* src_image1, const imImage* src_image2, con
 
 void imProcessSplitComponents(const imImage* src_image, imImage** dst_image)
 {
+  int dst_count = (imColorModeDepth(src_image->color_space) == 4 || src_image->has_alpha)? 4: 3;
+  for (int i = 0; i < dst_count; i++)
+    imImageMakeWritable(dst_image[i]);
+  if (!imProcessIsContiguous(src_image) || !imProcessIsContiguousList(dst_image, dst_count))
+  {
+    imProcessContiguous contiguous_src(src_image);
+    imProcessContiguousList contiguous_dst(dst_image, dst_count, 1);
+    if (!contiguous_src.Failed() && !contiguous_dst.Failed())
+      imProcessSplitComponents(contiguous_src, contiguous_dst);
+    return;
+  }
+
   memcpy(dst_image[0]->data[0], src_image->data[0], src_image->plane_size);
   memcpy(dst_image[1]->data[0], src_image->data[1], src_image->plane_size);
   memcpy(dst_image[2]->data[0], src_image->data[2], src_image->plane_size);
@@ -165,6 +193,17 @@ void imProcessSplitComponents(const imImage* src_image, imImage** dst_image)
 
 void imProcessMergeComponents(const imImage** src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  int src_count = (imColorModeDepth(dst_image->color_space) == 4 || dst_image->has_alpha)? 4: 3;
+  if (!imProcessIsContiguousList(src_image, src_count) || !imProcessIsContiguous(dst_image))
+  {
+    imProcessContiguousList contiguous_src(src_image, src_count);
+    imProcessContiguous contiguous_dst(dst_image, 1);
+    if (!contiguous_src.Failed() && !contiguous_dst.Failed())
+      imProcessMergeComponents(contiguous_src, contiguous_dst);
+    return;
+  }
+
   memcpy(dst_image->data[0], src_image[0]->data[0], dst_image->plane_size);
   memcpy(dst_image->data[1], src_image[1]->data[0], dst_image->plane_size);
   memcpy(dst_image->data[2], src_image[2]->data[0], dst_image->plane_size);
@@ -207,6 +246,10 @@ static void DoNormalizeComp(T** src_data, float** dst_data, int count, int depth
 
 void imProcessNormalizeComponents(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessNormalizeComponents, src_image, dst_image);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
@@ -257,6 +300,10 @@ static void DoReplaceColor(T *src_data, T *dst_data, int count, int depth, float
 
 void imProcessReplaceColor(const imImage* src_image, imImage* dst_image, float* src_color, float* dst_color)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessReplaceColor, src_image, dst_image, src_color, dst_color);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
@@ -302,6 +349,10 @@ static void DoSetAlphaColor(ST *src_data, DT *dst_data, int count, int depth, fl
 
 void imProcessSetAlphaColor(const imImage* src_image, imImage* dst_image, float* src_color, float dst_alpha)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessSetAlphaColor, src_image, dst_image, src_color, dst_alpha);
+
   int a = 0; // dst_image is a mask to be used as alpha
   if (dst_image->has_alpha)
     a = dst_image->depth; // Index of the alpha channel
@@ -15,6 +15,7 @@
 #else
 #include "im_counter.h"
 #endif
+#include "im_profile.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -36,8 +37,10 @@ int imConvertToBitmap(const imImage* src_image, imImage* dst_image, int cpx2real
 #ifdef IM_PROCESS
   int counter = imProcessCounterBegin("Building Bitmap");
 #else
+  imProfileBegin("Building Bitmap", 1);
   int counter = imCounterBegin("Building Bitmap");
 #endif
+  imProfileAddData(src_image->count, (double)src_image->count*(src_image->depth*imDataTypeSize(src_image->data_type) + dst_image->depth));
 
   int ret;
   if (src_image->data_type == IM_BYTE)
@@ -93,6 +96,7 @@ int imConvertToBitmap(const imImage* src_image, imImage* dst_image, int cpx2real
   imProcessCounterEnd(counter);
 #else
   imCounterEnd(counter);
+  imProfileEnd();
 #endif
 
   return ret;
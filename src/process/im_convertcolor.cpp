@@ -16,6 +16,8 @@
 #else
 #include "im_counter.h"
 #endif
+#include "im_profile.h"
+#include "process/im_process_layout.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -26,6 +28,9 @@
 #define IM_BEGIN_PROCESSING   
 #define IM_COUNT_PROCESSING   if (!imCounterInc(counter)) { processing = IM_ERR_COUNTER; break; }
 #define IM_END_PROCESSING
+#define IM_STOP_PROCESSING    (processing != IM_ERR_NONE)
+#else
+#define IM_STOP_PROCESSING    (!processing)
 #endif
 
 
@@ -40,65 +45,189 @@
 #endif
 
 
-static void iConvertSetTranspMap(imbyte *src_map, imbyte *dst_alpha, int count, imbyte *transp_map, int transp_count)
+/* The conversions access the image data as runs of pixels, a single run when the planes have no padding,
+   otherwise one run per line. In packed images the components of a pixel are consecutive,
+   so the step from one pixel to the next in the same component is the number of components. */
+
+static inline int iConvertRunCount(const imImage* image, int single)
 {
-#ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
-#endif
-  for(int i = 0; i < count; i++)
+  return single? 1: image->height;
+}
+
+static inline int iConvertRunSize(const imImage* image, int single)
+{
+  return single? image->count: image->width;
+}
+
+static inline int iConvertRunStep(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->has_alpha? image->depth+1: image->depth;
+  return 1;
+}
+
+static inline void* iConvertRunData(const imImage* image, int plane, int run)
+{
+  return (imbyte*)image->data[plane] + run*image->line_stride;
+}
+
+template <class T> 
+IM_STATIC void iConvertCopyRun(const T* src_map, int src_step, T* dst_map, int dst_step, int count)
+{
+  for (int i = 0; i < count; i++)
+    dst_map[i*dst_step] = src_map[i*src_step];
+}
+
+static void iConvertCopyPlane(const imImage* src_image, int src_plane, imImage* dst_image, int dst_plane, int single)
+{
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+  int type_size = imDataTypeSize(src_image->data_type);
+
+  for (int run = 0; run < run_count; run++)
   {
-    if (src_map[i] < transp_count)
-      dst_alpha[i] = transp_map[src_map[i]];
+    void* src_map = iConvertRunData(src_image, src_plane, run);
+    void* dst_map = iConvertRunData(dst_image, dst_plane, run);
+
+    if (src_step == 1 && dst_step == 1)
+      memcpy(dst_map, src_map, count*type_size);
     else
-      dst_alpha[i] = 255;  /* opaque */
+    {
+      switch(type_size)
+      {
+      case 1: iConvertCopyRun((const imbyte*)src_map, src_step, (imbyte*)dst_map, dst_step, count); break;
+      case 2: iConvertCopyRun((const imushort*)src_map, src_step, (imushort*)dst_map, dst_step, count); break;
+      case 4: iConvertCopyRun((const int*)src_map, src_step, (int*)dst_map, dst_step, count); break;
+      case 8: iConvertCopyRun((const imcfloat*)src_map, src_step, (imcfloat*)dst_map, dst_step, count); break;
+      }
+    }
   }
 }
 
-static void iConvertSetTranspIndex(imbyte *src_map, imbyte *dst_alpha, int count, imbyte index)
+static void iConvertSetTranspMap(const imImage* src_image, imImage* dst_image, int single, imbyte *transp_map, int transp_count)
 {
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const imbyte *src_map = (const imbyte*)iConvertRunData(src_image, 0, run);
+    imbyte *dst_alpha = (imbyte*)iConvertRunData(dst_image, 3, run);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for(int i = 0; i < count; i++)
+    for(int i = 0; i < count; i++)
+    {
+      int index = src_map[i*src_step];
+      if (index < transp_count)
+        dst_alpha[i*dst_step] = transp_map[index];
+      else
+        dst_alpha[i*dst_step] = 255;  /* opaque */
+    }
+  }
+}
+
+static void iConvertSetTranspIndex(const imImage* src_image, imImage* dst_image, int single, imbyte index)
+{
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-    if (src_map[i] == index)
-      dst_alpha[i] = 0;    /* full transparent */
-    else
-      dst_alpha[i] = 255;  /* opaque */
+    const imbyte *src_map = (const imbyte*)iConvertRunData(src_image, 0, run);
+    imbyte *dst_alpha = (imbyte*)iConvertRunData(dst_image, 3, run);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#endif
+    for(int i = 0; i < count; i++)
+    {
+      if (src_map[i*src_step] == index)
+        dst_alpha[i*dst_step] = 0;    /* full transparent */
+      else
+        dst_alpha[i*dst_step] = 255;  /* opaque */
+    }
   }
 }
 
-static void iConvertSetTranspColor(imbyte **dst_data, int count, imbyte r, imbyte g, imbyte b)
+static void iConvertSetTranspColor(imImage* dst_image, int single, imbyte r, imbyte g, imbyte b)
 {
-  imbyte *pr = dst_data[0];
-  imbyte *pg = dst_data[1];
-  imbyte *pb = dst_data[2];
-  imbyte *pa = dst_data[3];
+  int run_count = iConvertRunCount(dst_image, single);
+  int count = iConvertRunSize(dst_image, single);
+  int step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    imbyte *pr = (imbyte*)iConvertRunData(dst_image, 0, run);
+    imbyte *pg = (imbyte*)iConvertRunData(dst_image, 1, run);
+    imbyte *pb = (imbyte*)iConvertRunData(dst_image, 2, run);
+    imbyte *pa = (imbyte*)iConvertRunData(dst_image, 3, run);
 
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for(int i = 0; i < count; i++)
+    for(int i = 0; i < count; i++)
+    {
+      if (pr[i*step] == r &&
+          pg[i*step] == g &&
+          pb[i*step] == b)
+        pa[i*step] = 0;    /* transparent */
+      else
+        pa[i*step] = 255;  /* opaque */
+    }
+  }
+}
+
+static void iConvertSetOpaque(imImage* dst_image, int single)
+{
+  int run_count = iConvertRunCount(dst_image, single);
+  int count = iConvertRunSize(dst_image, single);
+  int step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-    if (pr[i] == r &&
-        pg[i] == g &&
-        pb[i] == b)
-      pa[i] = 0;    /* transparent */
+    imbyte *pa = (imbyte*)iConvertRunData(dst_image, 3, run);
+
+    if (step == 1)
+      memset(pa, 255, count);
     else
-      pa[i] = 255;  /* opaque */
+    {
+      for(int i = 0; i < count; i++)
+        pa[i*step] = 255;
+    }
   }
 }
 
 // convert bin2gray and gray2bin
-static void iConvertBinary(imbyte* map, int count, imbyte value)
+static void iConvertBinary(imImage* image, int single, imbyte value)
 {
+  int run_count = iConvertRunCount(image, single);
+  int count = iConvertRunSize(image, single);
+  int step = iConvertRunStep(image);
+  int run;
+
   imbyte thres = (value == 255)? 1: 128;
 
   // if gray2bin, check for invalid gray that already is binary
   if (value != 255)
   {
-    imbyte min, max;
-    imMinMax(map, count, min, max);
+    imbyte max = 0;
+    for (run = 0; run < run_count; run++)
+    {
+      const imbyte* map = (const imbyte*)iConvertRunData(image, 0, run);
+      for (int i = 0; i < count; i++)
+      {
+        if (map[i*step] > max)
+          max = map[i*step];
+      }
+    }
 
     if (max == 1)
       thres = 1;
@@ -106,59 +235,88 @@ static void iConvertBinary(imbyte* map, int count, imbyte value)
       thres = max / 2;
   }
 
+  for (run = 0; run < run_count; run++)
+  {
+    imbyte* map = (imbyte*)iConvertRunData(image, 0, run);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    if (map[i] >= thres)
-      map[i] = value;
-    else
-      map[i] = 0;
+    for (int i = 0; i < count; i++)
+    {
+      if (map[i*step] >= thres)
+        map[i*step] = value;
+      else
+        map[i*step] = 0;
+    }
   }
 }
 
-static void iConvertMap2Gray(const imbyte* src_map, imbyte* dst_map, int count, const long* palette, const int palette_count)
+static void iConvertMap2Gray(const imImage* src_image, imImage* dst_image, int single)
 {
   imbyte r, g, b;
   imbyte remap[256];
 
-  for (int c = 0; c < palette_count; c++)
+  for (int c = 0; c < src_image->palette_count; c++)
   {
-    imColorDecode(&r, &g, &b, palette[c]);
+    imColorDecode(&r, &g, &b, src_image->palette[c]);
     remap[c] = imColorRGB2Luma(r, g, b);
   }
 
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const imbyte* src_map = (const imbyte*)iConvertRunData(src_image, 0, run);
+    imbyte* dst_map = (imbyte*)iConvertRunData(dst_image, 0, run);
+
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    dst_map[i] = remap[src_map[i]];
+    for (int i = 0; i < count; i++)
+    {
+      dst_map[i*dst_step] = remap[src_map[i*src_step]];
+    }
   }
 }
 
-static void iConvertMapToRGB(const imbyte* src_map, imbyte* red, imbyte* green, imbyte* blue, int count, const long* palette, const int palette_count)
+static void iConvertMapToRGB(const imImage* src_image, imImage* dst_image, int single)
 {
   imbyte r[256], g[256], b[256];
-  for (int c = 0; c < palette_count; c++)
-    imColorDecode(&r[c], &g[c], &b[c], palette[c]);
+  for (int c = 0; c < src_image->palette_count; c++)
+    imColorDecode(&r[c], &g[c], &b[c], src_image->palette[c]);
+
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    const imbyte* src_map = (const imbyte*)iConvertRunData(src_image, 0, run);
+    imbyte* red = (imbyte*)iConvertRunData(dst_image, 0, run);
+    imbyte* green = (imbyte*)iConvertRunData(dst_image, 1, run);
+    imbyte* blue = (imbyte*)iConvertRunData(dst_image, 2, run);
 
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-  for (int i = 0; i < count; i++)
-  {
-    int index = src_map[i];
-    red[i] = r[index];
-    green[i] = g[index];
-    blue[i] = b[index];
+    for (int i = 0; i < count; i++)
+    {
+      int index = src_map[i*src_step];
+      red[i*dst_step] = r[index];
+      green[i*dst_step] = g[index];
+      blue[i*dst_step] = b[index];
+    }
   }
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2Gray(int count, int data_type, 
-                    const T** src_data, int src_color_space, T** dst_data, int counter)
+                    const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T type_max = (T)imColorMax(data_type);
@@ -170,8 +328,6 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
   const T* src_map3 = (src_color_space == IM_CMYK)? src_data[3]: 0;
   T* dst_map = dst_data[0];
 
-  imCounterTotal(counter, count, "Converting To Gray...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -188,10 +344,10 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
       IM_BEGIN_PROCESSING;
 
       // scale to 0-1
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);  // use only Y component
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);  // use only Y component
 
       // do gamma correction then scale back to 0-type_max
-      dst_map[i] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
+      dst_map[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -213,8 +369,8 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
 
       T r, g, b;
       // result is still 0-type_max
-      imColorCMYK2RGB(src_map0[i], src_map1[i], src_map2[i], src_map3[i], r, g, b, type_max);
-      dst_map[i] = imColorRGB2Luma(r, g, b);
+      imColorCMYK2RGB(src_map0[i*src_step], src_map1[i*src_step], src_map2[i*src_step], src_map3[i*src_step], r, g, b, type_max);
+      dst_map[i*dst_step] = imColorRGB2Luma(r, g, b);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -234,7 +390,7 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
 #endif
       IM_BEGIN_PROCESSING;
 
-      dst_map[i] = imColorRGB2Luma(src_map0[i], src_map1[i], src_map2[i]);
+      dst_map[i*dst_step] = imColorRGB2Luma(src_map0[i*src_step], src_map1[i*src_step], src_map2[i*src_step]);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -257,11 +413,11 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max); // scale to 0-1
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max); // scale to 0-1
       c0 = imColorLightness2Luminance(c0);             // do the conversion
 
       // do gamma correction then scale back to 0-type_max
-      dst_map[i] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
+      dst_map[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -274,12 +430,12 @@ IM_STATIC int iDoConvert2Gray(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2RGB(int count, int data_type, 
-                   const T** src_data, int src_color_space, T** dst_data, int counter)
+                   const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T zero;
@@ -294,8 +450,6 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
   T* dst_map1 = dst_data[1];
   T* dst_map2 = dst_data[2];
 
-  imCounterTotal(counter, count, "Converting To RGB...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -314,18 +468,18 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
       // to increase precision do intermediate conversions in float
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       // result is still 0-1
       imColorXYZ2RGB(c0, c1, c2, 
                      c0, c1, c2);
 
       // do gamma correction then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
-      dst_map1[i] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
-      dst_map2[i] = imColorQuantize(imColorTransfer2Nonlinear(c2), type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c2), type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -341,8 +495,8 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
 #endif
     for (i = 0; i < count; i++)
     {
-      imColorYCbCr2RGB(src_map0[i], src_map1[i], src_map2[i], 
-                       dst_map0[i], dst_map1[i], dst_map2[i], zero, type_min, type_max);
+      imColorYCbCr2RGB(src_map0[i*src_step], src_map1[i*src_step], src_map2[i*src_step], 
+                       dst_map0[i*dst_step], dst_map1[i*dst_step], dst_map2[i*dst_step], zero, type_min, type_max);
     }
     break;
   case IM_CMYK: 
@@ -357,8 +511,8 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
       IM_BEGIN_PROCESSING;
 
       // result is still 0-type_max
-      imColorCMYK2RGB(src_map0[i], src_map1[i], src_map2[i], src_map3[i], 
-                      dst_map0[i], dst_map1[i], dst_map2[i], type_max);
+      imColorCMYK2RGB(src_map0[i*src_step], src_map1[i*src_step], src_map2[i*src_step], src_map3[i*src_step], 
+                      dst_map0[i*dst_step], dst_map1[i*dst_step], dst_map2[i*dst_step], type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -382,9 +536,9 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
       // to increase precision do intermediate conversions in float
 
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max) - 0.5f;
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max) - 0.5f;
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max) - 0.5f;
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max) - 0.5f;
 
       if (src_color_space == IM_LUV)
         imColorLuv2XYZ(c0, c1, c2,  // conversion in-place
@@ -397,9 +551,9 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
                      c0, c1, c2);
 
       // do gamma correction then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
-      dst_map1[i] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
-      dst_map2[i] = imColorQuantize(imColorTransfer2Nonlinear(c2), type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c0), type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c1), type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(imColorTransfer2Nonlinear(c2), type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -412,12 +566,12 @@ IM_STATIC int iDoConvert2RGB(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2YCbCr(int count, int data_type, 
-                     const T** src_data, int src_color_space, T** dst_data, int counter)
+                     const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T zero;
@@ -429,8 +583,6 @@ IM_STATIC int iDoConvert2YCbCr(int count, int data_type,
   T* dst_map1 = dst_data[1];
   T* dst_map2 = dst_data[2];
 
-  imCounterTotal(counter, count, "Converting To YCbCr...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -447,8 +599,8 @@ IM_STATIC int iDoConvert2YCbCr(int count, int data_type,
 #endif
       IM_BEGIN_PROCESSING;
 
-      imColorRGB2YCbCr(src_map0[i], src_map1[i], src_map2[i], 
-                       dst_map0[i], dst_map1[i], dst_map2[i], zero);
+      imColorRGB2YCbCr(src_map0[i*src_step], src_map1[i*src_step], src_map2[i*src_step], 
+                       dst_map0[i*dst_step], dst_map1[i*dst_step], dst_map2[i*dst_step], zero);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -461,12 +613,12 @@ IM_STATIC int iDoConvert2YCbCr(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2XYZ(int count, int data_type, 
-                   const T** src_data, int src_color_space, T** dst_data, int counter)
+                   const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T type_max = (T)imColorMax(data_type);
@@ -479,8 +631,6 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
   T* dst_map1 = dst_data[1];
   T* dst_map2 = dst_data[2];
 
-  imCounterTotal(counter, count, "Converting To XYZ...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -497,15 +647,15 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
       IM_BEGIN_PROCESSING;
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0*0.9505f, type_min, type_max);    // Compensate D65 white point
-      dst_map1[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c0*1.0890f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0*0.9505f, type_min, type_max);    // Compensate D65 white point
+      dst_map1[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c0*1.0890f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -528,9 +678,9 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
       // to increase precision do intermediate conversions in float
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
@@ -542,9 +692,9 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
                      c0, c1, c2);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -567,9 +717,9 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max) - 0.5f;
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max) - 0.5f;
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max) - 0.5f;
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max) - 0.5f;
 
       if (src_color_space == IM_LUV)
         imColorLuv2XYZ(c0, c1, c2,  // conversion in-place
@@ -579,9 +729,9 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
                        c0, c1, c2);
 
       // scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -594,12 +744,12 @@ IM_STATIC int iDoConvert2XYZ(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2Lab(int count, int data_type, 
-                   const T** src_data, int src_color_space, T** dst_data, int counter)
+                   const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T type_max = (T)imColorMax(data_type);
@@ -612,8 +762,6 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
   T* dst_map1 = dst_data[1];
   T* dst_map2 = dst_data[2];
 
-  imCounterTotal(counter, count, "Converting To Lab...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -630,7 +778,7 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
       IM_BEGIN_PROCESSING;
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
@@ -639,7 +787,7 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
       c0 = imColorLuminance2Lightness(c0);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);  // update only the L component
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);  // update only the L component
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -662,9 +810,9 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
       // to increase precision do intermediate conversions in float
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
@@ -678,9 +826,9 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
                      c0, c1, c2);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -702,17 +850,17 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       imColorXYZ2Lab(c0, c1, c2,  // conversion in-place
                      c0, c1, c2);
 
       // scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -734,9 +882,9 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max) - 0.5f;
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max) - 0.5f;
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max) - 0.5f;
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max) - 0.5f;
 
       imColorLuv2XYZ(c0, c1, c2,  // conversion in-place
                      c0, c1, c2);
@@ -744,9 +892,9 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
                      c0, c1, c2);
 
       // scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -759,12 +907,12 @@ IM_STATIC int iDoConvert2Lab(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
 IM_STATIC int iDoConvert2Luv(int count, int data_type, 
-                   const T** src_data, int src_color_space, T** dst_data, int counter)
+                   const T** src_data, int src_step, int src_color_space, T** dst_data, int dst_step, int counter)
 {
   int i;
   T type_max = (T)imColorMax(data_type);
@@ -777,8 +925,6 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
   T* dst_map1 = dst_data[1];
   T* dst_map2 = dst_data[2];
 
-  imCounterTotal(counter, count, "Converting To Luv...");
-
   IM_INT_PROCESSING;
 
   switch(src_color_space)
@@ -795,7 +941,7 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
       IM_BEGIN_PROCESSING;
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
@@ -804,7 +950,7 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
       c0 = imColorLuminance2Lightness(c0);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);  // update only the L component
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);  // update only the L component
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -827,9 +973,9 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
       // to increase precision do intermediate conversions in float
 
       // scale to 0-1
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       // do gamma correction
       c0 = imColorTransfer2Linear(c0);
@@ -843,9 +989,9 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
                      c0, c1, c2);
 
       // then scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -867,17 +1013,17 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max);
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max);
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max);
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max);
 
       imColorXYZ2Luv(c0, c1, c2,  // conversion in-place
                      c0, c1, c2);
 
       // scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -899,9 +1045,9 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
 
       // to increase precision do intermediate conversions in float
       // scale to 0-1 and -0.5/+0.5
-      float c0 = imColorReconstruct(src_map0[i], type_min, type_max);
-      float c1 = imColorReconstruct(src_map1[i], type_min, type_max) - 0.5f;
-      float c2 = imColorReconstruct(src_map2[i], type_min, type_max) - 0.5f;
+      float c0 = imColorReconstruct(src_map0[i*src_step], type_min, type_max);
+      float c1 = imColorReconstruct(src_map1[i*src_step], type_min, type_max) - 0.5f;
+      float c2 = imColorReconstruct(src_map2[i*src_step], type_min, type_max) - 0.5f;
 
       imColorLab2XYZ(c0, c1, c2,  // conversion in-place
                      c0, c1, c2);
@@ -909,9 +1055,9 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
                      c0, c1, c2);
 
       // scale back to 0-type_max
-      dst_map0[i] = imColorQuantize(c0, type_min, type_max);
-      dst_map1[i] = imColorQuantize(c1 + 0.5f, type_min, type_max);
-      dst_map2[i] = imColorQuantize(c2 + 0.5f, type_min, type_max);
+      dst_map0[i*dst_step] = imColorQuantize(c0, type_min, type_max);
+      dst_map1[i*dst_step] = imColorQuantize(c1 + 0.5f, type_min, type_max);
+      dst_map2[i*dst_step] = imColorQuantize(c2 + 0.5f, type_min, type_max);
 
       IM_COUNT_PROCESSING;
 #ifdef _OPENMP
@@ -924,14 +1070,15 @@ IM_STATIC int iDoConvert2Luv(int count, int data_type,
     return IM_ERR_DATA;
   }
 
-  return IM_ERR_NONE;
+  return IM_STOP_PROCESSING? IM_ERR_COUNTER: IM_ERR_NONE;
 }
 
 template <class T> 
-IM_STATIC int iDoConvertColorSpace(int count, int data_type, 
-                                 const T** src_data, int src_color_space, 
-                                       T** dst_data, int dst_color_space)
+IM_STATIC int iDoConvertColorSpace(const imImage* src_image, imImage* dst_image, int single)
 {
+  int src_color_space = src_image->color_space, 
+      dst_color_space = dst_image->color_space, 
+      data_type = src_image->data_type;
   int ret = IM_ERR_DATA, 
       convert2rgb = 0;
 
@@ -947,110 +1094,124 @@ IM_STATIC int iDoConvertColorSpace(int count, int data_type,
   if (dst_color_space == IM_YCBCR && src_color_space != IM_RGB)
     convert2rgb = 1;
 
+  int run_count = iConvertRunCount(src_image, single);
+  int count = iConvertRunSize(src_image, single);
+  if (data_type == IM_CFLOAT)
+    count *= 2;  /* treat complex as two real values */
+  int src_step = iConvertRunStep(src_image);
+  int dst_step = iConvertRunStep(dst_image);
+  int total_count = run_count*count;
+
 #ifdef IM_PROCESS
   int counter = imProcessCounterBegin("Convert Color Space");
 #else
+  imProfileBegin("Convert Color Space", 1);
   int counter = imCounterBegin("Convert Color Space");
 #endif
+  imProfileAddData(total_count, (double)total_count*imDataTypeSize(data_type)*(imColorModeDepth(src_color_space) + imColorModeDepth(dst_color_space)));
 
-  if (convert2rgb)
+  const char* msg = NULL;
+  switch(dst_color_space)
   {
-    ret = iDoConvert2RGB(count, data_type, src_data, src_color_space, dst_data, counter);     
+  case IM_GRAY:  msg = "Converting To Gray..."; break;
+  case IM_RGB:   msg = "Converting To RGB..."; break;
+  case IM_YCBCR: msg = "Converting To YCbCr..."; break;
+  case IM_XYZ:   msg = "Converting To XYZ..."; break;
+  case IM_LAB:   msg = "Converting To Lab..."; break;
+  case IM_LUV:   msg = "Converting To Luv..."; break;
+  }
+  imCounterTotal(counter, convert2rgb? 2*total_count: total_count, msg);
 
-    if (ret != IM_ERR_NONE) 
+  for (int run = 0; run < run_count; run++)
+  {
+    void* src_data[5];
+    void* dst_data[5];
+    int d;
+    for (d = 0; d < src_image->depth; d++)
+      src_data[d] = iConvertRunData(src_image, d, run);
+    for (d = 0; d < dst_image->depth; d++)
+      dst_data[d] = iConvertRunData(dst_image, d, run);
+
+    const T** run_src_data = (const T**)src_data;
+    int run_src_step = src_step, 
+        run_src_color_space = src_color_space;
+
+    if (convert2rgb)
     {
-#ifdef IM_PROCESS
-      imProcessCounterEnd(counter);
-#else
-      imCounterEnd(counter);
-#endif
-      return ret;
+      ret = iDoConvert2RGB(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);     
+      if (ret != IM_ERR_NONE) 
+        break;
+
+      run_src_data = (const T**)dst_data;
+      run_src_step = dst_step;
+      run_src_color_space = IM_RGB;
     }
 
-    src_data = (const T**)dst_data;
-    src_color_space = IM_RGB;
-  }
+    switch(dst_color_space)
+    {
+    case IM_GRAY: 
+      ret = iDoConvert2Gray(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);
+      break;
+    case IM_RGB: 
+      ret = iDoConvert2RGB(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);
+      break;
+    case IM_YCBCR: 
+      ret = iDoConvert2YCbCr(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter); 
+      break;
+    case IM_XYZ: 
+      ret = iDoConvert2XYZ(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);
+      break;
+    case IM_LAB: 
+      ret = iDoConvert2Lab(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);
+      break;
+    case IM_LUV: 
+      ret = iDoConvert2Luv(count, data_type, run_src_data, run_src_step, run_src_color_space, (T**)dst_data, dst_step, counter);
+      break;
+    default:
+      ret = IM_ERR_DATA;
+      break;
+    }
 
-  switch(dst_color_space)
-  {
-  case IM_GRAY: 
-    ret = iDoConvert2Gray(count, data_type, src_data, src_color_space, dst_data, counter);
-    break;
-  case IM_RGB: 
-    ret = iDoConvert2RGB(count, data_type, src_data, src_color_space, dst_data, counter);
-    break;
-  case IM_YCBCR: 
-    ret = iDoConvert2YCbCr(count, data_type, src_data, src_color_space, dst_data, counter); 
-    break;
-  case IM_XYZ: 
-    ret = iDoConvert2XYZ(count, data_type, src_data, src_color_space, dst_data, counter);
-    break;
-  case IM_LAB: 
-    ret = iDoConvert2Lab(count, data_type, src_data, src_color_space, dst_data, counter);
-    break;
-  case IM_LUV: 
-    ret = iDoConvert2Luv(count, data_type, src_data, src_color_space, dst_data, counter);
-    break;
-  default:
-    ret = IM_ERR_DATA;
-    break;
+    if (ret != IM_ERR_NONE) 
+      break;
   }
 
 #ifdef IM_PROCESS
   imProcessCounterEnd(counter);
 #else
   imCounterEnd(counter);
+  imProfileEnd();
 #endif
 
   return ret;
 }
 
-static int iConvertColorSpace(const imImage* src_image, imImage* dst_image)
+static int iConvertColorSpace(const imImage* src_image, imImage* dst_image, int single)
 {
   switch(src_image->data_type)
   {
   case IM_BYTE:
-    return iDoConvertColorSpace(src_image->count, src_image->data_type,
-                         (const imbyte**)src_image->data, src_image->color_space, 
-                               (imbyte**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<imbyte>(src_image, dst_image, single);
   case IM_SHORT:
-    return iDoConvertColorSpace(src_image->count, src_image->data_type, 
-                         (const short**)src_image->data, src_image->color_space, 
-                               (short**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<short>(src_image, dst_image, single);
   case IM_USHORT:
-    return iDoConvertColorSpace(src_image->count, src_image->data_type, 
-                         (const imushort**)src_image->data, src_image->color_space, 
-                               (imushort**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<imushort>(src_image, dst_image, single);
   case IM_INT:
-    return iDoConvertColorSpace(src_image->count, src_image->data_type,
-                         (const int**)src_image->data, src_image->color_space, 
-                               (int**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<int>(src_image, dst_image, single);
   case IM_FLOAT:
-    return iDoConvertColorSpace(src_image->count, src_image->data_type, 
-                         (const float**)src_image->data, src_image->color_space, 
-                               (float**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<float>(src_image, dst_image, single);
   case IM_CFLOAT:
     /* treat complex as two real values */
-    return iDoConvertColorSpace(2*src_image->count, src_image->data_type,
-                         (const float**)src_image->data, src_image->color_space, 
-                               (float**)dst_image->data, dst_image->color_space);
+    return iDoConvertColorSpace<float>(src_image, dst_image, single);
   }
 
   return IM_ERR_DATA;
 }
 
-#ifdef IM_PROCESS
-int imProcessConvertColorSpace(const imImage* src_image, imImage* dst_image)
-#else
-int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
-#endif
+static int iConvertImageColorSpace(const imImage* src_image, imImage* dst_image)
 {
   int ret = IM_ERR_NONE;
-  assert(src_image);
-  assert(dst_image);
-
-  if (!imImageMatchDataType(src_image, dst_image))
-    return IM_ERR_DATA;
+  int single = imImageIsContiguous(src_image) && imImageIsContiguous(dst_image);
 
   if (src_image->color_space != dst_image->color_space)
   {
@@ -1060,24 +1221,24 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       switch(src_image->color_space)
       {
       case IM_BINARY:
-          memcpy(dst_image->data[0], src_image->data[0], dst_image->plane_size);
-          iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 255);
-          memcpy(dst_image->data[1], dst_image->data[0], dst_image->plane_size);
-          memcpy(dst_image->data[2], dst_image->data[0], dst_image->plane_size);
+          iConvertCopyPlane(src_image, 0, dst_image, 0, single);
+          iConvertBinary(dst_image, single, 255);
+          iConvertCopyPlane(dst_image, 0, dst_image, 1, single);
+          iConvertCopyPlane(dst_image, 0, dst_image, 2, single);
         ret = IM_ERR_NONE;
         break;
       case IM_MAP:
-        iConvertMapToRGB((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], (imbyte*)dst_image->data[1], (imbyte*)dst_image->data[2], dst_image->count, src_image->palette, src_image->palette_count);
+        iConvertMapToRGB(src_image, dst_image, single);
         ret = IM_ERR_NONE;
         break;
       case IM_GRAY:
-          memcpy(dst_image->data[0], src_image->data[0], dst_image->plane_size);
-          memcpy(dst_image->data[1], src_image->data[0], dst_image->plane_size);
-          memcpy(dst_image->data[2], src_image->data[0], dst_image->plane_size);
+          iConvertCopyPlane(src_image, 0, dst_image, 0, single);
+          iConvertCopyPlane(src_image, 0, dst_image, 1, single);
+          iConvertCopyPlane(src_image, 0, dst_image, 2, single);
         ret = IM_ERR_NONE;
         break;
       default: 
-        ret = iConvertColorSpace(src_image, dst_image);
+        ret = iConvertColorSpace(src_image, dst_image, single);
         break;
       }
       break;
@@ -1085,20 +1246,20 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       switch(src_image->color_space)
       {
       case IM_BINARY:
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->size);
-        iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 255);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
+        iConvertBinary(dst_image, single, 255);
         ret = IM_ERR_NONE;
         break;
       case IM_MAP:
-        iConvertMap2Gray((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], dst_image->count, src_image->palette, src_image->palette_count);
+        iConvertMap2Gray(src_image, dst_image, single);
         ret = IM_ERR_NONE;
         break;
       case IM_YCBCR: 
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->plane_size);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
         ret = IM_ERR_NONE;
         break;
       default:
-        ret = iConvertColorSpace(src_image, dst_image);
+        ret = iConvertColorSpace(src_image, dst_image, single);
         break;
       }
       break;
@@ -1107,12 +1268,13 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       {
       case IM_BINARY: // no break, same procedure as gray
       case IM_GRAY:
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->size);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
         dst_image->palette_count = src_image->palette_count;
         memcpy(dst_image->palette, src_image->palette, dst_image->palette_count*sizeof(long));
         ret = IM_ERR_NONE;
         break;
       case IM_RGB:
+        // the images are contiguous, see imConvertColorSpace
         dst_image->palette_count = 256;
         ret = imConvertRGB2Map(src_image->width, src_image->height, 
                                (imbyte*)src_image->data[0], (imbyte*)src_image->data[1], (imbyte*)src_image->data[2], 
@@ -1127,26 +1289,26 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       switch(src_image->color_space)
       {
       case IM_GRAY:
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->size);
-        iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 1);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
+        iConvertBinary(dst_image, single, 1);
         ret = IM_ERR_NONE;
         break;
       case IM_MAP:           // convert to gray, then convert to binary
-        iConvertMap2Gray((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], dst_image->count, src_image->palette, src_image->palette_count);
-        iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 1);
+        iConvertMap2Gray(src_image, dst_image, single);
+        iConvertBinary(dst_image, single, 1);
         ret = IM_ERR_NONE;
         break;
       case IM_YCBCR:         // convert to gray, then convert to binary
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->plane_size);
-        iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 1);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
+        iConvertBinary(dst_image, single, 1);
         ret = IM_ERR_NONE;
         break;
       default:               // convert to gray, then convert to binary
         dst_image->color_space = IM_GRAY;
-        ret = iConvertColorSpace(src_image, dst_image);
+        ret = iConvertColorSpace(src_image, dst_image, single);
         dst_image->color_space = IM_BINARY;
         if (ret == IM_ERR_NONE)
-          iConvertBinary((imbyte*)dst_image->data[0], dst_image->count, 1);
+          iConvertBinary(dst_image, single, 1);
         ret = IM_ERR_NONE;
         break;
       }
@@ -1155,31 +1317,31 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       switch(src_image->color_space)
       {
       case IM_GRAY:
-        memcpy(dst_image->data[0], src_image->data[0], dst_image->plane_size);
+        iConvertCopyPlane(src_image, 0, dst_image, 0, single);
         ret = IM_ERR_NONE;
         break;
       default:
-        ret = iConvertColorSpace(src_image, dst_image);
+        ret = iConvertColorSpace(src_image, dst_image, single);
         break;
       }
       break;
     default: 
-      ret = iConvertColorSpace(src_image, dst_image);
+      ret = iConvertColorSpace(src_image, dst_image, single);
       break;
     }
   }
 
   if (src_image->has_alpha && dst_image->has_alpha)
-    memcpy(dst_image->data[dst_image->depth], src_image->data[src_image->depth], src_image->plane_size);
+    iConvertCopyPlane(src_image, src_image->depth, dst_image, dst_image->depth, single);
   else if (dst_image->color_space == IM_RGB && dst_image->data_type == IM_BYTE && dst_image->has_alpha)
   {
     if (src_image->color_space == IM_RGB)
     {
       imbyte* transp_color = (imbyte*)imImageGetAttribute(src_image, "TransparencyColor", NULL, NULL);
       if (transp_color)
-        iConvertSetTranspColor((imbyte**)dst_image->data, dst_image->count, *(transp_color+0), *(transp_color+1), *(transp_color+2));
+        iConvertSetTranspColor(dst_image, single, *(transp_color+0), *(transp_color+1), *(transp_color+2));
       else
-        memset(dst_image->data[3], 255, dst_image->count);
+        iConvertSetOpaque(dst_image, single);
     }
     else
     {
@@ -1187,14 +1349,41 @@ int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
       imbyte* transp_index = (imbyte*)imImageGetAttribute(src_image, "TransparencyIndex", NULL, NULL);
       imbyte* transp_map = (imbyte*)imImageGetAttribute(src_image, "TransparencyMap", NULL, &transp_count);
       if (transp_map)
-        iConvertSetTranspMap((imbyte*)src_image->data[0], (imbyte*)dst_image->data[3], dst_image->count, transp_map, transp_count);
+        iConvertSetTranspMap(src_image, dst_image, single, transp_map, transp_count);
       else if (transp_index)
-        iConvertSetTranspIndex((imbyte*)src_image->data[0], (imbyte*)dst_image->data[3], dst_image->count, *transp_index);
+        iConvertSetTranspIndex(src_image, dst_image, single, *transp_index);
       else
-        memset(dst_image->data[3], 255, dst_image->count);
+        iConvertSetOpaque(dst_image, single);
     }
   }
 
   return ret;
 }
 
+#ifdef IM_PROCESS
+int imProcessConvertColorSpace(const imImage* src_image, imImage* dst_image)
+#else
+int imConvertColorSpace(const imImage* src_image, imImage* dst_image)
+#endif
+{
+  assert(src_image);
+  assert(dst_image);
+
+  if (!imImageMatchDataType(src_image, dst_image))
+    return IM_ERR_DATA;
+
+  if (!imImageMakeWritable(dst_image))
+    return IM_ERR_MEM;
+
+  // packed complex images and RGB to Map are converted using contiguous planar copies
+  if ((src_image->data_type == IM_CFLOAT && !imProcessIsPlanar(src_image, dst_image)) ||
+      (src_image->color_space == IM_RGB && dst_image->color_space == IM_MAP && !imProcessIsContiguous(src_image, dst_image)))
+  {
+    imProcessContiguous contiguous_src(src_image), contiguous_dst(dst_image, 1);
+    if (contiguous_src.Failed() || contiguous_dst.Failed())
+      return IM_ERR_MEM;
+    return iConvertImageColorSpace(contiguous_src, contiguous_dst);
+  }
+
+  return iConvertImageColorSpace(src_image, dst_image);
+}
@@ -11,8 +11,11 @@
 #include <im_math_op.h>
 #include <im_image.h>
 #include <im_kernel.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
+#include "im_process_run.h"
 #include "im_process_loc.h"
 #include "im_process_pnt.h"
 
@@ -203,6 +206,10 @@ static void iKernelRotate(KT* kernel_map, int kernel_size)
 
 void imProcessRotateKernel(imImage* kernel)
 {
+  imImageMakeWritable(kernel);
+  if (!imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessRotateKernel, kernel);
+
   if (kernel->data_type == IM_INT)
     iKernelRotate((int*)kernel->data[0], kernel->width);
   else
@@ -210,7 +217,7 @@ void imProcessRotateKernel(imImage* kernel)
 }
 
 template <class T, class KT, class CT> 
-static int DoCompassConvolve(T* map, T* new_map, int width, int height, KT* orig_kernel_map, int kernel_size, int counter, CT)
+static int DoCompassConvolve(T* map, T* new_map, int width, int height, int stride, int new_stride, KT* orig_kernel_map, int kernel_size, int counter, CT)
 {
   KT total, *kernel_line;
 
@@ -235,7 +242,7 @@ static int DoCompassConvolve(T* map, T* new_map, int width, int height, KT* orig
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -252,11 +259,11 @@ static int DoCompassConvolve(T* map, T* new_map, int width, int height, KT* orig
           kernel_line = kernel_map + (y+ks2)*kernel_size;
 
           if (j + y < 0)             // pass the bottom border
-            offset = -(y + j + 1) * width;
+            offset = -(y + j + 1) * stride;
           else if (j + y >= height)  // pass the top border
-            offset = (2*height - 1 - (j + y)) * width;
+            offset = (2*height - 1 - (j + y)) * stride;
           else
-            offset = (j + y) * width;
+            offset = (j + y) * stride;
 
           for(int x = -ks2; x <= ks2; x++)
           {
@@ -297,9 +304,18 @@ static int DoCompassConvolve(T* map, T* new_map, int width, int height, KT* orig
 
 int imProcessCompassConvolve(const imImage* src_image, imImage* dst_image, imImage *kernel)
 {
+  imImageMakeWritable(dst_image);
+  imImageMakeWritable(kernel);
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessCompassConvolve, src_image, dst_image, kernel);
+
   int ret = 0;
+  int type_size = imDataTypeSize(src_image->data_type);
+  int src_stride = src_image->line_stride / type_size;
+  int dst_stride = dst_image->line_stride / type_size;
 
   int counter = imProcessCounterBegin("Compass Convolution");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* msg = (const char*)imImageGetAttribute(kernel, "Description", NULL, NULL);
   if (!msg) msg = "Filtering...";
   imCounterTotal(counter, src_image->depth*src_image->height, msg);
@@ -310,33 +326,33 @@ int imProcessCompassConvolve(const imImage* src_image, imImage* dst_image, imIma
     {
     case IM_BYTE:
       if (kernel->data_type == IM_INT)
-        ret = DoCompassConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, counter, (int)0);
+        ret = DoCompassConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, counter, (int)0);
       else
-        ret = DoCompassConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, counter, (float)0);
       break;                                                                                
     case IM_SHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoCompassConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, counter, (int)0);
+        ret = DoCompassConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, counter, (int)0);
       else
-        ret = DoCompassConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, counter, (float)0);
       break;                                                                                
     case IM_USHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoCompassConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, counter, (int)0);
+        ret = DoCompassConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, counter, (int)0);
       else
-        ret = DoCompassConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, counter, (float)0);
       break;                                                                                
     case IM_INT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoCompassConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, counter, (int)0);
+        ret = DoCompassConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, counter, (int)0);
       else
-        ret = DoCompassConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, counter, (float)0);
       break;                                                                                
     case IM_FLOAT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoCompassConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, counter, (float)0);
       else
-        ret = DoCompassConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, counter, (float)0);
+        ret = DoCompassConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, counter, (float)0);
       break;                                                                                
     }
     
@@ -350,7 +366,7 @@ int imProcessCompassConvolve(const imImage* src_image, imImage* dst_image, imIma
 }
 
 template <class T, class KT, class CT> 
-static int DoConvolveDual(T* map, T* new_map, int width, int height, KT* kernel_map1, KT* kernel_map2, int kernel_width, int kernel_height, int counter, CT)
+static int DoConvolveDual(T* map, T* new_map, int width, int height, int stride, int new_stride, KT* kernel_map1, KT* kernel_map2, int kernel_width, int kernel_height, int counter, CT)
 {
   KT total1, total2, *kernel_line;
 
@@ -375,7 +391,7 @@ static int DoConvolveDual(T* map, T* new_map, int width, int height, KT* kernel_
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -387,11 +403,11 @@ static int DoConvolveDual(T* map, T* new_map, int width, int height, KT* kernel_
         int offset, x;
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         kernel_line = kernel_map1 + (y+kh2)*kernel_width;
         for(x = -kw2; x <= kw2; x++)
@@ -439,7 +455,7 @@ static int DoConvolveDual(T* map, T* new_map, int width, int height, KT* kernel_
 }
 
 template <class KT> 
-static int DoConvolveDualCpx(imcfloat* map, imcfloat* new_map, int width, int height, KT* kernel_map1, KT* kernel_map2, int kernel_width, int kernel_height, int counter)
+static int DoConvolveDualCpx(imcfloat* map, imcfloat* new_map, int width, int height, int stride, int new_stride, KT* kernel_map1, KT* kernel_map2, int kernel_width, int kernel_height, int counter)
 {
   KT total1, total2, *kernel_line;
 
@@ -464,7 +480,7 @@ static int DoConvolveDualCpx(imcfloat* map, imcfloat* new_map, int width, int he
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -476,11 +492,11 @@ static int DoConvolveDualCpx(imcfloat* map, imcfloat* new_map, int width, int he
         int offset, x;
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         kernel_line = kernel_map1 + (y+kh2)*kernel_width;
         for(x = -kw2; x <= kw2; x++)
@@ -523,12 +539,20 @@ static int DoConvolveDualCpx(imcfloat* map, imcfloat* new_map, int width, int he
 
 int imProcessConvolveDual(const imImage* src_image, imImage* dst_image, const imImage *kernel1, const imImage *kernel2)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel1, kernel2))
+    return imProcessContiguousCall(imProcessConvolveDual, src_image, dst_image, kernel1, kernel2);
+
   int counter = imProcessCounterBegin("Convolution");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* msg = (const char*)imImageGetAttribute(kernel1, "Description", NULL, NULL);
   if (!msg) msg = "Filtering...";
   imCounterTotal(counter, src_image->depth*src_image->height, msg);
 
   int ret = 0;
+  int type_size = imDataTypeSize(src_image->data_type);
+  int src_stride = src_image->line_stride / type_size;
+  int dst_stride = dst_image->line_stride / type_size;
 
   for (int i = 0; i < src_image->depth; i++)
   {
@@ -536,39 +560,39 @@ int imProcessConvolveDual(const imImage* src_image, imImage* dst_image, const im
     {
     case IM_BYTE:
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDual((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
+        ret = DoConvolveDual((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
       else
-        ret = DoConvolveDual((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       break;                                                                                
     case IM_SHORT:                                                                           
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDual((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
+        ret = DoConvolveDual((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
       else
-        ret = DoConvolveDual((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       break;                                                                                
     case IM_USHORT:                                                                           
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDual((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
+        ret = DoConvolveDual((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
       else
-        ret = DoConvolveDual((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       break;                                                                                
     case IM_INT:                                                                           
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDual((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
+        ret = DoConvolveDual((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (int)0);
       else
-        ret = DoConvolveDual((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       break;                                                                                
     case IM_FLOAT:                                                                           
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDual((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       else
-        ret = DoConvolveDual((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
+        ret = DoConvolveDual((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter, (float)0);
       break;                                                                                
     case IM_CFLOAT:            
       if (kernel1->data_type == IM_INT)
-        ret = DoConvolveDualCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter);
+        ret = DoConvolveDualCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel1->data[0], (int*)kernel2->data[0], kernel1->width, kernel1->height, counter);
       else
-        ret = DoConvolveDualCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter);
+        ret = DoConvolveDualCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel1->data[0], (float*)kernel2->data[0], kernel1->width, kernel1->height, counter);
       break;
     }
     
@@ -582,7 +606,7 @@ int imProcessConvolveDual(const imImage* src_image, imImage* dst_image, const im
 }
 
 template <class T, class KT, class CT> 
-static int DoConvolve(T* map, T* new_map, int width, int height, KT* kernel_map, int kernel_width, int kernel_height, int counter, CT)
+static int DoConvolve(T* map, T* new_map, int width, int height, int stride, int new_stride, KT* kernel_map, int kernel_width, int kernel_height, int counter, CT)
 {
   KT total, *kernel_line;
 
@@ -606,7 +630,7 @@ static int DoConvolve(T* map, T* new_map, int width, int height, KT* kernel_map,
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -619,11 +643,11 @@ static int DoConvolve(T* map, T* new_map, int width, int height, KT* kernel_map,
         kernel_line = kernel_map + (y+kh2)*kernel_width;
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         for(int x = -kw2; x <= kw2; x++)
         {
@@ -656,7 +680,7 @@ static int DoConvolve(T* map, T* new_map, int width, int height, KT* kernel_map,
 }
 
 template <class KT> 
-static int DoConvolveCpx(imcfloat* map, imcfloat* new_map, int width, int height, KT* kernel_map, int kernel_width, int kernel_height, int counter)
+static int DoConvolveCpx(imcfloat* map, imcfloat* new_map, int width, int height, int stride, int new_stride, KT* kernel_map, int kernel_width, int kernel_height, int counter)
 {
   KT total, *kernel_line;
 
@@ -680,7 +704,7 @@ static int DoConvolveCpx(imcfloat* map, imcfloat* new_map, int width, int height
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -693,11 +717,11 @@ static int DoConvolveCpx(imcfloat* map, imcfloat* new_map, int width, int height
         kernel_line = kernel_map + (y+kh2)*kernel_width;
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         for(int x = -kw2; x <= kw2; x++)
         {
@@ -729,45 +753,50 @@ static int DoConvolveStep(const imImage* src_image, imImage* dst_image, const im
 {
   int ret = 0;
 
+  /* rows are addressed by the line stride, so sub-image views are processed in place */
+  int type_size = imDataTypeSize(src_image->data_type);
+  int src_stride = src_image->line_stride / type_size;
+  int dst_stride = dst_image->line_stride / type_size;
+
   for (int i = 0; i < src_image->depth; i++)
   {
     switch(src_image->data_type)
     {
     case IM_BYTE:
       if (kernel->data_type == IM_INT)
-        ret = DoConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_SHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_USHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_INT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_FLOAT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       else
-        ret = DoConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolve((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_CFLOAT:            
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter);
+        ret = DoConvolveCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter);
       else
-        ret = DoConvolveCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter);
+        ret = DoConvolveCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter);
       break;
     }
     
@@ -780,7 +809,13 @@ static int DoConvolveStep(const imImage* src_image, imImage* dst_image, const im
 
 int imProcessConvolve(const imImage* src_image, imImage* dst_image, const imImage *kernel)
 {
+  imImageMakeWritable(dst_image);
+  /* the images can have padded lines, but can not be packed */
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessConvolve, src_image, dst_image, kernel);
+
   int counter = imProcessCounterBegin("Convolution");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* msg = (const char*)imImageGetAttribute(kernel, "Description", NULL, NULL);
   if (!msg) msg = "Filtering...";
   imCounterTotal(counter, src_image->depth*src_image->height, msg);
@@ -794,6 +829,10 @@ int imProcessConvolve(const imImage* src_image, imImage* dst_image, const imImag
 
 int imProcessConvolveRep(const imImage* src_image, imImage* dst_image, const imImage *kernel, int ntimes)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessConvolveRep, src_image, dst_image, kernel, ntimes);
+
   imImage *AuxImage = imImageClone(dst_image);
   if (!AuxImage)
     return 0;
@@ -823,12 +862,18 @@ int imProcessConvolveRep(const imImage* src_image, imImage* dst_image, const imI
       image2 = dst_image;
   }
 
-  // The result is in image1, if in the Aux swap the data
+  // The result is in image1, if in the Aux swap the data,
+  // padded images must keep their own buffer
   if (image1 == AuxImage)
   {
-    void** temp = (void**)dst_image->data;
-    dst_image->data = AuxImage->data;
-    AuxImage->data = (void**)temp;
+    if (imImageIsContiguous(dst_image) && !dst_image->shared)
+    {
+      void** temp = (void**)dst_image->data;
+      dst_image->data = AuxImage->data;
+      AuxImage->data = (void**)temp;
+    }
+    else
+      imImageCopyData(AuxImage, dst_image);
   }
 
   imProcessCounterEnd(counter);
@@ -838,7 +883,7 @@ int imProcessConvolveRep(const imImage* src_image, imImage* dst_image, const imI
 }
 
 template <class T, class KT, class CT> 
-static int DoConvolveSep(T* map, T* new_map, int width, int height, KT* kernel_map, int kernel_width, int kernel_height, int counter, CT)
+static int DoConvolveSep(T* map, T* new_map, int width, int height, int stride, int new_stride, KT* kernel_map, int kernel_width, int kernel_height, int counter, CT)
 {
   KT totalH, totalW, *kernel_line;
   T* aux_line;
@@ -868,7 +913,7 @@ static int DoConvolveSep(T* map, T* new_map, int width, int height, KT* kernel_m
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -883,11 +928,11 @@ static int DoConvolveSep(T* map, T* new_map, int width, int height, KT* kernel_m
         kernel_line = kernel_map + (y+kh2)*kernel_width;  // Use only the first column
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         if (offset != -1)
           value += kernel_line[0] * map[offset + i];
@@ -925,7 +970,7 @@ static int DoConvolveSep(T* map, T* new_map, int width, int height, KT* kernel_m
 #endif
     IM_BEGIN_PROCESSING;
 
-    int offset = j * width;
+    int offset = j * new_stride;
     int new_offset = offset;
 
     for(int i = 0; i < width; i++)
@@ -970,7 +1015,7 @@ static int DoConvolveSep(T* map, T* new_map, int width, int height, KT* kernel_m
 
 
 template <class KT> 
-static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int height, KT* kernel_map, int kernel_width, int kernel_height, int counter)
+static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int height, int stride, int new_stride, KT* kernel_map, int kernel_width, int kernel_height, int counter)
 {
   KT totalH, totalW, *kernel_line;
   imcfloat* aux_line;
@@ -1000,7 +1045,7 @@ static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int hei
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
 
     for(int i = 0; i < width; i++)
     {
@@ -1015,11 +1060,11 @@ static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int hei
         kernel_line = kernel_map + (y+kh2)*kernel_width;
 
         if (j + y < 0)             // pass the bottom border
-          offset = -(y + j + 1) * width;
+          offset = -(y + j + 1) * stride;
         else if (j + y >= height)  // pass the top border
-          offset = (2*height - 1 - (j + y)) * width;
+          offset = (2*height - 1 - (j + y)) * stride;
         else
-          offset = (j + y) * width;
+          offset = (j + y) * stride;
 
         if (offset != -1)
           value += map[offset + i] * (float)kernel_line[0];
@@ -1053,7 +1098,7 @@ static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int hei
 #endif
     IM_BEGIN_PROCESSING;
 
-    int offset = j * width;
+    int offset = j * new_stride;
     int new_offset = offset;
 
     for(int i = 0; i < width; i++)
@@ -1095,12 +1140,20 @@ static int DoConvolveSepCpx(imcfloat* map, imcfloat* new_map, int width, int hei
 
 int imProcessConvolveSep(const imImage* src_image, imImage* dst_image, const imImage *kernel)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessConvolveSep, src_image, dst_image, kernel);
+
   int counter = imProcessCounterBegin("Separable Convolution");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* msg = (const char*)imImageGetAttribute(kernel, "Description", NULL, NULL);
   if (!msg) msg = "Filtering...";
   imCounterTotal(counter, 2*src_image->depth*src_image->height, msg);
 
   int ret = 0;
+  int type_size = imDataTypeSize(src_image->data_type);
+  int src_stride = src_image->line_stride / type_size;
+  int dst_stride = dst_image->line_stride / type_size;
 
   for (int i = 0; i < src_image->depth; i++)
   {
@@ -1108,39 +1161,39 @@ int imProcessConvolveSep(const imImage* src_image, imImage* dst_image, const imI
     {
     case IM_BYTE:
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSep((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolveSep((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolveSep((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_SHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSep((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolveSep((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolveSep((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((short*)src_image->data[i], (short*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_USHORT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSep((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolveSep((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolveSep((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((imushort*)src_image->data[i], (imushort*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_INT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSep((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
+        ret = DoConvolveSep((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (int)0);
       else
-        ret = DoConvolveSep((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_FLOAT:                                                                           
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSep((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       else
-        ret = DoConvolveSep((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
+        ret = DoConvolveSep((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter, (float)0);
       break;                                                                                
     case IM_CFLOAT:            
       if (kernel->data_type == IM_INT)
-        ret = DoConvolveSepCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (int*)kernel->data[0], kernel->width, kernel->height, counter);
+        ret = DoConvolveSepCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (int*)kernel->data[0], kernel->width, kernel->height, counter);
       else
-        ret = DoConvolveSepCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, (float*)kernel->data[0], kernel->width, kernel->height, counter);
+        ret = DoConvolveSepCpx((imcfloat*)src_image->data[i], (imcfloat*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, (float*)kernel->data[0], kernel->width, kernel->height, counter);
       break;
     }
     
@@ -1176,16 +1229,17 @@ Image processing lab, Department of Informatics
 University of Oslo
 */
 template <class T> 
-static void do_crossing(T* iband, T* oband, int width, int height, T t)
+static void do_crossing(T* iband, T* oband, int width, int height, int stride, int new_stride, T t)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
   for (int y=0; y < height-1; y++)
   {
-    int offset00 = y*width;
-    int offset10 = (y+1)*width;
+    int offset00 = y*stride;
+    int offset10 = (y+1)*stride;
     int offset01 = offset00 + 1;
+    int new_offset = y*new_stride;
 
     for (int x=0; x < width-1; x++)
     {
@@ -1214,17 +1268,15 @@ static void do_crossing(T* iband, T* oband, int width, int height, T t)
         }
       }
 
-      oband[offset00] = v;
+      oband[new_offset] = v;
 
       offset00++;
       offset10++;
       offset01++;
+      new_offset++;
     }
 
     /* last pixel on line */
-    offset00++;
-    offset10++;
-
     T v = 0;
 
     if (iband[offset00] <= t)
@@ -1238,12 +1290,13 @@ static void do_crossing(T* iband, T* oband, int width, int height, T t)
         v = iband[offset00]-iband[offset10];
     }
 
-    oband[offset00] = v;
+    oband[new_offset] = v;
   }
 
   /* last line */
-  int offset00 = (height-1)*width;
+  int offset00 = (height-1)*stride;
   int offset01 = offset00 + 1;
+  int new_offset = (height-1)*new_stride;
 
   for (int x=0; x < width-1; x++)
   {
@@ -1260,29 +1313,36 @@ static void do_crossing(T* iband, T* oband, int width, int height, T t)
         v = iband[offset00]-iband[offset01];
     }
 
-    oband[offset00] = v;
+    oband[new_offset] = v;
 
     offset00++;
     offset01++;
+    new_offset++;
   }
 
-  offset00++;
-
   /* last pixel */
-  oband[offset00] = 0;
+  oband[new_offset] = 0;
 }
 
 void imProcessZeroCrossing(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessZeroCrossing, src_image, dst_image);
+
+  int type_size = imDataTypeSize(src_image->data_type);
+  int src_stride = src_image->line_stride / type_size;
+  int dst_stride = dst_image->line_stride / type_size;
+
   for (int i = 0; i < src_image->depth; i++)
   {
     switch(src_image->data_type)
     {
     case IM_INT:                                                                           
-      do_crossing((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, 0);
+      do_crossing((int*)src_image->data[i], (int*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, 0);
       break;                                                                                
     case IM_FLOAT:                                                                           
-      do_crossing((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, 0.0f);
+      do_crossing((float*)src_image->data[i], (float*)dst_image->data[i], src_image->width, src_image->height, src_stride, dst_stride, 0.0f);
       break;                                                                                
     }
   }
@@ -1290,6 +1350,8 @@ void imProcessZeroCrossing(const imImage* src_image, imImage* dst_image)
 
 int imProcessBarlettConvolve(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_INT);
   if (!kernel)
     return 0;
@@ -1323,6 +1385,8 @@ int imProcessBarlettConvolve(const imImage* src_image, imImage* dst_image, int k
 
 int imProcessSobelConvolve(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
 	int ret = 0;
 
   imImage* kernel1 = imKernelSobel();
@@ -1339,6 +1403,8 @@ int imProcessSobelConvolve(const imImage* src_image, imImage* dst_image)
 
 int imProcessPrewittConvolve(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
 	int ret = 0;
 
   imImage* kernel1 = imKernelPrewitt();
@@ -1355,6 +1421,10 @@ int imProcessPrewittConvolve(const imImage* src_image, imImage* dst_image)
 
 int imProcessSplineEdgeConvolve(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessSplineEdgeConvolve, src_image, dst_image);
+
 	int ret = 0;
 
   imImage* tmp_image = imImageClone(src_image);
@@ -1413,6 +1483,8 @@ float imGaussianKernelSize2StdDev(int kernel_size)
 
 int imProcessGaussianConvolve(const imImage* src_image, imImage* dst_image, float stddev)
 {
+  imImageMakeWritable(dst_image);
+
   int kernel_size = imGaussianStdDev2KernelSize(stddev);
 
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_FLOAT);
@@ -1431,6 +1503,10 @@ int imProcessGaussianConvolve(const imImage* src_image, imImage* dst_image, floa
 
 int imProcessLapOfGaussianConvolve(const imImage* src_image, imImage* dst_image, float stddev)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessLapOfGaussianConvolve, src_image, dst_image, stddev);
+
   int kernel_size = imGaussianStdDev2KernelSize(stddev);
 
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_FLOAT);
@@ -1465,6 +1541,10 @@ int imProcessLapOfGaussianConvolve(const imImage* src_image, imImage* dst_image,
 
 int imProcessDiffOfGaussianConvolve(const imImage* src_image, imImage* dst_image, float stddev1, float stddev2)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessDiffOfGaussianConvolve, src_image, dst_image, stddev1, stddev2);
+
   imImage* aux_image1 = imImageClone(src_image);
   imImage* aux_image2 = imImageClone(src_image);
   if (!aux_image1 || !aux_image2)
@@ -1517,7 +1597,12 @@ int imProcessDiffOfGaussianConvolve(const imImage* src_image, imImage* dst_image
 
 int imProcessMeanConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessMeanConvolve, src_image, dst_image, ks);
+
   int counter = imProcessCounterBegin("Mean Convolve");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
 
   imImage* kernel = imImageCreate(ks, ks, IM_GRAY, IM_INT);
@@ -1548,60 +1633,89 @@ int imProcessMeanConvolve(const imImage* src_image, imImage* dst_image, int ks)
 }
 
 template <class T1, class T2> 
-static void DoSharpOp(T1 *src_map, T1 *dst_map, int count, float amount, T2 threshold, int gauss)
+static void DoSharpOp(const imImage* src_image, imImage* dst_image, int plane, float amount, T2 threshold, int gauss)
 {
   T1 min, max;
+  int width = src_image->width;
+  int height = src_image->height;
 
-  // min,max values used only for cropping
-  imMinMaxType(src_map, count, min, max);
+  // min,max values used only for cropping, same as imMinMaxType for all the lines
+  if (sizeof(T1) == sizeof(imbyte))
+  {
+    min = 0;
+    max = (T1)255;
+  }
+  else
+  {
+    imMinMax((T1*)imProcessLineData(src_image, plane, 0), width, min, max);
+    for (int y = 1; y < height; y++)
+    {
+      T1 line_min, line_max;
+      imMinMax((T1*)imProcessLineData(src_image, plane, y), width, line_min, line_max);
+      if (line_min < min) min = line_min;
+      if (line_max > max) max = line_max;
+    }
+
+    if (min == max)
+    {
+      max = min + 1;
+
+      if (min != 0)
+        min = min - 1;
+    }
+  }
 
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
-  for (int i = 0; i < count; i++)
+  for (int y = 0; y < height; y++)
   {
-    T2 diff;
-    
-    if (gauss)
-      diff = 20*(src_map[i] - dst_map[i]);  /* dst_map contains a gaussian filter of the source image, must compensate for small edge values */
-    else
-      diff = dst_map[i];  /* dst_map contains a laplacian filter of the source image */
+    T1* src_map = (T1*)imProcessLineData(src_image, plane, y);
+    T1* dst_map = (T1*)imProcessLineData(dst_image, plane, y);
+
+    for (int i = 0; i < width; i++)
+    {
+      T2 diff;
+      
+      if (gauss)
+        diff = 20*(src_map[i] - dst_map[i]);  /* dst_map contains a gaussian filter of the source image, must compensate for small edge values */
+      else
+        diff = dst_map[i];  /* dst_map contains a laplacian filter of the source image */
 
-    if (threshold && abs_op(2*diff) < threshold)
-      diff = 0;
+      if (threshold && abs_op(2*diff) < threshold)
+        diff = 0;
 
-    T2 value = (T2)(src_map[i] + amount*diff);
-    if (value < min) // keep current min,max range
-      value = min;
-    else if (value > max)
-      value = max;
+      T2 value = (T2)(src_map[i] + amount*diff);
+      if (value < min) // keep current min,max range
+        value = min;
+      else if (value > max)
+        value = max;
 
-    dst_map[i] = (T1)value;
+      dst_map[i] = (T1)value;
+    }
   }
 }
 
 static void doSharp(const imImage* src_image, imImage* dst_image, float amount, float threshold, int gauss)
 {
-  int count = src_image->count;
-
   for (int i = 0; i < src_image->depth; i++)
   {
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      DoSharpOp((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], count, amount, (int)threshold, gauss);
+      DoSharpOp<imbyte>(src_image, dst_image, i, amount, (int)threshold, gauss);
       break;
     case IM_SHORT:
-      DoSharpOp((short*)src_image->data[i], (short*)dst_image->data[i], count, amount, (int)threshold, gauss);
+      DoSharpOp<short>(src_image, dst_image, i, amount, (int)threshold, gauss);
       break;
     case IM_USHORT:
-      DoSharpOp((imushort*)src_image->data[i], (imushort*)dst_image->data[i], count, amount, (int)threshold, gauss);
+      DoSharpOp<imushort>(src_image, dst_image, i, amount, (int)threshold, gauss);
       break;
     case IM_INT:
-      DoSharpOp((int*)src_image->data[i], (int*)dst_image->data[i], count, amount, (int)threshold, gauss);
+      DoSharpOp<int>(src_image, dst_image, i, amount, (int)threshold, gauss);
       break;
     case IM_FLOAT:
-      DoSharpOp((float*)src_image->data[i], (float*)dst_image->data[i], count, amount, (float)threshold, gauss);
+      DoSharpOp<float>(src_image, dst_image, i, amount, (float)threshold, gauss);
       break;
     }
   }
@@ -1609,6 +1723,10 @@ static void doSharp(const imImage* src_image, imImage* dst_image, float amount,
 
 int imProcessUnsharp(const imImage* src_image, imImage* dst_image, float stddev, float amount, float threshold)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessUnsharp, src_image, dst_image, stddev, amount, threshold);
+
   int kernel_size = imGaussianStdDev2KernelSize(stddev);
 
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_FLOAT);
@@ -1628,6 +1746,10 @@ int imProcessUnsharp(const imImage* src_image, imImage* dst_image, float stddev,
 
 int imProcessSharp(const imImage* src_image, imImage* dst_image, float amount, float threshold)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessSharp, src_image, dst_image, amount, threshold);
+
   imImage* kernel = imKernelLaplacian8();
   if (!kernel)
     return 0;
@@ -1665,6 +1787,10 @@ static int iProcessCheckKernelType(const imImage* kernel)
 
 int imProcessSharpKernel(const imImage* src_image, const imImage* kernel, imImage* dst_image, float amount, float threshold)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image) || !imProcessIsContiguous(kernel))
+    return imProcessContiguousCall(imProcessSharpKernel, src_image, kernel, dst_image, amount, threshold);
+
   int ret = imProcessConvolve(src_image, dst_image, kernel);
   doSharp(src_image, dst_image, amount, threshold, iProcessCheckKernelType(kernel));
   return ret;
@@ -8,8 +8,10 @@
 #include <im.h>
 #include <im_util.h>
 #include <im_math.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
 
 #include <stdlib.h>
@@ -20,7 +22,7 @@
 
 
 template <class T, class DT> 
-static int DoConvolveRankFunc(T *map, DT* new_map, int width, int height, int kw, int kh, T (*func)(T* value, int count, int center), int counter)
+static int DoConvolveRankFunc(T *map, DT* new_map, int width, int height, int stride, int new_stride, int kw, int kh, T (*func)(T* value, int count, int center), int counter)
 {
   int tcount = IM_MAX_THREADS;
   T* value = new T[kw*kh*tcount];
@@ -44,7 +46,7 @@ static int DoConvolveRankFunc(T *map, DT* new_map, int width, int height, int kw
 #endif
     IM_BEGIN_PROCESSING;
 
-    int new_offset = j * width;
+    int new_offset = j * new_stride;
     int toffset = IM_THREAD_NUM*(kw*kh);
 
     for(int i = 0; i < width; i++)
@@ -58,7 +60,7 @@ static int DoConvolveRankFunc(T *map, DT* new_map, int width, int height, int kw
             (j + y >= height))    // pass the top border
           continue;
 
-        int offset = (j + y) * width;
+        int offset = (j + y) * stride;
 
         for(int x = kw1; x <= kw2; x++)
         {
@@ -195,8 +197,14 @@ static float median_op_real(float* value, int count, int center)
 
 int imProcessMedianConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessMedianConvolve, src_image, dst_image, ks);
+
   int i, ret = 0;
   int counter;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
 
   counter = imProcessCounterBegin("Median Filter");
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
@@ -207,23 +215,23 @@ int imProcessMedianConvolve(const imImage* src_image, imImage* dst_image, int ks
     {
     case IM_BYTE:
       ret = DoConvolveRankFunc((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, median_op_byte, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, median_op_byte, counter);
       break;                                                                                
     case IM_SHORT:                                                                           
       ret = DoConvolveRankFunc((short*)src_image->data[i], (short*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, median_op_short, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, median_op_short, counter);
       break;                                                                                
     case IM_USHORT:                                                                           
       ret = DoConvolveRankFunc((imushort*)src_image->data[i], (imushort*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, median_op_ushort, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, median_op_ushort, counter);
       break;                                                                                
     case IM_INT:                                                                           
       ret = DoConvolveRankFunc((int*)src_image->data[i], (int*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, median_op_int, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, median_op_int, counter);
       break;                                                                                
     case IM_FLOAT:                                                                           
       ret = DoConvolveRankFunc((float*)src_image->data[i], (float*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, median_op_real, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, median_op_real, counter);
       break;                                                                                
     }
     
@@ -278,8 +286,14 @@ static float range_op_real(float* value, int count, int center)
 
 int imProcessRangeConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRangeConvolve, src_image, dst_image, ks);
+
   int i, ret = 0;
   int counter;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
 
   counter = imProcessCounterBegin("Range Filter");
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
@@ -290,23 +304,23 @@ int imProcessRangeConvolve(const imImage* src_image, imImage* dst_image, int ks)
     {
     case IM_BYTE:
       ret = DoConvolveRankFunc((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, range_op_byte, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, range_op_byte, counter);
       break;                                                                                
     case IM_SHORT:                                                                           
       ret = DoConvolveRankFunc((short*)src_image->data[i], (short*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, range_op_short, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, range_op_short, counter);
       break;                                                                                
     case IM_USHORT:                                                                           
       ret = DoConvolveRankFunc((imushort*)src_image->data[i], (imushort*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, range_op_ushort, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, range_op_ushort, counter);
       break;                                                                                
     case IM_INT:                                                                           
       ret = DoConvolveRankFunc((int*)src_image->data[i], (int*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, range_op_int, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, range_op_int, counter);
       break;                                                                                
     case IM_FLOAT:                                                                           
       ret = DoConvolveRankFunc((float*)src_image->data[i], (float*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, range_op_real, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, range_op_real, counter);
       break;                                                                                
     }
 
@@ -434,8 +448,15 @@ static int contrast_thres_op_int(int* value, int count, int center)
 
 int imProcessRangeContrastThreshold(const imImage* src_image, imImage* dst_image, int ks, int min_range)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRangeContrastThreshold, src_image, dst_image, ks, min_range);
+
   int ret = 0;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
   int counter = imProcessCounterBegin("Range Contrast Threshold");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
 
   thresAux = min_range;
@@ -444,19 +465,19 @@ int imProcessRangeContrastThreshold(const imImage* src_image, imImage* dst_image
   {
   case IM_BYTE:
     ret = DoConvolveRankFunc((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, contrast_thres_op_byte, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, contrast_thres_op_byte, counter);
     break;                                                                                
   case IM_SHORT:                                                                           
     ret = DoConvolveRankFunc((short*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, contrast_thres_op_short, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, contrast_thres_op_short, counter);
     break;                                                                                
   case IM_USHORT:                                                                           
     ret = DoConvolveRankFunc((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, contrast_thres_op_ushort, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, contrast_thres_op_ushort, counter);
     break;                                                                                
   case IM_INT:                                                                           
     ret = DoConvolveRankFunc((int*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, contrast_thres_op_int, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, contrast_thres_op_int, counter);
     break;                                                                                
   }
 
@@ -527,8 +548,15 @@ static int max_thres_op_int(int* value, int count, int center)
 
 int imProcessLocalMaxThreshold(const imImage* src_image, imImage* dst_image, int ks, int min_thres)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessLocalMaxThreshold, src_image, dst_image, ks, min_thres);
+
   int ret = 0;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
   int counter = imProcessCounterBegin("Local Max Threshold");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
 
   thresAux = min_thres;
@@ -537,19 +565,19 @@ int imProcessLocalMaxThreshold(const imImage* src_image, imImage* dst_image, int
   {
   case IM_BYTE:
     ret = DoConvolveRankFunc((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, max_thres_op_byte, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, max_thres_op_byte, counter);
     break;                                                                                
   case IM_SHORT:                                                                           
     ret = DoConvolveRankFunc((short*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, max_thres_op_short, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, max_thres_op_short, counter);
     break;                                                                                
   case IM_USHORT:                                                                           
     ret = DoConvolveRankFunc((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, max_thres_op_ushort, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, max_thres_op_ushort, counter);
     break;                                                                                
   case IM_INT:                                                                           
     ret = DoConvolveRankFunc((int*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->width, src_image->height, ks, ks, max_thres_op_int, counter);
+                             src_image->width, src_image->height, src_stride, dst_stride, ks, ks, max_thres_op_int, counter);
     break;                                                                                
   }
 
@@ -626,8 +654,14 @@ static float rank_closest_op_real(float* value, int count, int center)
 
 int imProcessRankClosestConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRankClosestConvolve, src_image, dst_image, ks);
+
   int i, ret = 0;
   int counter;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
 
   counter = imProcessCounterBegin("Rank Closest");
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
@@ -638,23 +672,23 @@ int imProcessRankClosestConvolve(const imImage* src_image, imImage* dst_image, i
     {
     case IM_BYTE:
       ret = DoConvolveRankFunc((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_closest_op_byte, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_closest_op_byte, counter);
       break;                                                                                
     case IM_SHORT:                                                                           
       ret = DoConvolveRankFunc((short*)src_image->data[i], (short*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_closest_op_short, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_closest_op_short, counter);
       break;                                                                                
     case IM_USHORT:                                                                           
       ret = DoConvolveRankFunc((imushort*)src_image->data[i], (imushort*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_closest_op_ushort, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_closest_op_ushort, counter);
       break;                                                                                
     case IM_INT:                                                                           
       ret = DoConvolveRankFunc((int*)src_image->data[i], (int*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_closest_op_int, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_closest_op_int, counter);
       break;                                                                                
     case IM_FLOAT:                                                                           
       ret = DoConvolveRankFunc((float*)src_image->data[i], (float*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_closest_op_real, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_closest_op_real, counter);
       break;                                                                                
     }
     
@@ -709,8 +743,14 @@ static float rank_max_op_real(float* value, int count, int center)
 
 int imProcessRankMaxConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRankMaxConvolve, src_image, dst_image, ks);
+
   int i, ret = 0;
   int counter;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
 
   counter = imProcessCounterBegin("Rank Max");
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
@@ -721,23 +761,23 @@ int imProcessRankMaxConvolve(const imImage* src_image, imImage* dst_image, int k
     {
     case IM_BYTE:
       ret = DoConvolveRankFunc((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_max_op_byte, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_max_op_byte, counter);
       break;                                                                                
     case IM_SHORT:                                                                           
       ret = DoConvolveRankFunc((short*)src_image->data[i], (short*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_max_op_short, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_max_op_short, counter);
       break;                                                                                
     case IM_USHORT:                                                                           
       ret = DoConvolveRankFunc((imushort*)src_image->data[i], (imushort*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_max_op_ushort, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_max_op_ushort, counter);
       break;                                                                                
     case IM_INT:                                                                           
       ret = DoConvolveRankFunc((int*)src_image->data[i], (int*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_max_op_int, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_max_op_int, counter);
       break;                                                                                
     case IM_FLOAT:                                                                           
       ret = DoConvolveRankFunc((float*)src_image->data[i], (float*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_max_op_real, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_max_op_real, counter);
       break;                                                                                
     }
     
@@ -792,8 +832,14 @@ static float rank_min_op_real(float* value, int count, int center)
 
 int imProcessRankMinConvolve(const imImage* src_image, imImage* dst_image, int ks)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsPlanar(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRankMinConvolve, src_image, dst_image, ks);
+
   int i, ret = 0;
   int counter;
+  int src_stride = src_image->line_stride / imDataTypeSize(src_image->data_type);
+  int dst_stride = dst_image->line_stride / imDataTypeSize(dst_image->data_type);
 
   counter = imProcessCounterBegin("Rank Min");
   imCounterTotal(counter, src_image->depth*src_image->height, "Filtering...");
@@ -804,23 +850,23 @@ int imProcessRankMinConvolve(const imImage* src_image, imImage* dst_image, int k
     {
     case IM_BYTE:
       ret = DoConvolveRankFunc((imbyte*)src_image->data[i], (imbyte*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_min_op_byte, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_min_op_byte, counter);
       break;                                                                                
     case IM_SHORT:                                                                           
       ret = DoConvolveRankFunc((short*)src_image->data[i], (short*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_min_op_short, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_min_op_short, counter);
       break;                                                                                
     case IM_USHORT:                                                                           
       ret = DoConvolveRankFunc((imushort*)src_image->data[i], (imushort*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_min_op_ushort, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_min_op_ushort, counter);
       break;                                                                                
     case IM_INT:                                                                           
       ret = DoConvolveRankFunc((int*)src_image->data[i], (int*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_min_op_int, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_min_op_int, counter);
       break;                                                                                
     case IM_FLOAT:                                                                           
       ret = DoConvolveRankFunc((float*)src_image->data[i], (float*)dst_image->data[i], 
-                               src_image->width, src_image->height, ks, ks, rank_min_op_real, counter);
+                               src_image->width, src_image->height, src_stride, dst_stride, ks, ks, rank_min_op_real, counter);
       break;                                                                                
     }
     
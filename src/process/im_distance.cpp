@@ -8,6 +8,7 @@
 #include <im_util.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_glo.h"
 
 #include <stdlib.h>
@@ -238,6 +239,10 @@ static inline void setValueBackwardEdge(int r, int r1, int r2, int width, int he
 
 void imProcessDistanceTransform(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessDistanceTransform, src_image, dst_image);
+
   int width = src_image->width,
      height = src_image->height;
 
@@ -465,6 +470,10 @@ static inline void iCheckMaximum(int r, int r1a, int r1b, float *src_data, imbyt
 
 void imProcessRegionalMaximum(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRegionalMaximum, src_image, dst_image);
+
   int width = src_image->width,
      height = src_image->height;
 
@@ -11,6 +11,7 @@
 #include <im_complex.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 #include "im_math_op.h"
 
@@ -51,6 +52,10 @@ static void BoxSet(imbyte *map, int offset, int shift, int hbox_size, int vbox_s
 
 void imProcessPixelate(const imImage* src_image, imImage* dst_image, int box_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessPixelate, src_image, dst_image, box_size);
+
   int hbox = (src_image->width  + box_size-1) / box_size;
   int vbox = (src_image->height + box_size-1) / box_size;
 
@@ -84,6 +89,10 @@ void imProcessPixelate(const imImage* src_image, imImage* dst_image, int box_siz
 
 void imProcessPosterize(const imImage* src_image, imImage* dst_image, int level)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessPosterize, src_image, dst_image, level);
+
   unsigned char mask = (unsigned char)(0xFF << level);
   imProcessBitMask(src_image, dst_image, mask, IM_BIT_AND);
 }
@@ -7,9 +7,12 @@
 
 #include <im.h>
 #include <im_util.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
+#include "im_process_run.h"
 #include "im_math_op.h"
 
 #include <stdlib.h>
@@ -284,7 +287,11 @@ template <class DT>
 static void Rotate90(int src_width, 
                    int src_height, 
                    DT *src_map, 
+                   int src_stride,
+                   int src_step,
                    DT *dst_map, 
+                   int dst_stride,
+                   int dst_step,
                    int dir)
 {
 #ifdef _OPENMP
@@ -303,7 +310,7 @@ static void Rotate90(int src_width,
     else
       xd = src_height-1 - y;
 
-    int line_offset = y*src_width;
+    int line_offset = y*src_stride;
 
     for(int x = 0; x < src_width; x++)
     {
@@ -312,7 +319,7 @@ static void Rotate90(int src_width,
       else
         yd = x;
 
-      dst_map[yd*src_height + xd] = src_map[line_offset + x];
+      dst_map[yd*dst_stride + xd*dst_step] = src_map[line_offset + x*src_step];
     }        
   }
 }
@@ -321,7 +328,11 @@ template <class DT>
 static void Rotate180(int width, 
                    int height, 
                    DT *src_map, 
-                   DT *dst_map)
+                   int src_stride,
+                   int src_step,
+                   DT *dst_map,
+                   int dst_stride,
+                   int dst_step)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
@@ -330,13 +341,13 @@ static void Rotate180(int width,
   {
     int yd = height-1 - y;
 
-    int src_line_offset = y*width;
-    int dst_line_offset = yd*width;
+    int src_line_offset = y*src_stride;
+    int dst_line_offset = yd*dst_stride;
 
     for(int x = 0; x < width; x++)
     {
       int xd = width-1 - x;
-      dst_map[dst_line_offset + xd] = src_map[src_line_offset + x];
+      dst_map[dst_line_offset + xd*dst_step] = src_map[src_line_offset + x*src_step];
     }        
   }
 }
@@ -345,7 +356,11 @@ template <class DT>
 static void Mirror(int width, 
                    int height, 
                    DT *src_map, 
-                   DT *dst_map)
+                   int src_stride,
+                   int src_step,
+                   DT *dst_map,
+                   int dst_stride,
+                   int dst_step)
 {
   if (src_map == dst_map) // check of in-place operation
   {
@@ -356,14 +371,14 @@ static void Mirror(int width,
 #endif
     for(int y = 0 ; y < height; y++)
     {
-      int line_offset = y*width;
+      int line_offset = y*src_stride;
 
       for(int x = 0 ; x < half_width; x++)
       {
         int xd = width-1 - x;
-        DT temp_value = src_map[line_offset + xd];
-        src_map[line_offset + xd] = src_map[line_offset + x];
-        src_map[line_offset + x] = temp_value;
+        DT temp_value = src_map[line_offset + xd*src_step];
+        src_map[line_offset + xd*src_step] = src_map[line_offset + x*src_step];
+        src_map[line_offset + x*src_step] = temp_value;
         xd--;
       }        
     }
@@ -375,35 +390,37 @@ static void Mirror(int width,
 #endif
     for(int y = 0 ; y < height; y++)
     {
-      int line_offset = y*width;
+      int src_line_offset = y*src_stride;
+      int dst_line_offset = y*dst_stride;
 
       for(int x = 0 ; x < width; x++)
       {
         int xd = width-1 - x;
-        dst_map[line_offset + xd] = src_map[line_offset + x];
+        dst_map[dst_line_offset + xd*dst_step] = src_map[src_line_offset + x*src_step];
       }        
     }
   }
 }
 
-template <class DT> 
-static void Flip(int width, 
+static void Flip(int line_size, 
                    int height, 
-                   DT *src_map, 
-                   DT *dst_map)
+                   imbyte *src_map, 
+                   int src_stride,
+                   imbyte *dst_map,
+                   int dst_stride)
 {
   if (src_map == dst_map) // check of in-place operation
   {
-    DT* temp_line = (DT*)malloc(width*sizeof(DT));
+    imbyte* temp_line = (imbyte*)malloc(line_size);
     int half_height = height/2;
 
     // Can NOT run in parallel
     for(int y = 0 ; y < half_height; y++)
     {
       int yd = height-1 - y;
-      memcpy(temp_line, dst_map + yd*width, width*sizeof(DT));
-      memcpy(dst_map + yd*width, src_map + y*width, width*sizeof(DT));
-      memcpy(src_map + y*width, temp_line, width*sizeof(DT));
+      memcpy(temp_line, dst_map + yd*dst_stride, line_size);
+      memcpy(dst_map + yd*dst_stride, src_map + y*src_stride, line_size);
+      memcpy(src_map + y*src_stride, temp_line, line_size);
     }
 
     free(temp_line);
@@ -416,17 +433,19 @@ static void Flip(int width,
     for(int y = 0 ; y < height; y++)
     {
       int yd = height-1 - y;
-      memcpy(dst_map + yd*width, src_map + y*width,width * sizeof(DT));
+      memcpy(dst_map + yd*dst_stride, src_map + y*src_stride, line_size);
     }
   }
 }
 
-template <class DT> 
-static void InterlaceSplit(int width, 
+static void InterlaceSplit(int line_size, 
                    int height, 
-                   DT *src_map, 
-                   DT *dst_map1,
-                   DT *dst_map2)
+                   imbyte *src_map, 
+                   int src_stride,
+                   imbyte *dst_map1,
+                   int dst_stride1,
+                   imbyte *dst_map2,
+                   int dst_stride2)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
@@ -435,9 +454,9 @@ static void InterlaceSplit(int width,
   {
     int yd = y/2;
     if (y%2)
-      memcpy(dst_map2 + yd*width, src_map + y*width, width*sizeof(DT));
+      memcpy(dst_map2 + yd*dst_stride2, src_map + y*src_stride, line_size);
     else
-      memcpy(dst_map1 + yd*width, src_map + y*width, width*sizeof(DT));
+      memcpy(dst_map1 + yd*dst_stride1, src_map + y*src_stride, line_size);
   }
 }
 
@@ -447,28 +466,33 @@ static void InterlaceSplit(int width,
 
 void imProcessRotate90(const imImage* src_image, imImage* dst_image, int dir)
 {
+  imImageMakeWritable(dst_image);
+
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
+
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   for (int i = 0; i < src_depth; i++)
   {
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      Rotate90(src_image->width, src_image->height, (imbyte*)src_image->data[i],  (imbyte*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (imbyte*)src_image->data[i], src_stride, src_step, (imbyte*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     case IM_SHORT:
-      Rotate90(src_image->width, src_image->height, (short*)src_image->data[i],  (short*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (short*)src_image->data[i], src_stride, src_step, (short*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     case IM_USHORT:
-      Rotate90(src_image->width, src_image->height, (imushort*)src_image->data[i],  (imushort*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (imushort*)src_image->data[i], src_stride, src_step, (imushort*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     case IM_INT:
-      Rotate90(src_image->width, src_image->height, (int*)src_image->data[i],  (int*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (int*)src_image->data[i], src_stride, src_step, (int*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     case IM_FLOAT:
-      Rotate90(src_image->width, src_image->height, (float*)src_image->data[i],  (float*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (float*)src_image->data[i], src_stride, src_step, (float*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     case IM_CFLOAT:
-      Rotate90(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  (imcfloat*)dst_image->data[i], dir);
+      Rotate90(src_image->width, src_image->height, (imcfloat*)src_image->data[i], src_stride, src_step, (imcfloat*)dst_image->data[i], dst_stride, dst_step, dir);
       break;
     }
   }
@@ -476,28 +500,33 @@ void imProcessRotate90(const imImage* src_image, imImage* dst_image, int dir)
 
 void imProcessRotate180(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
+
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   for (int i = 0; i < src_depth; i++)
   {
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      Rotate180(src_image->width, src_image->height, (imbyte*)src_image->data[i],  (imbyte*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (imbyte*)src_image->data[i], src_stride, src_step, (imbyte*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_SHORT:
-      Rotate180(src_image->width, src_image->height, (short*)src_image->data[i],  (short*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (short*)src_image->data[i], src_stride, src_step, (short*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_USHORT:
-      Rotate180(src_image->width, src_image->height, (imushort*)src_image->data[i],  (imushort*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (imushort*)src_image->data[i], src_stride, src_step, (imushort*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_INT:
-      Rotate180(src_image->width, src_image->height, (int*)src_image->data[i],  (int*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (int*)src_image->data[i], src_stride, src_step, (int*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_FLOAT:
-      Rotate180(src_image->width, src_image->height, (float*)src_image->data[i],  (float*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (float*)src_image->data[i], src_stride, src_step, (float*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_CFLOAT:
-      Rotate180(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  (imcfloat*)dst_image->data[i]);
+      Rotate180(src_image->width, src_image->height, (imcfloat*)src_image->data[i], src_stride, src_step, (imcfloat*)dst_image->data[i], dst_stride, dst_step);
       break;
     }
   }
@@ -505,9 +534,14 @@ void imProcessRotate180(const imImage* src_image, imImage* dst_image)
 
 int imProcessRadial(const imImage* src_image, imImage* dst_image, float k1, int order)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRadial, src_image, dst_image, k1, order);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("Radial Distort");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, "Processing...");  /* size of the destiny image */
 
@@ -546,9 +580,14 @@ int imProcessRadial(const imImage* src_image, imImage* dst_image, float k1, int
 
 int imProcessSwirl(const imImage* src_image, imImage* dst_image, float k, int order)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessSwirl, src_image, dst_image, k, order);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("Swirl Distort");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, "Processing...");  /* size of the destiny image */
 
@@ -626,9 +665,14 @@ void imProcessCalcRotateSize(int width, int height, int *new_width, int *new_hei
 
 int imProcessRotate(const imImage* src_image, imImage* dst_image, double cos0, double sin0, int order)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRotate, src_image, dst_image, cos0, sin0, order);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("Rotate");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, "Processing...");  /* size of the destiny image */
 
@@ -674,9 +718,14 @@ int imProcessRotate(const imImage* src_image, imImage* dst_image, double cos0, d
 
 int imProcessRotateRef(const imImage* src_image, imImage* dst_image, double cos0, double sin0, int x, int y, int to_origin, int order)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRotateRef, src_image, dst_image, cos0, sin0, x, y, to_origin, order);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("RotateRef");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, "Processing...");  /* size of the destiny image */
 
@@ -722,6 +771,11 @@ int imProcessRotateRef(const imImage* src_image, imImage* dst_image, double cos0
 
 void imProcessMirror(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
+
   int i;
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
 
@@ -730,22 +784,22 @@ void imProcessMirror(const imImage* src_image, imImage* dst_image)
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      Mirror(src_image->width, src_image->height, (imbyte*)src_image->data[i],  (imbyte*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (imbyte*)src_image->data[i], src_stride, src_step, (imbyte*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_SHORT:
-      Mirror(src_image->width, src_image->height, (short*)src_image->data[i],  (short*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (short*)src_image->data[i], src_stride, src_step, (short*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_USHORT:
-      Mirror(src_image->width, src_image->height, (imushort*)src_image->data[i],  (imushort*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (imushort*)src_image->data[i], src_stride, src_step, (imushort*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_INT:
-      Mirror(src_image->width, src_image->height, (int*)src_image->data[i],  (int*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (int*)src_image->data[i], src_stride, src_step, (int*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_FLOAT:
-      Mirror(src_image->width, src_image->height, (float*)src_image->data[i],  (float*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (float*)src_image->data[i], src_stride, src_step, (float*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_CFLOAT:
-      Mirror(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  (imcfloat*)dst_image->data[i]);
+      Mirror(src_image->width, src_image->height, (imcfloat*)src_image->data[i], src_stride, src_step, (imcfloat*)dst_image->data[i], dst_stride, dst_step);
       break;
     }
   }
@@ -753,62 +807,28 @@ void imProcessMirror(const imImage* src_image, imImage* dst_image)
 
 void imProcessFlip(const imImage* src_image, imImage* dst_image)
 {
-  int i;
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, dst_image))
+    return imProcessContiguousCall(imProcessFlip, src_image, dst_image);
 
-  for (i = 0; i < src_depth; i++)
-  {
-    switch(src_image->data_type)
-    {
-    case IM_BYTE:
-      Flip(src_image->width, src_image->height, (imbyte*)src_image->data[i],  (imbyte*)dst_image->data[i]);
-      break;
-    case IM_SHORT:
-      Flip(src_image->width, src_image->height, (short*)src_image->data[i],  (short*)dst_image->data[i]);
-      break;
-    case IM_USHORT:
-      Flip(src_image->width, src_image->height, (imushort*)src_image->data[i],  (imushort*)dst_image->data[i]);
-      break;
-    case IM_INT:
-      Flip(src_image->width, src_image->height, (int*)src_image->data[i],  (int*)dst_image->data[i]);
-      break;
-    case IM_FLOAT:
-      Flip(src_image->width, src_image->height, (float*)src_image->data[i],  (float*)dst_image->data[i]);
-      break;
-    case IM_CFLOAT:
-      Flip(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  (imcfloat*)dst_image->data[i]);
-      break;
-    }
-  }
+  int line_size = src_image->width * imProcessPixelSize(src_image);
+  int src_depth = imProcessPlaneCount(src_image);
+
+  for (int i = 0; i < src_depth; i++)
+    Flip(line_size, src_image->height, (imbyte*)src_image->data[i], src_image->line_stride, (imbyte*)dst_image->data[i], dst_image->line_stride);
 }
 
 void imProcessInterlaceSplit(const imImage* src_image, imImage* dst_image1, imImage* dst_image2)
 {
-  int i;
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  imImageMakeWritable(dst_image1);
+  imImageMakeWritable(dst_image2);
+  if (!imProcessIsSameLayout(src_image, dst_image1, dst_image2))
+    return imProcessContiguousCall(imProcessInterlaceSplit, src_image, dst_image1, dst_image2);
 
-  for (i = 0; i < src_depth; i++)
-  {
-    switch(src_image->data_type)
-    {
-    case IM_BYTE:
-      InterlaceSplit(src_image->width, src_image->height, (imbyte*)src_image->data[i],  (imbyte*)dst_image1->data[i], (imbyte*)dst_image2->data[i]);
-      break;
-    case IM_SHORT:
-      InterlaceSplit(src_image->width, src_image->height, (short*)src_image->data[i],  (short*)dst_image1->data[i], (short*)dst_image2->data[i]);
-      break;
-    case IM_USHORT:
-      InterlaceSplit(src_image->width, src_image->height, (imushort*)src_image->data[i],  (imushort*)dst_image1->data[i], (imushort*)dst_image2->data[i]);
-      break;
-    case IM_INT:
-      InterlaceSplit(src_image->width, src_image->height, (int*)src_image->data[i],  (int*)dst_image1->data[i], (int*)dst_image2->data[i]);
-      break;
-    case IM_FLOAT:
-      InterlaceSplit(src_image->width, src_image->height, (float*)src_image->data[i],  (float*)dst_image1->data[i], (float*)dst_image2->data[i]);
-      break;
-    case IM_CFLOAT:
-      InterlaceSplit(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  (imcfloat*)dst_image1->data[i], (imcfloat*)dst_image2->data[i]);
-      break;
-    }
-  }
+  int line_size = src_image->width * imProcessPixelSize(src_image);
+  int src_depth = imProcessPlaneCount(src_image);
+
+  for (int i = 0; i < src_depth; i++)
+    InterlaceSplit(line_size, src_image->height, (imbyte*)src_image->data[i], src_image->line_stride, 
+                   (imbyte*)dst_image1->data[i], dst_image1->line_stride, (imbyte*)dst_image2->data[i], dst_image2->line_stride);
 }
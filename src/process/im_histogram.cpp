@@ -10,6 +10,7 @@
 #include <im_math.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 #include "im_process_ana.h"
 
@@ -80,6 +81,10 @@ static void DoExpandHistogram(T* src_map, T* dst_map, int size, int depth, int h
 
 void imProcessExpandHistogram(const imImage* src_image, imImage* dst_image, float percent)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessExpandHistogram, src_image, dst_image, percent);
+
   int low_level, high_level;
   imCalcPercentMinMax(src_image, percent, 0, &low_level, &high_level);
 
@@ -121,6 +126,10 @@ static void DoEqualizeHistogram(T* src_map, T* dst_map, int size, int depth, int
 
 void imProcessEqualizeHistogram(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessEqualizeHistogram, src_image, dst_image);
+
   int hcount;
   unsigned long* histo = imHistogramNew(src_image->data_type, &hcount);
 
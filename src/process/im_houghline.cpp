@@ -11,6 +11,7 @@
 #include <im_counter.h>
 
 #include "im_process_glo.h"
+#include "im_process_layout.h"
 
 #include <stdlib.h>
 #include <memory.h>
@@ -366,6 +367,10 @@ static void drawLine(imImage* image, int theta, int rho)
 
 int imProcessHoughLines(const imImage* src_image, imImage *dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessHoughLines, src_image, dst_image);
+
   int counter = imCounterBegin("Hough Line Transform");
   imCounterTotal(counter, src_image->height, "Processing...");
 
@@ -408,6 +413,10 @@ static void ReplaceColor(imImage* image)
 
 int imProcessHoughLinesDraw(const imImage* src_image, const imImage *hough, const imImage *hough_points, imImage *dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, hough, hough_points, dst_image))
+    return imProcessContiguousCall(imProcessHoughLinesDraw, src_image, hough, hough_points, dst_image);
+
   int theta, line_count = 0;
 
   if (src_image != dst_image)
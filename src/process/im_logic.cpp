@@ -9,6 +9,8 @@
 #include <im_util.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 
 #include <stdlib.h>
@@ -47,22 +49,40 @@ static void DoBitwiseOp(T *map1, T *map2, T *map, int count, int op)
 
 void imProcessBitwiseOp(const imImage* src_image1, const imImage* src_image2, imImage* dst_image, int op)
 {
-  int count = src_image1->count*src_image1->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image1, src_image2, dst_image))
+    return imProcessContiguousCall(imProcessBitwiseOp, src_image1, src_image2, dst_image, op);
 
-  switch(src_image1->data_type)
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(src_image2) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image1, single);
+  int count = imProcessRunSize(src_image1, single);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    DoBitwiseOp((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imbyte*)dst_image->data[0], count, op);
-    break;                                                                                
-  case IM_SHORT:
-    DoBitwiseOp((short*)src_image1->data[0], (short*)src_image2->data[0], (short*)dst_image->data[0], count, op);
-    break;                                                                                
-  case IM_USHORT:
-    DoBitwiseOp((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (imushort*)dst_image->data[0], count, op);
-    break;                                                                                
-  case IM_INT:                                                                           
-    DoBitwiseOp((int*)src_image1->data[0], (int*)src_image2->data[0], (int*)dst_image->data[0], count, op);
-    break;                                                                                
+    void* src_map1 = imProcessRunData(src_image1, run, single);
+    void* src_map2 = imProcessRunData(src_image2, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      DoBitwiseOp((imbyte*)src_map1, (imbyte*)src_map2, (imbyte*)dst_map, count, op);
+      break;                                                                                
+    case IM_SHORT:
+      DoBitwiseOp((short*)src_map1, (short*)src_map2, (short*)dst_map, count, op);
+      break;                                                                                
+    case IM_USHORT:
+      DoBitwiseOp((imushort*)src_map1, (imushort*)src_map2, (imushort*)dst_map, count, op);
+      break;                                                                                
+    case IM_INT:                                                                           
+      DoBitwiseOp((int*)src_map1, (int*)src_map2, (int*)dst_map, count, op);
+      break;                                                                                
+    }
   }
 }
 
@@ -87,37 +107,51 @@ static void DoBitwiseNotBin(imbyte *map1, imbyte *map, int count)
 
 void imProcessBitwiseNot(const imImage* src_image, imImage* dst_image)
 {
-  int count = src_image->count*src_image->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBitwiseNot, src_image, dst_image);
 
-  if (dst_image->color_space == IM_BINARY)
-  {
-    DoBitwiseNotBin((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    return;
-  }
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessRunCount(src_image, single);
+  int count = imProcessRunSize(src_image, single);
 
-  switch(src_image->data_type)
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    DoBitwiseNot((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_SHORT:
-    DoBitwiseNot((short*)src_image->data[0], (short*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_USHORT:
-    DoBitwiseNot((imushort*)src_image->data[0], (imushort*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_INT:                                                                           
-    DoBitwiseNot((int*)src_image->data[0], (int*)dst_image->data[0], count);
-    break;                                                                                
+    void* src_map = imProcessRunData(src_image, run, single);
+    void* dst_map = imProcessRunData(dst_image, run, single);
+
+    if (dst_image->color_space == IM_BINARY)
+    {
+      DoBitwiseNotBin((imbyte*)src_map, (imbyte*)dst_map, count);
+      continue;
+    }
+
+    switch(src_image->data_type)
+    {
+    case IM_BYTE:
+      DoBitwiseNot((imbyte*)src_map, (imbyte*)dst_map, count);
+      break;                                                                                
+    case IM_SHORT:
+      DoBitwiseNot((short*)src_map, (short*)dst_map, count);
+      break;                                                                                
+    case IM_USHORT:
+      DoBitwiseNot((imushort*)src_map, (imushort*)dst_map, count);
+      break;                                                                                
+    case IM_INT:                                                                           
+      DoBitwiseNot((int*)src_map, (int*)dst_map, count);
+      break;                                                                                
+    }
   }
 }
 
-void imProcessBitMask(const imImage* src_image, imImage* dst_image, unsigned char mask, int op)
+static void DoBitMask(imbyte *src_map, int src_step, imbyte *dst_map, int dst_step, int count, imbyte mask, int op)
 {
-  imbyte* src_map = (imbyte*)src_image->data[0];
-  imbyte* dst_map = (imbyte*)dst_image->data[0];
   int i;
-  int count = dst_image->count * dst_image->depth;
+
   switch(op)
   {
   case IM_BIT_AND:
@@ -125,43 +159,85 @@ void imProcessBitMask(const imImage* src_image, imImage* dst_image, unsigned cha
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      dst_map[i] = src_map[i] & mask;
+      dst_map[i*dst_step] = src_map[i*src_step] & mask;
     break;
   case IM_BIT_OR:
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      dst_map[i] = src_map[i] | mask;
+      dst_map[i*dst_step] = src_map[i*src_step] | mask;
     break;
   case IM_BIT_XOR:
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      dst_map[i] = (imbyte)~(src_map[i] | mask);
+      dst_map[i*dst_step] = (imbyte)~(src_map[i*src_step] | mask);
     break;
   }
+}
+
+void imProcessBitMask(const imImage* src_image, imImage* dst_image, unsigned char mask, int op)
+{
+  imImageMakeWritable(dst_image);
+
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(src_image, single);
+  int count = imProcessPlaneRunSize(src_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
+  {
+    imbyte* src_map = (imbyte*)imProcessPlaneRunData(src_image, run, single);
+    imbyte* dst_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+    DoBitMask(src_map, src_step, dst_map, dst_step, count, mask, op);
+  }
 
   if ((op == IM_BIT_XOR || op == IM_BIT_OR) && dst_image->color_space == IM_BINARY && mask > 1)
     dst_image->color_space = IM_GRAY;
 }
 
-void imProcessBitPlane(const imImage* src_image, imImage* dst_image, int plane, int reset)
+static void DoBitPlane(imbyte *src_map, int src_step, imbyte *dst_map, int dst_step, int count, imbyte mask, int reset)
 {
-  imbyte mask = imbyte(0x01 << plane);
-  if (reset) mask = ~mask;
-  imbyte* src_map = (imbyte*)src_image->data[0];
-  imbyte* dst_map = (imbyte*)dst_image->data[0];
-  int count = dst_image->count * dst_image->depth;
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
     if (reset) 
-      dst_map[i] = src_map[i] & mask;
+      dst_map[i*dst_step] = src_map[i*src_step] & mask;
     else
-      dst_map[i] = (src_map[i] & mask)? 1: 0;
+      dst_map[i*dst_step] = (src_map[i*src_step] & mask)? 1: 0;
+  }
+}
+
+void imProcessBitPlane(const imImage* src_image, imImage* dst_image, int plane, int reset)
+{
+  imImageMakeWritable(dst_image);
+
+  imbyte mask = imbyte(0x01 << plane);
+  if (reset) mask = ~mask;
+
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(src_image, single);
+  int count = imProcessPlaneRunSize(src_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (run_count > 1 && IM_OMP_MINCOUNT(run_count*count))
+#endif
+  for (int run = 0; run < run_count; run++)
+  {
+    imbyte* src_map = (imbyte*)imProcessPlaneRunData(src_image, run, single);
+    imbyte* dst_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+    DoBitPlane(src_map, src_step, dst_map, dst_step, count, mask, reset);
   }
 }
@@ -9,6 +9,7 @@
 #include <im_util.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
 #include "im_process_pnt.h"
 
@@ -87,6 +88,10 @@ static int DoBinMorphConvolve(imbyte *map, imbyte* new_map, int width, int heigh
 
 int imProcessBinMorphConvolve(const imImage* src_image, imImage* dst_image, const imImage *kernel, int hit_white, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image, kernel))
+    return imProcessContiguousCall(imProcessBinMorphConvolve, src_image, dst_image, kernel, hit_white, iter);
+
   int j, ret = 0, hit_value, miss_value;
   void *tmp = NULL;
   int counter;
@@ -132,6 +137,10 @@ int imProcessBinMorphConvolve(const imImage* src_image, imImage* dst_image, cons
 
 int imProcessBinMorphErode(const imImage* src_image, imImage* dst_image, int kernel_size, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphErode, src_image, dst_image, kernel_size, iter);
+
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_INT);
   imImageSetAttribute(kernel, "Description", IM_BYTE, -1, (void*)"Erode");
 
@@ -146,6 +155,10 @@ int imProcessBinMorphErode(const imImage* src_image, imImage* dst_image, int ker
 
 int imProcessBinMorphDilate(const imImage* src_image, imImage* dst_image, int kernel_size, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphDilate, src_image, dst_image, kernel_size, iter);
+
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_INT);
   imImageSetAttribute(kernel, "Description", IM_BYTE, -1, (void*)"Dilate");
   // Kernel is all zeros
@@ -156,6 +169,10 @@ int imProcessBinMorphDilate(const imImage* src_image, imImage* dst_image, int ke
 
 int imProcessBinMorphOpen(const imImage* src_image, imImage* dst_image, int kernel_size, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphOpen, src_image, dst_image, kernel_size, iter);
+
   imImage*temp = imImageClone(src_image);
   if (!temp)
     return 0;
@@ -171,6 +188,10 @@ int imProcessBinMorphOpen(const imImage* src_image, imImage* dst_image, int kern
 
 int imProcessBinMorphClose(const imImage* src_image, imImage* dst_image, int kernel_size, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphClose, src_image, dst_image, kernel_size, iter);
+
   imImage*temp = imImageClone(src_image);
   if (!temp)
     return 0;
@@ -186,6 +207,10 @@ int imProcessBinMorphClose(const imImage* src_image, imImage* dst_image, int ker
 
 int imProcessBinMorphOutline(const imImage* src_image, imImage* dst_image, int kernel_size, int iter)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphOutline, src_image, dst_image, kernel_size, iter);
+
   if (!imProcessBinMorphErode(src_image, dst_image, kernel_size, iter)) 
     return 0;
   imProcessArithmeticOp(src_image, dst_image, dst_image, IM_BIN_DIFF);
@@ -325,6 +350,10 @@ static void DoThinImage(imbyte *map, int xsize, int ysize)
 
 void imProcessBinMorphThin(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessBinMorphThin, src_image, dst_image);
+
   imImageCopyData(src_image, dst_image);
   DoThinImage((imbyte*)dst_image->data[0], dst_image->width, dst_image->height);
 }
@@ -8,8 +8,10 @@
 #include <im.h>
 #include <im_util.h>
 #include <im_convert.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
 #include "im_process_pnt.h"
 
@@ -119,9 +121,14 @@ static int DoGrayMorphConvolve(T *map, T* new_map, int width, int height, const
 
 int imProcessGrayMorphConvolve(const imImage* src_image, imImage* dst_image, const imImage *kernel, int ismax)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image, kernel))
+    return imProcessContiguousCall(imProcessGrayMorphConvolve, src_image, dst_image, kernel, ismax);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin("Gray Morphological Convolution");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* msg = (const char*)imImageGetAttribute(kernel, "Description", NULL, NULL);
   if (!msg) msg = "Processing...";
   imCounterTotal(counter, src_image->depth*src_image->height, msg);
@@ -168,6 +175,10 @@ int imProcessGrayMorphConvolve(const imImage* src_image, imImage* dst_image, con
 
 int imProcessGrayMorphErode(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphErode, src_image, dst_image, kernel_size);
+
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_INT);
   imImageSetAttribute(kernel, "Description", IM_BYTE, -1, (void*)"Erode");
   // Kernel is all zeros
@@ -178,6 +189,10 @@ int imProcessGrayMorphErode(const imImage* src_image, imImage* dst_image, int ke
 
 int imProcessGrayMorphDilate(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphDilate, src_image, dst_image, kernel_size);
+
   imImage* kernel = imImageCreate(kernel_size, kernel_size, IM_GRAY, IM_INT);
   imImageSetAttribute(kernel, "Description", IM_BYTE, -1, (void*)"Dilate");
   // Kernel is all zeros
@@ -188,6 +203,10 @@ int imProcessGrayMorphDilate(const imImage* src_image, imImage* dst_image, int k
 
 int imProcessGrayMorphOpen(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphOpen, src_image, dst_image, kernel_size);
+
   imImage*temp = imImageClone(src_image);
   if (!temp)
     return 0;
@@ -203,6 +222,10 @@ int imProcessGrayMorphOpen(const imImage* src_image, imImage* dst_image, int ker
 
 int imProcessGrayMorphClose(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphClose, src_image, dst_image, kernel_size);
+
   imImage*temp = imImageClone(src_image);
   if (!temp)
     return 0;
@@ -218,6 +241,10 @@ int imProcessGrayMorphClose(const imImage* src_image, imImage* dst_image, int ke
 
 int imProcessGrayMorphTopHat(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphTopHat, src_image, dst_image, kernel_size);
+
   if (!imProcessGrayMorphOpen(src_image, dst_image, kernel_size)) 
     return 0;
   imProcessArithmeticOp(src_image, dst_image, dst_image, IM_BIN_DIFF);
@@ -226,6 +253,10 @@ int imProcessGrayMorphTopHat(const imImage* src_image, imImage* dst_image, int k
 
 int imProcessGrayMorphWell(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphWell, src_image, dst_image, kernel_size);
+
   if (!imProcessGrayMorphClose(src_image, dst_image, kernel_size)) 
     return 0;
   imProcessArithmeticOp(src_image, dst_image, dst_image, IM_BIN_DIFF);
@@ -234,6 +265,10 @@ int imProcessGrayMorphWell(const imImage* src_image, imImage* dst_image, int ker
 
 int imProcessGrayMorphGradient(const imImage* src_image, imImage* dst_image, int kernel_size)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessGrayMorphGradient, src_image, dst_image, kernel_size);
+
   imImage*temp = imImageClone(src_image);
   if (!temp)
     return 0;
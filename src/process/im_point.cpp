@@ -9,8 +9,10 @@
 #include <im_util.h>
 #include <im_math.h>
 #include <im_complex.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 #include "im_math_op.h"
 
@@ -19,38 +21,43 @@
 
 
 template <class T1, class T2> 
-static int DoUnaryPointOp(T1 *src_map, T2 *dst_map, int width, int height, int depth, imUnaryPointOpFunc func, float* params, void* userdata, int counter)
+static int DoUnaryPointOp(const imImage* src_image, imImage* dst_image, imUnaryPointOpFunc func, float* params, void* userdata, int counter)
 {
-  int count = width * height;
-  int size = count * depth;
+  int width = src_image->width;
+  int height = src_image->height;
+  int depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  int line_count = depth * height;
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
   IM_INT_PROCESSING;
 
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(size))
+#pragma omp parallel for if (IM_OMP_MINCOUNT(line_count * width))
 #endif
-  for(int i = 0; i < size; i++)
+  for(int line = 0; line < line_count; line++)
   {
 #ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
     IM_BEGIN_PROCESSING; 
-    
-    float dst_value;
-    int d = i%count;
-    int y = (i - d*count)%width;
-    int x = i - d*count - y*width;
 
-    if (func((float)src_map[i], &dst_value, params, userdata, x, y, d)) 
-      dst_map[i] = (T2)dst_value;
+    int d = line / height;
+    int y = line - d*height;
+    const T1* src_line = (const T1*)imProcessLineData(src_image, d, y);
+    T2* dst_line = (T2*)imProcessLineData(dst_image, d, y);
 
-    if (x == width-1)
+    for(int x = 0; x < width; x++)
     {
-      IM_COUNT_PROCESSING;
-  #ifdef _OPENMP
+      float dst_value;
+      if (func((float)src_line[x*src_step], &dst_value, params, userdata, x, y, d)) 
+        dst_line[x*dst_step] = (T2)dst_value;
+    }
+
+    IM_COUNT_PROCESSING;
+#ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
-      IM_END_PROCESSING;
-    }
+    IM_END_PROCESSING;
   }
 
   return processing;
@@ -58,73 +65,76 @@ static int DoUnaryPointOp(T1 *src_map, T2 *dst_map, int width, int height, int d
 
 int imProcessUnaryPointOp(const imImage* src_image, imImage* dst_image, imUnaryPointOpFunc func, float* params, void* userdata, const char* op_name)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
   int depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
 
   int counter = imProcessCounterBegin(op_name? op_name: "UnaryPointOp");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, depth*src_image->height, "Processing...");
 
   switch(src_image->data_type)
   {
   case IM_BYTE:
     if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointOp((imbyte*)src_image->data[0], (float*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imbyte, float>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointOp((imbyte*)src_image->data[0], (int*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imbyte, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointOp((imbyte*)src_image->data[0], (imushort*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imbyte, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointOp((imbyte*)src_image->data[0], (short*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imbyte, short>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointOp((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imbyte, imbyte>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_SHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointOp((short*)src_image->data[0], (imbyte*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<short, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointOp((short*)src_image->data[0], (imushort*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<short, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointOp((short*)src_image->data[0], (int*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<short, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointOp((short*)src_image->data[0], (float*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<short, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointOp((short*)src_image->data[0], (short*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<short, short>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_USHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointOp((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imushort, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointOp((imushort*)src_image->data[0], (short*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imushort, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointOp((imushort*)src_image->data[0], (int*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imushort, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointOp((imushort*)src_image->data[0], (float*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imushort, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointOp((imushort*)src_image->data[0], (imushort*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<imushort, imushort>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_INT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointOp((int*)src_image->data[0], (imbyte*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<int, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointOp((int*)src_image->data[0], (short*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<int, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointOp((int*)src_image->data[0], (imushort*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<int, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointOp((int*)src_image->data[0], (float*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<int, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointOp((int*)src_image->data[0], (int*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<int, int>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_FLOAT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointOp((float*)src_image->data[0], (imbyte*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<float, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointOp((float*)src_image->data[0], (short*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<float, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointOp((float*)src_image->data[0], (imushort*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<float, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointOp((float*)src_image->data[0], (int*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<float, int>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointOp((float*)src_image->data[0], (float*)dst_image->data[0], src_image->width, src_image->height, depth, func, params, userdata, counter);
+      ret = DoUnaryPointOp<float, float>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   }
 
@@ -134,45 +144,55 @@ int imProcessUnaryPointOp(const imImage* src_image, imImage* dst_image, imUnaryP
 }
 
 template <class T1, class T2> 
-static int DoUnaryPointColorOp(T1 **src_map, T2 **dst_map, int width, int height, int src_depth, int dst_depth, imUnaryPointColorOpFunc func, float* params, void* userdata, int counter)
+static int DoUnaryPointColorOp(const imImage* src_image, imImage* dst_image, imUnaryPointColorOpFunc func, float* params, void* userdata, int counter)
 {
-  int count = width * height;
+  int width = src_image->width;
+  int height = src_image->height;
+  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  int dst_depth = dst_image->has_alpha? dst_image->depth+1: dst_image->depth;
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
   IM_INT_PROCESSING;
 
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
-  for(int i = 0; i < count; i++)
+  for(int y = 0; y < height; y++)
   {
 #ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
     IM_BEGIN_PROCESSING; 
-    
-    int y = i%width;
-    int x = i - y*width;
 
     int d;
-    float src_value[IM_MAXDEPTH];
-    float dst_value[IM_MAXDEPTH];
+    const T1* src_line[IM_MAXDEPTH];
+    T2* dst_line[IM_MAXDEPTH];
 
     for(d = 0; d < src_depth; d++)
-      src_value[d] = (float)(src_map[d])[i];
+      src_line[d] = (const T1*)imProcessLineData(src_image, d, y);
+    for(d = 0; d < dst_depth; d++)
+      dst_line[d] = (T2*)imProcessLineData(dst_image, d, y);
 
-    if (func(src_value, dst_value, params, userdata, x, y))
+    for(int x = 0; x < width; x++)
     {
-      for(d = 0; d < dst_depth; d++)
-        (dst_map[d])[i] = (T2)dst_value[d];
+      float src_value[IM_MAXDEPTH];
+      float dst_value[IM_MAXDEPTH];
+
+      for(d = 0; d < src_depth; d++)
+        src_value[d] = (float)(src_line[d])[x*src_step];
+
+      if (func(src_value, dst_value, params, userdata, x, y))
+      {
+        for(d = 0; d < dst_depth; d++)
+          (dst_line[d])[x*dst_step] = (T2)dst_value[d];
+      }
     }
 
-    if (x == width-1)
-    {
-      IM_COUNT_PROCESSING;
-  #ifdef _OPENMP
+    IM_COUNT_PROCESSING;
+#ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
-      IM_END_PROCESSING;
-    }
+    IM_END_PROCESSING;
   }
 
   return processing;
@@ -180,74 +200,75 @@ static int DoUnaryPointColorOp(T1 **src_map, T2 **dst_map, int width, int height
 
 int imProcessUnaryPointColorOp(const imImage* src_image, imImage* dst_image, imUnaryPointColorOpFunc func, float* params, void* userdata, const char* op_name)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
-  int dst_depth = dst_image->has_alpha? dst_image->depth+1: dst_image->depth;
 
   int counter = imProcessCounterBegin(op_name? op_name: "UnaryPointColorOp");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   imCounterTotal(counter, src_image->height, "Processing...");
 
   switch(src_image->data_type)
   {
   case IM_BYTE:
     if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointColorOp((imbyte**)src_image->data, (float**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imbyte, float>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointColorOp((imbyte**)src_image->data, (int**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imbyte, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointColorOp((imbyte**)src_image->data, (imushort**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imbyte, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointColorOp((imbyte**)src_image->data, (short**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imbyte, short>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointColorOp((imbyte**)src_image->data, (imbyte**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imbyte, imbyte>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_SHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointColorOp((short**)src_image->data, (imbyte**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<short, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointColorOp((short**)src_image->data, (imushort**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<short, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointColorOp((short**)src_image->data, (int**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<short, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointColorOp((short**)src_image->data, (float**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<short, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointColorOp((short**)src_image->data, (short**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<short, short>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_USHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointColorOp((imushort**)src_image->data, (imbyte**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imushort, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointColorOp((imushort**)src_image->data, (short**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imushort, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointColorOp((imushort**)src_image->data, (int**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imushort, int>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointColorOp((imushort**)src_image->data, (float**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imushort, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointColorOp((imushort**)src_image->data, (imushort**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<imushort, imushort>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_INT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointColorOp((int**)src_image->data, (imbyte**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<int, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointColorOp((int**)src_image->data, (short**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<int, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointColorOp((int**)src_image->data, (imushort**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<int, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoUnaryPointColorOp((int**)src_image->data, (float**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<int, float>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointColorOp((int**)src_image->data, (int**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<int, int>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_FLOAT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoUnaryPointColorOp((float**)src_image->data, (imbyte**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<float, imbyte>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoUnaryPointColorOp((float**)src_image->data, (short**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<float, short>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoUnaryPointColorOp((float**)src_image->data, (imushort**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<float, imushort>(src_image, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoUnaryPointColorOp((float**)src_image->data, (int**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<float, int>(src_image, dst_image, func, params, userdata, counter);
     else
-      ret = DoUnaryPointColorOp((float**)src_image->data, (float**)dst_image->data, src_image->width, src_image->height, src_depth, dst_depth, func, params, userdata, counter);
+      ret = DoUnaryPointColorOp<float, float>(src_image, dst_image, func, params, userdata, counter);
     break;                                                                                
   }
 
@@ -257,261 +278,286 @@ int imProcessUnaryPointColorOp(const imImage* src_image, imImage* dst_image, imU
 }
 
 template <class T1, class T2> 
-static int DoMultiPointOp(T1 **src_map, T2 *dst_map, int width, int height, int depth, int src_count, imMultiPointOpFunc func, float* params, void* userdata, int counter)
+static int DoMultiPointOp(const imImage** src_image, int src_count, imImage* dst_image, imMultiPointOpFunc func, float* params, void* userdata, int counter)
 {
-  int count = width * height;
-  int size = count * depth;
+  int width = dst_image->width;
+  int height = dst_image->height;
+  int depth = src_image[0]->has_alpha? src_image[0]->depth+1: src_image[0]->depth;
+  int line_count = depth * height;
+  int dst_step = imProcessPixelStep(dst_image);
   int tcount = IM_MAX_THREADS;
   float* src_value = new float [src_count*tcount];
+  const T1** src_line = new const T1* [src_count*tcount];
+  int* src_step = new int [src_count];
   IM_INT_PROCESSING;
 
+  for(int j = 0; j < src_count; j++)
+    src_step[j] = imProcessPixelStep(src_image[j]);
+
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(size))
+#pragma omp parallel for if (IM_OMP_MINCOUNT(line_count * width))
 #endif
-  for(int i = 0; i < size; i++)
+  for(int line = 0; line < line_count; line++)
   {
 #ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
     IM_BEGIN_PROCESSING; 
-    
-    float dst_value;
-    int d = i%count;
-    int y = (i - d*count)%width;
-    int x = i - d*count - y*width;
+
+    int d = line / height;
+    int y = line - d*height;
     int toffset = IM_THREAD_NUM*src_count;
+    T2* dst_line = (T2*)imProcessLineData(dst_image, d, y);
 
     for(int j = 0; j < src_count; j++)
-      src_value[toffset + j] = (float)(src_map[j])[i];
+      src_line[toffset + j] = (const T1*)imProcessLineData(src_image[j], d, y);
 
-    if (func(src_value + toffset, &dst_value, params, userdata, x, y, d))
-      dst_map[i] = (T2)dst_value;
-
-    if (x == width-1)
+    for(int x = 0; x < width; x++)
     {
-      IM_COUNT_PROCESSING;
-  #ifdef _OPENMP
+      float dst_value;
+
+      for(int j = 0; j < src_count; j++)
+        src_value[toffset + j] = (float)(src_line[toffset + j])[x*src_step[j]];
+
+      if (func(src_value + toffset, &dst_value, params, userdata, x, y, d))
+        dst_line[x*dst_step] = (T2)dst_value;
+    }
+
+    IM_COUNT_PROCESSING;
+#ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
-      IM_END_PROCESSING;
-    }
+    IM_END_PROCESSING;
   }
 
+  delete[] src_step;
+  delete[] src_line;
   delete[] src_value;
   return processing;
 }
 
 int imProcessMultiPointOp(const imImage** src_image, int src_count, imImage* dst_image, imMultiPointOpFunc func, float* params, void* userdata, const char* op_name)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
   int depth = src_image[0]->has_alpha? src_image[0]->depth+1: src_image[0]->depth;
-  void** src_map = new void* [src_count];
 
   int counter = imProcessCounterBegin(op_name? op_name: "MultiPointOp");
-  imCounterTotal(counter, src_image[0]->depth*src_image[0]->height, "Processing...");
-
-  for(int i = 0; i < src_count; i++)
-    src_map[i] = src_image[i]->data[0];
+  imCounterTotal(counter, depth*src_image[0]->height, "Processing...");
 
   switch(src_image[0]->data_type)
   {
   case IM_BYTE:
     if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointOp((imbyte**)src_map, (float*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imbyte, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointOp((imbyte**)src_map, (int*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imbyte, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointOp((imbyte**)src_map, (imushort*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imbyte, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointOp((imbyte**)src_map, (short*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imbyte, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointOp((imbyte**)src_map, (imbyte*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imbyte, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_SHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointOp((short**)src_map, (imbyte*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<short, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointOp((short**)src_map, (imushort*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<short, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointOp((short**)src_map, (int*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<short, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointOp((short**)src_map, (float*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<short, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointOp((short**)src_map, (short*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<short, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_USHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointOp((imushort**)src_map, (imbyte*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imushort, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointOp((imushort**)src_map, (short*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imushort, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointOp((imushort**)src_map, (int*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imushort, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointOp((imushort**)src_map, (float*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imushort, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointOp((imushort**)src_map, (imushort*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<imushort, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_INT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointOp((int**)src_map, (imbyte*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<int, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointOp((int**)src_map, (short*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<int, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointOp((int**)src_map, (imushort*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<int, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointOp((int**)src_map, (float*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<int, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointOp((int**)src_map, (int*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<int, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_FLOAT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointOp((float**)src_map, (imbyte*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<float, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointOp((float**)src_map, (short*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<float, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointOp((float**)src_map, (imushort*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<float, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointOp((float**)src_map, (int*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<float, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointOp((float**)src_map, (float*)dst_image->data[0], src_image[0]->width, src_image[0]->height, depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointOp<float, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   }
 
-  delete [] src_map;
-
   imProcessCounterEnd(counter);
 
   return ret;
 }
 
 template <class T1, class T2> 
-static int DoMultiPointColorOp(T1 ***src_map, T2 **dst_map, int width, int height, int src_depth, int dst_depth, int src_count, imMultiPointColorOpFunc func, float* params, void* userdata, int counter)
+static int DoMultiPointColorOp(const imImage** src_image, int src_count, imImage* dst_image, imMultiPointColorOpFunc func, float* params, void* userdata, int counter)
 {
-  int count = width * height;
+  int width = dst_image->width;
+  int height = dst_image->height;
+  int src_depth = src_image[0]->has_alpha? src_image[0]->depth+1: src_image[0]->depth;
+  int dst_depth = dst_image->has_alpha? dst_image->depth+1: dst_image->depth;
+  int dst_step = imProcessPixelStep(dst_image);
+  int src_size = src_count*src_depth;
   int tcount = IM_MAX_THREADS;
-  float* src_value = new float [src_count*src_depth*tcount];
+  float* src_value = new float [src_size*tcount];
+  const T1** src_line = new const T1* [src_size*tcount];
+  int* src_step = new int [src_count];
   IM_INT_PROCESSING;
 
+  for(int j = 0; j < src_count; j++)
+    src_step[j] = imProcessPixelStep(src_image[j]);
+
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
-  for(int i = 0; i < count; i++)
+  for(int y = 0; y < height; y++)
   {
 #ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
     IM_BEGIN_PROCESSING; 
-    
-    float dst_value[IM_MAXDEPTH];
-    int y = i%width;
-    int x = i - y*width;
-    int toffset = IM_THREAD_NUM*(src_count*src_depth);
+
+    int d;
+    int toffset = IM_THREAD_NUM*src_size;
+    T2* dst_line[IM_MAXDEPTH];
 
     for(int j = 0; j < src_count; j++)
     {
-      for(int d = 0; d < src_depth; d++)
-        src_value[toffset + j*src_depth + d] = (float)((src_map[j])[d])[i];
+      for(d = 0; d < src_depth; d++)
+        src_line[toffset + j*src_depth + d] = (const T1*)imProcessLineData(src_image[j], d, y);
     }
+    for(d = 0; d < dst_depth; d++)
+      dst_line[d] = (T2*)imProcessLineData(dst_image, d, y);
 
-    if (func(src_value + toffset, dst_value, params, userdata, x, y))
+    for(int x = 0; x < width; x++)
     {
-      for(int d = 0; d < dst_depth; d++)
-        (dst_map[d])[i] = (T2)dst_value[d];
+      float dst_value[IM_MAXDEPTH];
+
+      for(int j = 0; j < src_count; j++)
+      {
+        for(d = 0; d < src_depth; d++)
+          src_value[toffset + j*src_depth + d] = (float)(src_line[toffset + j*src_depth + d])[x*src_step[j]];
+      }
+
+      if (func(src_value + toffset, dst_value, params, userdata, x, y))
+      {
+        for(d = 0; d < dst_depth; d++)
+          (dst_line[d])[x*dst_step] = (T2)dst_value[d];
+      }
     }
 
-    if (x == width-1)
-    {
-      IM_COUNT_PROCESSING;
-  #ifdef _OPENMP
+    IM_COUNT_PROCESSING;
+#ifdef _OPENMP
 #pragma omp flush (processing)
 #endif
-      IM_END_PROCESSING;
-    }
+    IM_END_PROCESSING;
   }
 
+  delete[] src_step;
+  delete[] src_line;
   delete[] src_value;
   return processing;
 }
 
 int imProcessMultiPointColorOp(const imImage** src_image, int src_count, imImage* dst_image, imMultiPointColorOpFunc func, float* params, void* userdata, const char* op_name)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
-  int src_depth = src_image[0]->has_alpha? src_image[0]->depth+1: src_image[0]->depth;
-  int dst_depth = dst_image->has_alpha? dst_image->depth+1: dst_image->depth;
-  void*** src_map = new void** [src_count];
 
   int counter = imProcessCounterBegin(op_name? op_name: "MultiPointColorOp");
   imCounterTotal(counter, src_image[0]->height, "Processing...");
 
-  for(int i = 0; i < src_count; i++)
-    src_map[i] = src_image[i]->data;
-
   switch(src_image[0]->data_type)
   {
   case IM_BYTE:
     if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointColorOp((imbyte***)src_map, (float**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imbyte, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointColorOp((imbyte***)src_map, (int**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imbyte, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointColorOp((imbyte***)src_map, (imushort**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imbyte, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointColorOp((imbyte***)src_map, (short**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imbyte, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointColorOp((imbyte***)src_map, (imbyte**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imbyte, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_SHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointColorOp((short***)src_map, (imbyte**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<short, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointColorOp((short***)src_map, (imushort**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<short, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointColorOp((short***)src_map, (int**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<short, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointColorOp((short***)src_map, (float**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<short, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointColorOp((short***)src_map, (short**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<short, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_USHORT:
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointColorOp((imushort***)src_map, (imbyte**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imushort, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointColorOp((imushort***)src_map, (short**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imushort, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointColorOp((imushort***)src_map, (int**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imushort, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointColorOp((imushort***)src_map, (float**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imushort, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointColorOp((imushort***)src_map, (imushort**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<imushort, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_INT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointColorOp((int***)src_map, (imbyte**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<int, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointColorOp((int***)src_map, (short**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<int, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointColorOp((int***)src_map, (imushort**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<int, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_FLOAT)
-      ret = DoMultiPointColorOp((int***)src_map, (float**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<int, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointColorOp((int***)src_map, (int**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<int, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   case IM_FLOAT:                                                                           
     if (dst_image->data_type == IM_BYTE)
-      ret = DoMultiPointColorOp((float***)src_map, (imbyte**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<float, imbyte>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_SHORT)
-      ret = DoMultiPointColorOp((float***)src_map, (short**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<float, short>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_USHORT)
-      ret = DoMultiPointColorOp((float***)src_map, (imushort**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<float, imushort>(src_image, src_count, dst_image, func, params, userdata, counter);
     else if (dst_image->data_type == IM_INT)
-      ret = DoMultiPointColorOp((float***)src_map, (int**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<float, int>(src_image, src_count, dst_image, func, params, userdata, counter);
     else
-      ret = DoMultiPointColorOp((float***)src_map, (float**)dst_image->data, src_image[0]->width, src_image[0]->height, src_depth, dst_depth, src_count, func, params, userdata, counter);
+      ret = DoMultiPointColorOp<float, float>(src_image, src_count, dst_image, func, params, userdata, counter);
     break;                                                                                
   }
 
-  delete [] src_map;
-
   imProcessCounterEnd(counter);
 
   return ret;
@@ -5,6 +5,7 @@
  */
 
 #include "im_process_counter.h"
+#include <im_profile.h>
 
 #include <stdlib.h>
 #include <memory.h>
@@ -73,3 +74,23 @@ int imCounterInc_OMP(int counter)
 }
 
 #endif
+
+int imProcessCounterBegin(const char* title)
+{
+  imProfileBegin(title, IM_MAX_THREADS);
+#ifdef _OPENMP
+  return imCounterBegin_OMP(title);
+#else
+  return imCounterBegin(title);
+#endif
+}
+
+void imProcessCounterEnd(int counter)
+{
+#ifdef _OPENMP
+  imCounterEnd_OMP(counter);
+#else
+  imCounterEnd(counter);
+#endif
+  imProfileEnd();
+}
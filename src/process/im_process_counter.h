@@ -39,9 +39,6 @@ int  imCounterBegin_OMP(const char* title);
 void imCounterEnd_OMP(int counter);
 int  imCounterInc_OMP(int counter);
 
-#define imProcessCounterBegin imCounterBegin_OMP
-#define imProcessCounterEnd   imCounterEnd_OMP
-
 #else
 
 /*
@@ -54,11 +51,12 @@ int  imCounterInc_OMP(int counter);
 #define IM_MAX_THREADS 1
 #define IM_THREAD_NUM  0
 
-#define imProcessCounterBegin imCounterBegin
-#define imProcessCounterEnd   imCounterEnd
-
 #endif
 
+/* Counter of the processing functions, also measures the operation when profiling is enabled (see im_profile.h) */
+int  imProcessCounterBegin(const char* title);
+void imProcessCounterEnd(int counter);
+
 
 #if defined(__cplusplus)
 }
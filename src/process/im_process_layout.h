@@ -0,0 +1,346 @@
+/** \file
+ * \brief Image Layouts of the Processing Functions
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_PROCESS_LAYOUT_H
+#define __IM_PROCESS_LAYOUT_H
+
+#include <im.h>
+#include <im_image.h>
+#include <im_util.h>
+
+#include <stdlib.h>
+
+/* This is the only place where processing functions fall back to contiguous copies.
+ * The point operations (see im_process_run.h), resize, Rotate90/180 and Mirror access any layout directly.
+ * The convolution and rank filters address lines by line_stride, so they accept padded planar images,
+ * and check imProcessIsPlanar to process packed images using contiguous copies.
+ * The functions that copy whole lines check imProcessIsSameLayout.
+ * The other functions access each plane as a single array of width*height pixels,
+ * and check imProcessIsContiguous to process padded and packed images using contiguous copies. */
+
+/* Returns a contiguous copy of the image, or the image itself if already contiguous.
+ * The data is copied only if copy is non zero. Returns NULL if failed. */
+static inline imImage* iContiguousBegin(const imImage* image, int copy)
+{
+  if (imImageIsContiguous(image))
+    return (imImage*)image;
+
+  imImage* contiguous = imImageCreateEx(image->width, image->height, image->color_space, image->data_type, IM_IMAGE_NOCLEAR);
+  if (!contiguous)
+    return NULL;
+
+  if (image->has_alpha)
+    imImageAddAlpha(contiguous);
+
+  imImageCopyAttributes(image, contiguous);
+  if (copy)
+    imImageCopyData(image, contiguous);
+
+  return contiguous;
+}
+
+/* Copies the data back to the image if copy is non zero, and destroys the contiguous copy. */
+static inline void iContiguousEnd(imImage* image, imImage* contiguous, int copy)
+{
+  if (!contiguous || contiguous == image)
+    return;
+
+  if (copy)
+  {
+    imImageCopyData(contiguous, image);
+    imImageCopyAttributes(contiguous, image);  /* palette may have changed */
+  }
+
+  imImageDestroy(contiguous);
+}
+
+/* Returns non zero if all the images are contiguous. NULL images are ignored. */
+static inline int imProcessIsContiguous(const imImage* image1, const imImage* image2 = NULL,
+                                        const imImage* image3 = NULL, const imImage* image4 = NULL)
+{
+  return (!image1 || imImageIsContiguous(image1)) &&
+         (!image2 || imImageIsContiguous(image2)) &&
+         (!image3 || imImageIsContiguous(image3)) &&
+         (!image4 || imImageIsContiguous(image4));
+}
+
+/* Returns non zero if all the images in the list are contiguous. */
+static inline int imProcessIsContiguousList(const imImage* const* image_list, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    if (!imImageIsContiguous(image_list[i]))
+      return 0;
+  }
+  return 1;
+}
+
+/* Returns non zero if none of the images is packed. NULL images are ignored. */
+static inline int imProcessIsPlanar(const imImage* image1, const imImage* image2 = NULL,
+                                    const imImage* image3 = NULL, const imImage* image4 = NULL)
+{
+  int flags = (image1? image1->flags: 0) | (image2? image2->flags: 0) |
+              (image3? image3->flags: 0) | (image4? image4->flags: 0);
+  return !(flags & IM_IMAGE_PACKED);
+}
+
+/* Returns non zero if all the images are planar, or all are packed with the same number of components.
+ * NULL images are ignored. */
+static inline int imProcessIsSameLayout(const imImage* image1, const imImage* image2 = NULL,
+                                        const imImage* image3 = NULL, const imImage* image4 = NULL)
+{
+  const imImage* image_list[3] = {image2, image3, image4};
+  int packed = image1->flags & IM_IMAGE_PACKED;
+  int components = image1->has_alpha? image1->depth+1: image1->depth;
+
+  for (int i = 0; i < 3; i++)
+  {
+    const imImage* image = image_list[i];
+    if (!image)
+      continue;
+
+    if ((image->flags & IM_IMAGE_PACKED) != packed)
+      return 0;
+    if (packed && (image->has_alpha? image->depth+1: image->depth) != components)
+      return 0;
+  }
+  return 1;
+}
+
+/* Number of planes accessed by the functions that copy pixels without changing them (crop, insert, ...).
+ * A packed image has a single plane with all the components, including alpha. */
+static inline int imProcessPlaneCount(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return 1;
+  return image->has_alpha? image->depth+1: image->depth;
+}
+
+/* Number of bytes of one pixel in each plane of imProcessPlaneCount. */
+static inline int imProcessPixelSize(const imImage* image)
+{
+  int type_size = imDataTypeSize(image->data_type);
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->has_alpha? type_size*(image->depth+1): type_size*image->depth;
+  return type_size;
+}
+
+/* Contiguous copy of a parameter of a processing function, valid until the end of the scope.
+ * The copy starts with the image data, and when output is non zero the data is copied back at the end.
+ * Used by imProcessContiguousCall. */
+class imProcessContiguous
+{
+  imImage* image;
+  imImage* contiguous;
+  int output;
+
+  imProcessContiguous(const imProcessContiguous&);
+  void operator=(const imProcessContiguous&);
+
+public:
+  imProcessContiguous(const imImage* _image, int _output = 0)
+    : image((imImage*)_image), contiguous(NULL), output(_output)
+  {
+    if (image)
+      contiguous = iContiguousBegin(image, 1);
+  }
+
+  ~imProcessContiguous()
+  {
+    if (image)
+      iContiguousEnd(image, contiguous, output);
+  }
+
+  int Failed() const { return image && !contiguous; }
+
+  operator imImage*() const { return contiguous; }
+};
+
+/* Parameter of imProcessContiguousCall. Images are replaced by contiguous copies (see imProcessContiguous),
+ * the copies of non const images are copied back at the end. Other parameters are passed unchanged. */
+template <class T>
+class imProcessLayoutArg
+{
+  T value;
+
+public:
+  imProcessLayoutArg(T _value): value(_value) {}
+
+  int Failed() const { return 0; }
+
+  operator T() const { return value; }
+};
+
+template <>
+class imProcessLayoutArg<const imImage*>: public imProcessContiguous
+{
+public:
+  imProcessLayoutArg(const imImage* image): imProcessContiguous(image) {}
+};
+
+template <>
+class imProcessLayoutArg<imImage*>: public imProcessContiguous
+{
+public:
+  imProcessLayoutArg(imImage* image): imProcessContiguous(image, 1) {}
+};
+
+/* Calls the processing function with contiguous copies of the images, 
+ * it is the fallback of the functions that do not access the other layouts directly. 
+ * Returns zero if the copies could not be created. Used as:
+ *   if (!imProcessIsContiguous(src_image, dst_image))
+ *     return imProcessContiguousCall(imProcessSomething, src_image, dst_image, param);  */
+template <class R, class A1, class T1>
+inline R imProcessContiguousCall(R (*func)(A1), T1 a1)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  if (l1.Failed())
+    return R();
+  return func(l1);
+}
+
+template <class R, class A1, class A2, class T1, class T2>
+inline R imProcessContiguousCall(R (*func)(A1, A2), T1 a1, T2 a2)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  if (l1.Failed() || l2.Failed())
+    return R();
+  return func(l1, l2);
+}
+
+template <class R, class A1, class A2, class A3, class T1, class T2, class T3>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3), T1 a1, T2 a2, T3 a3)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  if (l1.Failed() || l2.Failed() || l3.Failed())
+    return R();
+  return func(l1, l2, l3);
+}
+
+template <class R, class A1, class A2, class A3, class A4, class T1, class T2, class T3, class T4>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3, A4), T1 a1, T2 a2, T3 a3, T4 a4)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  imProcessLayoutArg<T4> l4(a4);
+  if (l1.Failed() || l2.Failed() || l3.Failed() || l4.Failed())
+    return R();
+  return func(l1, l2, l3, l4);
+}
+
+template <class R, class A1, class A2, class A3, class A4, class A5, class T1, class T2, class T3, class T4, class T5>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3, A4, A5), T1 a1, T2 a2, T3 a3, T4 a4, T5 a5)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  imProcessLayoutArg<T4> l4(a4);
+  imProcessLayoutArg<T5> l5(a5);
+  if (l1.Failed() || l2.Failed() || l3.Failed() || l4.Failed() || l5.Failed())
+    return R();
+  return func(l1, l2, l3, l4, l5);
+}
+
+template <class R, class A1, class A2, class A3, class A4, class A5, class A6, class T1, class T2, class T3, class T4, class T5, class T6>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3, A4, A5, A6), T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  imProcessLayoutArg<T4> l4(a4);
+  imProcessLayoutArg<T5> l5(a5);
+  imProcessLayoutArg<T6> l6(a6);
+  if (l1.Failed() || l2.Failed() || l3.Failed() || l4.Failed() || l5.Failed() || l6.Failed())
+    return R();
+  return func(l1, l2, l3, l4, l5, l6);
+}
+
+template <class R, class A1, class A2, class A3, class A4, class A5, class A6, class A7, class T1, class T2, class T3, class T4, class T5, class T6, class T7>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3, A4, A5, A6, A7), T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  imProcessLayoutArg<T4> l4(a4);
+  imProcessLayoutArg<T5> l5(a5);
+  imProcessLayoutArg<T6> l6(a6);
+  imProcessLayoutArg<T7> l7(a7);
+  if (l1.Failed() || l2.Failed() || l3.Failed() || l4.Failed() || l5.Failed() || l6.Failed() || l7.Failed())
+    return R();
+  return func(l1, l2, l3, l4, l5, l6, l7);
+}
+
+template <class R, class A1, class A2, class A3, class A4, class A5, class A6, class A7, class A8, class T1, class T2, class T3, class T4, class T5, class T6, class T7, class T8>
+inline R imProcessContiguousCall(R (*func)(A1, A2, A3, A4, A5, A6, A7, A8), T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7, T8 a8)
+{
+  imProcessLayoutArg<T1> l1(a1);
+  imProcessLayoutArg<T2> l2(a2);
+  imProcessLayoutArg<T3> l3(a3);
+  imProcessLayoutArg<T4> l4(a4);
+  imProcessLayoutArg<T5> l5(a5);
+  imProcessLayoutArg<T6> l6(a6);
+  imProcessLayoutArg<T7> l7(a7);
+  imProcessLayoutArg<T8> l8(a8);
+  if (l1.Failed() || l2.Failed() || l3.Failed() || l4.Failed() || l5.Failed() || l6.Failed() || l7.Failed() || l8.Failed())
+    return R();
+  return func(l1, l2, l3, l4, l5, l6, l7, l8);
+}
+/* Same as imProcessContiguous for a list of images. 
+ * Used by the functions that receive image lists, before calling the function again with the copies. */
+class imProcessContiguousList
+{
+  imImage** image_list;
+  imImage** contiguous_list;
+  int count, output;
+
+  imProcessContiguousList(const imProcessContiguousList&);
+  void operator=(const imProcessContiguousList&);
+
+public:
+  imProcessContiguousList(const imImage* const* _image_list, int _count, int _output = 0)
+    : image_list((imImage**)_image_list), count(_count), output(_output)
+  {
+    contiguous_list = (imImage**)calloc(count, sizeof(imImage*));
+    if (!contiguous_list)
+      return;
+
+    for (int i = 0; i < count; i++)
+    {
+      contiguous_list[i] = iContiguousBegin(image_list[i], 1);
+      if (!contiguous_list[i])
+      {
+        for (int j = 0; j < i; j++)
+          iContiguousEnd(image_list[j], contiguous_list[j], 0);
+
+        free(contiguous_list);
+        contiguous_list = NULL;
+        return;
+      }
+    }
+  }
+
+  ~imProcessContiguousList()
+  {
+    if (!contiguous_list)
+      return;
+
+    for (int i = 0; i < count; i++)
+      iContiguousEnd(image_list[i], contiguous_list[i], output);
+
+    free(contiguous_list);
+  }
+
+  int Failed() const { return contiguous_list == NULL; }
+
+  operator imImage**() const { return contiguous_list; }
+  operator const imImage**() const { return (const imImage**)contiguous_list; }
+};
+
+#endif
@@ -0,0 +1,89 @@
+/** \file
+ * \brief Pixel Runs of Point Operations
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_PROCESS_RUN_H
+#define __IM_PROCESS_RUN_H
+
+#include <im.h>
+#include <im_image.h>
+#include <im_util.h>
+
+/* Point operations access the image data as runs of contiguous pixels.
+ * When all the images have no padding (single!=0) all the planes are a single run of depth*count pixels,
+ * otherwise each line of each plane is a run of width pixels. 
+ * Packed images (IM_IMAGE_PACKED) have one run per line with all the components, including alpha,
+ * so all the images of the operation must be packed with the same number of components. */
+
+static inline int imProcessRunCount(const imImage* image, int single)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->height;
+  return single? 1: image->depth*image->height;
+}
+
+static inline int imProcessRunSize(const imImage* image, int single)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->line_size / imDataTypeSize(image->data_type);
+  return single? image->depth*image->count: image->width;
+}
+
+static inline void* imProcessRunData(const imImage* image, int run, int single)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return (imbyte*)image->data[0] + run*image->line_stride;
+
+  if (single)
+    return image->data[0];
+
+  return (imbyte*)image->data[run / image->height] + (run % image->height)*image->line_stride;
+}
+
+/* Number of samples from one pixel to the next in the same plane, 
+ * the number of components of a packed image, 1 otherwise. */
+static inline int imProcessPixelStep(const imImage* image)
+{
+  if (image->flags & IM_IMAGE_PACKED)
+    return image->has_alpha? image->depth+1: image->depth;
+  return 1;
+}
+
+/* Number of samples from one line to the next in the same plane, for any layout. */
+static inline int imProcessLineStride(const imImage* image)
+{
+  return image->line_stride / imDataTypeSize(image->data_type);
+}
+
+/* First sample of a line in a plane, for any layout. 
+ * In a packed image the plane is a component and the next samples are imProcessPixelStep apart. */
+static inline void* imProcessLineData(const imImage* image, int plane, int line)
+{
+  return (imbyte*)image->data[plane] + line*image->line_stride;
+}
+
+/* Operations that must not change the alpha access only the depth planes, as runs of samples imProcessPixelStep apart.
+ * When all the images have no padding (single!=0) the planes are a single run of depth*count samples,
+ * otherwise each line of each plane is a run of width samples, also in packed images. */
+
+static inline int imProcessPlaneRunCount(const imImage* image, int single)
+{
+  return single? 1: image->depth*image->height;
+}
+
+static inline int imProcessPlaneRunSize(const imImage* image, int single)
+{
+  return single? image->depth*image->count: image->width;
+}
+
+static inline void* imProcessPlaneRunData(const imImage* image, int run, int single)
+{
+  if (single)
+    return image->data[0];
+
+  return imProcessLineData(image, run / image->height, run % image->height);
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <im_math.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 
 #include <stdlib.h>
@@ -19,6 +20,10 @@
 
 void imProcessQuantizeRGBUniform(const imImage* src_image, imImage* dst_image, int dither)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessQuantizeRGBUniform, src_image, dst_image, dither);
+
   imbyte *dst_map=(imbyte*)dst_image->data[0], 
          *red_map=(imbyte*)src_image->data[0],
          *green_map=(imbyte*)src_image->data[1],
@@ -45,6 +50,10 @@ void imProcessQuantizeRGBUniform(const imImage* src_image, imImage* dst_image, i
 
 void imProcessQuantizeGrayUniform(const imImage* src_image, imImage* dst_image, int grays)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessQuantizeGrayUniform, src_image, dst_image, grays);
+
   int i;
 
   imbyte *dst_map=(imbyte*)dst_image->data[0], 
@@ -10,6 +10,7 @@
 #include <im_math.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 
 #include <stdlib.h>
@@ -36,6 +37,10 @@ static void DoNormDiffRatio(T *map1, T *map2, float *new_map, int count)
 
 void imProcessNormDiffRatio(const imImage* image1, const imImage* image2, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(image1, image2, dst_image))
+    return imProcessContiguousCall(imProcessNormDiffRatio, image1, image2, dst_image);
+
   int count = image1->count;
 
   switch(image1->data_type)
@@ -171,6 +176,11 @@ static void DoAbnormalCorrection(T *map, T *new_map, int width, int height, imby
 
 void imProcessAbnormalHyperionCorrection(const imImage* src_image, imImage* dst_image, int threshold_consecutive, int threshold_percent, imImage* image_abnormal)
 {
+  imImageMakeWritable(dst_image);
+  imImageMakeWritable(image_abnormal);
+  if (!imProcessIsContiguous(src_image, dst_image, image_abnormal))
+    return imProcessContiguousCall(imProcessAbnormalHyperionCorrection, src_image, dst_image, threshold_consecutive, threshold_percent, image_abnormal);
+
   imImage* abnormal = image_abnormal;
   if (!image_abnormal)
     abnormal = imImageCreateBased(src_image, 0, 0, IM_BINARY, IM_BYTE);
@@ -11,6 +11,7 @@
 #include <im_color.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_pnt.h"
 
 #include <stdlib.h>
@@ -55,6 +56,10 @@ static int DoRenderCondOp(T *map, int width, int height, int d, imRenderCondFunc
 
 int imProcessRenderCondOp(imImage* image, imRenderCondFunc render_func, const char* render_name, float* param)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderCondOp, image, render_func, render_name, param);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin(render_name);
@@ -135,6 +140,10 @@ static int DoRenderOp(T *map, int width, int height, int d, imRenderFunc render_
 
 int imProcessRenderOp(imImage* image, imRenderFunc render_func, const char* render_name, float* param, int plus)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderOp, image, render_func, render_name, param, plus);
+
   int ret = 0;
 
   int counter = imProcessCounterBegin(render_name);
@@ -187,6 +196,10 @@ static float do_add_specklenoise(int, int, int, int *cond, float* param)
 
 int imProcessRenderAddSpeckleNoise(const imImage* src_image, imImage* dst_image, float percent)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRenderAddSpeckleNoise, src_image, dst_image, percent);
+
   float param[2];
   param[0] = (float)imColorMax(src_image->data_type);
   param[1] = percent / 100.0f;
@@ -214,6 +227,10 @@ static float do_add_gaussiannoise(int, int, int, float* param)
 
 int imProcessRenderAddGaussianNoise(const imImage* src_image, imImage* dst_image, float mean, float stddev)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRenderAddGaussianNoise, src_image, dst_image, mean, stddev);
+
   float param[2];
   param[0] = mean;
   param[1] = stddev;
@@ -231,6 +248,10 @@ static float do_add_uniformnoise(int, int, int, float* param)
 
 int imProcessRenderAddUniformNoise(const imImage* src_image, imImage* dst_image, float mean, float stddev)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessRenderAddUniformNoise, src_image, dst_image, mean, stddev);
+
   float param[2];
   param[0] = mean;
   param[1] = stddev;
@@ -246,6 +267,10 @@ static float do_const(int, int, int d, float* param)
 
 int imProcessRenderConstant(imImage* image, float* value)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderConstant, image, value);
+
   return imProcessRenderOp(image, do_const, "Constant", value, 0);
 }
 
@@ -256,6 +281,10 @@ static float do_noise(int, int, int, float* param)
 
 int imProcessRenderRandomNoise(imImage* image)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderRandomNoise, image);
+
   static float param[1];
   param[0] = (float)imColorMax(image->data_type);
   srand((unsigned)time(NULL));
@@ -269,6 +298,10 @@ static float do_cosine(int x, int y, int, float* param)
 
 int imProcessRenderCosine(imImage* image, float xperiod, float yperiod)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderCosine, image, xperiod, yperiod);
+
   float param[6];
   param[0] = (float)imColorMax(image->data_type);
 
@@ -303,6 +336,10 @@ static float do_gaussian(int x, int y, int, float* param)
 
 int imProcessRenderGaussian(imImage* image, float stddev)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderGaussian, image, stddev);
+
   float param[4];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = -1.0f / (2.0f * stddev * stddev);
@@ -323,6 +360,10 @@ static float do_lapgauss(int x, int y, int, float* param)
 
 int imProcessRenderLapOfGaussian(imImage* image, float stddev)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderLapOfGaussian, image, stddev);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = -1.0f / (2.0f * stddev * stddev);
@@ -348,6 +389,10 @@ static float do_sinc(int x, int y, int, float* param)
 
 int imProcessRenderSinc(imImage* image, float xperiod, float yperiod)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderSinc, image, xperiod, yperiod);
+
   float param[6];
   param[0] = (float)imColorMax(image->data_type);
 
@@ -384,6 +429,10 @@ static float do_box(int x, int y, int, float* param)
 
 int imProcessRenderBox(imImage* image, int width, int height)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderBox, image, width, height);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = width/2.0f;
@@ -417,6 +466,10 @@ static float do_ramp(int x, int y, int, float* param)
 
 int imProcessRenderRamp(imImage* image, int start, int end, int dir)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderRamp, image, start, end, dir);
+
   float param[4];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = (float)start;
@@ -447,6 +500,10 @@ static float do_tent(int x, int y, int, float* param)
 
 int imProcessRenderTent(imImage* image, int width, int height)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderTent, image, width, height);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = width/2.0f;
@@ -470,6 +527,10 @@ static float do_cone(int x, int y, int, float* param)
 
 int imProcessRenderCone(imImage* image, int radius)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderCone, image, radius);
+
   float param[4];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = (float)radius;
@@ -492,6 +553,10 @@ static float do_wheel(int x, int y, int, float* param)
 
 int imProcessRenderWheel(imImage* image, int int_radius, int ext_radius)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderWheel, image, int_radius, ext_radius);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = (float)int_radius;
@@ -513,6 +578,10 @@ static float do_grid(int x, int y, int, float* param)
 
 int imProcessRenderGrid(imImage* image, int x_space, int y_space)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderGrid, image, x_space, y_space);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = (float)x_space;
@@ -541,6 +610,10 @@ static float do_chessboard(int x, int y, int, float* param)
 
 int imProcessRenderChessboard(imImage* image, int x_space, int y_space)
 {
+  imImageMakeWritable(image);
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessRenderChessboard, image, x_space, y_space);
+
   float param[5];
   param[0] = (float)imColorMax(image->data_type);
   param[1] = (float)x_space*2;
@@ -9,9 +9,12 @@
 #include <im_util.h>
 #include <im_math.h>
 #include <im_complex.h>
+#include <im_profile.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_loc.h"
+#include "im_process_run.h"
 
 #include <stdlib.h>
 #include <memory.h>
@@ -24,8 +27,8 @@ static inline void iResizeInverse(int x, int y, float *xl, float *yl, float x_in
 }
 
 template <class DT, class DTU> 
-static int iResize(int src_width, int src_height, const DT *src_map, 
-                         int dst_width, int dst_height, DT *dst_map, 
+static int iResize(int src_width, int src_height, const DT *src_map, int src_stride, int src_step, 
+                         int dst_width, int dst_height, DT *dst_map, int dst_stride, int dst_step, 
                          DTU Dummy, int order, int counter)
 {
   float x_invfactor = float(src_width)/float(dst_width);
@@ -43,7 +46,7 @@ static int iResize(int src_width, int src_height, const DT *src_map,
 #endif
     IM_BEGIN_PROCESSING;
 
-    int line_offset = y*dst_width;
+    int line_offset = y*dst_stride;
 
     for (int x = 0; x < dst_width; x++)
     {
@@ -54,11 +57,11 @@ static int iResize(int src_width, int src_height, const DT *src_map,
       if (xl > 0.0 && yl > 0.0 && xl < src_width && yl < src_height)
       {
         if (order == 1)
-          dst_map[line_offset+x] = imBilinearInterpolation(src_width, src_height, src_map, xl, yl);
+          dst_map[line_offset + x*dst_step] = imBilinearInterpolation(src_width, src_height, src_map, src_stride, src_step, xl, yl);
         else if (order == 3)
-          dst_map[line_offset+x] = imBicubicInterpolation(src_width, src_height, src_map, xl, yl, Dummy);
+          dst_map[line_offset + x*dst_step] = imBicubicInterpolation(src_width, src_height, src_map, src_stride, src_step, xl, yl, Dummy);
         else
-          dst_map[line_offset+x] = imZeroOrderInterpolation(src_width, src_height, src_map, xl, yl);
+          dst_map[line_offset + x*dst_step] = imZeroOrderInterpolation(src_width, src_height, src_map, src_stride, src_step, xl, yl);
       }
     }
 
@@ -73,8 +76,8 @@ static int iResize(int src_width, int src_height, const DT *src_map,
 }
 
 template <class DT, class DTU> 
-static int iReduce(int src_width, int src_height, const DT *src_map, 
-                         int dst_width, int dst_height, DT *dst_map, 
+static int iReduce(int src_width, int src_height, const DT *src_map, int src_stride, int src_step, 
+                         int dst_width, int dst_height, DT *dst_map, int dst_stride, int dst_step, 
                          DTU Dummy, int order, int counter)
 {
   float x_invfactor = float(src_width)/float(dst_width);
@@ -100,7 +103,7 @@ static int iReduce(int src_width, int src_height, const DT *src_map,
 #endif
     IM_BEGIN_PROCESSING;
 
-    int line_offset = y*dst_width;
+    int line_offset = y*dst_stride;
 
     for (int x = 0; x < dst_width; x++)
     {
@@ -111,9 +114,9 @@ static int iReduce(int src_width, int src_height, const DT *src_map,
       if (xl > 0.0 && yl > 0.0 && xl < src_width && yl < src_height)
       {
         if (order == 0)
-          dst_map[line_offset+x] = imZeroOrderDecimation(src_width, src_height, src_map, xl, yl, box_width, box_height, Dummy);
+          dst_map[line_offset + x*dst_step] = imZeroOrderDecimation(src_width, src_height, src_map, src_stride, src_step, xl, yl, box_width, box_height, Dummy);
         else
-          dst_map[line_offset+x] = imBilinearDecimation(src_width, src_height, src_map, xl, yl, box_width, box_height, Dummy);
+          dst_map[line_offset + x*dst_step] = imBilinearDecimation(src_width, src_height, src_map, src_stride, src_step, xl, yl, box_width, box_height, Dummy);
       }
     }
 
@@ -129,8 +132,13 @@ static int iReduce(int src_width, int src_height, const DT *src_map,
 
 int imProcessReduce(const imImage* src_image, imImage* dst_image, int order)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
   int counter = imProcessCounterBegin("Reduce Size");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* int_msg = (order == 1)? "Bilinear Decimation": "Zero Order Decimation";
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, int_msg);
@@ -140,33 +148,33 @@ int imProcessReduce(const imImage* src_image, imImage* dst_image, int order)
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      ret = iReduce(src_image->width, src_image->height, (const imbyte*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imbyte*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const imbyte*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imbyte*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_SHORT:
-      ret = iReduce(src_image->width, src_image->height, (const short*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (short*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const short*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (short*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_USHORT:
-      ret = iReduce(src_image->width, src_image->height, (const imushort*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imushort*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const imushort*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imushort*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_INT:
-      ret = iReduce(src_image->width, src_image->height, (const int*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (int*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const int*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (int*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_FLOAT:
-      ret = iReduce(src_image->width, src_image->height, (const float*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (float*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const float*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (float*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_CFLOAT:
-      ret = iReduce(src_image->width, src_image->height, (const imcfloat*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imcfloat*)dst_image->data[i], 
+      ret = iReduce(src_image->width, src_image->height, (const imcfloat*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imcfloat*)dst_image->data[i], dst_stride, dst_step, 
                     imcfloat(0,0), order, counter);
       break;
     }
@@ -178,8 +186,13 @@ int imProcessReduce(const imImage* src_image, imImage* dst_image, int order)
 
 int imProcessResize(const imImage* src_image, imImage* dst_image, int order)
 {
+  imImageMakeWritable(dst_image);
+
   int ret = 0;
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
   int counter = imProcessCounterBegin("Resize");
+  imProfileAddData(dst_image->count, (double)src_image->size + dst_image->size);
   const char* int_msg = (order == 3)? "Bicubic Interpolation": (order == 1)? "Bilinear Interpolation": "Zero Order Interpolation";
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
   imCounterTotal(counter, src_depth*dst_image->height, int_msg);
@@ -189,33 +202,33 @@ int imProcessResize(const imImage* src_image, imImage* dst_image, int order)
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      ret = iResize(src_image->width, src_image->height, (const imbyte*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imbyte*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const imbyte*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imbyte*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_SHORT:
-      ret = iResize(src_image->width, src_image->height, (const short*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (short*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const short*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (short*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_USHORT:
-      ret = iResize(src_image->width, src_image->height, (const imushort*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imushort*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const imushort*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imushort*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_INT:
-      ret = iResize(src_image->width, src_image->height, (const int*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (int*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const int*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (int*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_FLOAT:
-      ret = iResize(src_image->width, src_image->height, (const float*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (float*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const float*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (float*)dst_image->data[i], dst_stride, dst_step, 
                     float(0), order, counter);
       break;
     case IM_CFLOAT:
-      ret = iResize(src_image->width, src_image->height, (const imcfloat*)src_image->data[i],  
-                    dst_image->width, dst_image->height, (imcfloat*)dst_image->data[i], 
+      ret = iResize(src_image->width, src_image->height, (const imcfloat*)src_image->data[i], src_stride, src_step, 
+                    dst_image->width, dst_image->height, (imcfloat*)dst_image->data[i], dst_stride, dst_step, 
                     imcfloat(0,0), order, counter);
       break;
     }
@@ -229,12 +242,12 @@ template <class DT>
 static void ReduceBy4(int src_width, 
                       int src_height, 
                       DT *src_map, 
-                      int dst_width,
-                      int dst_height,
-                      DT *dst_map)
+                      int src_stride,
+                      int src_step,
+                      DT *dst_map,
+                      int dst_stride,
+                      int dst_step)
 {
-  (void)dst_height;
-
   // make an even size
   int height = (src_height/2)*2;
   int width = (src_width/2)*2;
@@ -248,17 +261,21 @@ static void ReduceBy4(int src_width,
     for(int x = 0 ; x < width; x += 2)
     {
       int xd = x/2;
-      dst_map[yd * dst_width + xd] = ((src_map[y * src_width + x] + 
-                                       src_map[y * src_width + (x+1)] +
-                                       src_map[(y+1) * src_width + x] +
-                                       src_map[(y+1) * src_width + (x+1)])/4);
+      dst_map[yd * dst_stride + xd * dst_step] = ((src_map[y * src_stride + x * src_step] + 
+                                                   src_map[y * src_stride + (x+1) * src_step] +
+                                                   src_map[(y+1) * src_stride + x * src_step] +
+                                                   src_map[(y+1) * src_stride + (x+1) * src_step])/4);
     }        
   }
 }
 
 void imProcessReduceBy4(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   int i;
+  int src_stride = imProcessLineStride(src_image), src_step = imProcessPixelStep(src_image);
+  int dst_stride = imProcessLineStride(dst_image), dst_step = imProcessPixelStep(dst_image);
   int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
 
   for (i = 0; i < src_depth; i++)
@@ -266,22 +283,22 @@ void imProcessReduceBy4(const imImage* src_image, imImage* dst_image)
     switch(src_image->data_type)
     {
     case IM_BYTE:
-      ReduceBy4(src_image->width, src_image->height, (imbyte*)src_image->data[i],  dst_image->width, dst_image->height, (imbyte*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (imbyte*)src_image->data[i], src_stride, src_step, (imbyte*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_SHORT:
-      ReduceBy4(src_image->width, src_image->height, (short*)src_image->data[i],  dst_image->width, dst_image->height, (short*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (short*)src_image->data[i], src_stride, src_step, (short*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_USHORT:
-      ReduceBy4(src_image->width, src_image->height, (imushort*)src_image->data[i],  dst_image->width, dst_image->height, (imushort*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (imushort*)src_image->data[i], src_stride, src_step, (imushort*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_INT:
-      ReduceBy4(src_image->width, src_image->height, (int*)src_image->data[i],  dst_image->width, dst_image->height, (int*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (int*)src_image->data[i], src_stride, src_step, (int*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_FLOAT:
-      ReduceBy4(src_image->width, src_image->height, (float*)src_image->data[i],  dst_image->width, dst_image->height, (float*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (float*)src_image->data[i], src_stride, src_step, (float*)dst_image->data[i], dst_stride, dst_step);
       break;
     case IM_CFLOAT:
-      ReduceBy4(src_image->width, src_image->height, (imcfloat*)src_image->data[i],  dst_image->width, dst_image->height, (imcfloat*)dst_image->data[i]);
+      ReduceBy4(src_image->width, src_image->height, (imcfloat*)src_image->data[i], src_stride, src_step, (imcfloat*)dst_image->data[i], dst_stride, dst_step);
       break;
     }
   }
@@ -289,8 +306,13 @@ void imProcessReduceBy4(const imImage* src_image, imImage* dst_image)
 
 void imProcessCrop(const imImage* src_image, imImage* dst_image, int xmin, int ymin)
 {
-  int type_size = imDataTypeSize(src_image->data_type);
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, dst_image))
+    return imProcessContiguousCall(imProcessCrop, src_image, dst_image, xmin, ymin);
+
+  /* lines are addressed by the line stride, and packed images have a single plane */
+  int pixel_size = imProcessPixelSize(src_image);
+  int src_depth = imProcessPlaneCount(src_image);
   for (int i = 0; i < src_depth; i++)
   {
     imbyte *src_map = (imbyte*)src_image->data[i];
@@ -301,8 +323,8 @@ void imProcessCrop(const imImage* src_image, imImage* dst_image, int xmin, int y
 #endif
     for (int y = 0; y < dst_image->height; y++)
     {
-      int src_offset = (y + ymin)*src_image->line_size + xmin*type_size;
-      int dst_offset = y*dst_image->line_size;
+      int src_offset = (y + ymin)*src_image->line_stride + xmin*pixel_size;
+      int dst_offset = y*dst_image->line_stride;
 
       memcpy(&dst_map[dst_offset], &src_map[src_offset], dst_image->line_size);
     }
@@ -311,15 +333,21 @@ void imProcessCrop(const imImage* src_image, imImage* dst_image, int xmin, int y
 
 void imProcessInsert(const imImage* src_image, const imImage* rgn_image, imImage* dst_image, int xmin, int ymin)
 {
-  int type_size = imDataTypeSize(src_image->data_type);
-  int dst_size1 = xmin*type_size;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, rgn_image, dst_image))
+    return imProcessContiguousCall(imProcessInsert, src_image, rgn_image, dst_image, xmin, ymin);
+
+  int pixel_size = imProcessPixelSize(src_image);
+  int dst_size1 = xmin*pixel_size;
   int dst_size2 = src_image->line_size - (rgn_image->line_size + dst_size1);
   int dst_offset2 = dst_size1+rgn_image->line_size;
   int ymax = ymin+rgn_image->height-1;
   int rgn_size, rgn_line_size = rgn_image->line_size;
   int src_line_size = src_image->line_size;
-  int dst_line_size = dst_image->line_size;
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  int src_line_stride = src_image->line_stride;
+  int rgn_line_stride = rgn_image->line_stride;
+  int dst_line_stride = dst_image->line_stride;
+  int src_depth = imProcessPlaneCount(src_image);
 
   if (dst_size2 < 0)
   {
@@ -347,23 +375,23 @@ void imProcessInsert(const imImage* src_image, const imImage* rgn_image, imImage
       if (y < ymin || y > ymax)
       {
         if (dst_map != src_map)  // avoid in-place processing
-          memcpy(dst_map + y*dst_line_size, src_map + y*src_line_size, src_line_size);
+          memcpy(dst_map + y*dst_line_stride, src_map + y*src_line_stride, src_line_size);
       }
       else
       {
         if (dst_size1)
         {
           if (dst_map != src_map)  // avoid in-place processing
-            memcpy(dst_map + y*dst_line_size, src_map + y*src_line_size, dst_size1);
+            memcpy(dst_map + y*dst_line_stride, src_map + y*src_line_stride, dst_size1);
         }
 
-        memcpy(dst_map + y*dst_line_size + dst_size1, rgn_map + (y-ymin)*rgn_line_size, rgn_size);
+        memcpy(dst_map + y*dst_line_stride + dst_size1, rgn_map + (y-ymin)*rgn_line_stride, rgn_size);
 
         if (dst_size2)
         {
           if (dst_map != src_map)  // avoid in-place processing
-            memcpy(dst_map + y*dst_line_size + dst_offset2, 
-                   src_map + y*src_line_size + dst_offset2, dst_size2);
+            memcpy(dst_map + y*dst_line_stride + dst_offset2, 
+                   src_map + y*src_line_stride + dst_offset2, dst_size2);
         }
       }
     }
@@ -372,8 +400,12 @@ void imProcessInsert(const imImage* src_image, const imImage* rgn_image, imImage
 
 void imProcessAddMargins(const imImage* src_image, imImage* dst_image, int xmin, int ymin)
 {
-  int type_size = imDataTypeSize(src_image->data_type);
-  int src_depth = src_image->has_alpha? src_image->depth+1: src_image->depth;
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsSameLayout(src_image, dst_image))
+    return imProcessContiguousCall(imProcessAddMargins, src_image, dst_image, xmin, ymin);
+
+  int pixel_size = imProcessPixelSize(src_image);
+  int src_depth = imProcessPlaneCount(src_image);
   for (int i = 0; i < src_depth; i++)
   {
     imbyte *dst_map = (imbyte*)dst_image->data[i];
@@ -384,8 +416,8 @@ void imProcessAddMargins(const imImage* src_image, imImage* dst_image, int xmin,
 #endif
     for (int y = 0; y < src_image->height; y++)
     {
-      int src_offset = y*src_image->line_size;
-      int dst_offset = (y + ymin)*dst_image->line_size + xmin*type_size;
+      int src_offset = y*src_image->line_stride;
+      int dst_offset = (y + ymin)*dst_image->line_stride + xmin*pixel_size;
 
       memcpy(&dst_map[dst_offset], &src_map[src_offset], src_image->line_size);
     }
@@ -11,6 +11,7 @@
 #include <im_math_op.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
 #include "im_process_ana.h"
 
 #include <stdlib.h>
@@ -62,6 +63,9 @@ void imCalcShortHistogram(const short* map, int size, unsigned long* histo, int
 
 void imCalcHistogram(const imImage* src_image, unsigned long* histo, int plane, int cumulative)
 {
+  if (!imProcessIsContiguous(src_image))
+    return imProcessContiguousCall(imCalcHistogram, src_image, histo, plane, cumulative);
+
   switch (src_image->data_type)
   {
   case IM_BYTE:
@@ -78,6 +82,9 @@ void imCalcHistogram(const imImage* src_image, unsigned long* histo, int plane,
 
 void imCalcGrayHistogram(const imImage* image, unsigned long* histo, int cumulative)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcGrayHistogram, image, histo, cumulative);
+
   int hcount = imHistogramCount(image->data_type);
 
   if (image->color_space == IM_GRAY)
@@ -227,6 +234,9 @@ static unsigned long count_comp(const imImage* image)
 
 unsigned long imCalcCountColors(const imImage* image)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcCountColors, image);
+
   if (imColorModeDepth(image->color_space) > 1)
     return count_comp(image);
   else
@@ -281,6 +291,9 @@ static void DoStats(T* data, int count, imStats* stats)
 
 void imCalcImageStatistics(const imImage* image, imStats* stats)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcImageStatistics, image, stats);
+
   for (int i = 0; i < image->depth; i++)
   {
     switch(image->data_type)
@@ -306,6 +319,9 @@ void imCalcImageStatistics(const imImage* image, imStats* stats)
 
 void imCalcHistogramStatistics(const imImage* image, imStats* stats)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcHistogramStatistics, image, stats);
+
   int hcount;
   unsigned long* histo = imHistogramNew(image->data_type, &hcount);
 
@@ -321,6 +337,9 @@ void imCalcHistogramStatistics(const imImage* image, imStats* stats)
 
 void imCalcHistoImageStatistics(const imImage* image, int* median, int* mode)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcHistoImageStatistics, image, median, mode);
+
   int hcount;
   unsigned long* histo = imHistogramNew(image->data_type, &hcount);
 
@@ -374,6 +393,9 @@ void imCalcHistoImageStatistics(const imImage* image, int* median, int* mode)
 
 void imCalcPercentMinMax(const imImage* image, float percent, int ignore_zero, int *min, int *max)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imCalcPercentMinMax, image, percent, ignore_zero, min, max);
+
   int zero = -imHistogramShift(image->data_type);
   int hcount;
   unsigned long* histo = imHistogramNew(image->data_type, &hcount);
@@ -424,6 +446,9 @@ void imCalcPercentMinMax(const imImage* image, float percent, int ignore_zero, i
 
 float imCalcSNR(const imImage* image, const imImage* noise_image)
 {
+  if (!imProcessIsContiguous(image, noise_image))
+    return imProcessContiguousCall(imCalcSNR, image, noise_image);
+
   imStats stats[4];
   imCalcImageStatistics((imImage*)image, stats);
 
@@ -465,6 +490,9 @@ static double DoRMSOp(T *map1, T *map2, int count)
   
 float imCalcRMSError(const imImage* image1, const imImage* image2)
 {
+  if (!imProcessIsContiguous(image1, image2))
+    return imProcessContiguousCall(imCalcRMSError, image1, image2);
+
   double rmserror = 0;
 
   int count = image1->count*image1->depth;
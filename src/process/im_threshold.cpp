@@ -9,6 +9,8 @@
 #include <im_util.h>
 
 #include "im_process_counter.h"
+#include "im_process_layout.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 #include "im_process_ana.h"
 
@@ -20,123 +22,162 @@
 
 
 template <class T> 
-static void doThresholdSlice(T *src_map, imbyte *dst_map, int count, T start_level, T end_level)
+static void doThresholdSlice(T *src_map, int src_step, imbyte *dst_map, int dst_step, int count, T start_level, T end_level)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
-    if (src_map[i] < start_level || src_map[i] > end_level)
-      dst_map[i] = 0;
+    T value = src_map[i*src_step];
+    if (value < start_level || value > end_level)
+      dst_map[i*dst_step] = 0;
     else
-      dst_map[i] = 1;
+      dst_map[i*dst_step] = 1;
   }
 }
 
 void imProcessSliceThreshold(const imImage* src_image, imImage* dst_image, float start_level, float end_level)
 {
-  switch(src_image->data_type)
+  imImageMakeWritable(dst_image);
+
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(dst_image, single);
+  int count = imProcessPlaneRunSize(dst_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    doThresholdSlice((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (imbyte)start_level, (imbyte)end_level);
-    break;                                                                                
-  case IM_SHORT:                                                                           
-    doThresholdSlice((short*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (short)start_level, (short)end_level);
-    break;                                                                                
-  case IM_USHORT:                                                                           
-    doThresholdSlice((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (imushort)start_level, (imushort)end_level);
-    break;                                                                                
-  case IM_INT:                                                                           
-    doThresholdSlice((int*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (int)start_level, (int)end_level);
-    break;                                                                                
-  case IM_FLOAT:
-    doThresholdSlice((float*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (float)start_level, (float)end_level);
-    break;                                                                                
+    void* src_map = imProcessPlaneRunData(src_image, run, single);
+    imbyte* dst_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+
+    switch(src_image->data_type)
+    {
+    case IM_BYTE:
+      doThresholdSlice((imbyte*)src_map, src_step, dst_map, dst_step, count, (imbyte)start_level, (imbyte)end_level);
+      break;                                                                                
+    case IM_SHORT:                                                                           
+      doThresholdSlice((short*)src_map, src_step, dst_map, dst_step, count, (short)start_level, (short)end_level);
+      break;                                                                                
+    case IM_USHORT:                                                                           
+      doThresholdSlice((imushort*)src_map, src_step, dst_map, dst_step, count, (imushort)start_level, (imushort)end_level);
+      break;                                                                                
+    case IM_INT:                                                                           
+      doThresholdSlice((int*)src_map, src_step, dst_map, dst_step, count, (int)start_level, (int)end_level);
+      break;                                                                                
+    case IM_FLOAT:
+      doThresholdSlice((float*)src_map, src_step, dst_map, dst_step, count, (float)start_level, (float)end_level);
+      break;                                                                                
+    }
   }
 }
 
 template <class T> 
-static void doThresholdByDiff(T *src_map1, T *src_map2, imbyte *dst_map, int count)
+static void doThresholdByDiff(T *src_map1, int src_step1, T *src_map2, int src_step2, imbyte *dst_map, int dst_step, int count)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
-    if (src_map1[i] <= src_map2[i])
-      dst_map[i] = 0;
+    if (src_map1[i*src_step1] <= src_map2[i*src_step2])
+      dst_map[i*dst_step] = 0;
     else
-      dst_map[i] = 1;
+      dst_map[i*dst_step] = 1;
   }
 }
 
 void imProcessThresholdByDiff(const imImage* src_image1, const imImage* src_image2, imImage* dst_image)
 {
-  switch(src_image1->data_type)
+  imImageMakeWritable(dst_image);
+
+  int single = imImageIsContiguous(src_image1) && 
+               imImageIsContiguous(src_image2) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(dst_image, single);
+  int count = imProcessPlaneRunSize(dst_image, single);
+  int src_step1 = imProcessPixelStep(src_image1);
+  int src_step2 = imProcessPixelStep(src_image2);
+  int dst_step = imProcessPixelStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    doThresholdByDiff((imbyte*)src_image1->data[0], (imbyte*)src_image2->data[0], (imbyte*)dst_image->data[0], src_image1->count);
-    break;                                                                                
-  case IM_SHORT:                                                                           
-    doThresholdByDiff((short*)src_image1->data[0], (short*)src_image2->data[0], (imbyte*)dst_image->data[0], src_image1->count);
-    break;                                                                                
-  case IM_USHORT:                                                                           
-    doThresholdByDiff((imushort*)src_image1->data[0], (imushort*)src_image2->data[0], (imbyte*)dst_image->data[0], src_image1->count);
-    break;                                                                                
-  case IM_INT:                                                                           
-    doThresholdByDiff((int*)src_image1->data[0], (int*)src_image2->data[0], (imbyte*)dst_image->data[0], src_image1->count);
-    break;                                                                                
-  case IM_FLOAT:
-    doThresholdByDiff((float*)src_image1->data[0], (float*)src_image2->data[0], (imbyte*)dst_image->data[0], src_image1->count);
-    break;                                                                                
+    void* src_map1 = imProcessPlaneRunData(src_image1, run, single);
+    void* src_map2 = imProcessPlaneRunData(src_image2, run, single);
+    imbyte* dst_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+
+    switch(src_image1->data_type)
+    {
+    case IM_BYTE:
+      doThresholdByDiff((imbyte*)src_map1, src_step1, (imbyte*)src_map2, src_step2, dst_map, dst_step, count);
+      break;                                                                                
+    case IM_SHORT:                                                                           
+      doThresholdByDiff((short*)src_map1, src_step1, (short*)src_map2, src_step2, dst_map, dst_step, count);
+      break;                                                                                
+    case IM_USHORT:                                                                           
+      doThresholdByDiff((imushort*)src_map1, src_step1, (imushort*)src_map2, src_step2, dst_map, dst_step, count);
+      break;                                                                                
+    case IM_INT:                                                                           
+      doThresholdByDiff((int*)src_map1, src_step1, (int*)src_map2, src_step2, dst_map, dst_step, count);
+      break;                                                                                
+    case IM_FLOAT:
+      doThresholdByDiff((float*)src_map1, src_step1, (float*)src_map2, src_step2, dst_map, dst_step, count);
+      break;                                                                                
+    }
   }
 }
 
 template <class T> 
-static void doThreshold(T *src_map, imbyte *dst_map, int count, T level, int value)
+static void doThreshold(T *src_map, int src_step, imbyte *dst_map, int dst_step, int count, T level, int value)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
-    if (src_map[i] <= level)
-      dst_map[i] = 0;
+    if (src_map[i*src_step] <= level)
+      dst_map[i*dst_step] = 0;
     else
-      dst_map[i] = (imbyte)value;
+      dst_map[i*dst_step] = (imbyte)value;
   }
 }
 
 void imProcessThreshold(const imImage* src_image, imImage* dst_image, float level, int value)
 {
-  switch(src_image->data_type)
+  imImageMakeWritable(dst_image);
+
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(dst_image, single);
+  int count = imProcessPlaneRunSize(dst_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_BYTE:
-    doThreshold((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (imbyte)level, value);
-    break;                                                                                
-  case IM_SHORT:                                                                           
-    doThreshold((short*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (short)level, value);
-    break;                                                                                
-  case IM_USHORT:                                                                           
-    doThreshold((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (imushort)level, value);
-    break;                                                                                
-  case IM_INT:                                                                           
-    doThreshold((int*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (int)level, value);
-    break;                                                                                
-  case IM_FLOAT:
-    doThreshold((float*)src_image->data[0], (imbyte*)dst_image->data[0], 
-                             src_image->count, (float)level, value);
-    break;                                                                                
+    void* src_map = imProcessPlaneRunData(src_image, run, single);
+    imbyte* dst_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+
+    switch(src_image->data_type)
+    {
+    case IM_BYTE:
+      doThreshold((imbyte*)src_map, src_step, dst_map, dst_step, count, (imbyte)level, value);
+      break;                                                                                
+    case IM_SHORT:                                                                           
+      doThreshold((short*)src_map, src_step, dst_map, dst_step, count, (short)level, value);
+      break;                                                                                
+    case IM_USHORT:                                                                           
+      doThreshold((imushort*)src_map, src_step, dst_map, dst_step, count, (imushort)level, value);
+      break;                                                                                
+    case IM_INT:                                                                           
+      doThreshold((int*)src_map, src_step, dst_map, dst_step, count, (int)level, value);
+      break;                                                                                
+    case IM_FLOAT:
+      doThreshold((float*)src_map, src_step, dst_map, dst_step, count, (float)level, value);
+      break;                                                                                
+    }
   }
 }
 
@@ -244,6 +285,10 @@ static int thresUniErr(unsigned char* band, int width, int height)
 
 int imProcessUniformErrThreshold(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessUniformErrThreshold, src_image, dst_image);
+
   int level = thresUniErr((imbyte*)src_image->data[0], src_image->width, src_image->height);
   imProcessThreshold(src_image, dst_image, (float)level, 1);
   return level;
@@ -272,6 +317,10 @@ static void do_dither_error(imbyte* data1, imbyte* data2, int size, int t, int v
 
 void imProcessDifusionErrThreshold(const imImage* src_image, imImage* dst_image, int level)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessDifusionErrThreshold, src_image, dst_image, level);
+
   int value = src_image->depth > 1? 255: 1;
   for (int i = 0; i < src_image->depth; i++)
   {
@@ -281,6 +330,8 @@ void imProcessDifusionErrThreshold(const imImage* src_image, imImage* dst_image,
 
 int imProcessPercentThreshold(const imImage* src_image, imImage* dst_image, float percent)
 {
+  imImageMakeWritable(dst_image);
+
   int hcount;
   unsigned long* histo = imHistogramNew(src_image->data_type, &hcount);
 
@@ -339,6 +390,8 @@ static int MaximizeDiscriminantFunction(double* p, int count)
 
 int imProcessOtsuThreshold(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   int hcount;
   unsigned long* histo = imHistogramNew(src_image->data_type, &hcount);
 
@@ -363,6 +416,8 @@ int imProcessOtsuThreshold(const imImage* src_image, imImage* dst_image)
 
 float imProcessMinMaxThreshold(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   imStats stats;
   imCalcImageStatistics(src_image, &stats);
   float level = (stats.max - stats.min)/2.0f;
@@ -372,6 +427,9 @@ float imProcessMinMaxThreshold(const imImage* src_image, imImage* dst_image)
 
 void imProcessHysteresisThresEstimate(const imImage* image, int *low_thres, int *high_thres)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessHysteresisThresEstimate, image, low_thres, high_thres);
+
   int hcount;
   unsigned long* histo = imHistogramNew(image->data_type, &hcount);
 
@@ -461,6 +519,10 @@ static void doHysteresisThreshold(T *src_map, imbyte *dst_map, int width, int he
 
 void imProcessHysteresisThreshold(const imImage* src_image, imImage* dst_image, int low_thres, int high_thres)
 {
+  imImageMakeWritable(dst_image);
+  if (!imProcessIsContiguous(src_image, dst_image))
+    return imProcessContiguousCall(imProcessHysteresisThreshold, src_image, dst_image, low_thres, high_thres);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
@@ -488,6 +550,9 @@ void imProcessHysteresisThreshold(const imImage* src_image, imImage* dst_image,
 
 void imProcessLocalMaxThresEstimate(const imImage* image, int *thres)
 {
+  if (!imProcessIsContiguous(image))
+    return imProcessContiguousCall(imProcessLocalMaxThresEstimate, image, thres);
+
   int hcount;
   unsigned long* histo = imHistogramNew(image->data_type, &hcount);
 
@@ -11,6 +11,7 @@
 #include <im_colorhsi.h>
 
 #include "im_process_counter.h"
+#include "im_process_run.h"
 #include "im_process_pnt.h"
 #include "im_process_ana.h"
 
@@ -110,21 +111,58 @@ static inline float norm_exp_op(const T& v, const T& min, const T& range, const
 }
 
 template <class T> 
-static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *args)
+static void DoMinMax(const imImage* image, int single, T& min, T& max)
 {
-  int i;
-  T min, max, range;
+  int run_count = imProcessPlaneRunCount(image, single);
+  int count = imProcessPlaneRunSize(image, single);
+  int step = imProcessPixelStep(image);
 
-  if (op & IM_GAMUT_MINMAX)
+  /* same as imMinMaxType for all the runs */
+  if (sizeof(T) == sizeof(imbyte))
   {
-    min = (T)args[0];
-    max = (T)args[1];
-    args += 2;
+    min = 0;
+    max = (T)255;
+    return;
   }
-  else
-    imMinMaxType(map, count, min, max);
 
-  range = max-min;
+  min = *(T*)imProcessPlaneRunData(image, 0, single);
+  max = min;
+
+  for (int run = 0; run < run_count; run++)
+  {
+    T* map = (T*)imProcessPlaneRunData(image, run, single);
+
+    if (step == 1)
+    {
+      T run_min, run_max;
+      imMinMax(map, count, run_min, run_max);
+      if (run_max > max) max = run_max;
+      if (run_min < min) min = run_min;
+      continue;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+      T value = map[i*step];
+      if (value > max) max = value;
+      if (value < min) min = value;
+    }
+  }
+
+  if (min == max)
+  {
+    max = min + 1;
+
+    if (min != 0)
+      min = min - 1;
+  }
+}
+
+template <class T> 
+static void DoNormalizedUnaryOp(T *map, int src_step, T *new_map, int dst_step, int count, int op, float *args, T min, T max)
+{
+  int i;
+  T range = max-min;
   
   switch(op & 0x00FF)
   {
@@ -136,7 +174,7 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
         for (i = 0; i < count; i++)
-          new_map[i] = (T)map[i];
+          new_map[i*dst_step] = (T)map[i*src_step];
       }
       else
       {
@@ -144,7 +182,7 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
         for (i = 0; i < count; i++)
-          new_map[i] = normal_op(map[i], min, range);
+          new_map[i*dst_step] = normal_op(map[i*src_step], min, range);
       }
       break;
     }
@@ -153,14 +191,14 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      new_map[i] = (T)(invert_op(map[i], min, range)*range + min);
+      new_map[i*dst_step] = (T)(invert_op(map[i*src_step], min, range)*range + min);
     break;
   case IM_GAMUT_ZEROSTART:
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      new_map[i] = (T)zerostart_op(map[i], min);
+      new_map[i*dst_step] = (T)zerostart_op(map[i*src_step], min);
     break;
   case IM_GAMUT_SOLARIZE:
     {
@@ -171,7 +209,7 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = solarize_op(map[i], level, A, B);
+        new_map[i*dst_step] = solarize_op(map[i*src_step], level, A, B);
       break;
     }
   case IM_GAMUT_POW:
@@ -179,7 +217,7 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
     for (i = 0; i < count; i++)
-      new_map[i] = (T)(norm_pow_op(map[i], min, range, args[0])*range + min);
+      new_map[i*dst_step] = (T)(norm_pow_op(map[i*src_step], min, range, args[0])*range + min);
     break;
   case IM_GAMUT_LOG:
     {
@@ -188,7 +226,7 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = (T)(norm_log_op(map[i], min, range, norm, args[0])*range + min);
+        new_map[i*dst_step] = (T)(norm_log_op(map[i*src_step], min, range, norm, args[0])*range + min);
       break;
     }
   case IM_GAMUT_EXP:
@@ -198,44 +236,35 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = (T)(norm_exp_op(map[i], min, range, norm, args[0])*range + min);
+        new_map[i*dst_step] = (T)(norm_exp_op(map[i*src_step], min, range, norm, args[0])*range + min);
       break;
     }
   case IM_GAMUT_SLICE:
     {
-      if (args[0] > args[1]) { float tmp = args[1]; args[1] = args[0]; args[0] = tmp; }
-      if (args[1] > max) args[1] = (float)max;
-      if (args[0] < min) args[0] = (float)min;
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = slice_op(map[i], min, max, (T)args[0], (T)args[1], (int)args[2]);
+        new_map[i*dst_step] = slice_op(map[i*src_step], min, max, (T)args[0], (T)args[1], (int)args[2]);
       break;
     }
   case IM_GAMUT_CROP:
     {
-      if (args[0] > args[1]) { float tmp = args[1]; args[1] = args[0]; args[0] = tmp; }
-      if (args[1] > max) args[1] = (float)max;
-      if (args[0] < min) args[0] = (float)min;
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = tonecrop_op(map[i], (T)args[0], (T)args[1]);
+        new_map[i*dst_step] = tonecrop_op(map[i*src_step], (T)args[0], (T)args[1]);
       break;
     }
   case IM_GAMUT_EXPAND:
     {
-      if (args[0] > args[1]) { float tmp = args[1]; args[1] = args[0]; args[0] = tmp; }
-      if (args[1] > max) args[1] = (float)max;
-      if (args[0] < min) args[0] = (float)min;
       float norm = float(max - min)/(args[1] - args[0]);
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = expand_op(map[i], min, max, (T)args[0], norm);
+        new_map[i*dst_step] = expand_op(map[i*src_step], min, max, (T)args[0], norm);
       break;
     }
   case IM_GAMUT_BRIGHTCONT:
@@ -247,44 +276,87 @@ static void DoNormalizedUnaryOp(T *map, T *new_map, int count, int op, float *ar
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
       for (i = 0; i < count; i++)
-        new_map[i] = line_op(map[i], min, max, a, b);
+        new_map[i*dst_step] = line_op(map[i*src_step], min, max, a, b);
       break;
     }
   }
 }
 
+template <class T> 
+static void DoToneGamut(const imImage* src_image, imImage* dst_image, int op, float *args)
+{
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(src_image, single);
+  int count = imProcessPlaneRunSize(src_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+  T min, max;
+
+  if (op & IM_GAMUT_MINMAX)
+  {
+    min = (T)args[0];
+    max = (T)args[1];
+    args += 2;
+  }
+  else
+    DoMinMax(src_image, single, min, max);
+
+  switch(op & 0x00FF)
+  {
+  case IM_GAMUT_SLICE:
+  case IM_GAMUT_CROP:
+  case IM_GAMUT_EXPAND:
+    if (args[0] > args[1]) { float tmp = args[1]; args[1] = args[0]; args[0] = tmp; }
+    if (args[1] > max) args[1] = (float)max;
+    if (args[0] < min) args[0] = (float)min;
+    break;
+  }
+
+  for (int run = 0; run < run_count; run++)
+  {
+    T* map = (T*)imProcessPlaneRunData(src_image, run, single);
+    T* new_map = (T*)imProcessPlaneRunData(dst_image, run, single);
+    DoNormalizedUnaryOp(map, src_step, new_map, dst_step, count, op, args, min, max);
+  }
+}
+
 void imProcessToneGamut(const imImage* src_image, imImage* dst_image, int op, float *args)
 {
-  int count = src_image->count*src_image->depth;
+  imImageMakeWritable(dst_image);
 
   switch(src_image->data_type)
   {
   case IM_BYTE:
-    DoNormalizedUnaryOp((imbyte*)src_image->data[0], (imbyte*)dst_image->data[0], count, op, args);
+    DoToneGamut<imbyte>(src_image, dst_image, op, args);
     break;                                                                                
   case IM_SHORT:                                                                           
-    DoNormalizedUnaryOp((short*)src_image->data[0], (short*)dst_image->data[0], count, op, args);
+    DoToneGamut<short>(src_image, dst_image, op, args);
     break;                                                                                
   case IM_USHORT:                                                                           
-    DoNormalizedUnaryOp((imushort*)src_image->data[0], (imushort*)dst_image->data[0], count, op, args);
+    DoToneGamut<imushort>(src_image, dst_image, op, args);
     break;                                                                                
   case IM_INT:                                                                           
-    DoNormalizedUnaryOp((int*)src_image->data[0], (int*)dst_image->data[0], count, op, args);
+    DoToneGamut<int>(src_image, dst_image, op, args);
     break;                                                                                
   case IM_FLOAT:                                                                           
-    DoNormalizedUnaryOp((float*)src_image->data[0], (float*)dst_image->data[0], count, op, args);
+    DoToneGamut<float>(src_image, dst_image, op, args);
     break;                                                                                
   }
 }
 
 template <class T> 
-static void DoShiftHSI(T **map, T **new_map, int count, float h_shift, float s_shift, float i_shift)
+static void DoShiftHSI(const imImage* src_image, imImage* dst_image, float h_shift, float s_shift, float i_shift)
 {
   float min, max, range;
   T tmin, tmax;
-  int tcount = count*3;
+  int width = src_image->width;
+  int height = src_image->height;
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+  int single = imImageIsContiguous(src_image);
 
-  imMinMaxType(map[0], tcount, tmin, tmax);
+  DoMinMax(src_image, single, tmin, tmax);
 
   min = (float)tmin;
   max = (float)tmax;
@@ -292,87 +364,120 @@ static void DoShiftHSI(T **map, T **new_map, int count, float h_shift, float s_s
   range = max-min;
 
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
-  for (int j = 0; j < count; j++)
+  for (int y = 0; y < height; y++)
   {
-    float h, s, i;
-    float r, g, b;
-
-    // Normalize to 0-1
-    r = normal_op((float)map[0][j], min, range);
-    g = normal_op((float)map[1][j], min, range);
-    b = normal_op((float)map[2][j], min, range);
-
-    imColorRGB2HSI(r, g, b, &h, &s, &i);
-
-    h += h_shift; // in degrees
-    s += s_shift;
-    if (s < 0) s = 0;
-    if (s > 1) s = 1;
-    i += i_shift;
-    if (i < 0) i = 0;
-    if (i > 1) i = 1;
-
-    imColorHSI2RGB(h, s, i, &r, &g, &b);
-
-    // Expand to min-max
-    new_map[0][j] = (T)(r*range + min);
-    new_map[1][j] = (T)(g*range + min);
-    new_map[2][j] = (T)(b*range + min);
+    T* map[3];
+    T* new_map[3];
+    for (int d = 0; d < 3; d++)
+    {
+      map[d] = (T*)imProcessLineData(src_image, d, y);
+      new_map[d] = (T*)imProcessLineData(dst_image, d, y);
+    }
+
+    for (int x = 0; x < width; x++)
+    {
+      float h, s, i;
+      float r, g, b;
+      int j = x*src_step;
+
+      // Normalize to 0-1
+      r = normal_op((float)map[0][j], min, range);
+      g = normal_op((float)map[1][j], min, range);
+      b = normal_op((float)map[2][j], min, range);
+
+      imColorRGB2HSI(r, g, b, &h, &s, &i);
+
+      h += h_shift; // in degrees
+      s += s_shift;
+      if (s < 0) s = 0;
+      if (s > 1) s = 1;
+      i += i_shift;
+      if (i < 0) i = 0;
+      if (i > 1) i = 1;
+
+      imColorHSI2RGB(h, s, i, &r, &g, &b);
+
+      // Expand to min-max
+      j = x*dst_step;
+      new_map[0][j] = (T)(r*range + min);
+      new_map[1][j] = (T)(g*range + min);
+      new_map[2][j] = (T)(b*range + min);
+    }
   }
 }
 
-static void DoShiftHSIByte(imbyte **map, imbyte **new_map, int count, float h_shift, float s_shift, float i_shift)
+static void DoShiftHSIByte(const imImage* src_image, imImage* dst_image, float h_shift, float s_shift, float i_shift)
 {
+  int width = src_image->width;
+  int height = src_image->height;
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
+#pragma omp parallel for if (IM_OMP_MINHEIGHT(height))
 #endif
-  for (int j = 0; j < count; j++)
+  for (int y = 0; y < height; y++)
   {
-    float h, s, i;
-    imbyte r, g, b;
-
-    r = map[0][j];
-    g = map[1][j];
-    b = map[2][j];
-
-    imColorRGB2HSIbyte(r, g, b, &h, &s, &i);
-
-    h += h_shift; // in degrees
-    s += s_shift;
-    if (s < 0) s = 0;
-    if (s > 1) s = 1;
-    i += i_shift;
-    if (i < 0) i = 0;
-    if (i > 1) i = 1;
-
-    imColorHSI2RGBbyte(h, s, i, &r, &g, &b);
+    imbyte* map[3];
+    imbyte* new_map[3];
+    for (int d = 0; d < 3; d++)
+    {
+      map[d] = (imbyte*)imProcessLineData(src_image, d, y);
+      new_map[d] = (imbyte*)imProcessLineData(dst_image, d, y);
+    }
 
-    new_map[0][j] = r;
-    new_map[1][j] = g;
-    new_map[2][j] = b;
+    for (int x = 0; x < width; x++)
+    {
+      float h, s, i;
+      imbyte r, g, b;
+      int j = x*src_step;
+
+      r = map[0][j];
+      g = map[1][j];
+      b = map[2][j];
+
+      imColorRGB2HSIbyte(r, g, b, &h, &s, &i);
+
+      h += h_shift; // in degrees
+      s += s_shift;
+      if (s < 0) s = 0;
+      if (s > 1) s = 1;
+      i += i_shift;
+      if (i < 0) i = 0;
+      if (i > 1) i = 1;
+
+      imColorHSI2RGBbyte(h, s, i, &r, &g, &b);
+
+      j = x*dst_step;
+      new_map[0][j] = r;
+      new_map[1][j] = g;
+      new_map[2][j] = b;
+    }
   }
 }
 
 void imProcessShiftHSI(const imImage* src_image, imImage* dst_image, float h_shift, float s_shift, float i_shift)
 {
+  imImageMakeWritable(dst_image);
+
   switch(src_image->data_type)
   {
   case IM_BYTE:
-    DoShiftHSIByte((imbyte**)src_image->data, (imbyte**)dst_image->data, src_image->count, h_shift, s_shift, i_shift);
+    DoShiftHSIByte(src_image, dst_image, h_shift, s_shift, i_shift);
     break;                                                                                
   case IM_SHORT:                                                                           
-    DoShiftHSI((short**)src_image->data, (short**)dst_image->data, src_image->count, h_shift, s_shift, i_shift);
+    DoShiftHSI<short>(src_image, dst_image, h_shift, s_shift, i_shift);
     break;                                                                                
   case IM_USHORT:                                                                           
-    DoShiftHSI((imushort**)src_image->data, (imushort**)dst_image->data, src_image->count, h_shift, s_shift, i_shift);
+    DoShiftHSI<imushort>(src_image, dst_image, h_shift, s_shift, i_shift);
     break;                                                                                
   case IM_INT:                                                                           
-    DoShiftHSI((int**)src_image->data, (int**)dst_image->data, src_image->count, h_shift, s_shift, i_shift);
+    DoShiftHSI<int>(src_image, dst_image, h_shift, s_shift, i_shift);
     break;                                                                                
   case IM_FLOAT:                                                                           
-    DoShiftHSI((float**)src_image->data, (float**)dst_image->data, src_image->count, h_shift, s_shift, i_shift);
+    DoShiftHSI<float>(src_image, dst_image, h_shift, s_shift, i_shift);
     break;                                                                                
   }
 }
@@ -400,67 +505,98 @@ float imProcessCalcAutoGamma(const imImage* image)
   return (float)(log((double)((mean-min)/(max-min)))/log(0.5));
 }
 
-void imProcessUnNormalize(const imImage* src_image, imImage* dst_image)
+static void DoUnNormalize(float* map, int src_step, imbyte* new_map, int dst_step, int count)
 {
-  int count = src_image->count*src_image->depth;
-
-  float* map = (float*)src_image->data[0];
-  imbyte* new_map = (imbyte*)dst_image->data[0];
-
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
-    if (map[i] > 1)
-      new_map[i] = (imbyte)255;
-    else if (map[i] < 0)
-      new_map[i] = (imbyte)0;
+    float value = map[i*src_step];
+    if (value > 1)
+      new_map[i*dst_step] = (imbyte)255;
+    else if (value < 0)
+      new_map[i*dst_step] = (imbyte)0;
     else
-      new_map[i] = (imbyte)(map[i]*255);
+      new_map[i*dst_step] = (imbyte)(value*255);
+  }
+}
+
+void imProcessUnNormalize(const imImage* src_image, imImage* dst_image)
+{
+  imImageMakeWritable(dst_image);
+
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(src_image, single);
+  int count = imProcessPlaneRunSize(src_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
+  {
+    float* map = (float*)imProcessPlaneRunData(src_image, run, single);
+    imbyte* new_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+    DoUnNormalize(map, src_step, new_map, dst_step, count);
   }
 }
 
 template <class T> 
-static void DoDirectConv(T* map, imbyte* new_map, int count)
+static void DoDirectConv(T* map, int src_step, imbyte* new_map, int dst_step, int count)
 {
 #ifdef _OPENMP
 #pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
   for (int i = 0; i < count; i++)
   {
-    if (map[i] > 255)
-      new_map[i] = (imbyte)255;
-    else if (map[i] < 0)
-      new_map[i] = (imbyte)0;
+    T value = map[i*src_step];
+    if (value > 255)
+      new_map[i*dst_step] = (imbyte)255;
+    else if (value < 0)
+      new_map[i*dst_step] = (imbyte)0;
     else
-      new_map[i] = (imbyte)(map[i]);
+      new_map[i*dst_step] = (imbyte)(value);
   }
 }
 
 void imProcessDirectConv(const imImage* src_image, imImage* dst_image)
 {
-  int count = src_image->count*src_image->depth;
+  imImageMakeWritable(dst_image);
 
-  switch(src_image->data_type)
+  int single = imImageIsContiguous(src_image) && 
+               imImageIsContiguous(dst_image);
+  int run_count = imProcessPlaneRunCount(src_image, single);
+  int count = imProcessPlaneRunSize(src_image, single);
+  int src_step = imProcessPixelStep(src_image);
+  int dst_step = imProcessPixelStep(dst_image);
+
+  for (int run = 0; run < run_count; run++)
   {
-  case IM_SHORT:                                                                           
-    DoDirectConv((short*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_USHORT:                                                                           
-    DoDirectConv((imushort*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_INT:                                                                           
-    DoDirectConv((int*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    break;                                                                                
-  case IM_FLOAT:                                                                           
-    DoDirectConv((float*)src_image->data[0], (imbyte*)dst_image->data[0], count);
-    break;                                                                                
+    void* map = imProcessPlaneRunData(src_image, run, single);
+    imbyte* new_map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
+
+    switch(src_image->data_type)
+    {
+    case IM_SHORT:                                                                           
+      DoDirectConv((short*)map, src_step, new_map, dst_step, count);
+      break;                                                                                
+    case IM_USHORT:                                                                           
+      DoDirectConv((imushort*)map, src_step, new_map, dst_step, count);
+      break;                                                                                
+    case IM_INT:                                                                           
+      DoDirectConv((int*)map, src_step, new_map, dst_step, count);
+      break;                                                                                
+    case IM_FLOAT:                                                                           
+      DoDirectConv((float*)map, src_step, new_map, dst_step, count);
+      break;                                                                                
+    }
   }
 }
 
 void imProcessNegative(const imImage* src_image, imImage* dst_image)
 {
+  imImageMakeWritable(dst_image);
+
   if (src_image->color_space == IM_MAP)
   {
     unsigned char r, g, b;
@@ -475,13 +611,23 @@ void imProcessNegative(const imImage* src_image, imImage* dst_image)
   }
   else if (src_image->color_space == IM_BINARY)
   {
-    imbyte* map1 = (imbyte*)src_image->data[0];
-    imbyte* map = (imbyte*)dst_image->data[0];
+    int single = imImageIsContiguous(src_image) && 
+                 imImageIsContiguous(dst_image);
+    int run_count = imProcessPlaneRunCount(src_image, single);
+    int count = imProcessPlaneRunSize(src_image, single);
+    int src_step = imProcessPixelStep(src_image);
+    int dst_step = imProcessPixelStep(dst_image);
+
+    for (int run = 0; run < run_count; run++)
+    {
+      imbyte* map1 = (imbyte*)imProcessPlaneRunData(src_image, run, single);
+      imbyte* map = (imbyte*)imProcessPlaneRunData(dst_image, run, single);
 #ifdef _OPENMP
-#pragma omp parallel for if (IM_OMP_MINCOUNT(src_image->count))
+#pragma omp parallel for if (IM_OMP_MINCOUNT(count))
 #endif
-    for (int i = 0; i < src_image->count; i++)
-      map[i] = map1[i]? 0: 1;
+      for (int i = 0; i < count; i++)
+        map[i*dst_step] = map1[i*src_step]? 0: 1;
+    }
   }
   else
     imProcessToneGamut(src_image, dst_image, IM_GAMUT_INVERT, NULL);
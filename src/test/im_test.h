@@ -0,0 +1,138 @@
+/** \file
+ * \brief IM Regression Tests
+ *
+ * Helpers shared by the regression programs.
+ * Each program receives a directory for temporary files as the first argument,
+ * and returns the number of failed checks.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#ifndef __IM_TEST_H
+#define __IM_TEST_H
+
+#include <im.h>
+#include <im_lib.h>
+#include <im_util.h>
+#include <im_image.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int iTestFailures = 0;
+
+#define IM_TEST_CHECK(_cond)                                                  \
+  do {                                                                        \
+    if (!(_cond))                                                             \
+    {                                                                         \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_cond); \
+      iTestFailures++;                                                        \
+    }                                                                         \
+  } while (0)
+
+static const char* iTestDir = ".";
+
+static void iTestInit(int argc, char* argv[])
+{
+  if (argc > 1)
+    iTestDir = argv[1];
+}
+
+static int iTestEnd(const char* name)
+{
+  if (iTestFailures)
+    fprintf(stderr, "%s: %d checks failed\n", name, iTestFailures);
+  else
+    printf("%s: ok\n", name);
+  return iTestFailures;
+}
+
+static void iTestFileName(char* file_name, const char* name)
+{
+  sprintf(file_name, "%s/%s", iTestDir, name);
+}
+
+/* Byte image with a different smooth pattern in each plane,
+   so the compressed formats keep the values close to the original. */
+static imImage* iTestCreateImage(int width, int height, int color_space, int flags)
+{
+  imImage* image = imImageCreateEx(width, height, color_space, IM_BYTE, flags);
+  if (!image)
+    return NULL;
+
+  int step = (flags & IM_IMAGE_PACKED)? image->depth: 1;
+
+  for (int d = 0; d < image->depth; d++)
+  {
+    for (int y = 0; y < height; y++)
+    {
+      imbyte* line = (imbyte*)image->data[d] + y*image->line_stride;
+      for (int x = 0; x < width; x++)
+      {
+        int vx = ((d % 2)? width-1 - x: x)*255/width;
+        int vy = ((d == 2)? height-1 - y: y)*255/height;
+        line[x*step] = (imbyte)((vx + vy)/2);
+      }
+    }
+  }
+
+  return image;
+}
+
+/* Returns the maximum absolute difference between the pixels of two byte images,
+   for any layout. Returns 256 if the images are not compatible. */
+static int iTestCompare(const imImage* image1, const imImage* image2)
+{
+  if (image1->width != image2->width || image1->height != image2->height ||
+      image1->depth != image2->depth || image1->data_type != IM_BYTE || image2->data_type != IM_BYTE)
+    return 256;
+
+  int step1 = (image1->flags & IM_IMAGE_PACKED)? (image1->has_alpha? image1->depth+1: image1->depth): 1;
+  int step2 = (image2->flags & IM_IMAGE_PACKED)? (image2->has_alpha? image2->depth+1: image2->depth): 1;
+  int max_diff = 0;
+
+  for (int d = 0; d < image1->depth; d++)
+  {
+    for (int y = 0; y < image1->height; y++)
+    {
+      const imbyte* line1 = (const imbyte*)image1->data[d] + y*image1->line_stride;
+      const imbyte* line2 = (const imbyte*)image2->data[d] + y*image2->line_stride;
+      for (int x = 0; x < image1->width; x++)
+      {
+        int diff = abs((int)line1[x*step1] - (int)line2[x*step2]);
+        if (diff > max_diff)
+          max_diff = diff;
+      }
+    }
+  }
+
+  return max_diff;
+}
+
+/* Copies count lines starting at first_line between a planar byte image and a block of lines
+   with the layout of imFileReadImageLines and imFileWriteImageLines:
+   each plane has count lines, or a single plane with all the components when packed. */
+static void iTestCopyLines(imImage* image, imbyte* block, int first_line, int count, int packed, int to_block)
+{
+  int width = image->width;
+
+  for (int d = 0; d < image->depth; d++)
+  {
+    for (int y = 0; y < count; y++)
+    {
+      imbyte* line = (imbyte*)image->data[d] + (first_line + y)*image->line_stride;
+      for (int x = 0; x < width; x++)
+      {
+        imbyte* block_value = packed? block + (y*width + x)*image->depth + d: block + (d*count + y)*width + x;
+        if (to_block)
+          *block_value = line[x];
+        else
+          line[x] = *block_value;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,130 @@
+/** \file
+ * \brief Regression test of the batch loader (user-050)
+ *
+ * imFileImageLoadBatchNext must return the images in the order of the list,
+ * equal to the images loaded by imFileImageLoad, report the files that failed,
+ * and imFileImageLoadBatchStop must work before all the images were returned.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+
+#define IM_TEST_FILES 12
+
+static void iTestBatch(const char** file_list, int count, int thread_count, int max_memory, int bitmap, int missing)
+{
+  imFileImageBatch* batch = imFileImageLoadBatchStart(file_list, count, thread_count, max_memory, bitmap);
+  IM_TEST_CHECK(batch != NULL);
+  if (!batch)
+    return;
+
+  for (int i = 0; i < count; i++)
+  {
+    int index = -1, error = -1;
+    imImage* image = imFileImageLoadBatchNext(batch, &index, &error);
+    IM_TEST_CHECK(index == i);
+
+    if (i == missing)
+    {
+      IM_TEST_CHECK(image == NULL);
+      IM_TEST_CHECK(error == IM_ERR_OPEN);
+      continue;
+    }
+
+    IM_TEST_CHECK(image != NULL);
+    IM_TEST_CHECK(error == IM_ERR_NONE);
+    if (!image)
+      continue;
+
+    imImage* loaded = bitmap? imFileImageLoadBitmap(file_list[i], 0, &error): imFileImageLoad(file_list[i], 0, &error);
+    IM_TEST_CHECK(loaded != NULL);
+    if (loaded)
+    {
+      IM_TEST_CHECK(image->color_space == loaded->color_space);
+      IM_TEST_CHECK(iTestCompare(image, loaded) == 0);
+      imImageDestroy(loaded);
+    }
+
+    imImageDestroy(image);
+  }
+
+  /* all the files were returned */
+  int error = -1;
+  IM_TEST_CHECK(imFileImageLoadBatchNext(batch, NULL, &error) == NULL);
+  IM_TEST_CHECK(error == IM_ERR_NONE);
+
+  imFileImageLoadBatchStop(batch);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  static const char* formats[] = {"PNG", "TIFF", "BMP", "JPEG"};
+  char file_names[IM_TEST_FILES][512];
+  const char* file_list[IM_TEST_FILES];
+  int missing = 5;
+
+  for (int i = 0; i < IM_TEST_FILES; i++)
+  {
+    const char* format = formats[i % 4];
+    char name[64];
+    sprintf(name, "im_test_batch%d.%s", i, format);
+    iTestFileName(file_names[i], name);
+    file_list[i] = file_names[i];
+
+    if (i == missing)
+    {
+      remove(file_names[i]);
+      continue;
+    }
+
+    /* different sizes, so slower files can finish after the next ones */
+    imImage* image = iTestCreateImage(40 + 97*(i % 3), 30 + 61*(i % 4), (i % 2)? IM_GRAY: IM_RGB, 0);
+    IM_TEST_CHECK(imFileImageSave(file_names[i], format, image) == IM_ERR_NONE);
+    imImageDestroy(image);
+  }
+
+  iTestBatch(file_list, IM_TEST_FILES, 1, 0, 0, missing);
+  iTestBatch(file_list, IM_TEST_FILES, 4, 0, 0, missing);
+  iTestBatch(file_list, IM_TEST_FILES, 0, 0, 1, missing);
+
+  /* a memory limit smaller than one image, the next image in order is always loaded */
+  iTestBatch(file_list, IM_TEST_FILES, 3, 1, 0, missing);
+
+  /* stop before all the images were returned */
+  for (int thread_count = 1; thread_count <= 4; thread_count += 3)
+  {
+    imFileImageBatch* batch = imFileImageLoadBatchStart(file_list, IM_TEST_FILES, thread_count, 0, 0);
+    IM_TEST_CHECK(batch != NULL);
+    if (!batch)
+      continue;
+
+    int index, error;
+    imImage* image = imFileImageLoadBatchNext(batch, &index, &error);
+    IM_TEST_CHECK(image != NULL && index == 0);
+    if (image)
+      imImageDestroy(image);
+
+    imFileImageLoadBatchStop(batch);
+  }
+
+  /* an empty list */
+  {
+    imFileImageBatch* batch = imFileImageLoadBatchStart(file_list, 0, 2, 0, 0);
+    if (batch)
+    {
+      int error = -1;
+      IM_TEST_CHECK(imFileImageLoadBatchNext(batch, NULL, &error) == NULL);
+      IM_TEST_CHECK(error == IM_ERR_NONE);
+      imFileImageLoadBatchStop(batch);
+    }
+  }
+
+  for (int i = 0; i < IM_TEST_FILES; i++)
+    remove(file_names[i]);
+
+  return iTestEnd("im_test_batch");
+}
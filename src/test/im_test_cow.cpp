@@ -0,0 +1,161 @@
+/** \file
+ * \brief Regression test of the copy-on-write duplicates (user-037)
+ *
+ * Duplicates of IM_IMAGE_COPYONWRITE images share the pixels and the attributes
+ * until one of them is changed by the imImage functions, image loading,
+ * the conversion functions, the processing functions or after imImageMakeWritable.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+#include <im_convert.h>
+#include <im_process.h>
+
+
+static int iTestShared(const imImage* image1, const imImage* image2)
+{
+  return image1->data[0] == image2->data[0];
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  imImage* image = iTestCreateImage(45, 33, IM_RGB, IM_IMAGE_COPYONWRITE);
+  imImage* original = imImageCreate(45, 33, IM_RGB, IM_BYTE);
+  imImageCopyData(image, original);
+
+  /* without the flag the duplicate is a copy */
+  {
+    imImage* copy = imImageDuplicate(original);
+    IM_TEST_CHECK(!iTestShared(copy, original));
+    IM_TEST_CHECK(iTestCompare(copy, original) == 0);
+    imImageDestroy(copy);
+  }
+
+  /* the duplicate is shared and also has the flag */
+  imImage* dup = imImageDuplicate(image);
+  IM_TEST_CHECK(iTestShared(dup, image));
+  IM_TEST_CHECK(dup->flags & IM_IMAGE_COPYONWRITE);
+
+  /* a processing function writing to the duplicate */
+  imProcessNegative(image, dup);
+  IM_TEST_CHECK(!iTestShared(dup, image));
+  IM_TEST_CHECK(iTestCompare(image, original) == 0);
+  {
+    imImage* negative = imImageClone(original);
+    imProcessNegative(original, negative);
+    IM_TEST_CHECK(iTestCompare(dup, negative) == 0);
+    imImageDestroy(negative);
+  }
+  imImageDestroy(dup);
+
+  /* a processing function writing to the original */
+  dup = imImageDuplicate(image);
+  imProcessMirror(dup, image);
+  IM_TEST_CHECK(!iTestShared(dup, image));
+  IM_TEST_CHECK(iTestCompare(dup, original) == 0);
+  imProcessMirror(image, image);
+  IM_TEST_CHECK(iTestCompare(image, original) == 0);
+  imImageDestroy(dup);
+
+  /* writing directly to the data buffer after imImageMakeWritable */
+  dup = imImageDuplicate(image);
+  IM_TEST_CHECK(imImageMakeWritable(dup));
+  IM_TEST_CHECK(!iTestShared(dup, image));
+  IM_TEST_CHECK(iTestCompare(dup, original) == 0);
+  memset(dup->data[0], 0, dup->size);
+  IM_TEST_CHECK(iTestCompare(image, original) == 0);
+  imImageDestroy(dup);
+
+  /* the imImage functions and the conversion functions */
+  dup = imImageDuplicate(image);
+  imImageClear(dup);
+  IM_TEST_CHECK(!iTestShared(dup, image));
+  IM_TEST_CHECK(iTestCompare(image, original) == 0);
+  imImageDestroy(dup);
+
+  dup = imImageDuplicate(image);
+  {
+    imImage* gray = imImageCreate(45, 33, IM_GRAY, IM_BYTE);
+    imConvertColorSpace(image, gray);
+    imImage* rgb = imImageCreate(45, 33, IM_RGB, IM_BYTE);
+    imConvertColorSpace(gray, rgb);
+
+    imConvertColorSpace(gray, dup);
+    IM_TEST_CHECK(!iTestShared(dup, image));
+    IM_TEST_CHECK(iTestCompare(dup, rgb) == 0);
+    IM_TEST_CHECK(iTestCompare(image, original) == 0);
+
+    imImageDestroy(rgb);
+    imImageDestroy(gray);
+  }
+  imImageDestroy(dup);
+
+  /* the attributes are also shared until changed */
+  {
+    int value = 10;
+    imImageSetAttribute(image, "TestValue", IM_INT, 1, &value);
+
+    dup = imImageDuplicate(image);
+    value = 20;
+    imImageSetAttribute(dup, "TestValue", IM_INT, 1, &value);
+    imImageSetAttribute(dup, "TestOther", IM_INT, 1, &value);
+
+    int data_type, count;
+    const int* data = (const int*)imImageGetAttribute(image, "TestValue", &data_type, &count);
+    IM_TEST_CHECK(data && *data == 10);
+    IM_TEST_CHECK(imImageGetAttribute(image, "TestOther", NULL, NULL) == NULL);
+    data = (const int*)imImageGetAttribute(dup, "TestValue", &data_type, &count);
+    IM_TEST_CHECK(data && *data == 20);
+
+    /* the pixels are still shared */
+    IM_TEST_CHECK(iTestShared(dup, image));
+    imImageDestroy(dup);
+  }
+
+  /* image loading into a duplicate */
+  {
+    char file_name[512];
+    iTestFileName(file_name, "im_test_cow.png");
+    imImage* other = iTestCreateImage(45, 33, IM_RGB, 0);
+    imProcessFlip(other, other);
+    IM_TEST_CHECK(imFileImageSave(file_name, "PNG", other) == IM_ERR_NONE);
+
+    dup = imImageDuplicate(image);
+    int error;
+    imFile* ifile = imFileOpen(file_name, &error);
+    IM_TEST_CHECK(ifile != NULL);
+    if (ifile)
+    {
+      imFileLoadImageFrame(ifile, 0, dup, &error);
+      IM_TEST_CHECK(error == IM_ERR_NONE);
+      imFileClose(ifile);
+
+      IM_TEST_CHECK(!iTestShared(dup, image));
+      IM_TEST_CHECK(iTestCompare(dup, other) == 0);
+      IM_TEST_CHECK(iTestCompare(image, original) == 0);
+    }
+
+    imImageDestroy(dup);
+    imImageDestroy(other);
+    remove(file_name);
+  }
+
+  /* the duplicates keep the pixels after the original is destroyed, in any order */
+  dup = imImageDuplicate(image);
+  imImage* dup2 = imImageDuplicate(dup);
+  IM_TEST_CHECK(iTestShared(dup2, image));
+  imImageDestroy(image);
+  IM_TEST_CHECK(iTestCompare(dup, original) == 0);
+  imProcessNegative(dup, dup);
+  IM_TEST_CHECK(iTestCompare(dup2, original) == 0);
+  imImageDestroy(dup2);
+  imImageDestroy(dup);
+
+  imImageDestroy(original);
+
+  return iTestEnd("im_test_cow");
+}
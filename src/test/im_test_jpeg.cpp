@@ -0,0 +1,155 @@
+/** \file
+ * \brief Regression test of imFileTransformJPEG and imFileCropJPEG (user-049)
+ *
+ * The lossless transformations must decode as the same transformation
+ * applied to the decoded image, and the crop as the same region of the decoded image.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+#include <im_jpeg.h>
+#include <im_process.h>
+
+
+/* The DCT coefficients are not changed, but the chroma upsampling
+   uses the neighbor blocks, that are different after the transformation. */
+#define IM_TEST_TOLERANCE 4
+
+static imImage* iTestTransform(const imImage* image, int transform)
+{
+  int swap = (transform == IM_JPEG_TRANSPOSE || transform == IM_JPEG_TRANSVERSE ||
+              transform == IM_JPEG_ROT90 || transform == IM_JPEG_ROT270);
+  imImage* dst = swap? imImageCreateBased(image, image->height, image->width, -1, -1): imImageClone(image);
+
+  switch (transform)
+  {
+  case IM_JPEG_NONE:
+    imImageCopyData(image, dst);
+    break;
+  case IM_JPEG_FLIP_H:
+    imProcessMirror(image, dst);
+    break;
+  case IM_JPEG_FLIP_V:
+    imProcessFlip(image, dst);
+    break;
+  case IM_JPEG_ROT180:
+    imProcessRotate180(image, dst);
+    break;
+  case IM_JPEG_ROT90:
+    imProcessRotate90(image, dst, 1);
+    break;
+  case IM_JPEG_ROT270:
+    imProcessRotate90(image, dst, -1);
+    break;
+  case IM_JPEG_TRANSPOSE:
+    imProcessRotate90(image, dst, 1);
+    imProcessMirror(dst, dst);
+    break;
+  case IM_JPEG_TRANSVERSE:
+    imProcessRotate90(image, dst, 1);
+    imProcessFlip(dst, dst);
+    break;
+  }
+
+  return dst;
+}
+
+static void iTestCrop(const char* src_file_name, const char* dst_file_name, const imImage* decoded,
+                      int x, int y, int width, int height, int xmin, int ymin)
+{
+  IM_TEST_CHECK(imFileCropJPEG(src_file_name, dst_file_name, x, y, width, height) == IM_ERR_NONE);
+
+  int error;
+  imImage* cropped = imFileImageLoad(dst_file_name, 0, &error);
+  IM_TEST_CHECK(cropped != NULL);
+  if (!cropped)
+    return;
+
+  /* the origin is moved to the iMCU boundary, and the size is increased by the same amount */
+  IM_TEST_CHECK(cropped->width == width + (x - xmin));
+  IM_TEST_CHECK(cropped->height == height + (y - ymin));
+
+  /* the file origin is top-left, the image origin is bottom-left */
+  imImage* region = imImageCreateBased(decoded, cropped->width, cropped->height, -1, -1);
+  imProcessCrop(decoded, region, xmin, decoded->height - (ymin + cropped->height));
+  IM_TEST_CHECK(iTestCompare(cropped, region) <= IM_TEST_TOLERANCE);
+
+  imImageDestroy(region);
+  imImageDestroy(cropped);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  char src_file_name[512], dst_file_name[512];
+  iTestFileName(src_file_name, "im_test_jpeg_src.jpg");
+  iTestFileName(dst_file_name, "im_test_jpeg_dst.jpg");
+
+  /* multiple of the iMCU size, so no blocks are trimmed */
+  imImage* image = iTestCreateImage(96, 64, IM_RGB, 0);
+  IM_TEST_CHECK(imFileImageSave(src_file_name, "JPEG", image) == IM_ERR_NONE);
+
+  int error;
+  imImage* decoded = imFileImageLoad(src_file_name, 0, &error);
+  IM_TEST_CHECK(decoded != NULL);
+  if (!decoded)
+    return iTestEnd("im_test_jpeg");
+
+  for (int transform = IM_JPEG_NONE; transform <= IM_JPEG_ROT270; transform++)
+  {
+    IM_TEST_CHECK(imFileTransformJPEG(src_file_name, dst_file_name, transform) == IM_ERR_NONE);
+
+    imImage* transformed = imFileImageLoad(dst_file_name, 0, &error);
+    IM_TEST_CHECK(transformed != NULL);
+    if (!transformed)
+      continue;
+
+    imImage* expected = iTestTransform(decoded, transform);
+    IM_TEST_CHECK(iTestCompare(transformed, expected) <= ((transform == IM_JPEG_NONE)? 0: IM_TEST_TOLERANCE));
+
+    imImageDestroy(expected);
+    imImageDestroy(transformed);
+  }
+
+  /* the source and destination can be the same file, two flips restore the image */
+  IM_TEST_CHECK(imFileTransformJPEG(src_file_name, dst_file_name, IM_JPEG_FLIP_H) == IM_ERR_NONE);
+  IM_TEST_CHECK(imFileTransformJPEG(dst_file_name, dst_file_name, IM_JPEG_FLIP_H) == IM_ERR_NONE);
+  {
+    imImage* restored = imFileImageLoad(dst_file_name, 0, &error);
+    IM_TEST_CHECK(restored != NULL);
+    if (restored)
+    {
+      IM_TEST_CHECK(iTestCompare(restored, decoded) == 0);
+      imImageDestroy(restored);
+    }
+  }
+
+  /* a region aligned to the iMCU, and one that is not */
+  iTestCrop(src_file_name, dst_file_name, decoded, 32, 16, 48, 32, 32, 16);
+  iTestCrop(src_file_name, dst_file_name, decoded, 37, 21, 20, 10, 32, 16);
+
+  /* a region outside the image */
+  IM_TEST_CHECK(imFileCropJPEG(src_file_name, dst_file_name, 80, 0, 32, 16) == IM_ERR_DATA);
+
+  /* the partial blocks that would move to the interior are dropped */
+  imImage* odd = iTestCreateImage(61, 37, IM_RGB, 0);
+  IM_TEST_CHECK(imFileImageSave(src_file_name, "JPEG", odd) == IM_ERR_NONE);
+  IM_TEST_CHECK(imFileTransformJPEG(src_file_name, dst_file_name, IM_JPEG_FLIP_H) == IM_ERR_NONE);
+  {
+    imFileProbeInfo info;
+    IM_TEST_CHECK(imFileProbe(dst_file_name, &info) == IM_ERR_NONE);
+    IM_TEST_CHECK(info.width < 61 && info.width % 8 == 0 && info.height == 37);
+  }
+  imImageDestroy(odd);
+
+  remove(src_file_name);
+  remove(dst_file_name);
+
+  imImageDestroy(decoded);
+  imImageDestroy(image);
+
+  return iTestEnd("im_test_jpeg");
+}
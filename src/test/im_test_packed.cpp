@@ -0,0 +1,242 @@
+/** \file
+ * \brief Regression test of the packed images (user-038)
+ *
+ * Packed images (IM_IMAGE_PACKED) must be saved, converted and processed
+ * as the same planar images, also when mixed with planar images and with alpha.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+#include <im_convert.h>
+#include <im_process.h>
+
+
+typedef void (*iTestProcessFunc)(const imImage* src, imImage* dst);
+
+static void iTestResize(const imImage* src, imImage* dst) { imProcessResize(src, dst, 3); }
+static void iTestReduce(const imImage* src, imImage* dst) { imProcessReduce(src, dst, 1); }
+static void iTestReduceBy4(const imImage* src, imImage* dst) { imProcessReduceBy4(src, dst); }
+static void iTestRotate90(const imImage* src, imImage* dst) { imProcessRotate90(src, dst, 1); }
+static void iTestRotate270(const imImage* src, imImage* dst) { imProcessRotate90(src, dst, -1); }
+static void iTestRotate180(const imImage* src, imImage* dst) { imProcessRotate180(src, dst); }
+static void iTestMirror(const imImage* src, imImage* dst) { imProcessMirror(src, dst); }
+static void iTestFlip(const imImage* src, imImage* dst) { imProcessFlip(src, dst); }
+static void iTestNegative(const imImage* src, imImage* dst) { imProcessNegative(src, dst); }
+static void iTestAddConst(const imImage* src, imImage* dst) { imProcessArithmeticConstOp(src, 20, dst, IM_BIN_ADD); }
+static void iTestGamma(const imImage* src, imImage* dst) { float params[1] = {2.2f}; imProcessToneGamut(src, dst, IM_GAMUT_POW, params); }
+static void iTestGaussian(const imImage* src, imImage* dst) { imProcessGaussianConvolve(src, dst, 1.2f); }
+static void iTestMedian(const imImage* src, imImage* dst) { imProcessMedianConvolve(src, dst, 3); }
+
+struct iTestProcess
+{
+  const char* name;
+  iTestProcessFunc func;
+  int dst_width, dst_height;   /* 0 for the source size */
+};
+
+static imImage* iTestCreate(int width, int height, int color_space, int packed, int alpha)
+{
+  imImage* image = iTestCreateImage(width, height, color_space, packed? IM_IMAGE_PACKED: 0);
+  if (alpha)
+  {
+    imImageAddAlpha(image);
+    imImageSetAlpha(image, 200);
+  }
+  return image;
+}
+
+static int iTestAlpha(const imImage* image, int value)
+{
+  int step = (image->flags & IM_IMAGE_PACKED)? image->depth+1: 1;
+  for (int y = 0; y < image->height; y++)
+  {
+    const imbyte* line = (const imbyte*)image->data[image->depth] + y*image->line_stride;
+    for (int x = 0; x < image->width; x++)
+    {
+      if (line[x*step] != value)
+        return 0;
+    }
+  }
+  return 1;
+}
+
+/* Applies a function to all the combinations of planar and packed source and destination,
+   the results must be equal to the planar ones */
+static void iTestLayouts(const iTestProcess* process, int color_space, int alpha)
+{
+  int width = 38, height = 26;
+  int dst_width = process->dst_width? process->dst_width: width;
+  int dst_height = process->dst_height? process->dst_height: height;
+
+  imImage* src = iTestCreate(width, height, color_space, 0, alpha);
+  imImage* dst = iTestCreate(dst_width, dst_height, color_space, 0, alpha);
+  process->func(src, dst);
+
+  for (int src_packed = 0; src_packed < 2; src_packed++)
+  {
+    for (int dst_packed = 0; dst_packed < 2; dst_packed++)
+    {
+      if (!src_packed && !dst_packed)
+        continue;
+
+      imImage* src2 = iTestCreate(width, height, color_space, src_packed, alpha);
+      imImage* dst2 = iTestCreate(dst_width, dst_height, color_space, dst_packed, alpha);
+      process->func(src2, dst2);
+
+      if (iTestCompare(dst2, dst) != 0)
+        fprintf(stderr, "%s: src_packed=%d dst_packed=%d alpha=%d\n", process->name, src_packed, dst_packed, alpha);
+      IM_TEST_CHECK(iTestCompare(dst2, dst) == 0);
+
+      imImageDestroy(src2);
+      imImageDestroy(dst2);
+    }
+  }
+
+  imImageDestroy(src);
+  imImageDestroy(dst);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  imImage* packed = iTestCreate(41, 29, IM_RGB, 1, 0);
+  imImage* planar = iTestCreate(41, 29, IM_RGB, 0, 0);
+
+  /* the layout */
+  IM_TEST_CHECK(packed->flags & IM_IMAGE_PACKED);
+  IM_TEST_CHECK(!imImageIsContiguous(packed));
+  IM_TEST_CHECK((imbyte*)packed->data[1] == (imbyte*)packed->data[0] + 1);
+  IM_TEST_CHECK((imbyte*)packed->data[2] == (imbyte*)packed->data[0] + 2);
+  IM_TEST_CHECK(packed->line_size == 41*3);
+  IM_TEST_CHECK(iTestCompare(packed, planar) == 0);
+
+  /* copies between layouts */
+  {
+    imImage* copy = iTestCreate(41, 29, IM_RGB, 1, 0);
+    imImageClear(copy);
+    imImageCopyData(planar, copy);
+    IM_TEST_CHECK(iTestCompare(copy, planar) == 0);
+    imImageDestroy(copy);
+  }
+
+  /* OpenGL data is the image data */
+  {
+    int glformat;
+    IM_TEST_CHECK(imImageGetOpenGLData(packed, &glformat) == packed->data[0]);
+  }
+
+  /* saving and loading */
+  {
+    char file_name[512];
+    iTestFileName(file_name, "im_test_packed.tif");
+    IM_TEST_CHECK(imFileImageSave(file_name, "TIFF", packed) == IM_ERR_NONE);
+
+    int error;
+    imImage* loaded = imFileImageLoad(file_name, 0, &error);
+    IM_TEST_CHECK(loaded != NULL);
+    if (loaded)
+    {
+      IM_TEST_CHECK(iTestCompare(loaded, planar) == 0);
+      imImageDestroy(loaded);
+    }
+    remove(file_name);
+  }
+
+  /* color conversion to and from gray, with and without alpha,
+     the color planes are not changed when the color spaces are the same */
+  {
+    imImage* gray = imImageCreate(41, 29, IM_GRAY, IM_BYTE);
+    imImage* gray_planar = imImageCreate(41, 29, IM_GRAY, IM_BYTE);
+    IM_TEST_CHECK(imConvertColorSpace(packed, gray) == IM_ERR_NONE);
+    IM_TEST_CHECK(imConvertColorSpace(planar, gray_planar) == IM_ERR_NONE);
+    IM_TEST_CHECK(iTestCompare(gray, gray_planar) == 0);
+
+    imImage* rgb_planar = iTestCreate(41, 29, IM_RGB, 0, 0);
+    IM_TEST_CHECK(imConvertColorSpace(gray, rgb_planar) == IM_ERR_NONE);
+
+    imImage* rgba = iTestCreate(41, 29, IM_RGB, 1, 1);
+    imImageClear(rgba);
+    IM_TEST_CHECK(imConvertColorSpace(gray, rgba) == IM_ERR_NONE);
+    IM_TEST_CHECK(iTestCompare(rgba, rgb_planar) == 0);
+    IM_TEST_CHECK(iTestAlpha(rgba, 255));
+
+    imImageSetAlpha(rgba, 100);
+    imImage* rgba_planar = iTestCreate(41, 29, IM_RGB, 0, 1);
+    IM_TEST_CHECK(imConvertColorSpace(rgba, rgba_planar) == IM_ERR_NONE);
+    IM_TEST_CHECK(iTestCompare(rgba_planar, planar) == 0);
+    IM_TEST_CHECK(iTestAlpha(rgba_planar, 100));
+
+    imImage* gray_alpha = imImageCreate(41, 29, IM_GRAY, IM_BYTE);
+    imImageAddAlpha(gray_alpha);
+    IM_TEST_CHECK(imConvertColorSpace(rgba, gray_alpha) == IM_ERR_NONE);
+    IM_TEST_CHECK(iTestCompare(gray_alpha, gray) == 0);
+    IM_TEST_CHECK(iTestAlpha(gray_alpha, 100));
+
+    imImageDestroy(gray_alpha);
+    imImageDestroy(rgba_planar);
+    imImageDestroy(rgba);
+    imImageDestroy(rgb_planar);
+    imImageDestroy(gray);
+    imImageDestroy(gray_planar);
+  }
+
+  /* processing, in the packed layout and in contiguous copies */
+  static const iTestProcess processes[] = {
+    {"Resize", iTestResize, 57, 31},
+    {"Reduce", iTestReduce, 17, 11},
+    {"ReduceBy4", iTestReduceBy4, 19, 13},
+    {"Rotate90", iTestRotate90, 26, 38},
+    {"Rotate270", iTestRotate270, 26, 38},
+    {"Rotate180", iTestRotate180, 0, 0},
+    {"Mirror", iTestMirror, 0, 0},
+    {"Flip", iTestFlip, 0, 0},
+    {"Negative", iTestNegative, 0, 0},
+    {"AddConst", iTestAddConst, 0, 0},
+    {"Gamma", iTestGamma, 0, 0},
+    {"Gaussian", iTestGaussian, 0, 0},
+    {"Median", iTestMedian, 0, 0}
+  };
+  const int process_count = sizeof(processes)/sizeof(processes[0]);
+
+  for (int i = 0; i < process_count; i++)
+  {
+    iTestLayouts(processes + i, IM_RGB, 0);
+    iTestLayouts(processes + i, IM_RGB, 1);
+  }
+
+  /* in place */
+  {
+    imImage* mirror = iTestCreate(41, 29, IM_RGB, 0, 0);
+    imProcessMirror(planar, mirror);
+    imProcessMirror(packed, packed);
+    IM_TEST_CHECK(iTestCompare(packed, mirror) == 0);
+
+    imImage* flip = iTestCreate(41, 29, IM_RGB, 0, 0);
+    imProcessFlip(mirror, flip);
+    imProcessFlip(packed, packed);
+    IM_TEST_CHECK(iTestCompare(packed, flip) == 0);
+
+    imImageDestroy(flip);
+    imImageDestroy(mirror);
+  }
+
+  /* the point operations do not change alpha */
+  {
+    imImage* src = iTestCreate(41, 29, IM_RGB, 1, 1);
+    imImage* dst = iTestCreate(41, 29, IM_RGB, 1, 1);
+    imImageSetAlpha(dst, 50);
+    float params[1] = {2.2f};
+    imProcessToneGamut(src, dst, IM_GAMUT_POW, params);
+    IM_TEST_CHECK(iTestAlpha(dst, 50));
+    imImageDestroy(src);
+    imImageDestroy(dst);
+  }
+
+  imImageDestroy(packed);
+  imImageDestroy(planar);
+
+  return iTestEnd("im_test_packed");
+}
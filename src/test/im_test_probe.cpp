@@ -0,0 +1,130 @@
+/** \file
+ * \brief Regression test of the file probe (user-045)
+ *
+ * imFileProbe and imFileProbeList must return the same information
+ * of imFileOpen, imFileGetInfo and imFileReadImageInfo.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+
+static int iTestSaveTwoImages(const char* file_name, const char* format, const imImage* image)
+{
+  int error;
+  imFile* ifile = imFileNew(file_name, format, &error);
+  if (!ifile)
+    return error;
+
+  error = imFileSaveImage(ifile, image);
+  if (error == IM_ERR_NONE)
+    error = imFileSaveImage(ifile, image);
+
+  imFileClose(ifile);
+  return error;
+}
+
+static void iTestProbeFile(const char* file_name)
+{
+  imFileProbeInfo info;
+  int error = imFileProbe(file_name, &info);
+  IM_TEST_CHECK(error == IM_ERR_NONE);
+  if (error != IM_ERR_NONE)
+    return;
+
+  imFile* ifile = imFileOpen(file_name, &error);
+  IM_TEST_CHECK(ifile != NULL);
+  if (!ifile)
+    return;
+
+  char format[10];
+  int image_count;
+  imFileGetInfo(ifile, format, NULL, &image_count);
+
+  int width, height, color_mode, data_type;
+  error = imFileReadImageInfo(ifile, 0, &width, &height, &color_mode, &data_type);
+  IM_TEST_CHECK(error == IM_ERR_NONE);
+  imFileClose(ifile);
+
+  IM_TEST_CHECK(strcmp(info.format, format) == 0);
+  IM_TEST_CHECK(info.image_count == image_count);
+  IM_TEST_CHECK(info.width == width);
+  IM_TEST_CHECK(info.height == height);
+  IM_TEST_CHECK(info.color_mode == color_mode);
+  IM_TEST_CHECK(info.data_type == data_type);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  static const char* formats[] = {"JPEG", "PNG", "TIFF", "BMP", "PNM", "GIF"};
+  const int format_count = sizeof(formats)/sizeof(formats[0]);
+  char file_names[format_count+2][512];
+  const char* file_list[format_count+2];
+
+  imImage* rgb = iTestCreateImage(61, 37, IM_RGB, 0);
+  imImage* gray = iTestCreateImage(61, 37, IM_GRAY, 0);
+  imImage* map = iTestCreateImage(61, 37, IM_MAP, 0);
+
+  for (int i = 0; i < format_count; i++)
+  {
+    char name[64];
+    sprintf(name, "im_test_probe.%s", formats[i]);
+    iTestFileName(file_names[i], name);
+    file_list[i] = file_names[i];
+
+    const imImage* image = (strcmp(formats[i], "GIF") == 0)? map: (i % 2)? gray: rgb;
+    IM_TEST_CHECK(imFileImageSave(file_names[i], formats[i], image) == IM_ERR_NONE);
+
+    iTestProbeFile(file_names[i]);
+  }
+
+  /* the image count is returned, not only the first image information */
+  iTestFileName(file_names[format_count], "im_test_probe_multi.tif");
+  file_list[format_count] = file_names[format_count];
+  IM_TEST_CHECK(iTestSaveTwoImages(file_names[format_count], "TIFF", rgb) == IM_ERR_NONE);
+  iTestProbeFile(file_names[format_count]);
+  {
+    imFileProbeInfo info;
+    IM_TEST_CHECK(imFileProbe(file_names[format_count], &info) == IM_ERR_NONE);
+    IM_TEST_CHECK(info.image_count == 2);
+  }
+
+  /* a missing file fails, and its info is zeroed in the list */
+  iTestFileName(file_names[format_count+1], "im_test_probe_missing.png");
+  file_list[format_count+1] = file_names[format_count+1];
+  remove(file_names[format_count+1]);
+  {
+    imFileProbeInfo info;
+    IM_TEST_CHECK(imFileProbe(file_names[format_count+1], &info) == IM_ERR_OPEN);
+  }
+
+  imFileProbeInfo infos[format_count+2];
+  int errors[format_count+2];
+  imFileProbeList(file_list, format_count+2, infos, errors);
+
+  for (int i = 0; i < format_count+1; i++)
+  {
+    imFileProbeInfo info;
+    IM_TEST_CHECK(errors[i] == IM_ERR_NONE);
+    IM_TEST_CHECK(imFileProbe(file_list[i], &info) == IM_ERR_NONE);
+    IM_TEST_CHECK(strcmp(info.format, infos[i].format) == 0);
+    IM_TEST_CHECK(info.image_count == infos[i].image_count);
+    IM_TEST_CHECK(info.width == infos[i].width && info.height == infos[i].height);
+    IM_TEST_CHECK(info.color_mode == infos[i].color_mode && info.data_type == infos[i].data_type);
+  }
+
+  IM_TEST_CHECK(errors[format_count+1] == IM_ERR_OPEN);
+  IM_TEST_CHECK(infos[format_count+1].width == 0 && infos[format_count+1].format[0] == 0);
+
+  for (int i = 0; i < format_count+2; i++)
+    remove(file_names[i]);
+
+  imImageDestroy(rgb);
+  imImageDestroy(gray);
+  imImageDestroy(map);
+
+  return iTestEnd("im_test_probe");
+}
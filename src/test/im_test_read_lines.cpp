@@ -0,0 +1,143 @@
+/** \file
+ * \brief Regression test of imFileReadImageLines (user-047)
+ *
+ * Images read in blocks of lines must be equal to the images read at once,
+ * in planar and packed user layouts, and blocks out of the file order must fail.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+
+#define IM_TEST_BLOCK 5
+
+struct iTestFormat
+{
+  const char* format;
+  int top_down;      /* file orientation */
+};
+
+static imImage* iTestReadLines(const char* file_name, int packed, int top_down, int *error)
+{
+  imFile* ifile = imFileOpen(file_name, error);
+  if (!ifile)
+    return NULL;
+
+  int width, height, color_mode, data_type;
+  *error = imFileReadImageInfo(ifile, 0, &width, &height, &color_mode, &data_type);
+  if (*error)
+  {
+    imFileClose(ifile);
+    return NULL;
+  }
+
+  imImage* image = imImageCreate(width, height, imColorModeSpace(color_mode), data_type);
+  imbyte* block = (imbyte*)malloc(IM_TEST_BLOCK * image->width * image->depth);
+  int color_mode_flags = packed? IM_PACKED: 0;
+
+  /* the user data is bottom up, so a top down file returns the last lines first */
+  for (int line = 0; line < height && *error == IM_ERR_NONE; line += IM_TEST_BLOCK)
+  {
+    int count = (height - line < IM_TEST_BLOCK)? height - line: IM_TEST_BLOCK;
+    int first_line = top_down? height - (line + count): line;
+
+    *error = imFileReadImageLines(ifile, block, first_line, count, 0, color_mode_flags);
+    if (*error == IM_ERR_NONE)
+      iTestCopyLines(image, block, first_line, count, packed, 0);
+  }
+
+  free(block);
+  imFileClose(ifile);
+
+  if (*error)
+  {
+    imImageDestroy(image);
+    return NULL;
+  }
+
+  return image;
+}
+
+static void iTestReadOutOfOrder(const char* file_name, int top_down)
+{
+  int error;
+  imFile* ifile = imFileOpen(file_name, &error);
+  IM_TEST_CHECK(ifile != NULL);
+  if (!ifile)
+    return;
+
+  int width, height, color_mode, data_type;
+  IM_TEST_CHECK(imFileReadImageInfo(ifile, 0, &width, &height, &color_mode, &data_type) == IM_ERR_NONE);
+
+  imbyte* block = (imbyte*)malloc(IM_TEST_BLOCK * width * imColorModeDepth(color_mode));
+
+  /* the second block in the file order can not be the first read */
+  int first_line = top_down? height - 2*IM_TEST_BLOCK: IM_TEST_BLOCK;
+  IM_TEST_CHECK(imFileReadImageLines(ifile, block, first_line, IM_TEST_BLOCK, 0, 0) == IM_ERR_DATA);
+
+  /* lines outside the image */
+  IM_TEST_CHECK(imFileReadImageLines(ifile, block, height - 1, IM_TEST_BLOCK, 0, 0) == IM_ERR_DATA);
+
+  free(block);
+  imFileClose(ifile);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  static const iTestFormat formats[] = {
+    {"BMP", 0}, {"PNM", 1}, {"TIFF", 1}, {"PNG", 1}, {"JPEG", 1}
+  };
+  const int format_count = sizeof(formats)/sizeof(formats[0]);
+
+  imImage* rgb = iTestCreateImage(53, 41, IM_RGB, 0);
+  imImage* gray = iTestCreateImage(53, 41, IM_GRAY, 0);
+
+  for (int i = 0; i < format_count; i++)
+  {
+    const iTestFormat* f = formats + i;
+    char file_name[512], name[64];
+    sprintf(name, "im_test_read_lines.%s", f->format);
+    iTestFileName(file_name, name);
+
+    imImage* images[2] = {rgb, gray};
+    for (int j = 0; j < 2; j++)
+    {
+      imImage* image = images[j];
+      IM_TEST_CHECK(imFileImageSave(file_name, f->format, image) == IM_ERR_NONE);
+
+      int error;
+      imImage* loaded = imFileImageLoad(file_name, 0, &error);
+      IM_TEST_CHECK(loaded != NULL);
+      if (!loaded)
+        continue;
+
+      for (int packed = 0; packed < 2; packed++)
+      {
+        if (packed && image->depth == 1)
+          continue;
+
+        imImage* lines = iTestReadLines(file_name, packed, f->top_down, &error);
+        IM_TEST_CHECK(error == IM_ERR_NONE);
+        if (!lines)
+          continue;
+
+        IM_TEST_CHECK(lines->color_space == loaded->color_space);
+        IM_TEST_CHECK(iTestCompare(lines, loaded) == 0);
+        imImageDestroy(lines);
+      }
+
+      imImageDestroy(loaded);
+    }
+
+    iTestReadOutOfOrder(file_name, f->top_down);
+    remove(file_name);
+  }
+
+  imImageDestroy(rgb);
+  imImageDestroy(gray);
+
+  return iTestEnd("im_test_read_lines");
+}
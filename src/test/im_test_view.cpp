@@ -0,0 +1,186 @@
+/** \file
+ * \brief Regression test of the image views (user-036)
+ *
+ * Views share the pixels of the image, keep them alive after the image is destroyed,
+ * and are processed, converted and saved as the same region copied to a contiguous image.
+ * Pixels outside the view are never written.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+#include <im_convert.h>
+#include <im_process.h>
+
+
+static imImage* iTestCropCopy(const imImage* image, int xmin, int ymin, int width, int height)
+{
+  imImage* region = imImageCreate(width, height, image->color_space, image->data_type);
+  imProcessCrop(image, region, xmin, ymin);
+  return region;
+}
+
+/* Compares a processing function applied to the view and to a contiguous copy of the same region */
+static void iTestProcess(const imImage* view, const imImage* region, void (*process)(const imImage* src, imImage* dst))
+{
+  imImage* dst_view = imImageClone(region);
+  imImage* dst_region = imImageClone(region);
+
+  process(view, dst_view);
+  process(region, dst_region);
+  IM_TEST_CHECK(iTestCompare(dst_view, dst_region) == 0);
+
+  imImageDestroy(dst_view);
+  imImageDestroy(dst_region);
+}
+
+static void iTestGaussian(const imImage* src, imImage* dst) { imProcessGaussianConvolve(src, dst, 1.5f); }
+static void iTestMedian(const imImage* src, imImage* dst) { imProcessMedianConvolve(src, dst, 5); }
+static void iTestNegative(const imImage* src, imImage* dst) { imProcessNegative(src, dst); }
+static void iTestMirror(const imImage* src, imImage* dst) { imProcessMirror(src, dst); }
+static void iTestFlip(const imImage* src, imImage* dst) { imProcessFlip(src, dst); }
+static void iTestErode(const imImage* src, imImage* dst) { imProcessGrayMorphErode(src, dst, 3); }
+static void iTestCopyView(const imImage* src, imImage* dst) { imImageCopyData(src, dst); }
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  for (int aligned = 0; aligned < 2; aligned++)
+  {
+    imImage* image = iTestCreateImage(50, 40, IM_RGB, aligned? IM_IMAGE_ALIGNED: 0);
+    imImage* original = imImageDuplicate(image);
+
+    /* the region is not inside the image */
+    IM_TEST_CHECK(imImageCreateView(image, 40, 30, 20, 15) == NULL);
+    IM_TEST_CHECK(imImageCreateView(image, -1, 0, 20, 15) == NULL);
+
+    imImage* view = imImageCreateView(image, 7, 5, 20, 15);
+    IM_TEST_CHECK(view != NULL);
+    if (!view)
+      continue;
+
+    IM_TEST_CHECK(view->width == 20 && view->height == 15);
+    IM_TEST_CHECK(view->line_stride == image->line_stride);
+    IM_TEST_CHECK(!(view->flags & IM_IMAGE_ALIGNED));
+    IM_TEST_CHECK(!imImageIsContiguous(view));
+    IM_TEST_CHECK((imbyte*)view->data[1] == (imbyte*)image->data[1] + 5*image->line_stride + 7);
+
+    imImage* region = iTestCropCopy(image, 7, 5, 20, 15);
+    IM_TEST_CHECK(iTestCompare(view, region) == 0);
+
+    /* functions that use the padded layout, and functions that use contiguous copies */
+    iTestProcess(view, region, iTestGaussian);
+    iTestProcess(view, region, iTestMedian);
+    iTestProcess(view, region, iTestNegative);
+    iTestProcess(view, region, iTestMirror);
+    iTestProcess(view, region, iTestFlip);
+    iTestProcess(view, region, iTestErode);
+    iTestProcess(view, region, iTestCopyView);
+
+    /* writing to the view changes only the region of the image */
+    imProcessNegative(view, view);
+    imProcessNegative(region, region);
+    {
+      imImage* changed = iTestCropCopy(image, 7, 5, 20, 15);
+      IM_TEST_CHECK(iTestCompare(changed, region) == 0);
+      imImageDestroy(changed);
+
+      imImage* expected = imImageDuplicate(original);
+      imImage* expected_view = imImageCreateView(expected, 7, 5, 20, 15);
+      imImageCopyData(region, expected_view);
+      IM_TEST_CHECK(iTestCompare(image, expected) == 0);
+      imImageDestroy(expected_view);
+      imImageDestroy(expected);
+    }
+
+    /* a view of a view, outputs of conversions and resize */
+    imImage* sub_view = imImageCreateView(view, 3, 2, 10, 8);
+    IM_TEST_CHECK(sub_view != NULL);
+    if (sub_view)
+    {
+      imImage* sub_region = iTestCropCopy(region, 3, 2, 10, 8);
+      IM_TEST_CHECK(iTestCompare(sub_view, sub_region) == 0);
+
+      imImage* gray_view = imImageCreate(10, 8, IM_GRAY, IM_BYTE);
+      imImage* gray_region = imImageCreate(10, 8, IM_GRAY, IM_BYTE);
+      IM_TEST_CHECK(imConvertColorSpace(sub_view, gray_view) == IM_ERR_NONE);
+      IM_TEST_CHECK(imConvertColorSpace(sub_region, gray_region) == IM_ERR_NONE);
+      IM_TEST_CHECK(iTestCompare(gray_view, gray_region) == 0);
+      imImageDestroy(gray_view);
+      imImageDestroy(gray_region);
+
+      imImage* small = imImageCreate(7, 5, IM_RGB, IM_BYTE);
+      imImage* small_region = imImageCreate(7, 5, IM_RGB, IM_BYTE);
+      imProcessResize(sub_view, small, 1);
+      imProcessResize(sub_region, small_region, 1);
+      IM_TEST_CHECK(iTestCompare(small, small_region) == 0);
+
+      /* the output of a resize can also be a view */
+      imImage* dst_view = imImageCreateView(view, 1, 1, 7, 5);
+      imImage* outside = imImageDuplicate(image);
+      imProcessResize(sub_region, dst_view, 1);
+      IM_TEST_CHECK(iTestCompare(dst_view, small_region) == 0);
+      imImageDestroy(dst_view);
+
+      imImage* outside_view = imImageCreateView(outside, 8, 6, 7, 5);
+      imImageCopyData(small_region, outside_view);
+      IM_TEST_CHECK(iTestCompare(image, outside) == 0);
+      imImageDestroy(outside_view);
+      imImageDestroy(outside);
+
+      imImageDestroy(small);
+      imImageDestroy(small_region);
+      imImageDestroy(sub_region);
+    }
+
+    /* saving a view saves the region */
+    {
+      char file_name[512];
+      iTestFileName(file_name, "im_test_view.png");
+      imImage* saved_region = iTestCropCopy(image, 7, 5, 20, 15);
+      IM_TEST_CHECK(imFileImageSave(file_name, "PNG", view) == IM_ERR_NONE);
+
+      int error;
+      imImage* loaded = imFileImageLoad(file_name, 0, &error);
+      IM_TEST_CHECK(loaded != NULL);
+      if (loaded)
+      {
+        IM_TEST_CHECK(iTestCompare(loaded, saved_region) == 0);
+        imImageDestroy(loaded);
+      }
+
+      imImageDestroy(saved_region);
+      remove(file_name);
+    }
+
+    /* the views keep the pixels after the image is destroyed */
+    imImage* kept = iTestCropCopy(image, 7, 5, 20, 15);
+    imImageDestroy(image);
+    IM_TEST_CHECK(iTestCompare(view, kept) == 0);
+    if (sub_view)
+    {
+      imImage* sub_kept = iTestCropCopy(kept, 3, 2, 10, 8);
+      imImageDestroy(view);
+      view = NULL;
+      IM_TEST_CHECK(iTestCompare(sub_view, sub_kept) == 0);
+
+      /* adding alpha detaches the view */
+      imImageAddAlpha(sub_view);
+      IM_TEST_CHECK(sub_view->has_alpha && imImageIsContiguous(sub_view));
+      IM_TEST_CHECK(iTestCompare(sub_view, sub_kept) == 0);
+
+      imImageDestroy(sub_kept);
+      imImageDestroy(sub_view);
+    }
+
+    if (view)
+      imImageDestroy(view);
+    imImageDestroy(kept);
+    imImageDestroy(region);
+    imImageDestroy(original);
+  }
+
+  return iTestEnd("im_test_view");
+}
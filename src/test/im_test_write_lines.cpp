@@ -0,0 +1,146 @@
+/** \file
+ * \brief Regression test of imFileWriteImageLines (user-046)
+ *
+ * Images written in blocks of lines must load as the images written at once,
+ * in planar and packed user layouts, and blocks out of the file order must fail.
+ *
+ * See Copyright Notice in im_lib.h
+ */
+
+#include "im_test.h"
+
+
+#define IM_TEST_BLOCK 7
+
+struct iTestFormat
+{
+  const char* format;
+  int top_down;      /* file orientation */
+  int tolerance;     /* compression loss */
+};
+
+static int iTestWriteLines(const char* file_name, const char* format, imImage* image, int packed, int top_down)
+{
+  int error;
+  imFile* ifile = imFileNew(file_name, format, &error);
+  if (!ifile)
+    return error;
+
+  int user_color_mode = packed? image->color_space | IM_PACKED: image->color_space;
+  error = imFileWriteImageInfo(ifile, image->width, image->height, user_color_mode, IM_BYTE);
+  if (error)
+  {
+    imFileClose(ifile);
+    return error;
+  }
+
+  imbyte* block = (imbyte*)malloc(IM_TEST_BLOCK * image->width * image->depth);
+  int height = image->height;
+
+  /* the user data is bottom up, so a top down file receives the last lines first */
+  for (int line = 0; line < height && error == IM_ERR_NONE; line += IM_TEST_BLOCK)
+  {
+    int count = (height - line < IM_TEST_BLOCK)? height - line: IM_TEST_BLOCK;
+    int first_line = top_down? height - (line + count): line;
+
+    iTestCopyLines(image, block, first_line, count, packed, 1);
+    error = imFileWriteImageLines(ifile, block, first_line, count);
+  }
+
+  free(block);
+  imFileClose(ifile);
+  return error;
+}
+
+static void iTestWriteOutOfOrder(const char* file_name, const char* format, imImage* image, int top_down)
+{
+  int error;
+  imFile* ifile = imFileNew(file_name, format, &error);
+  IM_TEST_CHECK(ifile != NULL);
+  if (!ifile)
+    return;
+
+  IM_TEST_CHECK(imFileWriteImageInfo(ifile, image->width, image->height, image->color_space, IM_BYTE) == IM_ERR_NONE);
+
+  imbyte* block = (imbyte*)malloc(IM_TEST_BLOCK * image->width * image->depth);
+  int height = image->height;
+
+  /* the second block in the file order can not be the first written */
+  int first_line = top_down? height - 2*IM_TEST_BLOCK: IM_TEST_BLOCK;
+  iTestCopyLines(image, block, first_line, IM_TEST_BLOCK, 0, 1);
+  IM_TEST_CHECK(imFileWriteImageLines(ifile, block, first_line, IM_TEST_BLOCK) == IM_ERR_DATA);
+
+  /* lines outside the image */
+  IM_TEST_CHECK(imFileWriteImageLines(ifile, block, height - 1, IM_TEST_BLOCK) == IM_ERR_DATA);
+
+  free(block);
+  imFileClose(ifile);
+}
+
+int main(int argc, char* argv[])
+{
+  iTestInit(argc, argv);
+
+  static const iTestFormat formats[] = {
+    {"BMP", 0, 0}, {"PNM", 1, 0}, {"TIFF", 1, 0}, {"PNG", 1, 0}, {"JPEG", 1, 16}
+  };
+  const int format_count = sizeof(formats)/sizeof(formats[0]);
+
+  imImage* rgb = iTestCreateImage(61, 37, IM_RGB, 0);
+  imImage* gray = iTestCreateImage(61, 37, IM_GRAY, 0);
+
+  for (int i = 0; i < format_count; i++)
+  {
+    const iTestFormat* f = formats + i;
+    char file_name[512], name[64];
+    sprintf(name, "im_test_write_lines.%s", f->format);
+    iTestFileName(file_name, name);
+
+    for (int packed = 0; packed < 2; packed++)
+    {
+      imImage* images[2] = {rgb, gray};
+      for (int j = 0; j < 2; j++)
+      {
+        imImage* image = images[j];
+        if (packed && image->depth == 1)
+          continue;
+
+        int error = iTestWriteLines(file_name, f->format, image, packed, f->top_down);
+        IM_TEST_CHECK(error == IM_ERR_NONE);
+        if (error)
+          continue;
+
+        imImage* loaded = imFileImageLoad(file_name, 0, &error);
+        IM_TEST_CHECK(loaded != NULL);
+        if (!loaded)
+          continue;
+
+        IM_TEST_CHECK(loaded->color_space == image->color_space);
+        IM_TEST_CHECK(iTestCompare(loaded, image) <= f->tolerance);
+
+        /* the same image written at once */
+        if (f->tolerance)
+        {
+          IM_TEST_CHECK(imFileImageSave(file_name, f->format, image) == IM_ERR_NONE);
+          imImage* saved = imFileImageLoad(file_name, 0, &error);
+          IM_TEST_CHECK(saved != NULL);
+          if (saved)
+          {
+            IM_TEST_CHECK(iTestCompare(loaded, saved) == 0);
+            imImageDestroy(saved);
+          }
+        }
+
+        imImageDestroy(loaded);
+      }
+    }
+
+    iTestWriteOutOfOrder(file_name, f->format, rgb, f->top_down);
+    remove(file_name);
+  }
+
+  imImageDestroy(rgb);
+  imImageDestroy(gray);
+
+  return iTestEnd("im_test_write_lines");
+}
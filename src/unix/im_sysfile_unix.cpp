@@ -62,7 +62,7 @@ void imBinSystemFile::Open(const char* pFileName)
 
 void imBinSystemFile::New(const char* pFileName)
 {
-  int mode = O_WRONLY | O_CREAT | O_TRUNC;           
+  int mode = O_RDWR | O_CREAT | O_TRUNC;  // some formats must read back what was written (TIFF directories)
 #ifdef O_BINARY
     mode |= O_BINARY;
 #endif        